@@ -0,0 +1,28 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// CPU affinity handling for packaging jobs on shared hosts.
+
+#ifndef APP_CPU_AFFINITY_H_
+#define APP_CPU_AFFINITY_H_
+
+#include <gflags/gflags.h>
+
+DECLARE_string(cpu_affinity);
+
+namespace shaka {
+namespace media {
+
+/// Apply the --cpu_affinity flag to the current process, if set. Threads
+/// created afterwards inherit the CPU set, so this must be called before the
+/// pipeline threads are spawned.
+/// @return true on success or if the flag is empty.
+bool SetCpuAffinityFromFlags();
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // APP_CPU_AFFINITY_H_
@@ -13,6 +13,12 @@
 DEFINE_bool(enable_fixed_key_encryption,
             false,
             "Enable encryption with fixed key.");
+DEFINE_bool(enable_synthetic_encryption,
+            false,
+            "Enable encryption with locally fabricated random keys, for load "
+            "and capacity testing of the encrypted path without license "
+            "server dependencies. The keys are not escrowed anywhere, so the "
+            "output can never be decrypted. NOT for production packaging.");
 DEFINE_bool(enable_fixed_key_decryption,
             false,
             "Enable decryption with fixed key.");
@@ -67,6 +73,13 @@ bool ValidateFixedCryptoFlags() {
                     "--enable_fixed_key_encryption")) {
     success = false;
   }
+
+  if (FLAGS_enable_synthetic_encryption && FLAGS_enable_fixed_key_encryption) {
+    PrintError(
+        "--enable_synthetic_encryption cannot be combined with "
+        "--enable_fixed_key_encryption.");
+    success = false;
+  }
   return success;
 }
 
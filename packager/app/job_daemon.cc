@@ -0,0 +1,154 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/job_daemon.h"
+
+#include "packager/base/logging.h"
+
+#if defined(OS_WIN)
+
+namespace shaka {
+namespace media {
+
+// TODO(tinskip): Implement on top of named pipes for winsock builds.
+JobDaemon::JobDaemon(const std::string& socket_path,
+                     const RunJobCallback& run_job)
+    : socket_path_(socket_path), run_job_(run_job), listen_socket_(-1) {}
+
+JobDaemon::~JobDaemon() {}
+
+bool JobDaemon::Run() {
+  NOTIMPLEMENTED() << "Daemon mode is not supported on Windows.";
+  return false;
+}
+
+bool JobDaemon::ServeConnection(int connection_socket) {
+  return false;
+}
+
+}  // namespace media
+}  // namespace shaka
+
+#else
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "packager/base/strings/string_split.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const int kInvalidSocket(-1);
+const int kListenBacklog(8);
+
+}  // namespace
+
+JobDaemon::JobDaemon(const std::string& socket_path,
+                     const RunJobCallback& run_job)
+    : socket_path_(socket_path),
+      run_job_(run_job),
+      listen_socket_(kInvalidSocket) {}
+
+JobDaemon::~JobDaemon() {
+  if (listen_socket_ != kInvalidSocket) {
+    close(listen_socket_);
+    unlink(socket_path_.c_str());
+  }
+}
+
+bool JobDaemon::Run() {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (socket_path_.size() >= sizeof(addr.sun_path)) {
+    LOG(ERROR) << "Socket path too long: " << socket_path_;
+    return false;
+  }
+  strncpy(addr.sun_path, socket_path_.c_str(), sizeof(addr.sun_path) - 1);
+
+  listen_socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_socket_ == kInvalidSocket) {
+    PLOG(ERROR) << "Could not create daemon socket";
+    return false;
+  }
+
+  // Replace any stale socket file left over from a previous run.
+  unlink(socket_path_.c_str());
+  if (bind(listen_socket_, reinterpret_cast<struct sockaddr*>(&addr),
+           sizeof(addr)) < 0) {
+    PLOG(ERROR) << "Could not bind daemon socket to " << socket_path_;
+    return false;
+  }
+  if (listen(listen_socket_, kListenBacklog) < 0) {
+    PLOG(ERROR) << "Could not listen on daemon socket " << socket_path_;
+    return false;
+  }
+
+  LOG(INFO) << "Waiting for packaging jobs on " << socket_path_;
+  while (true) {
+    int connection_socket = accept(listen_socket_, NULL, NULL);
+    if (connection_socket < 0) {
+      if (errno == EINTR)
+        continue;
+      PLOG(ERROR) << "Accept failed on daemon socket " << socket_path_;
+      return false;
+    }
+    ServeConnection(connection_socket);
+    close(connection_socket);
+  }
+}
+
+bool JobDaemon::ServeConnection(int connection_socket) {
+  std::string request;
+  char buffer[4096];
+  ssize_t bytes_read;
+  while ((bytes_read = read(connection_socket, buffer, sizeof(buffer))) > 0)
+    request.append(buffer, bytes_read);
+  if (bytes_read < 0) {
+    PLOG(ERROR) << "Read failed on daemon connection";
+    return false;
+  }
+
+  std::vector<std::string> lines;
+  base::SplitString(request, '\n', &lines);
+
+  StreamDescriptorList stream_descriptors;
+  bool success = true;
+  for (std::vector<std::string>::const_iterator line_iter = lines.begin();
+       line_iter != lines.end();
+       ++line_iter) {
+    if (line_iter->empty())
+      continue;
+    if (!InsertStreamDescriptor(*line_iter, &stream_descriptors)) {
+      success = false;
+      break;
+    }
+  }
+  if (stream_descriptors.empty()) {
+    LOG(ERROR) << "Job submission contains no stream descriptors.";
+    success = false;
+  }
+
+  if (success)
+    success = run_job_.Run(stream_descriptors);
+
+  const char* reply = success ? "OK\n" : "ERROR\n";
+  if (write(connection_socket, reply, strlen(reply)) < 0)
+    PLOG(WARNING) << "Failed to write daemon reply";
+  return success;
+}
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // defined(OS_WIN)
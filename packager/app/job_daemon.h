@@ -0,0 +1,55 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef APP_JOB_DAEMON_H_
+#define APP_JOB_DAEMON_H_
+
+#include <string>
+
+#include "packager/app/stream_descriptor.h"
+#include "packager/base/callback.h"
+#include "packager/base/macros.h"
+
+namespace shaka {
+namespace media {
+
+/// Serves packaging jobs submitted over a local (unix domain) socket from a
+/// long-lived process. Each connection carries one job: one stream descriptor
+/// string per line, terminated by the client shutting down its write side.
+/// The daemon runs the job using already-initialized global state (gflags,
+/// libcrypto threading, key source) and replies with a single "OK" or "ERROR"
+/// line, so short jobs do not pay process startup or license fetch costs.
+class JobDaemon {
+ public:
+  typedef base::Callback<bool(const StreamDescriptorList&)> RunJobCallback;
+
+  /// @param socket_path is the filesystem path to listen on. An existing
+  ///        socket file at this path is replaced.
+  /// @param run_job is called synchronously for each submitted job.
+  JobDaemon(const std::string& socket_path, const RunJobCallback& run_job);
+  ~JobDaemon();
+
+  /// Listen on the socket and serve jobs until an unrecoverable socket error
+  /// occurs. Jobs are run one at a time in submission order.
+  /// @return false if the socket could not be set up or accept failed.
+  bool Run();
+
+ private:
+  // Reads one job from @a connection_socket, runs it and writes the reply.
+  // Returns true if the job was parsed and packaged successfully.
+  bool ServeConnection(int connection_socket);
+
+  std::string socket_path_;
+  RunJobCallback run_job_;
+  int listen_socket_;
+
+  DISALLOW_COPY_AND_ASSIGN(JobDaemon);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // APP_JOB_DAEMON_H_
@@ -43,6 +43,20 @@ DEFINE_double(suggested_presentation_delay,
               0.0,
               "Specifies a delay, in seconds, to be added to the media "
               "presentation time. This value is used for live profile only.");
+DEFINE_double(mpd_flush_interval,
+              0.0,
+              "If positive, MPD updates for live profile are written by a "
+              "dedicated thread at most once per this many seconds, coalescing "
+              "pending updates and publishing the file with an atomic rename. "
+              "If zero, the MPD is rewritten synchronously on every segment.");
+DEFINE_bool(mpd_sharded_output,
+            false,
+            "Write each AdaptationSet to its own file next to the MPD, "
+            "composed by a small root MPD via xlink references. Only shards "
+            "with new segments are rewritten on an update, so the write cost "
+            "and the origin cache invalidation granularity match one "
+            "representation's change instead of the whole manifest. Not "
+            "supported with --generate_dash_if_iop_compliant_mpd.");
 DEFINE_bool(generate_dash_if_iop_compliant_mpd,
             false,
             "Try to generate DASH-IF IOPv3 compliant MPD. This is best effort "
@@ -4,13 +4,24 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 
+#include <algorithm>
+#include <map>
+
 #include "packager/app/mpd_generator_flags.h"
 #include "packager/app/vlog_flags.h"
 #include "packager/base/at_exit.h"
+#include "packager/base/bind.h"
 #include "packager/base/command_line.h"
 #include "packager/base/logging.h"
+#include "packager/base/stl_util.h"
 #include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/sys_info.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/file/file.h"
+#include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/util/mpd_writer.h"
 #include "packager/version/version.h"
 
@@ -27,16 +38,29 @@ const char kUsage[] =
     "audio, and 1 text.\n"
     "Sample Usage:\n"
     "%s --input=\"video1.media_info,video2.media_info,audio1.media_info\" "
-    "--output=\"video_audio.mpd\"";
+    "--output=\"video_audio.mpd\"\n"
+    "Batch mode generates many MPDs concurrently in one process:\n"
+    "%s --batch_input=\"jobs.txt\" --batch_threads=8\n"
+    "--merge_sharded_inputs merges MediaInfo files produced by a packaging "
+    "job that was split by time range across several packager invocations.";
 
 enum ExitStatus {
   kSuccess = 0,
   kEmptyInputError,
   kEmptyOutputError,
-  kFailedToWriteMpdToFileError
+  kFailedToWriteMpdToFileError,
+  kBatchInputError
 };
 
 ExitStatus CheckRequiredFlags() {
+  if (!FLAGS_batch_input.empty()) {
+    if (!FLAGS_input.empty() || !FLAGS_output.empty()) {
+      LOG(ERROR) << "--batch_input is exclusive with --input and --output.";
+      return kBatchInputError;
+    }
+    return kSuccess;
+  }
+
   if (FLAGS_input.empty()) {
     LOG(ERROR) << "--input is required.";
     return kEmptyInputError;
@@ -72,6 +96,9 @@ ExitStatus RunMpdGenerator() {
     }
   }
 
+  if (FLAGS_merge_sharded_inputs)
+    mpd_writer.MergeShardMediaInfos();
+
   if (!mpd_writer.WriteMpdToFile(FLAGS_output.c_str())) {
     LOG(ERROR) << "Failed to write MPD to " << FLAGS_output;
     return kFailedToWriteMpdToFileError;
@@ -80,13 +107,189 @@ ExitStatus RunMpdGenerator() {
   return kSuccess;
 }
 
+struct BatchJob {
+  std::string output_path;
+  std::vector<std::string> media_info_paths;
+};
+
+// Parses the batch input file content. Each non-empty line that does not
+// start with '#' must have the form
+//   <output mpd path>=<comma separated MediaInfo file paths>
+bool ParseBatchFile(const std::string& content, std::vector<BatchJob>* jobs) {
+  DCHECK(jobs);
+  std::vector<std::string> lines;
+  base::SplitString(content, '\n', &lines);
+  for (size_t i = 0; i < lines.size(); ++i) {
+    std::string line;
+    base::TrimWhitespaceASCII(lines[i], base::TRIM_ALL, &line);
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    const size_t separator_pos = line.find('=');
+    if (separator_pos == std::string::npos || separator_pos == 0 ||
+        separator_pos + 1 == line.size()) {
+      LOG(ERROR) << "Malformed batch line (expected "
+                 << "'output.mpd=a.media_info,b.media_info'): " << line;
+      return false;
+    }
+
+    BatchJob job;
+    job.output_path = line.substr(0, separator_pos);
+    base::SplitString(line.substr(separator_pos + 1), ',',
+                      &job.media_info_paths);
+    jobs->push_back(job);
+  }
+  return true;
+}
+
+// Runs a set of BatchJobs on a pool of worker threads. MediaInfo files are
+// parsed at most once per batch, so assets sharing streams (e.g. a common
+// audio track) reuse the parsed proto.
+class BatchMpdGenerator {
+ public:
+  BatchMpdGenerator(const std::vector<BatchJob>& jobs,
+                    const std::vector<std::string>& base_urls)
+      : jobs_(jobs),
+        base_urls_(base_urls),
+        next_job_(0),
+        num_failures_(0) {}
+
+  // Runs all jobs on at most |num_threads| workers. Returns the number of
+  // jobs that failed.
+  size_t Run(int num_threads) {
+    const size_t num_workers =
+        std::min(static_cast<size_t>(num_threads), jobs_.size());
+    if (num_workers <= 1) {
+      WorkerMain();
+      return num_failures_;
+    }
+
+    std::vector<media::ClosureThread*> workers;
+    for (size_t i = 0; i < num_workers; ++i) {
+      workers.push_back(new media::ClosureThread(
+          "MpdBatchWorker",
+          base::Bind(&BatchMpdGenerator::WorkerMain, base::Unretained(this))));
+      workers[i]->Start();
+    }
+    for (size_t i = 0; i < num_workers; ++i)
+      workers[i]->Join();
+    STLDeleteElements(&workers);
+    return num_failures_;
+  }
+
+ private:
+  // Gets the parsed MediaInfo for |path|, reading and parsing the file only
+  // on the first request.
+  bool GetMediaInfo(const std::string& path, MediaInfo* media_info) {
+    {
+      base::AutoLock auto_lock(lock_);
+      std::map<std::string, MediaInfo>::const_iterator it =
+          media_info_cache_.find(path);
+      if (it != media_info_cache_.end()) {
+        *media_info = it->second;
+        return true;
+      }
+    }
+    // Parse outside the lock; two workers racing on the same file just parse
+    // it twice and one result wins.
+    MediaInfo parsed;
+    if (!ReadMediaInfoFile(path, &parsed))
+      return false;
+
+    base::AutoLock auto_lock(lock_);
+    media_info_cache_[path] = parsed;
+    *media_info = parsed;
+    return true;
+  }
+
+  bool RunJob(const BatchJob& job) {
+    MpdWriter mpd_writer;
+    typedef std::vector<std::string>::const_iterator Iterator;
+    for (Iterator it = base_urls_.begin(); it != base_urls_.end(); ++it)
+      mpd_writer.AddBaseUrl(*it);
+
+    for (Iterator it = job.media_info_paths.begin();
+         it != job.media_info_paths.end(); ++it) {
+      MediaInfo media_info;
+      if (!GetMediaInfo(*it, &media_info)) {
+        LOG(WARNING) << "Failed to read " << *it << ", skipping.";
+        continue;
+      }
+      mpd_writer.AddMediaInfo(media_info, job.output_path);
+    }
+    if (FLAGS_merge_sharded_inputs)
+      mpd_writer.MergeShardMediaInfos();
+    return mpd_writer.WriteMpdToFile(job.output_path.c_str());
+  }
+
+  void WorkerMain() {
+    for (;;) {
+      size_t job_index;
+      {
+        base::AutoLock auto_lock(lock_);
+        if (next_job_ >= jobs_.size())
+          return;
+        job_index = next_job_++;
+      }
+      if (!RunJob(jobs_[job_index])) {
+        LOG(ERROR) << "Failed to generate " << jobs_[job_index].output_path;
+        base::AutoLock auto_lock(lock_);
+        ++num_failures_;
+      }
+    }
+  }
+
+  const std::vector<BatchJob>& jobs_;
+  const std::vector<std::string>& base_urls_;
+
+  // Guards |next_job_|, |num_failures_| and |media_info_cache_|.
+  base::Lock lock_;
+  size_t next_job_;
+  size_t num_failures_;
+  std::map<std::string, MediaInfo> media_info_cache_;
+};
+
+ExitStatus RunBatchMode() {
+  std::string batch_content;
+  if (!media::File::ReadFileToString(FLAGS_batch_input.c_str(),
+                                     &batch_content)) {
+    LOG(ERROR) << "Failed to read batch input file " << FLAGS_batch_input;
+    return kBatchInputError;
+  }
+
+  std::vector<BatchJob> jobs;
+  if (!ParseBatchFile(batch_content, &jobs))
+    return kBatchInputError;
+  if (jobs.empty()) {
+    LOG(ERROR) << "Batch input file " << FLAGS_batch_input
+               << " contains no jobs.";
+    return kBatchInputError;
+  }
+
+  std::vector<std::string> base_urls;
+  if (!FLAGS_base_urls.empty())
+    base::SplitString(FLAGS_base_urls, ',', &base_urls);
+
+  const int num_threads = FLAGS_batch_threads > 0
+                              ? FLAGS_batch_threads
+                              : base::SysInfo::NumberOfProcessors();
+  BatchMpdGenerator generator(jobs, base_urls);
+  const size_t num_failures = generator.Run(num_threads);
+  if (num_failures > 0) {
+    LOG(ERROR) << num_failures << " of " << jobs.size()
+               << " MPD generation jobs failed.";
+    return kFailedToWriteMpdToFileError;
+  }
+  return kSuccess;
+}
+
 int MpdMain(int argc, char** argv) {
   base::AtExitManager exit;
   // Needed to enable VLOG/DVLOG through --vmodule or --v.
   base::CommandLine::Init(argc, argv);
   CHECK(logging::InitLogging(logging::LoggingSettings()));
 
-  google::SetUsageMessage(base::StringPrintf(kUsage, argv[0]));
+  google::SetUsageMessage(base::StringPrintf(kUsage, argv[0], argv[0]));
   google::ParseCommandLineFlags(&argc, &argv, true);
 
   ExitStatus status = CheckRequiredFlags();
@@ -97,7 +300,7 @@ int MpdMain(int argc, char** argv) {
     return status;
   }
 
-  return RunMpdGenerator();
+  return FLAGS_batch_input.empty() ? RunMpdGenerator() : RunBatchMode();
 }
 
 }  // namespace
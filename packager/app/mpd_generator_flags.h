@@ -15,4 +15,23 @@ DEFINE_string(base_urls,
               "",
               "Comma separated BaseURLs for the MPD. The values will be added "
               "as <BaseURL> element(s) immediately under the <MPD> element.");
+DEFINE_string(batch_input,
+              "",
+              "Batch mode: path to a file listing one MPD generation job per "
+              "line, in the form "
+              "'output.mpd=first.media_info,second.media_info'. Blank lines "
+              "and lines starting with '#' are ignored. Exclusive with "
+              "--input and --output.");
+DEFINE_int32(batch_threads,
+             0,
+             "Number of concurrent MPD generation jobs in batch mode. 0 uses "
+             "the number of processor cores.");
+DEFINE_bool(merge_sharded_inputs,
+            false,
+            "Treat input MediaInfo files that share the same segment template "
+            "and init segment name as time-ordered shards of one stream and "
+            "merge them into a single Representation, summing the durations. "
+            "Use this to combine the outputs of a packaging job that was "
+            "split by time range across several packager invocations (see "
+            "packager --shard_count).");
 #endif  // APP_MPD_GENERATOR_FLAGS_H_
@@ -29,6 +29,14 @@ DEFINE_double(segment_duration,
 DEFINE_bool(segment_sap_aligned,
             true,
             "Force segments to begin with stream access points.");
+DEFINE_uint64(segment_start_number,
+              1,
+              "First value substituted for $Number$ in the segment template "
+              "and exposed as startNumber in the MPD. Set to the next "
+              "segment number of the stream when taking over a live channel "
+              "from another packager instance (see "
+              "--standby_promotion_file), so segment naming and the "
+              "manifest timeline continue seamlessly.");
 DEFINE_double(fragment_duration,
               10.0f,
               "Fragment duration in seconds. Should not be larger than "
@@ -46,8 +54,42 @@ DEFINE_int32(num_subsegments_per_sidx,
              "subsegments in the root SIDX of the segment, with "
              "segment_duration/N/fragment_duration fragments per "
              "subsegment.");
+DEFINE_int32(encryption_threads,
+             1,
+             "Number of worker threads used to encrypt media samples. With "
+             "more than one thread, the samples of a fragment (MP4) or the "
+             "frames of a cluster (WebM) are encrypted in parallel.");
 DEFINE_string(temp_dir,
               "",
               "Specify a directory in which to store temporary (intermediate) "
               " files. Used only if single_segment=true.");
+DEFINE_bool(mp4_reserve_index_space,
+            false,
+            "For ISO BMFF single-segment output only. Reserve space for the "
+            "moov and sidx boxes at the head of the output file and fill the "
+            "index in at finalization, producing the output in one "
+            "sequential pass without an intermediate file. Requires the "
+            "input duration to be known; falls back to the intermediate "
+            "file otherwise. Takes precedence over temp_file_memory_limit.");
+DEFINE_bool(mp4_stream_fragments,
+            false,
+            "For ISO BMFF live profile only. Write each fragment to the "
+            "current segment file as soon as it is finalized instead of "
+            "buffering the whole segment, emitting 'styp' once per segment "
+            "and no 'sidx'. Cuts end-to-end latency from segment duration "
+            "to fragment duration. Requires segment_template.");
+DEFINE_bool(webm_reserve_cues_space,
+            false,
+            "For WebM single-segment output only. Reserve space for the Cues "
+            "element in front of the media data and fill it in at "
+            "finalization, placing the index at the head of the file in one "
+            "sequential pass. Requires the input duration to be known and a "
+            "seekable output; the Cues are written at the end of the file "
+            "otherwise.");
+DEFINE_uint64(temp_file_memory_limit,
+              0,
+              "If nonzero, keep temporary (intermediate) data in memory up to "
+              "this many bytes, spilling to a file in temp_dir beyond the "
+              "limit. Avoids writing and re-reading every media byte for "
+              "assets that fit in RAM. Used only if single_segment=true.");
 
@@ -16,9 +16,15 @@ DECLARE_double(clear_lead);
 DECLARE_bool(single_segment);
 DECLARE_double(segment_duration);
 DECLARE_bool(segment_sap_aligned);
+DECLARE_uint64(segment_start_number);
 DECLARE_double(fragment_duration);
 DECLARE_bool(fragment_sap_aligned);
 DECLARE_int32(num_subsegments_per_sidx);
+DECLARE_int32(encryption_threads);
+DECLARE_bool(mp4_reserve_index_space);
+DECLARE_bool(mp4_stream_fragments);
+DECLARE_bool(webm_reserve_cues_space);
 DECLARE_string(temp_dir);
+DECLARE_uint64(temp_file_memory_limit);
 
 #endif  // APP_MUXER_FLAGS_H_
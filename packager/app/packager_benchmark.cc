@@ -0,0 +1,436 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// End-to-end throughput benchmark for the packaging pipeline. Synthesizes
+// deterministic H.264 Annex B and AAC ADTS elementary streams of configurable
+// bitrate, resolution and duration, wraps them in an MPEG-2 TS held in a
+// MemoryFile, and runs the full Demuxer->Muxer pipeline against it. Reports
+// overall MB/s and samples/s per run plus the per-stage pipeline counters, so
+// machines and releases can be compared without shipping test media around.
+//
+// The synthetic video consists of identical all-intra frames padded to the
+// target bitrate; the parsers and muxers do the same work per byte as they
+// would on real content, but the output is not meant to be watchable.
+
+#include <gflags/gflags.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "packager/base/at_exit.h"
+#include "packager/base/command_line.h"
+#include "packager/base/logging.h"
+#include "packager/base/memory/scoped_ptr.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/demuxer.h"
+#include "packager/media/base/media_stream.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/base/pipeline_stats.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/file/file.h"
+#include "packager/media/file/memory_file.h"
+#include "packager/media/formats/mp2t/pes_packet.h"
+#include "packager/media/formats/mp2t/ts_writer.h"
+#include "packager/media/formats/mp4/mp4_muxer.h"
+
+DEFINE_int32(duration, 60, "Duration of the synthetic streams in seconds.");
+DEFINE_int32(frame_rate, 30, "Video frame rate in frames per second.");
+DEFINE_int32(width, 1280, "Video width in pixels; rounded up to a multiple of 16.");
+DEFINE_int32(height, 720, "Video height in pixels; rounded up to a multiple of 16.");
+DEFINE_int32(video_bitrate, 4000000, "Video bitrate in bits per second.");
+DEFINE_int32(audio_bitrate, 128000, "Audio bitrate in bits per second.");
+
+namespace shaka {
+namespace media {
+namespace {
+
+const char kVideoInputFile[] = "memory://benchmark/input_video.ts";
+const char kAudioInputFile[] = "memory://benchmark/input_audio.ts";
+const char kVideoInitSegment[] = "memory://benchmark/video/init.mp4";
+const char kVideoSegmentTemplate[] = "memory://benchmark/video/$Number$.m4s";
+const char kAudioInitSegment[] = "memory://benchmark/audio/init.mp4";
+const char kAudioSegmentTemplate[] = "memory://benchmark/audio/$Number$.m4s";
+
+const uint32_t kMpeg2Timescale = 90000;
+const uint32_t kAudioSamplingFrequency = 48000;
+const uint32_t kAacSamplesPerFrame = 1024;
+
+// Writes an RBSP bit by bit, most significant bit first, including the
+// Exp-Golomb codes used by H.264 headers. Emulation prevention is applied
+// separately by EscapeRbsp() when the RBSP is placed in a NAL unit.
+class RbspWriter {
+ public:
+  RbspWriter() : bit_buffer_(0), num_bits_(0) {}
+
+  void WriteBits(int num_bits, uint32_t value) {
+    for (int i = num_bits - 1; i >= 0; --i) {
+      bit_buffer_ = (bit_buffer_ << 1) | ((value >> i) & 1);
+      if (++num_bits_ == 8) {
+        bytes_.push_back(bit_buffer_);
+        bit_buffer_ = 0;
+        num_bits_ = 0;
+      }
+    }
+  }
+
+  void WriteUe(uint32_t value) {
+    const uint32_t code = value + 1;
+    int num_leading_zeros = 0;
+    while ((code >> (num_leading_zeros + 1)) != 0)
+      ++num_leading_zeros;
+    WriteBits(num_leading_zeros, 0);
+    WriteBits(num_leading_zeros + 1, code);
+  }
+
+  void WriteSe(int32_t value) {
+    WriteUe(value <= 0 ? -2 * value : 2 * value - 1);
+  }
+
+  // Writes the rbsp_trailing_bits: a stop bit followed by zero padding to the
+  // next byte boundary.
+  void WriteTrailingBits() {
+    WriteBits(1, 1);
+    while (num_bits_ != 0)
+      WriteBits(1, 0);
+  }
+
+  const std::vector<uint8_t>& bytes() const { return bytes_; }
+
+ private:
+  std::vector<uint8_t> bytes_;
+  uint8_t bit_buffer_;
+  int num_bits_;
+
+  DISALLOW_COPY_AND_ASSIGN(RbspWriter);
+};
+
+// Inserts emulation prevention bytes so the RBSP does not contain byte
+// sequences that look like start codes.
+std::vector<uint8_t> EscapeRbsp(const std::vector<uint8_t>& rbsp) {
+  std::vector<uint8_t> escaped;
+  escaped.reserve(rbsp.size());
+  int num_zeros = 0;
+  for (size_t i = 0; i < rbsp.size(); ++i) {
+    if (num_zeros == 2 && rbsp[i] <= 3) {
+      escaped.push_back(0x03);
+      num_zeros = 0;
+    }
+    num_zeros = (rbsp[i] == 0) ? num_zeros + 1 : 0;
+    escaped.push_back(rbsp[i]);
+  }
+  return escaped;
+}
+
+// Appends a NAL unit with a 4-byte Annex B start code to |stream|.
+void AppendNalu(uint8_t nalu_header,
+                const std::vector<uint8_t>& rbsp,
+                std::vector<uint8_t>* stream) {
+  const uint8_t kStartCode[] = {0x00, 0x00, 0x00, 0x01};
+  stream->insert(stream->end(), kStartCode, kStartCode + sizeof(kStartCode));
+  stream->push_back(nalu_header);
+  const std::vector<uint8_t> escaped = EscapeRbsp(rbsp);
+  stream->insert(stream->end(), escaped.begin(), escaped.end());
+}
+
+// Builds a minimal baseline profile SPS for the given dimensions, which must
+// be multiples of 16 (no frame cropping is written).
+std::vector<uint8_t> MakeSps(int width, int height) {
+  DCHECK_EQ(0, width % 16);
+  DCHECK_EQ(0, height % 16);
+  RbspWriter writer;
+  writer.WriteBits(8, 66);  // profile_idc: baseline.
+  writer.WriteBits(8, 0);   // constraint flags and reserved bits.
+  writer.WriteBits(8, 40);  // level_idc: 4.0.
+  writer.WriteUe(0);        // seq_parameter_set_id.
+  writer.WriteUe(0);        // log2_max_frame_num_minus4.
+  writer.WriteUe(2);        // pic_order_cnt_type.
+  writer.WriteUe(1);        // max_num_ref_frames.
+  writer.WriteBits(1, 0);   // gaps_in_frame_num_value_allowed_flag.
+  writer.WriteUe(width / 16 - 1);   // pic_width_in_mbs_minus1.
+  writer.WriteUe(height / 16 - 1);  // pic_height_in_map_units_minus1.
+  writer.WriteBits(1, 1);   // frame_mbs_only_flag.
+  writer.WriteBits(1, 0);   // direct_8x8_inference_flag.
+  writer.WriteBits(1, 0);   // frame_cropping_flag.
+  writer.WriteBits(1, 0);   // vui_parameters_present_flag.
+  writer.WriteTrailingBits();
+  return writer.bytes();
+}
+
+std::vector<uint8_t> MakePps() {
+  RbspWriter writer;
+  writer.WriteUe(0);       // pic_parameter_set_id.
+  writer.WriteUe(0);       // seq_parameter_set_id.
+  writer.WriteBits(1, 0);  // entropy_coding_mode_flag.
+  writer.WriteBits(1, 0);  // bottom_field_pic_order_in_frame_present_flag.
+  writer.WriteUe(0);       // num_slice_groups_minus1.
+  writer.WriteUe(0);       // num_ref_idx_l0_default_active_minus1.
+  writer.WriteUe(0);       // num_ref_idx_l1_default_active_minus1.
+  writer.WriteBits(1, 0);  // weighted_pred_flag.
+  writer.WriteBits(2, 0);  // weighted_bipred_idc.
+  writer.WriteSe(0);       // pic_init_qp_minus26.
+  writer.WriteSe(0);       // pic_init_qs_minus26.
+  writer.WriteSe(0);       // chroma_qp_index_offset.
+  writer.WriteBits(1, 0);  // deblocking_filter_control_present_flag.
+  writer.WriteBits(1, 0);  // constrained_intra_pred_flag.
+  writer.WriteBits(1, 0);  // redundant_pic_cnt_present_flag.
+  writer.WriteTrailingBits();
+  return writer.bytes();
+}
+
+// Builds an IDR I-slice padded with filler to |rbsp_size| bytes. Only the
+// slice header is ever parsed by the pipeline; the filler stands in for slice
+// data.
+std::vector<uint8_t> MakeIdrSlice(size_t rbsp_size) {
+  RbspWriter writer;
+  writer.WriteUe(0);       // first_mb_in_slice.
+  writer.WriteUe(2);       // slice_type: I.
+  writer.WriteUe(0);       // pic_parameter_set_id.
+  writer.WriteBits(4, 0);  // frame_num.
+  writer.WriteUe(0);       // idr_pic_id.
+  writer.WriteBits(1, 0);  // no_output_of_prior_pics_flag.
+  writer.WriteBits(1, 0);  // long_term_reference_flag.
+  writer.WriteSe(0);       // slice_qp_delta.
+  writer.WriteTrailingBits();
+  std::vector<uint8_t> slice = writer.bytes();
+  if (slice.size() < rbsp_size)
+    slice.resize(rbsp_size, 0xFF);
+  return slice;
+}
+
+// Builds one ADTS frame (AAC-LC, 48 kHz, stereo) of |frame_size| bytes
+// including the 7-byte header.
+std::vector<uint8_t> MakeAdtsFrame(size_t frame_size) {
+  DCHECK_GE(frame_size, 7u);
+  DCHECK_LT(frame_size, 1u << 13);
+  const uint8_t kProfile = 1;           // AAC-LC.
+  const uint8_t kFrequencyIndex = 3;    // 48000 Hz.
+  const uint8_t kChannelConfig = 2;     // Stereo.
+  std::vector<uint8_t> frame(frame_size, 0xFF);
+  frame[0] = 0xFF;  // Sync word.
+  frame[1] = 0xF1;  // Sync word, MPEG-4, layer 0, no CRC.
+  frame[2] = (kProfile << 6) | (kFrequencyIndex << 2) | (kChannelConfig >> 2);
+  frame[3] = ((kChannelConfig & 0x3) << 6) | ((frame_size >> 11) & 0x3);
+  frame[4] = (frame_size >> 3) & 0xFF;
+  frame[5] = ((frame_size & 0x7) << 5) | 0x1F;  // Buffer fullness (none).
+  frame[6] = 0xFC;  // Buffer fullness, one data block.
+  return frame;
+}
+
+// Writes the synthetic video stream to |kVideoInputFile|. Every frame is an
+// IDR access unit of AUD + SPS + PPS + padded slice, sized to hit the target
+// bitrate. @return The number of frames written, or 0 on failure.
+int GenerateVideoInput() {
+  const int width = (FLAGS_width + 15) / 16 * 16;
+  const int height = (FLAGS_height + 15) / 16 * 16;
+  const int num_frames = FLAGS_duration * FLAGS_frame_rate;
+  const size_t bytes_per_frame =
+      std::max(256, FLAGS_video_bitrate / 8 / FLAGS_frame_rate);
+
+  VideoStreamInfo stream_info(1, kMpeg2Timescale,
+                              static_cast<uint64_t>(FLAGS_duration) *
+                                  kMpeg2Timescale,
+                              kCodecH264, "avc1.420028", std::string(), width,
+                              height, 1, 1, 0, 0, NULL, 0, false);
+  mp2t::TsWriter ts_writer;
+  if (!ts_writer.Initialize(stream_info) ||
+      !ts_writer.NewSegment(kVideoInputFile)) {
+    return 0;
+  }
+
+  const std::vector<uint8_t> aud_rbsp(1, 0x10);  // primary_pic_type 0.
+  const std::vector<uint8_t> sps = MakeSps(width, height);
+  const std::vector<uint8_t> pps = MakePps();
+
+  std::vector<uint8_t> parameter_sets;
+  AppendNalu(0x09, aud_rbsp, &parameter_sets);  // Access unit delimiter.
+  AppendNalu(0x67, sps, &parameter_sets);
+  AppendNalu(0x68, pps, &parameter_sets);
+
+  // Account for the slice start code and NAL header when padding to the
+  // per-frame byte budget.
+  const size_t slice_overhead = parameter_sets.size() + 5;
+  const size_t slice_rbsp_size =
+      bytes_per_frame > slice_overhead + 16 ? bytes_per_frame - slice_overhead
+                                            : 16;
+  const std::vector<uint8_t> slice = MakeIdrSlice(slice_rbsp_size);
+
+  std::vector<uint8_t> access_unit(parameter_sets);
+  AppendNalu(0x65, slice, &access_unit);
+
+  for (int i = 0; i < num_frames; ++i) {
+    scoped_ptr<mp2t::PesPacket> pes(new mp2t::PesPacket());
+    pes->set_stream_id(0xE0);
+    const int64_t timestamp =
+        static_cast<int64_t>(i) * kMpeg2Timescale / FLAGS_frame_rate;
+    pes->set_pts(timestamp);
+    pes->set_dts(timestamp);
+    pes->mutable_data()->assign(access_unit.begin(), access_unit.end());
+    if (!ts_writer.AddPesPacket(pes.Pass()))
+      return 0;
+  }
+  if (!ts_writer.FinalizeSegment())
+    return 0;
+  return num_frames;
+}
+
+// Writes the synthetic audio stream to |kAudioInputFile|. @return The number
+// of ADTS frames written, or 0 on failure.
+int GenerateAudioInput() {
+  const int num_frames = static_cast<int64_t>(FLAGS_duration) *
+                         kAudioSamplingFrequency / kAacSamplesPerFrame;
+  const size_t bytes_per_frame =
+      std::max(16, static_cast<int>(static_cast<int64_t>(FLAGS_audio_bitrate) /
+                                    8 * kAacSamplesPerFrame /
+                                    kAudioSamplingFrequency));
+
+  // AudioSpecificConfig for AAC-LC, 48 kHz, stereo; must match the ADTS
+  // headers below.
+  const uint8_t kAudioSpecificConfig[] = {0x11, 0x90};
+  AudioStreamInfo stream_info(2, kMpeg2Timescale,
+                              static_cast<uint64_t>(FLAGS_duration) *
+                                  kMpeg2Timescale,
+                              kCodecAAC, "mp4a.40.2", std::string(), 16, 2,
+                              kAudioSamplingFrequency, 0, 0, 0, 0,
+                              kAudioSpecificConfig,
+                              arraysize(kAudioSpecificConfig), false);
+  mp2t::TsWriter ts_writer;
+  if (!ts_writer.Initialize(stream_info) ||
+      !ts_writer.NewSegment(kAudioInputFile)) {
+    return 0;
+  }
+
+  const std::vector<uint8_t> frame = MakeAdtsFrame(bytes_per_frame);
+  for (int i = 0; i < num_frames; ++i) {
+    scoped_ptr<mp2t::PesPacket> pes(new mp2t::PesPacket());
+    pes->set_stream_id(0xC0);
+    pes->set_pts(static_cast<int64_t>(i) * kAacSamplesPerFrame *
+                 kMpeg2Timescale / kAudioSamplingFrequency);
+    pes->mutable_data()->assign(frame.begin(), frame.end());
+    if (!ts_writer.AddPesPacket(pes.Pass()))
+      return 0;
+  }
+  if (!ts_writer.FinalizeSegment())
+    return 0;
+  return num_frames;
+}
+
+// Runs a Demuxer->MP4Muxer pipeline over |input| and prints throughput.
+// @return true on success.
+bool RunPipeline(const std::string& name,
+                 const std::string& input,
+                 const std::string& init_segment,
+                 const std::string& segment_template,
+                 int num_samples) {
+  const int64_t input_size = File::GetFileSize(input.c_str());
+  CHECK_GT(input_size, 0);
+
+  const base::TimeTicks start = base::TimeTicks::Now();
+
+  Demuxer demuxer(input);
+  Status status = demuxer.Initialize();
+  if (!status.ok()) {
+    LOG(ERROR) << "Demuxer failed to initialize: " << status.ToString();
+    return false;
+  }
+
+  MuxerOptions options;
+  options.single_segment = false;
+  options.segment_duration = 6.0;
+  options.fragment_duration = 2.0;
+  options.segment_sap_aligned = true;
+  options.fragment_sap_aligned = true;
+  options.output_file_name = init_segment;
+  options.segment_template = segment_template;
+
+  mp4::MP4Muxer muxer(options);
+  CHECK(!demuxer.streams().empty());
+  muxer.AddStream(demuxer.streams()[0]);
+
+  status = demuxer.Run();
+  if (!status.ok()) {
+    LOG(ERROR) << "Pipeline failed: " << status.ToString();
+    return false;
+  }
+
+  const base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+  const double seconds = elapsed.InMicroseconds() / 1000000.0;
+  printf("%-8s %8.2f MB in %7.3f s %10.1f MB/s %12.0f samples/s\n",
+         name.c_str(), input_size / 1048576.0, seconds,
+         input_size / 1048576.0 / seconds, num_samples / seconds);
+  return true;
+}
+
+// Prints the per-stage counters accumulated by the pipeline across all runs.
+// Stage scopes may nest, so the times are not disjoint and do not sum to the
+// wall time.
+void ReportStageCounters() {
+  printf("\nPer-stage counters (cumulative across runs):\n");
+  for (int i = 0; i < pipeline_stats::kNumStages; ++i) {
+    const pipeline_stats::Stage stage = static_cast<pipeline_stats::Stage>(i);
+    const int64_t bytes = pipeline_stats::GetBytes(stage);
+    const int64_t time_us = pipeline_stats::GetTimeUs(stage);
+    if (time_us > 0) {
+      printf("%-12s %8.2f MB in %7.3f s %10.1f MB/s\n",
+             pipeline_stats::StageName(stage), bytes / 1048576.0,
+             time_us / 1000000.0,
+             bytes / 1048576.0 / (time_us / 1000000.0));
+    } else {
+      printf("%-12s %8.2f MB\n", pipeline_stats::StageName(stage),
+             bytes / 1048576.0);
+    }
+  }
+}
+
+int RunBenchmark() {
+  pipeline_stats::Enable();
+
+  const int num_video_frames = GenerateVideoInput();
+  if (num_video_frames == 0) {
+    LOG(ERROR) << "Failed to generate the synthetic video stream.";
+    return 1;
+  }
+  const int num_audio_frames = GenerateAudioInput();
+  if (num_audio_frames == 0) {
+    LOG(ERROR) << "Failed to generate the synthetic audio stream.";
+    return 1;
+  }
+
+  printf("Synthetic input: %dx%d@%d %.1f Mbps video, %.1f kbps audio, %d s\n\n",
+         FLAGS_width, FLAGS_height, FLAGS_frame_rate,
+         FLAGS_video_bitrate / 1000000.0, FLAGS_audio_bitrate / 1000.0,
+         FLAGS_duration);
+
+  if (!RunPipeline("video", kVideoInputFile, kVideoInitSegment,
+                   kVideoSegmentTemplate, num_video_frames)) {
+    return 1;
+  }
+  if (!RunPipeline("audio", kAudioInputFile, kAudioInitSegment,
+                   kAudioSegmentTemplate, num_audio_frames)) {
+    return 1;
+  }
+
+  ReportStageCounters();
+  MemoryFile::DeleteAll();
+  return 0;
+}
+
+}  // namespace
+}  // namespace media
+}  // namespace shaka
+
+int main(int argc, char** argv) {
+  base::AtExitManager at_exit;
+  google::SetUsageMessage(
+      "End-to-end packaging pipeline throughput benchmark.");
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  base::CommandLine::Init(argc, argv);
+  CHECK(logging::InitLogging(logging::LoggingSettings()));
+
+  return shaka::media::RunBenchmark();
+}
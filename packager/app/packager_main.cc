@@ -6,22 +6,30 @@
 
 #include <gflags/gflags.h>
 #include <iostream>
+#include <limits>
 
+#include "packager/app/cpu_affinity.h"
 #include "packager/app/fixed_key_encryption_flags.h"
 #include "packager/app/hls_flags.h"
+#include "packager/app/job_daemon.h"
 #include "packager/app/libcrypto_threading.h"
 #include "packager/app/mpd_flags.h"
 #include "packager/app/muxer_flags.h"
 #include "packager/app/packager_util.h"
+#include "packager/app/sampling_profiler.h"
 #include "packager/app/stream_descriptor.h"
 #include "packager/app/vlog_flags.h"
+#include "packager/app/watch_folder.h"
 #include "packager/app/widevine_encryption_flags.h"
 #include "packager/base/at_exit.h"
+#include "packager/base/atomic_sequence_num.h"
+#include "packager/base/bind.h"
 #include "packager/base/command_line.h"
 #include "packager/base/files/file_path.h"
 #include "packager/base/logging.h"
 #include "packager/base/stl_util.h"
 #include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
 #include "packager/base/threading/simple_thread.h"
 #include "packager/base/time/clock.h"
@@ -31,21 +39,35 @@
 #include "packager/media/base/demuxer.h"
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/key_source.h"
+#include "packager/media/base/memory_budget.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/media/base/pipeline_stats.h"
+#include "packager/media/base/trace_span.h"
+#include "packager/media/base/runtime_config.h"
+#include "packager/media/event/async_muxer_listener.h"
+#include "packager/media/event/checkpoint_muxer_listener.h"
 #include "packager/media/event/hls_notify_muxer_listener.h"
 #include "packager/media/event/mpd_notify_muxer_listener.h"
+#include "packager/media/event/segment_hash_muxer_listener.h"
 #include "packager/media/event/vod_media_info_dump_muxer_listener.h"
 #include "packager/media/file/file.h"
+#include "packager/media/file/io_scheduler.h"
 #include "packager/media/formats/mp2t/ts_muxer.h"
+#include "packager/media/formats/mp4/fragment_passthrough.h"
 #include "packager/media/formats/mp4/mp4_muxer.h"
 #include "packager/media/formats/webm/webm_muxer.h"
 #include "packager/mpd/base/dash_iop_mpd_notifier.h"
 #include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mpd_builder.h"
 #include "packager/mpd/base/simple_mpd_notifier.h"
+#include "packager/mpd/util/mpd_writer.h"
 #include "packager/version/version.h"
 
+#if !defined(OS_WIN)
+#include <signal.h>
+#endif  // !defined(OS_WIN)
+
 DEFINE_bool(use_fake_clock_for_muxer,
             false,
             "Set to true to use a fake clock for muxer. With this flag set, "
@@ -60,6 +82,202 @@ DEFINE_string(test_version,
               "",
               "Packager version for testing. Ignored if --override_version is "
               "false. Should be used for testing only.");
+DEFINE_string(daemon_socket,
+              "",
+              "If set, run as a long-lived daemon serving packaging jobs "
+              "submitted over the local socket at this path instead of "
+              "packaging the streams on the command line. Each connection "
+              "submits one job as newline separated stream descriptors. "
+              "Flag-controlled state (key source, crypto setup) is "
+              "initialized once and reused across jobs.");
+DEFINE_string(watch_folder,
+              "",
+              "If set, watch this folder and package every file that arrives "
+              "in it instead of exiting after one job. The stream "
+              "descriptors on the command line serve as per-file templates: "
+              "'input' is replaced with the arriving file, and the literal "
+              "'{basename}' in output and segment_template fields is "
+              "replaced with the file name without directory and extension. "
+              "Warmed state (key source, worker threads) is reused across "
+              "files. Linux only (inotify).");
+DEFINE_bool(dump_pipeline_stats,
+            false,
+            "Collect per-stage byte and wall time counters (file read, parse, "
+            "encrypt, mux, file write) and dump them as JSON to the log on "
+            "exit. On POSIX systems SIGUSR1 dumps a snapshot while running.");
+DEFINE_string(trace_file,
+              "",
+              "Path of a Chrome trace-event JSON file. When set, scoped "
+              "trace spans (demux parses, fragment finalization, segment "
+              "writes, key fetches, manifest writes) are recorded into an "
+              "in-memory ring buffer holding the most recent spans, and "
+              "dumped to this path on exit and on SIGUSR1, for loading into "
+              "a trace viewer. Requires a build with packager_tracing=1; "
+              "without it the spans are compiled out and the dump is empty.");
+DEFINE_uint64(max_demux_read_size,
+              0x200000,
+              "Upper bound in bytes for the demuxer's adaptive read block "
+              "size. Larger values amortize per-read overhead on high-latency "
+              "storage; the block size shrinks automatically for trickling "
+              "live sources.");
+DEFINE_uint64(job_memory_budget_mb,
+              0,
+              "Per-job memory budget in MiB for buffered samples, or 0 for "
+              "no budget. When a job's buffered sample bytes exceed the "
+              "budget, its input reads are paused until the muxers drain the "
+              "pipeline, so co-located jobs degrade to slower reads instead "
+              "of growing without bound. Budget crossings are logged and "
+              "counted in the pipeline stats. Most effective together with "
+              "--threaded_pipeline, where demuxing runs ahead of muxing.");
+DEFINE_string(io_priority,
+              "live",
+              "Write priority of this process's output files: 'live' "
+              "(latency sensitive, never delayed) or 'bulk' (yields to live "
+              "writes and self-limits to one in-flight block write, keeping "
+              "the device queue shallow). On hosts where live channels and "
+              "bulk VOD jobs share storage, run the VOD jobs with 'bulk' so "
+              "live segment publication latency stays low.");
+DEFINE_bool(threaded_pipeline,
+            false,
+            "If enabled, each muxer consumes samples on its own worker thread "
+            "so demuxing/parsing overlaps with fragment building, encryption "
+            "and segment writes. Recommended for VOD jobs on multi-core "
+            "machines.");
+DEFINE_bool(mp4_fragment_passthrough,
+            false,
+            "If enabled, fragmented mp4 inputs are copied to the output "
+            "without demuxing and re-muxing: the box structure is validated, "
+            "'mfhd' sequence numbers are renumbered and 'mdat' payloads are "
+            "block-copied untouched. With encryption enabled, samples are "
+            "encrypted in place while the bytes stream through ('cenc' "
+            "scheme with AVC/HEVC video only). Manifest output is not "
+            "generated in this mode.");
+DEFINE_bool(trusted_input,
+            false,
+            "If enabled, the input is treated as trusted (e.g. produced by "
+            "our own encoder) and validation the source already guarantees "
+            "is elided where the parser supports it. For MPEG-2 TS input, "
+            "PSI CRCs are only verified at a sampled rate, byte-identical "
+            "PSI repetitions are not re-parsed and the per-packet "
+            "continuity check is skipped. Inputs of other containers are "
+            "fully validated.");
+DEFINE_string(es_cache,
+              "",
+              "Path of an elementary-stream cache file. If the file exists "
+              "it is read as the input, bypassing container and codec "
+              "parsing; otherwise the input is demuxed normally and the "
+              "cache is written as a side effect, so later re-packaging "
+              "jobs of the same input (new DRM, new ladder, manifest fixes) "
+              "skip the demux cost. The cache records exactly what this job "
+              "demuxed, including any clip range. Only meaningful when all "
+              "stream descriptors share a single input.");
+DEFINE_string(mp4_parse_index,
+              "",
+              "Path of a parse index sidecar for non-fragmented mp4 input. "
+              "The parsed sample table state is persisted there on the "
+              "first run and loaded back - validated against the input's "
+              "size and mtime - on later runs, skipping the sample table "
+              "walk for long content. Unlike --es_cache the sidecar holds "
+              "no sample payloads, so it stays small, but the input is "
+              "still read. Ignored with a clip range or stream selection "
+              "by type, and when the input is not a local non-fragmented "
+              "mp4 file.");
+DEFINE_string(profile_output,
+              "",
+              "Path prefix for built-in sampling profiler output. If set, "
+              "stacks of the running threads are sampled with a SIGPROF "
+              "timer, tagged with the input name of the job each thread is "
+              "working on, and written as pprof-compatible CPU profiles "
+              "('<prefix>.<label>.prof', one per label) on SIGUSR2 and at "
+              "exit. View with pprof against the packager binary. Linux "
+              "only.");
+DEFINE_double(checkpoint_interval,
+              0,
+              "Interval, in seconds of output media time, between resume "
+              "checkpoints; 0 disables checkpointing. A checkpoint records "
+              "per stream the media time and segment number to resume from "
+              "and the bytes of completed segments; it is written next to "
+              "the stream's output as '<output>.checkpoint' after completed "
+              "segments and deleted when the stream finishes. Segment "
+              "template output only.");
+DEFINE_bool(resume,
+            false,
+            "Resume an interrupted packaging job from its checkpoint files: "
+            "each stream restarts at its last checkpointed segment boundary "
+            "via the clip-range fast remux (so unfragmented MP4 input only) "
+            "and continues its segment numbering, bounding recomputation to "
+            "one checkpoint interval. Streams without a checkpoint file "
+            "start from the beginning. Use the same command line as the "
+            "original run, plus --resume.");
+DEFINE_string(standby_promotion_file,
+              "",
+              "Run the job as a warm standby for live failover: the input is "
+              "ingested and parsed as usual, keeping parser state hot, but "
+              "nothing is encrypted, muxed or written until this file "
+              "appears, at which point the job promotes to active and "
+              "starts emitting segments at the next key frame. The file is "
+              "polled between input reads, so for live inputs takeover "
+              "latency is bounded by the input's delivery rate. Pair with "
+              "--segment_start_number so the promoted instance continues "
+              "the failed instance's segment numbering.");
+DEFINE_string(reconfig_file,
+              "",
+              "Poll this 'key = value' file for runtime parameter changes "
+              "while the job runs, so routine ops changes do not require "
+              "restarting a live channel. Changes are applied at safe "
+              "boundaries only; currently 'crypto_period_duration' (in "
+              "seconds) is applied at the next crypto period boundary. "
+              "Parameters that change the media structure, e.g. adding "
+              "streams, still require a restart. The file may appear, "
+              "change and disappear at any time; removing it clears the "
+              "overrides, but changes already applied stay in effect.");
+DEFINE_int32(shard_count,
+             0,
+             "Split the job into this many time-range shards and package "
+             "only the shard selected by --shard_index. Each shard covers "
+             "--shard_duration seconds; the last shard runs to the end of "
+             "the input. The split rides on the clip-range fast remux, so "
+             "the same input restrictions apply and shard starts snap to the "
+             "preceding sync sample; choose a shard duration that is a "
+             "multiple of the segment duration and cut the input at segment "
+             "boundaries so shard outputs stay segment aligned. Per-shard "
+             "manifests can then be merged into one MPD with mpd_generator "
+             "--merge_sharded_inputs. 0 disables sharding.");
+DEFINE_int32(shard_index,
+             -1,
+             "Zero-based index of the shard to package. Required when "
+             "--shard_count is set.");
+DEFINE_double(shard_duration,
+              0,
+              "Shard length in seconds. Required when --shard_count is set.");
+DEFINE_bool(deterministic_output,
+            false,
+            "Make reruns byte identical for unchanged input: creation and "
+            "modification times in the outputs are set to a fixed epoch "
+            "instead of the wall clock. Encrypted output is only "
+            "deterministic if the key and IV are fixed too (--iv with fixed "
+            "key encryption); key rotation and random IVs still vary "
+            "between runs.");
+DEFINE_bool(emit_segment_hashes,
+            false,
+            "Write a 'sha1_hex size_bytes segment_name' line for every "
+            "completed segment to '<output>.segment_hashes'. With "
+            "--deterministic_output the hashes are stable across reruns, so "
+            "an uploader can compare them against the previous run and skip "
+            "segments it already has. Segment template output only.");
+DEFINE_bool(async_muxer_events,
+            false,
+            "Deliver muxer events (manifest updates, media_info dumps, "
+            "checkpoints, segment hashes) on a dedicated thread per stream. "
+            "Event order is preserved, but slow event consumers no longer "
+            "block segment production.");
+DEFINE_int32(job_threads,
+             0,
+             "Maximum number of remux jobs to run concurrently. Jobs are "
+             "pulled from a shared queue by a fixed-size pool of worker "
+             "threads, so a finished worker immediately picks up the next "
+             "pending job. A value of zero (the default) runs every job on "
+             "its own thread.");
 
 namespace shaka {
 namespace media {
@@ -85,9 +303,23 @@ const char kUsage[] =
     "    content bit rate for the stream, in bits/sec. If specified, this\n"
     "    value is propagated to the $Bandwidth$ template parameter for\n"
     "    segment names. If not specified, its value may be estimated.\n"
+    "  - clip_start, clip_end: Optional values, in seconds, which restrict\n"
+    "    the output to the given time range of the input. Supported for\n"
+    "    non-fragmented MP4 input only. The start is snapped back to the\n"
+    "    nearest preceding key frame, and only the portions of the input\n"
+    "    covering the range are read.\n"
+    "  - trick_play_rate: Optional value which turns the output into a\n"
+    "    key-frame-only trick play track: every trick_play_rate-th key frame\n"
+    "    of the input stream is kept (1 keeps every key frame). The track is\n"
+    "    produced in the same packaging pass as the other outputs of the\n"
+    "    same input, so no second read of the input is needed.\n"
     "  - language (lang): Optional value which contains a user-specified\n"
     "    language tag. If specified, this value overrides any language\n"
     "    metadata in the input track.\n"
+    "  - input_format: Optional value which declares the container format\n"
+    "    of the input, bypassing content detection. Use 'escache' for\n"
+    "    AU-delimited elementary-stream ingest from a trusted upstream\n"
+    "    encoder (see media/formats/escache/es_cache_format.h).\n"
     "  - output_format (format): Optional value which specifies the format\n"
     "    of the output files (MP4 or WebM).  If not specified, it will be\n"
     "    derived from the file extension of the output file.\n"
@@ -101,6 +333,8 @@ const char kUsage[] =
     "    Name of the playlist for the stream. Usually ends with '.m3u8'.\n";
 
 const char kMediaInfoSuffix[] = ".media_info";
+const char kCheckpointSuffix[] = ".checkpoint";
+const char kSegmentHashesSuffix[] = ".segment_hashes";
 
 enum ExitStatus {
   kSuccess = 0,
@@ -145,6 +379,27 @@ FourCC GetProtectionScheme(const std::string& protection_scheme) {
   }
 }
 
+#if !defined(OS_WIN)
+// Best effort debugging aid: formatting the dumps is not strictly async
+// signal safe, but SIGUSR1 is only delivered on explicit operator request.
+void DumpDiagnosticsSignalHandler(int signal_number) {
+  pipeline_stats::DumpToLog();
+  if (tracing::enabled())
+    tracing::DumpToFile(FLAGS_trace_file);
+}
+#endif  // !defined(OS_WIN)
+
+// Registered with AtExitManager when --trace_file is set, so the spans are
+// dumped on every exit path, including daemon and watch folder modes.
+void DumpTraceSpans(void* param) {
+  tracing::DumpToFile(FLAGS_trace_file);
+}
+
+// Registered with AtExitManager when --profile_output is set.
+void StopSamplingProfiler(void* param) {
+  sampling_profiler::Stop();
+}
+
 }  // namespace
 
 // A fake clock that always return time 0 (epoch). Should only be used for
@@ -154,14 +409,14 @@ class FakeClock : public base::Clock {
   base::Time Now() override { return base::Time(); }
 };
 
-// Demux, Mux(es) and worker thread used to remux a source file/stream.
-class RemuxJob : public base::SimpleThread {
+// Demux and Mux(es) used to remux a source file/stream. Jobs are run by
+// RemuxJobWorker threads.
+class RemuxJob {
  public:
-  RemuxJob(scoped_ptr<Demuxer> demuxer)
-      : SimpleThread("RemuxJob"),
-        demuxer_(demuxer.Pass()) {}
+  RemuxJob(scoped_ptr<Demuxer> demuxer, const std::string& label)
+      : demuxer_(demuxer.Pass()), label_(label) {}
 
-  ~RemuxJob() override {
+  ~RemuxJob() {
     STLDeleteElements(&muxers_);
   }
 
@@ -169,22 +424,51 @@ class RemuxJob : public base::SimpleThread {
     muxers_.push_back(mux.release());
   }
 
-  Demuxer* demuxer() { return demuxer_.get(); }
-  Status status() { return status_; }
-
- private:
-  void Run() override {
+  void Run() {
     DCHECK(demuxer_);
+    // Attribute profiler samples taken on this worker thread to this job.
+    sampling_profiler::SetThreadLabel(label_);
     status_ = demuxer_->Run();
   }
 
+  Demuxer* demuxer() { return demuxer_.get(); }
+  Status status() { return status_; }
+
+ private:
   scoped_ptr<Demuxer> demuxer_;
+  std::string label_;
   std::vector<Muxer*> muxers_;
   Status status_;
 
   DISALLOW_COPY_AND_ASSIGN(RemuxJob);
 };
 
+// Worker thread that runs RemuxJobs pulled from a shared list. Workers claim
+// the next unstarted job through an atomic counter, so however unevenly the
+// jobs are sized, no worker sits idle while jobs are still pending.
+class RemuxJobWorker : public base::SimpleThread {
+ public:
+  RemuxJobWorker(const std::vector<RemuxJob*>* remux_jobs,
+                 base::AtomicSequenceNumber* next_job)
+      : SimpleThread("RemuxJobWorker"),
+        remux_jobs_(remux_jobs),
+        next_job_(next_job) {}
+
+ private:
+  void Run() override {
+    int index;
+    while ((index = next_job_->GetNext()) <
+           static_cast<int>(remux_jobs_->size())) {
+      (*remux_jobs_)[index]->Run();
+    }
+  }
+
+  const std::vector<RemuxJob*>* remux_jobs_;
+  base::AtomicSequenceNumber* next_job_;
+
+  DISALLOW_COPY_AND_ASSIGN(RemuxJobWorker);
+};
+
 bool StreamInfoToTextMediaInfo(const StreamDescriptor& stream_descriptor,
                                const MuxerOptions& stream_muxer_options,
                                MediaInfo* text_media_info) {
@@ -236,12 +520,19 @@ scoped_ptr<Muxer> CreateOutputMuxer(const MuxerOptions& options,
   }
 }
 
+// Polled by standby demuxers between input reads; the standby promotes to
+// active once the promotion file exists. See --standby_promotion_file.
+bool StandbyPromotionFileExists() {
+  return File::GetFileSize(FLAGS_standby_promotion_file.c_str()) >= 0;
+}
+
 bool CreateRemuxJobs(const StreamDescriptorList& stream_descriptors,
                      const MuxerOptions& muxer_options,
                      FakeClock* fake_clock,
                      KeySource* key_source,
                      MpdNotifier* mpd_notifier,
                      hls::HlsNotifier* hls_notifier,
+                     RuntimeConfig* runtime_config,
                      std::vector<RemuxJob*>* remux_jobs) {
   // No notifiers OR (mpd_notifier XOR hls_notifier); which is NAND.
   DCHECK(!(mpd_notifier && hls_notifier));
@@ -271,6 +562,28 @@ bool CreateRemuxJobs(const StreamDescriptorList& stream_descriptors,
     }
     stream_muxer_options.bandwidth = stream_iter->bandwidth;
 
+    // Checkpoint/resume state for this stream; see --checkpoint_interval.
+    const std::string checkpoint_file_name =
+        stream_muxer_options.output_file_name + kCheckpointSuffix;
+    double resume_start_seconds = 0;
+    if (FLAGS_resume && File::GetFileSize(checkpoint_file_name.c_str()) >= 0) {
+      MediaInfo checkpoint;
+      if (!ReadMediaInfoFile(checkpoint_file_name, &checkpoint) ||
+          !checkpoint.has_media_duration_seconds()) {
+        LOG(WARNING) << "Ignoring unusable checkpoint " << checkpoint_file_name
+                     << "; the stream restarts from the beginning.";
+      } else {
+        resume_start_seconds = checkpoint.media_duration_seconds();
+        if (checkpoint.has_segment_start_number()) {
+          stream_muxer_options.segment_start_number =
+              checkpoint.segment_start_number();
+        }
+        LOG(INFO) << "Resuming '" << stream_muxer_options.output_file_name
+                  << "' at " << resume_start_seconds << "s, segment "
+                  << stream_muxer_options.segment_start_number << ".";
+      }
+    }
+
     // Handle text input.
     if (stream_iter->stream_selector == "text") {
       MediaInfo text_media_info;
@@ -299,9 +612,116 @@ bool CreateRemuxJobs(const StreamDescriptorList& stream_descriptors,
       continue;
     }
 
-    if (stream_iter->input != previous_input) {
+    // Handle fragmented mp4 passthrough: the input is copied and validated
+    // without going through a demuxer/muxer pair.
+    if (FLAGS_mp4_fragment_passthrough) {
+      mp4::FragmentPassthrough passthrough(stream_muxer_options);
+      if (key_source) {
+        LOG_IF(WARNING, FLAGS_clear_lead > 0)
+            << "--clear_lead is not supported with --mp4_fragment_passthrough;"
+               " encrypting from the first fragment.";
+        passthrough.SetEncryptionKeySource(
+            key_source, GetProtectionScheme(FLAGS_protection_scheme),
+            FLAGS_max_sd_pixels);
+      }
+      Status status = passthrough.Run(stream_iter->input);
+      if (!status.ok()) {
+        LOG(ERROR) << "Fragment passthrough failed for " << stream_iter->input
+                   << ": " << status.ToString();
+        return false;
+      }
+      continue;
+    }
+
+    // In resume mode every stream gets its own demuxer: the clip range is a
+    // demuxer property and each stream resumes at its own checkpoint.
+    if (stream_iter->input != previous_input || FLAGS_resume) {
       // New remux job needed. Create demux and job thread.
-      scoped_ptr<Demuxer> demuxer(new Demuxer(stream_iter->input));
+      std::string demux_input = stream_iter->input;
+      bool write_es_cache = false;
+      if (!FLAGS_es_cache.empty()) {
+        if (!remux_jobs->empty()) {
+          LOG(WARNING) << "--es_cache supports a single input only; ignored "
+                          "for '" << stream_iter->input << "'.";
+        } else if (File::GetFileSize(FLAGS_es_cache.c_str()) >= 0) {
+          // An earlier run already wrote the cache; read it back instead of
+          // demuxing the mezzanine again.
+          demux_input = FLAGS_es_cache;
+        } else {
+          write_es_cache = true;
+        }
+      }
+      scoped_ptr<Demuxer> demuxer(new Demuxer(demux_input));
+      if (write_es_cache)
+        demuxer->SetEsCachePath(FLAGS_es_cache);
+      if (!FLAGS_mp4_parse_index.empty()) {
+        if (!remux_jobs->empty()) {
+          LOG(WARNING) << "--mp4_parse_index supports a single input only; "
+                          "ignored for '" << stream_iter->input << "'.";
+        } else {
+          demuxer->SetParseIndexPath(FLAGS_mp4_parse_index);
+        }
+      }
+      // Push the stream selection down into the parser when every descriptor
+      // of this input selects streams by type, so e.g. an audio-only job does
+      // no video parse work at all. Numeric and text selectors address tracks
+      // that cannot be classified before demuxing.
+      if (!FLAGS_dump_stream_info) {
+        bool wants_audio = false;
+        bool wants_video = false;
+        bool selectors_by_type = true;
+        for (StreamDescriptorList::const_iterator it =
+                 stream_descriptors.begin();
+             it != stream_descriptors.end(); ++it) {
+          if (it->input != stream_iter->input)
+            continue;
+          if (it->stream_selector == "audio")
+            wants_audio = true;
+          else if (it->stream_selector == "video")
+            wants_video = true;
+          else
+            selectors_by_type = false;
+        }
+        if (selectors_by_type && !(wants_audio && wants_video))
+          demuxer->SelectStreamTypes(wants_audio, wants_video);
+      }
+      demuxer->set_threaded_push(FLAGS_threaded_pipeline);
+      demuxer->set_trusted_input(FLAGS_trusted_input);
+      demuxer->set_max_read_size(FLAGS_max_demux_read_size);
+      if (stream_iter->input_format != CONTAINER_UNKNOWN)
+        demuxer->set_input_format(stream_iter->input_format);
+      if (FLAGS_job_memory_budget_mb > 0) {
+        demuxer->SetMemoryBudget(scoped_ptr<MemoryBudget>(
+            new MemoryBudget(FLAGS_job_memory_budget_mb * 1024 * 1024)));
+      }
+      if (!FLAGS_standby_promotion_file.empty()) {
+        demuxer->SetStandbyPromotionCheck(
+            base::Bind(&StandbyPromotionFileExists));
+      }
+      if (FLAGS_resume && resume_start_seconds > 0) {
+        // Restart at this stream's last completed segment boundary. Segments
+        // are cut at stream access points, so the clip start snaps to the
+        // boundary exactly.
+        demuxer->SetClipRange(resume_start_seconds,
+                              std::numeric_limits<double>::max());
+      } else if (FLAGS_shard_count > 0) {
+        if (stream_iter->clip_end_seconds > 0) {
+          LOG(ERROR) << "clip_start/clip_end cannot be combined with "
+                        "--shard_count.";
+          return false;
+        }
+        // Package only this worker's time range; the last shard runs to the
+        // end of the input.
+        const double shard_start = FLAGS_shard_index * FLAGS_shard_duration;
+        const double shard_end =
+            (FLAGS_shard_index + 1 == FLAGS_shard_count)
+                ? std::numeric_limits<double>::max()
+                : shard_start + FLAGS_shard_duration;
+        demuxer->SetClipRange(shard_start, shard_end);
+      } else if (stream_iter->clip_end_seconds > 0) {
+        demuxer->SetClipRange(stream_iter->clip_start_seconds,
+                              stream_iter->clip_end_seconds);
+      }
       if (FLAGS_enable_widevine_decryption ||
           FLAGS_enable_fixed_key_decryption) {
         scoped_ptr<KeySource> key_source(CreateDecryptionKeySource());
@@ -320,14 +740,18 @@ bool CreateRemuxJobs(const StreamDescriptorList& stream_descriptors,
         if (stream_iter->output.empty())
           continue;  // just need stream info.
       }
-      remux_jobs->push_back(new RemuxJob(demuxer.Pass()));
+      remux_jobs->push_back(new RemuxJob(demuxer.Pass(), stream_iter->input));
       previous_input = stream_iter->input;
     }
     DCHECK(!remux_jobs->empty());
 
     scoped_ptr<Muxer> muxer(
         CreateOutputMuxer(stream_muxer_options, stream_iter->output_format));
-    if (FLAGS_use_fake_clock_for_muxer) muxer->set_clock(fake_clock);
+    if (FLAGS_use_fake_clock_for_muxer || FLAGS_deterministic_output)
+      muxer->set_clock(fake_clock);
+    if (stream_iter->trick_play_rate > 0)
+      muxer->set_trick_play_rate(stream_iter->trick_play_rate);
+    muxer->set_runtime_config(runtime_config);
 
     if (key_source) {
       muxer->SetKeySource(key_source,
@@ -370,6 +794,34 @@ bool CreateRemuxJobs(const StreamDescriptorList& stream_descriptors,
                                                       group_id, hls_notifier));
     }
 
+    if (FLAGS_checkpoint_interval > 0) {
+      if (stream_muxer_options.segment_template.empty()) {
+        LOG(WARNING) << "Checkpoints are only written for segment template "
+                        "output; none for '"
+                     << stream_muxer_options.output_file_name << "'.";
+      } else {
+        muxer_listener.reset(new CheckpointMuxerListener(
+            checkpoint_file_name, FLAGS_checkpoint_interval,
+            muxer_listener.Pass()));
+      }
+    }
+
+    if (FLAGS_emit_segment_hashes) {
+      if (stream_muxer_options.segment_template.empty()) {
+        LOG(WARNING) << "Segment hashes are only written for segment template "
+                        "output; none for '"
+                     << stream_muxer_options.output_file_name << "'.";
+      } else {
+        muxer_listener.reset(new SegmentHashMuxerListener(
+            stream_muxer_options.output_file_name + kSegmentHashesSuffix,
+            muxer_listener.Pass()));
+      }
+    }
+
+    // Outermost wrapper, so the whole listener chain runs off-thread.
+    if (FLAGS_async_muxer_events && muxer_listener)
+      muxer_listener.reset(new AsyncMuxerListener(muxer_listener.Pass()));
+
     if (muxer_listener)
       muxer->SetMuxerListener(muxer_listener.Pass());
 
@@ -386,36 +838,46 @@ bool CreateRemuxJobs(const StreamDescriptorList& stream_descriptors,
 }
 
 Status RunRemuxJobs(const std::vector<RemuxJob*>& remux_jobs) {
-  // Start the job threads.
+  size_t num_workers = remux_jobs.size();
+  if (FLAGS_job_threads > 0 &&
+      static_cast<size_t>(FLAGS_job_threads) < num_workers) {
+    num_workers = FLAGS_job_threads;
+  }
+
+  // Start the worker threads. Each worker runs jobs until the shared queue
+  // is exhausted.
+  base::AtomicSequenceNumber next_job;
+  std::vector<RemuxJobWorker*> workers;
+  STLElementDeleter<std::vector<RemuxJobWorker*> > scoped_workers_deleter(
+      &workers);
+  for (size_t i = 0; i < num_workers; ++i)
+    workers.push_back(new RemuxJobWorker(&remux_jobs, &next_job));
+  for (std::vector<RemuxJobWorker*>::iterator worker_iter = workers.begin();
+       worker_iter != workers.end();
+       ++worker_iter) {
+    (*worker_iter)->Start();
+  }
+
+  // Wait for all jobs to complete, then report the first error encountered.
+  for (std::vector<RemuxJobWorker*>::iterator worker_iter = workers.begin();
+       worker_iter != workers.end();
+       ++worker_iter) {
+    (*worker_iter)->Join();
+  }
+
+  Status status;
   for (std::vector<RemuxJob*>::const_iterator job_iter = remux_jobs.begin();
        job_iter != remux_jobs.end();
        ++job_iter) {
-    (*job_iter)->Start();
+    status.Update((*job_iter)->status());
   }
-
-  // Wait for all jobs to complete or an error occurs.
-  Status status;
-  bool all_joined;
-  do {
-    all_joined = true;
-    for (std::vector<RemuxJob*>::const_iterator job_iter = remux_jobs.begin();
-         job_iter != remux_jobs.end();
-         ++job_iter) {
-      if ((*job_iter)->HasBeenJoined()) {
-        status = (*job_iter)->status();
-        if (!status.ok())
-          break;
-      } else {
-        all_joined = false;
-        (*job_iter)->Join();
-      }
-    }
-  } while (!all_joined && status.ok());
-
   return status;
 }
 
-bool RunPackager(const StreamDescriptorList& stream_descriptors) {
+// |encryption_key_source| is bound first so that daemon mode can package
+// multiple jobs against one long-lived key source.
+bool RunPackager(KeySource* encryption_key_source,
+                 const StreamDescriptorList& stream_descriptors) {
   const FourCC protection_scheme = GetProtectionScheme(FLAGS_protection_scheme);
   if (protection_scheme == FOURCC_NULL)
     return false;
@@ -451,14 +913,6 @@ bool RunPackager(const StreamDescriptorList& stream_descriptors) {
   if (!GetMpdOptions(&mpd_options))
     return false;
 
-  // Create encryption key source if needed.
-  scoped_ptr<KeySource> encryption_key_source;
-  if (FLAGS_enable_widevine_encryption || FLAGS_enable_fixed_key_encryption) {
-    encryption_key_source = CreateEncryptionKeySource();
-    if (!encryption_key_source)
-      return false;
-  }
-
   scoped_ptr<MpdNotifier> mpd_notifier;
   if (!FLAGS_mpd_output.empty()) {
     DashProfile profile =
@@ -489,16 +943,23 @@ bool RunPackager(const StreamDescriptorList& stream_descriptors) {
         master_playlist_name.value()));
   }
 
+  // Declared before |remux_jobs| since the muxers hold raw pointers to it.
+  scoped_ptr<RuntimeConfig> runtime_config;
+  if (!FLAGS_reconfig_file.empty())
+    runtime_config.reset(new RuntimeConfig(FLAGS_reconfig_file));
+
   std::vector<RemuxJob*> remux_jobs;
   STLElementDeleter<std::vector<RemuxJob*> > scoped_jobs_deleter(&remux_jobs);
   FakeClock fake_clock;
   if (!CreateRemuxJobs(stream_descriptors, muxer_options, &fake_clock,
-                       encryption_key_source.get(), mpd_notifier.get(),
-                       hls_notifier.get(), &remux_jobs)) {
+                       encryption_key_source, mpd_notifier.get(),
+                       hls_notifier.get(), runtime_config.get(),
+                       &remux_jobs)) {
     return false;
   }
 
   Status status = RunRemuxJobs(remux_jobs);
+  pipeline_stats::DumpToLog();
   if (!status.ok()) {
     LOG(ERROR) << "Packaging Error: " << status.ToString();
     return false;
@@ -517,6 +978,37 @@ bool RunPackager(const StreamDescriptorList& stream_descriptors) {
   return true;
 }
 
+// Packages one file that arrived in the watch folder; see --watch_folder.
+// The command line stream descriptors in |descriptor_templates| are
+// instantiated for the file: 'input' is replaced with |file_path| and
+// '{basename}' in the output related fields is replaced with the file name
+// without directory and extension.
+bool RunWatchedFile(KeySource* encryption_key_source,
+                    const StreamDescriptorList& descriptor_templates,
+                    const std::string& file_path) {
+  std::string basename = file_path;
+  const size_t slash_pos = basename.find_last_of('/');
+  if (slash_pos != std::string::npos)
+    basename.erase(0, slash_pos + 1);
+  const size_t dot_pos = basename.find_last_of('.');
+  if (dot_pos != std::string::npos && dot_pos > 0)
+    basename.erase(dot_pos);
+
+  StreamDescriptorList stream_descriptors;
+  for (StreamDescriptorList::const_iterator iter = descriptor_templates.begin();
+       iter != descriptor_templates.end();
+       ++iter) {
+    StreamDescriptor descriptor = *iter;
+    descriptor.input = file_path;
+    base::ReplaceSubstringsAfterOffset(&descriptor.output, 0, "{basename}",
+                                       basename);
+    base::ReplaceSubstringsAfterOffset(&descriptor.segment_template, 0,
+                                       "{basename}", basename);
+    stream_descriptors.insert(descriptor);
+  }
+  return RunPackager(encryption_key_source, stream_descriptors);
+}
+
 int PackagerMain(int argc, char** argv) {
   base::AtExitManager exit;
   // Needed to enable VLOG/DVLOG through --vmodule or --v.
@@ -525,7 +1017,7 @@ int PackagerMain(int argc, char** argv) {
 
   google::SetUsageMessage(base::StringPrintf(kUsage, argv[0]));
   google::ParseCommandLineFlags(&argc, &argv, true);
-  if (argc < 2) {
+  if (argc < 2 && FLAGS_daemon_socket.empty()) {
     const std::string version_string = base::StringPrintf(
         "shaka-packager version %s", GetPackagerVersion().c_str());
     google::ShowUsageWithFlags(version_string.c_str());
@@ -535,10 +1027,91 @@ int PackagerMain(int argc, char** argv) {
   if (!ValidateWidevineCryptoFlags() || !ValidateFixedCryptoFlags())
     return kArgumentValidationFailed;
 
+  if (FLAGS_shard_count > 0) {
+    if (FLAGS_shard_index < 0 || FLAGS_shard_index >= FLAGS_shard_count) {
+      LOG(ERROR) << "--shard_index must be in [0, --shard_count).";
+      return kArgumentValidationFailed;
+    }
+    if (FLAGS_shard_duration <= 0) {
+      LOG(ERROR) << "--shard_duration must be positive when --shard_count "
+                    "is set.";
+      return kArgumentValidationFailed;
+    }
+  } else if (FLAGS_shard_index >= 0 || FLAGS_shard_duration > 0) {
+    LOG(ERROR) << "--shard_index and --shard_duration require --shard_count.";
+    return kArgumentValidationFailed;
+  }
+  if (FLAGS_resume && FLAGS_shard_count > 0) {
+    LOG(ERROR) << "--resume cannot be combined with --shard_count; rerun the "
+                  "failed shard instead.";
+    return kArgumentValidationFailed;
+  }
+
+  // Apply CPU pinning before any pipeline thread is created so every thread
+  // inherits the CPU set.
+  if (!SetCpuAffinityFromFlags())
+    return kArgumentValidationFailed;
+
   if (FLAGS_override_version)
     SetPackagerVersionForTesting(FLAGS_test_version);
 
+  if (FLAGS_io_priority == "bulk") {
+    io_scheduler::SetProcessPriority(io_scheduler::kPriorityBulk);
+  } else if (FLAGS_io_priority != "live") {
+    LOG(ERROR) << "Invalid --io_priority value '" << FLAGS_io_priority
+               << "', expecting 'live' or 'bulk'.";
+    return kArgumentValidationFailed;
+  }
+
+  if (FLAGS_dump_pipeline_stats)
+    pipeline_stats::Enable();
+  if (!FLAGS_trace_file.empty()) {
+    // Enough for hours of spans at fragment/segment granularity; the ring
+    // keeps the most recent ones.
+    const size_t kTraceSpanCapacity = 0x10000;
+    tracing::Enable(kTraceSpanCapacity);
+    base::AtExitManager::RegisterCallback(&DumpTraceSpans, NULL);
+  }
+#if !defined(OS_WIN)
+  if (FLAGS_dump_pipeline_stats || !FLAGS_trace_file.empty())
+    signal(SIGUSR1, &DumpDiagnosticsSignalHandler);
+#endif  // !defined(OS_WIN)
+
+  if (!FLAGS_profile_output.empty()) {
+    if (!sampling_profiler::Start(FLAGS_profile_output))
+      return kArgumentValidationFailed;
+    // Flush the remaining samples on every exit path, including daemon and
+    // watch folder modes.
+    base::AtExitManager::RegisterCallback(&StopSamplingProfiler, NULL);
+  }
+
   LibcryptoThreading libcrypto_threading;
+
+  // The encryption key source is created up front so that daemon mode reuses
+  // it (and any keys it has already fetched) across jobs.
+  scoped_ptr<KeySource> encryption_key_source;
+  if (FLAGS_enable_widevine_encryption || FLAGS_enable_fixed_key_encryption ||
+      FLAGS_enable_synthetic_encryption) {
+    encryption_key_source = CreateEncryptionKeySource();
+    if (!encryption_key_source)
+      return kArgumentValidationFailed;
+  }
+
+  if (!FLAGS_daemon_socket.empty()) {
+    if (!FLAGS_watch_folder.empty()) {
+      LOG(ERROR) << "--daemon_socket and --watch_folder cannot be combined.";
+      return kArgumentValidationFailed;
+    }
+    if (argc >= 2) {
+      LOG(WARNING) << "Stream descriptors on the command line are ignored in "
+                      "daemon mode.";
+    }
+    JobDaemon daemon(
+        FLAGS_daemon_socket,
+        base::Bind(&RunPackager, encryption_key_source.get()));
+    return daemon.Run() ? kSuccess : kInternalError;
+  }
+
   // TODO(tinskip): Make InsertStreamDescriptor a member of
   // StreamDescriptorList.
   StreamDescriptorList stream_descriptors;
@@ -546,7 +1119,23 @@ int PackagerMain(int argc, char** argv) {
     if (!InsertStreamDescriptor(argv[i], &stream_descriptors))
       return kArgumentValidationFailed;
   }
-  return RunPackager(stream_descriptors) ? kSuccess : kPackagingFailed;
+
+  if (!FLAGS_watch_folder.empty()) {
+    if (stream_descriptors.empty()) {
+      LOG(ERROR) << "Watch folder mode requires stream descriptor templates "
+                    "on the command line.";
+      return kArgumentValidationFailed;
+    }
+    WatchFolder watcher(FLAGS_watch_folder,
+                        base::Bind(&RunWatchedFile,
+                                   encryption_key_source.get(),
+                                   stream_descriptors));
+    return watcher.Run() ? kSuccess : kInternalError;
+  }
+
+  return RunPackager(encryption_key_source.get(), stream_descriptors)
+             ? kSuccess
+             : kPackagingFailed;
 }
 
 }  // namespace media
@@ -19,8 +19,10 @@
 #include "packager/media/base/media_stream.h"
 #include "packager/media/base/muxer.h"
 #include "packager/media/base/muxer_options.h"
+#include "packager/media/base/protection_system_specific_info.h"
 #include "packager/media/base/request_signer.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/media/base/synthetic_key_source.h"
 #include "packager/media/base/widevine_key_source.h"
 #include "packager/media/file/file.h"
 #include "packager/mpd/base/mpd_builder.h"
@@ -83,22 +85,46 @@ scoped_ptr<KeySource> CreateEncryptionKeySource() {
         return scoped_ptr<KeySource>();
       widevine_key_source->set_signer(request_signer.Pass());
     }
+    widevine_key_source->set_key_prefetch_count(FLAGS_key_prefetch_periods);
+    if (!FLAGS_license_response_cache_dir.empty()) {
+      widevine_key_source->set_response_cache(
+          FLAGS_license_response_cache_dir, FLAGS_license_response_cache_ttl);
+    }
 
     std::vector<uint8_t> content_id;
     if (!base::HexStringToBytes(FLAGS_content_id, &content_id)) {
       LOG(ERROR) << "Invalid content_id hex string specified.";
       return scoped_ptr<KeySource>();
     }
-    Status status = widevine_key_source->FetchKeys(content_id, FLAGS_policy);
-    if (!status.ok()) {
-      LOG(ERROR) << "Widevine encryption key source failed to fetch keys: "
-                 << status.ToString();
-      return scoped_ptr<KeySource>();
-    }
+    // Start the license request in the background so the server round trip
+    // overlaps with demuxer initialization (container probing and stream
+    // info parsing). Fetch failures are reported by the first GetKey() call.
+    widevine_key_source->FetchKeysAsync(content_id, FLAGS_policy);
     encryption_key_source = widevine_key_source.Pass();
   } else if (FLAGS_enable_fixed_key_encryption) {
     encryption_key_source = FixedKeySource::CreateFromHexStrings(
         FLAGS_key_id, FLAGS_key, FLAGS_pssh, FLAGS_iv);
+  } else if (FLAGS_enable_synthetic_encryption) {
+    // Load-testing only; the source logs a warning that the output can never
+    // be decrypted.
+    encryption_key_source.reset(new SyntheticKeySource());
+  }
+  // Additional protection systems, e.g. PlayReady alongside Widevine, are
+  // signaled from the same encryption pass: the extra PSSH boxes are appended
+  // to the key system info of every key the source returns.
+  if (encryption_key_source && !FLAGS_additional_pssh.empty()) {
+    std::vector<uint8_t> pssh_bytes;
+    if (!base::HexStringToBytes(FLAGS_additional_pssh, &pssh_bytes)) {
+      LOG(ERROR) << "Invalid --additional_pssh hex string specified.";
+      return scoped_ptr<KeySource>();
+    }
+    std::vector<ProtectionSystemSpecificInfo> key_system_info;
+    if (!ProtectionSystemSpecificInfo::ParseBoxes(
+            pssh_bytes.data(), pssh_bytes.size(), &key_system_info)) {
+      LOG(ERROR) << "--additional_pssh does not contain valid PSSH boxes.";
+      return scoped_ptr<KeySource>();
+    }
+    encryption_key_source->set_additional_key_system_info(key_system_info);
   }
   return encryption_key_source.Pass();
 }
@@ -155,6 +181,12 @@ bool GetMuxerOptions(MuxerOptions* muxer_options) {
   muxer_options->fragment_sap_aligned = FLAGS_fragment_sap_aligned;
   muxer_options->num_subsegments_per_sidx = FLAGS_num_subsegments_per_sidx;
 
+  if (FLAGS_segment_start_number < 1) {
+    LOG(ERROR) << "--segment_start_number must be positive.";
+    return false;
+  }
+  muxer_options->segment_start_number = FLAGS_segment_start_number;
+
   if (FLAGS_mp4_use_decoding_timestamp_in_timeline) {
     LOG(WARNING) << "Flag --mp4_use_decoding_timestamp_in_timeline is set. "
                     "Note that it is a temporary hack to workaround Chromium "
@@ -164,7 +196,17 @@ bool GetMuxerOptions(MuxerOptions* muxer_options) {
   muxer_options->mp4_use_decoding_timestamp_in_timeline =
       FLAGS_mp4_use_decoding_timestamp_in_timeline;
 
+  if (FLAGS_encryption_threads < 1) {
+    LOG(ERROR) << "--encryption_threads must be positive.";
+    return false;
+  }
+  muxer_options->num_encryption_threads = FLAGS_encryption_threads;
+
+  muxer_options->mp4_reserve_index_space = FLAGS_mp4_reserve_index_space;
+  muxer_options->mp4_stream_fragments = FLAGS_mp4_stream_fragments;
+  muxer_options->webm_reserve_cues_space = FLAGS_webm_reserve_cues_space;
   muxer_options->temp_dir = FLAGS_temp_dir;
+  muxer_options->temp_file_memory_limit = FLAGS_temp_file_memory_limit;
   return true;
 }
 
@@ -177,6 +219,13 @@ bool GetMpdOptions(MpdOptions* mpd_options) {
   mpd_options->time_shift_buffer_depth = FLAGS_time_shift_buffer_depth;
   mpd_options->suggested_presentation_delay =
       FLAGS_suggested_presentation_delay;
+  mpd_options->mpd_flush_interval_seconds = FLAGS_mpd_flush_interval;
+  if (FLAGS_mpd_sharded_output && FLAGS_generate_dash_if_iop_compliant_mpd) {
+    LOG(ERROR) << "--mpd_sharded_output is not supported with "
+                  "--generate_dash_if_iop_compliant_mpd.";
+    return false;
+  }
+  mpd_options->sharded_output = FLAGS_mpd_sharded_output;
   return true;
 }
 
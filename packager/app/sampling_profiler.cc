@@ -0,0 +1,309 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/sampling_profiler.h"
+
+#include "packager/base/logging.h"
+
+#if !defined(OS_LINUX)
+
+namespace shaka {
+namespace media {
+namespace sampling_profiler {
+
+bool Start(const std::string& output_prefix) {
+  NOTIMPLEMENTED() << "The sampling profiler is only supported on Linux.";
+  return false;
+}
+
+void SetThreadLabel(const std::string& label) {}
+
+void Dump() {}
+
+void Stop() {}
+
+}  // namespace sampling_profiler
+}  // namespace media
+}  // namespace shaka
+
+#else
+
+#include <errno.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "packager/base/atomicops.h"
+
+namespace shaka {
+namespace media {
+namespace sampling_profiler {
+namespace {
+
+// Prime, so the sampling does not run in lockstep with periodic work driven
+// by common timer frequencies.
+const int kSamplingFrequencyHz = 97;
+
+const int kMaxStackDepth = 32;
+// backtrace() frames for the signal handler itself and the kernel signal
+// trampoline, dropped when profiles are written.
+const int kSkipFrames = 2;
+
+const int kMaxLabels = 64;
+const int kMaxLabelLength = 64;
+const int kMaxPathLength = 512;
+
+// About 18 MB of sample storage; roughly ten minutes of one busy thread at
+// the sampling frequency. The buffer is reset on every dump, and samples
+// taken while it is full are dropped (and counted).
+const int32_t kMaxSamples = 1 << 16;
+
+struct Sample {
+  int32_t label;
+  int32_t depth;
+  void* pcs[kMaxStackDepth];
+};
+
+// All of this state is written by normal code only while sampling is stopped
+// (g_started == 0), and read by the signal handlers otherwise.
+Sample* g_samples = NULL;
+char g_labels[kMaxLabels][kMaxLabelLength];
+char g_output_prefix[kMaxPathLength];
+base::subtle::Atomic32 g_num_labels = 0;
+base::subtle::Atomic32 g_next_sample = 0;
+base::subtle::Atomic32 g_dropped_samples = 0;
+base::subtle::Atomic32 g_started = 0;
+
+// Index into |g_labels| used for samples taken on this thread.
+__thread int32_t tls_label = 0;
+
+void ProfTimerSignalHandler(int signal_number) {
+  if (!base::subtle::Acquire_Load(&g_started))
+    return;
+  const base::subtle::Atomic32 index =
+      base::subtle::NoBarrier_AtomicIncrement(&g_next_sample, 1) - 1;
+  if (index >= kMaxSamples) {
+    base::subtle::NoBarrier_AtomicIncrement(&g_dropped_samples, 1);
+    return;
+  }
+  Sample* sample = &g_samples[index];
+  sample->label = tls_label;
+  sample->depth = backtrace(sample->pcs, kMaxStackDepth);
+}
+
+// Appends |value| to the NUL-terminated string in |buffer| of size |size|.
+// Async-signal-safe; silently truncates.
+void SafeAppend(char* buffer, size_t size, const char* value) {
+  size_t length = strlen(buffer);
+  while (length + 1 < size && *value != '\0')
+    buffer[length++] = *value++;
+  buffer[length] = '\0';
+}
+
+bool WriteFully(int fd, const void* data, size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  while (size > 0) {
+    const ssize_t written = write(fd, bytes, size);
+    if (written <= 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    bytes += written;
+    size -= written;
+  }
+  return true;
+}
+
+// Writes one profile in the pprof CPU profile binary format: a five word
+// header, then {count, depth, pcs...} per sample, a {0, 1, 0} trailer, and
+// the text of /proc/self/maps so pprof can symbolize the addresses.
+bool WriteProfile(const char* path, int32_t label, int32_t num_samples) {
+  const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+
+  bool ok = true;
+  const uintptr_t header[5] = {0, 3, 0, 1000000 / kSamplingFrequencyHz, 0};
+  ok = ok && WriteFully(fd, header, sizeof(header));
+
+  for (int32_t i = 0; ok && i < num_samples; ++i) {
+    const Sample& sample = g_samples[i];
+    if (sample.label != label || sample.depth <= kSkipFrames)
+      continue;
+    const uintptr_t record[2] = {
+        1, static_cast<uintptr_t>(sample.depth - kSkipFrames)};
+    ok = ok && WriteFully(fd, record, sizeof(record));
+    ok = ok && WriteFully(fd, &sample.pcs[kSkipFrames],
+                          (sample.depth - kSkipFrames) * sizeof(void*));
+  }
+
+  const uintptr_t trailer[3] = {0, 1, 0};
+  ok = ok && WriteFully(fd, trailer, sizeof(trailer));
+
+  const int maps_fd = open("/proc/self/maps", O_RDONLY);
+  if (maps_fd >= 0) {
+    char buffer[4096];
+    ssize_t bytes_read;
+    while (ok && (bytes_read = read(maps_fd, buffer, sizeof(buffer))) > 0)
+      ok = ok && WriteFully(fd, buffer, bytes_read);
+    close(maps_fd);
+  }
+
+  close(fd);
+  return ok;
+}
+
+void DumpSignalHandler(int signal_number) {
+  Dump();
+}
+
+}  // namespace
+
+bool Start(const std::string& output_prefix) {
+  if (base::subtle::Acquire_Load(&g_started)) {
+    LOG(ERROR) << "Sampling profiler is already running.";
+    return false;
+  }
+  if (output_prefix.size() >= kMaxPathLength - kMaxLabelLength - 8) {
+    LOG(ERROR) << "Profile output prefix is too long: " << output_prefix;
+    return false;
+  }
+  strcpy(g_output_prefix, output_prefix.c_str());
+
+  if (!g_samples)
+    g_samples = new Sample[kMaxSamples];
+  base::subtle::NoBarrier_Store(&g_next_sample, 0);
+  base::subtle::NoBarrier_Store(&g_dropped_samples, 0);
+  strcpy(g_labels[0], "main");
+  base::subtle::NoBarrier_Store(&g_num_labels, 1);
+
+  // The first backtrace() call may allocate while loading the unwinder;
+  // take one here so the signal handler never does.
+  void* warmup[kMaxStackDepth];
+  backtrace(warmup, kMaxStackDepth);
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = &ProfTimerSignalHandler;
+  action.sa_flags = SA_RESTART;
+  sigaction(SIGPROF, &action, NULL);
+  action.sa_handler = &DumpSignalHandler;
+  sigaction(SIGUSR2, &action, NULL);
+
+  base::subtle::Release_Store(&g_started, 1);
+
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = 1000000 / kSamplingFrequencyHz;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+    PLOG(ERROR) << "Failed to start the profiling timer";
+    base::subtle::Release_Store(&g_started, 0);
+    return false;
+  }
+
+  LOG(INFO) << "Sampling profiler started at " << kSamplingFrequencyHz
+            << " Hz; dump profiles with SIGUSR2 or at exit to "
+            << output_prefix << ".<label>.prof";
+  return true;
+}
+
+void SetThreadLabel(const std::string& label) {
+  if (!base::subtle::Acquire_Load(&g_started))
+    return;
+
+  char sanitized[kMaxLabelLength];
+  size_t length = 0;
+  for (size_t i = 0; i < label.size() && length < kMaxLabelLength - 1; ++i) {
+    const char c = label[i];
+    const bool is_safe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                         (c >= '0' && c <= '9') || c == '-' || c == '.';
+    sanitized[length++] = is_safe ? c : '_';
+  }
+  sanitized[length] = '\0';
+
+  // Reuse an existing label slot if the label has been seen before (e.g. the
+  // same channel restarting in a long-lived process). New slots are only ever
+  // appended and |g_num_labels| is only incremented after the name is in
+  // place, so the signal handlers always see consistent entries. Concurrent
+  // registration of the *same* new label from two threads could burn a
+  // duplicate slot, which is harmless.
+  const base::subtle::Atomic32 num_labels =
+      base::subtle::Acquire_Load(&g_num_labels);
+  for (base::subtle::Atomic32 i = 0; i < num_labels; ++i) {
+    if (strcmp(g_labels[i], sanitized) == 0) {
+      tls_label = i;
+      return;
+    }
+  }
+  const base::subtle::Atomic32 index =
+      base::subtle::NoBarrier_AtomicIncrement(&g_num_labels, 1) - 1;
+  if (index >= kMaxLabels) {
+    base::subtle::NoBarrier_Store(&g_num_labels, kMaxLabels);
+    LOG(WARNING) << "Too many profiler labels; samples for '" << label
+                 << "' are attributed to the main label.";
+    tls_label = 0;
+    return;
+  }
+  strcpy(g_labels[index], sanitized);
+  tls_label = index;
+}
+
+void Dump() {
+  // Pause sampling while the buffer is read; a SIGPROF that fires now drops
+  // its sample. A sample that was being written when the pause took effect
+  // may be read torn, which pprof tolerates.
+  const base::subtle::Atomic32 was_started =
+      base::subtle::NoBarrier_AtomicExchange(&g_started, 0);
+  if (!was_started)
+    return;
+
+  int32_t num_samples = base::subtle::Acquire_Load(&g_next_sample);
+  if (num_samples > kMaxSamples)
+    num_samples = kMaxSamples;
+
+  const base::subtle::Atomic32 num_labels =
+      base::subtle::Acquire_Load(&g_num_labels);
+  for (base::subtle::Atomic32 label = 0; label < num_labels; ++label) {
+    char path[kMaxPathLength];
+    path[0] = '\0';
+    SafeAppend(path, sizeof(path), g_output_prefix);
+    SafeAppend(path, sizeof(path), ".");
+    SafeAppend(path, sizeof(path), g_labels[label]);
+    SafeAppend(path, sizeof(path), ".prof");
+    WriteProfile(path, label, num_samples);
+  }
+
+  base::subtle::Release_Store(&g_next_sample, 0);
+  base::subtle::Release_Store(&g_started, 1);
+}
+
+void Stop() {
+  if (!base::subtle::Acquire_Load(&g_started))
+    return;
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NULL);
+
+  const base::subtle::Atomic32 dropped =
+      base::subtle::NoBarrier_Load(&g_dropped_samples);
+  LOG_IF(WARNING, dropped > 0)
+      << dropped << " profiler samples were dropped because the sample "
+                    "buffer filled up; dump more often (SIGUSR2).";
+
+  Dump();
+  base::subtle::Release_Store(&g_started, 0);
+}
+
+}  // namespace sampling_profiler
+}  // namespace media
+}  // namespace shaka
+
+#endif  // !defined(OS_LINUX)
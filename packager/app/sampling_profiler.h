@@ -0,0 +1,49 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef APP_SAMPLING_PROFILER_H_
+#define APP_SAMPLING_PROFILER_H_
+
+#include <string>
+
+namespace shaka {
+namespace media {
+
+/// Built-in signal-driven stack sampling, for seeing hot paths per packaging
+/// job in production without attaching external tooling. A SIGPROF timer
+/// samples whichever threads are running; each sample is tagged with a label
+/// set by the thread that produced it (the job's input name), so a box
+/// running many channels in one process can be broken down by channel.
+/// Profiles are written in the pprof CPU profile format, one file per label,
+/// on SIGUSR2 and when sampling stops, and can be viewed with
+/// `pprof <packager binary> <profile file>`. Linux only.
+namespace sampling_profiler {
+
+/// Start sampling. Call during startup before the pipeline threads exist.
+/// @param output_prefix is the path prefix for dumped profiles; a profile for
+///        label L is written to "<output_prefix>.<L>.prof".
+/// @return true on success.
+bool Start(const std::string& output_prefix);
+
+/// Tag future samples taken on the calling thread with @a label. Non-filename
+/// characters in the label are replaced with '_'. No-op when sampling is not
+/// active; cheap enough to call unconditionally at job start.
+void SetThreadLabel(const std::string& label);
+
+/// Write the collected samples out, one pprof-compatible file per label, and
+/// reset the sample buffer. Also invoked by SIGUSR2; only async-signal-safe
+/// calls are used.
+void Dump();
+
+/// Stop sampling and dump the remaining samples. No-op when sampling is not
+/// active.
+void Stop();
+
+}  // namespace sampling_profiler
+}  // namespace media
+}  // namespace shaka
+
+#endif  // APP_SAMPLING_PROFILER_H_
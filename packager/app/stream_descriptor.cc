@@ -25,7 +25,11 @@ enum FieldType {
   kOutputField,
   kSegmentTemplateField,
   kBandwidthField,
+  kClipStartField,
+  kClipEndField,
+  kTrickPlayRateField,
   kLanguageField,
+  kInputFormatField,
   kOutputFormatField,
   kHlsNameField,
   kHlsGroupIdField,
@@ -50,8 +54,12 @@ const FieldNameToTypeMapping kFieldNameTypeMappings[] = {
     {"bandwidth", kBandwidthField},
     {"bw", kBandwidthField},
     {"bitrate", kBandwidthField},
+    {"clip_start", kClipStartField},
+    {"clip_end", kClipEndField},
+    {"trick_play_rate", kTrickPlayRateField},
     {"language", kLanguageField},
     {"lang", kLanguageField},
+    {"input_format", kInputFormatField},
     {"output_format", kOutputFormatField},
     {"format", kOutputFormatField},
     {"hls_name", kHlsNameField},
@@ -70,7 +78,12 @@ FieldType GetFieldType(const std::string& field_name) {
 }  // anonymous namespace
 
 StreamDescriptor::StreamDescriptor()
-    : bandwidth(0), output_format(CONTAINER_UNKNOWN) {}
+    : bandwidth(0),
+      clip_start_seconds(0),
+      clip_end_seconds(0),
+      trick_play_rate(0),
+      input_format(CONTAINER_UNKNOWN),
+      output_format(CONTAINER_UNKNOWN) {}
 
 StreamDescriptor::~StreamDescriptor() {}
 
@@ -111,6 +124,34 @@ bool InsertStreamDescriptor(const std::string& descriptor_string,
         descriptor.bandwidth = bw;
         break;
       }
+      case kClipStartField: {
+        double seconds;
+        if (!base::StringToDouble(iter->second, &seconds) || seconds < 0) {
+          LOG(ERROR) << "Invalid clip_start specified: " << iter->second;
+          return false;
+        }
+        descriptor.clip_start_seconds = seconds;
+        break;
+      }
+      case kClipEndField: {
+        double seconds;
+        if (!base::StringToDouble(iter->second, &seconds) || seconds <= 0) {
+          LOG(ERROR) << "Invalid clip_end specified: " << iter->second;
+          return false;
+        }
+        descriptor.clip_end_seconds = seconds;
+        break;
+      }
+      case kTrickPlayRateField: {
+        unsigned rate;
+        if (!base::StringToUint(iter->second, &rate) || rate == 0 ||
+            rate > 0x7FFF) {
+          LOG(ERROR) << "Invalid trick_play_rate specified: " << iter->second;
+          return false;
+        }
+        descriptor.trick_play_rate = static_cast<int16_t>(rate);
+        break;
+      }
       case kLanguageField: {
         std::string language = LanguageToISO_639_2(iter->second);
         if (language == "und") {
@@ -121,10 +162,21 @@ bool InsertStreamDescriptor(const std::string& descriptor_string,
         descriptor.language = language;
         break;
       }
+      case kInputFormatField: {
+        MediaContainerName input_format =
+            DetermineContainerFromFormatName(iter->second);
+        if (input_format == CONTAINER_UNKNOWN) {
+          LOG(ERROR) << "Unrecognized input format " << iter->second;
+          return false;
+        }
+        descriptor.input_format = input_format;
+        break;
+      }
       case kOutputFormatField: {
         MediaContainerName output_format =
             DetermineContainerFromFormatName(iter->second);
-        if (output_format == CONTAINER_UNKNOWN) {
+        if (output_format == CONTAINER_UNKNOWN ||
+            output_format == CONTAINER_ESCACHE) {
           LOG(ERROR) << "Unrecognized output format " << iter->second;
           return false;
         }
@@ -151,6 +203,15 @@ bool InsertStreamDescriptor(const std::string& descriptor_string,
     }
   }
   // Validate and insert the descriptor
+  if (descriptor.clip_start_seconds > 0 && descriptor.clip_end_seconds == 0) {
+    LOG(ERROR) << "clip_start requires clip_end.";
+    return false;
+  }
+  if (descriptor.clip_end_seconds > 0 &&
+      descriptor.clip_end_seconds <= descriptor.clip_start_seconds) {
+    LOG(ERROR) << "clip_end must be greater than clip_start.";
+    return false;
+  }
   if (descriptor.input.empty()) {
     LOG(ERROR) << "Stream input not specified.";
     return false;
@@ -28,7 +28,16 @@ struct StreamDescriptor {
   std::string output;
   std::string segment_template;
   uint32_t bandwidth;
+  // Clip extraction range, in seconds. Unset if |clip_end_seconds| is zero.
+  double clip_start_seconds;
+  double clip_end_seconds;
+  // Key frame decimation factor for a trick play output. Zero disables trick
+  // play; 1 keeps every key frame.
+  int16_t trick_play_rate;
   std::string language;
+  // Declared input container, bypassing content sniffing when set. Intended
+  // for trusted encoder-adjacent inputs, e.g. CONTAINER_ESCACHE.
+  MediaContainerName input_format;
   MediaContainerName output_format;
   std::string hls_name;
   std::string hls_group_id;
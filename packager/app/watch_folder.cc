@@ -0,0 +1,142 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/app/watch_folder.h"
+
+#include "packager/base/logging.h"
+
+#if !defined(OS_LINUX)
+
+namespace shaka {
+namespace media {
+
+// TODO(tinskip): Implement on top of kqueue for mac builds.
+WatchFolder::WatchFolder(const std::string& watch_dir,
+                         const FileCallback& on_file)
+    : watch_dir_(watch_dir), on_file_(on_file), inotify_fd_(-1) {}
+
+WatchFolder::~WatchFolder() {}
+
+bool WatchFolder::Run() {
+  NOTIMPLEMENTED() << "Watch folder mode requires inotify and is only "
+                      "supported on Linux.";
+  return false;
+}
+
+void WatchFolder::ProcessFile(const std::string& name) {}
+
+}  // namespace media
+}  // namespace shaka
+
+#else
+
+#include <dirent.h>
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace shaka {
+namespace media {
+namespace {
+
+const int kInvalidFd(-1);
+
+}  // namespace
+
+WatchFolder::WatchFolder(const std::string& watch_dir,
+                         const FileCallback& on_file)
+    : watch_dir_(watch_dir), on_file_(on_file), inotify_fd_(kInvalidFd) {
+  // Normalize so ProcessFile can join with a single separator.
+  while (watch_dir_.size() > 1 && watch_dir_[watch_dir_.size() - 1] == '/')
+    watch_dir_.erase(watch_dir_.size() - 1);
+}
+
+WatchFolder::~WatchFolder() {
+  if (inotify_fd_ != kInvalidFd)
+    close(inotify_fd_);
+}
+
+bool WatchFolder::Run() {
+  inotify_fd_ = inotify_init();
+  if (inotify_fd_ == kInvalidFd) {
+    PLOG(ERROR) << "Could not initialize inotify";
+    return false;
+  }
+  // Watch for files that finished writing or were moved into the folder.
+  // IN_CREATE would fire while the producer is still writing.
+  if (inotify_add_watch(inotify_fd_, watch_dir_.c_str(),
+                        IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    PLOG(ERROR) << "Could not watch folder " << watch_dir_;
+    return false;
+  }
+
+  // Package the backlog already in the folder. The watch is set up first so
+  // a file dropped during the scan is seen either here or as an event;
+  // |processed_| suppresses the duplicate.
+  DIR* dir = opendir(watch_dir_.c_str());
+  if (!dir) {
+    PLOG(ERROR) << "Could not open folder " << watch_dir_;
+    return false;
+  }
+  std::vector<std::string> existing_files;
+  while (struct dirent* entry = readdir(dir)) {
+    if (entry->d_type != DT_DIR)
+      existing_files.push_back(entry->d_name);
+  }
+  closedir(dir);
+  std::sort(existing_files.begin(), existing_files.end());
+  for (std::vector<std::string>::const_iterator iter = existing_files.begin();
+       iter != existing_files.end();
+       ++iter) {
+    ProcessFile(*iter);
+  }
+
+  LOG(INFO) << "Watching " << watch_dir_ << " for new files.";
+  char buffer[4096];
+  while (true) {
+    const ssize_t bytes_read = read(inotify_fd_, buffer, sizeof(buffer));
+    if (bytes_read < 0) {
+      if (errno == EINTR)
+        continue;
+      PLOG(ERROR) << "Read failed on inotify descriptor for " << watch_dir_;
+      return false;
+    }
+    ssize_t offset = 0;
+    while (offset < bytes_read) {
+      const struct inotify_event* event =
+          reinterpret_cast<const struct inotify_event*>(buffer + offset);
+      if (event->len > 0 && !(event->mask & IN_ISDIR))
+        ProcessFile(event->name);
+      offset += sizeof(struct inotify_event) + event->len;
+    }
+  }
+}
+
+void WatchFolder::ProcessFile(const std::string& name) {
+  // Skip hidden files; producers commonly write to a dotfile and rename it
+  // into place when complete.
+  if (name.empty() || name[0] == '.')
+    return;
+  if (!processed_.insert(name).second) {
+    LOG(WARNING) << "Skipping '" << name
+                 << "': a file with this name was already packaged.";
+    return;
+  }
+  const std::string file_path = watch_dir_ + "/" + name;
+  LOG(INFO) << "Packaging " << file_path;
+  if (!on_file_.Run(file_path)) {
+    LOG(ERROR) << "Packaging failed for " << file_path
+               << "; continuing to watch.";
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // !defined(OS_LINUX)
@@ -0,0 +1,60 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef APP_WATCH_FOLDER_H_
+#define APP_WATCH_FOLDER_H_
+
+#include <set>
+#include <string>
+
+#include "packager/base/callback.h"
+#include "packager/base/macros.h"
+
+namespace shaka {
+namespace media {
+
+/// Watches a folder and packages files as they arrive, from a long-lived
+/// process. Files already in the folder when the watch starts are packaged
+/// first, in name order; afterwards every file that finishes writing in or is
+/// moved into the folder is packaged as it appears. Since all files are
+/// handled in process, warmed state - the key source and any fetched
+/// licenses, the task pool threads and the allocator - is reused across
+/// files, so small files do not pay process startup costs. Only supported on
+/// Linux (inotify).
+class WatchFolder {
+ public:
+  typedef base::Callback<bool(const std::string& file_path)> FileCallback;
+
+  /// @param watch_dir is the folder to watch. It must exist.
+  /// @param on_file is called synchronously for each arriving file.
+  WatchFolder(const std::string& watch_dir, const FileCallback& on_file);
+  ~WatchFolder();
+
+  /// Package the files already in the folder, then watch for new files until
+  /// an unrecoverable error occurs. Files are packaged one at a time; a
+  /// packaging failure is logged and does not stop the watch.
+  /// @return false if the folder could not be read or watched.
+  bool Run();
+
+ private:
+  // Runs the callback for the file named @a name in the watch folder, unless
+  // it is hidden or a file of the same name was already packaged.
+  void ProcessFile(const std::string& name);
+
+  std::string watch_dir_;
+  FileCallback on_file_;
+  int inotify_fd_;
+  // Names already packaged. Files are expected to be dropped once under
+  // unique names; a repeated name is skipped with a warning.
+  std::set<std::string> processed_;
+
+  DISALLOW_COPY_AND_ASSIGN(WatchFolder);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // APP_WATCH_FOLDER_H_
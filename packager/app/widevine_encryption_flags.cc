@@ -28,6 +28,14 @@ DEFINE_bool(include_common_pssh,
             "When using Widevine encryption, include an additional v1 PSSH box "
             "for the common system ID that includes the key IDs. See: "
             "https://goo.gl/507mKp");
+DEFINE_string(additional_pssh,
+              "",
+              "One or more concatenated PSSH boxes in hex string format, e.g. "
+              "for PlayReady, appended to the key system info of every "
+              "encryption key. Since CENC ciphertext is key dependent but the "
+              "PSSH/manifest signaling is not, this produces multi-DRM "
+              "outputs from a single encryption pass instead of one full "
+              "packaging pass per DRM system.");
 DEFINE_string(key_server_url, "", "Key server url. Required for encryption and "
               "decryption");
 DEFINE_string(content_id, "", "Content Id (hex).");
@@ -55,6 +63,23 @@ DEFINE_int32(crypto_period_duration,
              0,
              "Crypto period duration in seconds. If it is non-zero, key "
              "rotation is enabled.");
+DEFINE_int32(key_prefetch_periods,
+             40,
+             "Size of the rotation key prefetch window in crypto periods. "
+             "Roughly half of the window is fetched from the license server "
+             "ahead of the crypto period being packaged. Only relevant when "
+             "key rotation is enabled.");
+DEFINE_string(license_response_cache_dir,
+              "",
+              "Optional directory for caching license server responses on "
+              "disk, keyed by the request parameters. If set, key requests "
+              "identical to an earlier run are served from the cache without "
+              "contacting the license server.");
+DEFINE_int32(license_response_cache_ttl,
+             0,
+             "Time in seconds a cached license response stays usable. 0 "
+             "means cached responses never expire. Only relevant when "
+             "--license_response_cache_dir is set.");
 DEFINE_string(protection_scheme,
               "cenc",
               "Choose protection scheme, 'cenc' or 'cbc1' or pattern-based "
@@ -159,6 +184,23 @@ bool ValidateWidevineCryptoFlags() {
     PrintError("--crypto_period_duration should not be negative.");
     success = false;
   }
+
+  if (FLAGS_key_prefetch_periods <= 0) {
+    PrintError("--key_prefetch_periods must be positive.");
+    success = false;
+  }
+
+  if (FLAGS_license_response_cache_ttl < 0) {
+    PrintError("--license_response_cache_ttl should not be negative.");
+    success = false;
+  }
+  if (FLAGS_license_response_cache_ttl > 0 &&
+      FLAGS_license_response_cache_dir.empty()) {
+    PrintError(
+        "--license_response_cache_ttl requires "
+        "--license_response_cache_dir.");
+    success = false;
+  }
   return success;
 }
 
@@ -14,6 +14,7 @@
 DECLARE_bool(enable_widevine_encryption);
 DECLARE_bool(enable_widevine_decryption);
 DECLARE_bool(include_common_pssh);
+DECLARE_string(additional_pssh);
 DECLARE_string(key_server_url);
 DECLARE_string(content_id);
 DECLARE_string(policy);
@@ -23,6 +24,9 @@ DECLARE_string(aes_signing_key);
 DECLARE_string(aes_signing_iv);
 DECLARE_string(rsa_signing_key_path);
 DECLARE_int32(crypto_period_duration);
+DECLARE_int32(key_prefetch_periods);
+DECLARE_string(license_response_cache_dir);
+DECLARE_int32(license_response_cache_ttl);
 DECLARE_string(protection_scheme);
 
 namespace shaka {
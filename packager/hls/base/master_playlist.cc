@@ -8,21 +8,115 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
 #include <cmath>
 #include <list>
 #include <map>
 #include <set>
+#include <utility>
+#include <vector>
 
+#include "packager/base/bind.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_piece.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/time/time.h"
 #include "packager/hls/base/media_playlist.h"
+#include "packager/media/base/closure_thread.h"
 #include "packager/media/file/file.h"
 #include "packager/media/file/file_closer.h"
+#include "packager/media/file/gzip_file.h"
 #include "packager/version/version.h"
 
 namespace shaka {
 namespace hls {
 
+namespace {
+
+// Opens |file_path| for writing. Playlists with a ".gz" suffix are gzip
+// compressed as they are written.
+scoped_ptr<media::File, media::FileCloser> OpenPlaylistFile(
+    const std::string& file_path) {
+  scoped_ptr<media::File, media::FileCloser> file(
+      media::File::Open(file_path.c_str(), "w"));
+  if (file && base::StringPiece(file_path).ends_with(".gz"))
+    file.reset(new media::GzipFile(file.Pass()));
+  return file.Pass();
+}
+
+// Playlists may publish to slow network mounts where writes fail
+// transiently; retry a couple of times with a short pause before giving up.
+const int kPlaylistWriteAttempts = 3;
+const int kPlaylistWriteRetryDelayMs = 100;
+
+// Upper bound on concurrent playlist writes. Enough to keep one slow mount
+// from serializing the other variants without flooding the storage backend.
+const size_t kMaxParallelPlaylistWrites = 4;
+
+bool WritePlaylistWithRetry(MediaPlaylist* playlist,
+                            const std::string& file_path) {
+  for (int attempt = 0; attempt < kPlaylistWriteAttempts; ++attempt) {
+    if (attempt > 0) {
+      LOG(WARNING) << "Retrying write of playlist " << file_path << ".";
+      base::PlatformThread::Sleep(
+          base::TimeDelta::FromMilliseconds(kPlaylistWriteRetryDelayMs));
+    }
+    scoped_ptr<media::File, media::FileCloser> file(
+        OpenPlaylistFile(file_path));
+    if (!file) {
+      LOG(ERROR) << "Failed to open file " << file_path;
+      continue;
+    }
+    if (playlist->WriteToFile(file.get()))
+      return true;
+    LOG(ERROR) << "Failed to write playlist " << file_path;
+  }
+  return false;
+}
+
+// Hands the queued (playlist, path) pairs out to a bounded set of writer
+// threads, so one variant whose write stalls does not delay the visibility
+// of the others. Each playlist is handled by exactly one thread.
+class ParallelPlaylistWriter {
+ public:
+  explicit ParallelPlaylistWriter(
+      const std::vector<std::pair<MediaPlaylist*, std::string>>* work_items)
+      : work_items_(work_items), next_index_(0), success_(true) {}
+
+  void Run() {
+    for (;;) {
+      size_t index;
+      {
+        base::AutoLock auto_lock(lock_);
+        if (next_index_ >= work_items_->size())
+          return;
+        index = next_index_++;
+      }
+      const std::pair<MediaPlaylist*, std::string>& item =
+          (*work_items_)[index];
+      if (!WritePlaylistWithRetry(item.first, item.second)) {
+        base::AutoLock auto_lock(lock_);
+        success_ = false;
+      }
+    }
+  }
+
+  // Valid after all the writer threads are joined.
+  bool success() const { return success_; }
+
+ private:
+  const std::vector<std::pair<MediaPlaylist*, std::string>>* const work_items_;
+  base::Lock lock_;
+  size_t next_index_;
+  bool success_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelPlaylistWriter);
+};
+
+}  // namespace
+
 MasterPlaylist::MasterPlaylist(const std::string& file_name)
     : file_name_(file_name) {}
 MasterPlaylist::~MasterPlaylist() {}
@@ -48,6 +142,7 @@ bool MasterPlaylist::WriteAllPlaylists(const std::string& base_url,
     }
   }
 
+  std::vector<std::pair<MediaPlaylist*, std::string>> work_items;
   for (MediaPlaylist* playlist : media_playlists_) {
     std::string file_path = output_dir + playlist->file_name();
     if (!has_set_playlist_target_duration_) {
@@ -56,18 +151,30 @@ bool MasterPlaylist::WriteAllPlaylists(const std::string& base_url,
       LOG_IF(WARNING, !set_target_duration)
           << "Target duration was already set for " << file_path;
     }
+    work_items.push_back(std::make_pair(playlist, file_path));
+  }
 
-    scoped_ptr<media::File, media::FileCloser> file(
-        media::File::Open(file_path.c_str(), "w"));
-    if (!file) {
-      LOG(ERROR) << "Failed to open file " << file_path;
-      return false;
+  ParallelPlaylistWriter writer(&work_items);
+  if (work_items.size() <= 1) {
+    // Nothing to overlap; avoid the thread setup.
+    writer.Run();
+  } else {
+    const size_t num_threads =
+        std::min(work_items.size(), kMaxParallelPlaylistWrites);
+    std::vector<media::ClosureThread*> threads;
+    for (size_t i = 0; i < num_threads; ++i) {
+      threads.push_back(new media::ClosureThread(
+          "PlaylistWriteThread",
+          base::Bind(&ParallelPlaylistWriter::Run, base::Unretained(&writer))));
+      threads.back()->Start();
     }
-    if (!playlist->WriteToFile(file.get())) {
-      LOG(ERROR) << "Failed to write playlist " << file_path;
-      return false;
+    for (media::ClosureThread* thread : threads) {
+      thread->Join();
+      delete thread;
     }
   }
+  if (!writer.success())
+    return false;
 
   has_set_playlist_target_duration_ = true;
   return true;
@@ -75,9 +182,18 @@ bool MasterPlaylist::WriteAllPlaylists(const std::string& base_url,
 
 bool MasterPlaylist::WriteMasterPlaylist(const std::string& base_url,
                                          const std::string& output_dir) {
+  // Gather each variant's current bandwidth up front. The master playlist
+  // only depends on the variant list and these values, so when neither has
+  // changed since the last write - the steady state for live - the rebuild
+  // and the write are both skipped.
+  std::map<const MediaPlaylist*, uint64_t> current_bitrates;
+  for (const MediaPlaylist* playlist : media_playlists_)
+    current_bitrates[playlist] = playlist->Bitrate();
+  if (current_bitrates == written_bitrates_)
+    return true;
+
   std::string file_path = output_dir + file_name_;
-  scoped_ptr<media::File, media::FileCloser> file(
-      media::File::Open(file_path.c_str(), "w"));
+  scoped_ptr<media::File, media::FileCloser> file(OpenPlaylistFile(file_path));
   if (!file) {
     LOG(ERROR) << "Failed to open file " << file_path;
     return false;
@@ -116,13 +232,13 @@ bool MasterPlaylist::WriteMasterPlaylist(const std::string& base_url,
           "#EXT-X-MEDIA:TYPE=AUDIO,GROUP-ID=\"%s\",NAME=\"%s\",URI=\"%s\"\n",
           group_id.c_str(), audio_playlist->name().c_str(),
           (base_url + audio_playlist->file_name()).c_str());
-      const uint64_t audio_bitrate = audio_playlist->Bitrate();
+      const uint64_t audio_bitrate = current_bitrates[audio_playlist];
       if (audio_bitrate > max_audio_bitrate)
         max_audio_bitrate = audio_bitrate;
     }
     for (const MediaPlaylist* video_playlist : video_playlists) {
       const std::string& video_codec = video_playlist->codec();
-      const uint64_t video_bitrate = video_playlist->Bitrate();
+      const uint64_t video_bitrate = current_bitrates[video_playlist];
 
       // Assume all codecs are the same for same group ID.
       const std::string& audio_codec = audio_playlists.front()->codec();
@@ -139,7 +255,7 @@ bool MasterPlaylist::WriteMasterPlaylist(const std::string& base_url,
   if (audio_group_map.empty()) {
     for (const MediaPlaylist* video_playlist : video_playlists) {
       const std::string& video_codec = video_playlist->codec();
-      const uint64_t video_bitrate = video_playlist->Bitrate();
+      const uint64_t video_bitrate = current_bitrates[video_playlist];
       base::StringAppendF(&video_output,
                           "#EXT-X-STREAM-INF:CODECS=\"%s\",BANDWIDTH=%" PRIu64
                           "\n%s\n",
@@ -169,6 +285,7 @@ bool MasterPlaylist::WriteMasterPlaylist(const std::string& base_url,
     return false;
   }
 
+  written_bitrates_.swap(current_bitrates);
   return true;
 }
 
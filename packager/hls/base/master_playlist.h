@@ -7,7 +7,10 @@
 #ifndef PACKAGER_HLS_BASE_MASTER_PLAYLIST_H_
 #define PACKAGER_HLS_BASE_MASTER_PLAYLIST_H_
 
+#include <stdint.h>
+
 #include <list>
+#include <map>
 #include <string>
 
 #include "packager/base/macros.h"
@@ -59,6 +62,13 @@ class MasterPlaylist {
 
   bool has_set_playlist_target_duration_ = false;
 
+  // Bandwidth of every variant at the time the master playlist was last
+  // written, keyed by variant. The master playlist is a pure function of the
+  // variant list and these values, so the rebuild and the write are skipped
+  // when they have not changed; segment-level media playlist updates then no
+  // longer republish the master.
+  std::map<const MediaPlaylist*, uint64_t> written_bitrates_;
+
   DISALLOW_COPY_AND_ASSIGN(MasterPlaylist);
 };
 
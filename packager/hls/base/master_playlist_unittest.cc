@@ -96,6 +96,31 @@ TEST_F(MasterPlaylistTest, WriteMasterPlaylistOneVideo) {
   ASSERT_EQ(expected, actual);
 }
 
+TEST_F(MasterPlaylistTest, SkipWriteIfVariantsUnchanged) {
+  std::string codec = "avc1";
+  MockMediaPlaylist mock_playlist(kVodPlaylist, "media1.m3u8", "somename",
+                                  "somegroupid");
+  mock_playlist.SetStreamTypeForTesting(
+      MediaPlaylist::MediaPlaylistStreamType::kPlayListVideo);
+  mock_playlist.SetCodecForTesting(codec);
+  EXPECT_CALL(mock_playlist, Bitrate()).WillRepeatedly(Return(435889));
+  master_playlist_.AddMediaPlaylist(&mock_playlist);
+
+  const char kBaseUrl[] = "http://myplaylistdomain.com/";
+  EXPECT_TRUE(master_playlist_.WriteMasterPlaylist(kBaseUrl, test_output_dir_));
+
+  base::FilePath master_playlist_path =
+      test_output_dir_path_.Append(kDefaultMasterPlaylistName);
+  ASSERT_TRUE(base::PathExists(master_playlist_path))
+      << "Cannot find " << master_playlist_path.value();
+
+  // With the variant list and bandwidths unchanged, another write request
+  // must not touch the file; remove it and verify it is not recreated.
+  ASSERT_TRUE(base::DeleteFile(master_playlist_path, false));
+  EXPECT_TRUE(master_playlist_.WriteMasterPlaylist(kBaseUrl, test_output_dir_));
+  EXPECT_FALSE(base::PathExists(master_playlist_path));
+}
+
 TEST_F(MasterPlaylistTest, WriteMasterPlaylistVideoAndAudio) {
   // First video, sd.m3u8.
   std::string sd_video_codec = "sdvideocodec";
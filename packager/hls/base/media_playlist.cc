@@ -10,6 +10,7 @@
 #include <cmath>
 
 #include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/stringprintf.h"
 #include "packager/media/file/file.h"
 #include "packager/version/version.h"
@@ -33,13 +34,23 @@ uint32_t GetTimeScale(const MediaInfo& media_info) {
 class SegmentInfoEntry : public HlsEntry {
  public:
   SegmentInfoEntry(const std::string& file_name, double duration);
+  // For byte range segments: the segment is |size| bytes starting at
+  // |start_byte| of |file_name|.
+  SegmentInfoEntry(const std::string& file_name,
+                   double duration,
+                   uint64_t start_byte,
+                   uint64_t size);
   ~SegmentInfoEntry() override;
 
   std::string ToString() override;
+  const std::string& file_name() const { return file_name_; }
 
  private:
   const std::string file_name_;
   const double duration_;
+  const bool use_byte_range_;
+  const uint64_t start_byte_;
+  const uint64_t size_;
 
   DISALLOW_COPY_AND_ASSIGN(SegmentInfoEntry);
 };
@@ -48,10 +59,30 @@ SegmentInfoEntry::SegmentInfoEntry(const std::string& file_name,
                                    double duration)
     : HlsEntry(HlsEntry::EntryType::kExtInf),
       file_name_(file_name),
-      duration_(duration) {}
+      duration_(duration),
+      use_byte_range_(false),
+      start_byte_(0),
+      size_(0) {}
+SegmentInfoEntry::SegmentInfoEntry(const std::string& file_name,
+                                   double duration,
+                                   uint64_t start_byte,
+                                   uint64_t size)
+    : HlsEntry(HlsEntry::EntryType::kExtInf),
+      file_name_(file_name),
+      duration_(duration),
+      use_byte_range_(true),
+      start_byte_(start_byte),
+      size_(size) {}
 SegmentInfoEntry::~SegmentInfoEntry() {}
 
 std::string SegmentInfoEntry::ToString() {
+  if (use_byte_range_) {
+    // The offset is always included so that the entry does not depend on the
+    // entry before it, e.g. when the playlist is a sliding window.
+    return base::StringPrintf("#EXTINF:%.3f,\n", duration_) +
+           "#EXT-X-BYTERANGE:" + base::Uint64ToString(size_) + "@" +
+           base::Uint64ToString(start_byte_) + "\n" + file_name_ + "\n";
+  }
   return base::StringPrintf("#EXTINF:%.3f,\n%s\n", duration_,
                             file_name_.c_str());
 }
@@ -174,7 +205,12 @@ void MediaPlaylist::AddSegment(const std::string& file_name,
     LOG(WARNING) << "Timescale is not set and the duration for " << duration
                  << " cannot be calculated. The output will be wrong.";
 
-    entries_.push_back(new SegmentInfoEntry(file_name, 0.0));
+    HlsEntry* entry = CreateSegmentInfoEntry(file_name, 0.0, size);
+    entries_.push_back(entry);
+    ++num_segments_;
+    if (body_cache_valid_)
+      body_cache_ += entry->ToString();
+    SlideWindow();
     return;
   }
 
@@ -186,26 +222,37 @@ void MediaPlaylist::AddSegment(const std::string& file_name,
   const int kBitsInByte = 8;
   const uint64_t bitrate = kBitsInByte * size / segment_duration_seconds;
   max_bitrate_ = std::max(max_bitrate_, bitrate);
-  entries_.push_back(new SegmentInfoEntry(file_name, segment_duration_seconds));
+  HlsEntry* entry =
+      CreateSegmentInfoEntry(file_name, segment_duration_seconds, size);
+  entries_.push_back(entry);
+  ++num_segments_;
+  // New segments render after everything already in the cache, so the cache
+  // stays valid; only append the new entry's bytes.
+  if (body_cache_valid_)
+    body_cache_ += entry->ToString();
+  SlideWindow();
 }
 
 // TODO(rkuroiwa): This works for single key format but won't work for multiple
 // key formats (e.g. different DRM systems).
 // Candidate algorithm:
-// Assume entries_ is std::list (static_assert below).
 // Create a map from key_format to EncryptionInfoEntry (iterator actually).
 // Iterate over entries_ until it hits SegmentInfoEntry. While iterating over
 // entries_ if there are multiple EncryptionInfoEntry with the same key_format,
 // erase the older ones using the iterator.
-// Note that when erasing std::list iterators, only the deleted iterators are
-// invalidated.
+// All the erasures happen within the first few entries, so the std::deque
+// erases (and the pop_front()s below) do not shift the whole container.
 void MediaPlaylist::RemoveOldestSegment() {
   static_assert(
-      base::is_same<decltype(entries_), std::list<HlsEntry*>>::value,
-      "This algorithm assumes std::list.");
+      base::is_same<decltype(entries_), std::deque<HlsEntry*>>::value,
+      "This algorithm assumes std::deque.");
   if (entries_.empty())
     return;
+  // Removal changes already-rendered entries (and possibly the discontinuity
+  // tag placement); rebuild the cache on the next write.
+  body_cache_valid_ = false;
   if (entries_.front()->type() == HlsEntry::EntryType::kExtInf) {
+    OnSegmentExpired(entries_.front());
     delete entries_.front();
     entries_.pop_front();
     return;
@@ -227,6 +274,7 @@ void MediaPlaylist::RemoveOldestSegment() {
       delete entries_.front();
       entries_.pop_front();
     } else {
+      OnSegmentExpired(*entries_itr);
       delete *entries_itr;
       entries_.erase(entries_itr);
     }
@@ -237,6 +285,7 @@ void MediaPlaylist::RemoveOldestSegment() {
   ++entries_itr;
   if ((*entries_itr)->type() == HlsEntry::EntryType::kExtInf) {
     DCHECK((*entries_itr)->type() == HlsEntry::EntryType::kExtInf);
+    OnSegmentExpired(*entries_itr);
     delete *entries_itr;
     entries_.erase(entries_itr);
     return;
@@ -246,12 +295,31 @@ void MediaPlaylist::RemoveOldestSegment() {
   // This assumes that there is a segment between 2 EXT-X-KEY entries.
   // Which should be the case due to logic in AddEncryptionInfo().
   DCHECK((*entries_itr)->type() == HlsEntry::EntryType::kExtInf);
+  OnSegmentExpired(*entries_itr);
   delete *entries_itr;
   entries_.erase(entries_itr);
   delete entries_.front();
   entries_.pop_front();
 }
 
+void MediaPlaylist::SetUseByteRange(bool use_byte_range) {
+  DCHECK(entries_.empty());
+  use_byte_range_ = use_byte_range;
+}
+
+void MediaPlaylist::SetMaxNumSegments(size_t max_num_segments) {
+  max_num_segments_ = max_num_segments;
+  SlideWindow();
+}
+
+void MediaPlaylist::GetRemovedSegments(
+    std::vector<std::string>* removed_segments) {
+  DCHECK(removed_segments);
+  removed_segments->insert(removed_segments->end(), removed_segments_.begin(),
+                           removed_segments_.end());
+  removed_segments_.clear();
+}
+
 void MediaPlaylist::AddEncryptionInfo(MediaPlaylist::EncryptionMethod method,
                                       const std::string& url,
                                       const std::string& iv,
@@ -266,6 +334,9 @@ void MediaPlaylist::AddEncryptionInfo(MediaPlaylist::EncryptionMethod method,
   entries_.push_back(
       new EncryptionInfoEntry(
           method, url, iv, key_format, key_format_versions));
+  // An EXT-X-KEY entry may replace the previous one and can require a
+  // discontinuity tag before it; rebuild the cache on the next write.
+  body_cache_valid_ = false;
 }
 
 bool MediaPlaylist::WriteToFile(media::File* file) {
@@ -273,41 +344,44 @@ bool MediaPlaylist::WriteToFile(media::File* file) {
     SetTargetDuration(ceil(GetLongestSegmentDuration()));
   }
 
-  const std::string version = GetPackagerVersion();
-  std::string version_line;
-  if (!version.empty()) {
-    version_line =
-        base::StringPrintf("## Generated with %s version %s\n",
-                           GetPackagerProjectUrl().c_str(), version.c_str());
-  }
+  // The target duration cannot change once written, so the header only needs
+  // to be rendered once.
+  if (header_cache_.empty()) {
+    const std::string version = GetPackagerVersion();
+    std::string version_line;
+    if (!version.empty()) {
+      version_line =
+          base::StringPrintf("## Generated with %s version %s\n",
+                             GetPackagerProjectUrl().c_str(), version.c_str());
+    }
 
-  // KEYFORMAT and KEYFORMATVERSIONS on EXT-X-KEY requires 5 or above.
-  std::string header = base::StringPrintf(
-      "#EXTM3U\n"
-      "#EXT-X-VERSION:5\n"
-      "%s"
-      "#EXT-X-TARGETDURATION:%d\n",
-      version_line.c_str(), target_duration_);
-  if (type_ == MediaPlaylistType::kVod) {
-    header += "#EXT-X-PLAYLIST-TYPE:VOD\n";
+    // KEYFORMAT and KEYFORMATVERSIONS on EXT-X-KEY requires 5 or above.
+    header_cache_ = base::StringPrintf(
+        "#EXTM3U\n"
+        "#EXT-X-VERSION:5\n"
+        "%s"
+        "#EXT-X-TARGETDURATION:%d\n",
+        version_line.c_str(), target_duration_);
+    if (type_ == MediaPlaylistType::kVod) {
+      header_cache_ += "#EXT-X-PLAYLIST-TYPE:VOD\n";
+    }
   }
 
-  std::string body;
-  if (!entries_.empty()) {
-    const bool first_is_ext_key =
-        entries_.front()->type() == HlsEntry::EntryType::kExtKey;
-    bool inserted_discontinuity_tag = false;
-    for (const auto& entry : entries_) {
-      if (!first_is_ext_key && !inserted_discontinuity_tag &&
-          entry->type() == HlsEntry::EntryType::kExtKey) {
-        body.append("#EXT-X-DISCONTINUITY\n");
-        inserted_discontinuity_tag = true;
-      }
-      body.append(entry->ToString());
-    }
+  if (!body_cache_valid_)
+    RebuildBodyCache();
+
+  std::string content = header_cache_;
+
+  // Sliding window playlists need EXT-X-MEDIA-SEQUENCE so that players can
+  // tell which segments expired. The sequence number changes as the window
+  // slides, so it cannot be part of the cached header. Not applicable to VOD
+  // playlists, which list all the segments.
+  if (type_ != MediaPlaylistType::kVod && media_sequence_number_ > 0) {
+    content += "#EXT-X-MEDIA-SEQUENCE:" +
+               base::Uint64ToString(media_sequence_number_) + "\n";
   }
 
-  std::string content = header + body;
+  content += body_cache_;
 
   if (type_ == MediaPlaylistType::kVod) {
     content += "#EXT-X-ENDLIST\n";
@@ -331,6 +405,54 @@ bool MediaPlaylist::WriteToFile(media::File* file) {
   return true;
 }
 
+void MediaPlaylist::RebuildBodyCache() {
+  body_cache_.clear();
+  if (!entries_.empty()) {
+    const bool first_is_ext_key =
+        entries_.front()->type() == HlsEntry::EntryType::kExtKey;
+    bool inserted_discontinuity_tag = false;
+    for (const auto& entry : entries_) {
+      if (!first_is_ext_key && !inserted_discontinuity_tag &&
+          entry->type() == HlsEntry::EntryType::kExtKey) {
+        body_cache_.append("#EXT-X-DISCONTINUITY\n");
+        inserted_discontinuity_tag = true;
+      }
+      body_cache_.append(entry->ToString());
+    }
+  }
+  body_cache_valid_ = true;
+}
+
+HlsEntry* MediaPlaylist::CreateSegmentInfoEntry(const std::string& file_name,
+                                                double duration,
+                                                uint64_t size) {
+  if (!use_byte_range_)
+    return new SegmentInfoEntry(file_name, duration);
+  // Segments are appended to the single media file in order, so this
+  // segment's range starts where the previous one ended.
+  SegmentInfoEntry* entry =
+      new SegmentInfoEntry(file_name, duration, next_byte_range_offset_, size);
+  next_byte_range_offset_ += size;
+  return entry;
+}
+
+void MediaPlaylist::OnSegmentExpired(HlsEntry* entry) {
+  DCHECK(entry->type() == HlsEntry::EntryType::kExtInf);
+  ++media_sequence_number_;
+  --num_segments_;
+  removed_segments_.push_back(
+      static_cast<SegmentInfoEntry*>(entry)->file_name());
+}
+
+void MediaPlaylist::SlideWindow() {
+  if (max_num_segments_ == 0)
+    return;
+  // Each iteration removes one segment; entries without segments can only
+  // exist while |num_segments_| is 0, so this terminates.
+  while (num_segments_ > max_num_segments_)
+    RemoveOldestSegment();
+}
+
 uint64_t MediaPlaylist::Bitrate() const {
   if (media_info_.has_bandwidth())
     return media_info_.bandwidth();
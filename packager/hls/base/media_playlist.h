@@ -7,8 +7,9 @@
 #ifndef PACKAGER_HLS_BASE_MEDIA_PLAYLIST_H_
 #define PACKAGER_HLS_BASE_MEDIA_PLAYLIST_H_
 
-#include <list>
+#include <deque>
 #include <string>
+#include <vector>
 
 #include "packager/base/macros.h"
 #include "packager/base/memory/scoped_ptr.h"
@@ -104,6 +105,29 @@ class MediaPlaylist {
   /// the length of the playlist.
   virtual void RemoveOldestSegment();
 
+  /// Set the maximum number of segments kept in this playlist. Once the limit
+  /// is reached, AddSegment() removes the oldest segment, and the playlist
+  /// becomes a sliding window with an EXT-X-MEDIA-SEQUENCE tag (unless this is
+  /// a VOD playlist). The default of 0 keeps all segments.
+  /// @param max_num_segments is the maximum number of segments to keep, or 0
+  ///        for no limit.
+  virtual void SetMaxNumSegments(size_t max_num_segments);
+
+  /// Makes this a byte range playlist: all the segments added with
+  /// AddSegment() are byte ranges of a single media file, appended to it in
+  /// order, and each segment entry gets an EXT-X-BYTERANGE tag. This must be
+  /// called before adding any segments.
+  /// @param use_byte_range is true to enable byte range entries.
+  virtual void SetUseByteRange(bool use_byte_range);
+
+  /// Gets the file names of the segments that have been removed from the
+  /// playlist since the last call to this method. Removed segment files must
+  /// not be deleted right away since players may still be fetching them, so
+  /// deletion is deferred to the caller.
+  /// @param removed_segments gets the file names, exactly as they were passed
+  ///        to AddSegment(), appended to it.
+  virtual void GetRemovedSegments(std::vector<std::string>* removed_segments);
+
   /// All segments added after calling this method must be decryptable with
   /// the key that can be fetched from |url|, until calling this again.
   /// @param method is the encryption method.
@@ -151,6 +175,24 @@ class MediaPlaylist {
   virtual bool SetTargetDuration(uint32_t target_duration);
 
  private:
+  // Rebuilds |body_cache_| from |entries_| and marks it valid.
+  void RebuildBodyCache();
+
+  // Creates the entry for a segment of |duration| seconds and |size| bytes,
+  // as a byte range of the single media file if byte ranges are in use.
+  HlsEntry* CreateSegmentInfoEntry(const std::string& file_name,
+                                   double duration,
+                                   uint64_t size);
+
+  // Bookkeeping for a segment entry that is about to be removed from the
+  // playlist: advances the media sequence number and queues the segment file
+  // for deletion by the caller. Does not delete |entry|.
+  void OnSegmentExpired(HlsEntry* entry);
+
+  // Removes the oldest segments until the playlist is within
+  // |max_num_segments_|. No-op if |max_num_segments_| is 0.
+  void SlideWindow();
+
   // Mainly for MasterPlaylist to use these values.
   const std::string file_name_;
   const std::string name_;
@@ -171,9 +213,36 @@ class MediaPlaylist {
   bool target_duration_set_ = false;
   uint32_t target_duration_ = 0;
 
-  std::list<HlsEntry*> entries_;
+  // Deque so that expiring aged segments from the front is constant time.
+  std::deque<HlsEntry*> entries_;
   STLElementDeleter<decltype(entries_)> entries_deleter_;
 
+  // See SetUseByteRange(). |next_byte_range_offset_| is the offset in the
+  // media file where the next segment starts.
+  bool use_byte_range_ = false;
+  uint64_t next_byte_range_offset_ = 0;
+
+  // Sliding window state. 0 means the playlist keeps all segments.
+  size_t max_num_segments_ = 0;
+  // The number of kExtInf entries in |entries_|.
+  size_t num_segments_ = 0;
+  // Sequence number of the oldest segment in the playlist, i.e. the value of
+  // EXT-X-MEDIA-SEQUENCE. Stays 0 until segments are removed.
+  uint64_t media_sequence_number_ = 0;
+  // File names of removed segments, waiting for the caller to pick them up
+  // for deletion via GetRemovedSegments().
+  std::vector<std::string> removed_segments_;
+
+  // Rendered entries, so repeated writes do not serialize the whole
+  // playlist again. AddSegment() appends to it incrementally; operations
+  // that affect already-rendered entries (segment removal, new EXT-X-KEY and
+  // its discontinuity tag) invalidate it and it is rebuilt on the next
+  // write. The header is rendered once on the first write; target duration
+  // cannot change after that.
+  std::string body_cache_;
+  bool body_cache_valid_ = true;
+  std::string header_cache_;
+
   DISALLOW_COPY_AND_ASSIGN(MediaPlaylist);
 };
 
@@ -222,6 +222,54 @@ TEST_F(MediaPlaylistTest, WriteToFileWithSegments) {
   EXPECT_TRUE(media_playlist_.WriteToFile(&file));
 }
 
+// Segments added between writes should show up in the next write, appended
+// after the already rendered ones.
+TEST_F(MediaPlaylistTest, WriteToFileAgainAfterAddingSegment) {
+  valid_video_media_info_.set_reference_time_scale(90000);
+  ASSERT_TRUE(media_playlist_.SetMediaInfo(valid_video_media_info_));
+  media_playlist_.SetTargetDuration(30);
+
+  // 10 seconds.
+  media_playlist_.AddSegment("file1.ts", 900000, 1000000);
+  const std::string kExpectedFirstOutput =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:5\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:30\n"
+      "#EXT-X-PLAYLIST-TYPE:VOD\n"
+      "#EXTINF:10.000,\n"
+      "file1.ts\n"
+      "#EXT-X-ENDLIST\n";
+
+  MockFile first_file;
+  EXPECT_CALL(first_file, Write(MatchesString(kExpectedFirstOutput),
+                                kExpectedFirstOutput.size()))
+      .WillOnce(ReturnArg<1>());
+  EXPECT_TRUE(media_playlist_.WriteToFile(&first_file));
+
+  // 30 seconds.
+  media_playlist_.AddSegment("file2.ts", 2700000, 5000000);
+  const std::string kExpectedSecondOutput =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:5\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:30\n"
+      "#EXT-X-PLAYLIST-TYPE:VOD\n"
+      "#EXTINF:10.000,\n"
+      "file1.ts\n"
+      "#EXTINF:30.000,\n"
+      "file2.ts\n"
+      "#EXT-X-ENDLIST\n";
+
+  MockFile second_file;
+  EXPECT_CALL(second_file, Write(MatchesString(kExpectedSecondOutput),
+                                 kExpectedSecondOutput.size()))
+      .WillOnce(ReturnArg<1>());
+  EXPECT_TRUE(media_playlist_.WriteToFile(&second_file));
+}
+
 TEST_F(MediaPlaylistTest, WriteToFileWithEncryptionInfo) {
   valid_video_media_info_.set_reference_time_scale(90000);
   ASSERT_TRUE(media_playlist_.SetMediaInfo(valid_video_media_info_));
@@ -352,5 +400,86 @@ TEST_F(MediaPlaylistTest, RemoveOldestSegment) {
   EXPECT_TRUE(media_playlist_.WriteToFile(&file));
 }
 
+// In byte range mode all the segments are ranges of a single media file and
+// each entry should get an EXT-X-BYTERANGE tag.
+TEST_F(MediaPlaylistTest, WriteToFileWithByteRanges) {
+  valid_video_media_info_.set_reference_time_scale(90000);
+  ASSERT_TRUE(media_playlist_.SetMediaInfo(valid_video_media_info_));
+  media_playlist_.SetUseByteRange(true);
+
+  // 10 seconds.
+  media_playlist_.AddSegment("file.ts", 900000, 1000000);
+  // 30 seconds.
+  media_playlist_.AddSegment("file.ts", 2700000, 5000000);
+  const std::string kExpectedOutput =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:5\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:30\n"
+      "#EXT-X-PLAYLIST-TYPE:VOD\n"
+      "#EXTINF:10.000,\n"
+      "#EXT-X-BYTERANGE:1000000@0\n"
+      "file.ts\n"
+      "#EXTINF:30.000,\n"
+      "#EXT-X-BYTERANGE:5000000@1000000\n"
+      "file.ts\n"
+      "#EXT-X-ENDLIST\n";
+
+  MockFile file;
+  EXPECT_CALL(file,
+              Write(MatchesString(kExpectedOutput), kExpectedOutput.size()))
+      .WillOnce(ReturnArg<1>());
+  EXPECT_TRUE(media_playlist_.WriteToFile(&file));
+}
+
+// With a maximum number of segments set, the playlist should become a sliding
+// window with an EXT-X-MEDIA-SEQUENCE tag, and the expired segments should be
+// reported for deferred deletion.
+TEST_F(MediaPlaylistTest, SlidingWindow) {
+  MediaPlaylist media_playlist(MediaPlaylist::MediaPlaylistType::kLive,
+                               default_file_name_, default_name_,
+                               default_group_id_);
+  valid_video_media_info_.set_reference_time_scale(90000);
+  ASSERT_TRUE(media_playlist.SetMediaInfo(valid_video_media_info_));
+  media_playlist.SetTargetDuration(10);
+  media_playlist.SetMaxNumSegments(2);
+
+  // 10 seconds each.
+  media_playlist.AddSegment("file1.ts", 900000, 1000000);
+  media_playlist.AddSegment("file2.ts", 900000, 1000000);
+  media_playlist.AddSegment("file3.ts", 900000, 1000000);
+  media_playlist.AddSegment("file4.ts", 900000, 1000000);
+
+  const std::string kExpectedOutput =
+      "#EXTM3U\n"
+      "#EXT-X-VERSION:5\n"
+      "## Generated with https://github.com/google/shaka-packager version "
+      "test\n"
+      "#EXT-X-TARGETDURATION:10\n"
+      "#EXT-X-MEDIA-SEQUENCE:2\n"
+      "#EXTINF:10.000,\n"
+      "file3.ts\n"
+      "#EXTINF:10.000,\n"
+      "file4.ts\n";
+
+  MockFile file;
+  EXPECT_CALL(file,
+              Write(MatchesString(kExpectedOutput), kExpectedOutput.size()))
+      .WillOnce(ReturnArg<1>());
+  EXPECT_TRUE(media_playlist.WriteToFile(&file));
+
+  std::vector<std::string> removed_segments;
+  media_playlist.GetRemovedSegments(&removed_segments);
+  ASSERT_EQ(2u, removed_segments.size());
+  EXPECT_EQ("file1.ts", removed_segments[0]);
+  EXPECT_EQ("file2.ts", removed_segments[1]);
+
+  // Should only return segments removed since the last call.
+  removed_segments.clear();
+  media_playlist.GetRemovedSegments(&removed_segments);
+  EXPECT_TRUE(removed_segments.empty());
+}
+
 }  // namespace hls
 }  // namespace shaka
@@ -30,6 +30,10 @@ class MockMediaPlaylist : public MediaPlaylist {
                     uint64_t duration,
                     uint64_t size));
   MOCK_METHOD0(RemoveOldestSegment, void());
+  MOCK_METHOD1(SetMaxNumSegments, void(size_t max_num_segments));
+  MOCK_METHOD1(SetUseByteRange, void(bool use_byte_range));
+  MOCK_METHOD1(GetRemovedSegments,
+               void(std::vector<std::string>* removed_segments));
   MOCK_METHOD5(AddEncryptionInfo,
                void(EncryptionMethod method,
                     const std::string& url,
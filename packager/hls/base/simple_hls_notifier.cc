@@ -6,7 +6,7 @@
 
 #include "packager/hls/base/simple_hls_notifier.h"
 
-#include "packager/base/base64.h"
+#include "packager/base/bind.h"
 #include "packager/base/files/file_path.h"
 #include "packager/base/json/json_writer.h"
 #include "packager/base/logging.h"
@@ -14,6 +14,7 @@
 #include "packager/base/strings/stringprintf.h"
 #include "packager/hls/base/media_playlist.h"
 #include "packager/media/base/fixed_key_source.h"
+#include "packager/media/base/hex_base64.h"
 #include "packager/media/base/widevine_key_source.h"
 #include "packager/media/base/widevine_pssh_data.pb.h"
 
@@ -86,20 +87,19 @@ bool WidevinePsshToJson(const std::vector<uint8_t>& pssh_data,
   base::DictionaryValue pssh_dict;
   pssh_dict.SetString("provider", pssh_proto.provider());
   if (pssh_proto.has_content_id()) {
-    std::string content_id_base64;
-    base::Base64Encode(base::StringPiece(pssh_proto.content_id().data(),
-                                         pssh_proto.content_id().size()),
-                       &content_id_base64);
-    pssh_dict.SetString("content_id", content_id_base64);
+    pssh_dict.SetString(
+        "content_id",
+        media::Base64EncodeFast(pssh_proto.content_id().data(),
+                                pssh_proto.content_id().size()));
   }
   base::ListValue* key_ids = new base::ListValue();
-  key_ids->AppendString(base::HexEncode(key_id.data(), key_id.size()));
+  key_ids->AppendString(media::HexEncodeFast(key_id.data(), key_id.size()));
   for (const std::string& id : pssh_proto.key_id()) {
     if (key_id.size() == id.size() &&
         memcmp(key_id.data(), id.data(), id.size()) == 0) {
       continue;
     }
-    key_ids->AppendString(base::HexEncode(id.data(), id.size()));
+    key_ids->AppendString(media::HexEncodeFast(id.data(), id.size()));
   }
   pssh_dict.Set("key_ids", key_ids);
 
@@ -132,9 +132,21 @@ SimpleHlsNotifier::SimpleHlsNotifier(HlsProfile profile,
       output_dir_(output_dir),
       media_playlist_factory_(new MediaPlaylistFactory()),
       master_playlist_(new MasterPlaylist(master_playlist_name)),
-      media_playlist_map_deleter_(&media_playlist_map_) {}
+      media_playlist_map_deleter_(&media_playlist_map_),
+      queue_cv_(&queue_lock_),
+      processing_segments_(false),
+      segment_thread_exit_(false) {}
 
-SimpleHlsNotifier::~SimpleHlsNotifier() {}
+SimpleHlsNotifier::~SimpleHlsNotifier() {
+  {
+    base::AutoLock auto_lock(queue_lock_);
+    segment_thread_exit_ = true;
+    queue_cv_.Broadcast();
+  }
+  // The thread applies any queued segments before it exits.
+  if (segment_thread_)
+    segment_thread_->Join();
+}
 
 bool SimpleHlsNotifier::Init() {
   return true;
@@ -170,6 +182,13 @@ bool SimpleHlsNotifier::NotifyNewStream(const MediaInfo& media_info,
     return false;
   }
 
+  // Without a segment template the muxer appends every segment to the single
+  // media file, so the playlist refers to the segments by byte range.
+  if (adjusted_media_info.has_media_file_name() &&
+      !adjusted_media_info.has_segment_template()) {
+    media_playlist->SetUseByteRange(true);
+  }
+
   *stream_id = sequence_number_.GetNext();
   base::AutoLock auto_lock(lock_);
   master_playlist_->AddMediaPlaylist(media_playlist.get());
@@ -183,20 +202,68 @@ bool SimpleHlsNotifier::NotifyNewSegment(uint32_t stream_id,
                                          uint64_t start_time,
                                          uint64_t duration,
                                          uint64_t size) {
-  base::AutoLock auto_lock(lock_);
-  auto result = media_playlist_map_.find(stream_id);
-  if (result == media_playlist_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
-    return false;
+  {
+    base::AutoLock auto_lock(lock_);
+    if (media_playlist_map_.find(stream_id) == media_playlist_map_.end()) {
+      LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+      return false;
+    }
   }
-  const std::string relative_segment_name =
-      MakePathRelative(segment_name, output_dir_);
 
-  auto& media_playlist = result->second;
-  media_playlist->AddSegment(prefix_ + relative_segment_name, duration, size);
+  SegmentNotification notification;
+  notification.stream_id = stream_id;
+  notification.segment_name = segment_name;
+  notification.duration = duration;
+  notification.size = size;
+
+  base::AutoLock auto_lock(queue_lock_);
+  pending_segments_.push_back(notification);
+  if (!segment_thread_) {
+    segment_thread_.reset(new media::ClosureThread(
+        "HlsSegmentThread", base::Bind(&SimpleHlsNotifier::SegmentThreadMain,
+                                       base::Unretained(this))));
+    segment_thread_->Start();
+  }
+  queue_cv_.Broadcast();
   return true;
 }
 
+void SimpleHlsNotifier::SegmentThreadMain() {
+  base::AutoLock auto_lock(queue_lock_);
+  for (;;) {
+    while (pending_segments_.empty() && !segment_thread_exit_)
+      queue_cv_.Wait();
+    if (pending_segments_.empty()) {
+      DCHECK(segment_thread_exit_);
+      return;
+    }
+
+    std::deque<SegmentNotification> batch;
+    batch.swap(pending_segments_);
+    processing_segments_ = true;
+    {
+      base::AutoUnlock auto_unlock(queue_lock_);
+      base::AutoLock playlist_lock(lock_);
+      for (const SegmentNotification& notification : batch) {
+        auto result = media_playlist_map_.find(notification.stream_id);
+        if (result == media_playlist_map_.end()) {
+          // NotifyNewSegment() verified the ID and playlists are never
+          // removed from the map.
+          NOTREACHED() << "Cannot find stream with ID: "
+                       << notification.stream_id;
+          continue;
+        }
+        const std::string relative_segment_name =
+            MakePathRelative(notification.segment_name, output_dir_);
+        result->second->AddSegment(prefix_ + relative_segment_name,
+                                   notification.duration, notification.size);
+      }
+    }
+    processing_segments_ = false;
+    queue_cv_.Broadcast();
+  }
+}
+
 bool SimpleHlsNotifier::NotifyEncryptionUpdate(
     uint32_t stream_id,
     const std::vector<uint8_t>& key_id,
@@ -232,10 +299,12 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
   auto& media_playlist = result->second;
   std::string iv_string;
   if (!iv.empty()) {
-    iv_string = "0x" + base::HexEncode(iv.data(), iv.size());
+    iv_string = "0x" + media::HexEncodeFast(iv.data(), iv.size());
   }
-  std::string key_uri_data_base64;
-  base::Base64Encode(key_uri_data, &key_uri_data_base64);
+  // The rotated key changes on every update, so caching would only churn the
+  // encode cache; use the plain fast path.
+  const std::string key_uri_data_base64 =
+      media::Base64EncodeFast(key_uri_data.data(), key_uri_data.size());
   media_playlist->AddEncryptionInfo(
       MediaPlaylist::EncryptionMethod::kSampleAes,
       "data:text/plain;base64," + key_uri_data_base64, iv_string, key_format,
@@ -244,6 +313,12 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
 }
 
 bool SimpleHlsNotifier::Flush() {
+  {
+    // The playlists must include every segment notified before this call.
+    base::AutoLock auto_lock(queue_lock_);
+    while (!pending_segments_.empty() || processing_segments_)
+      queue_cv_.Wait();
+  }
   base::AutoLock auto_lock(lock_);
   return master_playlist_->WriteAllPlaylists(prefix_, output_dir_);
 }
@@ -7,6 +7,7 @@
 #ifndef PACKAGER_HLS_BASE_SIMPLE_HLS_NOTIFIER_H_
 #define PACKAGER_HLS_BASE_SIMPLE_HLS_NOTIFIER_H_
 
+#include <deque>
 #include <map>
 #include <string>
 #include <vector>
@@ -15,10 +16,12 @@
 #include "packager/base/macros.h"
 #include "packager/base/memory/scoped_ptr.h"
 #include "packager/base/stl_util.h"
+#include "packager/base/synchronization/condition_variable.h"
 #include "packager/base/synchronization/lock.h"
 #include "packager/hls/base/hls_notifier.h"
 #include "packager/hls/base/master_playlist.h"
 #include "packager/hls/base/media_playlist.h"
+#include "packager/media/base/closure_thread.h"
 
 namespace shaka {
 namespace hls {
@@ -77,6 +80,20 @@ class SimpleHlsNotifier : public HlsNotifier {
  private:
   friend class SimpleHlsNotifierTest;
 
+  // A NotifyNewSegment() call waiting to be applied to its media playlist by
+  // |segment_thread_|.
+  struct SegmentNotification {
+    uint32_t stream_id;
+    std::string segment_name;
+    uint64_t duration;
+    uint64_t size;
+  };
+
+  // Drains |pending_segments_| in batches until destruction. Each batch is
+  // applied to the playlists under |lock_| in one go, so concurrent muxer
+  // threads do not take turns on the lock per segment.
+  void SegmentThreadMain();
+
   const std::string prefix_;
   const std::string output_dir_;
 
@@ -89,6 +106,18 @@ class SimpleHlsNotifier : public HlsNotifier {
 
   base::Lock lock_;
 
+  // Applies queued segment notifications to the media playlists so that
+  // NotifyNewSegment() does not block on playlist updates for other streams.
+  // Lazily started by the first NotifyNewSegment() call.
+  scoped_ptr<media::ClosureThread> segment_thread_;
+  // Guards the members below. Signaled when a segment is queued, when a batch
+  // has been applied, and at destruction.
+  base::Lock queue_lock_;
+  base::ConditionVariable queue_cv_;
+  std::deque<SegmentNotification> pending_segments_;
+  bool processing_segments_;
+  bool segment_thread_exit_;
+
   DISALLOW_COPY_AND_ASSIGN(SimpleHlsNotifier);
 };
 
@@ -316,6 +316,44 @@ TEST_F(SimpleHlsNotifierTest, NotifyNewSegment) {
                                          kDuration, kSize));
 }
 
+// Segments are applied to the playlists asynchronously; Flush() must not
+// write the playlists until every queued segment has been applied.
+TEST_F(SimpleHlsNotifierTest, FlushWaitsForNotifiedSegments) {
+  scoped_ptr<MockMasterPlaylist> mock_master_playlist(new MockMasterPlaylist());
+  scoped_ptr<MockMediaPlaylistFactory> factory(new MockMediaPlaylistFactory());
+
+  // Pointer released by SimpleHlsNotifier.
+  MockMediaPlaylist* mock_media_playlist =
+      new MockMediaPlaylist(kVodPlaylist, "", "", "");
+
+  EXPECT_CALL(
+      *mock_master_playlist,
+      AddMediaPlaylist(static_cast<MediaPlaylist*>(mock_media_playlist)));
+  EXPECT_CALL(*mock_media_playlist, SetMediaInfo(_)).WillOnce(Return(true));
+  EXPECT_CALL(*factory, CreateMock(_, _, _, _))
+      .WillOnce(Return(mock_media_playlist));
+
+  ::testing::InSequence in_sequence;
+  EXPECT_CALL(*mock_media_playlist, AddSegment(_, _, _)).Times(2);
+  EXPECT_CALL(*mock_master_playlist,
+              WriteAllPlaylists(StrEq(kTestPrefix), StrEq(kAnyOutputDir)))
+      .WillOnce(Return(true));
+
+  InjectMasterPlaylist(mock_master_playlist.Pass());
+  InjectMediaPlaylistFactory(factory.Pass());
+  EXPECT_TRUE(notifier_.Init());
+  MediaInfo media_info;
+  uint32_t stream_id;
+  EXPECT_TRUE(notifier_.NotifyNewStream(media_info, "playlist.m3u8", "name",
+                                        "groupid", &stream_id));
+
+  EXPECT_TRUE(notifier_.NotifyNewSegment(stream_id, "segment1.ts",
+                                         kAnyStartTime, 1000u, 2000u));
+  EXPECT_TRUE(notifier_.NotifyNewSegment(stream_id, "segment2.ts",
+                                         kAnyStartTime, 1000u, 2000u));
+  EXPECT_TRUE(notifier_.Flush());
+}
+
 TEST_F(SimpleHlsNotifierTest, NotifyNewSegmentWithoutStreamsRegistered) {
   EXPECT_TRUE(notifier_.Init());
   EXPECT_FALSE(notifier_.NotifyNewSegment(1u, "anything", 0u, 0u, 0u));
@@ -0,0 +1,233 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/aes_crypto_backend.h"
+
+#include <openssl/aes.h>
+#include <openssl/evp.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+AesCryptoBackend::Factory g_backend_factory = NULL;
+
+// Upper bound for one EVP_*Update call, keeping the length within the int
+// range the EVP interface takes.
+const size_t kMaxBytesPerEvpCall = 1 << 28;
+
+// The default backend: the key schedule for single-block operations via the
+// OpenSSL AES interface; CTR and CBC via the EVP interface, which dispatches
+// to hardware-pipelined implementations where available.
+class OpensslAesCryptoBackend : public AesCryptoBackend {
+ public:
+  OpensslAesCryptoBackend()
+      : ctr_initialized_(false),
+        cbc_encrypt_initialized_(false),
+        cbc_decrypt_initialized_(false) {
+    EVP_CIPHER_CTX_init(&ctr_ctx_);
+    EVP_CIPHER_CTX_init(&cbc_encrypt_ctx_);
+    EVP_CIPHER_CTX_init(&cbc_decrypt_ctx_);
+  }
+
+  ~OpensslAesCryptoBackend() override {
+    EVP_CIPHER_CTX_cleanup(&ctr_ctx_);
+    EVP_CIPHER_CTX_cleanup(&cbc_encrypt_ctx_);
+    EVP_CIPHER_CTX_cleanup(&cbc_decrypt_ctx_);
+  }
+
+  bool SetEncryptKey(const std::vector<uint8_t>& key) override {
+    if (AES_set_encrypt_key(key.data(), key.size() * 8, &aes_key_) != 0) {
+      LOG(ERROR) << "Invalid AES key size: " << key.size();
+      return false;
+    }
+
+    const EVP_CIPHER* ctr_cipher = NULL;
+    switch (key.size()) {
+      case 16:
+        ctr_cipher = EVP_aes_128_ctr();
+        break;
+      case 24:
+        ctr_cipher = EVP_aes_192_ctr();
+        break;
+      case 32:
+        ctr_cipher = EVP_aes_256_ctr();
+        break;
+      default:
+        NOTREACHED() << "Invalid AES key size: " << key.size();
+        return false;
+    }
+    if (!EVP_EncryptInit_ex(&ctr_ctx_, ctr_cipher, NULL, key.data(), NULL)) {
+      LOG(ERROR) << "Failed to initialize AES-CTR cipher.";
+      return false;
+    }
+    ctr_initialized_ = true;
+
+    // The cryptor layer does its own padding, so the CBC cipher runs with
+    // padding disabled and sees whole blocks only.
+    if (!EVP_EncryptInit_ex(&cbc_encrypt_ctx_, CbcCipherForKeySize(key.size()),
+                            NULL, key.data(), NULL) ||
+        !EVP_CIPHER_CTX_set_padding(&cbc_encrypt_ctx_, 0)) {
+      LOG(ERROR) << "Failed to initialize AES-CBC cipher.";
+      return false;
+    }
+    cbc_encrypt_initialized_ = true;
+    return true;
+  }
+
+  bool SetDecryptKey(const std::vector<uint8_t>& key) override {
+    const EVP_CIPHER* cbc_cipher = CbcCipherForKeySize(key.size());
+    if (!cbc_cipher) {
+      LOG(ERROR) << "Invalid AES key size: " << key.size();
+      return false;
+    }
+    if (!EVP_DecryptInit_ex(&cbc_decrypt_ctx_, cbc_cipher, NULL, key.data(),
+                            NULL) ||
+        !EVP_CIPHER_CTX_set_padding(&cbc_decrypt_ctx_, 0)) {
+      LOG(ERROR) << "Failed to initialize AES-CBC cipher.";
+      return false;
+    }
+    cbc_decrypt_initialized_ = true;
+    return true;
+  }
+
+  bool EncryptBlock(const uint8_t* in, uint8_t* out) override {
+    AES_encrypt(in, out, &aes_key_);
+    return true;
+  }
+
+  bool CtrCrypt(const CtrRequest& request) override {
+    DCHECK(ctr_initialized_);
+    DCHECK_EQ(0u, request.size % AES_BLOCK_SIZE);
+    // Load the request's counter into the cipher; it keeps its own copy.
+    if (!EVP_EncryptInit_ex(&ctr_ctx_, NULL, NULL, NULL, request.counter)) {
+      LOG(ERROR) << "Failed to set AES-CTR counter.";
+      return false;
+    }
+    int crypt_size = 0;
+    if (!EVP_EncryptUpdate(&ctr_ctx_, request.out, &crypt_size, request.in,
+                           static_cast<int>(request.size))) {
+      LOG(ERROR) << "AES-CTR encryption failed.";
+      return false;
+    }
+    return static_cast<size_t>(crypt_size) == request.size;
+  }
+
+  bool CbcEncrypt(const uint8_t* in,
+                  size_t size,
+                  uint8_t* chain_iv,
+                  uint8_t* out) override {
+    DCHECK(cbc_encrypt_initialized_);
+    DCHECK_EQ(0u, size % AES_BLOCK_SIZE);
+    if (size == 0)
+      return true;
+    if (!EVP_EncryptInit_ex(&cbc_encrypt_ctx_, NULL, NULL, NULL, chain_iv)) {
+      LOG(ERROR) << "Failed to set AES-CBC iv.";
+      return false;
+    }
+    for (size_t offset = 0; offset < size;) {
+      const size_t chunk_size = std::min(size - offset, kMaxBytesPerEvpCall);
+      int crypt_size = 0;
+      if (!EVP_EncryptUpdate(&cbc_encrypt_ctx_, out + offset, &crypt_size,
+                             in + offset, static_cast<int>(chunk_size)) ||
+          static_cast<size_t>(crypt_size) != chunk_size) {
+        LOG(ERROR) << "AES-CBC encryption failed.";
+        return false;
+      }
+      offset += chunk_size;
+    }
+    // The next chaining iv is the last ciphertext block.
+    memcpy(chain_iv, out + size - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+    return true;
+  }
+
+  bool CbcDecrypt(const uint8_t* in,
+                  size_t size,
+                  uint8_t* chain_iv,
+                  uint8_t* out) override {
+    DCHECK(cbc_decrypt_initialized_);
+    DCHECK_EQ(0u, size % AES_BLOCK_SIZE);
+    if (size == 0)
+      return true;
+    // The next chaining iv is the last ciphertext block; capture it before
+    // decrypting as |in| and |out| may alias.
+    uint8_t next_iv[AES_BLOCK_SIZE];
+    memcpy(next_iv, in + size - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+    if (!EVP_DecryptInit_ex(&cbc_decrypt_ctx_, NULL, NULL, NULL, chain_iv)) {
+      LOG(ERROR) << "Failed to set AES-CBC iv.";
+      return false;
+    }
+    for (size_t offset = 0; offset < size;) {
+      const size_t chunk_size = std::min(size - offset, kMaxBytesPerEvpCall);
+      int crypt_size = 0;
+      if (!EVP_DecryptUpdate(&cbc_decrypt_ctx_, out + offset, &crypt_size,
+                             in + offset, static_cast<int>(chunk_size)) ||
+          static_cast<size_t>(crypt_size) != chunk_size) {
+        LOG(ERROR) << "AES-CBC decryption failed.";
+        return false;
+      }
+      offset += chunk_size;
+    }
+    memcpy(chain_iv, next_iv, AES_BLOCK_SIZE);
+    return true;
+  }
+
+ private:
+  static const EVP_CIPHER* CbcCipherForKeySize(size_t key_size) {
+    switch (key_size) {
+      case 16:
+        return EVP_aes_128_cbc();
+      case 24:
+        return EVP_aes_192_cbc();
+      case 32:
+        return EVP_aes_256_cbc();
+      default:
+        return NULL;
+    }
+  }
+
+  AES_KEY aes_key_;
+  EVP_CIPHER_CTX ctr_ctx_;
+  EVP_CIPHER_CTX cbc_encrypt_ctx_;
+  EVP_CIPHER_CTX cbc_decrypt_ctx_;
+  bool ctr_initialized_;
+  bool cbc_encrypt_initialized_;
+  bool cbc_decrypt_initialized_;
+
+  DISALLOW_COPY_AND_ASSIGN(OpensslAesCryptoBackend);
+};
+
+}  // namespace
+
+AesCryptoBackend::AesCryptoBackend() {}
+AesCryptoBackend::~AesCryptoBackend() {}
+
+scoped_ptr<AesCryptoBackend> AesCryptoBackend::Create() {
+  if (g_backend_factory)
+    return g_backend_factory();
+  return scoped_ptr<AesCryptoBackend>(new OpensslAesCryptoBackend);
+}
+
+void AesCryptoBackend::SetFactory(Factory factory) {
+  g_backend_factory = factory;
+}
+
+bool AesCryptoBackend::CtrCryptBatch(const CtrRequest* requests,
+                                     size_t num_requests) {
+  for (size_t i = 0; i < num_requests; ++i) {
+    if (!CtrCrypt(requests[i]))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,106 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_AES_CRYPTO_BACKEND_H_
+#define PACKAGER_MEDIA_BASE_AES_CRYPTO_BACKEND_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/base/memory/scoped_ptr.h"
+
+namespace shaka {
+namespace media {
+
+/// Engine-level AES primitives behind the AesCryptor implementations. The
+/// default backend uses OpenSSL; deployments where another engine performs
+/// better for bulk ciphering (kernel AF_ALG, hardware offload) can install
+/// their own backend via SetFactory() at process startup. Subsample framing,
+/// iv sequencing and padding stay in the AesCryptor classes; a backend only
+/// sees whole-block bulk operations.
+///
+/// A backend instance belongs to a single cryptor and is not thread safe;
+/// concurrent encryption uses one cryptor (and thus one backend) per worker.
+class AesCryptoBackend {
+ public:
+  /// One bulk AES-CTR operation. Requests within a batch are independent:
+  /// each carries its own 16-byte counter block and the backend may process
+  /// them in any order or concurrently.
+  struct CtrRequest {
+    const uint8_t* in;
+    uint8_t* out;
+    /// Size in bytes; must be a multiple of the AES block size.
+    size_t size;
+    /// The 16-byte counter block for the first block of @a in. Not updated;
+    /// the caller tracks counter advancement.
+    const uint8_t* counter;
+  };
+
+  typedef scoped_ptr<AesCryptoBackend> (*Factory)();
+
+  virtual ~AesCryptoBackend();
+
+  /// Create a backend using the installed factory, or the default OpenSSL
+  /// backend if no factory has been installed.
+  static scoped_ptr<AesCryptoBackend> Create();
+
+  /// Install @a factory as the source of all subsequently created backends.
+  /// Pass NULL to restore the default OpenSSL backend. Not thread safe;
+  /// intended to be called once during process startup.
+  static void SetFactory(Factory factory);
+
+  /// Set the AES key for encryption operations (EncryptBlock, CtrCrypt and
+  /// CbcEncrypt). @a key must be 16, 24 or 32 bytes.
+  /// @return true on success, false otherwise.
+  virtual bool SetEncryptKey(const std::vector<uint8_t>& key) = 0;
+
+  /// Set the AES key for CbcDecrypt. @a key must be 16, 24 or 32 bytes.
+  /// @return true on success, false otherwise.
+  virtual bool SetDecryptKey(const std::vector<uint8_t>& key) = 0;
+
+  /// Encrypt a single 16-byte block, e.g. to generate the keystream for a
+  /// partial counter-mode block. @a in and @a out may alias.
+  virtual bool EncryptBlock(const uint8_t* in, uint8_t* out) = 0;
+
+  /// Perform one bulk AES-CTR operation (identical for encryption and
+  /// decryption). @a request.in and @a request.out may alias.
+  virtual bool CtrCrypt(const CtrRequest& request) = 0;
+
+  /// Perform @a num_requests independent AES-CTR operations. The base
+  /// implementation simply loops over CtrCrypt(); offload backends should
+  /// override it to submit the whole batch to the engine at once.
+  /// @return true if all requests succeeded, false otherwise.
+  virtual bool CtrCryptBatch(const CtrRequest* requests, size_t num_requests);
+
+  /// AES-CBC encrypt @a size bytes (a multiple of the AES block size) from
+  /// @a in to @a out. @a chain_iv points to the 16-byte chaining iv and is
+  /// updated in place so chaining continues across calls.
+  virtual bool CbcEncrypt(const uint8_t* in,
+                          size_t size,
+                          uint8_t* chain_iv,
+                          uint8_t* out) = 0;
+
+  /// AES-CBC decrypt @a size bytes (a multiple of the AES block size) from
+  /// @a in to @a out. @a chain_iv points to the 16-byte chaining iv and is
+  /// updated in place so chaining continues across calls.
+  virtual bool CbcDecrypt(const uint8_t* in,
+                          size_t size,
+                          uint8_t* chain_iv,
+                          uint8_t* out) = 0;
+
+ protected:
+  AesCryptoBackend();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(AesCryptoBackend);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_AES_CRYPTO_BACKEND_H_
@@ -30,7 +30,7 @@ namespace shaka {
 namespace media {
 
 AesCryptor::AesCryptor(ConstantIvFlag constant_iv_flag)
-    : aes_key_(new AES_KEY),
+    : backend_(AesCryptoBackend::Create()),
       constant_iv_flag_(constant_iv_flag),
       num_crypt_bytes_(0) {}
 
@@ -12,11 +12,9 @@
 
 #include "packager/base/macros.h"
 #include "packager/base/memory/scoped_ptr.h"
+#include "packager/media/base/aes_crypto_backend.h"
 #include "packager/media/base/fourccs.h"
 
-struct aes_key_st;
-typedef struct aes_key_st AES_KEY;
-
 namespace shaka {
 namespace media {
 
@@ -77,6 +75,16 @@ class AesCryptor {
   /// This is used by encryptors only. It is a NOP if using kUseConstantIv.
   void UpdateIv();
 
+  /// Update IV for next sample as if @a num_crypt_bytes bytes had been
+  /// encrypted by this cryptor with the current iv. This is useful when the
+  /// actual encryption is delegated to other cryptors, e.g. when samples are
+  /// encrypted in parallel, while this cryptor remains the source of the
+  /// per-sample iv sequence. It is a NOP if using kUseConstantIv.
+  void AdvanceIv(size_t num_crypt_bytes) {
+    num_crypt_bytes_ += num_crypt_bytes;
+    UpdateIv();
+  }
+
   /// @return The current iv.
   const std::vector<uint8_t>& iv() const { return iv_; }
 
@@ -91,8 +99,8 @@ class AesCryptor {
                                std::vector<uint8_t>* iv);
 
  protected:
-  const AES_KEY* aes_key() const { return aes_key_.get(); }
-  AES_KEY* mutable_aes_key() { return aes_key_.get(); }
+  /// The engine performing the bulk cipher work for this cryptor.
+  AesCryptoBackend* backend() { return backend_.get(); }
 
  private:
   // Internal implementation of crypt function.
@@ -118,8 +126,8 @@ class AesCryptor {
   // Note: No paddings should be needed except for pkcs5-cbc encryptor.
   virtual size_t NumPaddingBytes(size_t size) const;
 
-  // Openssl AES_KEY.
-  scoped_ptr<AES_KEY> aes_key_;
+  // Engine backing the bulk cipher operations; see AesCryptoBackend.
+  scoped_ptr<AesCryptoBackend> backend_;
 
   // Indicates whether a constant iv is used. Internal iv will be reset to
   // |iv_| before calling Crypt if that is the case.
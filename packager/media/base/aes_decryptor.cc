@@ -44,8 +44,8 @@ bool AesCbcDecryptor::InitializeWithIv(const std::vector<uint8_t>& key,
     return false;
   }
 
-  CHECK_EQ(AES_set_decrypt_key(key.data(), key.size() * 8, mutable_aes_key()),
-           0);
+  if (!backend()->SetDecryptKey(key))
+    return false;
   return SetIv(iv);
 }
 
@@ -54,7 +54,7 @@ bool AesCbcDecryptor::CryptInternal(const uint8_t* ciphertext,
                                     uint8_t* plaintext,
                                     size_t* plaintext_size) {
   DCHECK(plaintext_size);
-  DCHECK(aes_key());
+  DCHECK(backend());
   // Plaintext size is the same as ciphertext size except for pkcs5 padding.
   // Will update later if using pkcs5 padding. For pkcs5 padding, we still
   // need at least |ciphertext_size| bytes for intermediate operation.
@@ -78,8 +78,10 @@ bool AesCbcDecryptor::CryptInternal(const uint8_t* ciphertext,
   const size_t residual_block_size = ciphertext_size % AES_BLOCK_SIZE;
   const size_t cbc_size = ciphertext_size - residual_block_size;
   if (residual_block_size == 0) {
-    AES_cbc_encrypt(ciphertext, plaintext, ciphertext_size, aes_key(),
-                    internal_iv_.data(), AES_DECRYPT);
+    if (!backend()->CbcDecrypt(ciphertext, ciphertext_size,
+                               internal_iv_.data(), plaintext)) {
+      return false;
+    }
     if (padding_scheme_ != kPkcs5Padding)
       return true;
 
@@ -93,8 +95,10 @@ bool AesCbcDecryptor::CryptInternal(const uint8_t* ciphertext,
     *plaintext_size -= num_padding_bytes;
     return true;
   } else if (padding_scheme_ == kNoPadding) {
-    AES_cbc_encrypt(ciphertext, plaintext, cbc_size, aes_key(),
-                    internal_iv_.data(), AES_DECRYPT);
+    if (!backend()->CbcDecrypt(ciphertext, cbc_size, internal_iv_.data(),
+                               plaintext)) {
+      return false;
+    }
 
     // The residual block is not encrypted.
     memcpy(plaintext + cbc_size, ciphertext + cbc_size, residual_block_size);
@@ -114,8 +118,10 @@ bool AesCbcDecryptor::CryptInternal(const uint8_t* ciphertext,
 
   // AES-CBC decrypt everything up to the next-to-last full block.
   if (cbc_size > AES_BLOCK_SIZE) {
-    AES_cbc_encrypt(ciphertext, plaintext, cbc_size - AES_BLOCK_SIZE, aes_key(),
-                    internal_iv_.data(), AES_DECRYPT);
+    if (!backend()->CbcDecrypt(ciphertext, cbc_size - AES_BLOCK_SIZE,
+                               internal_iv_.data(), plaintext)) {
+      return false;
+    }
   }
 
   const uint8_t* next_to_last_ciphertext_block =
@@ -132,8 +138,10 @@ bool AesCbcDecryptor::CryptInternal(const uint8_t* ciphertext,
 
   // Decrypt the next-to-last block using the IV determined above. This decrypts
   // the residual block bits.
-  AES_cbc_encrypt(next_to_last_ciphertext_block, next_to_last_plaintext_block,
-                  AES_BLOCK_SIZE, aes_key(), last_iv.data(), AES_DECRYPT);
+  if (!backend()->CbcDecrypt(next_to_last_ciphertext_block, AES_BLOCK_SIZE,
+                             last_iv.data(), next_to_last_plaintext_block)) {
+    return false;
+  }
 
   // Swap back the residual block bits and the next-to-last block.
   if (plaintext == ciphertext) {
@@ -148,8 +156,11 @@ bool AesCbcDecryptor::CryptInternal(const uint8_t* ciphertext,
   }
 
   // Decrypt the next-to-last full block.
-  AES_cbc_encrypt(next_to_last_plaintext_block, next_to_last_plaintext_block,
-                  AES_BLOCK_SIZE, aes_key(), internal_iv_.data(), AES_DECRYPT);
+  if (!backend()->CbcDecrypt(next_to_last_plaintext_block, AES_BLOCK_SIZE,
+                             internal_iv_.data(),
+                             next_to_last_plaintext_block)) {
+    return false;
+  }
   return true;
 }
 
@@ -4,7 +4,7 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 //
-// AES Decryptor implementation using openssl.
+// AES Decryptor implementation on top of AesCryptoBackend.
 
 #ifndef PACKAGER_MEDIA_BASE_AES_DECRYPTOR_H_
 #define PACKAGER_MEDIA_BASE_AES_DECRYPTOR_H_
@@ -8,6 +8,8 @@
 
 #include <openssl/aes.h>
 
+#include <algorithm>
+
 #include "packager/base/logging.h"
 
 namespace {
@@ -22,6 +24,27 @@ bool Increment64(uint8_t* counter) {
   return true;
 }
 
+// Read an 8-byte counter kept in network byte order.
+uint64_t ReadCounter64(const uint8_t* counter) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i)
+    value = (value << 8) | counter[i];
+  return value;
+}
+
+// Write an 8-byte counter in network byte order.
+void WriteCounter64(uint64_t value, uint8_t* counter) {
+  for (int i = 7; i >= 0; --i) {
+    counter[i] = static_cast<uint8_t>(value & 0xff);
+    value >>= 8;
+  }
+}
+
+// Upper bound for a single batched cipher call. Keeps the length within the
+// int range the EVP interface takes; 256MB per call is far beyond any
+// subsample we see in practice.
+const uint64_t kMaxBlocksPerBatch = 1 << 24;
+
 // AES defines three key sizes: 128, 192 and 256 bits.
 bool IsKeySizeValidForAes(size_t key_size) {
   return key_size == 16 || key_size == 24 || key_size == 32;
@@ -43,8 +66,8 @@ bool AesEncryptor::InitializeWithIv(const std::vector<uint8_t>& key,
     return false;
   }
 
-  CHECK_EQ(AES_set_encrypt_key(key.data(), key.size() * 8, mutable_aes_key()),
-           0);
+  if (!backend()->SetEncryptKey(key))
+    return false;
   return SetIv(iv);
 }
 
@@ -57,14 +80,13 @@ AesCtrEncryptor::AesCtrEncryptor()
 
 AesCtrEncryptor::~AesCtrEncryptor() {}
 
-
 bool AesCtrEncryptor::CryptInternal(const uint8_t* plaintext,
                                     size_t plaintext_size,
                                     uint8_t* ciphertext,
                                     size_t* ciphertext_size) {
   DCHECK(plaintext);
   DCHECK(ciphertext);
-  DCHECK(aes_key());
+  DCHECK(backend());
 
   // |ciphertext_size| is always the same as |plaintext_size| for counter mode.
   if (*ciphertext_size < plaintext_size) {
@@ -74,18 +96,57 @@ bool AesCtrEncryptor::CryptInternal(const uint8_t* plaintext,
   }
   *ciphertext_size = plaintext_size;
 
-  for (size_t i = 0; i < plaintext_size; ++i) {
-    if (block_offset_ == 0) {
-      AES_encrypt(&counter_[0], &encrypted_counter_[0], aes_key());
-      // As mentioned in ISO/IEC 23001-7:2016 CENC spec, of the 16 byte counter
-      // block, bytes 8 to 15 (i.e. the least significant bytes) are used as a
-      // simple 64 bit unsigned integer that is incremented by one for each
-      // subsequent block of sample data processed and is kept in network byte
-      // order.
-      Increment64(&counter_[8]);
-    }
+  // Finish the partial keystream block left over from the previous call.
+  size_t i = 0;
+  while (block_offset_ != 0 && i < plaintext_size) {
     ciphertext[i] = plaintext[i] ^ encrypted_counter_[block_offset_];
     block_offset_ = (block_offset_ + 1) % AES_BLOCK_SIZE;
+    ++i;
+  }
+
+  // Encrypt whole blocks in batched cipher calls rather than block by block.
+  // As mentioned in ISO/IEC 23001-7:2016 CENC spec, of the 16 byte counter
+  // block, bytes 8 to 15 (i.e. the least significant bytes) are used as a
+  // simple 64 bit unsigned integer that is incremented by one for each
+  // subsequent block of sample data processed and is kept in network byte
+  // order. The batched cipher carries into the upper bytes instead, so a
+  // batch must not cross a 64-bit counter wrap.
+  size_t remaining_blocks = (plaintext_size - i) / AES_BLOCK_SIZE;
+  while (remaining_blocks > 0) {
+    const uint64_t counter_low = ReadCounter64(&counter_[8]);
+    // (2^64 - counter_low) blocks until the counter wraps; zero means the
+    // full 2^64 range is available.
+    const uint64_t blocks_until_wrap = 0u - counter_low;
+    uint64_t batch_blocks = std::min<uint64_t>(remaining_blocks,
+                                               kMaxBlocksPerBatch);
+    if (blocks_until_wrap != 0 && batch_blocks > blocks_until_wrap)
+      batch_blocks = blocks_until_wrap;
+    const size_t batch_size = static_cast<size_t>(batch_blocks) *
+                              AES_BLOCK_SIZE;
+
+    AesCryptoBackend::CtrRequest request;
+    request.in = plaintext + i;
+    request.out = ciphertext + i;
+    request.size = batch_size;
+    request.counter = counter_.data();
+    if (!backend()->CtrCrypt(request))
+      return false;
+    WriteCounter64(counter_low + batch_blocks, &counter_[8]);
+    i += batch_size;
+    remaining_blocks -= static_cast<size_t>(batch_blocks);
+  }
+
+  // Generate the keystream for a trailing partial block; the leftover is
+  // kept in |encrypted_counter_| for the next call.
+  if (i < plaintext_size) {
+    if (!backend()->EncryptBlock(&counter_[0], &encrypted_counter_[0]))
+      return false;
+    Increment64(&counter_[8]);
+    while (i < plaintext_size) {
+      ciphertext[i] = plaintext[i] ^ encrypted_counter_[block_offset_];
+      ++block_offset_;
+      ++i;
+    }
   }
   return true;
 }
@@ -115,9 +176,26 @@ bool AesCbcEncryptor::CryptInternal(const uint8_t* plaintext,
                                     size_t plaintext_size,
                                     uint8_t* ciphertext,
                                     size_t* ciphertext_size) {
-  DCHECK(aes_key());
+  DCHECK(backend());
 
   const size_t residual_block_size = plaintext_size % AES_BLOCK_SIZE;
+
+  // Fast path: whole-block input with no padding to add is a single bulk
+  // cipher call with no residual handling. Full-sample cbc1 encryption hits
+  // this on every audio frame.
+  if (residual_block_size == 0 && padding_scheme_ != kPkcs5Padding) {
+    if (*ciphertext_size < plaintext_size) {
+      LOG(ERROR) << "Expecting output size of at least " << plaintext_size
+                 << " bytes.";
+      return false;
+    }
+    *ciphertext_size = plaintext_size;
+    if (plaintext_size == 0)
+      return true;
+    return backend()->CbcEncrypt(plaintext, plaintext_size,
+                                 internal_iv_.data(), ciphertext);
+  }
+
   const size_t num_padding_bytes = NumPaddingBytes(plaintext_size);
   const size_t required_ciphertext_size = plaintext_size + num_padding_bytes;
   if (*ciphertext_size < required_ciphertext_size) {
@@ -130,17 +208,15 @@ bool AesCbcEncryptor::CryptInternal(const uint8_t* plaintext,
   // Encrypt everything but the residual block using CBC.
   const size_t cbc_size = plaintext_size - residual_block_size;
   if (cbc_size != 0) {
-    AES_cbc_encrypt(plaintext, ciphertext, cbc_size, aes_key(),
-                    internal_iv_.data(), AES_ENCRYPT);
+    if (!backend()->CbcEncrypt(plaintext, cbc_size, internal_iv_.data(),
+                               ciphertext)) {
+      return false;
+    }
   } else if (padding_scheme_ == kCtsPadding) {
     // Don't have a full block, leave unencrypted.
     memcpy(ciphertext, plaintext, plaintext_size);
     return true;
   }
-  if (residual_block_size == 0 && padding_scheme_ != kPkcs5Padding) {
-    // No residual block. No need to do padding.
-    return true;
-  }
 
   if (padding_scheme_ == kNoPadding) {
     // The residual block is left unencrypted.
@@ -158,18 +234,21 @@ bool AesCbcEncryptor::CryptInternal(const uint8_t* plaintext,
 
     // Pad residue block with PKCS5 padding.
     residual_block.resize(AES_BLOCK_SIZE, static_cast<char>(num_padding_bytes));
-    AES_cbc_encrypt(residual_block.data(), residual_ciphertext_block,
-                    AES_BLOCK_SIZE, aes_key(), internal_iv_.data(),
-                    AES_ENCRYPT);
+    if (!backend()->CbcEncrypt(residual_block.data(), AES_BLOCK_SIZE,
+                               internal_iv_.data(),
+                               residual_ciphertext_block)) {
+      return false;
+    }
   } else {
     DCHECK_EQ(num_padding_bytes, 0u);
     DCHECK_EQ(padding_scheme_, kCtsPadding);
 
     // Zero-pad the residual block and encrypt using CBC.
     residual_block.resize(AES_BLOCK_SIZE, 0);
-    AES_cbc_encrypt(residual_block.data(), residual_block.data(),
-                    AES_BLOCK_SIZE, aes_key(), internal_iv_.data(),
-                    AES_ENCRYPT);
+    if (!backend()->CbcEncrypt(residual_block.data(), AES_BLOCK_SIZE,
+                               internal_iv_.data(), residual_block.data())) {
+      return false;
+    }
 
     // Replace the last full block with the zero-padded, encrypted residual
     // block, and replace the residual block with the equivalent portion of the
@@ -4,7 +4,7 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 //
-// AES Encryptor implementation using openssl.
+// AES Encryptor implementation on top of AesCryptoBackend.
 
 #ifndef MEDIA_BASE_AES_ENCRYPTOR_H_
 #define MEDIA_BASE_AES_ENCRYPTOR_H_
@@ -7,7 +7,6 @@
 #include "packager/media/base/aes_pattern_cryptor.h"
 
 #include <openssl/aes.h>
-#include <algorithm>
 #include "packager/base/logging.h"
 
 namespace shaka {
@@ -62,26 +61,41 @@ bool AesPatternCryptor::CryptInternal(const uint8_t* text,
     return true;
   }
 
-  while (text_size > 0) {
-    const size_t crypt_byte_size = crypt_byte_block_ * AES_BLOCK_SIZE;
-    if (NeedEncrypt(text_size, crypt_byte_size)) {
-      if (!cryptor_->Crypt(text, crypt_byte_size, crypt_text))
-        return false;
-    } else {
-      // If there is not enough data, just keep it in clear.
-      memcpy(crypt_text, text, text_size);
-      return true;
-    }
-    text += crypt_byte_size;
-    text_size -= crypt_byte_size;
-    crypt_text += crypt_byte_size;
+  const size_t crypt_byte_size = crypt_byte_block_ * AES_BLOCK_SIZE;
+  const size_t pattern_size =
+      crypt_byte_size + skip_byte_block_ * AES_BLOCK_SIZE;
 
-    const size_t skip_byte_size = std::min(
-        static_cast<size_t>(skip_byte_block_ * AES_BLOCK_SIZE), text_size);
-    memcpy(crypt_text, text, skip_byte_size);
-    text += skip_byte_size;
-    text_size -= skip_byte_size;
-    crypt_text += skip_byte_size;
+  // Every encrypted run spans exactly |crypt_byte_size| bytes: one run per
+  // full pattern unit, plus possibly one more in the trailing partial unit.
+  size_t num_crypt_runs = text_size / pattern_size;
+  const size_t tail_size = text_size % pattern_size;
+  if (tail_size > 0 && NeedEncrypt(tail_size, crypt_byte_size))
+    ++num_crypt_runs;
+
+  // Gather the to-be-encrypted runs into a contiguous scratch buffer, so the
+  // whole sample is ciphered in a single call instead of one call per pattern
+  // unit. This is safe because |cryptor_| carries its state (counter stream
+  // or cipher block chain) continuously across the skipped blocks, so
+  // ciphering the concatenated runs produces the same bytes as ciphering the
+  // runs one by one. The scratch buffer is reused across calls to avoid
+  // per-sample allocations.
+  scratch_.resize(num_crypt_runs * crypt_byte_size);
+  for (size_t i = 0; i < num_crypt_runs; ++i) {
+    memcpy(&scratch_[i * crypt_byte_size], text + i * pattern_size,
+           crypt_byte_size);
+  }
+  if (!scratch_.empty() &&
+      !cryptor_->Crypt(scratch_.data(), scratch_.size(), scratch_.data())) {
+    return false;
+  }
+
+  // The bytes outside the encrypted runs are passed through in clear.
+  if (crypt_text != text && text_size > 0)
+    memcpy(crypt_text, text, text_size);
+  // Scatter the encrypted runs back to their positions in the pattern.
+  for (size_t i = 0; i < num_crypt_runs; ++i) {
+    memcpy(crypt_text + i * pattern_size, &scratch_[i * crypt_byte_size],
+           crypt_byte_size);
   }
   return true;
 }
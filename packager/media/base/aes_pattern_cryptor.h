@@ -75,6 +75,9 @@ class AesPatternCryptor : public AesCryptor {
   const uint8_t skip_byte_block_;
   const PatternEncryptionMode encryption_mode_;
   scoped_ptr<AesCryptor> cryptor_;
+  // Scratch buffer used to gather the to-be-encrypted runs of a sample so
+  // they can be ciphered in one call. Reused across Crypt calls.
+  std::vector<uint8_t> scratch_;
 
   DISALLOW_COPY_AND_ASSIGN(AesPatternCryptor);
 };
@@ -12,15 +12,20 @@ namespace media {
 
 AudioTimestampHelper::AudioTimestampHelper(uint32_t timescale,
                                            uint32_t samples_per_second)
-    : base_timestamp_(kNoTimestamp), frame_count_(0) {
+    : timescale_(timescale),
+      samples_per_second_(samples_per_second),
+      base_timestamp_(kNoTimestamp),
+      frame_count_(0),
+      accumulated_ticks_(0),
+      tick_remainder_(0) {
   DCHECK_GT(samples_per_second, 0u);
-  double fps = samples_per_second;
-  ticks_per_frame_ = timescale / fps;
 }
 
 void AudioTimestampHelper::SetBaseTimestamp(int64_t base_timestamp) {
   base_timestamp_ = base_timestamp;
   frame_count_ = 0;
+  accumulated_ticks_ = 0;
+  tick_remainder_ = 0;
 }
 
 int64_t AudioTimestampHelper::base_timestamp() const {
@@ -31,16 +36,46 @@ void AudioTimestampHelper::AddFrames(int64_t frame_count) {
   DCHECK_GE(frame_count, 0);
   DCHECK(base_timestamp_ != kNoTimestamp);
   frame_count_ += frame_count;
+  const int64_t ticks = frame_count * timescale_ + tick_remainder_;
+  accumulated_ticks_ += ticks / samples_per_second_;
+  tick_remainder_ = ticks % samples_per_second_;
 }
 
 int64_t AudioTimestampHelper::GetTimestamp() const {
-  return ComputeTimestamp(frame_count_);
+  DCHECK(base_timestamp_ != kNoTimestamp);
+  return base_timestamp_ + accumulated_ticks_;
 }
 
 int64_t AudioTimestampHelper::GetFrameDuration(int64_t frame_count) const {
   DCHECK_GE(frame_count, 0);
-  int64_t end_timestamp = ComputeTimestamp(frame_count_ + frame_count);
-  return end_timestamp - GetTimestamp();
+  return (frame_count * timescale_ + tick_remainder_) / samples_per_second_;
+}
+
+void AudioTimestampHelper::GetTimestampsForBatch(
+    int64_t frames_per_sample,
+    size_t num_samples,
+    std::vector<int64_t>* timestamps) {
+  DCHECK_GE(frames_per_sample, 0);
+  DCHECK(base_timestamp_ != kNoTimestamp);
+  DCHECK(timestamps);
+
+  // Precompute the whole and fractional tick increments per sample once;
+  // stepping through the batch is then an add plus a conditional carry since
+  // both remainders are below |samples_per_second_|.
+  const int64_t sample_ticks = frames_per_sample * timescale_;
+  const int64_t step_ticks = sample_ticks / samples_per_second_;
+  const int64_t step_remainder = sample_ticks % samples_per_second_;
+
+  for (size_t i = 0; i < num_samples; ++i) {
+    timestamps->push_back(base_timestamp_ + accumulated_ticks_);
+    accumulated_ticks_ += step_ticks;
+    tick_remainder_ += step_remainder;
+    if (tick_remainder_ >= samples_per_second_) {
+      tick_remainder_ -= samples_per_second_;
+      ++accumulated_ticks_;
+    }
+  }
+  frame_count_ += frames_per_sample * num_samples;
 }
 
 int64_t AudioTimestampHelper::GetFramesToTarget(int64_t target) const {
@@ -54,22 +89,16 @@ int64_t AudioTimestampHelper::GetFramesToTarget(int64_t target) const {
   // Compute a timestamp relative to |base_timestamp_| since timestamps
   // created from |frame_count_| are computed relative to this base.
   // This ensures that the time to frame computation here is the proper inverse
-  // of the frame to time computation in ComputeTimestamp().
+  // of the frame to time computation in AddFrames().
   int64_t delta_from_base = target - base_timestamp_;
 
-  // Compute frame count for the time delta. This computation rounds to
-  // the nearest whole number of frames.
-  double threshold = ticks_per_frame_ / 2;
-  int64_t target_frame_count = (delta_from_base + threshold) / ticks_per_frame_;
+  // Compute frame count for the time delta, rounding to the nearest whole
+  // number of frames: frames = round(delta_from_base / ticks_per_frame) with
+  // ticks_per_frame = timescale / samples_per_second.
+  int64_t target_frame_count =
+      (delta_from_base * samples_per_second_ + timescale_ / 2) / timescale_;
   return target_frame_count - frame_count_;
 }
 
-int64_t AudioTimestampHelper::ComputeTimestamp(int64_t frame_count) const {
-  DCHECK_GE(frame_count, 0);
-  DCHECK(base_timestamp_ != kNoTimestamp);
-  double frames_ticks = ticks_per_frame_ * frame_count;
-  return base_timestamp_ + frames_ticks;
-}
-
 }  // namespace media
 }  // namespace shaka
@@ -7,6 +7,8 @@
 
 #include <stdint.h>
 
+#include <vector>
+
 #include "packager/base/macros.h"
 
 namespace shaka {
@@ -27,6 +29,12 @@ namespace media {
 // values for samples added to the current timestamp. GetFramesToTarget()
 // determines the number of frames that need to be added/removed from the
 // accumulated frames to reach a target timestamp.
+//
+// Timestamps are computed with exact integer arithmetic: the accumulated tick
+// count and the fractional remainder of frame_count * timescale /
+// samples_per_second are carried incrementally, so GetTimestamp() involves no
+// division and no floating point error accumulates regardless of how many
+// frames are added.
 class AudioTimestampHelper {
  public:
   explicit AudioTimestampHelper(uint32_t timescale,
@@ -53,20 +61,36 @@ class AudioTimestampHelper {
   // GetTimestamp() will return if AddFrames(n) is called.
   int64_t GetFrameDuration(int64_t frame_count) const;
 
+  // Appends the timestamps of |num_samples| consecutive samples of
+  // |frames_per_sample| frames each to |timestamps| and advances the frame
+  // counter past all of them. Equivalent to calling GetTimestamp() followed
+  // by AddFrames(frames_per_sample) once per sample, but the per-sample tick
+  // increment is precomputed so the whole batch costs one division plus an
+  // add-and-carry per sample.
+  void GetTimestampsForBatch(int64_t frames_per_sample,
+                             size_t num_samples,
+                             std::vector<int64_t>* timestamps);
+
   // Returns the number of frames needed to reach the target timestamp.
   // Note: |target| must be >= |base_timestamp_|.
   int64_t GetFramesToTarget(int64_t target) const;
 
  private:
-  int64_t ComputeTimestamp(int64_t frame_count) const;
-
-  double ticks_per_frame_;
+  const int64_t timescale_;
+  const int64_t samples_per_second_;
 
   int64_t base_timestamp_;
 
   // Number of frames accumulated by AddFrames() calls.
   int64_t frame_count_;
 
+  // Ticks elapsed since |base_timestamp_| for |frame_count_| frames, i.e.
+  // floor(frame_count_ * timescale_ / samples_per_second_), and the remainder
+  // of that division in units of 1 / samples_per_second_ ticks. Both are
+  // updated incrementally as frames are added.
+  int64_t accumulated_ticks_;
+  int64_t tick_remainder_;
+
   DISALLOW_IMPLICIT_CONSTRUCTORS(AudioTimestampHelper);
 };
 
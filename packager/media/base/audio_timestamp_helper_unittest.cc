@@ -87,6 +87,32 @@ TEST_F(AudioTimestampHelperTest, GetDuration) {
   }
 }
 
+TEST_F(AudioTimestampHelperTest, GetTimestampsForBatch) {
+  // Verify that the batched conversion produces exactly the same sequence as
+  // the equivalent GetTimestamp() / AddFrames() loop.
+  const int kFramesPerSample = 1024;
+  const size_t kNumSamples = 100;
+
+  std::vector<int64_t> expected_timestamps;
+  for (size_t i = 0; i < kNumSamples; ++i) {
+    expected_timestamps.push_back(helper_.GetTimestamp());
+    helper_.AddFrames(kFramesPerSample);
+  }
+  int64_t expected_end_timestamp = helper_.GetTimestamp();
+
+  AudioTimestampHelper batch_helper(kTimescale, kDefaultSampleRate);
+  batch_helper.SetBaseTimestamp(0);
+  std::vector<int64_t> timestamps;
+  batch_helper.GetTimestampsForBatch(kFramesPerSample, kNumSamples,
+                                     &timestamps);
+
+  ASSERT_EQ(expected_timestamps.size(), timestamps.size());
+  for (size_t i = 0; i < kNumSamples; ++i)
+    EXPECT_EQ(expected_timestamps[i], timestamps[i]) << " at sample " << i;
+  EXPECT_EQ(helper_.frame_count(), batch_helper.frame_count());
+  EXPECT_EQ(expected_end_timestamp, batch_helper.GetTimestamp());
+}
+
 TEST_F(AudioTimestampHelperTest, GetFramesToTarget) {
   // Verify GetFramesToTarget() rounding behavior.
   // 1 frame @ 44100 is ~22.67573 microseconds,
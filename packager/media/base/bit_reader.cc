@@ -4,7 +4,9 @@
 
 #include "packager/media/base/bit_reader.h"
 
-#include <algorithm>
+#include <string.h>
+
+#include "packager/base/sys_byteorder.h"
 
 namespace shaka {
 namespace media {
@@ -13,10 +15,9 @@ BitReader::BitReader(const uint8_t* data, off_t size)
     : data_(data),
       initial_size_(size),
       bytes_left_(size),
-      num_remaining_bits_in_curr_byte_(0) {
+      reg_(0),
+      num_bits_in_reg_(0) {
   DCHECK(data_ != NULL && bytes_left_ > 0);
-
-  UpdateCurrByte();
 }
 
 BitReader::~BitReader() {}
@@ -24,28 +25,27 @@ BitReader::~BitReader() {}
 bool BitReader::SkipBits(int num_bits) {
   DCHECK_GE(num_bits, 0);
 
-  // Skip any bits in the current byte waiting to be processed, then
-  // process full bytes until less than 8 bits remaining.
-  if (num_bits > num_remaining_bits_in_curr_byte_) {
-    num_bits -= num_remaining_bits_in_curr_byte_;
-    num_remaining_bits_in_curr_byte_ = 0;
-
-    int num_bytes = num_bits / 8;
-    num_bits %= 8;
-    if (bytes_left_ < num_bytes) {
-      bytes_left_ = 0;
-      return false;
-    }
-    bytes_left_ -= num_bytes;
-    data_ += num_bytes;
-    UpdateCurrByte();
-
-    // If there is no more data remaining, only return true if we
-    // skipped all that were requested.
-    if (num_remaining_bits_in_curr_byte_ == 0)
-      return (num_bits == 0);
+  if (num_bits < num_bits_in_reg_) {
+    reg_ <<= num_bits;
+    num_bits_in_reg_ -= num_bits;
+    return true;
   }
 
+  // Drop the buffered bits, then skip whole bytes directly in the stream
+  // without pulling them through the register.
+  num_bits -= num_bits_in_reg_;
+  num_bits_in_reg_ = 0;
+  reg_ = 0;
+
+  off_t num_bytes = num_bits / 8;
+  num_bits %= 8;
+  if (bytes_left_ < num_bytes) {
+    bytes_left_ = 0;
+    return false;
+  }
+  bytes_left_ -= num_bytes;
+  data_ += num_bytes;
+
   // Less than 8 bits remaining to skip. Use ReadBitsInternal to verify
   // that the remaining bits we need exist, and adjust them as necessary
   // for subsequent operations.
@@ -54,52 +54,80 @@ bool BitReader::SkipBits(int num_bits) {
 }
 
 bool BitReader::SkipBytes(int num_bytes) {
-  if (num_remaining_bits_in_curr_byte_ != 8)
-    return false;
-  if (num_bytes == 0)
-    return true;
+  DCHECK_GE(num_bytes, 0);
 
-  data_ += num_bytes - 1;  // One additional byte in curr_byte_.
-  if (num_bytes > bytes_left_ + 1)
+  if (num_bits_in_reg_ % 8 != 0)
     return false;
-  bytes_left_ -= num_bytes - 1;
-  num_remaining_bits_in_curr_byte_ = 0;
-  UpdateCurrByte();
-  return true;
+  return SkipBits(num_bytes * 8);
 }
 
 bool BitReader::ReadBitsInternal(int num_bits, uint64_t* out) {
+  DCHECK_GE(num_bits, 0);
   DCHECK_LE(num_bits, 64);
 
   *out = 0;
+  if (num_bits == 0)
+    return true;
 
-  while (num_remaining_bits_in_curr_byte_ != 0 && num_bits != 0) {
-    int bits_to_take = std::min(num_remaining_bits_in_curr_byte_, num_bits);
+  if (num_bits > bits_available()) {
+    // Put the stream in an exhausted state so that subsequent non-trivial
+    // reads and skips also fail.
+    num_bits_in_reg_ = 0;
+    bytes_left_ = 0;
+    return false;
+  }
 
-    *out <<= bits_to_take;
-    *out += curr_byte_ >> (num_remaining_bits_in_curr_byte_ - bits_to_take);
-    num_bits -= bits_to_take;
-    num_remaining_bits_in_curr_byte_ -= bits_to_take;
-    curr_byte_ &= (1 << num_remaining_bits_in_curr_byte_) - 1;
+  if (num_bits > num_bits_in_reg_) {
+    // Not enough buffered bits. Consume what is in the register, then refill.
+    // Strictly less than |num_bits| <= 64 bits are consumed here, so all the
+    // shifts below stay within [0, 63].
+    if (num_bits_in_reg_ != 0) {
+      *out = reg_ >> (64 - num_bits_in_reg_);
+      num_bits -= num_bits_in_reg_;
+      num_bits_in_reg_ = 0;
+    }
+    Refill();
+    DCHECK_LE(num_bits, num_bits_in_reg_);
+  }
 
-    if (num_remaining_bits_in_curr_byte_ == 0)
-      UpdateCurrByte();
+  if (num_bits == 64) {
+    // Only possible when nothing was consumed above and the register was
+    // (re)filled with a full 8 bytes.
+    *out = reg_;
+    reg_ = 0;
+    num_bits_in_reg_ = 0;
+    return true;
   }
 
-  return num_bits == 0;
+  *out = (*out << num_bits) | (reg_ >> (64 - num_bits));
+  reg_ <<= num_bits;
+  num_bits_in_reg_ -= num_bits;
+  return true;
 }
 
-void BitReader::UpdateCurrByte() {
-  DCHECK_EQ(num_remaining_bits_in_curr_byte_, 0);
-
-  if (bytes_left_ == 0)
+void BitReader::Refill() {
+  DCHECK_EQ(num_bits_in_reg_, 0);
+
+  if (bytes_left_ >= 8) {
+    // Fast path: load 8 bytes at once. The bit stream is in network byte
+    // order.
+    uint64_t value;
+    memcpy(&value, data_, sizeof(value));
+    reg_ = base::NetToHost64(value);
+    data_ += 8;
+    bytes_left_ -= 8;
+    num_bits_in_reg_ = 64;
     return;
+  }
 
-  // Load a new byte and advance pointers.
-  curr_byte_ = *data_;
-  ++data_;
-  --bytes_left_;
-  num_remaining_bits_in_curr_byte_ = 8;
+  // Tail of the buffer: assemble the remaining bytes one at a time.
+  reg_ = 0;
+  for (int shift = 56; bytes_left_ > 0; shift -= 8) {
+    reg_ |= static_cast<uint64_t>(*data_) << shift;
+    ++data_;
+    --bytes_left_;
+    num_bits_in_reg_ += 8;
+  }
 }
 
 }  // namespace media
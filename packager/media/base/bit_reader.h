@@ -73,9 +73,7 @@ class BitReader {
   bool SkipBytes(int num_bytes);
 
   /// @return The number of bits available for reading.
-  int bits_available() const {
-    return 8 * bytes_left_ + num_remaining_bits_in_curr_byte_;
-  }
+  int bits_available() const { return 8 * bytes_left_ + num_bits_in_reg_; }
 
   /// @return The current bit position.
   int bit_position() const { return 8 * initial_size_ - bits_available(); }
@@ -84,27 +82,27 @@ class BitReader {
   // Help function used by ReadBits to avoid inlining the bit reading logic.
   bool ReadBitsInternal(int num_bits, uint64_t* out);
 
-  // Advance to the next byte, loading it into curr_byte_.
-  // If the num_remaining_bits_in_curr_byte_ is 0 after this function returns,
+  // Refill reg_ from the stream, loading 8 bytes at a time except near the
+  // end of the buffer. If num_bits_in_reg_ is 0 after this function returns,
   // the stream has reached the end.
-  void UpdateCurrByte();
+  void Refill();
 
-  // Pointer to the next unread (not in curr_byte_) byte in the stream.
+  // Pointer to the next unread (not in reg_) byte in the stream.
   const uint8_t* data_;
 
   // Initial size of the input data.
   // TODO(kqyang): Use size_t instead of off_t instead.
   off_t initial_size_;
 
-  // Bytes left in the stream (without the curr_byte_).
+  // Bytes left in the stream (excluding the bytes in reg_).
   off_t bytes_left_;
 
-  // Contents of the current byte; first unread bit starting at position
-  // 8 - num_remaining_bits_in_curr_byte_ from MSB.
-  uint8_t curr_byte_;
+  // Bit accumulator holding the unread bits loaded from the stream; the
+  // first unread bit is the most significant bit.
+  uint64_t reg_;
 
-  // Number of bits remaining in curr_byte_
-  int num_remaining_bits_in_curr_byte_;
+  // Number of unread bits in reg_.
+  int num_bits_in_reg_;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(BitReader);
@@ -0,0 +1,117 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/buffer_pool.h"
+
+#include "packager/base/lazy_instance.h"
+#include "packager/base/logging.h"
+#include "packager/media/base/pipeline_stats.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+base::LazyInstance<BufferPool>::Leaky g_buffer_pool = LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+BufferPool::BufferPool() {}
+
+BufferPool::~BufferPool() {}
+
+// static
+BufferPool* BufferPool::GetInstance() {
+  return g_buffer_pool.Pointer();
+}
+
+void BufferPool::Acquire(size_t size, std::vector<uint8_t>* buffer) {
+  DCHECK(buffer);
+  // Memory accounting assumes |buffer| comes in empty, which holds for
+  // MediaSample, the pool's only client. Backing stores are counted when
+  // they are created here and uncounted when Release() lets one go; buffers
+  // parked on a free list stay counted because they remain resident.
+  DCHECK_EQ(0u, buffer->capacity());
+  const size_t size_class = SizeClassForAcquire(size);
+  if (size_class == kNumSizeClasses) {
+    // Not a pooled size. Fall back to a plain allocation.
+    buffer->resize(size);
+    pipeline_stats::RecordMemoryAllocated(pipeline_stats::kMemoryBufferPool,
+                                          buffer->capacity());
+    return;
+  }
+
+  {
+    base::AutoLock auto_lock(lock_);
+    std::vector<std::vector<uint8_t> >& free_list = free_buffers_[size_class];
+    if (!free_list.empty()) {
+      buffer->swap(free_list.back());
+      free_list.pop_back();
+      buffer->resize(size);
+      return;
+    }
+  }
+  // Nothing pooled. Reserve the full class capacity so the buffer lands back
+  // in the same class when released, regardless of |size|.
+  buffer->reserve(static_cast<size_t>(1)
+                  << (kMinSizeClassBits + size_class));
+  buffer->resize(size);
+  pipeline_stats::RecordMemoryAllocated(pipeline_stats::kMemoryBufferPool,
+                                        buffer->capacity());
+}
+
+void BufferPool::Release(std::vector<uint8_t>* buffer) {
+  DCHECK(buffer);
+  // |released| frees any capacity not returned to the pool when it goes out
+  // of scope, outside the lock.
+  std::vector<uint8_t> released;
+  released.swap(*buffer);
+
+  const size_t size_class = SizeClassForRelease(released.capacity());
+  if (size_class == kNumSizeClasses) {
+    pipeline_stats::RecordMemoryFreed(pipeline_stats::kMemoryBufferPool,
+                                      released.capacity());
+    return;
+  }
+
+  released.clear();
+  {
+    base::AutoLock auto_lock(lock_);
+    std::vector<std::vector<uint8_t> >& free_list = free_buffers_[size_class];
+    if (free_list.size() < kMaxFreeBuffersPerClass) {
+      free_list.push_back(std::vector<uint8_t>());
+      free_list.back().swap(released);
+      return;
+    }
+  }
+  // The free list is full; |released| is about to be deallocated.
+  pipeline_stats::RecordMemoryFreed(pipeline_stats::kMemoryBufferPool,
+                                    released.capacity());
+}
+
+// static
+size_t BufferPool::SizeClassForAcquire(size_t size) {
+  size_t size_class = 0;
+  while (size > (static_cast<size_t>(1) << (kMinSizeClassBits + size_class))) {
+    if (++size_class == kNumSizeClasses)
+      break;
+  }
+  return size_class;
+}
+
+// static
+size_t BufferPool::SizeClassForRelease(size_t capacity) {
+  if (capacity < (static_cast<size_t>(1) << kMinSizeClassBits))
+    return kNumSizeClasses;
+  size_t size_class = kNumSizeClasses - 1;
+  while (capacity <
+         (static_cast<size_t>(1) << (kMinSizeClassBits + size_class))) {
+    --size_class;
+  }
+  return size_class;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,75 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_BASE_BUFFER_POOL_H_
+#define MEDIA_BASE_BUFFER_POOL_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+namespace media {
+
+/// BufferPool recycles payload buffers across MediaSample instances. Samples
+/// churn at thousands per second across demux, encrypt and mux; recycling
+/// their buffers avoids round-tripping every payload through malloc/free.
+/// Released buffers are binned by capacity into power-of-two size classes
+/// and reused for subsequent acquisitions of a compatible size. The pool is
+/// thread safe: samples may be created and destroyed on different threads.
+class BufferPool {
+ public:
+  BufferPool();
+  ~BufferPool();
+
+  /// @return The process-wide pool used for MediaSample payloads.
+  static BufferPool* GetInstance();
+
+  /// Swap a buffer of exactly @a size bytes into @a buffer, reusing a
+  /// previously released buffer when one of sufficient capacity is pooled.
+  /// The buffer contents are uninitialized. The previous contents of
+  /// @a buffer are discarded.
+  void Acquire(size_t size, std::vector<uint8_t>* buffer);
+
+  /// Return the capacity of @a buffer to the pool, leaving @a buffer empty.
+  /// Buffers outside the pooled size range or beyond the per-class limit are
+  /// simply freed.
+  void Release(std::vector<uint8_t>* buffer);
+
+ private:
+  // Index of the size class whose buffers can hold |size| bytes, i.e. the
+  // smallest pooled power of two >= |size|. Returns kNumSizeClasses if |size|
+  // exceeds the largest pooled class.
+  static size_t SizeClassForAcquire(size_t size);
+  // Index of the size class a buffer of |capacity| bytes belongs to, i.e. the
+  // largest pooled power of two <= |capacity|. Returns kNumSizeClasses if
+  // |capacity| is below the smallest pooled class.
+  static size_t SizeClassForRelease(size_t capacity);
+
+  // Pooled capacities range from 2^kMinSizeClassBits (1KB) to
+  // 2^kMaxSizeClassBits (4MB). Smaller buffers are cheap to allocate and
+  // larger ones are rare enough that pooling them wastes memory.
+  static const size_t kMinSizeClassBits = 10;
+  static const size_t kMaxSizeClassBits = 22;
+  static const size_t kNumSizeClasses =
+      kMaxSizeClassBits - kMinSizeClassBits + 1;
+  // Maximum number of free buffers kept per size class; caps the worst case
+  // pool footprint while still covering the samples in flight in a pipeline.
+  static const size_t kMaxFreeBuffersPerClass = 32;
+
+  base::Lock lock_;
+  std::vector<std::vector<uint8_t> > free_buffers_[kNumSizeClasses];
+
+  DISALLOW_COPY_AND_ASSIGN(BufferPool);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_BASE_BUFFER_POOL_H_
@@ -0,0 +1,62 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/media/base/buffer_pool.h"
+
+namespace shaka {
+namespace media {
+
+TEST(BufferPoolTest, AcquireProvidesRequestedSize) {
+  BufferPool pool;
+  std::vector<uint8_t> buffer;
+  pool.Acquire(1000, &buffer);
+  EXPECT_EQ(1000u, buffer.size());
+  pool.Acquire(0, &buffer);
+  EXPECT_EQ(0u, buffer.size());
+}
+
+TEST(BufferPoolTest, ReleaseThenAcquireReusesBuffer) {
+  BufferPool pool;
+  std::vector<uint8_t> buffer;
+  pool.Acquire(1000, &buffer);
+  const uint8_t* data = &buffer[0];
+  pool.Release(&buffer);
+  EXPECT_EQ(0u, buffer.size());
+
+  // A second acquisition in the same size class reuses the released buffer.
+  pool.Acquire(500, &buffer);
+  EXPECT_EQ(500u, buffer.size());
+  EXPECT_EQ(data, &buffer[0]);
+}
+
+TEST(BufferPoolTest, AcquireReservesFullClassCapacity) {
+  BufferPool pool;
+  std::vector<uint8_t> buffer;
+  // 1500 bytes lands in the 2KB size class; the buffer is reserved to the
+  // full class capacity so it stays in the class when released.
+  pool.Acquire(1500, &buffer);
+  EXPECT_EQ(1500u, buffer.size());
+  EXPECT_LE(2048u, buffer.capacity());
+}
+
+TEST(BufferPoolTest, OversizeBufferNotPooled) {
+  BufferPool pool;
+  std::vector<uint8_t> buffer;
+  const size_t kOversize = 8 * 1024 * 1024;  // Larger than the biggest class.
+  pool.Acquire(kOversize, &buffer);
+  EXPECT_EQ(kOversize, buffer.size());
+  pool.Release(&buffer);
+  // The buffer was freed rather than pooled; a tiny follow-up acquisition
+  // must not be handed megabytes of capacity.
+  pool.Acquire(16, &buffer);
+  EXPECT_EQ(16u, buffer.size());
+  EXPECT_GT(kOversize, buffer.capacity());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -10,9 +10,11 @@
 #include <stdint.h>
 
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "packager/base/compiler_specific.h"
+#include "packager/base/logging.h"
 #include "packager/base/macros.h"
 
 namespace shaka {
@@ -31,19 +33,65 @@ class BufferReader {
   ///         otherwise.
   bool HasBytes(size_t count) { return pos() + count <= size(); }
 
+  /// Read a fixed-width value from the stream, performing endian correction,
+  /// and advance the stream pointer. Since the width is a compile-time
+  /// constant this compiles down to one bounds check and a constant-length
+  /// byte-swapped load, unlike the runtime-size ReadNBytesInto8 path.
+  /// @return false if there are not enough bytes in the buffer.
+  template <typename T>
+  bool Read(T* v) WARN_UNUSED_RESULT {
+    DCHECK(v != NULL);
+    if (!HasBytes(sizeof(T)))
+      return false;
+    *v = ReadBigEndian<T>();
+    return true;
+  }
+
+  /// Read a batch of fixed-width values with a single bounds check covering
+  /// every field, e.g. ReadBatch(&sample_count, &sample_delta) for one
+  /// sample table entry. All or nothing: on failure the stream pointer does
+  /// not advance and no field is written.
+  /// @return false if there are not enough bytes in the buffer.
+  template <typename... T>
+  bool ReadBatch(T*... v) WARN_UNUSED_RESULT {
+    if (!HasBytes(TotalFieldSize(v...)))
+      return false;
+    ReadFieldsUnchecked(v...);
+    return true;
+  }
+
   /// Read a value from the stream, performing endian correction, and advance
   /// the stream pointer.
   /// @return false if there are not enough bytes in the buffer.
   /// @{
-  bool Read1(uint8_t* v) WARN_UNUSED_RESULT;
-  bool Read2(uint16_t* v) WARN_UNUSED_RESULT;
-  bool Read2s(int16_t* v) WARN_UNUSED_RESULT;
-  bool Read4(uint32_t* v) WARN_UNUSED_RESULT;
-  bool Read4s(int32_t* v) WARN_UNUSED_RESULT;
-  bool Read8(uint64_t* v) WARN_UNUSED_RESULT;
-  bool Read8s(int64_t* v) WARN_UNUSED_RESULT;
+  bool Read1(uint8_t* v) WARN_UNUSED_RESULT { return Read(v); }
+  bool Read2(uint16_t* v) WARN_UNUSED_RESULT { return Read(v); }
+  bool Read2s(int16_t* v) WARN_UNUSED_RESULT { return Read(v); }
+  bool Read4(uint32_t* v) WARN_UNUSED_RESULT { return Read(v); }
+  bool Read4s(int32_t* v) WARN_UNUSED_RESULT { return Read(v); }
+  bool Read8(uint64_t* v) WARN_UNUSED_RESULT { return Read(v); }
+  bool Read8s(int64_t* v) WARN_UNUSED_RESULT { return Read(v); }
   /// @}
 
+  /// Read a column of @a count fixed-width values, e.g. a whole sample size
+  /// table, with a single bounds check covering the column. The vector is
+  /// sized once up front instead of growing per element. On failure the
+  /// stream pointer does not advance and the vector is left untouched.
+  /// @return false if there are not enough bytes in the buffer.
+  template <typename T>
+  bool ReadColumn(std::vector<T>* v, size_t count) WARN_UNUSED_RESULT {
+    DCHECK(v != NULL);
+    // Division instead of multiplication, so a huge |count| read from a
+    // corrupted file cannot overflow the byte computation.
+    if (count > (size() - pos()) / sizeof(T))
+      return false;
+    v->resize(count);
+    T* data = v->data();
+    for (size_t i = 0; i < count; ++i)
+      data[i] = ReadBigEndian<T>();
+    return true;
+  }
+
   /// Read N-byte integer of the corresponding signedness and store it in the
   /// 8-byte return type.
   /// @param num_bytes should not be larger than 8 bytes.
@@ -66,9 +114,34 @@ class BufferReader {
   size_t pos() const { return pos_; }
 
  private:
-  // Internal implementation of multi-byte reads.
+  // Big-endian load of a full-width value at the current position. The
+  // caller has already checked the bounds. The byte assembly runs over a
+  // compile-time constant width, which compilers collapse into an unaligned
+  // load plus byte swap.
   template <typename T>
-  bool Read(T* t) WARN_UNUSED_RESULT;
+  T ReadBigEndian() {
+    typename std::make_unsigned<T>::type tmp = 0;
+    for (size_t i = 0; i < sizeof(T); ++i)
+      tmp = (tmp << 8) | buf_[pos_ + i];
+    pos_ += sizeof(T);
+    return static_cast<T>(tmp);
+  }
+
+  // Compile-time accumulation of the byte size of a field pack.
+  static size_t TotalFieldSize() { return 0; }
+  template <typename First, typename... Rest>
+  static size_t TotalFieldSize(First* first, Rest*... rest) {
+    return sizeof(First) + TotalFieldSize(rest...);
+  }
+
+  void ReadFieldsUnchecked() {}
+  template <typename First, typename... Rest>
+  void ReadFieldsUnchecked(First* first, Rest*... rest) {
+    *first = ReadBigEndian<First>();
+    ReadFieldsUnchecked(rest...);
+  }
+
+  // Internal implementation of runtime-size multi-byte reads.
   template <typename T>
   bool ReadNBytes(T* t, size_t num_bytes) WARN_UNUSED_RESULT;
 
@@ -0,0 +1,110 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/media/base/buffer_reader.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const uint8_t kData[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+                         0x09, 0x0a, 0x0b, 0x0c, 0xfd, 0xfe, 0xff};
+}  // namespace
+
+TEST(BufferReaderTest, ReadFixedWidthIntegers) {
+  BufferReader reader(kData, sizeof(kData));
+
+  uint8_t v8;
+  uint16_t v16;
+  uint32_t v32;
+  uint64_t v64;
+  EXPECT_TRUE(reader.Read1(&v8));
+  EXPECT_EQ(0x01u, v8);
+  EXPECT_TRUE(reader.Read2(&v16));
+  EXPECT_EQ(0x0203u, v16);
+  EXPECT_TRUE(reader.Read4(&v32));
+  EXPECT_EQ(0x04050607u, v32);
+  EXPECT_TRUE(reader.Read8(&v64));
+  EXPECT_EQ(0x08090a0b0cfdfeffull, v64);
+
+  // The buffer is exhausted.
+  EXPECT_FALSE(reader.Read1(&v8));
+}
+
+TEST(BufferReaderTest, ReadSignedIntegers) {
+  BufferReader reader(kData + 12, 3);
+
+  int16_t v16;
+  EXPECT_TRUE(reader.Read2s(&v16));
+  EXPECT_EQ(-514, v16);  // 0xfdfe.
+  EXPECT_FALSE(reader.Read2s(&v16));
+}
+
+TEST(BufferReaderTest, ReadBatch) {
+  BufferReader reader(kData, sizeof(kData));
+
+  uint32_t first;
+  uint32_t second;
+  uint16_t third;
+  EXPECT_TRUE(reader.ReadBatch(&first, &second, &third));
+  EXPECT_EQ(0x01020304u, first);
+  EXPECT_EQ(0x05060708u, second);
+  EXPECT_EQ(0x090au, third);
+  EXPECT_EQ(10u, reader.pos());
+}
+
+TEST(BufferReaderTest, ReadBatchIsAllOrNothing) {
+  BufferReader reader(kData, 7);
+
+  uint32_t first = 0;
+  uint32_t second = 0;
+  // Only 7 bytes are available for 8 bytes of fields; neither field is read
+  // and the position does not advance.
+  EXPECT_FALSE(reader.ReadBatch(&first, &second));
+  EXPECT_EQ(0u, first);
+  EXPECT_EQ(0u, second);
+  EXPECT_EQ(0u, reader.pos());
+
+  uint32_t value;
+  EXPECT_TRUE(reader.Read4(&value));
+  EXPECT_EQ(0x01020304u, value);
+}
+
+TEST(BufferReaderTest, ReadColumn) {
+  BufferReader reader(kData, sizeof(kData));
+
+  std::vector<uint32_t> column;
+  EXPECT_TRUE(reader.ReadColumn(&column, 3));
+  ASSERT_EQ(3u, column.size());
+  EXPECT_EQ(0x01020304u, column[0]);
+  EXPECT_EQ(0x05060708u, column[1]);
+  EXPECT_EQ(0x090a0b0cu, column[2]);
+  EXPECT_EQ(12u, reader.pos());
+
+  // Only 3 bytes are left for a 4-byte entry; the column is not read and the
+  // position does not advance.
+  EXPECT_FALSE(reader.ReadColumn(&column, 1));
+  EXPECT_EQ(3u, column.size());
+  EXPECT_EQ(12u, reader.pos());
+}
+
+TEST(BufferReaderTest, ReadNBytesInto8) {
+  BufferReader reader(kData, sizeof(kData));
+
+  uint64_t v;
+  EXPECT_TRUE(reader.ReadNBytesInto8(&v, 3));
+  EXPECT_EQ(0x010203u, v);
+
+  int64_t vs;
+  BufferReader signed_reader(kData + 12, 3);
+  EXPECT_TRUE(signed_reader.ReadNBytesInto8s(&vs, 3));
+  EXPECT_EQ(-131329, vs);  // 0xfdfeff sign extended.
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -6,21 +6,41 @@
 
 #include "packager/media/base/buffer_writer.h"
 
+#include <string.h>
+
+#include <algorithm>
+
 #include "packager/base/logging.h"
 #include "packager/base/sys_byteorder.h"
+#include "packager/media/base/pipeline_stats.h"
 #include "packager/media/file/file.h"
 
 namespace shaka {
 namespace media {
+namespace {
+
+// Bound on the size of individual File::Write() calls. Flushing a large
+// segment in chunks keeps each call short, so a threaded output file can
+// start draining bytes to disk while the rest of the buffer is still being
+// handed over, instead of one latency spike proportional to segment size.
+const size_t kMaxWriteChunkSize = 512 * 1024;
+
+}  // namespace
 
-BufferWriter::BufferWriter() {
+BufferWriter::BufferWriter() : reported_capacity_(0) {
   const size_t kDefaultReservedCapacity = 0x40000;  // 256KB.
   buf_.reserve(kDefaultReservedCapacity);
+  UpdateMemoryStats();
 }
-BufferWriter::BufferWriter(size_t reserved_size_in_bytes) {
+BufferWriter::BufferWriter(size_t reserved_size_in_bytes)
+    : reported_capacity_(0) {
   buf_.reserve(reserved_size_in_bytes);
+  UpdateMemoryStats();
+}
+BufferWriter::~BufferWriter() {
+  pipeline_stats::RecordMemoryFreed(pipeline_stats::kMemoryBufferWriter,
+                                    reported_capacity_);
 }
-BufferWriter::~BufferWriter() {}
 
 void BufferWriter::AppendInt(uint8_t v) {
   buf_.push_back(v);
@@ -52,25 +72,69 @@ void BufferWriter::AppendNBytes(uint64_t v, size_t num_bytes) {
 }
 
 void BufferWriter::AppendVector(const std::vector<uint8_t>& v) {
+  EnsureCapacity(buf_.size() + v.size());
   buf_.insert(buf_.end(), v.begin(), v.end());
 }
 
 void BufferWriter::AppendArray(const uint8_t* buf, size_t size) {
+  EnsureCapacity(buf_.size() + size);
   buf_.insert(buf_.end(), buf, buf + size);
 }
 
 void BufferWriter::AppendBuffer(const BufferWriter& buffer) {
+  EnsureCapacity(buf_.size() + buffer.buf_.size());
   buf_.insert(buf_.end(), buffer.buf_.begin(), buffer.buf_.end());
 }
 
+uint8_t* BufferWriter::ReserveAppend(size_t size) {
+  const size_t old_size = buf_.size();
+  EnsureCapacity(old_size + size);
+  buf_.resize(old_size + size);
+  return &buf_[old_size];
+}
+
 Status BufferWriter::WriteToFile(File* file) {
   DCHECK(file);
   DCHECK(!buf_.empty());
 
-  size_t remaining_size = buf_.size();
-  const uint8_t* buf = &buf_[0];
+  Status status = WriteChunkedToFile(file, buf_.data(), buf_.size());
+  if (status.ok())
+    buf_.clear();
+  return status;
+}
+
+Status BufferWriter::WriteBuffersToFile(
+    File* file,
+    const std::vector<BufferWriter*>& buffers) {
+  DCHECK(file);
+
+  for (BufferWriter* buffer : buffers) {
+    DCHECK(buffer);
+    if (buffer->buf_.empty())
+      continue;
+    Status status =
+        WriteChunkedToFile(file, buffer->buf_.data(), buffer->buf_.size());
+    if (!status.ok())
+      return status;
+    buffer->buf_.clear();
+  }
+  return Status::OK;
+}
+
+template <typename T>
+void BufferWriter::AppendInternal(T v) {
+  // A fixed-size memcpy compiles to a single unaligned store.
+  memcpy(ReserveAppend(sizeof(T)), &v, sizeof(T));
+}
+
+Status BufferWriter::WriteChunkedToFile(File* file,
+                                        const uint8_t* buffer,
+                                        size_t size) {
+  size_t remaining_size = size;
+  const uint8_t* buf = buffer;
   while (remaining_size > 0) {
-    int64_t size_written = file->Write(buf, remaining_size);
+    const size_t chunk_size = std::min(remaining_size, kMaxWriteChunkSize);
+    int64_t size_written = file->Write(buf, chunk_size);
     if (size_written <= 0) {
       return Status(error::FILE_FAILURE,
                     "Fail to write to file in BufferWriter");
@@ -78,13 +142,41 @@ Status BufferWriter::WriteToFile(File* file) {
     remaining_size -= size_written;
     buf += size_written;
   }
-  buf_.clear();
   return Status::OK;
 }
 
-template <typename T>
-void BufferWriter::AppendInternal(T v) {
-  AppendArray(reinterpret_cast<uint8_t*>(&v), sizeof(T));
+void BufferWriter::EnsureCapacity(size_t size) {
+  if (size <= buf_.capacity())
+    return;
+  const size_t kMinimumCapacity = 64;
+  size_t new_capacity = std::max(buf_.capacity(), kMinimumCapacity);
+  while (new_capacity < size)
+    new_capacity *= 2;
+  buf_.reserve(new_capacity);
+  UpdateMemoryStats();
+}
+
+void BufferWriter::Swap(BufferWriter* buffer) {
+  buf_.swap(buffer->buf_);
+  UpdateMemoryStats();
+  buffer->UpdateMemoryStats();
+}
+
+void BufferWriter::SwapBuffer(std::vector<uint8_t>* buffer) {
+  buf_.swap(*buffer);
+  UpdateMemoryStats();
+}
+
+void BufferWriter::UpdateMemoryStats() {
+  const size_t capacity = buf_.capacity();
+  if (capacity > reported_capacity_) {
+    pipeline_stats::RecordMemoryAllocated(pipeline_stats::kMemoryBufferWriter,
+                                          capacity - reported_capacity_);
+  } else if (capacity < reported_capacity_) {
+    pipeline_stats::RecordMemoryFreed(pipeline_stats::kMemoryBufferWriter,
+                                      reported_capacity_ - capacity);
+  }
+  reported_capacity_ = capacity;
 }
 
 }  // namespace media
@@ -7,6 +7,7 @@
 #ifndef MEDIA_BASE_BUFFER_WRITER_H_
 #define MEDIA_BASE_BUFFER_WRITER_H_
 
+#include <type_traits>
 #include <vector>
 
 #include "packager/base/macros.h"
@@ -50,13 +51,43 @@ class BufferWriter {
   void AppendArray(const uint8_t* buf, size_t size);
   void AppendBuffer(const BufferWriter& buffer);
 
-  void Swap(BufferWriter* buffer) { buf_.swap(buffer->buf_); }
-  void SwapBuffer(std::vector<uint8_t>* buffer) { buf_.swap(*buffer); }
+  /// Append a column of fixed-width integers (in big endian), e.g. a whole
+  /// sample size table. Space for the column is reserved once and the values
+  /// are stored straight into it, instead of growing the buffer value by
+  /// value.
+  template <typename T>
+  void AppendColumn(const std::vector<T>& v) {
+    if (v.empty())
+      return;
+    uint8_t* dest = ReserveAppend(v.size() * sizeof(T));
+    for (size_t i = 0; i < v.size(); ++i) {
+      typename std::make_unsigned<T>::type value = v[i];
+      for (size_t j = sizeof(T); j > 0; --j) {
+        dest[j - 1] = static_cast<uint8_t>(value & 0xff);
+        value >>= 8;
+      }
+      dest += sizeof(T);
+    }
+  }
+
+  /// Grow the buffer by @a size bytes and return a pointer to the new region,
+  /// so callers can serialize directly into the buffer instead of staging the
+  /// bytes elsewhere and copying them in. The caller is expected to fill the
+  /// whole region. The pointer is invalidated by subsequent appends.
+  uint8_t* ReserveAppend(size_t size);
+
+  void Swap(BufferWriter* buffer);
+  void SwapBuffer(std::vector<uint8_t>* buffer);
 
   void Clear() { buf_.clear(); }
   size_t Size() const { return buf_.size(); }
   /// @return Underlying buffer. Behavior is undefined if the buffer size is 0.
   const uint8_t* Buffer() const { return buf_.data(); }
+  /// @return Mutable underlying buffer, which allows already appended data to
+  ///         be modified, e.g. encrypted in place. The pointer is invalidated
+  ///         by subsequent appends. Behavior is undefined if the buffer size
+  ///         is 0.
+  uint8_t* Buffer() { return buf_.data(); }
 
   /// Write the buffer to file. The internal buffer will be cleared after
   /// writing.
@@ -64,12 +95,36 @@ class BufferWriter {
   /// @return OK on success.
   Status WriteToFile(File* file);
 
+  /// Write several buffers to @a file back to back, e.g. a segment header
+  /// followed by the segment payload, in one call. The buffers are cleared
+  /// as they are written.
+  /// @param file should not be NULL.
+  /// @return OK on success.
+  static Status WriteBuffersToFile(File* file,
+                                   const std::vector<BufferWriter*>& buffers);
+
  private:
   // Internal implementation of multi-byte write.
   template <typename T>
   void AppendInternal(T v);
 
+  // Grow the capacity to hold at least |size| bytes, doubling on every
+  // reallocation so fragment-sized buffers reach steady state in a few
+  // appends regardless of the standard library's growth factor.
+  void EnsureCapacity(size_t size);
+
+  // Write |size| bytes from |buffer| to |file| in bounded chunks.
+  static Status WriteChunkedToFile(File* file,
+                                   const uint8_t* buffer,
+                                   size_t size);
+
+  // Reports capacity changes to the pipeline memory stats. Called wherever
+  // the capacity of |buf_| may have changed.
+  void UpdateMemoryStats();
+
   std::vector<uint8_t> buf_;
+  // Capacity last reported to the pipeline memory stats.
+  size_t reported_capacity_;
 
   DISALLOW_COPY_AND_ASSIGN(BufferWriter);
 };
@@ -6,6 +6,8 @@
 
 #include "packager/media/base/buffer_writer.h"
 
+#include <string.h>
+
 #include <limits>
 
 #include "packager/base/files/file_util.h"
@@ -110,6 +112,18 @@ TEST_F(BufferWriterTest, AppendVector) {
   ASSERT_EQ(v, data_read);
 }
 
+TEST_F(BufferWriterTest, AppendColumn) {
+  const uint32_t kColumn[] = {1, 0x0203, 0x04050607, 0xf0000000};
+  std::vector<uint32_t> column(kColumn, kColumn + arraysize(kColumn));
+  writer_->AppendColumn(column);
+  ASSERT_EQ(sizeof(kColumn), writer_->Size());
+
+  CreateReader();
+  std::vector<uint32_t> column_read;
+  ASSERT_TRUE(reader_->ReadColumn(&column_read, column.size()));
+  ASSERT_EQ(column, column_read);
+}
+
 TEST_F(BufferWriterTest, AppendArray) {
   writer_->AppendArray(kuint8Array, sizeof(kuint8Array));
   ASSERT_EQ(sizeof(kuint8Array), writer_->Size());
@@ -121,6 +135,22 @@ TEST_F(BufferWriterTest, AppendArray) {
     EXPECT_EQ(kuint8Array[i], data_read[i]);
 }
 
+TEST_F(BufferWriterTest, ReserveAppend) {
+  writer_->AppendInt(kuint8);
+  uint8_t* region = writer_->ReserveAppend(sizeof(kuint8Array));
+  ASSERT_EQ(sizeof(kuint8) + sizeof(kuint8Array), writer_->Size());
+  memcpy(region, kuint8Array, sizeof(kuint8Array));
+  writer_->AppendInt(kuint16);
+
+  CreateReader();
+  ASSERT_NO_FATAL_FAILURE(ReadAndExpect(kuint8));
+  std::vector<uint8_t> data_read;
+  ASSERT_TRUE(reader_->ReadToVector(&data_read, sizeof(kuint8Array)));
+  for (size_t i = 0; i < sizeof(kuint8Array); ++i)
+    EXPECT_EQ(kuint8Array[i], data_read[i]);
+  ASSERT_NO_FATAL_FAILURE(ReadAndExpect(kuint16));
+}
+
 TEST_F(BufferWriterTest, AppendBufferWriter) {
   BufferWriter local_writer;
   local_writer.AppendInt(kuint16);
@@ -184,5 +214,38 @@ TEST_F(BufferWriterTest, WriteToFile) {
     EXPECT_EQ(kuint8Array[i], data_read[i]);
 }
 
+TEST_F(BufferWriterTest, WriteBuffersToFile) {
+  base::FilePath path;
+  ASSERT_TRUE(base::CreateTemporaryFile(&path));
+  LOG(INFO) << "Created temporary file: " << path.value();
+
+  // Write two buffers back to back and verify the concatenated content.
+  File* const output_file = File::Open(path.value().c_str(), "w");
+  writer_->AppendInt(kuint32);
+  BufferWriter local_writer;
+  local_writer.AppendArray(kuint8Array, sizeof(kuint8Array));
+  std::vector<BufferWriter*> buffers;
+  buffers.push_back(writer_.get());
+  buffers.push_back(&local_writer);
+  ASSERT_OK(BufferWriter::WriteBuffersToFile(output_file, buffers));
+  ASSERT_EQ(0u, writer_->Size());
+  ASSERT_EQ(0u, local_writer.Size());
+  ASSERT_TRUE(output_file->Close());
+
+  File* const input_file = File::Open(path.value().c_str(), "r");
+  ASSERT_TRUE(input_file != NULL);
+  const size_t kExpectedSize = sizeof(kuint32) + sizeof(kuint8Array);
+  std::vector<uint8_t> data_read(kExpectedSize, 0);
+  EXPECT_EQ(
+      kExpectedSize,
+      static_cast<size_t>(input_file->Read(&data_read[0], data_read.size())));
+  ASSERT_TRUE(input_file->Close());
+
+  reader_.reset(new BufferReader(&data_read[0], data_read.size()));
+  ASSERT_NO_FATAL_FAILURE(ReadAndExpect(kuint32));
+  for (size_t i = 0; i < sizeof(kuint8Array); ++i)
+    EXPECT_EQ(kuint8Array[i], data_read[sizeof(kuint32) + i]);
+}
+
 }  // namespace media
 }  // namespace shaka
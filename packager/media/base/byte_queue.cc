@@ -4,12 +4,15 @@
 
 #include "packager/media/base/byte_queue.h"
 
+#include <algorithm>
+
 #include "packager/base/logging.h"
+#include "packager/media/base/pipeline_stats.h"
 
 namespace shaka {
 namespace media {
 
-// Default starting size for the queue.
+// Default starting size for the queue. Must be a power of two.
 enum { kDefaultQueueSize = 1024 };
 
 ByteQueue::ByteQueue()
@@ -17,9 +20,13 @@ ByteQueue::ByteQueue()
       size_(kDefaultQueueSize),
       offset_(0),
       used_(0) {
+  pipeline_stats::RecordMemoryAllocated(pipeline_stats::kMemoryByteQueue,
+                                        size_);
 }
 
-ByteQueue::~ByteQueue() {}
+ByteQueue::~ByteQueue() {
+  pipeline_stats::RecordMemoryFreed(pipeline_stats::kMemoryByteQueue, size_);
+}
 
 void ByteQueue::Reset() {
   offset_ = 0;
@@ -32,10 +39,13 @@ void ByteQueue::Push(const uint8_t* data, int size) {
 
   size_t size_needed = used_ + size;
 
-  // Check to see if we need a bigger buffer.
-  if (size_needed > size_) {
+  // Grow the buffer when the queue would become more than half full. The
+  // slack bounds how often the contents wrap around the end of the buffer,
+  // which keeps the unwrap in Peek() amortized constant per pushed byte.
+  if (size_needed > size_ / 2) {
+    // Doubling keeps the size a power of two.
     size_t new_size = 2 * size_;
-    while (size_needed > new_size && new_size > size_)
+    while (size_needed > new_size / 2 && new_size > size_)
       new_size *= 2;
 
     // Sanity check to make sure we didn't overflow.
@@ -43,26 +53,41 @@ void ByteQueue::Push(const uint8_t* data, int size) {
 
     scoped_ptr<uint8_t[]> new_buffer(new uint8_t[new_size]);
 
-    // Copy the data from the old buffer to the start of the new one.
-    if (used_ > 0)
-      memcpy(new_buffer.get(), front(), used_);
+    // Copy the data to the start of the new buffer, unwrapping it in the
+    // process.
+    if (used_ > 0) {
+      size_t tail_size =
+          std::min(static_cast<size_t>(used_), size_ - offset_);
+      memcpy(new_buffer.get(), buffer_.get() + offset_, tail_size);
+      memcpy(new_buffer.get() + tail_size, buffer_.get(), used_ - tail_size);
+    }
 
     buffer_.reset(new_buffer.release());
+    pipeline_stats::RecordMemoryAllocated(pipeline_stats::kMemoryByteQueue,
+                                          new_size - size_);
     size_ = new_size;
     offset_ = 0;
-  } else if ((offset_ + used_ + size) > size_) {
-    // The buffer is big enough, but we need to move the data in the queue.
-    memmove(buffer_.get(), front(), used_);
-    offset_ = 0;
   }
 
-  memcpy(front() + used_, data, size);
+  // Copy the new bytes into the ring, wrapping around the end of the buffer
+  // if necessary. Bytes already in the queue are never moved here.
+  size_t write_pos = (offset_ + used_) & (size_ - 1);
+  size_t contiguous =
+      std::min(static_cast<size_t>(size), size_ - write_pos);
+  memcpy(buffer_.get() + write_pos, data, contiguous);
+  memcpy(buffer_.get(), data + contiguous, size - contiguous);
   used_ += size;
 }
 
-void ByteQueue::Peek(const uint8_t** data, int* size) const {
+void ByteQueue::Peek(const uint8_t** data, int* size) {
   DCHECK(data);
   DCHECK(size);
+
+  // Callers expect to see the whole queue as one contiguous range, so unwrap
+  // the ring if the contents straddle the end of the buffer.
+  if (offset_ + used_ > size_)
+    Linearize();
+
   *data = front();
   *size = used_;
 }
@@ -70,19 +95,40 @@ void ByteQueue::Peek(const uint8_t** data, int* size) const {
 void ByteQueue::Pop(int count) {
   DCHECK_LE(count, used_);
 
-  offset_ += count;
+  offset_ = (offset_ + count) & (size_ - 1);
   used_ -= count;
 
-  // Move the offset back to 0 if we have reached the end of the buffer.
-  if (offset_ == size_) {
-    DCHECK_EQ(used_, 0);
+  // Restart from the beginning of the buffer when the queue drains to
+  // postpone the next wrap as long as possible.
+  if (used_ == 0)
     offset_ = 0;
-  }
 }
 
 uint8_t* ByteQueue::front() const {
   return buffer_.get() + offset_;
 }
 
+void ByteQueue::Linearize() {
+  DCHECK_GT(offset_ + used_, size_);
+
+  // The queue wraps: [offset_, size_) holds the front of the queue and
+  // [0, wrapped_size) holds the rest. Rotate the two segments into place
+  // through a scratch copy of the smaller one.
+  size_t front_size = size_ - offset_;
+  size_t wrapped_size = used_ - front_size;
+  if (front_size <= wrapped_size) {
+    scoped_ptr<uint8_t[]> scratch(new uint8_t[front_size]);
+    memcpy(scratch.get(), buffer_.get() + offset_, front_size);
+    memmove(buffer_.get() + front_size, buffer_.get(), wrapped_size);
+    memcpy(buffer_.get(), scratch.get(), front_size);
+  } else {
+    scoped_ptr<uint8_t[]> scratch(new uint8_t[wrapped_size]);
+    memcpy(scratch.get(), buffer_.get(), wrapped_size);
+    memmove(buffer_.get(), buffer_.get() + offset_, front_size);
+    memcpy(buffer_.get() + front_size, scratch.get(), wrapped_size);
+  }
+  offset_ = 0;
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -29,23 +29,32 @@ class ByteQueue {
   void Push(const uint8_t* data, int size);
 
   /// Get a pointer to the front of the queue and the queue size.
-  /// These values are only valid until the next Push() or Pop() call.
-  void Peek(const uint8_t** data, int* size) const;
+  /// These values are only valid until the next Push() or Pop() call. This
+  /// call may rearrange the underlying storage to make the queued bytes
+  /// contiguous.
+  void Peek(const uint8_t** data, int* size);
 
   /// Remove a number of bytes from the front of the queue.
   /// @param count specifies number of bytes to be popped.
   void Pop(int count);
 
  private:
-  // Returns a pointer to the front of the queue.
+  // Returns a pointer to the front of the queue. Only meaningful when the
+  // queued bytes do not wrap around the end of |buffer_|.
   uint8_t* front() const;
 
+  // Rotate the queued bytes so they start at the beginning of |buffer_|.
+  // Called by Peek() when the contents wrap around the end of the buffer.
+  void Linearize();
+
   scoped_ptr<uint8_t[]> buffer_;
 
-  // Size of |buffer_|.
+  // Size of |buffer_|. Always a power of two so ring positions can be
+  // wrapped with a mask.
   size_t size_;
 
-  // Offset from the start of |buffer_| that marks the front of the queue.
+  // Index into |buffer_| that marks the front of the queue. The contents may
+  // wrap around the end of the buffer.
   size_t offset_;
 
   // Number of bytes stored in the queue.
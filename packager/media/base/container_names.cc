@@ -1664,10 +1664,57 @@ bool CheckTtml(const uint8_t* buffer, int buffer_size) {
 
 }  // namespace
 
+// O(1) dispatch on the leading bytes for the containers that dominate real
+// inputs. Each check reads a fixed number of bytes near the start of the
+// buffer and verifies just enough to rule out false positives; anything
+// ambiguous returns CONTAINER_UNKNOWN so the caller falls through to the
+// thorough scanning probes.
+static MediaContainerName SniffCommonContainers(const uint8_t* buffer,
+                                                int buffer_size) {
+  if (buffer_size < 16)
+    return CONTAINER_UNKNOWN;
+
+  // MP4 family: 32-bit box size followed by an "ftyp" box type.
+  if (Read32(buffer + 4) == TAG('f', 't', 'y', 'p'))
+    return CONTAINER_MOV;
+
+  // WebM: EBML header id. CheckWebm() parses only the small EBML header to
+  // verify the DocType, so it stays cheap.
+  if (Read32(buffer) == 0x1a45dfa3 && CheckWebm(buffer, buffer_size))
+    return CONTAINER_WEBM;
+
+  // MPEG-2 TS: sync bytes at three consecutive 188-byte packet boundaries.
+  if (buffer[0] == kMpeg2SyncWord && buffer_size > 2 * 188 &&
+      buffer[188] == kMpeg2SyncWord && buffer[2 * 188] == kMpeg2SyncWord) {
+    return CONTAINER_MPEG2TS;
+  }
+
+  // ADTS AAC: 12-bit syncword with layer 0 and a valid sampling frequency,
+  // confirmed by a syncword at the start of the next frame.
+  if (buffer[0] == 0xff && (buffer[1] & 0xf6) == 0xf0 &&
+      ((buffer[2] >> 2) & 0xf) != 15) {
+    const int frame_size =
+        ((buffer[3] & 0x3) << 11) | (buffer[4] << 3) | (buffer[5] >> 5);
+    if (frame_size > 6 && frame_size + 1 < buffer_size &&
+        buffer[frame_size] == 0xff &&
+        (buffer[frame_size + 1] & 0xf6) == 0xf0) {
+      return CONTAINER_AAC;
+    }
+  }
+
+  return CONTAINER_UNKNOWN;
+}
+
 // Attempt to determine the container name from the buffer provided.
 MediaContainerName DetermineContainer(const uint8_t* buffer, int buffer_size) {
   DCHECK(buffer);
 
+  // First try the cheap magic-byte dispatch; on a miss fall through to the
+  // expensive probes below.
+  MediaContainerName sniff_result = SniffCommonContainers(buffer, buffer_size);
+  if (sniff_result != CONTAINER_UNKNOWN)
+    return sniff_result;
+
   // Since MOV/QuickTime/MPEG4 streams are common, check for them first.
   if (CheckMov(buffer, buffer_size))
     return CONTAINER_MOV;
@@ -1736,6 +1783,8 @@ MediaContainerName DetermineContainerFromFormatName(
   } else if (base::EqualsCaseInsensitiveASCII(format_name, "ts") ||
              base::EqualsCaseInsensitiveASCII(format_name, "mpeg2ts")) {
     return CONTAINER_MPEG2TS;
+  } else if (base::EqualsCaseInsensitiveASCII(format_name, "escache")) {
+    return CONTAINER_ESCACHE;
   }
   return CONTAINER_UNKNOWN;
 }
@@ -55,6 +55,8 @@ enum MediaContainerName {
   CONTAINER_WEBM,             // Matroska / WebM
   CONTAINER_WEBVTT,           // WebVTT file.
   CONTAINER_WTV,              // WTV (Windows Television)
+  CONTAINER_ESCACHE,          // Elementary-stream cache (SPES); see
+                              // media/formats/escache/es_cache_format.h
   CONTAINER_MAX               // Must be last
 };
 
@@ -0,0 +1,76 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/crc32.h"
+
+#include "packager/base/lazy_instance.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const uint32_t kCrcPoly = 0x04c11db7;
+
+// Slicing tables: table[k][b] is the CRC contribution of byte |b| followed by
+// |k| zero bytes. table[0] is the classic byte-at-a-time table. Generated
+// once on first use; 8 KB total.
+struct CrcTables {
+  CrcTables() {
+    for (int b = 0; b < 256; ++b) {
+      uint32_t crc = static_cast<uint32_t>(b) << 24;
+      for (int bit = 0; bit < 8; ++bit)
+        crc = (crc & 0x80000000u) ? (crc << 1) ^ kCrcPoly : (crc << 1);
+      table[0][b] = crc;
+    }
+    for (int k = 1; k < 8; ++k) {
+      for (int b = 0; b < 256; ++b) {
+        const uint32_t prev = table[k - 1][b];
+        table[k][b] = table[0][(prev >> 24) & 0xff] ^ (prev << 8);
+      }
+    }
+  }
+
+  uint32_t table[8][256];
+};
+
+base::LazyInstance<CrcTables>::Leaky g_crc_tables = LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+uint32_t Crc32Mpeg2(const uint8_t* data, size_t size) {
+  const CrcTables& tables = g_crc_tables.Get();
+  uint32_t crc = 0xffffffffu;
+
+  // Eight bytes per step: fold the running crc into the first four input
+  // bytes, then look up the contribution of each of the eight bytes
+  // independently and combine. The eight loads are independent, so they
+  // pipeline much better than the byte-at-a-time loop, where every lookup
+  // depends on the previous one.
+  while (size >= 8) {
+    const uint32_t high = crc ^ ((static_cast<uint32_t>(data[0]) << 24) |
+                                 (static_cast<uint32_t>(data[1]) << 16) |
+                                 (static_cast<uint32_t>(data[2]) << 8) |
+                                 static_cast<uint32_t>(data[3]));
+    crc = tables.table[7][(high >> 24) & 0xff] ^
+          tables.table[6][(high >> 16) & 0xff] ^
+          tables.table[5][(high >> 8) & 0xff] ^
+          tables.table[4][high & 0xff] ^
+          tables.table[3][data[4]] ^
+          tables.table[2][data[5]] ^
+          tables.table[1][data[6]] ^
+          tables.table[0][data[7]];
+    data += 8;
+    size -= 8;
+  }
+
+  // Remaining tail, byte at a time.
+  for (size_t i = 0; i < size; ++i)
+    crc = tables.table[0][((crc >> 24) ^ data[i]) & 0xff] ^ (crc << 8);
+  return crc;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,70 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/crc32.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace shaka {
+namespace media {
+namespace {
+
+// The CRC32/MPEG-2 catalogue check value for the input "123456789".
+const uint32_t kCheckValue = 0x0376e6e7;
+
+// Reference byte-at-a-time implementation, bit by bit.
+uint32_t ReferenceCrc32Mpeg2(const uint8_t* data, size_t size) {
+  const uint32_t kCrcPoly = 0x04c11db7;
+  uint32_t crc = 0xffffffffu;
+  for (size_t i = 0; i < size; ++i) {
+    crc ^= static_cast<uint32_t>(data[i]) << 24;
+    for (int bit = 0; bit < 8; ++bit)
+      crc = (crc & 0x80000000u) ? (crc << 1) ^ kCrcPoly : (crc << 1);
+  }
+  return crc;
+}
+
+}  // namespace
+
+TEST(Crc32Test, CheckValue) {
+  const uint8_t kInput[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  EXPECT_EQ(kCheckValue, Crc32Mpeg2(kInput, sizeof(kInput)));
+}
+
+TEST(Crc32Test, EmptyInput) {
+  EXPECT_EQ(0xffffffffu, Crc32Mpeg2(NULL, 0));
+}
+
+// Exercise all tail lengths around the 8-byte stride against the reference
+// implementation.
+TEST(Crc32Test, MatchesReferenceForAllTailLengths) {
+  std::vector<uint8_t> input;
+  for (size_t size = 0; size < 64; ++size) {
+    EXPECT_EQ(ReferenceCrc32Mpeg2(input.data(), input.size()),
+              Crc32Mpeg2(input.data(), input.size()))
+        << "size=" << size;
+    input.push_back(static_cast<uint8_t>(size * 77 + 5));
+  }
+}
+
+// A section followed by its own CRC computes to zero; the TS PSI parser
+// relies on this to validate sections.
+TEST(Crc32Test, SectionWithTrailingCrcIsZero) {
+  std::vector<uint8_t> section;
+  for (size_t i = 0; i < 100; ++i)
+    section.push_back(static_cast<uint8_t>(i * 31 + 7));
+  const uint32_t crc = Crc32Mpeg2(section.data(), section.size());
+  section.push_back((crc >> 24) & 0xff);
+  section.push_back((crc >> 16) & 0xff);
+  section.push_back((crc >> 8) & 0xff);
+  section.push_back(crc & 0xff);
+  EXPECT_EQ(0u, Crc32Mpeg2(section.data(), section.size()));
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -4,10 +4,90 @@
 
 #include "packager/media/base/decrypt_config.h"
 
+#include "packager/base/lazy_instance.h"
 #include "packager/base/logging.h"
+#include "packager/base/synchronization/lock.h"
 
 namespace shaka {
 namespace media {
+namespace {
+
+// Free list of recycled DecryptConfig instances. Parsers create and destroy
+// one config per encrypted sample; recycling keeps the instances (and the
+// capacity of their internal vectors) out of the allocator. The cap bounds
+// the footprint to a handful of small objects while covering the configs in
+// flight in a pipeline.
+const size_t kMaxFreeConfigs = 32;
+
+class DecryptConfigPool {
+ public:
+  DecryptConfigPool() {}
+
+  DecryptConfig* Take() {
+    base::AutoLock auto_lock(lock_);
+    if (free_configs_.empty())
+      return NULL;
+    DecryptConfig* config = free_configs_.back();
+    free_configs_.pop_back();
+    return config;
+  }
+
+  // Takes ownership of |config|. Deletes it if the free list is full.
+  void Put(DecryptConfig* config) {
+    {
+      base::AutoLock auto_lock(lock_);
+      if (free_configs_.size() < kMaxFreeConfigs) {
+        free_configs_.push_back(config);
+        return;
+      }
+    }
+    delete config;
+  }
+
+ private:
+  base::Lock lock_;
+  std::vector<DecryptConfig*> free_configs_;
+
+  DISALLOW_COPY_AND_ASSIGN(DecryptConfigPool);
+};
+
+base::LazyInstance<DecryptConfigPool>::Leaky g_decrypt_config_pool =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+// static
+scoped_ptr<DecryptConfig> DecryptConfig::Create(
+    const std::vector<uint8_t>& key_id,
+    const std::vector<uint8_t>& iv,
+    const std::vector<SubsampleEntry>& subsamples) {
+  return Create(key_id, iv, subsamples, FOURCC_cenc, 0, 0);
+}
+
+// static
+scoped_ptr<DecryptConfig> DecryptConfig::Create(
+    const std::vector<uint8_t>& key_id,
+    const std::vector<uint8_t>& iv,
+    const std::vector<SubsampleEntry>& subsamples,
+    FourCC protection_scheme,
+    uint8_t crypt_byte_block,
+    uint8_t skip_byte_block) {
+  scoped_ptr<DecryptConfig> config(g_decrypt_config_pool.Pointer()->Take());
+  if (config) {
+    config->Reset(key_id, iv, subsamples, protection_scheme, crypt_byte_block,
+                  skip_byte_block);
+    return config.Pass();
+  }
+  return scoped_ptr<DecryptConfig>(new DecryptConfig(
+      key_id, iv, subsamples, protection_scheme, crypt_byte_block,
+      skip_byte_block));
+}
+
+// static
+void DecryptConfig::Recycle(scoped_ptr<DecryptConfig> config) {
+  DCHECK(config);
+  g_decrypt_config_pool.Pointer()->Put(config.release());
+}
 
 DecryptConfig::DecryptConfig(const std::vector<uint8_t>& key_id,
                              const std::vector<uint8_t>& iv,
@@ -31,5 +111,20 @@ DecryptConfig::DecryptConfig(const std::vector<uint8_t>& key_id,
 
 DecryptConfig::~DecryptConfig() {}
 
+void DecryptConfig::Reset(const std::vector<uint8_t>& key_id,
+                          const std::vector<uint8_t>& iv,
+                          const std::vector<SubsampleEntry>& subsamples,
+                          FourCC protection_scheme,
+                          uint8_t crypt_byte_block,
+                          uint8_t skip_byte_block) {
+  CHECK_GT(key_id.size(), 0u);
+  key_id_ = key_id;
+  iv_ = iv;
+  subsamples_ = subsamples;
+  protection_scheme_ = protection_scheme;
+  crypt_byte_block_ = crypt_byte_block;
+  skip_byte_block_ = skip_byte_block;
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -42,6 +42,32 @@ class DecryptConfig {
   /// Keys are always 128 bits.
   static const size_t kDecryptionKeySize = 16;
 
+  /// Acquire a 'cenc' decrypt config from the process-wide pool. Parsers
+  /// create one config per encrypted sample, so the config object and the
+  /// heap capacity of its key id, iv and subsample vectors are recycled
+  /// rather than round-tripped through the allocator for every sample.
+  /// Parameters are as in the corresponding constructor.
+  static scoped_ptr<DecryptConfig> Create(
+      const std::vector<uint8_t>& key_id,
+      const std::vector<uint8_t>& iv,
+      const std::vector<SubsampleEntry>& subsamples);
+
+  /// Acquire a general decrypt config with possible pattern-based encryption
+  /// from the process-wide pool. Parameters are as in the corresponding
+  /// constructor.
+  static scoped_ptr<DecryptConfig> Create(
+      const std::vector<uint8_t>& key_id,
+      const std::vector<uint8_t>& iv,
+      const std::vector<SubsampleEntry>& subsamples,
+      FourCC protection_scheme,
+      uint8_t crypt_byte_block,
+      uint8_t skip_byte_block);
+
+  /// Return @a config to the process-wide pool for reuse by a later
+  /// Create() call. Deleting a config instead of recycling it is harmless;
+  /// recycling merely avoids the allocation churn.
+  static void Recycle(scoped_ptr<DecryptConfig> config);
+
   /// Create a 'cenc' decrypt config.
   /// @param key_id is the ID that references the decryption key.
   /// @param iv is the initialization vector defined by the encryptor.
@@ -81,19 +107,29 @@ class DecryptConfig {
   uint8_t skip_byte_block() const { return skip_byte_block_; }
 
  private:
-  const std::vector<uint8_t> key_id_;
+  // Reinitializes a pooled instance in place for Create(). Assigning into
+  // the existing vectors reuses their heap capacity.
+  void Reset(const std::vector<uint8_t>& key_id,
+             const std::vector<uint8_t>& iv,
+             const std::vector<SubsampleEntry>& subsamples,
+             FourCC protection_scheme,
+             uint8_t crypt_byte_block,
+             uint8_t skip_byte_block);
+
+  // Non-const so pooled instances can be reinitialized via Reset().
+  std::vector<uint8_t> key_id_;
 
   // Initialization vector.
-  const std::vector<uint8_t> iv_;
+  std::vector<uint8_t> iv_;
 
   // Subsample information. May be empty for some formats, meaning entire frame
   // (less data ignored by data_offset_) is encrypted.
-  const std::vector<SubsampleEntry> subsamples_;
+  std::vector<SubsampleEntry> subsamples_;
 
-  const FourCC protection_scheme_;
+  FourCC protection_scheme_;
   // For pattern-based protection schemes, like CENS and CBCS.
-  const uint8_t crypt_byte_block_;
-  const uint8_t skip_byte_block_;
+  uint8_t crypt_byte_block_;
+  uint8_t skip_byte_block_;
 
   DISALLOW_COPY_AND_ASSIGN(DecryptConfig);
 };
@@ -6,6 +6,7 @@
 
 #include "packager/media/base/decryptor_source.h"
 
+#include "packager/base/bind.h"
 #include "packager/base/logging.h"
 #include "packager/base/stl_util.h"
 #include "packager/media/base/aes_decryptor.h"
@@ -15,10 +16,23 @@ namespace shaka {
 namespace media {
 
 DecryptorSource::DecryptorSource(KeySource* key_source)
-    : key_source_(key_source) {
+    : key_source_(key_source),
+      cv_(&lock_),
+      decrypting_(false),
+      decrypt_error_(false),
+      decrypt_thread_exit_(false) {
   CHECK(key_source);
 }
+
 DecryptorSource::~DecryptorSource() {
+  if (decrypt_thread_) {
+    {
+      base::AutoLock auto_lock(lock_);
+      decrypt_thread_exit_ = true;
+      cv_.Broadcast();
+    }
+    decrypt_thread_->Join();
+  }
   STLDeleteValues(&decryptor_map_);
 }
 
@@ -28,63 +42,111 @@ bool DecryptorSource::DecryptSampleBuffer(const DecryptConfig* decrypt_config,
   DCHECK(decrypt_config);
   DCHECK(buffer);
 
-  // Get the decryptor object.
-  AesCryptor* decryptor;
-  auto found = decryptor_map_.find(decrypt_config->key_id());
-  if (found == decryptor_map_.end()) {
-    // Create new AesDecryptor based on decryption mode.
-    EncryptionKey key;
-    Status status(key_source_->GetKey(decrypt_config->key_id(), &key));
-    if (!status.ok()) {
-      LOG(ERROR) << "Error retrieving decryption key: " << status;
-      return false;
-    }
+  AesCryptor* decryptor = GetDecryptor(*decrypt_config);
+  if (!decryptor)
+    return false;
+  return DecryptBuffer(decryptor, *decrypt_config, buffer, buffer_size);
+}
 
-    scoped_ptr<AesCryptor> aes_decryptor;
-    switch (decrypt_config->protection_scheme()) {
-      case FOURCC_cenc:
-        aes_decryptor.reset(new AesCtrDecryptor);
-        break;
-      case FOURCC_cbc1:
-        aes_decryptor.reset(new AesCbcDecryptor(kNoPadding));
-        break;
-      case FOURCC_cens:
-        aes_decryptor.reset(new AesPatternCryptor(
-            decrypt_config->crypt_byte_block(),
-            decrypt_config->skip_byte_block(),
-            AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
-            AesCryptor::kDontUseConstantIv,
-            scoped_ptr<AesCryptor>(new AesCtrDecryptor())));
-        break;
-      case FOURCC_cbcs:
-        aes_decryptor.reset(new AesPatternCryptor(
-            decrypt_config->crypt_byte_block(),
-            decrypt_config->skip_byte_block(),
-            AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
-            AesCryptor::kUseConstantIv,
-            scoped_ptr<AesCryptor>(new AesCbcDecryptor(kNoPadding))));
-        break;
-      default:
-        LOG(ERROR) << "Unsupported protection scheme: "
-                   << decrypt_config->protection_scheme();
-        return false;
-    }
+bool DecryptorSource::DecryptSampleBufferAsync(
+    scoped_ptr<DecryptConfig> decrypt_config,
+    uint8_t* buffer,
+    size_t buffer_size) {
+  DCHECK(decrypt_config);
+  DCHECK(buffer);
 
-    if (!aes_decryptor->InitializeWithIv(key.key, decrypt_config->iv())) {
-      LOG(ERROR) << "Failed to initialize AesDecryptor for decryption.";
-      return false;
-    }
-    decryptor = aes_decryptor.release();
-    decryptor_map_[decrypt_config->key_id()] = decryptor;
-  } else {
-    decryptor = found->second;
+  // Resolve the decryptor on the calling thread: the key fetch may block and
+  // its failure should be reported synchronously. The map is only mutated
+  // here; the decryption thread merely uses the (stable) cached decryptors,
+  // one job at a time.
+  AesCryptor* decryptor = GetDecryptor(*decrypt_config);
+  if (!decryptor)
+    return false;
+
+  base::AutoLock auto_lock(lock_);
+  if (!decrypt_thread_) {
+    decrypt_thread_.reset(new ClosureThread(
+        "DecryptThread", base::Bind(&DecryptorSource::DecryptThreadMain,
+                                    base::Unretained(this))));
+    decrypt_thread_->Start();
+  }
+  PendingDecrypt pending = {decryptor, decrypt_config.release(), buffer,
+                            buffer_size};
+  pending_decrypts_.push_back(pending);
+  cv_.Broadcast();
+  return true;
+}
+
+bool DecryptorSource::WaitForPendingDecrypt() {
+  base::AutoLock auto_lock(lock_);
+  while (!pending_decrypts_.empty() || decrypting_)
+    cv_.Wait();
+  const bool success = !decrypt_error_;
+  decrypt_error_ = false;
+  return success;
+}
+
+AesCryptor* DecryptorSource::GetDecryptor(
+    const DecryptConfig& decrypt_config) {
+  auto found = decryptor_map_.find(decrypt_config.key_id());
+  if (found != decryptor_map_.end())
+    return found->second;
+
+  // Create new AesDecryptor based on decryption mode.
+  EncryptionKey key;
+  Status status(key_source_->GetKey(decrypt_config.key_id(), &key));
+  if (!status.ok()) {
+    LOG(ERROR) << "Error retrieving decryption key: " << status;
+    return NULL;
   }
-  if (!decryptor->SetIv(decrypt_config->iv())) {
+
+  scoped_ptr<AesCryptor> aes_decryptor;
+  switch (decrypt_config.protection_scheme()) {
+    case FOURCC_cenc:
+      aes_decryptor.reset(new AesCtrDecryptor);
+      break;
+    case FOURCC_cbc1:
+      aes_decryptor.reset(new AesCbcDecryptor(kNoPadding));
+      break;
+    case FOURCC_cens:
+      aes_decryptor.reset(new AesPatternCryptor(
+          decrypt_config.crypt_byte_block(), decrypt_config.skip_byte_block(),
+          AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
+          AesCryptor::kDontUseConstantIv,
+          scoped_ptr<AesCryptor>(new AesCtrDecryptor())));
+      break;
+    case FOURCC_cbcs:
+      aes_decryptor.reset(new AesPatternCryptor(
+          decrypt_config.crypt_byte_block(), decrypt_config.skip_byte_block(),
+          AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
+          AesCryptor::kUseConstantIv,
+          scoped_ptr<AesCryptor>(new AesCbcDecryptor(kNoPadding))));
+      break;
+    default:
+      LOG(ERROR) << "Unsupported protection scheme: "
+                 << decrypt_config.protection_scheme();
+      return NULL;
+  }
+
+  if (!aes_decryptor->InitializeWithIv(key.key, decrypt_config.iv())) {
+    LOG(ERROR) << "Failed to initialize AesDecryptor for decryption.";
+    return NULL;
+  }
+  AesCryptor* decryptor = aes_decryptor.release();
+  decryptor_map_[decrypt_config.key_id()] = decryptor;
+  return decryptor;
+}
+
+bool DecryptorSource::DecryptBuffer(AesCryptor* decryptor,
+                                    const DecryptConfig& decrypt_config,
+                                    uint8_t* buffer,
+                                    size_t buffer_size) {
+  if (!decryptor->SetIv(decrypt_config.iv())) {
     LOG(ERROR) << "Invalid initialization vector.";
     return false;
   }
 
-  if (decrypt_config->subsamples().empty()) {
+  if (decrypt_config.subsamples().empty()) {
     // Sample not encrypted using subsample encryption. Decrypt whole.
     if (!decryptor->Crypt(buffer, buffer_size, buffer)) {
       LOG(ERROR) << "Error during bulk sample decryption.";
@@ -94,7 +156,7 @@ bool DecryptorSource::DecryptSampleBuffer(const DecryptConfig* decrypt_config,
   }
 
   // Subsample decryption.
-  const std::vector<SubsampleEntry>& subsamples = decrypt_config->subsamples();
+  const std::vector<SubsampleEntry>& subsamples = decrypt_config.subsamples();
   uint8_t* current_ptr = buffer;
   const uint8_t* const buffer_end = buffer + buffer_size;
   for (const auto& subsample : subsamples) {
@@ -113,5 +175,34 @@ bool DecryptorSource::DecryptSampleBuffer(const DecryptConfig* decrypt_config,
   return true;
 }
 
+void DecryptorSource::DecryptThreadMain() {
+  base::AutoLock auto_lock(lock_);
+  while (true) {
+    while (pending_decrypts_.empty() && !decrypt_thread_exit_)
+      cv_.Wait();
+    // Drain all pending decryptions before exiting.
+    if (pending_decrypts_.empty() && decrypt_thread_exit_)
+      return;
+
+    PendingDecrypt pending = pending_decrypts_.front();
+    pending_decrypts_.pop_front();
+    decrypting_ = true;
+
+    bool success;
+    {
+      base::AutoUnlock auto_unlock(lock_);
+      scoped_ptr<DecryptConfig> decrypt_config(pending.decrypt_config);
+      success = DecryptBuffer(pending.decryptor, *decrypt_config,
+                              pending.buffer, pending.buffer_size);
+      DecryptConfig::Recycle(decrypt_config.Pass());
+    }
+
+    if (!success)
+      decrypt_error_ = true;
+    decrypting_ = false;
+    cv_.Broadcast();
+  }
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -7,10 +7,15 @@
 #ifndef MEDIA_BASE_DECRYPTOR_SOURCE_H_
 #define MEDIA_BASE_DECRYPTOR_SOURCE_H_
 
+#include <deque>
 #include <map>
 #include <vector>
 
+#include "packager/base/memory/scoped_ptr.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/media/base/aes_decryptor.h"
+#include "packager/media/base/closure_thread.h"
 #include "packager/media/base/decrypt_config.h"
 #include "packager/media/base/key_source.h"
 
@@ -27,10 +32,56 @@ class DecryptorSource {
                            uint8_t* buffer,
                            size_t buffer_size);
 
+  /// Queues decryption of @a buffer on a decryption thread and returns
+  /// immediately, so the caller can overlap decryption with other work.
+  /// @a buffer must remain valid and untouched until the decryption has been
+  /// waited for with WaitForPendingDecrypt(). Must not be interleaved with
+  /// DecryptSampleBuffer() calls on the same instance.
+  /// @return false if the decryptor cannot be set up, e.g. key fetch failure;
+  ///         decryption errors are reported by WaitForPendingDecrypt().
+  bool DecryptSampleBufferAsync(scoped_ptr<DecryptConfig> decrypt_config,
+                                uint8_t* buffer,
+                                size_t buffer_size);
+
+  /// Blocks until all decryptions queued with DecryptSampleBufferAsync() have
+  /// completed.
+  /// @return true if they all succeeded.
+  bool WaitForPendingDecrypt();
+
  private:
+  struct PendingDecrypt {
+    AesCryptor* decryptor;
+    DecryptConfig* decrypt_config;  // Owned; deleted after decryption.
+    uint8_t* buffer;
+    size_t buffer_size;
+  };
+
+  // Returns the decryptor for the key id in |decrypt_config|, creating and
+  // caching it on first use. Returns NULL on failure.
+  AesCryptor* GetDecryptor(const DecryptConfig& decrypt_config);
+  // Sets the IV and decrypts |buffer| in place.
+  static bool DecryptBuffer(AesCryptor* decryptor,
+                            const DecryptConfig& decrypt_config,
+                            uint8_t* buffer,
+                            size_t buffer_size);
+  void DecryptThreadMain();
+
   KeySource* key_source_;
   std::map<std::vector<uint8_t>, AesCryptor*> decryptor_map_;
 
+  // The thread that applies queued decryptions. Created lazily on the first
+  // DecryptSampleBufferAsync() call.
+  scoped_ptr<ClosureThread> decrypt_thread_;
+  // Protects the members below.
+  base::Lock lock_;
+  base::ConditionVariable cv_;
+  std::deque<PendingDecrypt> pending_decrypts_;
+  // True while the decryption thread is applying a dequeued job.
+  bool decrypting_;
+  // Sticky until the next WaitForPendingDecrypt() call.
+  bool decrypt_error_;
+  bool decrypt_thread_exit_;
+
   DISALLOW_COPY_AND_ASSIGN(DecryptorSource);
 };
 
@@ -158,6 +158,38 @@ TEST_F(DecryptorSourceTest, SubsampleDecryptionSizeValidation) {
       &decrypt_config, &buffer_[0], buffer_.size()));
 }
 
+TEST_F(DecryptorSourceTest, AsyncFullSampleDecryption) {
+  EncryptionKey encryption_key;
+  encryption_key.key.assign(kMockKey, kMockKey + arraysize(kMockKey));
+  EXPECT_CALL(mock_key_source_, GetKey(key_id_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(encryption_key), Return(Status::OK)));
+
+  scoped_ptr<DecryptConfig> decrypt_config(new DecryptConfig(
+      key_id_, std::vector<uint8_t>(kIv, kIv + arraysize(kIv)),
+      std::vector<SubsampleEntry>()));
+  ASSERT_TRUE(decryptor_source_.DecryptSampleBufferAsync(
+      decrypt_config.Pass(), &buffer_[0], buffer_.size()));
+  ASSERT_TRUE(decryptor_source_.WaitForPendingDecrypt());
+  EXPECT_EQ(std::vector<uint8_t>(
+                kExpectedDecryptedBuffer,
+                kExpectedDecryptedBuffer + arraysize(kExpectedDecryptedBuffer)),
+            buffer_);
+
+  // Queue another decryption with the same key id; the cached decryptor is
+  // reused without another GetKey call.
+  buffer_.assign(kBuffer2, kBuffer2 + arraysize(kBuffer2));
+  scoped_ptr<DecryptConfig> decrypt_config2(new DecryptConfig(
+      key_id_, std::vector<uint8_t>(kIv2, kIv2 + arraysize(kIv2)),
+      std::vector<SubsampleEntry>()));
+  ASSERT_TRUE(decryptor_source_.DecryptSampleBufferAsync(
+      decrypt_config2.Pass(), &buffer_[0], buffer_.size()));
+  ASSERT_TRUE(decryptor_source_.WaitForPendingDecrypt());
+  EXPECT_EQ(std::vector<uint8_t>(kExpectedDecryptedBuffer2,
+                                 kExpectedDecryptedBuffer2 +
+                                     arraysize(kExpectedDecryptedBuffer2)),
+            buffer_);
+}
+
 TEST_F(DecryptorSourceTest, DecryptFailedIfGetKeyFailed) {
   EXPECT_CALL(mock_key_source_, GetKey(key_id_, _))
       .WillOnce(Return(Status::UNKNOWN));
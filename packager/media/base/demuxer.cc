@@ -6,6 +6,8 @@
 
 #include "packager/media/base/demuxer.h"
 
+#include <algorithm>
+
 #include "packager/base/bind.h"
 #include "packager/base/logging.h"
 #include "packager/base/stl_util.h"
@@ -13,8 +15,13 @@
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/media_stream.h"
+#include "packager/media/base/memory_budget.h"
+#include "packager/media/base/pipeline_stats.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/media/base/trace_span.h"
 #include "packager/media/file/file.h"
+#include "packager/media/formats/escache/es_cache_media_parser.h"
+#include "packager/media/formats/escache/es_cache_writer.h"
 #include "packager/media/formats/mp2t/mp2t_media_parser.h"
 #include "packager/media/formats/mp4/mp4_media_parser.h"
 #include "packager/media/formats/webm/webm_media_parser.h"
@@ -24,7 +31,11 @@
 namespace {
 // 65KB, sufficient to determine the container and likely all init data.
 const size_t kInitBufSize = 0x10000;
-const size_t kBufSize = 0x200000;  // 2MB
+// Smallest read block. Small blocks keep buffering delay low for trickling
+// sources such as live UDP streams.
+const size_t kMinReadSize = 0x10000;  // 64KB
+// Default upper bound for the adaptive read block size.
+const size_t kDefaultMaxReadSize = 0x200000;  // 2MB
 // Maximum number of allowed queued samples. If we are receiving a lot of
 // samples before seeing init_event, something is not right. The number
 // set here is arbitrary though.
@@ -39,8 +50,24 @@ Demuxer::Demuxer(const std::string& file_name)
       media_file_(NULL),
       init_event_received_(false),
       container_name_(CONTAINER_UNKNOWN),
-      buffer_(new uint8_t[kBufSize]),
-      cancelled_(false) {
+      input_format_(CONTAINER_UNKNOWN),
+      mapped_data_(NULL),
+      mapped_size_(0),
+      mapped_pos_(0),
+      max_read_size_(kDefaultMaxReadSize),
+      read_size_(kMinReadSize),
+      cancelled_(false),
+      threaded_push_(false),
+      standby_(false),
+      probe_mode_(false),
+      trusted_input_(false),
+      has_stream_type_selection_(false),
+      select_audio_(true),
+      select_video_(true),
+      has_clip_range_(false),
+      clip_start_seconds_(0),
+      clip_end_seconds_(0),
+      parse_position_(0) {
 }
 
 Demuxer::~Demuxer() {
@@ -53,62 +80,159 @@ void Demuxer::SetKeySource(scoped_ptr<KeySource> key_source) {
   key_source_ = key_source.Pass();
 }
 
+void Demuxer::SetMemoryBudget(scoped_ptr<MemoryBudget> memory_budget) {
+  memory_budget_ = memory_budget.Pass();
+}
+
+void Demuxer::SetStandbyPromotionCheck(
+    const base::Callback<bool()>& promotion_cb) {
+  DCHECK(!promotion_cb.is_null());
+  standby_ = true;
+  promotion_cb_ = promotion_cb;
+}
+
 Status Demuxer::Initialize() {
   DCHECK(!media_file_);
   DCHECK(!init_event_received_);
 
   LOG(INFO) << "Initialize Demuxer for file '" << file_name_ << "'.";
 
+  if (max_read_size_ < kMinReadSize)
+    max_read_size_ = kMinReadSize;
+  read_size_ = std::min(read_size_, max_read_size_);
+
   media_file_ = File::Open(file_name_.c_str(), "r");
   if (!media_file_) {
     return Status(error::FILE_FAILURE,
                   "Cannot open file for reading " + file_name_);
   }
 
-  // Read enough bytes before detecting the container.
+  // Parse straight out of the page cache when the source supports read-only
+  // mapping (local VOD inputs); otherwise fall back to buffered reads.
   size_t bytes_read = 0;
-  while (bytes_read < kInitBufSize) {
-    int64_t read_result =
-        media_file_->Read(buffer_.get() + bytes_read, kInitBufSize);
-    if (read_result < 0)
-      return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
-    if (read_result == 0)
-      break;
-    bytes_read += read_result;
-  }
-  container_name_ = DetermineContainer(buffer_.get(), bytes_read);
-
-  // Initialize media parser.
-  switch (container_name_) {
-    case CONTAINER_MOV:
-      parser_.reset(new mp4::MP4MediaParser());
-      break;
-    case CONTAINER_MPEG2TS:
-      parser_.reset(new mp2t::Mp2tMediaParser());
-      break;
-    case CONTAINER_MPEG2PS:
-      parser_.reset(new wvm::WvmMediaParser());
-      break;
-    case CONTAINER_WEBM:
-      parser_.reset(new WebMMediaParser());
-      break;
-    case CONTAINER_WEBVTT:
-      parser_.reset(new WebVttMediaParser());
-      break;
-    default:
-      NOTIMPLEMENTED();
-      return Status(error::UNIMPLEMENTED, "Container not supported.");
+  if (media_file_->MapReadOnly(&mapped_data_, &mapped_size_)) {
+    VLOG(1) << "Using memory-mapped input for '" << file_name_ << "'.";
+    bytes_read = std::min<uint64_t>(kInitBufSize, mapped_size_);
+    mapped_pos_ = bytes_read;
+  } else {
+    buffer_.reset(new uint8_t[max_read_size_]);
+
+    // Read enough bytes before detecting the container.
+    while (bytes_read < kInitBufSize) {
+      int64_t read_result = media_file_->Read(buffer_.get() + bytes_read,
+                                              kInitBufSize - bytes_read);
+      if (read_result < 0)
+        return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
+      if (read_result == 0)
+        break;
+      bytes_read += read_result;
+    }
+  }
+  const uint8_t* init_data = mapped_data_ ? mapped_data_ : buffer_.get();
+  if (input_format_ == CONTAINER_ESCACHE ||
+      (input_format_ == CONTAINER_UNKNOWN &&
+       EsCacheMediaParser::IsEsCache(init_data, bytes_read))) {
+    // The input is an elementary-stream cache, from an earlier packaging run
+    // or emitted directly by a trusted upstream encoder; stream infos and
+    // samples are read back directly with no scanning.
+    VLOG(1) << "Input '" << file_name_ << "' is an elementary-stream cache.";
+    parser_.reset(new EsCacheMediaParser());
+  } else {
+    container_name_ = input_format_ != CONTAINER_UNKNOWN
+                          ? input_format_
+                          : DetermineContainer(init_data, bytes_read);
+
+    // Initialize media parser.
+    switch (container_name_) {
+      case CONTAINER_MOV:
+        parser_.reset(new mp4::MP4MediaParser());
+        break;
+      case CONTAINER_MPEG2TS:
+        parser_.reset(new mp2t::Mp2tMediaParser());
+        break;
+      case CONTAINER_MPEG2PS:
+        parser_.reset(new wvm::WvmMediaParser());
+        break;
+      case CONTAINER_WEBM:
+        parser_.reset(new WebMMediaParser());
+        break;
+      case CONTAINER_WEBVTT:
+        parser_.reset(new WebVttMediaParser());
+        break;
+      default:
+        NOTIMPLEMENTED();
+        return Status(error::UNIMPLEMENTED, "Container not supported.");
+    }
+
+    if (!es_cache_path_.empty() && probe_mode_) {
+      // A probe never demuxes samples, so there is nothing to cache.
+      LOG(WARNING) << "Elementary-stream cache is ignored in probe mode.";
+    } else if (!es_cache_path_.empty()) {
+      scoped_ptr<EsCacheWriter> writer(new EsCacheWriter(es_cache_path_));
+      if (writer->Open()) {
+        es_cache_writer_ = writer.Pass();
+      } else {
+        LOG(WARNING) << "Elementary-stream cache disabled for '" << file_name_
+                     << "'.";
+      }
+    }
   }
 
   parser_->Init(base::Bind(&Demuxer::ParserInitEvent, base::Unretained(this)),
                 base::Bind(&Demuxer::NewSampleEvent, base::Unretained(this)),
                 key_source_.get());
+  parser_->set_sample_batch_cb(
+      base::Bind(&Demuxer::NewSampleBatchEvent, base::Unretained(this)));
+
+  if (has_stream_type_selection_) {
+    DCHECK(select_audio_ || select_video_);
+    if (container_name_ == CONTAINER_MOV) {
+      static_cast<mp4::MP4MediaParser*>(parser_.get())
+          ->SelectStreamTypes(select_audio_, select_video_);
+    } else if (container_name_ == CONTAINER_MPEG2TS) {
+      static_cast<mp2t::Mp2tMediaParser*>(parser_.get())
+          ->SelectStreamTypes(select_audio_, select_video_);
+    } else {
+      DVLOG(1) << "Stream type selection is not pushed down for this "
+                  "container; all streams are parsed.";
+    }
+  }
+
+  if (trusted_input_) {
+    if (container_name_ == CONTAINER_MPEG2TS) {
+      static_cast<mp2t::Mp2tMediaParser*>(parser_.get())
+          ->set_trusted_input(true);
+    } else {
+      DVLOG(1) << "Trusted-input validation elision is not implemented for "
+                  "this container; the input is fully validated.";
+    }
+  }
+
+  if (has_clip_range_) {
+    if (container_name_ == CONTAINER_MOV) {
+      static_cast<mp4::MP4MediaParser*>(parser_.get())
+          ->SetClipRange(clip_start_seconds_, clip_end_seconds_);
+    } else {
+      LOG(WARNING) << "Clip range is only supported for MP4 input; ignored.";
+      has_clip_range_ = false;
+    }
+  }
+
+  if (!parse_index_path_.empty()) {
+    if (container_name_ == CONTAINER_MOV) {
+      static_cast<mp4::MP4MediaParser*>(parser_.get())
+          ->SetParseIndexPath(parse_index_path_, file_name_);
+    } else {
+      LOG(WARNING) << "Parse index is only supported for MP4 input; ignored.";
+    }
+  }
 
   // Handle trailing 'moov'.
   if (container_name_ == CONTAINER_MOV)
     static_cast<mp4::MP4MediaParser*>(parser_.get())->LoadMoov(file_name_);
 
-  if (!parser_->Parse(buffer_.get(), bytes_read)) {
+  parse_position_ = bytes_read;
+  if (!parser_->Parse(init_data, bytes_read)) {
     init_parsing_status_ =
         Status(error::PARSER_FAILURE, "Cannot parse media file " + file_name_);
   }
@@ -124,6 +248,19 @@ void Demuxer::ParserInitEvent(
     const std::vector<scoped_refptr<StreamInfo> >& streams) {
   init_event_received_ = true;
 
+  if (probe_mode_) {
+    // A probe only wants the metadata; keep the stream infos and skip the
+    // media stream (and queue) setup entirely.
+    probed_stream_infos_ = streams;
+    return;
+  }
+
+  if (es_cache_writer_ && !es_cache_writer_->WriteStreamInfos(streams)) {
+    LOG(WARNING) << "Elementary-stream cache disabled for '" << file_name_
+                 << "'.";
+    es_cache_writer_.reset();
+  }
+
   std::vector<scoped_refptr<StreamInfo> >::const_iterator it = streams.begin();
   for (; it != streams.end(); ++it) {
     streams_.push_back(new MediaStream(*it, this));
@@ -137,6 +274,15 @@ Demuxer::QueuedSample::~QueuedSample() {}
 
 bool Demuxer::NewSampleEvent(uint32_t track_id,
                              const scoped_refptr<MediaSample>& sample) {
+  // In probe mode only the stream metadata matters; discard samples instead
+  // of queueing them.
+  if (probe_mode_)
+    return true;
+  if (es_cache_writer_ && !es_cache_writer_->WriteSample(track_id, sample)) {
+    LOG(WARNING) << "Elementary-stream cache disabled for '" << file_name_
+                 << "'.";
+    es_cache_writer_.reset();
+  }
   if (!init_event_received_) {
     if (queued_samples_.size() >= kQueuedSamplesLimit) {
       LOG(ERROR) << "Queued samples limit reached: " << kQueuedSamplesLimit;
@@ -155,8 +301,74 @@ bool Demuxer::NewSampleEvent(uint32_t track_id,
   return PushSample(track_id, sample);
 }
 
+bool Demuxer::NewSampleBatchEvent(
+    uint32_t track_id,
+    const std::vector<scoped_refptr<MediaSample> >& samples) {
+  if (probe_mode_)
+    return true;
+  if (es_cache_writer_) {
+    for (size_t i = 0; i < samples.size(); ++i) {
+      if (!es_cache_writer_->WriteSample(track_id, samples[i])) {
+        LOG(WARNING) << "Elementary-stream cache disabled for '" << file_name_
+                     << "'.";
+        es_cache_writer_.reset();
+        break;
+      }
+    }
+  }
+  if (!init_event_received_) {
+    if (queued_samples_.size() + samples.size() > kQueuedSamplesLimit) {
+      LOG(ERROR) << "Queued samples limit reached: " << kQueuedSamplesLimit;
+      return false;
+    }
+    for (size_t i = 0; i < samples.size(); ++i)
+      queued_samples_.push_back(QueuedSample(track_id, samples[i]));
+    return true;
+  }
+  while (!queued_samples_.empty()) {
+    if (!PushSample(queued_samples_.front().track_id,
+                    queued_samples_.front().sample)) {
+      return false;
+    }
+    queued_samples_.pop_front();
+  }
+  return PushSampleBatch(track_id, samples);
+}
+
+bool Demuxer::ShouldDeliverSample(uint32_t track_id,
+                                  const scoped_refptr<MediaSample>& sample) {
+  if (standby_)
+    return sample->end_of_stream();
+  if (tracks_awaiting_key_frame_.empty())
+    return true;
+  std::set<uint32_t>::iterator it = tracks_awaiting_key_frame_.find(track_id);
+  if (it == tracks_awaiting_key_frame_.end())
+    return true;
+  if (!sample->is_key_frame() && !sample->end_of_stream())
+    return false;
+  tracks_awaiting_key_frame_.erase(it);
+  return true;
+}
+
+void Demuxer::Promote() {
+  DCHECK(standby_);
+  standby_ = false;
+  // Video streams rejoin at their next key frame so the first segment the
+  // promoted instance emits is decodable from its first sample.
+  for (std::vector<MediaStream*>::iterator it = streams_.begin();
+       it != streams_.end();
+       ++it) {
+    if ((*it)->info()->stream_type() == kStreamVideo)
+      tracks_awaiting_key_frame_.insert((*it)->info()->track_id());
+  }
+  LOG(INFO) << "Standby packager promoted to active for file '" << file_name_
+            << "'.";
+}
+
 bool Demuxer::PushSample(uint32_t track_id,
                          const scoped_refptr<MediaSample>& sample) {
+  if (!ShouldDeliverSample(track_id, sample))
+    return true;
   std::vector<MediaStream*>::iterator it = streams_.begin();
   for (; it != streams_.end(); ++it) {
     if (track_id == (*it)->info()->track_id()) {
@@ -170,27 +382,72 @@ bool Demuxer::PushSample(uint32_t track_id,
   return false;
 }
 
+bool Demuxer::PushSampleBatch(
+    uint32_t track_id,
+    const std::vector<scoped_refptr<MediaSample> >& samples) {
+  // Resolve the stream once for the whole batch.
+  std::vector<MediaStream*>::iterator it = streams_.begin();
+  for (; it != streams_.end(); ++it) {
+    if (track_id == (*it)->info()->track_id()) {
+      for (size_t i = 0; i < samples.size(); ++i) {
+        if (!ShouldDeliverSample(track_id, samples[i]))
+          continue;
+        Status status = (*it)->PushSample(samples[i]);
+        if (!status.ok()) {
+          LOG(ERROR) << "Demuxer::PushSample failed with " << status;
+          return false;
+        }
+      }
+      return true;
+    }
+  }
+  LOG(ERROR) << "Track " << track_id << " not found.";
+  return false;
+}
+
 Status Demuxer::Run() {
   Status status;
 
+  DCHECK(!probe_mode_) << "Run() must not be called in probe mode.";
   LOG(INFO) << "Demuxer::Run() on file '" << file_name_ << "'.";
 
   // Start the streams.
+  const MediaStream::MediaStreamOperation operation =
+      threaded_push_ ? MediaStream::kThreadedPush : MediaStream::kPush;
   for (std::vector<MediaStream*>::iterator it = streams_.begin();
        it != streams_.end();
        ++it) {
-    status = (*it)->Start(MediaStream::kPush);
+    status = (*it)->Start(operation);
     if (!status.ok())
       return status;
   }
 
-  while (!cancelled_ && (status = Parse()).ok())
-    continue;
+  while (!cancelled_ && (status = Parse()).ok()) {
+    // Poll for standby promotion between reads: for live inputs reads arrive
+    // at stream rate, so takeover latency is bounded by the read interval.
+    if (standby_ && promotion_cb_.Run())
+      Promote();
+    // Coordinated backpressure: pause input reads while the job holds more
+    // buffered sample bytes than its budget; the muxer side keeps draining
+    // and releasing, at which point reading resumes.
+    if (memory_budget_)
+      memory_budget_->WaitUntilWithinBudget();
+  }
 
   if (cancelled_ && status.ok())
-    return Status(error::CANCELLED, "Demuxer run cancelled");
+    status = Status(error::CANCELLED, "Demuxer run cancelled");
 
   if (status.error_code() == error::END_OF_STREAM) {
+    // The whole input was demuxed; finalize the elementary-stream cache so
+    // that the next run can use it. A cache left unfinalized (cancel, error)
+    // is rejected on read-back.
+    if (es_cache_writer_) {
+      if (!es_cache_writer_->Close()) {
+        LOG(WARNING) << "Failed to finalize the elementary-stream cache for '"
+                     << file_name_ << "'.";
+      }
+      es_cache_writer_.reset();
+    }
     // Push EOS sample to muxer to indicate end of stream.
     const scoped_refptr<MediaSample>& sample = MediaSample::CreateEOSBuffer();
     for (std::vector<MediaStream*>::iterator it = streams_.begin();
@@ -198,23 +455,68 @@ Status Demuxer::Run() {
          ++it) {
       status = (*it)->PushSample(sample);
       if (!status.ok())
-        return status;
+        break;
     }
   }
+
+  // In threaded push mode, wait for the worker threads to drain their sample
+  // queues. The first error encountered wins.
+  for (std::vector<MediaStream*>::iterator it = streams_.begin();
+       it != streams_.end();
+       ++it) {
+    status.Update((*it)->FinishThreadedPush());
+  }
   return status;
 }
 
 Status Demuxer::Parse() {
   DCHECK(media_file_);
   DCHECK(parser_);
-  DCHECK(buffer_);
+  DCHECK(buffer_ || mapped_data_);
 
   // Return early and avoid call Parse(...) again if it has already failed at
   // the initialization.
   if (!init_parsing_status_.ok())
     return init_parsing_status_;
 
-  int64_t bytes_read = media_file_->Read(buffer_.get(), kBufSize);
+  if (has_clip_range_) {
+    DCHECK_EQ(CONTAINER_MOV, container_name_);
+    mp4::MP4MediaParser* mp4_parser =
+        static_cast<mp4::MP4MediaParser*>(parser_.get());
+    const int64_t next = mp4_parser->NextRequiredPosition(parse_position_);
+    if (next < 0) {
+      // Every sample in the clip range has been emitted.
+      if (!parser_->Flush())
+        return Status(error::PARSER_FAILURE, "Failed to flush.");
+      return Status(error::END_OF_STREAM, "");
+    }
+    if (next > parse_position_) {
+      if (mapped_data_) {
+        mapped_pos_ = std::min<uint64_t>(next, mapped_size_);
+        mp4_parser->SkipTo(next);
+        parse_position_ = next;
+      } else if (media_file_->Seek(next)) {
+        mp4_parser->SkipTo(next);
+        parse_position_ = next;
+      }
+      // If the source does not support seeking, fall through and keep
+      // feeding sequentially; the parser discards the unneeded bytes.
+    }
+  }
+
+  const uint8_t* data;
+  int64_t bytes_read;
+  if (mapped_data_) {
+    // The bytes are already resident in the mapping; hand the parser a view
+    // without copying. The kernel's readahead takes care of prefetching.
+    bytes_read = std::min<uint64_t>(max_read_size_, mapped_size_ - mapped_pos_);
+    data = mapped_data_ + mapped_pos_;
+    mapped_pos_ += bytes_read;
+  } else {
+    pipeline_stats::ScopedStageTimer timer(pipeline_stats::kStageFileRead);
+    bytes_read = media_file_->Read(buffer_.get(), read_size_);
+    data = buffer_.get();
+  }
   if (bytes_read == 0) {
     if (!parser_->Flush())
       return Status(error::PARSER_FAILURE, "Failed to flush.");
@@ -222,13 +524,35 @@ Status Demuxer::Parse() {
   } else if (bytes_read < 0) {
     return Status(error::FILE_FAILURE, "Cannot read file " + file_name_);
   }
+  if (!mapped_data_) {
+    pipeline_stats::RecordBytes(pipeline_stats::kStageFileRead, bytes_read);
+    UpdateReadSize(bytes_read);
+  }
+  parse_position_ += bytes_read;
 
-  return parser_->Parse(buffer_.get(), bytes_read)
+  pipeline_stats::RecordBytes(pipeline_stats::kStageParse, bytes_read);
+  pipeline_stats::ScopedStageTimer timer(pipeline_stats::kStageParse);
+  TRACE_SPAN("demux", "Demuxer::Parse");
+  return parser_->Parse(data, bytes_read)
              ? Status::OK
              : Status(error::PARSER_FAILURE,
                       "Cannot parse media file " + file_name_);
 }
 
+void Demuxer::UpdateReadSize(int64_t bytes_read) {
+  if (static_cast<size_t>(bytes_read) == read_size_) {
+    // The source filled the whole block: throughput bound. Larger blocks
+    // amortize per-read overhead, which matters on high-latency links such
+    // as network mounted storage.
+    if (read_size_ * 2 <= max_read_size_)
+      read_size_ *= 2;
+  } else if (static_cast<size_t>(bytes_read) < read_size_ / 4) {
+    // The source trickles data (e.g. a live UDP stream): smaller blocks
+    // reduce buffering delay.
+    read_size_ = std::max(kMinReadSize, read_size_ / 2);
+  }
+}
+
 void Demuxer::Cancel() {
   cancelled_ = true;
 }
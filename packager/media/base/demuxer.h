@@ -8,8 +8,10 @@
 #define MEDIA_BASE_DEMUXER_H_
 
 #include <deque>
+#include <set>
 #include <vector>
 
+#include "packager/base/callback.h"
 #include "packager/base/compiler_specific.h"
 #include "packager/base/memory/ref_counted.h"
 #include "packager/base/memory/scoped_ptr.h"
@@ -20,11 +22,13 @@ namespace shaka {
 namespace media {
 
 class Decryptor;
+class EsCacheWriter;
 class File;
 class KeySource;
 class MediaParser;
 class MediaSample;
 class MediaStream;
+class MemoryBudget;
 class StreamInfo;
 
 /// Demuxer is responsible for extracting elementary stream samples from a
@@ -50,6 +54,118 @@ class Demuxer {
   /// @return OK on success.
   Status Initialize();
 
+  /// Set the upper bound for the adaptive read block size, e.g. large for
+  /// network mounted mezzanine storage, small for low-latency live inputs.
+  /// Must be called before @a Initialize. The actual read size starts small
+  /// and adapts to the observed behavior of the source within
+  /// [64KB, @a max_read_size].
+  void set_max_read_size(size_t max_read_size) {
+    max_read_size_ = max_read_size;
+  }
+
+  /// Trust the given container format for the input instead of sniffing the
+  /// content. Must be called before @a Initialize. Intended for trusted
+  /// encoder-adjacent inputs - e.g. CONTAINER_ESCACHE for AU-delimited
+  /// elementary-stream ingest - where the producer already knows the framing
+  /// and detection is redundant.
+  void set_input_format(MediaContainerName input_format) {
+    input_format_ = input_format;
+  }
+
+  /// Restrict demuxing to the given time range, in seconds. Supported for
+  /// non-fragmented MP4 input only; must be called before @a Initialize. The
+  /// range start is snapped back to the nearest preceding sync sample. For
+  /// seekable input the demuxer skips over the bytes that no in-range sample
+  /// covers, so extracting a short clip from a long file reads little more
+  /// than the movie metadata and the clip's chunks.
+  void SetClipRange(double start_seconds, double end_seconds) {
+    clip_start_seconds_ = start_seconds;
+    clip_end_seconds_ = end_seconds;
+    has_clip_range_ = true;
+  }
+
+  /// Demux only streams of the selected types. The selection is pushed down
+  /// into the media parser where supported (unselected 'trak' boxes are
+  /// skipped for MP4 input, unselected pids are filtered out for MPEG-2 TS
+  /// input), so e.g. extracting the audio track of a UHD source does no
+  /// video slice or sample table work at all. Ignored for containers without
+  /// parser support; the per-stream selection downstream still applies.
+  /// Must be called before @a Initialize.
+  /// @param audio selects audio streams.
+  /// @param video selects video streams. At least one of @a audio and
+  ///        @a video must be true.
+  void SelectStreamTypes(bool audio, bool video) {
+    has_stream_type_selection_ = true;
+    select_audio_ = audio;
+    select_video_ = video;
+  }
+
+  /// Write an elementary-stream cache file to @a path while demuxing, so
+  /// that later re-packaging jobs of the same input can read the cache
+  /// instead and skip container and codec parsing entirely. Caching is best
+  /// effort: a write failure is logged and disables the cache without
+  /// failing the job. Must be called before @a Initialize. Ignored when the
+  /// input itself is an elementary-stream cache.
+  void SetEsCachePath(const std::string& path) { es_cache_path_ = path; }
+
+  /// Persist the parsed sample table state of non-fragmented MP4 input to
+  /// the sidecar file at @a path, and load it back on later runs of the same
+  /// input instead of walking the sample tables again. The sidecar is
+  /// validated against the input's size and mtime, so a changed input never
+  /// serves stale tables; a missing, stale or corrupt sidecar falls back to
+  /// a normal parse and is rewritten. Ignored for other containers and when
+  /// a clip range or stream type selection is active. Must be called before
+  /// @a Initialize.
+  void SetParseIndexPath(const std::string& path) { parse_index_path_ = path; }
+
+  /// Probe the input's stream metadata only. @a Initialize then returns as
+  /// soon as the stream infos are known, discards any samples parsed along
+  /// the way and creates no media streams; only probed_stream_infos() may be
+  /// consumed afterwards and @a Run must not be called. Combined with the
+  /// ranged 'moov' loading for MP4 input, probing a remote file transfers
+  /// little more than the movie metadata. Must be called before
+  /// @a Initialize.
+  void set_probe_mode(bool probe_mode) { probe_mode_ = probe_mode; }
+
+  /// Treat the input as trusted (e.g. produced by our own encoder) and elide
+  /// validation the source already guarantees. Pushed down into the media
+  /// parser where supported: for MPEG-2 TS input, PSI CRCs are only verified
+  /// at a sampled rate, byte-identical PSI repetitions are not re-parsed and
+  /// the per-packet continuity check is skipped. Ignored for containers
+  /// without parser support; those inputs are fully validated. Must be
+  /// called before @a Initialize.
+  void set_trusted_input(bool trusted_input) {
+    trusted_input_ = trusted_input;
+  }
+
+  /// Set a memory budget for this job. The media streams charge the budget
+  /// for buffered sample bytes and release as the muxers consume them; @a Run
+  /// pauses input reads while the job is over budget. Applies to the push
+  /// modes; pull mode is driven by the consumer and needs no backpressure.
+  /// Must be called before @a Run.
+  void SetMemoryBudget(scoped_ptr<MemoryBudget> memory_budget);
+
+  /// @return The job's memory budget, or NULL if none was set.
+  MemoryBudget* memory_budget() { return memory_budget_.get(); }
+
+  /// Start the job as a warm standby: samples are parsed as usual but
+  /// dropped before they reach the media streams, so parser and decryption
+  /// state stay hot without any muxing, encryption or manifest cost.
+  /// @a promotion_cb is polled between input reads during @a Run; once it
+  /// returns true the demuxer promotes to active and delivery begins, with
+  /// each video stream joining at its next key frame so downstream segments
+  /// start clean. Applies to the push modes; must be called before @a Run.
+  /// @param promotion_cb cannot be null.
+  void SetStandbyPromotionCheck(const base::Callback<bool()>& promotion_cb);
+
+  /// Enable or disable threaded push mode for @a Run. When enabled, each
+  /// connected stream feeds its muxer on a dedicated worker thread so that
+  /// demuxing/parsing overlaps with fragment building, encryption and segment
+  /// writes. Must be called before @a Run.
+  void set_threaded_push(bool threaded_push) {
+    threaded_push_ = threaded_push;
+  }
+
   /// Drive the remuxing from demuxer side (push). Read the file and push
   /// the Data to Muxer until Eof.
   Status Run();
@@ -67,6 +183,12 @@ class Demuxer {
   ///         through MediaStream APIs.
   const std::vector<MediaStream*>& streams() { return streams_; }
 
+  /// @return The stream metadata collected in probe mode. Valid after a
+  ///         successful @a Initialize with probe mode set.
+  const std::vector<scoped_refptr<StreamInfo> >& probed_stream_infos() const {
+    return probed_stream_infos_;
+  }
+
   /// @return Container name (type). Value is CONTAINER_UNKNOWN if the demuxer
   ///         is not initialized.
   MediaContainerName container_name() { return container_name_; }
@@ -87,8 +209,27 @@ class Demuxer {
   // corresponding stream.
   bool NewSampleEvent(uint32_t track_id,
                       const scoped_refptr<MediaSample>& sample);
+  // Parser batch event handler; the batched equivalent of NewSampleEvent().
+  bool NewSampleBatchEvent(
+      uint32_t track_id,
+      const std::vector<scoped_refptr<MediaSample> >& samples);
   // Helper function to push the sample to corresponding stream.
   bool PushSample(uint32_t track_id, const scoped_refptr<MediaSample>& sample);
+  // Helper function to push a batch of samples of one track to its stream.
+  bool PushSampleBatch(
+      uint32_t track_id,
+      const std::vector<scoped_refptr<MediaSample> >& samples);
+
+  // Standby gate; see SetStandbyPromotionCheck(). Returns true if |sample| of
+  // |track_id| should be delivered to its stream.
+  bool ShouldDeliverSample(uint32_t track_id,
+                           const scoped_refptr<MediaSample>& sample);
+  // Leaves standby: delivery resumes, with video streams rejoining at their
+  // next key frame.
+  void Promote();
+
+  // Adapts |read_size_| based on how much of the last read was filled.
+  void UpdateReadSize(int64_t bytes_read);
 
   std::string file_name_;
   File* media_file_;
@@ -99,9 +240,54 @@ class Demuxer {
   scoped_ptr<MediaParser> parser_;
   std::vector<MediaStream*> streams_;
   MediaContainerName container_name_;
+  // Caller-declared input format; CONTAINER_UNKNOWN means sniff the content.
+  MediaContainerName input_format_;
+  // Read buffer; not allocated when the input is memory mapped.
   scoped_ptr<uint8_t[]> buffer_;
+  // Set when the input file supports read-only mapping (see
+  // File::MapReadOnly). The parser is then fed directly from the mapping
+  // and |buffer_| is unused.
+  const uint8_t* mapped_data_;
+  uint64_t mapped_size_;
+  uint64_t mapped_pos_;
+  // Read block sizing; see set_max_read_size() and UpdateReadSize().
+  size_t max_read_size_;
+  size_t read_size_;
   scoped_ptr<KeySource> key_source_;
+  // Set between Initialize() and the end of stream when an elementary-stream
+  // cache is being written; see SetEsCachePath().
+  std::string es_cache_path_;
+  scoped_ptr<EsCacheWriter> es_cache_writer_;
+  // Parse index sidecar path; see SetParseIndexPath(). May be empty.
+  std::string parse_index_path_;
   bool cancelled_;
+  bool threaded_push_;
+  // Warm standby state; see SetStandbyPromotionCheck(). While |standby_| is
+  // set all samples are dropped; after promotion the tracks in
+  // |tracks_awaiting_key_frame_| keep dropping until their next key frame.
+  bool standby_;
+  base::Callback<bool()> promotion_cb_;
+  std::set<uint32_t> tracks_awaiting_key_frame_;
+  // Probe mode state; see set_probe_mode(). While |probe_mode_| is set,
+  // parsed samples are discarded and the stream infos end up in
+  // |probed_stream_infos_| instead of media streams.
+  bool probe_mode_;
+
+  // Trusted-input validation elision; see set_trusted_input().
+  bool trusted_input_;
+  std::vector<scoped_refptr<StreamInfo> > probed_stream_infos_;
+  // Job memory budget; see SetMemoryBudget(). May be NULL.
+  scoped_ptr<MemoryBudget> memory_budget_;
+  // Stream type selection; see SelectStreamTypes().
+  bool has_stream_type_selection_;
+  bool select_audio_;
+  bool select_video_;
+  // Clip range; see SetClipRange(). |parse_position_| is the file offset one
+  // past the last byte fed to the parser, used to drive clip range skips.
+  bool has_clip_range_;
+  double clip_start_seconds_;
+  double clip_end_seconds_;
+  int64_t parse_position_;
 
   DISALLOW_COPY_AND_ASSIGN(Demuxer);
 };
@@ -6,11 +6,58 @@
 
 #include "packager/media/base/fixed_key_source.h"
 
+#include <map>
+
+#include "packager/base/lazy_instance.h"
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/synchronization/lock.h"
 
 namespace shaka {
 namespace media {
+namespace {
+
+// Process-wide cache of fixed-key sessions, keyed by the hex-string tuple the
+// session was derived from. Distinct tuples are few (typically one per ladder)
+// and sessions are small, so entries are kept for the process lifetime.
+class FixedKeySessionCache {
+ public:
+  FixedKeySessionCache() {}
+
+  scoped_refptr<const FixedKeySession> Find(const std::string& cache_key) {
+    base::AutoLock auto_lock(lock_);
+    SessionMap::const_iterator iter = sessions_.find(cache_key);
+    return iter == sessions_.end() ? scoped_refptr<const FixedKeySession>()
+                                   : iter->second;
+  }
+
+  void Insert(const std::string& cache_key,
+              scoped_refptr<const FixedKeySession> session) {
+    base::AutoLock auto_lock(lock_);
+    sessions_[cache_key] = session;
+  }
+
+ private:
+  typedef std::map<std::string, scoped_refptr<const FixedKeySession> >
+      SessionMap;
+
+  base::Lock lock_;
+  SessionMap sessions_;
+
+  DISALLOW_COPY_AND_ASSIGN(FixedKeySessionCache);
+};
+
+base::LazyInstance<FixedKeySessionCache>::Leaky g_session_cache =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+FixedKeySession::FixedKeySession(scoped_ptr<EncryptionKey> key)
+    : key_(key.Pass()) {
+  DCHECK(key_);
+}
+
+FixedKeySession::~FixedKeySession() {}
 
 FixedKeySource::~FixedKeySource() {}
 
@@ -32,22 +79,24 @@ Status FixedKeySource::FetchKeys(uint32_t asset_id) {
 
 Status FixedKeySource::GetKey(TrackType track_type, EncryptionKey* key) {
   DCHECK(key);
-  DCHECK(encryption_key_);
-  *key = *encryption_key_;
+  DCHECK(session_);
+  *key = session_->key();
+  AppendAdditionalKeySystemInfo(key);
   return Status::OK;
 }
 
 Status FixedKeySource::GetKey(const std::vector<uint8_t>& key_id,
                               EncryptionKey* key) {
   DCHECK(key);
-  DCHECK(encryption_key_);
-  if (key_id != encryption_key_->key_id) {
+  DCHECK(session_);
+  if (key_id != session_->key().key_id) {
     return Status(error::NOT_FOUND,
                   std::string("Key for key ID ") +
                       base::HexEncode(&key_id[0], key_id.size()) +
                       " was not found.");
   }
-  *key = *encryption_key_;
+  *key = session_->key();
+  AppendAdditionalKeySystemInfo(key);
   return Status::OK;
 }
 
@@ -55,7 +104,8 @@ Status FixedKeySource::GetCryptoPeriodKey(uint32_t crypto_period_index,
                                           TrackType track_type,
                                           EncryptionKey* key) {
   // Create a copy of the key.
-  *key = *encryption_key_;
+  DCHECK(session_);
+  *key = session_->key();
 
   // A naive key rotation algorithm is implemented here by left rotating the
   // key, key_id and pssh. Note that this implementation is only intended for
@@ -80,6 +130,7 @@ Status FixedKeySource::GetCryptoPeriodKey(uint32_t crypto_period_index,
     }
   }
 
+  AppendAdditionalKeySystemInfo(key);
   return Status::OK;
 }
 
@@ -88,6 +139,16 @@ scoped_ptr<FixedKeySource> FixedKeySource::CreateFromHexStrings(
     const std::string& key_hex,
     const std::string& pssh_boxes_hex,
     const std::string& iv_hex) {
+  // Sessions derived from the same values are identical, so look for a shared
+  // one before deriving. Hits skip the hex parsing and PSSH box construction
+  // below entirely.
+  const std::string cache_key =
+      key_id_hex + ":" + key_hex + ":" + pssh_boxes_hex + ":" + iv_hex;
+  scoped_refptr<const FixedKeySession> session =
+      g_session_cache.Get().Find(cache_key);
+  if (session)
+    return scoped_ptr<FixedKeySource>(new FixedKeySource(session));
+
   scoped_ptr<EncryptionKey> encryption_key(new EncryptionKey());
 
   if (!base::HexStringToBytes(key_id_hex, &encryption_key->key_id)) {
@@ -135,12 +196,14 @@ scoped_ptr<FixedKeySource> FixedKeySource::CreateFromHexStrings(
     encryption_key->key_system_info.push_back(info);
   }
 
-  return scoped_ptr<FixedKeySource>(new FixedKeySource(encryption_key.Pass()));
+  session = new FixedKeySession(encryption_key.Pass());
+  g_session_cache.Get().Insert(cache_key, session);
+  return scoped_ptr<FixedKeySource>(new FixedKeySource(session));
 }
 
 FixedKeySource::FixedKeySource() {}
-FixedKeySource::FixedKeySource(scoped_ptr<EncryptionKey> key)
-    : encryption_key_(key.Pass()) {}
+FixedKeySource::FixedKeySource(scoped_refptr<const FixedKeySession> session)
+    : session_(session) {}
 
 }  // namespace media
 }  // namespace shaka
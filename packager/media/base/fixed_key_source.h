@@ -10,12 +10,36 @@
 #include <string>
 #include <vector>
 
+#include "packager/base/memory/ref_counted.h"
 #include "packager/base/memory/scoped_ptr.h"
 #include "packager/media/base/key_source.h"
 
 namespace shaka {
 namespace media {
 
+class FixedKeySource;
+
+/// An immutable fixed-key session: the EncryptionKey (key, key id, IV and
+/// parsed PSSH info) derived from one set of key_id/key/pssh/iv values.
+/// Sessions are shared through a process-wide cache, so when daemon or watch
+/// folder jobs reuse the same clear-key parameters the derived state is
+/// constructed once and every key source references it.
+class FixedKeySession : public base::RefCountedThreadSafe<FixedKeySession> {
+ public:
+  const EncryptionKey& key() const { return *key_; }
+
+ private:
+  friend class base::RefCountedThreadSafe<FixedKeySession>;
+  friend class FixedKeySource;
+
+  explicit FixedKeySession(scoped_ptr<EncryptionKey> key);
+  ~FixedKeySession();
+
+  const scoped_ptr<EncryptionKey> key_;
+
+  DISALLOW_COPY_AND_ASSIGN(FixedKeySession);
+};
+
 // Common SystemID defined by EME, which requires Key System implementations
 // supporting ISO Common Encryption to support this SystemID and format.
 // http://goo.gl/PHZDAF
@@ -51,20 +75,26 @@ class FixedKeySource : public KeySource {
   ///        generated IV with the default length will be used.
   /// Note: GetKey on the created key source will always return the same key
   ///       for all track types.
+  /// The derived session is cached process wide, keyed by the hex strings,
+  /// so repeated creations with the same values (e.g. one daemon job per
+  /// rendition of a clear-key ladder) share it instead of re-deriving it.
   static scoped_ptr<FixedKeySource> CreateFromHexStrings(
       const std::string& key_id_hex,
       const std::string& key_hex,
       const std::string& pssh_boxes_hex,
       const std::string& iv_hex);
 
+  /// @return The underlying session, for verifying sharing in tests.
+  const FixedKeySession* session_for_testing() const { return session_.get(); }
+
  protected:
   // Allow default constructor for mock key sources.
   FixedKeySource();
 
  private:
-  explicit FixedKeySource(scoped_ptr<EncryptionKey> key);
+  explicit FixedKeySource(scoped_refptr<const FixedKeySession> session);
 
-  scoped_ptr<EncryptionKey> encryption_key_;
+  scoped_refptr<const FixedKeySession> session_;
 
   DISALLOW_COPY_AND_ASSIGN(FixedKeySource);
 };
@@ -79,6 +79,54 @@ TEST(FixedKeySourceTest, CreateFromHexStrings_EmptyPssh) {
   EXPECT_HEX_EQ(kDefaultPsshBoxHex, key.key_system_info[0].CreateBox());
 }
 
+TEST(FixedKeySourceTest, AdditionalKeySystemInfo) {
+  scoped_ptr<FixedKeySource> key_source = FixedKeySource::CreateFromHexStrings(
+      kKeyIdHex, kKeyHex, kPsshBox1Hex, kIvHex);
+  ASSERT_NE(nullptr, key_source);
+
+  std::vector<uint8_t> additional_pssh;
+  ASSERT_TRUE(base::HexStringToBytes(kPsshBox2Hex, &additional_pssh));
+  std::vector<ProtectionSystemSpecificInfo> additional_info;
+  ASSERT_TRUE(ProtectionSystemSpecificInfo::ParseBoxes(
+      additional_pssh.data(), additional_pssh.size(), &additional_info));
+  key_source->set_additional_key_system_info(additional_info);
+
+  EncryptionKey key;
+  ASSERT_OK(key_source->GetKey(KeySource::TRACK_TYPE_SD, &key));
+
+  // The additional protection system is appended after the source's own.
+  ASSERT_EQ(2u, key.key_system_info.size());
+  EXPECT_HEX_EQ(kPsshBox1Hex, key.key_system_info[0].CreateBox());
+  EXPECT_HEX_EQ(kPsshBox2Hex, key.key_system_info[1].CreateBox());
+}
+
+TEST(FixedKeySourceTest, CreateFromHexStrings_SharesSession) {
+  scoped_ptr<FixedKeySource> key_source1 = FixedKeySource::CreateFromHexStrings(
+      kKeyIdHex, kKeyHex, kPsshBox1Hex, kIvHex);
+  ASSERT_NE(nullptr, key_source1);
+  scoped_ptr<FixedKeySource> key_source2 = FixedKeySource::CreateFromHexStrings(
+      kKeyIdHex, kKeyHex, kPsshBox1Hex, kIvHex);
+  ASSERT_NE(nullptr, key_source2);
+
+  // Identical hex strings share one derived session; different strings do not.
+  EXPECT_EQ(key_source1->session_for_testing(),
+            key_source2->session_for_testing());
+  scoped_ptr<FixedKeySource> key_source3 = FixedKeySource::CreateFromHexStrings(
+      kKeyIdHex, kKeyHex, kPsshBox1Hex, "");
+  ASSERT_NE(nullptr, key_source3);
+  EXPECT_NE(key_source1->session_for_testing(),
+            key_source3->session_for_testing());
+
+  // Both sources return the same key independently.
+  EncryptionKey key1;
+  EncryptionKey key2;
+  ASSERT_OK(key_source1->GetKey(KeySource::TRACK_TYPE_SD, &key1));
+  ASSERT_OK(key_source2->GetKey(KeySource::TRACK_TYPE_SD, &key2));
+  EXPECT_EQ(key1.key_id, key2.key_id);
+  EXPECT_EQ(key1.key, key2.key);
+  EXPECT_EQ(key1.iv, key2.iv);
+}
+
 TEST(FixedKeySourceTest, CreateFromHexStrings_Failure) {
   scoped_ptr<FixedKeySource> key_source = FixedKeySource::CreateFromHexStrings(
       kKeyIdHex, "invalid_hex_value", kPsshBox1Hex, kIvHex);
@@ -0,0 +1,105 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/gather_buffer.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/location.h"
+#include "packager/base/stl_util.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/file/file.h"
+
+namespace shaka {
+namespace media {
+
+GatherBuffer::GatherBuffer() {}
+
+GatherBuffer::~GatherBuffer() {
+  Clear();
+}
+
+BufferWriter* GatherBuffer::writer() {
+  if (pieces_.empty() || !pieces_.back()->buffer) {
+    Piece* piece = new Piece();
+    piece->buffer.reset(new BufferWriter());
+    pieces_.push_back(piece);
+  }
+  return pieces_.back()->buffer.get();
+}
+
+void GatherBuffer::AppendSample(const scoped_refptr<MediaSample>& sample) {
+  DCHECK(sample);
+  Piece* piece = new Piece();
+  piece->sample = sample;
+  pieces_.push_back(piece);
+}
+
+size_t GatherBuffer::Size() const {
+  size_t size = 0;
+  for (size_t i = 0; i < pieces_.size(); ++i) {
+    size += pieces_[i]->buffer ? pieces_[i]->buffer->Size()
+                               : pieces_[i]->sample->data_size();
+  }
+  return size;
+}
+
+void GatherBuffer::Clear() {
+  STLDeleteElements(&pieces_);
+}
+
+void GatherBuffer::Swap(GatherBuffer* buffer) {
+  pieces_.swap(buffer->pieces_);
+}
+
+Status GatherBuffer::WriteToFile(File* file) {
+  DCHECK(file);
+
+  Status status;
+  for (size_t i = 0; i < pieces_.size() && status.ok(); ++i) {
+    Piece* piece = pieces_[i];
+    if (piece->buffer) {
+      status = piece->buffer->WriteToFile(file);
+      continue;
+    }
+    const uint8_t* data = piece->sample->data();
+    size_t remaining = piece->sample->data_size();
+    while (remaining > 0) {
+      const int64_t bytes_written = file->Write(data, remaining);
+      if (bytes_written < 0) {
+        status = Status(error::FILE_FAILURE,
+                        "Failed to write sample data to file.");
+        break;
+      }
+      data += bytes_written;
+      remaining -= bytes_written;
+    }
+  }
+  Clear();
+  return status;
+}
+
+void GatherBuffer::WriteToFileAsync(
+    File* file,
+    const base::Callback<void(int64_t)>& callback) {
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&GatherBuffer::WriteToFileTask, base::Unretained(this), file,
+                 callback),
+      true /* task_is_slow */);
+}
+
+void GatherBuffer::WriteToFileTask(
+    File* file,
+    const base::Callback<void(int64_t)>& callback) {
+  const size_t size = Size();
+  const Status status = WriteToFile(file);
+  callback.Run(status.ok() ? static_cast<int64_t>(size) : -1);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,82 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_BASE_GATHER_BUFFER_H_
+#define MEDIA_BASE_GATHER_BUFFER_H_
+
+#include <vector>
+
+#include "packager/base/callback.h"
+#include "packager/base/memory/ref_counted.h"
+#include "packager/base/memory/scoped_ptr.h"
+#include "packager/media/base/status.h"
+
+namespace shaka {
+namespace media {
+
+class BufferWriter;
+class File;
+class MediaSample;
+
+/// An ordered sequence of byte pieces - box data staged in BufferWriters
+/// interleaved with refcounted media sample payloads - written out in a
+/// single gather pass. Sample payloads are referenced, not copied, so the
+/// bytes parsed from the input are not copied again on their way to the
+/// output file. Referenced samples are kept alive until the buffer is
+/// written or cleared.
+class GatherBuffer {
+ public:
+  GatherBuffer();
+  ~GatherBuffer();
+
+  /// @return A writer collecting box and header bytes at the current tail of
+  ///         the sequence. The pointer is invalidated by AppendSample().
+  BufferWriter* writer();
+
+  /// Append the payload of @a sample to the sequence without copying it.
+  void AppendSample(const scoped_refptr<MediaSample>& sample);
+
+  /// @return The total size of all pieces in bytes.
+  size_t Size() const;
+
+  /// Release all pieces, dropping the sample references.
+  void Clear();
+
+  void Swap(GatherBuffer* buffer);
+
+  /// Write all pieces to @a file in order. The buffer is cleared as it is
+  /// written.
+  /// @param file should not be NULL.
+  /// @return OK on success.
+  Status WriteToFile(File* file);
+
+  /// Like WriteToFile() but performed on a worker thread. @a callback
+  /// receives the number of bytes written, or a negative value on error,
+  /// matching File::WriteAsync. The buffer and @a file must outlive the
+  /// completion of the write.
+  void WriteToFileAsync(File* file,
+                        const base::Callback<void(int64_t)>& callback);
+
+ private:
+  // One piece of the sequence; exactly one of the members is set.
+  struct Piece {
+    scoped_ptr<BufferWriter> buffer;
+    scoped_refptr<MediaSample> sample;
+  };
+
+  void WriteToFileTask(File* file,
+                       const base::Callback<void(int64_t)>& callback);
+
+  // Owned. Raw pointers as Piece is not copyable.
+  std::vector<Piece*> pieces_;
+
+  DISALLOW_COPY_AND_ASSIGN(GatherBuffer);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_BASE_GATHER_BUFFER_H_
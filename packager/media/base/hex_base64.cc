@@ -0,0 +1,247 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/hex_base64.h"
+
+#include <stdint.h>
+
+#include <map>
+
+#include "packager/base/lazy_instance.h"
+#include "packager/base/logging.h"
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/lock.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <tmmintrin.h>
+#define PACKAGER_HEX_BASE64_SSSE3 1
+#endif
+
+namespace shaka {
+namespace media {
+namespace {
+
+const char kBase64Chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+const char kHexCharsUpper[] = "0123456789ABCDEF";
+const char kHexCharsLower[] = "0123456789abcdef";
+
+size_t Base64EncodedSize(size_t size) {
+  return (size + 2) / 3 * 4;
+}
+
+// Scalar tail shared by both paths. Encodes from |src + *in| to the end,
+// appending at |dst + *out|.
+void Base64EncodeScalar(const uint8_t* src,
+                        size_t size,
+                        size_t* in,
+                        char* dst,
+                        size_t* out) {
+  while (size - *in >= 3) {
+    const uint32_t v =
+        (src[*in] << 16) | (src[*in + 1] << 8) | src[*in + 2];
+    dst[(*out)++] = kBase64Chars[(v >> 18) & 0x3f];
+    dst[(*out)++] = kBase64Chars[(v >> 12) & 0x3f];
+    dst[(*out)++] = kBase64Chars[(v >> 6) & 0x3f];
+    dst[(*out)++] = kBase64Chars[v & 0x3f];
+    *in += 3;
+  }
+  const size_t remaining = size - *in;
+  if (remaining == 1) {
+    const uint32_t v = src[*in] << 16;
+    dst[(*out)++] = kBase64Chars[(v >> 18) & 0x3f];
+    dst[(*out)++] = kBase64Chars[(v >> 12) & 0x3f];
+    dst[(*out)++] = '=';
+    dst[(*out)++] = '=';
+  } else if (remaining == 2) {
+    const uint32_t v = (src[*in] << 16) | (src[*in + 1] << 8);
+    dst[(*out)++] = kBase64Chars[(v >> 18) & 0x3f];
+    dst[(*out)++] = kBase64Chars[(v >> 12) & 0x3f];
+    dst[(*out)++] = kBase64Chars[(v >> 6) & 0x3f];
+    dst[(*out)++] = '=';
+  }
+}
+
+void HexEncodeScalar(const uint8_t* src,
+                     size_t size,
+                     size_t* in,
+                     char* dst,
+                     size_t* out,
+                     const char* digits) {
+  for (; *in < size; ++(*in)) {
+    dst[(*out)++] = digits[src[*in] >> 4];
+    dst[(*out)++] = digits[src[*in] & 0x0f];
+  }
+}
+
+#if defined(PACKAGER_HEX_BASE64_SSSE3)
+
+bool HasSsse3() {
+  static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+  return has_ssse3;
+}
+
+// Spread each 3-byte group of the low 12 input bytes into four 6-bit values,
+// one per output byte.
+__attribute__((target("ssse3"))) inline __m128i Base64Reshuffle(
+    const __m128i input) {
+  const __m128i in = _mm_shuffle_epi8(
+      input, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(t1, t3);
+}
+
+// Map 6-bit values to base64 characters by adding a per-range offset picked
+// with a shuffle.
+__attribute__((target("ssse3"))) inline __m128i Base64Translate(
+    const __m128i indices) {
+  const __m128i offsets = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4,
+                                        -4, -4, -4, -19, -16, 0, 0);
+  __m128i index = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  const __m128i gt25 = _mm_cmpgt_epi8(indices, _mm_set1_epi8(25));
+  index = _mm_sub_epi8(index, gt25);
+  return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, index));
+}
+
+__attribute__((target("ssse3"))) void Base64EncodeSsse3(const uint8_t* src,
+                                                        size_t size,
+                                                        char* dst,
+                                                        size_t* out) {
+  size_t in = 0;
+  *out = 0;
+  // Each iteration loads 16 bytes but consumes 12, so stop while a full
+  // 16-byte load stays in bounds.
+  while (size - in >= 16) {
+    const __m128i data =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + in));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + *out),
+                     Base64Translate(Base64Reshuffle(data)));
+    in += 12;
+    *out += 16;
+  }
+  Base64EncodeScalar(src, size, &in, dst, out);
+}
+
+__attribute__((target("ssse3"))) void HexEncodeSsse3(const uint8_t* src,
+                                                     size_t size,
+                                                     char* dst,
+                                                     size_t* out,
+                                                     const char* digits) {
+  const __m128i table =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(digits));
+  const __m128i low_nibble = _mm_set1_epi8(0x0f);
+  size_t in = 0;
+  *out = 0;
+  while (size - in >= 16) {
+    const __m128i data =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + in));
+    const __m128i hi = _mm_and_si128(_mm_srli_epi16(data, 4), low_nibble);
+    const __m128i lo = _mm_and_si128(data, low_nibble);
+    const __m128i hi_chars = _mm_shuffle_epi8(table, hi);
+    const __m128i lo_chars = _mm_shuffle_epi8(table, lo);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + *out),
+                     _mm_unpacklo_epi8(hi_chars, lo_chars));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + *out + 16),
+                     _mm_unpackhi_epi8(hi_chars, lo_chars));
+    in += 16;
+    *out += 32;
+  }
+  HexEncodeScalar(src, size, &in, dst, out, digits);
+}
+
+#endif  // defined(PACKAGER_HEX_BASE64_SSSE3)
+
+std::string HexEncodeInternal(const void* bytes,
+                              size_t size,
+                              const char* digits) {
+  if (size == 0)
+    return std::string();
+  const uint8_t* src = static_cast<const uint8_t*>(bytes);
+  std::string encoded(size * 2, '\0');
+  size_t out = 0;
+#if defined(PACKAGER_HEX_BASE64_SSSE3)
+  if (HasSsse3()) {
+    HexEncodeSsse3(src, size, &encoded[0], &out, digits);
+    DCHECK_EQ(encoded.size(), out);
+    return encoded;
+  }
+#endif
+  size_t in = 0;
+  HexEncodeScalar(src, size, &in, &encoded[0], &out, digits);
+  DCHECK_EQ(encoded.size(), out);
+  return encoded;
+}
+
+// Process-wide base64 cache for values that recur across manifest updates.
+class Base64Cache {
+ public:
+  Base64Cache() {}
+
+  std::string Encode(const void* bytes, size_t size) {
+    const std::string key(static_cast<const char*>(bytes), size);
+    base::AutoLock lock(lock_);
+    std::map<std::string, std::string>::const_iterator it = cache_.find(key);
+    if (it != cache_.end())
+      return it->second;
+    // The expected population is a handful of pssh boxes per channel; if the
+    // cache grows past this, something is feeding it per-update values, so
+    // start over rather than grow without bound.
+    const size_t kMaxEntries = 64;
+    if (cache_.size() >= kMaxEntries)
+      cache_.clear();
+    const std::string encoded = Base64EncodeFast(bytes, size);
+    cache_[key] = encoded;
+    return encoded;
+  }
+
+ private:
+  base::Lock lock_;
+  std::map<std::string, std::string> cache_;
+
+  DISALLOW_COPY_AND_ASSIGN(Base64Cache);
+};
+
+base::LazyInstance<Base64Cache>::Leaky g_base64_cache =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+std::string Base64EncodeFast(const void* bytes, size_t size) {
+  if (size == 0)
+    return std::string();
+  const uint8_t* src = static_cast<const uint8_t*>(bytes);
+  std::string encoded(Base64EncodedSize(size), '\0');
+  size_t out = 0;
+#if defined(PACKAGER_HEX_BASE64_SSSE3)
+  if (HasSsse3()) {
+    Base64EncodeSsse3(src, size, &encoded[0], &out);
+    DCHECK_EQ(encoded.size(), out);
+    return encoded;
+  }
+#endif
+  size_t in = 0;
+  Base64EncodeScalar(src, size, &in, &encoded[0], &out);
+  DCHECK_EQ(encoded.size(), out);
+  return encoded;
+}
+
+std::string Base64EncodeCached(const void* bytes, size_t size) {
+  return g_base64_cache.Get().Encode(bytes, size);
+}
+
+std::string HexEncodeFast(const void* bytes, size_t size) {
+  return HexEncodeInternal(bytes, size, kHexCharsUpper);
+}
+
+std::string HexEncodeLowerFast(const void* bytes, size_t size) {
+  return HexEncodeInternal(bytes, size, kHexCharsLower);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,44 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// Fast hex and base64 encoders for manifest hot paths.
+
+#ifndef MEDIA_BASE_HEX_BASE64_H_
+#define MEDIA_BASE_HEX_BASE64_H_
+
+#include <stddef.h>
+
+#include <string>
+
+namespace shaka {
+namespace media {
+
+/// Encode @a bytes as base64. Drop-in replacement for base::Base64Encode on
+/// hot paths: processes 12 input bytes per step on SSSE3-capable x86-64
+/// (detected at runtime) and falls back to a table-driven scalar loop
+/// elsewhere. Live manifest updates re-encode pssh boxes and keys on every
+/// refresh, where the byte-at-a-time base implementation shows up in
+/// profiles at high channel counts.
+std::string Base64EncodeFast(const void* bytes, size_t size);
+
+/// Same as Base64EncodeFast(), but serves repeated inputs from a small
+/// process-wide cache keyed on the raw bytes. Use for values that recur
+/// across manifest updates, like pssh boxes; values that change on every
+/// call would only churn the cache.
+std::string Base64EncodeCached(const void* bytes, size_t size);
+
+/// Encode @a bytes as uppercase hex. Drop-in replacement for
+/// base::HexEncode, vectorized like Base64EncodeFast().
+std::string HexEncodeFast(const void* bytes, size_t size);
+
+/// Lowercase variant of HexEncodeFast(), replacing the
+/// StringToLowerASCII(HexEncode()) pattern without the extra pass.
+std::string HexEncodeLowerFast(const void* bytes, size_t size);
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_BASE_HEX_BASE64_H_
@@ -0,0 +1,50 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "packager/base/base64.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/media/base/hex_base64.h"
+
+namespace shaka {
+namespace media {
+
+// Sizes around the 12-byte vector step and 16-byte load boundaries, plus
+// every padding case.
+TEST(HexBase64Test, MatchesBaseImplementations) {
+  for (size_t size = 0; size <= 100; ++size) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i)
+      data[i] = static_cast<uint8_t>(i * 89 + 41);
+    const void* bytes = size == 0 ? NULL : &data[0];
+
+    std::string expected_base64;
+    base::Base64Encode(
+        base::StringPiece(reinterpret_cast<const char*>(bytes), size),
+        &expected_base64);
+    EXPECT_EQ(expected_base64, Base64EncodeFast(bytes, size)) << size;
+
+    const std::string expected_hex = base::HexEncode(bytes, size);
+    EXPECT_EQ(expected_hex, HexEncodeFast(bytes, size)) << size;
+    EXPECT_EQ(base::StringToLowerASCII(expected_hex),
+              HexEncodeLowerFast(bytes, size))
+        << size;
+  }
+}
+
+TEST(HexBase64Test, CachedEncodeIsStable) {
+  const uint8_t kData[] = {0x00, 0x01, 0x7f, 0x80, 0xff};
+  const std::string first = Base64EncodeCached(kData, sizeof(kData));
+  EXPECT_EQ(Base64EncodeFast(kData, sizeof(kData)), first);
+  EXPECT_EQ(first, Base64EncodeCached(kData, sizeof(kData)));
+}
+
+}  // namespace media
+}  // namespace shaka
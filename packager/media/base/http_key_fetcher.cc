@@ -8,6 +8,7 @@
 
 #include <curl/curl.h>
 
+#include "packager/base/lazy_instance.h"
 #include "packager/base/logging.h"
 #include "packager/base/strings/stringprintf.h"
 #include "packager/base/synchronization/lock.h"
@@ -17,21 +18,16 @@ namespace shaka {
 namespace {
 const char kUserAgentString[] = "shaka-packager-http_fetcher/1.0";
 
-// Scoped CURL implementation which cleans up itself when goes out of scope.
-class ScopedCurl {
- public:
-  ScopedCurl() { ptr_ = curl_easy_init(); }
-  ~ScopedCurl() {
-    if (ptr_)
-      curl_easy_cleanup(ptr_);
-  }
+// Bound on name resolution plus TCP/TLS connect, separate from the overall
+// request timeout. A black-holed or slow-resolving key server fails fast
+// instead of stalling the requesting thread for the full transfer timeout.
+const long kConnectTimeoutMs = 10000;
 
-  CURL* get() { return ptr_; }
-
- private:
-  CURL* ptr_;
-  DISALLOW_COPY_AND_ASSIGN(ScopedCurl);
-};
+// How long resolved names stay valid in the shared DNS cache. License
+// servers sit behind stable addresses; re-resolving for every key rotation
+// in a long-running daemon is wasted start-up latency. curl's default is
+// 60 seconds.
+const long kDnsCacheTimeoutSeconds = 300;
 
 size_t AppendToString(char* ptr, size_t size, size_t nmemb, std::string* response) {
   DCHECK(ptr);
@@ -66,6 +62,56 @@ class LibCurlInitializer {
   DISALLOW_COPY_AND_ASSIGN(LibCurlInitializer);
 };
 
+// Process-wide curl share handle. TLS sessions and resolved names are shared
+// across all easy handles and fetcher instances, so a new connection to the
+// license server - another fetch thread, a later daemon-mode job - resumes
+// the TLS session with an abbreviated handshake instead of a full one. On
+// curl 7.57+ the connection cache is shared as well, which together with
+// CURLOPT_PIPEWAIT lets concurrent fetches multiplex over a single HTTP/2
+// connection.
+class CurlShareManager {
+ public:
+  CurlShareManager() : share_(curl_share_init()) {
+    if (!share_) {
+      LOG(WARNING) << "curl_share_init() failed; TLS sessions will not be "
+                      "reused across connections.";
+      return;
+    }
+    curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &CurlShareManager::Lock);
+    curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &CurlShareManager::Unlock);
+    curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+#if LIBCURL_VERSION_NUM >= 0x073900  // 7.57.0
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+  }
+
+  CURLSH* share() { return share_; }
+
+ private:
+  static void Lock(CURL* handle,
+                   curl_lock_data data,
+                   curl_lock_access access,
+                   void* userp) {
+    static_cast<CurlShareManager*>(userp)->locks_[data].Acquire();
+  }
+
+  static void Unlock(CURL* handle, curl_lock_data data, void* userp) {
+    static_cast<CurlShareManager*>(userp)->locks_[data].Release();
+  }
+
+  CURLSH* share_;
+  base::Lock locks_[CURL_LOCK_DATA_LAST];
+
+  DISALLOW_COPY_AND_ASSIGN(CurlShareManager);
+};
+
+// Leaky: the share must outlive every easy handle, including pooled idle
+// ones destroyed at static deinitialization time.
+base::LazyInstance<CurlShareManager>::Leaky g_curl_share =
+    LAZY_INSTANCE_INITIALIZER;
+
 }  // namespace
 
 namespace media {
@@ -75,7 +121,10 @@ HttpKeyFetcher::HttpKeyFetcher() : timeout_in_seconds_(0) {}
 HttpKeyFetcher::HttpKeyFetcher(uint32_t timeout_in_seconds)
     : timeout_in_seconds_(timeout_in_seconds) {}
 
-HttpKeyFetcher::~HttpKeyFetcher() {}
+HttpKeyFetcher::~HttpKeyFetcher() {
+  for (CURL* curl : idle_connections_)
+    curl_easy_cleanup(curl);
+}
 
 Status HttpKeyFetcher::FetchKeys(const std::string& url,
                                  const std::string& request,
@@ -101,8 +150,7 @@ Status HttpKeyFetcher::FetchInternal(HttpMethod method,
 
   static LibCurlInitializer lib_curl_initializer;
 
-  ScopedCurl scoped_curl;
-  CURL* curl = scoped_curl.get();
+  CURL* curl = AcquireConnection();
   if (!curl) {
     LOG(ERROR) << "curl_easy_init() failed.";
     return Status(error::HTTP_FAILURE, "curl_easy_init() failed.");
@@ -112,13 +160,35 @@ Status HttpKeyFetcher::FetchInternal(HttpMethod method,
   curl_easy_setopt(curl, CURLOPT_URL, path.c_str());
   curl_easy_setopt(curl, CURLOPT_USERAGENT, kUserAgentString);
   curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout_in_seconds_);
+  // Fetches run on muxer threads; curl's signal-based resolver timeout uses
+  // SIGALRM and is not thread-safe, so disable signals and bound the connect
+  // phase explicitly.
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, kConnectTimeoutMs);
+  curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, kDnsCacheTimeoutSeconds);
   curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  if (g_curl_share.Get().share())
+    curl_easy_setopt(curl, CURLOPT_SHARE, g_curl_share.Get().share());
+#if LIBCURL_VERSION_NUM >= 0x072f00  // 7.47.0
+  // Negotiate HTTP/2 via ALPN on https URLs; servers without support fall
+  // back to HTTP/1.1 during the handshake, so this is a no-op there.
+  curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072b00  // 7.43.0
+  // Prefer multiplexing onto an existing HTTP/2 connection over opening
+  // another connection when fetches run concurrently.
+  curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+#endif
   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, AppendToString);
   curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
   if (method == POST) {
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
     curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, data.size());
+  } else {
+    // The handle may have been used for a POST before; reset it to GET.
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
   }
 
   CURLcode res = curl_easy_perform(curl);
@@ -132,12 +202,33 @@ Status HttpKeyFetcher::FetchInternal(HttpMethod method,
     }
 
     LOG(ERROR) << error_message;
+    // The handle and its connections may be in a bad state; don't reuse it.
+    curl_easy_cleanup(curl);
     return Status(
         res == CURLE_OPERATION_TIMEDOUT ? error::TIME_OUT : error::HTTP_FAILURE,
         error_message);
   }
+  ReleaseConnection(curl);
   return Status::OK;
 }
 
+CURL* HttpKeyFetcher::AcquireConnection() {
+  {
+    base::AutoLock lock(lock_);
+    if (!idle_connections_.empty()) {
+      CURL* curl = idle_connections_.back();
+      idle_connections_.pop_back();
+      return curl;
+    }
+  }
+  return curl_easy_init();
+}
+
+void HttpKeyFetcher::ReleaseConnection(CURL* curl) {
+  DCHECK(curl);
+  base::AutoLock lock(lock_);
+  idle_connections_.push_back(curl);
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -11,14 +11,28 @@
 #ifndef MEDIA_BASE_HTTP_KEY_FETCHER_H_
 #define MEDIA_BASE_HTTP_KEY_FETCHER_H_
 
+#include <vector>
+
 #include "packager/base/compiler_specific.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/media/base/key_fetcher.h"
 #include "packager/media/base/status.h"
 
+// From <curl/curl.h>, which defines the handle as a void type in its public
+// interface. Declared here to avoid pulling curl into this header.
+typedef void CURL;
+
 namespace shaka {
 namespace media {
 
 /// A KeyFetcher implementation that retrieves keys over HTTP(s).
+/// Underlying http connections are kept alive and reused across fetches, so
+/// repeated requests to the same server, e.g. license requests under key
+/// rotation, do not pay for a new TCP and TLS handshake every time.
+/// TLS sessions and resolved names are additionally shared process wide, so
+/// connections opened by other fetch threads or later daemon-mode jobs
+/// resume with an abbreviated handshake. HTTP/2 is negotiated where libcurl
+/// supports it, letting concurrent fetches multiplex on one connection.
 /// This class is not fully thread safe. It can be used in multi-thread
 /// environment once constructed, but it may not be safe to create a
 /// HttpKeyFetcher object when any other thread is running due to use of
@@ -64,8 +78,17 @@ class HttpKeyFetcher : public KeyFetcher {
   Status FetchInternal(HttpMethod method, const std::string& url,
                        const std::string& data, std::string* response);
 
+  // Return an idle curl handle, which keeps its connection cache with warm
+  // connections from earlier fetches, or create one if none is idle.
+  CURL* AcquireConnection();
+  // Return the handle to the idle pool so its connections can be reused.
+  void ReleaseConnection(CURL* curl);
+
   const uint32_t timeout_in_seconds_;
 
+  base::Lock lock_;
+  std::vector<CURL*> idle_connections_;
+
   DISALLOW_COPY_AND_ASSIGN(HttpKeyFetcher);
 };
 
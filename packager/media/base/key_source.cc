@@ -16,6 +16,13 @@ EncryptionKey::~EncryptionKey() {}
 
 KeySource::~KeySource() {}
 
+void KeySource::AppendAdditionalKeySystemInfo(EncryptionKey* key) const {
+  DCHECK(key);
+  key->key_system_info.insert(key->key_system_info.end(),
+                              additional_key_system_info_.begin(),
+                              additional_key_system_info_.end());
+}
+
 KeySource::TrackType KeySource::GetTrackTypeFromString(
     const std::string& track_type_string) {
   if (track_type_string == "SD")
@@ -85,13 +85,31 @@ class KeySource {
                                     TrackType track_type,
                                     EncryptionKey* key) = 0;
 
+  /// Set additional protection system info, e.g. PlayReady PSSH boxes, to be
+  /// appended to the key system info of every key this source returns. CENC
+  /// ciphertext is key dependent but the PSSH/manifest signaling is not, so
+  /// this produces multi-DRM outputs from a single encryption pass instead of
+  /// one full packaging pass per DRM system.
+  void set_additional_key_system_info(
+      const std::vector<ProtectionSystemSpecificInfo>& key_system_info) {
+    additional_key_system_info_ = key_system_info;
+  }
+
   /// Convert string representation of track type to enum representation.
   static TrackType GetTrackTypeFromString(const std::string& track_type_string);
 
   /// Convert TrackType to string.
   static std::string TrackTypeToString(TrackType track_type);
 
+ protected:
+  /// Append the additional key system info, if any, to @a key. Subclasses
+  /// must call this on every key returned from GetKey() and
+  /// GetCryptoPeriodKey().
+  void AppendAdditionalKeySystemInfo(EncryptionKey* key) const;
+
  private:
+  std::vector<ProtectionSystemSpecificInfo> additional_key_system_info_;
+
   DISALLOW_COPY_AND_ASSIGN(KeySource);
 };
 
@@ -13,6 +13,8 @@
       'target_name': 'media_base',
       'type': '<(component)',
       'sources': [
+        'aes_crypto_backend.cc',
+        'aes_crypto_backend.h',
         'aes_cryptor.cc',
         'aes_cryptor.h',
         'aes_decryptor.cc',
@@ -27,6 +29,8 @@
         'audio_timestamp_helper.h',
         'bit_reader.cc',
         'bit_reader.h',
+        'buffer_pool.cc',
+        'buffer_pool.h',
         'buffer_reader.cc',
         'buffer_reader.h',
         'buffer_writer.cc',
@@ -37,6 +41,8 @@
         'closure_thread.h',
         'container_names.cc',
         'container_names.h',
+        'crc32.cc',
+        'crc32.h',
         'demuxer.cc',
         'demuxer.h',
         'decrypt_config.cc',
@@ -47,6 +53,10 @@
         'fixed_key_source.cc',
         'fixed_key_source.h',
         'fourccs.h',
+        'gather_buffer.cc',
+        'gather_buffer.h',
+        'hex_base64.cc',
+        'hex_base64.h',
         'http_key_fetcher.cc',
         'http_key_fetcher.h',
         'key_fetcher.cc',
@@ -55,7 +65,10 @@
         'key_source.h',
         'limits.h',
         'macros.h',
+        'media_parser.cc',
         'media_parser.h',
+        'memory_budget.cc',
+        'memory_budget.h',
         'media_sample.cc',
         'media_sample.h',
         'media_stream.cc',
@@ -70,6 +83,8 @@
         'network_util.h',
         'offset_byte_queue.cc',
         'offset_byte_queue.h',
+        'pipeline_stats.cc',
+        'pipeline_stats.h',
         'producer_consumer_queue.h',
         'protection_system_specific_info.cc',
         'protection_system_specific_info.h',
@@ -78,16 +93,29 @@
         'request_signer.h',
         'rsa_key.cc',
         'rsa_key.h',
+        'runtime_config.cc',
+        'runtime_config.h',
+        'shared_buffer.cc',
+        'shared_buffer.h',
+        'spsc_ring_queue.h',
         'status.cc',
         'status.h',
         'stream_info.cc',
         'stream_info.h',
+        'synthetic_key_source.cc',
+        'synthetic_key_source.h',
+        'task_pool.cc',
+        'task_pool.h',
         'text_stream_info.cc',
         'text_stream_info.h',
         'text_track.h',
         'text_track_config.cc',
         'text_track_config.h',
         'timestamp.h',
+        'timestamp_rescaler.cc',
+        'timestamp_rescaler.h',
+        'trace_span.cc',
+        'trace_span.h',
         'video_stream_info.cc',
         'video_stream_info.h',
         'widevine_key_source.cc',
@@ -123,19 +151,30 @@
         'aes_pattern_cryptor_unittest.cc',
         'audio_timestamp_helper_unittest.cc',
         'bit_reader_unittest.cc',
+        'buffer_pool_unittest.cc',
+        'buffer_reader_unittest.cc',
         'buffer_writer_unittest.cc',
         'closure_thread_unittest.cc',
         'container_names_unittest.cc',
+        'crc32_unittest.cc',
         'decryptor_source_unittest.cc',
         'fixed_key_source_unittest.cc',
+        'hex_base64_unittest.cc',
         'http_key_fetcher_unittest.cc',
+        'media_sample_unittest.cc',
         'muxer_util_unittest.cc',
         'offset_byte_queue_unittest.cc',
         'producer_consumer_queue_unittest.cc',
+        'spsc_ring_queue_unittest.cc',
         'protection_system_specific_info_unittest.cc',
         'rsa_key_unittest.cc',
+        'runtime_config_unittest.cc',
         'status_test_util_unittest.cc',
         'status_unittest.cc',
+        'synthetic_key_source_unittest.cc',
+        'task_pool_unittest.cc',
+        'timestamp_rescaler_unittest.cc',
+        'trace_span_unittest.cc',
         'test/fake_prng.cc',  # For rsa_key_unittest
         'test/fake_prng.h',   # For rsa_key_unittest
         'test/rsa_test_data.cc',  # For rsa_key_unittest
@@ -0,0 +1,30 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/media_parser.h"
+
+#include "packager/media/base/media_sample.h"
+
+namespace shaka {
+namespace media {
+
+bool MediaParser::DeliverSampleBatch(
+    uint32_t track_id,
+    const std::vector<scoped_refptr<MediaSample> >& samples,
+    const NewSampleCB& sample_cb) const {
+  if (samples.empty())
+    return true;
+  if (!sample_batch_cb_.is_null())
+    return sample_batch_cb_.Run(track_id, samples);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    if (!sample_cb.Run(track_id, samples[i]))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace media
+}  // namespace shaka
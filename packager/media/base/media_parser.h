@@ -43,6 +43,19 @@ class MediaParser {
                               const scoped_refptr<MediaSample>& media_sample)>
       NewSampleCB;
 
+  /// Called when a contiguous batch of media samples of one track has been
+  /// parsed. Semantically equivalent to one NewSampleCB invocation per
+  /// sample, in order, but amortizes the callback and downstream handoff
+  /// costs across the batch.
+  /// @param track_id is the track id of the samples.
+  /// @param samples are the new media samples, in decode order.
+  /// @return true if the samples are accepted, false if something was wrong
+  ///         and a parsing error should be signaled.
+  typedef base::Callback<bool(
+      uint32_t track_id,
+      const std::vector<scoped_refptr<MediaSample> >& samples)>
+      NewSampleBatchCB;
+
   /// Initialize the parser with necessary callbacks. Must be called before any
   /// data is passed to Parse().
   /// @param init_cb will be called once enough data has been parsed to
@@ -54,6 +67,17 @@ class MediaParser {
                     const NewSampleCB& new_sample_cb,
                     KeySource* decryption_key_source) = 0;
 
+  /// Set an optional batch callback. Parsers with batch support deliver
+  /// samples through it in contiguous per-track batches (per movie fragment
+  /// for MP4, per PES emission run for MPEG-2 TS, per input buffer for
+  /// WebVTT) instead of one NewSampleCB
+  /// invocation per sample; parsers without batch support are unaffected.
+  /// Must be called before any data is passed to Parse(). The caller retains
+  /// ownership.
+  void set_sample_batch_cb(const NewSampleBatchCB& sample_batch_cb) {
+    sample_batch_cb_ = sample_batch_cb;
+  }
+
   /// Flush data currently in the parser and put the parser in a state where it
   /// can receive data for a new seek point.
   /// @return true if successful, false otherwise.
@@ -63,7 +87,19 @@ class MediaParser {
   /// @return true if successful.
   virtual bool Parse(const uint8_t* buf, int size) WARN_UNUSED_RESULT = 0;
 
+ protected:
+  /// Deliver @a samples of @a track_id downstream: through the batch
+  /// callback when one is set, with one @a sample_cb invocation per sample
+  /// otherwise.
+  /// @return true if all the samples are accepted.
+  bool DeliverSampleBatch(
+      uint32_t track_id,
+      const std::vector<scoped_refptr<MediaSample> >& samples,
+      const NewSampleCB& sample_cb) const;
+
  private:
+  NewSampleBatchCB sample_batch_cb_;
+
   DISALLOW_COPY_AND_ASSIGN(MediaParser);
 };
 
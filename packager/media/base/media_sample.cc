@@ -7,9 +7,11 @@
 #include "packager/media/base/media_sample.h"
 
 #include <inttypes.h>
+#include <string.h>
 
 #include "packager/base/logging.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/media/base/buffer_pool.h"
 
 namespace shaka {
 namespace media {
@@ -23,12 +25,14 @@ MediaSample::MediaSample(const uint8_t* data,
       pts_(0),
       duration_(0),
       is_key_frame_(is_key_frame),
-      is_encrypted_(false) {
+      is_encrypted_(false),
+      view_offset_(0),
+      view_size_(0) {
   if (!data) {
     CHECK_EQ(size, 0u);
+  } else {
+    set_data(data, size);
   }
-
-  data_.assign(data, data + size);
   if (side_data)
     side_data_.assign(side_data, side_data + side_data_size);
 }
@@ -37,9 +41,46 @@ MediaSample::MediaSample() : dts_(0),
                              pts_(0),
                              duration_(0),
                              is_key_frame_(false),
-                             is_encrypted_(false) {}
+                             is_encrypted_(false),
+                             view_offset_(0),
+                             view_size_(0) {}
+
+MediaSample::~MediaSample() {
+  BufferPool::GetInstance()->Release(&data_);
+}
+
+void MediaSample::set_data(const uint8_t* data, const size_t data_size) {
+  shared_buffer_ = NULL;
+  view_offset_ = 0;
+  view_size_ = 0;
+  if (data_size > data_.capacity()) {
+    BufferPool::GetInstance()->Release(&data_);
+    BufferPool::GetInstance()->Acquire(data_size, &data_);
+  } else {
+    data_.resize(data_size);
+  }
+  if (data_size > 0)
+    memcpy(&data_[0], data, data_size);
+}
 
-MediaSample::~MediaSample() {}
+void MediaSample::set_data_view(const scoped_refptr<SharedBuffer>& buffer,
+                                size_t offset,
+                                size_t size) {
+  DCHECK(buffer);
+  DCHECK_GT(size, 0u);
+  DCHECK_LE(offset + size, buffer->size());
+  BufferPool::GetInstance()->Release(&data_);
+  shared_buffer_ = buffer;
+  view_offset_ = offset;
+  view_size_ = size;
+}
+
+void MediaSample::DetachView() {
+  DCHECK(shared_buffer_);
+  // Keep the buffer alive while its bytes are copied out by set_data().
+  scoped_refptr<SharedBuffer> buffer = shared_buffer_;
+  set_data(buffer->data() + view_offset_, view_size_);
+}
 
 // static
 scoped_refptr<MediaSample> MediaSample::CopyFrom(const uint8_t* data,
@@ -63,6 +104,18 @@ scoped_refptr<MediaSample> MediaSample::CopyFrom(const uint8_t* data,
       data, data_size, side_data, side_data_size, is_key_frame));
 }
 
+// static
+scoped_refptr<MediaSample> MediaSample::CreateView(
+    const scoped_refptr<SharedBuffer>& buffer,
+    size_t offset,
+    size_t size,
+    bool is_key_frame) {
+  scoped_refptr<MediaSample> sample(new MediaSample());
+  sample->set_data_view(buffer, offset, size);
+  sample->set_is_key_frame(is_key_frame);
+  return sample;
+}
+
 // static
 scoped_refptr<MediaSample> MediaSample::FromMetadata(const uint8_t* metadata,
                                                      size_t metadata_size) {
@@ -91,7 +144,7 @@ std::string MediaSample::ToString() const {
       pts_,
       duration_,
       is_key_frame_ ? "true" : "false",
-      data_.size(),
+      data_size(),
       side_data_.size());
 }
 
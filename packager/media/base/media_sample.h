@@ -14,6 +14,7 @@
 #include "packager/base/logging.h"
 #include "packager/base/memory/ref_counted.h"
 #include "packager/base/memory/scoped_ptr.h"
+#include "packager/media/base/shared_buffer.h"
 
 namespace shaka {
 namespace media {
@@ -45,6 +46,20 @@ class MediaSample : public base::RefCountedThreadSafe<MediaSample> {
                                              size_t side_data_size,
                                              bool is_key_frame);
 
+  /// Create a MediaSample as a zero-copy view over a slice of @a buffer.
+  /// The sample shares the buffer bytes until a writer asks for
+  /// writable_data(), at which point the view is detached into a private
+  /// copy. The underlying buffer must not be mutated while views exist.
+  /// @param buffer is the shared buffer backing the view. Must not be NULL.
+  /// @param offset is the offset of the slice within @a buffer.
+  /// @param size is the slice size in bytes. Must not be zero.
+  /// @param is_key_frame indicates whether the sample is a key frame.
+  static scoped_refptr<MediaSample> CreateView(
+      const scoped_refptr<SharedBuffer>& buffer,
+      size_t offset,
+      size_t size,
+      bool is_key_frame);
+
   /// Create a MediaSample object from metadata.
   /// Unlike other factory methods, this cannot be a key frame. It must be only
   /// for metadata.
@@ -97,17 +112,19 @@ class MediaSample : public base::RefCountedThreadSafe<MediaSample> {
   }
   const uint8_t* data() const {
     DCHECK(!end_of_stream());
-    return &data_[0];
+    return shared_buffer_ ? shared_buffer_->data() + view_offset_ : &data_[0];
   }
 
   uint8_t* writable_data() {
     DCHECK(!end_of_stream());
+    if (shared_buffer_)
+      DetachView();
     return &data_[0];
   }
 
   size_t data_size() const {
     DCHECK(!end_of_stream());
-    return data_.size();
+    return shared_buffer_ ? view_size_ : data_.size();
   }
 
   const uint8_t* side_data() const {
@@ -118,11 +135,17 @@ class MediaSample : public base::RefCountedThreadSafe<MediaSample> {
     return side_data_.size();
   }
 
-  void set_data(const uint8_t* data, const size_t data_size) {
-    data_.assign(data, data + data_size);
-  }
+  void set_data(const uint8_t* data, const size_t data_size);
+
+  /// Make this sample a zero-copy view over a slice of @a buffer; see
+  /// CreateView(). Any previously owned data is released.
+  void set_data_view(const scoped_refptr<SharedBuffer>& buffer,
+                     size_t offset,
+                     size_t size);
 
   void resize_data(const size_t data_size) {
+    if (shared_buffer_)
+      DetachView();
     data_.resize(data_size);
   }
 
@@ -135,7 +158,7 @@ class MediaSample : public base::RefCountedThreadSafe<MediaSample> {
   }
 
   // If there's no data in this buffer, it represents end of stream.
-  bool end_of_stream() const { return data_.size() == 0; }
+  bool end_of_stream() const { return !shared_buffer_ && data_.size() == 0; }
 
   const std::string& config_id() const { return config_id_; }
   void set_config_id(const std::string& config_id) {
@@ -159,6 +182,10 @@ class MediaSample : public base::RefCountedThreadSafe<MediaSample> {
   MediaSample();
   virtual ~MediaSample();
 
+  // Copy the viewed bytes into |data_| and drop the shared buffer reference,
+  // so the sample owns a private mutable copy.
+  void DetachView();
+
   // Decoding time stamp.
   int64_t dts_;
   // Presentation time stamp.
@@ -168,8 +195,15 @@ class MediaSample : public base::RefCountedThreadSafe<MediaSample> {
   // is sample encrypted ?
   bool is_encrypted_;
 
-  // Main buffer data.
+  // Main buffer data. The buffer is acquired from and released to the
+  // process-wide BufferPool to avoid per-sample heap allocations. Unused
+  // while |shared_buffer_| below is set.
   std::vector<uint8_t> data_;
+  // When set, the sample is a zero-copy view of |view_size_| bytes at
+  // |view_offset_| in |shared_buffer_| instead of owning |data_|.
+  scoped_refptr<SharedBuffer> shared_buffer_;
+  size_t view_offset_;
+  size_t view_size_;
   // Contain additional buffers to complete the main one. Needed by WebM
   // http://www.matroska.org/technical/specs/index.html BlockAdditional[A5].
   // Not used by mp4 and other containers.
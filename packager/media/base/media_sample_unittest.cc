@@ -0,0 +1,82 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/shared_buffer.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const uint8_t kData[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+
+}  // namespace
+
+TEST(MediaSampleTest, CopyFromOwnsData) {
+  scoped_refptr<MediaSample> sample(
+      MediaSample::CopyFrom(kData, sizeof(kData), true));
+  ASSERT_EQ(sizeof(kData), sample->data_size());
+  EXPECT_EQ(0, memcmp(kData, sample->data(), sizeof(kData)));
+  EXPECT_NE(kData, sample->data());
+  EXPECT_TRUE(sample->is_key_frame());
+  EXPECT_FALSE(sample->end_of_stream());
+}
+
+TEST(MediaSampleTest, ViewSharesBufferBytes) {
+  scoped_refptr<SharedBuffer> buffer(
+      SharedBuffer::CopyFrom(kData, sizeof(kData)));
+  scoped_refptr<MediaSample> sample(
+      MediaSample::CreateView(buffer, 2, 4, false));
+
+  ASSERT_EQ(4u, sample->data_size());
+  EXPECT_EQ(buffer->data() + 2, sample->data());
+  EXPECT_EQ(0, memcmp(kData + 2, sample->data(), 4));
+  EXPECT_FALSE(sample->end_of_stream());
+}
+
+TEST(MediaSampleTest, WritableDataDetachesView) {
+  scoped_refptr<SharedBuffer> buffer(
+      SharedBuffer::CopyFrom(kData, sizeof(kData)));
+  scoped_refptr<MediaSample> sample(
+      MediaSample::CreateView(buffer, 2, 4, false));
+
+  uint8_t* writable = sample->writable_data();
+  // The sample now owns a private copy; mutations do not alias the shared
+  // buffer.
+  EXPECT_NE(buffer->data() + 2, writable);
+  ASSERT_EQ(4u, sample->data_size());
+  EXPECT_EQ(0, memcmp(kData + 2, writable, 4));
+
+  writable[0] = 0xff;
+  EXPECT_EQ(0x03, buffer->data()[2]);
+}
+
+TEST(MediaSampleTest, SetDataDropsView) {
+  scoped_refptr<SharedBuffer> buffer(
+      SharedBuffer::CopyFrom(kData, sizeof(kData)));
+  scoped_refptr<MediaSample> sample(
+      MediaSample::CreateView(buffer, 0, sizeof(kData), false));
+
+  const uint8_t kNewData[] = {0x0a, 0x0b};
+  sample->set_data(kNewData, sizeof(kNewData));
+  ASSERT_EQ(sizeof(kNewData), sample->data_size());
+  EXPECT_EQ(0, memcmp(kNewData, sample->data(), sizeof(kNewData)));
+}
+
+TEST(MediaSampleTest, MoveFromEmptiesSource) {
+  std::vector<uint8_t> source(kData, kData + sizeof(kData));
+  const uint8_t* source_data = &source[0];
+  scoped_refptr<SharedBuffer> buffer(SharedBuffer::MoveFrom(&source));
+
+  EXPECT_TRUE(source.empty());
+  EXPECT_EQ(source_data, buffer->data());
+  EXPECT_EQ(sizeof(kData), buffer->size());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -6,20 +6,41 @@
 
 #include "packager/media/base/media_stream.h"
 
+#include "packager/base/bind.h"
 #include "packager/base/logging.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/media/base/closure_thread.h"
 #include "packager/media/base/demuxer.h"
 #include "packager/media/base/media_sample.h"
+#include "packager/media/base/memory_budget.h"
 #include "packager/media/base/muxer.h"
+#include "packager/media/base/producer_consumer_queue.h"  // For kInfiniteTimeout.
 #include "packager/media/base/stream_info.h"
 
 namespace shaka {
 namespace media {
+namespace {
+// Samples are transferred to the worker thread in batches so that the queue
+// lock and condition variable wakeup are amortized over many samples; at
+// audio sample rates per-sample handoff costs show up in demux thread
+// profiles.
+const size_t kSampleBatchSize = 32u;
+// Bounds staging memory in threaded push mode while keeping the muxer thread
+// busy: kBatchQueueCapacity * kSampleBatchSize samples at most.
+const size_t kBatchQueueCapacity = 16u;
+}  // namespace
 
 MediaStream::MediaStream(scoped_refptr<StreamInfo> info, Demuxer* demuxer)
-    : info_(info), demuxer_(demuxer), muxer_(NULL), state_(kIdle) {}
+    : info_(info),
+      demuxer_(demuxer),
+      state_(kIdle),
+      draining_batch_(NULL),
+      draining_index_(0) {}
 
-MediaStream::~MediaStream() {}
+MediaStream::~MediaStream() {
+  if (sample_queue_)
+    sample_queue_->Stop();
+}
 
 Status MediaStream::PullSample(scoped_refptr<MediaSample>* sample) {
   DCHECK_EQ(state_, kPulling);
@@ -33,6 +54,7 @@ Status MediaStream::PullSample(scoped_refptr<MediaSample>* sample) {
 
   *sample = samples_.front();
   samples_.pop_front();
+  ReleaseBudget(*sample);
   return Status::OK;
 }
 
@@ -41,11 +63,21 @@ Status MediaStream::PushSample(const scoped_refptr<MediaSample>& sample) {
     case kIdle:
     case kPulling:
       samples_.push_back(sample);
+      ChargeBudget(sample);
       return Status::OK;
     case kDisconnected:
       return Status::OK;
     case kPushing:
-      return muxer_->AddSample(this, sample);
+      // Consumed synchronously; nothing is buffered.
+      return PushToMuxers(sample);
+    case kThreadedPushing:
+      // Batch samples before handing them to the worker thread; the end of
+      // stream sample flushes the pending batch.
+      pending_batch_.push_back(sample);
+      ChargeBudget(sample);
+      if (pending_batch_.size() < kSampleBatchSize && !sample->end_of_stream())
+        return Status::OK;
+      return FlushBatch();
     default:
       NOTREACHED() << "Unexpected State " << state_;
       return Status::UNKNOWN;
@@ -54,32 +86,70 @@ Status MediaStream::PushSample(const scoped_refptr<MediaSample>& sample) {
 
 void MediaStream::Connect(Muxer* muxer) {
   DCHECK(muxer);
-  DCHECK(!muxer_);
+  DCHECK(state_ == kIdle || state_ == kConnected);
   state_ = kConnected;
-  muxer_ = muxer;
+  muxers_.push_back(muxer);
+}
+
+Status MediaStream::PushToMuxers(const scoped_refptr<MediaSample>& sample) {
+  Status status;
+  for (std::vector<Muxer*>::iterator it = muxers_.begin();
+       it != muxers_.end();
+       ++it) {
+    status.Update((*it)->AddSample(this, sample));
+  }
+  return status;
 }
 
 Status MediaStream::Start(MediaStreamOperation operation) {
   DCHECK(demuxer_);
-  DCHECK(operation == kPush || operation == kPull);
+  DCHECK(operation == kPush || operation == kThreadedPush ||
+         operation == kPull);
 
   switch (state_) {
     case kIdle:
       // Disconnect the stream if it is not connected to a muxer.
       state_ = kDisconnected;
-      samples_.clear();
+      while (!samples_.empty()) {
+        ReleaseBudget(samples_.front());
+        samples_.pop_front();
+      }
       return Status::OK;
     case kConnected:
-      state_ = (operation == kPush) ? kPushing : kPulling;
-      if (operation == kPush) {
+      state_ = (operation == kPush)
+                   ? kPushing
+                   : (operation == kThreadedPush) ? kThreadedPushing
+                                                  : kPulling;
+      if (operation == kThreadedPush) {
+        sample_queue_.reset(new SpscRingQueue<
+            std::vector<scoped_refptr<MediaSample> > >(kBatchQueueCapacity));
+        drain_thread_.reset(new ClosureThread(
+            "MediaStreamPush",
+            base::Bind(&MediaStream::DrainSampleQueue,
+                       base::Unretained(this))));
+        drain_thread_->Start();
+        // Queue samples buffered before Start if there is any.
+        while (!samples_.empty()) {
+          pending_batch_.push_back(samples_.front());
+          samples_.pop_front();
+          if (pending_batch_.size() >= kSampleBatchSize) {
+            Status status = FlushBatch();
+            if (!status.ok())
+              return status;
+          }
+        }
+      } else if (operation == kPush) {
         // Push samples in the queue to muxer if there is any.
         while (!samples_.empty()) {
-          Status status = muxer_->AddSample(this, samples_.front());
+          Status status = PushToMuxers(samples_.front());
           if (!status.ok())
             return status;
+          ReleaseBudget(samples_.front());
           samples_.pop_front();
         }
       } else {
+        // Fan-out is only supported in push modes.
+        DCHECK_EQ(1u, muxers_.size());
         // We need to disconnect all its peer streams which are not connected
         // to a muxer.
         for (size_t i = 0; i < demuxer_->streams().size(); ++i) {
@@ -98,6 +168,113 @@ Status MediaStream::Start(MediaStreamOperation operation) {
   }
 }
 
+Status MediaStream::FinishThreadedPush() {
+  if (state_ != kThreadedPushing)
+    return Status::OK;
+  DCHECK(sample_queue_);
+  DCHECK(drain_thread_);
+  // Flush any partial batch, then let the drain loop consume what is already
+  // queued and exit.
+  Status status;
+  if (!pending_batch_.empty())
+    status = FlushBatch();
+  sample_queue_->Stop();
+  drain_thread_->Join();
+  status.Update(drain_status_);
+  return status;
+}
+
+bool MediaStream::PeekNextKeyFrameTimestamp(int64_t* timestamp) const {
+  DCHECK(timestamp);
+  // |draining_batch_| is only set while the drain thread is delivering a
+  // sample, so a non-NULL value also means we are on the drain thread.
+  if (state_ != kThreadedPushing || !draining_batch_)
+    return false;
+  // First the rest of the batch being delivered.
+  for (size_t i = draining_index_ + 1; i < draining_batch_->size(); ++i) {
+    const scoped_refptr<MediaSample>& sample = (*draining_batch_)[i];
+    if (sample->end_of_stream())
+      return false;
+    if (sample->is_key_frame()) {
+      *timestamp = sample->dts();
+      return true;
+    }
+  }
+  // Then the batches still staged in the ring queue. Peeking from the
+  // consumer thread is safe; see SpscRingQueue::PeekFromFront.
+  std::vector<scoped_refptr<MediaSample> > batch;
+  for (size_t offset = 0; sample_queue_->PeekFromFront(offset, &batch);
+       ++offset) {
+    for (size_t i = 0; i < batch.size(); ++i) {
+      if (batch[i]->end_of_stream())
+        return false;
+      if (batch[i]->is_key_frame()) {
+        *timestamp = batch[i]->dts();
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+Status MediaStream::FlushBatch() {
+  DCHECK(sample_queue_);
+  std::vector<scoped_refptr<MediaSample> > batch;
+  batch.swap(pending_batch_);
+  Status status = sample_queue_->Push(batch, kInfiniteTimeout);
+  if (!status.ok()) {
+    // The batch was not handed over (queue stopped); it is not buffered.
+    for (size_t i = 0; i < batch.size(); ++i)
+      ReleaseBudget(batch[i]);
+  }
+  return status;
+}
+
+void MediaStream::ChargeBudget(const scoped_refptr<MediaSample>& sample) {
+  MemoryBudget* budget = demuxer_->memory_budget();
+  if (budget)
+    budget->Charge(sample->data_size());
+}
+
+void MediaStream::ReleaseBudget(const scoped_refptr<MediaSample>& sample) {
+  MemoryBudget* budget = demuxer_->memory_budget();
+  if (budget)
+    budget->Release(sample->data_size());
+}
+
+void MediaStream::DrainSampleQueue() {
+  while (true) {
+    std::vector<scoped_refptr<MediaSample> > batch;
+    Status status = sample_queue_->Pop(&batch, kInfiniteTimeout);
+    if (!status.ok()) {
+      // Queue stopped and fully drained.
+      return;
+    }
+    for (size_t i = 0; i < batch.size(); ++i) {
+      draining_batch_ = &batch;
+      draining_index_ = i;
+      drain_status_ = PushToMuxers(batch[i]);
+      draining_batch_ = NULL;
+      ReleaseBudget(batch[i]);
+      if (!drain_status_.ok() || batch[i]->end_of_stream()) {
+        // Stop the queue so that a blocked producer does not wait forever on
+        // a dead consumer.
+        sample_queue_->Stop();
+        // Release the bytes of anything left undelivered so a producer
+        // blocked on the memory budget does not wait on a dead consumer
+        // either.
+        for (size_t j = i + 1; j < batch.size(); ++j)
+          ReleaseBudget(batch[j]);
+        while (sample_queue_->Pop(&batch, 0).ok()) {
+          for (size_t j = 0; j < batch.size(); ++j)
+            ReleaseBudget(batch[j]);
+        }
+        return;
+      }
+    }
+  }
+}
+
 const scoped_refptr<StreamInfo> MediaStream::info() const { return info_; }
 
 std::string MediaStream::ToString() const {
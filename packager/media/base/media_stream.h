@@ -8,25 +8,35 @@
 #define MEDIA_BASE_MEDIA_STREAM_H_
 
 #include <deque>
+#include <vector>
 
 #include "packager/base/memory/ref_counted.h"
 #include "packager/base/memory/scoped_ptr.h"
+#include "packager/media/base/spsc_ring_queue.h"
 #include "packager/media/base/status.h"
 
 namespace shaka {
 namespace media {
 
+class ClosureThread;
 class Demuxer;
 class Muxer;
 class MediaSample;
 class StreamInfo;
 
 /// MediaStream connects Demuxer to Muxer. It is an abstraction for a media
-/// elementary stream.
+/// elementary stream. In push mode a stream may be connected to multiple
+/// muxers: one demux/parse pass then fans the (reference counted) samples out
+/// to every connected muxer, e.g. to produce MP4 and TS output from a single
+/// read of the input. Pull mode supports a single connected muxer only.
 class MediaStream {
  public:
   enum MediaStreamOperation {
     kPush,
+    // Like kPush, but samples are staged in a bounded thread safe queue and
+    // fed to the muxer on a dedicated worker thread, so demuxing/parsing
+    // overlaps with muxing/encryption.
+    kThreadedPush,
     kPull,
   };
   /// Create MediaStream from StreamInfo and Demuxer.
@@ -34,7 +44,8 @@ class MediaStream {
   MediaStream(scoped_refptr<StreamInfo> info, Demuxer* demuxer);
   ~MediaStream();
 
-  /// Connect the stream to Muxer.
+  /// Connect the stream to Muxer. May be called multiple times to fan the
+  /// stream out to several muxers; see the class comment.
   /// @param muxer cannot be NULL.
   void Connect(Muxer* muxer);
 
@@ -47,8 +58,29 @@ class MediaStream {
   /// Pull sample from Demuxer (triggered by Muxer).
   Status PullSample(scoped_refptr<MediaSample>* sample);
 
+  /// Wait for the worker thread created by a kThreadedPush Start to drain all
+  /// queued samples and exit. No-op for other operations.
+  /// @return the status of the last Muxer::AddSample performed on the worker
+  ///         thread.
+  Status FinishThreadedPush();
+
+  /// Look ahead at samples that have been parsed and staged for this stream
+  /// but not yet delivered, and report the timestamp of the next key frame
+  /// among them. Only meaningful in threaded push mode and on the delivering
+  /// thread, i.e. when called from within Muxer::AddSample; the lookahead
+  /// window is bounded by the staging queue capacity. Muxers use this to plan
+  /// segment split points: knowing where the next GOP starts allows cutting
+  /// at the key frame closest to the target duration instead of the first key
+  /// frame past it.
+  /// @param[out] timestamp receives the decoding timestamp of the next staged
+  ///             key frame, in the stream's timescale.
+  /// @return true if a key frame was found in the staged window; false
+  ///         otherwise, including in non-threaded modes.
+  bool PeekNextKeyFrameTimestamp(int64_t* timestamp) const;
+
   Demuxer* demuxer() { return demuxer_; }
-  Muxer* muxer() { return muxer_; }
+  /// @return the first connected muxer, or NULL if not connected.
+  Muxer* muxer() { return muxers_.empty() ? NULL : muxers_.front(); }
   const scoped_refptr<StreamInfo> info() const;
 
   /// @return a human-readable string describing |*this|.
@@ -61,15 +93,45 @@ class MediaStream {
     kConnected,
     kDisconnected,
     kPushing,
+    kThreadedPushing,
     kPulling,
   };
 
+  // Runs on |drain_thread_|. Pops samples from |sample_queue_| and feeds them
+  // to the muxer(s) until end of stream, a muxer error or queue Stop.
+  void DrainSampleQueue();
+
+  // Delivers |sample| to every connected muxer; the first error wins.
+  Status PushToMuxers(const scoped_refptr<MediaSample>& sample);
+
+  // Hands the pending sample batch to the worker thread as one queue element
+  // so the queue lock is amortized over the whole batch.
+  Status FlushBatch();
+
+  // Charge/release the demuxer's memory budget, if any, for a sample held in
+  // |samples_|, |pending_batch_| or |sample_queue_|. See MemoryBudget.
+  void ChargeBudget(const scoped_refptr<MediaSample>& sample);
+  void ReleaseBudget(const scoped_refptr<MediaSample>& sample);
+
   scoped_refptr<StreamInfo> info_;
   Demuxer* demuxer_;
-  Muxer* muxer_;
+  std::vector<Muxer*> muxers_;
   State state_;
   // An internal buffer to store samples temporarily.
   std::deque<scoped_refptr<MediaSample> > samples_;
+  // Used in threaded push mode only. The demuxer thread is the single
+  // producer and the drain thread the single consumer, so a lock-free ring
+  // is used; samples cross the thread boundary in batches.
+  scoped_ptr<SpscRingQueue<std::vector<scoped_refptr<MediaSample> > > >
+      sample_queue_;
+  std::vector<scoped_refptr<MediaSample> > pending_batch_;
+  scoped_ptr<ClosureThread> drain_thread_;
+  Status drain_status_;
+  // The batch currently being delivered by the drain thread and the index of
+  // the sample being delivered. Only touched on the drain thread; they give
+  // PeekNextKeyFrameTimestamp() its lookahead window.
+  const std::vector<scoped_refptr<MediaSample> >* draining_batch_;
+  size_t draining_index_;
 
   DISALLOW_COPY_AND_ASSIGN(MediaStream);
 };
@@ -0,0 +1,63 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/memory_budget.h"
+
+#include "packager/base/logging.h"
+#include "packager/media/base/pipeline_stats.h"
+
+namespace shaka {
+namespace media {
+
+MemoryBudget::MemoryBudget(uint64_t budget_bytes)
+    : budget_bytes_(budget_bytes),
+      within_budget_cv_(&lock_),
+      charged_bytes_(0),
+      exceeded_count_(0) {
+  DCHECK_GT(budget_bytes, 0u);
+}
+
+MemoryBudget::~MemoryBudget() {}
+
+void MemoryBudget::Charge(uint64_t bytes) {
+  base::AutoLock auto_lock(lock_);
+  const bool was_within = charged_bytes_ <= budget_bytes_;
+  charged_bytes_ += bytes;
+  if (was_within && charged_bytes_ > budget_bytes_) {
+    ++exceeded_count_;
+    pipeline_stats::RecordBudgetExceeded();
+    LOG(WARNING) << "Job memory budget exceeded: " << charged_bytes_ << " of "
+                 << budget_bytes_ << " bytes buffered. Input reads are paused "
+                 << "until the pipeline drains.";
+  }
+}
+
+void MemoryBudget::Release(uint64_t bytes) {
+  base::AutoLock auto_lock(lock_);
+  DCHECK_GE(charged_bytes_, bytes);
+  charged_bytes_ -= bytes;
+  if (charged_bytes_ <= budget_bytes_)
+    within_budget_cv_.Broadcast();
+}
+
+void MemoryBudget::WaitUntilWithinBudget() {
+  base::AutoLock auto_lock(lock_);
+  while (charged_bytes_ > budget_bytes_)
+    within_budget_cv_.Wait();
+}
+
+uint64_t MemoryBudget::charged_bytes() const {
+  base::AutoLock auto_lock(lock_);
+  return charged_bytes_;
+}
+
+uint64_t MemoryBudget::exceeded_count() const {
+  base::AutoLock auto_lock(lock_);
+  return exceeded_count_;
+}
+
+}  // namespace media
+}  // namespace shaka
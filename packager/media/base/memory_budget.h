@@ -0,0 +1,67 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_MEMORY_BUDGET_H_
+#define PACKAGER_MEDIA_BASE_MEMORY_BUDGET_H_
+
+#include <stdint.h>
+
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+namespace media {
+
+/// Tracks the bytes a packaging job holds in its pipeline buffers against a
+/// fixed budget and coordinates backpressure at the input: the buffer owners
+/// (the media streams between demuxer and muxers) charge the budget as
+/// samples are buffered and release as they are consumed, and the demuxer
+/// blocks before the next input read while the job is over budget. Charging
+/// never blocks - samples already parsed must go downstream - so consumers
+/// always make progress and the reader resumes once they drain.
+/// Thread safe.
+class MemoryBudget {
+ public:
+  /// @param budget_bytes is the maximum number of bytes the job should hold
+  ///        buffered. Must be positive. The budget is a soft limit: it can
+  ///        be overshot by the samples of one parse iteration before the
+  ///        reader pauses.
+  explicit MemoryBudget(uint64_t budget_bytes);
+  ~MemoryBudget();
+
+  /// Charge @a bytes against the budget. Never blocks. The first charge that
+  /// crosses the budget logs a warning and is counted on the stats surface.
+  void Charge(uint64_t bytes);
+
+  /// Release @a bytes previously charged.
+  void Release(uint64_t bytes);
+
+  /// Block until the charged bytes are back within the budget. Called on the
+  /// reading (demuxer) thread between input reads.
+  void WaitUntilWithinBudget();
+
+  uint64_t budget_bytes() const { return budget_bytes_; }
+  uint64_t charged_bytes() const;
+
+  /// @return The number of times a charge crossed the budget.
+  uint64_t exceeded_count() const;
+
+ private:
+  const uint64_t budget_bytes_;
+
+  mutable base::Lock lock_;
+  base::ConditionVariable within_budget_cv_;
+  uint64_t charged_bytes_;
+  uint64_t exceeded_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemoryBudget);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_MEMORY_BUDGET_H_
@@ -9,9 +9,47 @@
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/media_stream.h"
+#include "packager/media/base/pipeline_stats.h"
+#include "packager/media/base/stream_info.h"
 
 namespace shaka {
 namespace media {
+namespace {
+
+// Minimum progress advance before an update is forwarded to the wrapped
+// listener. 0.001 keeps a progress bar smooth while capping the number of
+// forwarded updates at about a thousand per job.
+const double kMinProgressDelta = 0.001;
+
+// Drops OnProgress() calls that advance progress by less than |min_delta|
+// since the last forwarded call. Completion (progress >= 1.0) is always
+// forwarded. This keeps listener dispatch cost independent of how often the
+// segmenters report progress.
+class ThrottledProgressListener : public ProgressListener {
+ public:
+  ThrottledProgressListener(scoped_ptr<ProgressListener> listener,
+                            double min_delta)
+      : listener_(listener.Pass()),
+        min_delta_(min_delta),
+        last_reported_progress_(-1.0) {}
+  ~ThrottledProgressListener() override {}
+
+  void OnProgress(double progress) override {
+    if (progress < 1.0 && progress - last_reported_progress_ < min_delta_)
+      return;
+    last_reported_progress_ = progress;
+    listener_->OnProgress(progress);
+  }
+
+ private:
+  scoped_ptr<ProgressListener> listener_;
+  const double min_delta_;
+  double last_reported_progress_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThrottledProgressListener);
+};
+
+}  // namespace
 
 Muxer::Muxer(const MuxerOptions& options)
     : options_(options),
@@ -21,8 +59,11 @@ Muxer::Muxer(const MuxerOptions& options)
       clear_lead_in_seconds_(0),
       crypto_period_duration_in_seconds_(0),
       protection_scheme_(FOURCC_NULL),
+      trick_play_rate_(0),
+      trick_play_key_frame_count_(0),
       cancelled_(false),
-      clock_(NULL) {}
+      clock_(NULL),
+      runtime_config_(NULL) {}
 
 Muxer::~Muxer() {}
 
@@ -58,25 +99,65 @@ Status Muxer::Run() {
       return status;
   }
 
-  uint32_t current_stream_id = 0;
-  while (status.ok()) {
+  // Keep one sample of lookahead per stream and always dispatch the sample
+  // with the lowest timestamp next. This keeps segmenter-side interleave
+  // buffering near-constant regardless of how the input tracks are ordered;
+  // pulling triggers new parses only on demand, so the lookahead also bounds
+  // how far ahead of the lagging stream the source is read.
+  std::vector<scoped_refptr<MediaSample> > next_samples(streams_.size());
+  std::vector<bool> stream_ended(streams_.size(), false);
+  size_t num_ended_streams = 0;
+  for (size_t i = 0; i < streams_.size(); ++i) {
+    Status pull_status = streams_[i]->PullSample(&next_samples[i]);
+    if (pull_status.error_code() == error::END_OF_STREAM) {
+      stream_ended[i] = true;
+      ++num_ended_streams;
+    } else if (!pull_status.ok()) {
+      return pull_status;
+    }
+  }
+
+  while (num_ended_streams < streams_.size()) {
     if (cancelled_)
       return Status(error::CANCELLED, "muxer run cancelled");
 
-    scoped_refptr<MediaSample> sample;
-    status = streams_[current_stream_id]->PullSample(&sample);
-    if (!status.ok())
-      break;
-    status = AddSample(streams_[current_stream_id], sample);
+    // Find the stream whose pending sample has the lowest timestamp. Streams
+    // may use different time scales, so compare in seconds.
+    size_t next_stream = streams_.size();
+    double lowest_dts_seconds = 0;
+    for (size_t i = 0; i < streams_.size(); ++i) {
+      if (stream_ended[i])
+        continue;
+      const double dts_seconds = static_cast<double>(next_samples[i]->dts()) /
+                                 streams_[i]->info()->time_scale();
+      if (next_stream == streams_.size() ||
+          dts_seconds < lowest_dts_seconds) {
+        next_stream = i;
+        lowest_dts_seconds = dts_seconds;
+      }
+    }
+    DCHECK_LT(next_stream, streams_.size());
 
-    // Switch to next stream if the current stream is ready for fragmentation.
-    if (status.error_code() == error::FRAGMENT_FINALIZED) {
-      current_stream_id = (current_stream_id + 1) % streams_.size();
+    status = AddSample(streams_[next_stream], next_samples[next_stream]);
+    // A finalized fragment is not an error; scheduling is purely by
+    // timestamp, so there is nothing to switch.
+    if (status.error_code() == error::FRAGMENT_FINALIZED)
       status.Clear();
+    if (!status.ok())
+      return status;
+
+    next_samples[next_stream] = NULL;
+    Status pull_status =
+        streams_[next_stream]->PullSample(&next_samples[next_stream]);
+    if (pull_status.error_code() == error::END_OF_STREAM) {
+      stream_ended[next_stream] = true;
+      ++num_ended_streams;
+    } else if (!pull_status.ok()) {
+      return pull_status;
     }
   }
-  // Finalize the muxer after reaching end of stream.
-  return status.error_code() == error::END_OF_STREAM ? Finalize() : status;
+  // Finalize the muxer after all streams reached end of stream.
+  return Finalize();
 }
 
 void Muxer::Cancel() {
@@ -89,12 +170,17 @@ void Muxer::SetMuxerListener(scoped_ptr<MuxerListener> muxer_listener) {
 
 void Muxer::SetProgressListener(
     scoped_ptr<ProgressListener> progress_listener) {
-  progress_listener_ = progress_listener.Pass();
+  // Throttle centrally so segmenters can report progress at whatever
+  // granularity is natural to them without per-update dispatch cost.
+  progress_listener_.reset(new ThrottledProgressListener(
+      progress_listener.Pass(), kMinProgressDelta));
 }
 
 Status Muxer::AddSample(const MediaStream* stream,
                         scoped_refptr<MediaSample> sample) {
   DCHECK(std::find(streams_.begin(), streams_.end(), stream) != streams_.end());
+  // Covers the full mux work for the sample, including nested encryption.
+  pipeline_stats::ScopedStageTimer stage_timer(pipeline_stats::kStageMux);
 
   if (!initialized_) {
     Status status = Initialize();
@@ -106,11 +192,52 @@ Status Muxer::AddSample(const MediaStream* stream,
     // EOS sample should be sent only when the sample was pushed from Demuxer
     // to Muxer. In this case, there should be only one stream in Muxer.
     DCHECK_EQ(1u, streams_.size());
+    if (trick_play_rate_ > 0) {
+      Status status = FlushTrickPlaySample(stream);
+      if (!status.ok())
+        return status;
+    }
     return Finalize();
   } else if (sample->is_encrypted()) {
     LOG(ERROR) << "Unable to multiplex encrypted media sample";
     return Status(error::INTERNAL_ERROR, "Encrypted media sample.");
   }
+  if (trick_play_rate_ > 0)
+    return AddTrickPlaySample(stream, sample);
+  return DoAddSample(stream, sample);
+}
+
+Status Muxer::AddTrickPlaySample(const MediaStream* stream,
+                                 const scoped_refptr<MediaSample>& sample) {
+  if (sample->is_key_frame() &&
+      trick_play_key_frame_count_++ % trick_play_rate_ == 0) {
+    Status status = FlushTrickPlaySample(stream);
+    if (!status.ok())
+      return status;
+    // The sample is copied because its duration is extended below to cover
+    // the dropped samples, while the original is shared with the other
+    // muxers connected to the stream. Only kept key frames are copied.
+    trick_play_sample_ =
+        MediaSample::CopyFrom(sample->data(), sample->data_size(), true);
+    trick_play_sample_->set_pts(sample->pts());
+    trick_play_sample_->set_dts(sample->dts());
+    trick_play_sample_->set_duration(sample->duration());
+    return Status::OK;
+  }
+  // Dropped sample: extend the pending key frame so the trick play timeline
+  // still covers the whole presentation.
+  if (trick_play_sample_) {
+    trick_play_sample_->set_duration(trick_play_sample_->duration() +
+                                     sample->duration());
+  }
+  return Status::OK;
+}
+
+Status Muxer::FlushTrickPlaySample(const MediaStream* stream) {
+  if (!trick_play_sample_)
+    return Status::OK;
+  scoped_refptr<MediaSample> sample = trick_play_sample_;
+  trick_play_sample_ = NULL;
   return DoAddSample(stream, sample);
 }
 
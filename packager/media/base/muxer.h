@@ -26,6 +26,7 @@ namespace media {
 class KeySource;
 class MediaSample;
 class MediaStream;
+class RuntimeConfig;
 
 /// Muxer is responsible for taking elementary stream samples and producing
 /// media containers. An optional KeySource can be provided to Muxer
@@ -73,6 +74,29 @@ class Muxer {
 
   const std::vector<MediaStream*>& streams() const { return streams_; }
 
+  /// Turn this muxer into a key-frame-only trick play muxer: every
+  /// @a trick_play_rate-th key frame is kept and its duration is extended to
+  /// cover the dropped samples, so the trick play timeline still spans the
+  /// whole presentation. Connect the muxer to the same video stream as the
+  /// main muxer (see MediaStream::Connect) to produce the trick play
+  /// representation in the same packaging pass, at near-zero marginal I/O
+  /// cost. Must be called before any samples arrive.
+  /// @param trick_play_rate is the key frame decimation factor; 1 keeps every
+  ///        key frame.
+  void set_trick_play_rate(int16_t trick_play_rate) {
+    DCHECK_GT(trick_play_rate, 0);
+    trick_play_rate_ = trick_play_rate;
+  }
+
+  /// Set the runtime config polled for parameters that may change while the
+  /// job runs, e.g. the key rotation interval; see RuntimeConfig. Changes are
+  /// applied at safe boundaries only. Must be called before Run().
+  /// @param runtime_config is the config to poll. The caller retains
+  ///        ownership, and it must outlive this muxer. May be NULL.
+  void set_runtime_config(RuntimeConfig* runtime_config) {
+    runtime_config_ = runtime_config;
+  }
+
   /// Inject clock, mainly used for testing.
   /// The injected clock will be used to generate the creation time-stamp and
   /// modification time-stamp of the muxer output.
@@ -97,6 +121,7 @@ class Muxer {
   ProgressListener* progress_listener() { return progress_listener_.get(); }
   base::Clock* clock() { return clock_; }
   FourCC protection_scheme() const { return protection_scheme_; }
+  RuntimeConfig* runtime_config() { return runtime_config_; }
 
  private:
   friend class MediaStream;  // Needed to access AddSample.
@@ -115,6 +140,13 @@ class Muxer {
   virtual Status DoAddSample(const MediaStream* stream,
                              scoped_refptr<MediaSample> sample) = 0;
 
+  // Trick play filtering; see set_trick_play_rate(). Kept key frames are
+  // buffered in |trick_play_sample_| so their duration can absorb the
+  // durations of the samples dropped after them.
+  Status AddTrickPlaySample(const MediaStream* stream,
+                            const scoped_refptr<MediaSample>& sample);
+  Status FlushTrickPlaySample(const MediaStream* stream);
+
   MuxerOptions options_;
   bool initialized_;
   std::vector<MediaStream*> streams_;
@@ -123,12 +155,19 @@ class Muxer {
   double clear_lead_in_seconds_;
   double crypto_period_duration_in_seconds_;
   FourCC protection_scheme_;
+  // Trick play state; see set_trick_play_rate(). Disabled when
+  // |trick_play_rate_| is zero.
+  int16_t trick_play_rate_;
+  uint32_t trick_play_key_frame_count_;
+  scoped_refptr<MediaSample> trick_play_sample_;
   bool cancelled_;
 
   scoped_ptr<MuxerListener> muxer_listener_;
   scoped_ptr<ProgressListener> progress_listener_;
   // An external injected clock, can be NULL.
   base::Clock* clock_;
+  // Not owned, can be NULL. See set_runtime_config().
+  RuntimeConfig* runtime_config_;
 
   DISALLOW_COPY_AND_ASSIGN(Muxer);
 };
@@ -17,6 +17,12 @@ MuxerOptions::MuxerOptions()
       fragment_sap_aligned(false),
       num_subsegments_per_sidx(0),
       mp4_use_decoding_timestamp_in_timeline(false),
+      mp4_reserve_index_space(false),
+      mp4_stream_fragments(false),
+      webm_reserve_cues_space(false),
+      num_encryption_threads(1),
+      segment_start_number(1),
+      temp_file_memory_limit(0),
       bandwidth(0) {}
 MuxerOptions::~MuxerOptions() {}
 
@@ -56,6 +56,38 @@ struct MuxerOptions {
   /// used in buffered range, https://crbug.com/398130.
   bool mp4_use_decoding_timestamp_in_timeline;
 
+  /// For ISO BMFF only.
+  /// If set, a single-segment output reserves space for the moov and sidx
+  /// boxes (plus free box padding) at the head of the output file, writes
+  /// media data directly after it and fills the index in at finalization, so
+  /// the output is produced in a single sequential pass without an
+  /// intermediate file. Requires the input duration to be known; falls back
+  /// to the intermediate file otherwise.
+  bool mp4_reserve_index_space;
+
+  /// For ISO BMFF live profile (segment template) output only.
+  /// If set, each finalized fragment is written to the current segment file
+  /// as soon as it is available instead of being buffered until the segment
+  /// completes. 'styp' is emitted once at the head of the segment and no
+  /// 'sidx' is written, since the index cannot precede data that has already
+  /// been flushed. Cuts end-to-end latency from segment duration to fragment
+  /// duration for low-latency streaming.
+  bool mp4_stream_fragments;
+
+  /// For WebM single-segment output only.
+  /// If set, space for the Cues element (padded with a Void element) is
+  /// reserved in front of the media data and filled in at finalization, so
+  /// the index ends up at the head of the file instead of its end. The
+  /// reservation is sized from the input duration and segment duration;
+  /// the Cues are written at the end of the file as before if the size
+  /// cannot be estimated or the reservation turns out too small. Ignored
+  /// for non-seekable output.
+  bool webm_reserve_cues_space;
+
+  /// Number of worker threads used to encrypt media samples. Values less
+  /// than two keep sample encryption inline on the muxer thread.
+  uint32_t num_encryption_threads;
+
   /// Output file name. If segment_template is not specified, the Muxer
   /// generates this single output file with all segments concatenated;
   /// Otherwise, it specifies the init segment name.
@@ -67,9 +99,21 @@ struct MuxerOptions {
   /// Optional.
   std::string segment_template;
 
+  /// First value substituted for $Number$ in segment_template, also exposed
+  /// as SegmentTemplate@startNumber in the MPD. Defaults to 1. Set to the
+  /// next segment number of the stream when taking over a live channel from
+  /// another packager instance, so segment naming and the manifest timeline
+  /// continue where the previous instance left off.
+  uint32_t segment_start_number;
+
   /// Specify temporary directory for intermediate files.
   std::string temp_dir;
 
+  /// If nonzero, keep single-segment intermediate data in memory up to this
+  /// many bytes, spilling to a disk temporary file beyond the limit. Avoids
+  /// writing and re-reading every media byte for assets that fit in RAM.
+  uint64_t temp_file_memory_limit;
+
   /// User-specified bit rate for the media stream. If zero, the muxer will
   /// attempt to estimate.
   uint32_t bandwidth;
@@ -103,24 +103,42 @@ std::string GetSegmentName(const std::string& segment_template,
                            uint64_t segment_start_time,
                            uint32_t segment_index,
                            uint32_t bandwidth) {
+  SegmentNameTemplate name_template;
+  name_template.Compile(segment_template);
+  return name_template.GetSegmentName(segment_start_time, segment_index,
+                                      bandwidth);
+}
+
+SegmentNameTemplate::SegmentNameTemplate() : initialized_(false) {}
+
+SegmentNameTemplate::~SegmentNameTemplate() {}
+
+void SegmentNameTemplate::Compile(const std::string& segment_template) {
   DCHECK(ValidateSegmentTemplate(segment_template));
+  pieces_.clear();
 
   std::vector<std::string> splits;
   base::SplitString(segment_template, '$', &splits);
   // "$" always appears in pairs, so there should be odd number of splits.
   DCHECK_EQ(1u, splits.size() % 2);
 
-  std::string segment_name;
   for (size_t i = 0; i < splits.size(); ++i) {
     // Every second substring in split output should be an identifier.
-    // Simply copy the non-identifier part.
-    if (i % 2 == 0) {
-      segment_name += splits[i];
-      continue;
-    }
-    if (splits[i].empty()) {
-      // "$$" is an escape sequence, replaced with a single "$".
-      segment_name += "$";
+    if (i % 2 == 0 || splits[i].empty()) {
+      // Non-identifier part, or the "$$" escape sequence which is replaced
+      // with a single "$". Adjacent literals are merged so rendering walks
+      // as few pieces as possible.
+      const std::string literal = (i % 2 == 0) ? splits[i] : "$";
+      if (literal.empty())
+        continue;
+      if (!pieces_.empty() && pieces_.back().type == kLiteral) {
+        pieces_.back().text += literal;
+      } else {
+        Piece piece;
+        piece.type = kLiteral;
+        piece.text = literal;
+        pieces_.push_back(piece);
+      }
       continue;
     }
     size_t format_pos = splits[i].find('%');
@@ -128,30 +146,56 @@ std::string GetSegmentName(const std::string& segment_template,
     DCHECK(identifier == "Number" || identifier == "Time" ||
            identifier == "Bandwidth");
 
-    std::string format_tag;
+    Piece piece;
     if (format_pos != std::string::npos) {
-      format_tag = splits[i].substr(format_pos);
-      DCHECK(ValidateFormatTag(format_tag));
+      piece.text = splits[i].substr(format_pos);
+      DCHECK(ValidateFormatTag(piece.text));
       // Replace %d formatting to correctly format uint64_t.
-      format_tag = format_tag.substr(0, format_tag.size() - 1) + PRIu64;
+      piece.text = piece.text.substr(0, piece.text.size() - 1) + PRIu64;
     } else {
       // Default format tag "%01d", modified to format uint64_t correctly.
-      format_tag = "%01" PRIu64;
+      piece.text = "%01" PRIu64;
     }
-
     if (identifier == "Number") {
-      // SegmentNumber starts from 1.
-      segment_name += base::StringPrintf(
-          format_tag.c_str(), static_cast<uint64_t>(segment_index + 1));
+      piece.type = kNumber;
     } else if (identifier == "Time") {
-      segment_name +=
-          base::StringPrintf(format_tag.c_str(), segment_start_time);
-    } else if (identifier == "Bandwidth") {
-      segment_name += base::StringPrintf(format_tag.c_str(),
-                                         static_cast<uint64_t>(bandwidth));
+      piece.type = kTime;
+    } else {
+      piece.type = kBandwidth;
+    }
+    pieces_.push_back(piece);
+  }
+  initialized_ = true;
+}
+
+const std::string& SegmentNameTemplate::GetSegmentName(
+    uint64_t segment_start_time,
+    uint32_t segment_index,
+    uint32_t bandwidth) {
+  DCHECK(initialized_);
+  buffer_.clear();
+  for (std::vector<Piece>::const_iterator piece = pieces_.begin();
+       piece != pieces_.end(); ++piece) {
+    switch (piece->type) {
+      case kLiteral:
+        buffer_.append(piece->text);
+        break;
+      case kNumber:
+        // SegmentNumber starts from 1.
+        base::StringAppendF(&buffer_, piece->text.c_str(),
+                            static_cast<uint64_t>(segment_index + 1));
+        break;
+      case kTime:
+        base::StringAppendF(&buffer_, piece->text.c_str(),
+                            segment_start_time);
+        break;
+      case kBandwidth:
+        base::StringAppendF(&buffer_, piece->text.c_str(),
+                            static_cast<uint64_t>(bandwidth));
+        break;
     }
   }
-  return segment_name;
+  return buffer_;
 }
 
 KeySource::TrackType GetTrackTypeForEncryption(const StreamInfo& stream_info,
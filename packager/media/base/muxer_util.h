@@ -12,6 +12,7 @@
 #include <stdint.h>
 
 #include <string>
+#include <vector>
 
 #include "packager/media/base/key_source.h"
 
@@ -39,6 +40,47 @@ std::string GetSegmentName(const std::string& segment_template,
                            uint32_t segment_index,
                            uint32_t bandwidth);
 
+/// Pre-compiled form of a segment name template. The free GetSegmentName()
+/// re-tokenizes the template string for every segment; for live jobs with
+/// short segments this is avoidable string churn. Compile() tokenizes the
+/// template once into a render plan and GetSegmentName() then renders into a
+/// reused internal buffer.
+class SegmentNameTemplate {
+ public:
+  SegmentNameTemplate();
+  ~SegmentNameTemplate();
+
+  /// Compiles @a segment_template, which must comply with ISO/IEC
+  /// 23009-1:2012 5.3.9.4.4 (see ValidateSegmentTemplate()).
+  void Compile(const std::string& segment_template);
+
+  /// @return true if Compile() has been called.
+  bool initialized() const { return initialized_; }
+
+  /// Renders the segment name for one segment. The returned reference stays
+  /// valid until the next call on this instance.
+  /// @param segment_start_time specifies the segment start time.
+  /// @param segment_index specifies the segment index.
+  /// @param bandwidth represents the bit rate, in bits/sec, of the stream.
+  /// @return The segment name with identifiers substituted.
+  const std::string& GetSegmentName(uint64_t segment_start_time,
+                                    uint32_t segment_index,
+                                    uint32_t bandwidth);
+
+ private:
+  enum PieceType { kLiteral, kNumber, kTime, kBandwidth };
+  // One chunk of the render plan: either a literal to copy or an identifier
+  // with |text| holding its printf format tag.
+  struct Piece {
+    PieceType type;
+    std::string text;
+  };
+
+  std::vector<Piece> pieces_;
+  std::string buffer_;
+  bool initialized_;
+};
+
 /// Determine the track type for encryption from input.
 /// @param stream_info is the info of the stream.
 /// @param max_sd_pixels is the maximum number of pixels to be considered SD.
@@ -142,6 +142,23 @@ TEST(MuxerUtilTest, GetSegmentNameWithIndexZero) {
                            kBandwidth));
 }
 
+TEST(MuxerUtilTest, SegmentNameTemplate) {
+  SegmentNameTemplate name_template;
+  EXPECT_FALSE(name_template.initialized());
+  name_template.Compile("foo$$_$Number%05d$-$Bandwidth$.m4s");
+  EXPECT_TRUE(name_template.initialized());
+
+  // The compiled template renders the same names as GetSegmentName(), and
+  // can be reused for consecutive segments.
+  EXPECT_EQ("foo$_00001-1234.m4s", name_template.GetSegmentName(0, 0, 1234));
+  EXPECT_EQ("foo$_00012-1234.m4s",
+            name_template.GetSegmentName(180180, 11, 1234));
+
+  name_template.Compile("$Time$");
+  EXPECT_EQ("1601599839840",
+            name_template.GetSegmentName(1601599839840ULL, 8888888, 444444));
+}
+
 TEST(MuxerUtilTest, GetSegmentNameLargeTime) {
   const uint64_t kSegmentStartTime = 1601599839840ULL;
   const uint32_t kSegmentIndex = 8888888;
@@ -23,11 +23,14 @@ void OffsetByteQueue::Reset() {
 
 void OffsetByteQueue::Push(const uint8_t* buf, int size) {
   queue_.Push(buf, size);
-  Sync();
+  size_ += size;
+  buf_ = NULL;
   DVLOG(4) << "Buffer pushed. head=" << head() << " tail=" << tail();
 }
 
 void OffsetByteQueue::Peek(const uint8_t** buf, int* size) {
+  if (!buf_ && size_ > 0)
+    Sync();
   *buf = size_ > 0 ? buf_ : NULL;
   *size = size_;
 }
@@ -35,7 +38,8 @@ void OffsetByteQueue::Peek(const uint8_t** buf, int* size) {
 void OffsetByteQueue::Pop(int count) {
   queue_.Pop(count);
   head_ += count;
-  Sync();
+  size_ -= count;
+  buf_ = NULL;
 }
 
 void OffsetByteQueue::PeekAt(int64_t offset, const uint8_t** buf, int* size) {
@@ -44,6 +48,8 @@ void OffsetByteQueue::PeekAt(int64_t offset, const uint8_t** buf, int* size) {
     *size = 0;
     return;
   }
+  if (!buf_)
+    Sync();
   *buf = &buf_[offset - head()];
   *size = tail() - offset;
 }
@@ -58,8 +64,16 @@ bool OffsetByteQueue::Trim(int64_t max_offset) {
   return true;
 }
 
+void OffsetByteQueue::AdvanceHeadTo(int64_t offset) {
+  DCHECK_EQ(0, size_);
+  DCHECK_GE(offset, head_);
+  head_ = offset;
+}
+
 void OffsetByteQueue::Sync() {
-  queue_.Peek(&buf_, &size_);
+  int size;
+  queue_.Peek(&buf_, &size);
+  DCHECK_EQ(size_, size);
 }
 
 }  // namespace media
@@ -48,6 +48,12 @@ class OffsetByteQueue {
   ///         buffered are still cleared).
   bool Trim(int64_t max_offset);
 
+  /// Advance the head to @a offset without the bytes in between ever being
+  /// pushed. The queue must be empty (fully trimmed) and @a offset must not
+  /// be behind the current head; subsequent pushes continue from @a offset.
+  /// Used to skip over input regions that are known not to be needed.
+  void AdvanceHeadTo(int64_t offset);
+
   /// @return The head position, in terms of the file's absolute offset.
   int64_t head() { return head_; }
   /// @return The tail position (exclusive), in terms of the file's absolute
@@ -55,10 +61,15 @@ class OffsetByteQueue {
   int64_t tail() { return head_ + size_; }
 
  private:
-  // Synchronize |buf_| and |size_| with |queue_|.
+  // Refresh |buf_| with a contiguous view of the queued bytes. Only called
+  // when a caller actually dereferences the queue contents; Push() and Pop()
+  // just update the bookkeeping, so the underlying ring buffer is not
+  // unwrapped on every call.
   void Sync();
 
   ByteQueue queue_;
+  // Contiguous view of the queued bytes. NULL when stale; refreshed lazily
+  // by Sync().
   const uint8_t* buf_;
   int size_;
   int64_t head_;
@@ -0,0 +1,148 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/pipeline_stats.h"
+
+#include <inttypes.h>
+
+#include "packager/base/atomicops.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+
+namespace shaka {
+namespace media {
+namespace pipeline_stats {
+namespace {
+
+const char* kStageNames[kNumStages] = {
+    "file_read", "parse", "encrypt", "mux", "file_write",
+};
+
+const char* kMemoryComponentNames[kNumMemoryComponents] = {
+    "buffer_pool", "buffer_writer", "byte_queue", "io_cache",
+};
+
+base::subtle::Atomic32 g_enabled = 0;
+// Indexed by Stage. AtomicWord is pointer sized, which is 64 bits on every
+// platform we care about for performance analysis.
+base::subtle::AtomicWord g_bytes[kNumStages] = {0};
+base::subtle::AtomicWord g_time_us[kNumStages] = {0};
+// Indexed by MemoryComponent.
+base::subtle::AtomicWord g_memory_live[kNumMemoryComponents] = {0};
+base::subtle::AtomicWord g_memory_peak[kNumMemoryComponents] = {0};
+base::subtle::AtomicWord g_budget_exceeded = 0;
+
+}  // namespace
+
+void Enable() {
+  base::subtle::Release_Store(&g_enabled, 1);
+}
+
+bool enabled() {
+  return base::subtle::Acquire_Load(&g_enabled) != 0;
+}
+
+void RecordBytes(Stage stage, int64_t bytes) {
+  if (!enabled() || bytes <= 0)
+    return;
+  base::subtle::NoBarrier_AtomicIncrement(&g_bytes[stage], bytes);
+}
+
+void RecordTime(Stage stage, const base::TimeDelta& elapsed) {
+  if (!enabled())
+    return;
+  base::subtle::NoBarrier_AtomicIncrement(&g_time_us[stage],
+                                          elapsed.InMicroseconds());
+}
+
+void RecordMemoryAllocated(MemoryComponent component, int64_t bytes) {
+  if (!enabled() || bytes <= 0)
+    return;
+  const base::subtle::AtomicWord live = base::subtle::NoBarrier_AtomicIncrement(
+      &g_memory_live[component], bytes);
+  // Lift the high water mark to |live|. A racing update can only replace the
+  // mark with a larger value, so the mark never moves down.
+  base::subtle::AtomicWord peak =
+      base::subtle::NoBarrier_Load(&g_memory_peak[component]);
+  while (live > peak) {
+    const base::subtle::AtomicWord prev = base::subtle::NoBarrier_CompareAndSwap(
+        &g_memory_peak[component], peak, live);
+    if (prev == peak)
+      break;
+    peak = prev;
+  }
+}
+
+void RecordMemoryFreed(MemoryComponent component, int64_t bytes) {
+  if (!enabled() || bytes <= 0)
+    return;
+  base::subtle::NoBarrier_AtomicIncrement(&g_memory_live[component], -bytes);
+}
+
+void RecordBudgetExceeded() {
+  if (!enabled())
+    return;
+  base::subtle::NoBarrier_AtomicIncrement(&g_budget_exceeded, 1);
+}
+
+int64_t GetBudgetExceededCount() {
+  return base::subtle::NoBarrier_Load(&g_budget_exceeded);
+}
+
+const char* StageName(Stage stage) {
+  return kStageNames[stage];
+}
+
+int64_t GetBytes(Stage stage) {
+  return base::subtle::NoBarrier_Load(&g_bytes[stage]);
+}
+
+int64_t GetTimeUs(Stage stage) {
+  return base::subtle::NoBarrier_Load(&g_time_us[stage]);
+}
+
+std::string ToJson() {
+  std::string json("{");
+  for (int i = 0; i < kNumStages; ++i) {
+    base::StringAppendF(
+        &json, "%s\"%s\": {\"bytes\": %" PRId64 ", \"time_us\": %" PRId64 "}",
+        i == 0 ? "" : ", ", kStageNames[i],
+        static_cast<int64_t>(base::subtle::NoBarrier_Load(&g_bytes[i])),
+        static_cast<int64_t>(base::subtle::NoBarrier_Load(&g_time_us[i])));
+  }
+  json += ", \"memory\": {";
+  for (int i = 0; i < kNumMemoryComponents; ++i) {
+    base::StringAppendF(
+        &json,
+        "%s\"%s\": {\"live_bytes\": %" PRId64 ", \"peak_bytes\": %" PRId64 "}",
+        i == 0 ? "" : ", ", kMemoryComponentNames[i],
+        static_cast<int64_t>(base::subtle::NoBarrier_Load(&g_memory_live[i])),
+        static_cast<int64_t>(base::subtle::NoBarrier_Load(&g_memory_peak[i])));
+  }
+  json += "}";
+  base::StringAppendF(
+      &json, ", \"memory_budget_exceeded\": %" PRId64 "}",
+      static_cast<int64_t>(base::subtle::NoBarrier_Load(&g_budget_exceeded)));
+  return json;
+}
+
+void DumpToLog() {
+  if (!enabled())
+    return;
+  LOG(INFO) << "Pipeline stats: " << ToJson();
+}
+
+ScopedStageTimer::ScopedStageTimer(Stage stage)
+    : stage_(stage), enabled_(enabled()) {}
+
+ScopedStageTimer::~ScopedStageTimer() {
+  if (enabled_)
+    RecordTime(stage_, timer_.Elapsed());
+}
+
+}  // namespace pipeline_stats
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,124 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_BASE_PIPELINE_STATS_H_
+#define MEDIA_BASE_PIPELINE_STATS_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "packager/base/macros.h"
+#include "packager/base/timer/elapsed_timer.h"
+
+namespace shaka {
+namespace media {
+
+/// Process-wide, lock-free per-stage counters for the packaging pipeline.
+/// When a live channel falls behind real time, these tell whether the
+/// bottleneck is input reads, parsing, encryption, muxing or output I/O.
+/// Collection is disabled by default; when disabled every recording call is
+/// a single atomic load. Counters are accumulated from the hot paths
+/// (Demuxer::Parse, EncryptingFragmenter::EncryptSample, ThreadedIoFile) and
+/// can be dumped as JSON on process exit or on SIGUSR1.
+///
+/// Stages may nest (e.g. mux work happens inside the parse scope when the
+/// pipeline is unthreaded); each counter reports the full wall time spent in
+/// its own scope, so nested stage times are not disjoint.
+///
+/// In addition to the per-stage counters, per-component memory gauges track
+/// the bytes held live by the major buffer owners (sample payloads, buffer
+/// writers, parser byte queues, I/O caches) along with their high water
+/// marks, so RSS growth can be attributed to a component instead of guessed
+/// at.
+namespace pipeline_stats {
+
+enum Stage {
+  kStageFileRead = 0,
+  kStageParse,
+  kStageEncrypt,
+  kStageMux,
+  kStageFileWrite,
+  kNumStages
+};
+
+enum MemoryComponent {
+  kMemoryBufferPool = 0,  // MediaSample payloads, pooled and in flight.
+  kMemoryBufferWriter,
+  kMemoryByteQueue,
+  kMemoryIoCache,
+  kNumMemoryComponents
+};
+
+/// Turn on collection. Not thread safe; call during startup before the
+/// pipeline threads exist.
+void Enable();
+
+/// @return true if collection is enabled.
+bool enabled();
+
+/// Add @a bytes processed by @a stage.
+void RecordBytes(Stage stage, int64_t bytes);
+
+/// Add @a elapsed wall time spent in @a stage.
+void RecordTime(Stage stage, const base::TimeDelta& elapsed);
+
+/// Add @a bytes to the live byte count of @a component and lift its high
+/// water mark if exceeded. Call when backing storage is allocated or grown,
+/// not on every use of it.
+void RecordMemoryAllocated(MemoryComponent component, int64_t bytes);
+
+/// Subtract @a bytes from the live byte count of @a component. Call when the
+/// backing storage counted by RecordMemoryAllocated() is actually freed.
+void RecordMemoryFreed(MemoryComponent component, int64_t bytes);
+
+/// Count one memory budget crossing: a job's buffered bytes went over its
+/// budget and its input reads are being paused. See MemoryBudget.
+void RecordBudgetExceeded();
+
+/// @return The number of recorded memory budget crossings.
+int64_t GetBudgetExceededCount();
+
+/// @return The name of @a stage as it appears in the JSON dump. Intended for
+///         tools that post-process the counters, e.g. the throughput
+///         benchmark.
+const char* StageName(Stage stage);
+
+/// @return Accumulated byte count for @a stage.
+int64_t GetBytes(Stage stage);
+
+/// @return Accumulated wall time for @a stage in microseconds.
+int64_t GetTimeUs(Stage stage);
+
+/// @return Accumulated counters encoded as a JSON object, e.g.
+///         {"parse": {"bytes": 123, "time_us": 456}, ...,
+///          "memory": {"byte_queue": {"live_bytes": 1024,
+///                                    "peak_bytes": 4096}, ...}}.
+std::string ToJson();
+
+/// Log the JSON dump. Safe to call even when collection is disabled.
+void DumpToLog();
+
+/// Measures the wall time of a scope and attributes it to a stage. No-op
+/// when collection is disabled.
+class ScopedStageTimer {
+ public:
+  explicit ScopedStageTimer(Stage stage);
+  ~ScopedStageTimer();
+
+ private:
+  const Stage stage_;
+  const bool enabled_;
+  base::ElapsedTimer timer_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedStageTimer);
+};
+
+}  // namespace pipeline_stats
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_BASE_PIPELINE_STATS_H_
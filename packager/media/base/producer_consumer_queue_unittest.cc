@@ -241,6 +241,18 @@ TEST_F(MultiThreadProducerConsumerQueueTest, Pop) {
   ASSERT_EQ(error::STOPPED, queue_.Pop(&val, kInfiniteTimeout).error_code());
 }
 
+TEST_F(MultiThreadProducerConsumerQueueTest, PopWithSpinCount) {
+  queue_.set_spin_count(100);
+
+  // Perform a number of pops, some of which block on the producer thread.
+  size_t val;
+  for (size_t i = 0; i < kCapacity * 3; ++i) {
+    ASSERT_OK(queue_.Pop(&val, kInfiniteTimeout));
+    EXPECT_EQ(i, val);
+  }
+  queue_.Stop();
+}
+
 TEST_F(MultiThreadProducerConsumerQueueTest, Peek) {
   const size_t kPositionOne = 25u;
   const size_t kPositionTwo = 88u;
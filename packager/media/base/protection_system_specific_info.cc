@@ -6,6 +6,11 @@
 
 #include "packager/media/base/protection_system_specific_info.h"
 
+#include <map>
+#include <string>
+
+#include "packager/base/lazy_instance.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/rcheck.h"
@@ -16,8 +21,55 @@ namespace media {
 namespace {
 const size_t kSystemIdSize = 16u;
 const size_t kKeyIdSize = 16u;
+
+// Process-wide cache of serialized pssh boxes, keyed by box content. Key
+// rotation hands the same key system info to the muxer, MPD and HLS
+// consumers independently, and per segment on top of that; the cache makes
+// that one serialization total with every consumer referencing the same
+// bytes.
+class PsshBlobCache {
+ public:
+  PsshBlobCache() {}
+
+  scoped_refptr<const PsshBoxBlob> GetOrCreate(
+      const std::string& cache_key,
+      const ProtectionSystemSpecificInfo& info) {
+    base::AutoLock auto_lock(lock_);
+    std::map<std::string, scoped_refptr<const PsshBoxBlob> >::const_iterator
+        it = blobs_.find(cache_key);
+    if (it != blobs_.end())
+      return it->second;
+
+    // On long-running jobs every crypto period leaves a stale entry behind;
+    // reset the cache instead of growing without bound. Blobs already handed
+    // out stay alive through their references.
+    const size_t kMaxCachedBlobs = 128;
+    if (blobs_.size() >= kMaxCachedBlobs)
+      blobs_.clear();
+
+    std::vector<uint8_t> box = info.CreateBox();
+    scoped_refptr<const PsshBoxBlob> blob(new PsshBoxBlob(&box));
+    blobs_[cache_key] = blob;
+    return blob;
+  }
+
+ private:
+  base::Lock lock_;
+  std::map<std::string, scoped_refptr<const PsshBoxBlob> > blobs_;
+
+  DISALLOW_COPY_AND_ASSIGN(PsshBlobCache);
+};
+
+// Leaky: blobs may still be referenced by consumers at shutdown.
+base::LazyInstance<PsshBlobCache>::Leaky g_pssh_blob_cache =
+    LAZY_INSTANCE_INITIALIZER;
 }  // namespace
 
+PsshBoxBlob::PsshBoxBlob(std::vector<uint8_t>* data) {
+  data_.swap(*data);
+}
+PsshBoxBlob::~PsshBoxBlob() {}
+
 ProtectionSystemSpecificInfo::ProtectionSystemSpecificInfo()
     : version_(0) {}
 ProtectionSystemSpecificInfo::~ProtectionSystemSpecificInfo() {}
@@ -112,7 +164,32 @@ std::vector<uint8_t> ProtectionSystemSpecificInfo::CreateBox() const {
   writer.AppendVector(pssh_data_);
 
   DCHECK_EQ(total_size, writer.Size());
-  return std::vector<uint8_t>(writer.Buffer(), writer.Buffer() + writer.Size());
+  // Steal the writer's buffer rather than copying it; key rotation recreates
+  // this box every crypto period.
+  std::vector<uint8_t> box;
+  writer.SwapBuffer(&box);
+  return box;
+}
+
+scoped_refptr<const PsshBoxBlob> ProtectionSystemSpecificInfo::CreateBoxShared()
+    const {
+  // The cache key is the box-defining content. Building it is a single
+  // append pass, cheaper than the serialization and per-consumer copies a
+  // hit saves. The key id count keeps the key unambiguous: without it the
+  // pssh data of one box could mimic the key ids of another.
+  std::string cache_key;
+  cache_key.reserve(1 + system_id_.size() + sizeof(uint32_t) +
+                    kKeyIdSize * key_ids_.size() + pssh_data_.size());
+  cache_key.push_back(static_cast<char>(version_));
+  cache_key.append(system_id_.begin(), system_id_.end());
+  const uint32_t key_id_count = key_ids_.size();
+  cache_key.append(reinterpret_cast<const char*>(&key_id_count),
+                   sizeof(key_id_count));
+  for (size_t i = 0; i < key_ids_.size(); i++)
+    cache_key.append(key_ids_[i].begin(), key_ids_[i].end());
+  cache_key.append(pssh_data_.begin(), pssh_data_.end());
+
+  return g_pssh_blob_cache.Get().GetOrCreate(cache_key, *this);
 }
 
 }  // namespace media
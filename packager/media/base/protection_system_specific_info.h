@@ -11,11 +11,37 @@
 #include <vector>
 
 #include "packager/base/logging.h"
+#include "packager/base/memory/ref_counted.h"
 #include "packager/media/base/buffer_reader.h"
 
 namespace shaka {
 namespace media {
 
+class ProtectionSystemSpecificInfo;
+
+/// An immutable serialized 'pssh' box. Blobs are handed out by
+/// ProtectionSystemSpecificInfo::CreateBoxShared() and shared through a
+/// process-wide cache; refcounting is thread safe, so the muxer, MPD and HLS
+/// consumers can hold the same blob from their own threads.
+class PsshBoxBlob : public base::RefCountedThreadSafe<PsshBoxBlob> {
+ public:
+  const uint8_t* data() const { return data_.empty() ? NULL : &data_[0]; }
+  size_t size() const { return data_.size(); }
+  const std::vector<uint8_t>& bytes() const { return data_; }
+
+ private:
+  friend class base::RefCountedThreadSafe<PsshBoxBlob>;
+  friend class ProtectionSystemSpecificInfo;
+
+  // Takes over the contents of |data|.
+  explicit PsshBoxBlob(std::vector<uint8_t>* data);
+  ~PsshBoxBlob();
+
+  std::vector<uint8_t> data_;
+
+  DISALLOW_COPY_AND_ASSIGN(PsshBoxBlob);
+};
+
 class ProtectionSystemSpecificInfo {
  public:
   ProtectionSystemSpecificInfo();
@@ -36,6 +62,13 @@ class ProtectionSystemSpecificInfo {
   /// Creates a PSSH box for the current data.
   std::vector<uint8_t> CreateBox() const;
 
+  /// Returns the PSSH box for the current data as a shared immutable blob.
+  /// Blobs are cached process wide, keyed by the box content (system id, key
+  /// ids and pssh data), so when key rotation hands the same info to several
+  /// consumers - and again for every segment of a crypto period - the box is
+  /// serialized once and everyone references the same bytes.
+  scoped_refptr<const PsshBoxBlob> CreateBoxShared() const;
+
   uint8_t pssh_box_version() const { return version_; }
   const std::vector<uint8_t>& system_id() const { return system_id_; }
   const std::vector<std::vector<uint8_t>>& key_ids() const { return key_ids_; }
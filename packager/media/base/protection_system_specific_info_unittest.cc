@@ -136,5 +136,33 @@ TEST_F(PsshTest, CreateBox_MakesV1Boxes) {
   EXPECT_EQ(v1_box_, info.CreateBox());
 }
 
+TEST_F(PsshTest, CreateBoxShared_SharesEqualBoxes) {
+  ProtectionSystemSpecificInfo info;
+  info.add_key_id(test_key_id_);
+  info.set_system_id(kTestSystemIdArray, arraysize(kTestSystemIdArray));
+  info.set_pssh_data(test_pssh_data_);
+  info.set_pssh_box_version(1);
+
+  scoped_refptr<const PsshBoxBlob> blob = info.CreateBoxShared();
+  EXPECT_EQ(v1_box_, blob->bytes());
+
+  // An info with the same content serializes to the very same blob.
+  ProtectionSystemSpecificInfo same_info;
+  same_info.add_key_id(test_key_id_);
+  same_info.set_system_id(kTestSystemIdArray, arraysize(kTestSystemIdArray));
+  same_info.set_pssh_data(test_pssh_data_);
+  same_info.set_pssh_box_version(1);
+  EXPECT_EQ(blob.get(), same_info.CreateBoxShared().get());
+
+  // Different content yields a different blob.
+  ProtectionSystemSpecificInfo other_info;
+  other_info.set_system_id(kTestSystemIdArray, arraysize(kTestSystemIdArray));
+  other_info.set_pssh_data(test_pssh_data_);
+  other_info.set_pssh_box_version(0);
+  scoped_refptr<const PsshBoxBlob> other_blob = other_info.CreateBoxShared();
+  EXPECT_NE(blob.get(), other_blob.get());
+  EXPECT_EQ(v0_box_, other_blob->bytes());
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -0,0 +1,101 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/runtime_config.h"
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/media/file/file.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// Minimum interval between looks at the config file. Reconfiguration is an
+// operator action; sub-second latency is not needed.
+const int64_t kMinCheckIntervalMs = 1000;
+
+}  // namespace
+
+RuntimeConfig::RuntimeConfig(const std::string& config_file_path)
+    : config_file_path_(config_file_path),
+      min_check_interval_ms_(kMinCheckIntervalMs) {}
+
+RuntimeConfig::~RuntimeConfig() {}
+
+void RuntimeConfig::MaybeReload() {
+  base::AutoLock auto_lock(lock_);
+
+  const base::TimeTicks now = base::TimeTicks::Now();
+  if (!last_check_time_.is_null() &&
+      (now - last_check_time_).InMilliseconds() < min_check_interval_ms_) {
+    return;
+  }
+  last_check_time_ = now;
+
+  std::string contents;
+  if (!File::ReadFileToString(config_file_path_.c_str(), &contents)) {
+    // A missing (or vanished) config file is normal; it means no overrides.
+    if (!loaded_contents_.empty()) {
+      LOG(INFO) << "Runtime config " << config_file_path_
+                << " removed; overrides cleared.";
+      loaded_contents_.clear();
+      values_.clear();
+    }
+    return;
+  }
+  if (contents == loaded_contents_)
+    return;
+
+  values_.clear();
+  std::vector<std::string> lines;
+  base::SplitString(contents, '\n', &lines);
+  for (size_t i = 0; i < lines.size(); ++i) {
+    std::string line;
+    base::TrimWhitespaceASCII(lines[i], base::TRIM_ALL, &line);
+    if (line.empty() || line[0] == '#')
+      continue;
+    const size_t separator_pos = line.find('=');
+    if (separator_pos == std::string::npos) {
+      LOG(WARNING) << "Ignoring malformed runtime config line: " << line;
+      continue;
+    }
+    std::string key;
+    std::string value;
+    base::TrimWhitespaceASCII(line.substr(0, separator_pos), base::TRIM_ALL,
+                              &key);
+    base::TrimWhitespaceASCII(line.substr(separator_pos + 1), base::TRIM_ALL,
+                              &value);
+    if (key.empty()) {
+      LOG(WARNING) << "Ignoring malformed runtime config line: " << line;
+      continue;
+    }
+    values_[key] = value;
+    LOG(INFO) << "Runtime config: " << key << " = " << value;
+  }
+  loaded_contents_ = contents;
+}
+
+bool RuntimeConfig::GetDouble(const std::string& key, double* value) const {
+  DCHECK(value);
+  base::AutoLock auto_lock(lock_);
+  std::map<std::string, std::string>::const_iterator it = values_.find(key);
+  if (it == values_.end())
+    return false;
+  double parsed_value = 0;
+  if (!base::StringToDouble(it->second, &parsed_value)) {
+    LOG(WARNING) << "Runtime config parameter '" << key
+                 << "' is not a number: " << it->second;
+    return false;
+  }
+  *value = parsed_value;
+  return true;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,68 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_BASE_RUNTIME_CONFIG_H_
+#define MEDIA_BASE_RUNTIME_CONFIG_H_
+
+#include <map>
+#include <string>
+
+#include "packager/base/macros.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+namespace media {
+
+/// Thread-safe holder for packaging parameters that may be changed while a
+/// job is running. The parameters are read from a small "key = value" text
+/// file ('#' starts a comment line) which operators rewrite to reconfigure a
+/// live channel without restarting it; see --reconfig_file. Consumers call
+/// MaybeReload() at a point where applying a change is safe, e.g. a segment
+/// or crypto period boundary, then read the values they care about. Only
+/// parameters that do not change the media structure can be reconfigured this
+/// way; adding or removing streams still requires a restart.
+class RuntimeConfig {
+ public:
+  /// @param config_file_path is the file the parameters are read from. The
+  ///        file does not need to exist; it can appear, change and disappear
+  ///        while the job runs. A missing file simply sets no parameters.
+  explicit RuntimeConfig(const std::string& config_file_path);
+  ~RuntimeConfig();
+
+  /// Re-reads the config file if its contents changed. The file is checked at
+  /// most once per second, so this is cheap enough to call per segment. Safe
+  /// to call from any thread.
+  void MaybeReload();
+
+  /// Look up parameter @a key as a double.
+  /// @param[out] value receives the parameter value. Not touched if the
+  ///             parameter is not set or does not parse as a double.
+  /// @return true if the parameter is set and parses as a double.
+  bool GetDouble(const std::string& key, double* value) const;
+
+  /// Overrides the once-per-second check throttle. For testing.
+  void set_min_check_interval_ms_for_testing(int64_t interval_ms) {
+    min_check_interval_ms_ = interval_ms;
+  }
+
+ private:
+  const std::string config_file_path_;
+  int64_t min_check_interval_ms_;
+
+  mutable base::Lock lock_;
+  // Raw file contents of the last successful load, to detect changes.
+  std::string loaded_contents_;
+  std::map<std::string, std::string> values_;
+  base::TimeTicks last_check_time_;
+
+  DISALLOW_COPY_AND_ASSIGN(RuntimeConfig);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_BASE_RUNTIME_CONFIG_H_
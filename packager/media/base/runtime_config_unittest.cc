@@ -0,0 +1,87 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/media/base/runtime_config.h"
+#include "packager/media/file/file.h"
+#include "packager/media/file/memory_file.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const char kConfigFile[] = "memory://test/runtime_config.txt";
+}  // namespace
+
+class RuntimeConfigTest : public ::testing::Test {
+ protected:
+  RuntimeConfigTest() : config_(kConfigFile) {
+    config_.set_min_check_interval_ms_for_testing(0);
+  }
+
+  void TearDown() override { MemoryFile::DeleteAll(); }
+
+  void WriteConfigFile(const std::string& contents) {
+    File* file = File::Open(kConfigFile, "w");
+    ASSERT_TRUE(file != NULL);
+    ASSERT_EQ(static_cast<int64_t>(contents.size()),
+              file->Write(contents.data(), contents.size()));
+    ASSERT_TRUE(file->Close());
+  }
+
+  RuntimeConfig config_;
+};
+
+TEST_F(RuntimeConfigTest, MissingFileSetsNothing) {
+  config_.MaybeReload();
+  double value = 0;
+  EXPECT_FALSE(config_.GetDouble("crypto_period_duration", &value));
+}
+
+TEST_F(RuntimeConfigTest, LoadsAndReloadsValues) {
+  WriteConfigFile("crypto_period_duration = 30\n");
+  config_.MaybeReload();
+
+  double value = 0;
+  EXPECT_TRUE(config_.GetDouble("crypto_period_duration", &value));
+  EXPECT_EQ(30, value);
+
+  WriteConfigFile("crypto_period_duration = 7.5\n");
+  config_.MaybeReload();
+  EXPECT_TRUE(config_.GetDouble("crypto_period_duration", &value));
+  EXPECT_EQ(7.5, value);
+}
+
+TEST_F(RuntimeConfigTest, RemovedFileClearsOverrides) {
+  WriteConfigFile("crypto_period_duration = 30\n");
+  config_.MaybeReload();
+
+  ASSERT_TRUE(File::Delete(kConfigFile));
+  config_.MaybeReload();
+
+  double value = 0;
+  EXPECT_FALSE(config_.GetDouble("crypto_period_duration", &value));
+}
+
+TEST_F(RuntimeConfigTest, IgnoresCommentsAndMalformedLines) {
+  WriteConfigFile(
+      "# a comment\n"
+      "\n"
+      "no separator\n"
+      "crypto_period_duration = 30\n"
+      "not_a_number = abc\n");
+  config_.MaybeReload();
+
+  double value = 0;
+  EXPECT_TRUE(config_.GetDouble("crypto_period_duration", &value));
+  EXPECT_EQ(30, value);
+  EXPECT_FALSE(config_.GetDouble("no separator", &value));
+  EXPECT_FALSE(config_.GetDouble("not_a_number", &value));
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,37 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/shared_buffer.h"
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+
+SharedBuffer::SharedBuffer() {}
+
+SharedBuffer::~SharedBuffer() {}
+
+// static
+scoped_refptr<SharedBuffer> SharedBuffer::CopyFrom(const uint8_t* data,
+                                                   size_t size) {
+  DCHECK(data);
+  scoped_refptr<SharedBuffer> buffer(new SharedBuffer());
+  buffer->data_.assign(data, data + size);
+  return buffer;
+}
+
+// static
+scoped_refptr<SharedBuffer> SharedBuffer::MoveFrom(
+    std::vector<uint8_t>* data) {
+  DCHECK(data);
+  scoped_refptr<SharedBuffer> buffer(new SharedBuffer());
+  buffer->data_.swap(*data);
+  return buffer;
+}
+
+}  // namespace media
+}  // namespace shaka
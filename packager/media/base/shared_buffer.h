@@ -0,0 +1,53 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_BASE_SHARED_BUFFER_H_
+#define MEDIA_BASE_SHARED_BUFFER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "packager/base/memory/ref_counted.h"
+
+namespace shaka {
+namespace media {
+
+/// SharedBuffer is a reference counted, immutable-by-convention byte buffer.
+/// It backs MediaSample views: several samples may reference disjoint slices
+/// of one buffer without copying, and the bytes are freed once the last
+/// reference is dropped. The buffer contents must not be mutated once views
+/// have been handed out; writers go through MediaSample::writable_data(),
+/// which detaches the view into a private copy first.
+class SharedBuffer : public base::RefCountedThreadSafe<SharedBuffer> {
+ public:
+  /// Create a SharedBuffer with a copy of the given bytes.
+  /// @param data points to the bytes to copy. Must not be NULL.
+  /// @param size is the number of bytes to copy.
+  static scoped_refptr<SharedBuffer> CopyFrom(const uint8_t* data, size_t size);
+
+  /// Create a SharedBuffer by taking over the contents of @a data without
+  /// copying. @a data is left empty.
+  static scoped_refptr<SharedBuffer> MoveFrom(std::vector<uint8_t>* data);
+
+  const uint8_t* data() const { return data_.empty() ? NULL : &data_[0]; }
+  size_t size() const { return data_.size(); }
+
+ private:
+  friend class base::RefCountedThreadSafe<SharedBuffer>;
+
+  SharedBuffer();
+  ~SharedBuffer();
+
+  std::vector<uint8_t> data_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedBuffer);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_BASE_SHARED_BUFFER_H_
@@ -0,0 +1,185 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_BASE_SPSC_RING_QUEUE_H_
+#define MEDIA_BASE_SPSC_RING_QUEUE_H_
+
+#include <vector>
+
+#include "packager/base/atomicops.h"
+#include "packager/base/logging.h"
+#include "packager/base/macros.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/timer/elapsed_timer.h"
+#include "packager/media/base/status.h"
+
+namespace shaka {
+namespace media {
+
+/// A bounded lock-free single-producer single-consumer ring buffer with the
+/// same Push/Pop/Stop interface as ProducerConsumerQueue, for use on
+/// cross-thread handoffs that are strictly one producer and one consumer,
+/// e.g. the MediaStream demuxer to muxer sample queue. Unlike
+/// ProducerConsumerQueue there is no mutex or condition variable on the hot
+/// path; a full/empty queue is waited out with a short spin followed by
+/// thread yields. Exactly one thread may call Push and one thread may call
+/// Pop; Stop may be called from any thread.
+template <class T>
+class SpscRingQueue {
+ public:
+  /// Create an SpscRingQueue.
+  /// @param capacity is the maximum number of elements that the queue can
+  ///        hold at once, rounded up to a power of two. Must be non-zero:
+  ///        the bounded capacity is what provides backpressure.
+  explicit SpscRingQueue(size_t capacity)
+      : capacity_(RoundUpToPowerOfTwo(capacity)),
+        mask_(capacity_ - 1),
+        ring_(capacity_),
+        head_(0),
+        tail_(0),
+        stop_requested_(0) {
+    DCHECK_GT(capacity, 0u);
+  }
+
+  ~SpscRingQueue() {}
+
+  /// Push an element to the back of the queue. If the queue is full, block
+  /// until spare capacity is available or time out or stopped.
+  /// @param timeout_ms indicates timeout in milliseconds. A value of zero
+  ///        means return immediately. A negative value means waiting
+  ///        indefinitely.
+  /// @return OK if the element was pushed successfully, STOPPED if Stop has
+  ///         been called, TIME_OUT if times out.
+  Status Push(const T& element, int64_t timeout_ms) {
+    base::ElapsedTimer timer;
+    size_t spins = 0;
+    while (true) {
+      if (base::subtle::Acquire_Load(&stop_requested_))
+        return Status(error::STOPPED, "");
+      // |tail_| is only written by this (the producer) thread.
+      const base::subtle::AtomicWord tail = base::subtle::NoBarrier_Load(&tail_);
+      const base::subtle::AtomicWord head = base::subtle::Acquire_Load(&head_);
+      if (static_cast<size_t>(tail - head) < capacity_) {
+        ring_[tail & mask_] = element;
+        base::subtle::Release_Store(&tail_, tail + 1);
+        return Status::OK;
+      }
+      if (!Wait(&timer, &spins, timeout_ms))
+        return Status(error::TIME_OUT, "Time out on pushing.");
+    }
+  }
+
+  /// Pop an element from the front of the queue. If the queue is empty, block
+  /// for an element to be available to be consumed or time out or stopped.
+  /// @param timeout_ms indicates timeout in milliseconds. A value of zero
+  ///        means return immediately. A negative value means waiting
+  ///        indefinitely.
+  /// @return STOPPED if Stop has been called and the queue is completely
+  ///         empty, TIME_OUT if times out, OK otherwise.
+  Status Pop(T* element, int64_t timeout_ms) {
+    base::ElapsedTimer timer;
+    size_t spins = 0;
+    while (true) {
+      // |head_| is only written by this (the consumer) thread.
+      const base::subtle::AtomicWord head = base::subtle::NoBarrier_Load(&head_);
+      const base::subtle::AtomicWord tail = base::subtle::Acquire_Load(&tail_);
+      if (head != tail) {
+        *element = ring_[head & mask_];
+        ring_[head & mask_] = T();
+        base::subtle::Release_Store(&head_, head + 1);
+        return Status::OK;
+      }
+      // Drain the queue completely before honoring Stop.
+      if (base::subtle::Acquire_Load(&stop_requested_))
+        return Status(error::STOPPED, "");
+      if (!Wait(&timer, &spins, timeout_ms))
+        return Status(error::TIME_OUT, "Time out on popping.");
+    }
+  }
+
+  /// Look at the element @a offset positions from the front of the queue
+  /// without popping it. Must be called on the consumer thread: elements
+  /// between the head and the producer's tail are not touched by the
+  /// producer, so reading them from the consumer is safe. Never blocks.
+  /// @param[out] element receives a copy of the peeked element.
+  /// @return true if an element exists at @a offset, false if the queue
+  ///         currently holds @a offset elements or fewer.
+  bool PeekFromFront(size_t offset, T* element) const {
+    DCHECK(element);
+    // |head_| is only written by this (the consumer) thread.
+    const base::subtle::AtomicWord head = base::subtle::NoBarrier_Load(&head_);
+    const base::subtle::AtomicWord tail = base::subtle::Acquire_Load(&tail_);
+    if (static_cast<size_t>(tail - head) <= offset)
+      return false;
+    *element = ring_[(head + offset) & mask_];
+    return true;
+  }
+
+  /// Terminate Pop requests once the queue drains entirely. Also terminate
+  /// all waiting and future Push requests immediately. Stop cannot stall.
+  void Stop() { base::subtle::Release_Store(&stop_requested_, 1); }
+
+  /// @return true if the queue has been stopped.
+  bool Stopped() const {
+    return base::subtle::Acquire_Load(&stop_requested_) != 0;
+  }
+
+  /// @return true if the queue is empty. Only meaningful on the consumer
+  ///         thread or after both threads have quiesced.
+  bool Empty() const {
+    return base::subtle::Acquire_Load(&head_) ==
+           base::subtle::Acquire_Load(&tail_);
+  }
+
+  /// @return The number of elements in the queue. Approximate if both
+  ///         threads are active.
+  size_t Size() const {
+    return static_cast<size_t>(base::subtle::Acquire_Load(&tail_) -
+                               base::subtle::Acquire_Load(&head_));
+  }
+
+ private:
+  // Number of spin iterations on a full/empty queue before yielding the
+  // processor. Handoffs typically complete well within the spin window.
+  static const size_t kSpinsBeforeYield = 1000u;
+
+  static size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value)
+      result <<= 1;
+    return result;
+  }
+
+  // Spins or yields once. Returns false if |timeout_ms| has expired.
+  bool Wait(base::ElapsedTimer* timer, size_t* spins, int64_t timeout_ms) {
+    if (timeout_ms == 0)
+      return false;
+    if (timeout_ms > 0 &&
+        timer->Elapsed() >= base::TimeDelta::FromMilliseconds(timeout_ms)) {
+      return false;
+    }
+    if (++(*spins) > kSpinsBeforeYield)
+      base::PlatformThread::YieldCurrentThread();
+    return true;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::vector<T> ring_;
+  // |head_| is the next position to pop, written by the consumer; |tail_| is
+  // the next position to push, written by the producer. Indices increase
+  // monotonically and are wrapped with |mask_| on access.
+  base::subtle::AtomicWord head_;
+  base::subtle::AtomicWord tail_;
+  base::subtle::Atomic32 stop_requested_;
+
+  DISALLOW_COPY_AND_ASSIGN(SpscRingQueue);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_BASE_SPSC_RING_QUEUE_H_
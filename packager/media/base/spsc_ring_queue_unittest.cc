@@ -0,0 +1,135 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/base/bind.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/base/producer_consumer_queue.h"  // For kInfiniteTimeout.
+#include "packager/media/base/spsc_ring_queue.h"
+#include "packager/media/base/test/status_test_util.h"
+
+namespace shaka {
+namespace {
+const size_t kCapacity = 8u;  // Power of two already.
+const size_t kNumElements = 10000u;
+}  // namespace
+
+namespace media {
+
+TEST(SpscRingQueueTest, CheckEmpty) {
+  SpscRingQueue<int> queue(kCapacity);
+  EXPECT_EQ(0u, queue.Size());
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(SpscRingQueueTest, PushPop) {
+  SpscRingQueue<size_t> queue(kCapacity);
+  for (size_t i = 0; i < kCapacity; ++i)
+    ASSERT_OK(queue.Push(i, kInfiniteTimeout));
+
+  EXPECT_EQ(kCapacity, queue.Size());
+  EXPECT_FALSE(queue.Empty());
+
+  for (size_t i = 0; i < kCapacity; ++i) {
+    size_t val;
+    ASSERT_OK(queue.Pop(&val, kInfiniteTimeout));
+    EXPECT_EQ(i, val);
+  }
+  EXPECT_TRUE(queue.Empty());
+}
+
+TEST(SpscRingQueueTest, PushTimeoutWhenFull) {
+  SpscRingQueue<size_t> queue(kCapacity);
+  for (size_t i = 0; i < kCapacity; ++i)
+    ASSERT_OK(queue.Push(i, kInfiniteTimeout));
+
+  Status status = queue.Push(kCapacity, 0);
+  EXPECT_EQ(error::TIME_OUT, status.error_code());
+}
+
+TEST(SpscRingQueueTest, PopTimeoutWhenEmpty) {
+  SpscRingQueue<size_t> queue(kCapacity);
+  size_t val;
+  Status status = queue.Pop(&val, 0);
+  EXPECT_EQ(error::TIME_OUT, status.error_code());
+}
+
+TEST(SpscRingQueueTest, PeekFromFrontDoesNotConsume) {
+  SpscRingQueue<size_t> queue(kCapacity);
+  for (size_t i = 0; i < kCapacity / 2; ++i)
+    ASSERT_OK(queue.Push(i, kInfiniteTimeout));
+
+  size_t val;
+  for (size_t i = 0; i < kCapacity / 2; ++i) {
+    ASSERT_TRUE(queue.PeekFromFront(i, &val));
+    EXPECT_EQ(i, val);
+  }
+  // Peeking past the last element fails without blocking.
+  EXPECT_FALSE(queue.PeekFromFront(kCapacity / 2, &val));
+  // Nothing was consumed.
+  EXPECT_EQ(kCapacity / 2, queue.Size());
+  ASSERT_OK(queue.Pop(&val, kInfiniteTimeout));
+  EXPECT_EQ(0u, val);
+
+  // Peek offsets are relative to the new front after a pop.
+  ASSERT_TRUE(queue.PeekFromFront(0, &val));
+  EXPECT_EQ(1u, val);
+}
+
+TEST(SpscRingQueueTest, StopDrainsBeforeStopping) {
+  SpscRingQueue<size_t> queue(kCapacity);
+  ASSERT_OK(queue.Push(1u, kInfiniteTimeout));
+  ASSERT_OK(queue.Push(2u, kInfiniteTimeout));
+  queue.Stop();
+
+  // Push is rejected immediately after Stop.
+  Status status = queue.Push(3u, kInfiniteTimeout);
+  EXPECT_EQ(error::STOPPED, status.error_code());
+
+  // Pop drains the queue completely before reporting STOPPED.
+  size_t val;
+  ASSERT_OK(queue.Pop(&val, kInfiniteTimeout));
+  EXPECT_EQ(1u, val);
+  ASSERT_OK(queue.Pop(&val, kInfiniteTimeout));
+  EXPECT_EQ(2u, val);
+  status = queue.Pop(&val, kInfiniteTimeout);
+  EXPECT_EQ(error::STOPPED, status.error_code());
+}
+
+namespace {
+
+void ProducerTask(SpscRingQueue<size_t>* queue) {
+  for (size_t i = 0; i < kNumElements; ++i)
+    ASSERT_OK(queue->Push(i, kInfiniteTimeout));
+  queue->Stop();
+}
+
+}  // namespace
+
+TEST(SpscRingQueueTest, CrossThreadOrderPreserved) {
+  SpscRingQueue<size_t> queue(kCapacity);
+  ClosureThread producer("Producer",
+                         base::Bind(&ProducerTask, base::Unretained(&queue)));
+  producer.Start();
+
+  size_t expected = 0;
+  while (true) {
+    size_t val;
+    Status status = queue.Pop(&val, kInfiniteTimeout);
+    if (!status.ok()) {
+      EXPECT_EQ(error::STOPPED, status.error_code());
+      break;
+    }
+    EXPECT_EQ(expected, val);
+    ++expected;
+  }
+  EXPECT_EQ(kNumElements, expected);
+  producer.Join();
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -57,6 +57,13 @@ std::string ErrorCodeToString(Code error_code) {
 const Status Status::OK = Status(error::OK, "");
 const Status Status::UNKNOWN = Status(error::UNKNOWN, "");
 
+// static
+const std::string& Status::EmptyString() {
+  // Intentionally leaked to avoid an exit-time destructor.
+  static const std::string* const empty_string = new std::string;
+  return *empty_string;
+}
+
 std::string Status::ToString() const {
   if (error_code_ == error::OK)
     return "OK";
@@ -64,7 +71,7 @@ std::string Status::ToString() const {
   return base::StringPrintf("%d (%s): %s",
                             error_code_,
                             error::ErrorCodeToString(error_code_).c_str(),
-                            error_message_.c_str());
+                            error_message().c_str());
 }
 
 std::ostream& operator<<(std::ostream& os, const Status& x) {
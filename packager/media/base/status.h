@@ -74,19 +74,50 @@ enum Code {
 
 class Status {
  public:
-  /// Creates a "successful" status.
-  Status() : error_code_(error::OK) {}
+  /// Creates a "successful" status. Does not allocate.
+  Status() : error_code_(error::OK), error_message_(nullptr) {}
 
   /// Create a status with the specified code, and error message.
   /// If "error_code == error::OK", error_message is ignored and a Status
-  /// object identical to Status::OK is constructed.
+  /// object identical to Status::OK is constructed. Message storage is
+  /// only allocated for failures.
   Status(error::Code error_code, const std::string& error_message)
-      : error_code_(error_code) {
-    if (!ok())
-      error_message_ = error_message;
+      : error_code_(error_code), error_message_(nullptr) {
+    if (!ok() && !error_message.empty())
+      error_message_ = new std::string(error_message);
+  }
+
+  Status(const Status& x)
+      : error_code_(x.error_code_),
+        error_message_(x.error_message_ ? new std::string(*x.error_message_)
+                                        : nullptr) {}
+
+  Status& operator=(const Status& x) {
+    if (this != &x) {
+      error_code_ = x.error_code_;
+      SetMessage(x.error_message_ ? *x.error_message_ : EmptyString());
+    }
+    return *this;
+  }
+
+  Status(Status&& x)
+      : error_code_(x.error_code_), error_message_(x.error_message_) {
+    x.error_code_ = error::OK;
+    x.error_message_ = nullptr;
+  }
+
+  Status& operator=(Status&& x) {
+    if (this != &x) {
+      error_code_ = x.error_code_;
+      delete error_message_;
+      error_message_ = x.error_message_;
+      x.error_code_ = error::OK;
+      x.error_message_ = nullptr;
+    }
+    return *this;
   }
 
-  ~Status() {}
+  ~Status() { delete error_message_; }
 
   /// @name Some pre-defined Status objects.
   /// @{
@@ -102,7 +133,7 @@ class Status {
       Clear();
     } else {
       error_code_ = error_code;
-      error_message_ = error_message;
+      SetMessage(error_message);
     }
   }
 
@@ -122,15 +153,19 @@ class Status {
   /// Clear this status object to contain the OK code and no error message.
   void Clear() {
     error_code_ = error::OK;
-    error_message_ = "";
+    delete error_message_;
+    error_message_ = nullptr;
   }
 
   bool ok() const { return error_code_ == error::OK; }
   error::Code error_code() const { return error_code_; }
-  const std::string& error_message() const { return error_message_; }
+  const std::string& error_message() const {
+    return error_message_ ? *error_message_ : EmptyString();
+  }
 
   bool operator==(const Status& x) const {
-    return error_code_ == x.error_code() && error_message_ == x.error_message();
+    return error_code_ == x.error_code() &&
+           error_message() == x.error_message();
   }
   bool operator!=(const Status& x) const { return !(*this == x); }
 
@@ -146,15 +181,37 @@ class Status {
     error::Code error_code = error_code_;
     error_code_ = other->error_code_;
     other->error_code_ = error_code;
-    error_message_.swap(other->error_message_);
+    std::string* error_message = error_message_;
+    error_message_ = other->error_message_;
+    other->error_message_ = error_message;
   }
 
  private:
+  // Returns a shared empty string for successful statuses and statuses
+  // without a message.
+  static const std::string& EmptyString();
+
+  // Replace the stored message, releasing the storage if the new message is
+  // empty and reusing it otherwise.
+  void SetMessage(const std::string& message) {
+    if (message.empty()) {
+      delete error_message_;
+      error_message_ = nullptr;
+    } else if (error_message_) {
+      *error_message_ = message;
+    } else {
+      error_message_ = new std::string(message);
+    }
+  }
+
   error::Code error_code_;
-  std::string error_message_;
 
-  // Not using DISALLOW_COPY_AND_ASSIGN here intentionally to allow the compiler
-  // generated copy constructor and assignment operator.
+  // Lazily allocated so that the common successful status carries no string;
+  // nullptr means an empty message.
+  std::string* error_message_;
+
+  // Copy constructor and assignment operator are intentionally allowed; they
+  // deep-copy the message so statuses remain independent.
 };
 
 std::ostream& operator<<(std::ostream& os, const Status& x);
@@ -0,0 +1,124 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/synthetic_key_source.h"
+
+#include <openssl/err.h>
+#include <openssl/rand.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/media/base/fixed_key_source.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kKeySize = 16;
+const size_t kKeyIdSize = 16;
+
+}  // namespace
+
+SyntheticKeySource::SyntheticKeySource() {
+  LOG(WARNING) << "Synthetic key source enabled: keys are random and not "
+                  "escrowed anywhere, so the output can never be decrypted. "
+                  "For load and capacity testing only.";
+}
+
+SyntheticKeySource::~SyntheticKeySource() {}
+
+Status SyntheticKeySource::FetchKeys(const std::vector<uint8_t>& pssh_box) {
+  // Nothing to fetch; keys are fabricated locally.
+  return Status::OK;
+}
+
+Status SyntheticKeySource::FetchKeys(
+    const std::vector<std::vector<uint8_t>>& key_ids) {
+  // Nothing to fetch; keys are fabricated locally.
+  return Status::OK;
+}
+
+Status SyntheticKeySource::FetchKeys(uint32_t asset_id) {
+  // Nothing to fetch; keys are fabricated locally.
+  return Status::OK;
+}
+
+Status SyntheticKeySource::GetKey(TrackType track_type, EncryptionKey* key) {
+  DCHECK(key);
+  base::AutoLock auto_lock(lock_);
+  std::map<TrackType, EncryptionKey>::const_iterator iter =
+      keys_.find(track_type);
+  if (iter == keys_.end()) {
+    Status status = GenerateKey(&keys_[track_type]);
+    if (!status.ok())
+      return status;
+    iter = keys_.find(track_type);
+  }
+  *key = iter->second;
+  AppendAdditionalKeySystemInfo(key);
+  return Status::OK;
+}
+
+Status SyntheticKeySource::GetKey(const std::vector<uint8_t>& key_id,
+                                  EncryptionKey* key) {
+  DCHECK(key);
+  base::AutoLock auto_lock(lock_);
+  for (std::map<TrackType, EncryptionKey>::const_iterator iter = keys_.begin();
+       iter != keys_.end(); ++iter) {
+    if (iter->second.key_id == key_id) {
+      *key = iter->second;
+      AppendAdditionalKeySystemInfo(key);
+      return Status::OK;
+    }
+  }
+  return Status(error::NOT_FOUND,
+                std::string("Key for key ID ") +
+                    base::HexEncode(key_id.data(), key_id.size()) +
+                    " was not found.");
+}
+
+Status SyntheticKeySource::GetCryptoPeriodKey(uint32_t crypto_period_index,
+                                              TrackType track_type,
+                                              EncryptionKey* key) {
+  DCHECK(key);
+  base::AutoLock auto_lock(lock_);
+  const std::pair<uint32_t, TrackType> period_key(crypto_period_index,
+                                                  track_type);
+  std::map<std::pair<uint32_t, TrackType>, EncryptionKey>::const_iterator
+      iter = crypto_period_keys_.find(period_key);
+  if (iter == crypto_period_keys_.end()) {
+    Status status = GenerateKey(&crypto_period_keys_[period_key]);
+    if (!status.ok())
+      return status;
+    iter = crypto_period_keys_.find(period_key);
+  }
+  *key = iter->second;
+  AppendAdditionalKeySystemInfo(key);
+  return Status::OK;
+}
+
+Status SyntheticKeySource::GenerateKey(EncryptionKey* key) {
+  key->key_id.resize(kKeyIdSize);
+  key->key.resize(kKeySize);
+  if (RAND_bytes(key->key_id.data(), kKeyIdSize) != 1 ||
+      RAND_bytes(key->key.data(), kKeySize) != 1) {
+    return Status(error::INTERNAL_ERROR,
+                  std::string("RAND_bytes failed with error: ") +
+                      ERR_error_string(ERR_get_error(), NULL));
+  }
+
+  // A v1 common system PSSH box, like the one FixedKeySource generates when
+  // no PSSH boxes are given, so manifest/PSSH signaling is exercised too.
+  ProtectionSystemSpecificInfo info;
+  info.add_key_id(key->key_id);
+  info.set_system_id(kCommonSystemId, arraysize(kCommonSystemId));
+  info.set_pssh_box_version(1);
+  key->key_system_info.push_back(info);
+  return Status::OK;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,63 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_BASE_SYNTHETIC_KEY_SOURCE_H_
+#define MEDIA_BASE_SYNTHETIC_KEY_SOURCE_H_
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/media/base/key_source.h"
+
+namespace shaka {
+namespace media {
+
+/// A key source that fabricates random keys locally, for load and capacity
+/// testing of the encrypted path. It drives the complete encryption
+/// machinery -- per-track keys, key rotation and PSSH generation -- without
+/// any license server dependency, so benchmark and soak runs measure true
+/// encrypted throughput.
+/// The keys are random and not escrowed anywhere: the output can never be
+/// decrypted. NOT for production packaging.
+class SyntheticKeySource : public KeySource {
+ public:
+  SyntheticKeySource();
+  ~SyntheticKeySource() override;
+
+  /// @name KeySource implementation overrides.
+  /// @{
+  Status FetchKeys(const std::vector<uint8_t>& pssh_box) override;
+  Status FetchKeys(const std::vector<std::vector<uint8_t>>& key_ids) override;
+  Status FetchKeys(uint32_t asset_id) override;
+
+  Status GetKey(TrackType track_type, EncryptionKey* key) override;
+  Status GetKey(const std::vector<uint8_t>& key_id,
+                EncryptionKey* key) override;
+  Status GetCryptoPeriodKey(uint32_t crypto_period_index,
+                            TrackType track_type,
+                            EncryptionKey* key) override;
+  /// @}
+
+ private:
+  // Fill |key| with a random key id and key plus a common system PSSH box.
+  Status GenerateKey(EncryptionKey* key);
+
+  base::Lock lock_;
+  // Lazily generated keys, one per track type, so every track type gets its
+  // own key like a production multi-key source.
+  std::map<TrackType, EncryptionKey> keys_;
+  // Lazily generated rotation keys, one per (crypto period, track type).
+  std::map<std::pair<uint32_t, TrackType>, EncryptionKey> crypto_period_keys_;
+
+  DISALLOW_COPY_AND_ASSIGN(SyntheticKeySource);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_BASE_SYNTHETIC_KEY_SOURCE_H_
@@ -0,0 +1,73 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/media/base/fixed_key_source.h"
+#include "packager/media/base/synthetic_key_source.h"
+#include "packager/media/base/test/status_test_util.h"
+
+namespace shaka {
+namespace media {
+
+TEST(SyntheticKeySourceTest, PerTrackKeysAreStableAndDistinct) {
+  SyntheticKeySource key_source;
+
+  EncryptionKey sd_key;
+  ASSERT_OK(key_source.GetKey(KeySource::TRACK_TYPE_SD, &sd_key));
+  EXPECT_EQ(16u, sd_key.key_id.size());
+  EXPECT_EQ(16u, sd_key.key.size());
+  ASSERT_EQ(1u, sd_key.key_system_info.size());
+  EXPECT_EQ(std::vector<uint8_t>(kCommonSystemId,
+                                 kCommonSystemId + arraysize(kCommonSystemId)),
+            sd_key.key_system_info[0].system_id());
+
+  // The same track type returns the same key; other track types get their
+  // own keys.
+  EncryptionKey sd_key2;
+  ASSERT_OK(key_source.GetKey(KeySource::TRACK_TYPE_SD, &sd_key2));
+  EXPECT_EQ(sd_key.key_id, sd_key2.key_id);
+  EXPECT_EQ(sd_key.key, sd_key2.key);
+
+  EncryptionKey audio_key;
+  ASSERT_OK(key_source.GetKey(KeySource::TRACK_TYPE_AUDIO, &audio_key));
+  EXPECT_NE(sd_key.key_id, audio_key.key_id);
+}
+
+TEST(SyntheticKeySourceTest, GetKeyByKeyId) {
+  SyntheticKeySource key_source;
+
+  EncryptionKey key;
+  ASSERT_OK(key_source.GetKey(KeySource::TRACK_TYPE_HD, &key));
+
+  EncryptionKey key_by_id;
+  ASSERT_OK(key_source.GetKey(key.key_id, &key_by_id));
+  EXPECT_EQ(key.key, key_by_id.key);
+
+  const std::vector<uint8_t> unknown_key_id(16, 0);
+  EXPECT_EQ(error::NOT_FOUND,
+            key_source.GetKey(unknown_key_id, &key_by_id).error_code());
+}
+
+TEST(SyntheticKeySourceTest, CryptoPeriodKeysRotate) {
+  SyntheticKeySource key_source;
+
+  EncryptionKey period0_key;
+  ASSERT_OK(key_source.GetCryptoPeriodKey(0, KeySource::TRACK_TYPE_SD,
+                                          &period0_key));
+  EncryptionKey period0_key2;
+  ASSERT_OK(key_source.GetCryptoPeriodKey(0, KeySource::TRACK_TYPE_SD,
+                                          &period0_key2));
+  EXPECT_EQ(period0_key.key_id, period0_key2.key_id);
+
+  EncryptionKey period1_key;
+  ASSERT_OK(key_source.GetCryptoPeriodKey(1, KeySource::TRACK_TYPE_SD,
+                                          &period1_key));
+  EXPECT_NE(period0_key.key_id, period1_key.key_id);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,129 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/task_pool.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/lazy_instance.h"
+#include "packager/base/logging.h"
+#include "packager/base/stl_util.h"
+#include "packager/base/sys_info.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+base::LazyInstance<TaskPool>::Leaky g_task_pool = LAZY_INSTANCE_INITIALIZER;
+
+size_t NumberOfCores() {
+  const int num_cores = base::SysInfo::NumberOfProcessors();
+  return num_cores > 0 ? num_cores : 1;
+}
+
+}  // namespace
+
+TaskPool::TaskPool()
+    : num_threads_(NumberOfCores()),
+      tasks_available_(&lock_),
+      exit_(false) {}
+
+TaskPool::TaskPool(size_t num_threads)
+    : num_threads_(num_threads), tasks_available_(&lock_), exit_(false) {
+  DCHECK_GT(num_threads, 0u);
+}
+
+TaskPool::~TaskPool() {
+  {
+    base::AutoLock auto_lock(lock_);
+    exit_ = true;
+    tasks_available_.Broadcast();
+  }
+  for (ClosureThread* worker : workers_)
+    worker->Join();
+  STLDeleteElements(&workers_);
+}
+
+// static
+TaskPool* TaskPool::GetInstance() {
+  return g_task_pool.Pointer();
+}
+
+void TaskPool::PostTask(TaskPriority priority, const base::Closure& task) {
+  base::AutoLock auto_lock(lock_);
+  EnsureWorkersStarted();
+  if (priority == kHighPriority)
+    high_priority_tasks_.push_back(task);
+  else
+    low_priority_tasks_.push_back(task);
+  tasks_available_.Signal();
+}
+
+void TaskPool::RunTasksAndWait(TaskPriority priority,
+                               const std::vector<base::Closure>& tasks) {
+  base::Lock batch_lock;
+  base::ConditionVariable batch_done(&batch_lock);
+  size_t remaining = tasks.size();
+
+  for (const base::Closure& task : tasks) {
+    PostTask(priority, base::Bind(&TaskPool::RunBatchTask, task, &batch_lock,
+                                  &batch_done, &remaining));
+  }
+
+  base::AutoLock auto_lock(batch_lock);
+  while (remaining > 0)
+    batch_done.Wait();
+}
+
+// static
+void TaskPool::RunBatchTask(const base::Closure& task,
+                            base::Lock* lock,
+                            base::ConditionVariable* cv,
+                            size_t* remaining) {
+  task.Run();
+  base::AutoLock auto_lock(*lock);
+  DCHECK_GT(*remaining, 0u);
+  --(*remaining);
+  if (*remaining == 0)
+    cv->Signal();
+}
+
+void TaskPool::EnsureWorkersStarted() {
+  lock_.AssertAcquired();
+  if (!workers_.empty())
+    return;
+  for (size_t i = 0; i < num_threads_; ++i) {
+    workers_.push_back(new ClosureThread(
+        "TaskPoolWorker",
+        base::Bind(&TaskPool::WorkerMain, base::Unretained(this))));
+    workers_.back()->Start();
+  }
+}
+
+void TaskPool::WorkerMain() {
+  base::AutoLock auto_lock(lock_);
+  while (true) {
+    while (high_priority_tasks_.empty() && low_priority_tasks_.empty() &&
+           !exit_) {
+      tasks_available_.Wait();
+    }
+    // Drain queued tasks before exiting so no posted task is dropped.
+    if (high_priority_tasks_.empty() && low_priority_tasks_.empty() && exit_)
+      return;
+
+    std::deque<base::Closure>& queue = high_priority_tasks_.empty()
+                                           ? low_priority_tasks_
+                                           : high_priority_tasks_;
+    base::Closure task = queue.front();
+    queue.pop_front();
+    {
+      base::AutoUnlock auto_unlock(lock_);
+      task.Run();
+    }
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
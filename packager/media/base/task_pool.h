@@ -0,0 +1,81 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_BASE_TASK_POOL_H_
+#define MEDIA_BASE_TASK_POOL_H_
+
+#include <deque>
+#include <vector>
+
+#include "packager/base/callback.h"
+#include "packager/base/macros.h"
+#include "packager/base/memory/scoped_ptr.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/media/base/closure_thread.h"
+
+namespace shaka {
+namespace media {
+
+/// TaskPool runs short-lived tasks on a shared set of worker threads, so
+/// components that fan work out per fragment or per cluster do not each spawn
+/// and join their own threads. The pool size is proportional to the number of
+/// CPU cores, not to the number of outputs. Long-running pipeline loops
+/// should keep their dedicated threads; a task that never returns would pin a
+/// pool worker.
+class TaskPool {
+ public:
+  enum TaskPriority {
+    /// Tasks on the sample path, e.g. per-fragment crypto. Run before any
+    /// queued low priority tasks.
+    kHighPriority,
+    /// Background and bulk tasks.
+    kLowPriority,
+  };
+
+  /// Creates a pool with one worker per CPU core.
+  TaskPool();
+  /// Creates a pool with @a num_threads workers. Intended for tests.
+  explicit TaskPool(size_t num_threads);
+  /// Joins all workers after draining queued tasks.
+  ~TaskPool();
+
+  /// @return The process-wide pool, created on first use.
+  static TaskPool* GetInstance();
+
+  /// Queues @a task and returns immediately.
+  void PostTask(TaskPriority priority, const base::Closure& task);
+
+  /// Runs all @a tasks on the pool and blocks until every one has finished.
+  /// Must not be called from a pool worker, which could deadlock the pool.
+  void RunTasksAndWait(TaskPriority priority,
+                       const std::vector<base::Closure>& tasks);
+
+ private:
+  // Runs |task|, then decrements |*remaining| under |lock| and signals |cv|.
+  static void RunBatchTask(const base::Closure& task,
+                           base::Lock* lock,
+                           base::ConditionVariable* cv,
+                           size_t* remaining);
+  // Starts the workers if they are not running yet. Called with |lock_| held.
+  void EnsureWorkersStarted();
+  void WorkerMain();
+
+  const size_t num_threads_;
+  base::Lock lock_;
+  base::ConditionVariable tasks_available_;
+  std::deque<base::Closure> high_priority_tasks_;
+  std::deque<base::Closure> low_priority_tasks_;
+  bool exit_;
+  std::vector<ClosureThread*> workers_;  // Owned.
+
+  DISALLOW_COPY_AND_ASSIGN(TaskPool);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_BASE_TASK_POOL_H_
@@ -0,0 +1,52 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/task_pool.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/bind.h"
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+void IncrementCounter(base::Lock* lock, int* counter) {
+  base::AutoLock auto_lock(*lock);
+  ++(*counter);
+}
+
+}  // namespace
+
+TEST(TaskPoolTest, RunTasksAndWait) {
+  TaskPool pool(2);
+  base::Lock lock;
+  int counter = 0;
+  std::vector<base::Closure> tasks;
+  for (int i = 0; i < 10; ++i)
+    tasks.push_back(base::Bind(&IncrementCounter, &lock, &counter));
+  pool.RunTasksAndWait(TaskPool::kHighPriority, tasks);
+  EXPECT_EQ(10, counter);
+}
+
+TEST(TaskPoolTest, DrainsQueuedTasksBeforeDestruction) {
+  base::Lock lock;
+  int counter = 0;
+  {
+    TaskPool pool(1);
+    for (int i = 0; i < 5; ++i) {
+      pool.PostTask(TaskPool::kLowPriority,
+                    base::Bind(&IncrementCounter, &lock, &counter));
+    }
+  }
+  // The destructor drains queued tasks before joining the workers.
+  base::AutoLock auto_lock(lock);
+  EXPECT_EQ(5, counter);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,53 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/timestamp_rescaler.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+int64_t Gcd(int64_t a, int64_t b) {
+  while (b != 0) {
+    const int64_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+}  // namespace
+
+TimestampRescaler::TimestampRescaler(uint32_t from_timescale,
+                                     uint32_t to_timescale) {
+  DCHECK_GT(from_timescale, 0u);
+  DCHECK_GT(to_timescale, 0u);
+  const int64_t gcd = Gcd(to_timescale, from_timescale);
+  numerator_ = to_timescale / gcd;
+  denominator_ = from_timescale / gcd;
+  max_input_ = std::numeric_limits<int64_t>::max() / numerator_;
+}
+
+void TimestampRescaler::RescaleBatch(const int64_t* input,
+                                     size_t count,
+                                     int64_t* output) const {
+  DCHECK(input);
+  DCHECK(output);
+#if !defined(NDEBUG)
+  for (size_t i = 0; i < count; ++i)
+    DCHECK_LE(input[i], max_input_);
+#endif
+  if (denominator_ == 1) {
+    for (size_t i = 0; i < count; ++i)
+      output[i] = input[i] * numerator_;
+    return;
+  }
+  for (size_t i = 0; i < count; ++i)
+    output[i] = input[i] * numerator_ / denominator_;
+}
+
+}  // namespace media
+}  // namespace shaka
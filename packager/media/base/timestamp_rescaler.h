@@ -0,0 +1,73 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_BASE_TIMESTAMP_RESCALER_H_
+#define MEDIA_BASE_TIMESTAMP_RESCALER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <limits>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+
+/// Converts timestamps and durations from one fixed timescale to another with
+/// integer arithmetic. The timescale pair is constant for a muxing job, so
+/// the conversion ratio is reduced once at construction; when it reduces to
+/// an integer (the common case: TS output at 90000 from inputs at 3000,
+/// 9000, 30000 or 45000) every conversion is a single multiply. Non-integer
+/// ratios use one multiply and one divide, still exact up to truncation,
+/// unlike a floating point scale factor which loses precision for timescales
+/// that do not divide the target. Overflow is guarded by a precomputed input
+/// bound instead of per-operation checks; see max_input().
+class TimestampRescaler {
+ public:
+  /// Creates an identity rescaler.
+  TimestampRescaler()
+      : numerator_(1),
+        denominator_(1),
+        max_input_(std::numeric_limits<int64_t>::max()) {}
+
+  /// Creates a rescaler from @a from_timescale to @a to_timescale. Both must
+  /// be non-zero.
+  TimestampRescaler(uint32_t from_timescale, uint32_t to_timescale);
+
+  /// Rescale @a value from the source to the destination timescale.
+  /// @a value must not exceed max_input().
+  int64_t Rescale(int64_t value) const {
+    DCHECK_LE(value, max_input_);
+    if (denominator_ == 1)
+      return value * numerator_;
+    return value * numerator_ / denominator_;
+  }
+
+  /// Rescale @a count values from @a input into @a output, which may alias
+  /// @a input. The overflow bound is checked (in debug builds) once for the
+  /// whole batch and the ratio branch is hoisted out of the loop.
+  void RescaleBatch(const int64_t* input, size_t count, int64_t* output) const;
+
+  /// @return The largest input value that can be rescaled without 64-bit
+  ///         overflow. Reached only with degenerate timescale pairs; e.g. a
+  ///         ratio of 30 still admits inputs of over nine million years at
+  ///         90 kHz.
+  int64_t max_input() const { return max_input_; }
+
+ private:
+  int64_t numerator_;
+  int64_t denominator_;
+  int64_t max_input_;
+
+  // Copyable: this is a value type, assigned when a stream's timescale
+  // becomes known.
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_BASE_TIMESTAMP_RESCALER_H_
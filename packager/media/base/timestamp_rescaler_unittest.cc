@@ -0,0 +1,71 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/base/macros.h"
+#include "packager/media/base/timestamp_rescaler.h"
+
+namespace shaka {
+namespace media {
+
+TEST(TimestampRescalerTest, Identity) {
+  TimestampRescaler rescaler;
+  EXPECT_EQ(0, rescaler.Rescale(0));
+  EXPECT_EQ(12345, rescaler.Rescale(12345));
+}
+
+TEST(TimestampRescalerTest, IntegerRatio) {
+  // 3000 -> 90000 reduces to a pure multiply by 30.
+  TimestampRescaler rescaler(3000, 90000);
+  EXPECT_EQ(0, rescaler.Rescale(0));
+  EXPECT_EQ(30, rescaler.Rescale(1));
+  EXPECT_EQ(3000 * 30, rescaler.Rescale(3000));
+}
+
+TEST(TimestampRescalerTest, FractionalRatio) {
+  // 44100 -> 90000 reduces to 300/147 = 100/49; exact where a double scale
+  // factor would round.
+  TimestampRescaler rescaler(44100, 90000);
+  EXPECT_EQ(90000, rescaler.Rescale(44100));
+  EXPECT_EQ(2, rescaler.Rescale(1));  // 100/49, truncated.
+  // One hour at 44.1 kHz maps exactly to one hour at 90 kHz.
+  EXPECT_EQ(90000 * 3600ll, rescaler.Rescale(44100 * 3600ll));
+}
+
+TEST(TimestampRescalerTest, Downscale) {
+  TimestampRescaler rescaler(90000, 1000);
+  EXPECT_EQ(1000, rescaler.Rescale(90000));
+  EXPECT_EQ(0, rescaler.Rescale(89));  // Truncates toward zero.
+}
+
+TEST(TimestampRescalerTest, RescaleBatch) {
+  TimestampRescaler rescaler(30000, 90000);
+  const int64_t input[] = {0, 1, 1001, 30000};
+  int64_t output[arraysize(input)] = {0};
+  rescaler.RescaleBatch(input, arraysize(input), output);
+  EXPECT_EQ(0, output[0]);
+  EXPECT_EQ(3, output[1]);
+  EXPECT_EQ(3003, output[2]);
+  EXPECT_EQ(90000, output[3]);
+}
+
+TEST(TimestampRescalerTest, RescaleBatchInPlace) {
+  TimestampRescaler rescaler(45000, 90000);
+  int64_t values[] = {1, 2, 3};
+  rescaler.RescaleBatch(values, arraysize(values), values);
+  EXPECT_EQ(2, values[0]);
+  EXPECT_EQ(4, values[1]);
+  EXPECT_EQ(6, values[2]);
+}
+
+TEST(TimestampRescalerTest, MaxInput) {
+  TimestampRescaler rescaler(3000, 90000);
+  EXPECT_EQ(std::numeric_limits<int64_t>::max() / 30, rescaler.max_input());
+}
+
+}  // namespace media
+}  // namespace shaka
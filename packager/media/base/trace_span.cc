@@ -0,0 +1,154 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/trace_span.h"
+
+#include <inttypes.h>
+
+#include <vector>
+
+#include "packager/base/lazy_instance.h"
+#include "packager/base/logging.h"
+#include "packager/base/process/process_handle.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/media/file/file.h"
+
+namespace shaka {
+namespace media {
+namespace tracing {
+namespace {
+
+struct TraceSpan {
+  const char* category;
+  const char* name;
+  int64_t start_us;
+  int64_t duration_us;
+  int32_t tid;
+};
+
+// The span ring. Recording takes the lock for an index bump and a struct
+// copy; spans are recorded at fragment/segment granularity, not per sample,
+// so contention is not a concern.
+class SpanBuffer {
+ public:
+  SpanBuffer() : enabled_(false), next_(0), wrapped_(false) {}
+
+  void Enable(size_t max_spans) {
+    DCHECK_GT(max_spans, 0u);
+    spans_.resize(max_spans);
+    enabled_ = true;
+  }
+
+  bool enabled() const { return enabled_; }
+
+  void Record(const TraceSpan& span) {
+    base::AutoLock auto_lock(lock_);
+    spans_[next_] = span;
+    if (++next_ == spans_.size()) {
+      next_ = 0;
+      wrapped_ = true;
+    }
+  }
+
+  // Copies out the recorded spans, oldest first.
+  void Snapshot(std::vector<TraceSpan>* spans) const {
+    base::AutoLock auto_lock(lock_);
+    spans->clear();
+    if (wrapped_)
+      spans->insert(spans->end(), spans_.begin() + next_, spans_.end());
+    spans->insert(spans->end(), spans_.begin(), spans_.begin() + next_);
+  }
+
+ private:
+  bool enabled_;
+  mutable base::Lock lock_;
+  std::vector<TraceSpan> spans_;
+  size_t next_;
+  bool wrapped_;
+
+  DISALLOW_COPY_AND_ASSIGN(SpanBuffer);
+};
+
+base::LazyInstance<SpanBuffer>::Leaky g_span_buffer = LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+void Enable(size_t max_spans) {
+  g_span_buffer.Get().Enable(max_spans);
+}
+
+bool enabled() {
+  return g_span_buffer.Get().enabled();
+}
+
+void RecordSpan(const char* category,
+                const char* name,
+                int64_t start_us,
+                int64_t duration_us) {
+  if (!enabled())
+    return;
+  TraceSpan span;
+  span.category = category;
+  span.name = name;
+  span.start_us = start_us;
+  span.duration_us = duration_us;
+  span.tid = static_cast<int32_t>(base::PlatformThread::CurrentId());
+  g_span_buffer.Get().Record(span);
+}
+
+std::string ToJson() {
+  std::vector<TraceSpan> spans;
+  g_span_buffer.Get().Snapshot(&spans);
+  const int32_t pid = static_cast<int32_t>(base::GetCurrentProcId());
+  std::string json("{\"traceEvents\": [");
+  for (size_t i = 0; i < spans.size(); ++i) {
+    base::StringAppendF(
+        &json,
+        "%s{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", "
+        "\"ts\": %" PRId64 ", \"dur\": %" PRId64 ", "
+        "\"pid\": %" PRId32 ", \"tid\": %" PRId32 "}",
+        i == 0 ? "" : ", ", spans[i].name, spans[i].category,
+        spans[i].start_us, spans[i].duration_us, pid, spans[i].tid);
+  }
+  json += "]}";
+  return json;
+}
+
+bool DumpToFile(const std::string& path) {
+  const std::string json = ToJson();
+  File* file = File::Open(path.c_str(), "w");
+  if (!file) {
+    LOG(ERROR) << "Failed to open trace file " << path;
+    return false;
+  }
+  const int64_t written = file->Write(json.data(), json.size());
+  if (!file->Close() || written != static_cast<int64_t>(json.size())) {
+    LOG(ERROR) << "Failed to write trace file " << path;
+    return false;
+  }
+  return true;
+}
+
+ScopedTraceSpan::ScopedTraceSpan(const char* category, const char* name)
+    : category_(category),
+      name_(name),
+      enabled_(enabled()),
+      start_(base::TimeTicks::Now()) {}
+
+ScopedTraceSpan::~ScopedTraceSpan() {
+  if (!enabled_)
+    return;
+  const base::TimeTicks end = base::TimeTicks::Now();
+  RecordSpan(category_, name_,
+             (start_ - base::TimeTicks()).InMicroseconds(),
+             (end - start_).InMicroseconds());
+}
+
+}  // namespace tracing
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,96 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_BASE_TRACE_SPAN_H_
+#define MEDIA_BASE_TRACE_SPAN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "packager/base/macros.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+namespace media {
+
+/// Scoped trace spans for timeline diagnosis. Where the pipeline stats
+/// counters answer "which stage is slow overall", spans answer "what happened
+/// around this one late segment": each span records its start time and
+/// duration into an in-memory ring buffer, which can be dumped as Chrome
+/// trace-event JSON and loaded into a trace viewer (chrome://tracing).
+///
+/// Span recording is compiled out by default; build with
+/// GYP_DEFINES="packager_tracing=1" to compile the TRACE_SPAN macro in. Even
+/// then nothing is recorded until tracing::Enable() is called (--trace_file).
+/// The ring buffer keeps the most recent spans, so a misbehaving live channel
+/// can run indefinitely and still dump the window around the incident.
+namespace tracing {
+
+/// Turn on span collection with room for @a max_spans spans; older spans are
+/// overwritten once the ring is full. Not thread safe; call during startup
+/// before the pipeline threads exist.
+void Enable(size_t max_spans);
+
+/// @return true if span collection is enabled.
+bool enabled();
+
+/// Record one completed span. @a category and @a name must be string
+/// literals; only the pointers are stored.
+void RecordSpan(const char* category,
+                const char* name,
+                int64_t start_us,
+                int64_t duration_us);
+
+/// @return The recorded spans, oldest first, encoded in the Chrome
+///         trace-event JSON format: {"traceEvents": [{"name": ...,
+///         "cat": ..., "ph": "X", "ts": ..., "dur": ..., "pid": ...,
+///         "tid": ...}, ...]}.
+std::string ToJson();
+
+/// Write ToJson() to @a path, replacing the file if it exists.
+/// @return true on success.
+bool DumpToFile(const std::string& path);
+
+/// Measures the wall time of a scope and records it as a span. Use through
+/// the TRACE_SPAN macro so disabled builds compile the span out entirely.
+class ScopedTraceSpan {
+ public:
+  ScopedTraceSpan(const char* category, const char* name);
+  ~ScopedTraceSpan();
+
+ private:
+  const char* const category_;
+  const char* const name_;
+  const bool enabled_;
+  const base::TimeTicks start_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedTraceSpan);
+};
+
+}  // namespace tracing
+}  // namespace media
+}  // namespace shaka
+
+#if defined(PACKAGER_ENABLE_TRACING)
+
+#define TRACE_SPAN_CONCAT_INTERNAL(a, b) a##b
+#define TRACE_SPAN_CONCAT(a, b) TRACE_SPAN_CONCAT_INTERNAL(a, b)
+
+/// Records the enclosing scope as a trace span. @a category and @a name must
+/// be string literals, e.g. TRACE_SPAN("mux", "WriteSegment").
+#define TRACE_SPAN(category, name)                  \
+  ::shaka::media::tracing::ScopedTraceSpan          \
+      TRACE_SPAN_CONCAT(trace_span_, __LINE__)(category, name)
+
+#else
+
+#define TRACE_SPAN(category, name)
+
+#endif  // defined(PACKAGER_ENABLE_TRACING)
+
+#endif  // MEDIA_BASE_TRACE_SPAN_H_
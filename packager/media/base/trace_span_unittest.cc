@@ -0,0 +1,51 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/media/base/trace_span.h"
+#include "packager/media/file/file.h"
+#include "packager/media/file/memory_file.h"
+
+namespace shaka {
+namespace media {
+
+// The span buffer is process-wide state, so everything is exercised in one
+// test to keep the expectations independent of test ordering.
+TEST(TraceSpanTest, RecordsWrapsAndDumps) {
+  EXPECT_FALSE(tracing::enabled());
+  tracing::RecordSpan("demux", "ignored", 0, 1);  // Dropped while disabled.
+
+  tracing::Enable(2);
+  EXPECT_TRUE(tracing::enabled());
+  tracing::RecordSpan("demux", "first", 10, 5);
+  std::string json = tracing::ToJson();
+  EXPECT_NE(std::string::npos, json.find("\"first\""));
+  EXPECT_EQ(std::string::npos, json.find("ignored"));
+
+  // The ring keeps the most recent spans, oldest first in the dump.
+  tracing::RecordSpan("demux", "second", 20, 5);
+  tracing::RecordSpan("demux", "third", 30, 5);
+  json = tracing::ToJson();
+  EXPECT_EQ(std::string::npos, json.find("\"first\""));
+  EXPECT_LT(json.find("\"second\""), json.find("\"third\""));
+
+  {
+    tracing::ScopedTraceSpan span("mux", "scoped_span");
+  }
+  EXPECT_NE(std::string::npos, tracing::ToJson().find("\"scoped_span\""));
+
+  const char kTraceFile[] = "memory://test/trace.json";
+  EXPECT_TRUE(tracing::DumpToFile(kTraceFile));
+  std::string contents;
+  EXPECT_TRUE(File::ReadFileToString(kTraceFile, &contents));
+  EXPECT_NE(std::string::npos, contents.find("\"traceEvents\""));
+  EXPECT_NE(std::string::npos, contents.find("\"scoped_span\""));
+  MemoryFile::DeleteAll();
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -6,6 +6,8 @@
 
 #include "packager/media/base/video_stream_info.h"
 
+#include <algorithm>
+
 #include "packager/base/logging.h"
 #include "packager/base/stl_util.h"
 #include "packager/base/strings/string_number_conversions.h"
@@ -89,6 +91,33 @@ bool VideoStreamInfo::IsValidConfig() const {
          (nalu_length_size_ <= 2 || nalu_length_size_ == 4);
 }
 
+bool VideoStreamInfo::FindNextKeyFrameTimestamp(int64_t timestamp,
+                                                int64_t* next) const {
+  DCHECK(next);
+  DCHECK(has_key_frame_index());
+  std::vector<int64_t>::const_iterator it =
+      std::upper_bound(key_frame_timestamps_.begin(),
+                       key_frame_timestamps_.end(), timestamp);
+  if (it == key_frame_timestamps_.end())
+    return false;
+  *next = *it;
+  return true;
+}
+
+bool VideoStreamInfo::FindKeyFrameTimestampAtOrBefore(
+    int64_t timestamp,
+    int64_t* at_or_before) const {
+  DCHECK(at_or_before);
+  DCHECK(has_key_frame_index());
+  std::vector<int64_t>::const_iterator it =
+      std::upper_bound(key_frame_timestamps_.begin(),
+                       key_frame_timestamps_.end(), timestamp);
+  if (it == key_frame_timestamps_.begin())
+    return false;
+  *at_or_before = *(it - 1);
+  return true;
+}
+
 std::string VideoStreamInfo::ToString() const {
   return base::StringPrintf(
       "%s codec: %s\n width: %d\n height: %d\n pixel_aspect_ratio: %d:%d\n "
@@ -7,6 +7,8 @@
 #ifndef MEDIA_BASE_VIDEO_STREAM_INFO_H_
 #define MEDIA_BASE_VIDEO_STREAM_INFO_H_
 
+#include <vector>
+
 #include "packager/media/base/stream_info.h"
 
 namespace shaka {
@@ -73,6 +75,33 @@ class VideoStreamInfo : public StreamInfo {
   void set_pixel_width(uint32_t pixel_width) { pixel_width_ = pixel_width; }
   void set_pixel_height(uint32_t pixel_height) { pixel_height_ = pixel_height; }
 
+  /// Install the key frame index for this stream: the decode timestamps of
+  /// all key frames, ascending, in the stream's time scale. Set by the media
+  /// parser when the container provides the information upfront (e.g. the
+  /// 'stss' table of a non-fragmented mp4), so downstream consumers can
+  /// query key frame positions in O(log n) instead of rediscovering them
+  /// from the samples.
+  /// @param key_frame_timestamps must be sorted ascending.
+  void set_key_frame_timestamps(const std::vector<int64_t>& timestamps) {
+    key_frame_timestamps_ = timestamps;
+  }
+
+  /// @return true if a key frame index was installed for this stream.
+  bool has_key_frame_index() const { return !key_frame_timestamps_.empty(); }
+
+  /// Looks up the decode timestamp of the first key frame strictly after
+  /// @a timestamp. O(log n) in the number of key frames. Requires
+  /// has_key_frame_index().
+  /// @return true on success, false if no key frame follows @a timestamp.
+  bool FindNextKeyFrameTimestamp(int64_t timestamp, int64_t* next) const;
+
+  /// Looks up the decode timestamp of the last key frame at or before
+  /// @a timestamp. O(log n) in the number of key frames. Requires
+  /// has_key_frame_index().
+  /// @return true on success, false if no key frame precedes @a timestamp.
+  bool FindKeyFrameTimestampAtOrBefore(int64_t timestamp,
+                                       int64_t* at_or_before) const;
+
  private:
   ~VideoStreamInfo() override;
 
@@ -91,6 +120,10 @@ class VideoStreamInfo : public StreamInfo {
   // (H.264).
   uint8_t nalu_length_size_;
 
+  // Sorted key frame decode timestamps; see set_key_frame_timestamps().
+  // Empty when the parser could not build the index upfront.
+  std::vector<int64_t> key_frame_timestamps_;
+
   // Not using DISALLOW_COPY_AND_ASSIGN here intentionally to allow the compiler
   // generated copy constructor and assignment operator. Since the extra data is
   // typically small, the performance impact is minimal.
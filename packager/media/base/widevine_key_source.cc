@@ -6,20 +6,27 @@
 
 #include "packager/media/base/widevine_key_source.h"
 
+#include <openssl/sha.h>
+
 #include <set>
 
 #include "packager/base/base64.h"
 #include "packager/base/bind.h"
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
 #include "packager/base/json/json_reader.h"
 #include "packager/base/json/json_writer.h"
 #include "packager/base/memory/ref_counted.h"
 #include "packager/base/stl_util.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/time/time.h"
 #include "packager/media/base/fixed_key_source.h"
 #include "packager/media/base/http_key_fetcher.h"
 #include "packager/media/base/producer_consumer_queue.h"
 #include "packager/media/base/protection_system_specific_info.h"
 #include "packager/media/base/rcheck.h"
 #include "packager/media/base/request_signer.h"
+#include "packager/media/base/trace_span.h"
 #include "packager/media/base/widevine_pssh_data.pb.h"
 
 namespace shaka {
@@ -36,10 +43,20 @@ const char kLicenseStatusTransientError[] = "INTERNAL_ERROR";
 // the server.
 const int kNumTransientErrorRetries = 5;
 const int kFirstRetryDelayMilliseconds = 1000;
+// With key rotation every crypto period produces a distinct request payload,
+// so bound the signature cache to keep long-running jobs from growing it
+// without limit.
+const size_t kMaxCachedSignatures = 16;
 
 // Default crypto period count, which is the number of keys to fetch on every
 // key rotation enabled request.
 const int kDefaultCryptoPeriodCount = 10;
+// Default size of the rotation key prefetch window, i.e. the capacity of
+// |key_pool_|. The pool keeps the crypto period being consumed roughly
+// centered, so about half of the window is keys fetched ahead of the
+// packaging threads. Two fetch batches of headroom hides license server
+// latency even when crypto periods are short.
+const int kDefaultKeyPrefetchCount = 4 * kDefaultCryptoPeriodCount;
 const int kGetKeyTimeoutInSeconds = 5 * 60;  // 5 minutes.
 const int kKeyFetchTimeoutInSeconds = 60;  // 1 minute.
 
@@ -142,10 +159,13 @@ WidevineKeySource::WidevineKeySource(const std::string& server_url,
       key_fetcher_(new HttpKeyFetcher(kKeyFetchTimeoutInSeconds)),
       server_url_(server_url),
       crypto_period_count_(kDefaultCryptoPeriodCount),
+      key_prefetch_count_(kDefaultKeyPrefetchCount),
+      response_cache_ttl_in_seconds_(0),
       add_common_pssh_(add_common_pssh),
       key_production_started_(false),
       start_key_production_(false, false),
-      first_crypto_period_index_(0) {
+      first_crypto_period_index_(0),
+      async_fetch_complete_(true, false) {
   key_production_thread_.Start();
 }
 
@@ -172,6 +192,23 @@ Status WidevineKeySource::FetchKeys(const std::vector<uint8_t>& content_id,
   return FetchKeysInternal(!kEnableKeyRotation, 0, false);
 }
 
+void WidevineKeySource::FetchKeysAsync(const std::vector<uint8_t>& content_id,
+                                       const std::string& policy) {
+  DCHECK(!async_fetch_thread_);
+  {
+    base::AutoLock scoped_lock(lock_);
+    request_dict_.Clear();
+    std::string content_id_base64_string;
+    BytesToBase64String(content_id, &content_id_base64_string);
+    request_dict_.SetString("content_id", content_id_base64_string);
+    request_dict_.SetString("policy", policy);
+  }
+  async_fetch_thread_.reset(new ClosureThread(
+      "KeyFetchThread",
+      base::Bind(&WidevineKeySource::AsyncFetchTask, base::Unretained(this))));
+  async_fetch_thread_->Start();
+}
+
 Status WidevineKeySource::FetchKeys(const std::vector<uint8_t>& pssh_box) {
   const std::vector<uint8_t> widevine_system_id(
       kWidevineSystemId, kWidevineSystemId + arraysize(kWidevineSystemId));
@@ -231,23 +268,31 @@ Status WidevineKeySource::FetchKeys(uint32_t asset_id) {
 
 Status WidevineKeySource::GetKey(TrackType track_type, EncryptionKey* key) {
   DCHECK(key);
+  Status fetch_status = WaitForAsyncFetch();
+  if (!fetch_status.ok())
+    return fetch_status;
   if (encryption_key_map_.find(track_type) == encryption_key_map_.end()) {
     return Status(error::INTERNAL_ERROR,
                   "Cannot find key of type " + TrackTypeToString(track_type));
   }
   *key = *encryption_key_map_[track_type];
+  AppendAdditionalKeySystemInfo(key);
   return Status::OK;
 }
 
 Status WidevineKeySource::GetKey(const std::vector<uint8_t>& key_id,
                                  EncryptionKey* key) {
   DCHECK(key);
+  Status fetch_status = WaitForAsyncFetch();
+  if (!fetch_status.ok())
+    return fetch_status;
   for (std::map<TrackType, EncryptionKey*>::iterator iter =
            encryption_key_map_.begin();
        iter != encryption_key_map_.end();
        ++iter) {
     if (iter->second->key_id == key_id) {
       *key = *iter->second;
+      AppendAdditionalKeySystemInfo(key);
       return Status::OK;
     }
   }
@@ -259,6 +304,11 @@ Status WidevineKeySource::GetCryptoPeriodKey(uint32_t crypto_period_index,
                                              TrackType track_type,
                                              EncryptionKey* key) {
   DCHECK(key_production_thread_.HasBeenStarted());
+  // The initial fetch populates |request_dict_|, which the key rotation
+  // requests below build on; it must complete before key production starts.
+  Status fetch_status = WaitForAsyncFetch();
+  if (!fetch_status.ok())
+    return fetch_status;
   // TODO(kqyang): This is not elegant. Consider refactoring later.
   {
     base::AutoLock scoped_lock(lock_);
@@ -268,7 +318,7 @@ Status WidevineKeySource::GetCryptoPeriodKey(uint32_t crypto_period_index,
       first_crypto_period_index_ =
           crypto_period_index ? crypto_period_index - 1 : 0;
       DCHECK(!key_pool_);
-      key_pool_.reset(new EncryptionKeyQueue(crypto_period_count_,
+      key_pool_.reset(new EncryptionKeyQueue(key_prefetch_count_,
                                              first_crypto_period_index_));
       start_key_production_.Signal();
       key_production_started_ = true;
@@ -285,6 +335,20 @@ void WidevineKeySource::set_key_fetcher(scoped_ptr<KeyFetcher> key_fetcher) {
   key_fetcher_ = key_fetcher.Pass();
 }
 
+void WidevineKeySource::set_key_prefetch_count(uint32_t key_prefetch_count) {
+  base::AutoLock scoped_lock(lock_);
+  DCHECK(!key_production_started_);
+  key_prefetch_count_ = key_prefetch_count;
+}
+
+void WidevineKeySource::set_response_cache(
+    const std::string& response_cache_dir,
+    int32_t response_cache_ttl_in_seconds) {
+  DCHECK_GE(response_cache_ttl_in_seconds, 0);
+  response_cache_dir_ = response_cache_dir;
+  response_cache_ttl_in_seconds_ = response_cache_ttl_in_seconds;
+}
+
 Status WidevineKeySource::GetKeyInternal(uint32_t crypto_period_index,
                                          TrackType track_type,
                                          EncryptionKey* key) {
@@ -311,6 +375,7 @@ Status WidevineKeySource::GetKeyInternal(uint32_t crypto_period_index,
                   "Cannot find key of type " + TrackTypeToString(track_type));
   }
   *key = *encryption_key_map[track_type];
+  AppendAdditionalKeySystemInfo(key);
   return Status::OK;
 }
 
@@ -333,14 +398,51 @@ void WidevineKeySource::FetchKeysTask() {
   key_pool_->Stop();
 }
 
+void WidevineKeySource::AsyncFetchTask() {
+  {
+    base::AutoLock scoped_lock(lock_);
+    async_fetch_status_ = FetchKeysInternal(!kEnableKeyRotation, 0, false);
+  }
+  async_fetch_complete_.Signal();
+}
+
+Status WidevineKeySource::WaitForAsyncFetch() {
+  if (!async_fetch_thread_)
+    return Status::OK;
+  async_fetch_complete_.Wait();
+  if (!async_fetch_status_.ok()) {
+    LOG(ERROR) << "Widevine encryption key source failed to fetch keys: "
+               << async_fetch_status_.ToString();
+  }
+  return async_fetch_status_;
+}
+
 Status WidevineKeySource::FetchKeysInternal(bool enable_key_rotation,
                                             uint32_t first_crypto_period_index,
                                             bool widevine_classic) {
+  TRACE_SPAN("drm", "WidevineKeySource::FetchKeys");
   std::string request;
   FillRequest(enable_key_rotation,
               first_crypto_period_index,
               &request);
 
+  // Consult the response cache, if enabled, before going to the network.
+  const std::string cache_file_path = GetCacheFilePath(request);
+  if (!cache_file_path.empty()) {
+    std::string cached_response;
+    if (LookupResponseCache(cache_file_path, &cached_response)) {
+      std::string response;
+      bool transient_error = false;
+      if (DecodeResponse(cached_response, &response) &&
+          ExtractEncryptionKey(enable_key_rotation, widevine_classic, response,
+                               &transient_error)) {
+        return Status::OK;
+      }
+      LOG(WARNING) << "Ignoring unusable cached license response in "
+                   << cache_file_path;
+    }
+  }
+
   std::string message;
   Status status = GenerateKeyMessage(request, &message);
   if (!status.ok())
@@ -367,8 +469,11 @@ Status WidevineKeySource::FetchKeysInternal(bool enable_key_rotation,
       if (ExtractEncryptionKey(enable_key_rotation,
                                widevine_classic,
                                response,
-                               &transient_error))
+                               &transient_error)) {
+        if (!cache_file_path.empty())
+          SaveToResponseCache(cache_file_path, raw_response);
         return Status::OK;
+      }
 
       if (!transient_error) {
         return Status(
@@ -445,7 +550,7 @@ Status WidevineKeySource::GenerateKeyMessage(const std::string& request,
   // Sign the request.
   if (signer_) {
     std::string signature;
-    if (!signer_->GenerateSignature(request, &signature))
+    if (!GenerateSignatureCached(request, &signature))
       return Status(error::INTERNAL_ERROR, "Signature generation failed.");
 
     std::string signature_base64_string;
@@ -459,6 +564,34 @@ Status WidevineKeySource::GenerateKeyMessage(const std::string& request,
   return Status::OK;
 }
 
+bool WidevineKeySource::GenerateSignatureCached(const std::string& request,
+                                                std::string* signature) {
+  DCHECK(signer_);
+  DCHECK(signature);
+
+  {
+    base::AutoLock scoped_lock(signature_cache_lock_);
+    auto found = signature_cache_.find(request);
+    if (found != signature_cache_.end()) {
+      *signature = found->second;
+      return true;
+    }
+  }
+
+  // RSA-PSS signatures are salted, so two signatures of the same payload
+  // differ, but any valid signature is acceptable to the server; reusing a
+  // cached one is correct. Sign outside the lock since this takes
+  // milliseconds.
+  if (!signer_->GenerateSignature(request, signature))
+    return false;
+
+  base::AutoLock scoped_lock(signature_cache_lock_);
+  if (signature_cache_.size() >= kMaxCachedSignatures)
+    signature_cache_.clear();
+  signature_cache_[request] = *signature;
+  return true;
+}
+
 bool WidevineKeySource::DecodeResponse(
     const std::string& raw_response,
     std::string* response) {
@@ -479,6 +612,59 @@ bool WidevineKeySource::DecodeResponse(
   return true;
 }
 
+std::string WidevineKeySource::GetCacheFilePath(const std::string& request) {
+  if (response_cache_dir_.empty())
+    return "";
+  // The request signature is deliberately not part of the cache key: RSA
+  // signatures are salted and change on every run. The signer name is
+  // included to distinguish credentials.
+  std::string cache_key = request;
+  if (signer_)
+    cache_key += signer_->signer_name();
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const uint8_t*>(cache_key.data()), cache_key.size(),
+         digest);
+  const std::string file_name =
+      base::HexEncode(digest, sizeof(digest)) + ".json";
+  return base::FilePath::FromUTF8Unsafe(response_cache_dir_)
+      .AppendASCII(file_name)
+      .AsUTF8Unsafe();
+}
+
+bool WidevineKeySource::LookupResponseCache(const std::string& cache_file_path,
+                                            std::string* raw_response) {
+  DCHECK(raw_response);
+  const base::FilePath path =
+      base::FilePath::FromUTF8Unsafe(cache_file_path);
+  base::File::Info file_info;
+  if (!base::GetFileInfo(path, &file_info))
+    return false;
+  if (response_cache_ttl_in_seconds_ > 0) {
+    const base::TimeDelta age = base::Time::Now() - file_info.last_modified;
+    if (age >
+        base::TimeDelta::FromSeconds(response_cache_ttl_in_seconds_)) {
+      VLOG(1) << "Cached license response expired: " << cache_file_path;
+      return false;
+    }
+  }
+  if (!base::ReadFileToString(path, raw_response))
+    return false;
+  VLOG(1) << "Using cached license response: " << cache_file_path;
+  return true;
+}
+
+void WidevineKeySource::SaveToResponseCache(const std::string& cache_file_path,
+                                            const std::string& raw_response) {
+  const int bytes_written =
+      base::WriteFile(base::FilePath::FromUTF8Unsafe(cache_file_path),
+                      raw_response.data(), raw_response.size());
+  if (bytes_written < 0 ||
+      static_cast<size_t>(bytes_written) != raw_response.size()) {
+    LOG(WARNING) << "Failed to write license response cache file "
+                 << cache_file_path;
+  }
+}
+
 bool WidevineKeySource::ExtractEncryptionKey(
     bool enable_key_rotation,
     bool widevine_classic,
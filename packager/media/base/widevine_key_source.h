@@ -56,6 +56,15 @@ class WidevineKeySource : public KeySource {
   Status FetchKeys(const std::vector<uint8_t>& content_id,
                    const std::string& policy);
 
+  /// Start FetchKeys() for CENC on a background thread, so the license
+  /// server round trip overlaps with other start-up work, e.g. demuxer
+  /// initialization. The first GetKey() or GetCryptoPeriodKey() call blocks
+  /// until the fetch completes and reports its status.
+  /// @param content_id the unique id identify the content.
+  /// @param policy specifies the DRM content rights.
+  void FetchKeysAsync(const std::vector<uint8_t>& content_id,
+                      const std::string& policy);
+
   /// Set signer for the key source.
   /// @param signer signs the request message.
   void set_signer(scoped_ptr<RequestSigner> signer);
@@ -64,6 +73,24 @@ class WidevineKeySource : public KeySource {
   /// @param key_fetcher points to the @b KeyFetcher object to be injected.
   void set_key_fetcher(scoped_ptr<KeyFetcher> key_fetcher);
 
+  /// Set the size of the rotation key prefetch window. The background key
+  /// production thread keeps roughly half of the window fetched ahead of the
+  /// crypto period being consumed, so GetCryptoPeriodKey() does not block on
+  /// license requests at crypto period boundaries.
+  /// Must be called before the first call to GetCryptoPeriodKey().
+  /// @param key_prefetch_count is the window size in crypto periods.
+  void set_key_prefetch_count(uint32_t key_prefetch_count);
+
+  /// Enable an on-disk cache of license server responses, keyed by the
+  /// request parameters. The cache is consulted before a request goes to the
+  /// network, so repeated packaging runs for the same content do not depend
+  /// on the license server.
+  /// @param response_cache_dir is the directory holding cached responses.
+  /// @param response_cache_ttl_in_seconds is how long a cached response stays
+  ///        usable. A value of 0 means cached responses never expire.
+  void set_response_cache(const std::string& response_cache_dir,
+                          int32_t response_cache_ttl_in_seconds);
+
  protected:
    ClosureThread key_production_thread_;
 
@@ -81,6 +108,14 @@ class WidevineKeySource : public KeySource {
   // The closure task to fetch keys repeatedly.
   void FetchKeysTask();
 
+  // The closure task for the one-shot background fetch started by
+  // FetchKeysAsync().
+  void AsyncFetchTask();
+
+  // Block until a fetch started by FetchKeysAsync() completes and return its
+  // status. Returns OK immediately if no asynchronous fetch was started.
+  Status WaitForAsyncFetch();
+
   // Fetch keys from server.
   Status FetchKeysInternal(bool enable_key_rotation,
                            uint32_t first_crypto_period_index,
@@ -94,9 +129,23 @@ class WidevineKeySource : public KeySource {
   // Base64 escape and format the request. Optionally sign the request if a
   // signer is provided. |message| should not be NULL. Return OK on success.
   Status GenerateKeyMessage(const std::string& request, std::string* message);
+  // Sign |request|, reusing a cached signature if the same payload has been
+  // signed before. |signature| should not be NULL. Return true on success.
+  bool GenerateSignatureCached(const std::string& request,
+                               std::string* signature);
   // Decode |response| from JSON formatted |raw_response|.
   // |response| should not be NULL.
   bool DecodeResponse(const std::string& raw_response, std::string* response);
+  // Return the response cache file path for |request|, or an empty string if
+  // response caching is not enabled.
+  std::string GetCacheFilePath(const std::string& request);
+  // Look up |cache_file_path| in the response cache. Return true and fill in
+  // |raw_response| if a usable cached response is found.
+  bool LookupResponseCache(const std::string& cache_file_path,
+                           std::string* raw_response);
+  // Store |raw_response| in the response cache.
+  void SaveToResponseCache(const std::string& cache_file_path,
+                           const std::string& raw_response);
   // Extract encryption key from |response|, which is expected to be properly
   // formatted. |transient_error| will be set to true if it fails and the
   // failure is because of a transient error from the server. |transient_error|
@@ -114,9 +163,19 @@ class WidevineKeySource : public KeySource {
   scoped_ptr<KeyFetcher> key_fetcher_;
   std::string server_url_;
   scoped_ptr<RequestSigner> signer_;
+  // Signatures of previously signed request payloads, keyed by payload. RSA
+  // signing costs milliseconds of CPU, and identical payloads recur with
+  // client-side retries and with fetches fanned out across tracks. The lock
+  // is needed since requests are signed both on the caller's thread and on
+  // the key production thread.
+  base::Lock signature_cache_lock_;
+  std::map<std::string, std::string> signature_cache_;
   base::DictionaryValue request_dict_;
 
   const uint32_t crypto_period_count_;
+  uint32_t key_prefetch_count_;
+  std::string response_cache_dir_;
+  int32_t response_cache_ttl_in_seconds_;
   base::Lock lock_;
   bool add_common_pssh_;
   bool key_production_started_;
@@ -126,6 +185,14 @@ class WidevineKeySource : public KeySource {
   EncryptionKeyMap encryption_key_map_;  // For non key rotation request.
   Status common_encryption_request_status_;
 
+  // Written by AsyncFetchTask() before |async_fetch_complete_| is signaled;
+  // read by waiters afterwards.
+  Status async_fetch_status_;
+  base::WaitableEvent async_fetch_complete_;
+  // Declared last so the thread is joined before any member it uses is
+  // destroyed.
+  scoped_ptr<ClosureThread> async_fetch_thread_;
+
   DISALLOW_COPY_AND_ASSIGN(WidevineKeySource);
 };
 
@@ -10,6 +10,7 @@
 #include <algorithm>
 
 #include "packager/base/base64.h"
+#include "packager/base/files/scoped_temp_dir.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/stringprintf.h"
 #include "packager/media/base/fixed_key_source.h"
@@ -281,6 +282,59 @@ TEST_P(WidevineKeySourceTest, LicenseStatusCencOK) {
   VerifyKeys(false);
 }
 
+TEST_P(WidevineKeySourceTest, FetchKeysAsync) {
+  std::string mock_response = base::StringPrintf(
+      kHttpResponseFormat, Base64Encode(GenerateMockLicenseResponse()).c_str());
+
+  EXPECT_CALL(*mock_key_fetcher_, FetchKeys(_, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(mock_response), Return(Status::OK)));
+
+  CreateWidevineKeySource();
+  widevine_key_source_->FetchKeysAsync(content_id_, kPolicy);
+  // GetKey() inside VerifyKeys() waits for the background fetch to complete.
+  VerifyKeys(false);
+}
+
+TEST_P(WidevineKeySourceTest, FetchKeysAsyncFailure) {
+  const Status kMockStatus = Status::UNKNOWN;
+  EXPECT_CALL(*mock_key_fetcher_, FetchKeys(_, _, _))
+      .WillOnce(Return(kMockStatus));
+
+  CreateWidevineKeySource();
+  widevine_key_source_->FetchKeysAsync(content_id_, kPolicy);
+  EncryptionKey encryption_key;
+  ASSERT_EQ(kMockStatus, widevine_key_source_->GetKey(
+                             KeySource::TRACK_TYPE_SD, &encryption_key));
+}
+
+TEST_P(WidevineKeySourceTest, CachedLicenseResponseReused) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  const std::string cache_dir = temp_dir.path().AsUTF8Unsafe();
+  const int32_t kNoTtl = 0;
+
+  std::string mock_response = base::StringPrintf(
+      kHttpResponseFormat, Base64Encode(GenerateMockLicenseResponse()).c_str());
+
+  // The first fetch goes to the network and populates the cache.
+  EXPECT_CALL(*mock_key_fetcher_, FetchKeys(_, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(mock_response), Return(Status::OK)));
+  CreateWidevineKeySource();
+  widevine_key_source_->set_response_cache(cache_dir, kNoTtl);
+  ASSERT_OK(widevine_key_source_->FetchKeys(content_id_, kPolicy));
+  VerifyKeys(false);
+
+  // A second key source with the same cache serves the keys without hitting
+  // the network.
+  scoped_ptr<MockKeyFetcher> another_key_fetcher(new MockKeyFetcher());
+  EXPECT_CALL(*another_key_fetcher, FetchKeys(_, _, _)).Times(0);
+  widevine_key_source_.reset(new WidevineKeySource(kServerUrl, GetParam()));
+  widevine_key_source_->set_key_fetcher(another_key_fetcher.Pass());
+  widevine_key_source_->set_response_cache(cache_dir, kNoTtl);
+  ASSERT_OK(widevine_key_source_->FetchKeys(content_id_, kPolicy));
+  VerifyKeys(false);
+}
+
 TEST_P(WidevineKeySourceTest, LicenseStatusCencNotOK) {
   std::string mock_response = base::StringPrintf(
       kHttpResponseFormat, Base64Encode(
@@ -491,6 +545,9 @@ TEST_P(WidevineKeySourceTest, KeyRotationTest) {
 
   CreateWidevineKeySource();
   widevine_key_source_->set_signer(mock_request_signer_.Pass());
+  // Pin the prefetch window to one fetch batch so the number of license
+  // requests expected above stays deterministic.
+  widevine_key_source_->set_key_prefetch_count(kCryptoPeriodCount);
   ASSERT_OK(widevine_key_source_->FetchKeys(content_id_, kPolicy));
 
   EncryptionKey encryption_key;
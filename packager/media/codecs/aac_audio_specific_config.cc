@@ -126,7 +126,17 @@ bool AACAudioSpecificConfig::Parse(const std::vector<uint8_t>& data) {
 }
 
 bool AACAudioSpecificConfig::ConvertToADTS(std::vector<uint8_t>* buffer) const {
-  size_t size = buffer->size() + kADTSHeaderSize;
+  std::vector<uint8_t> adts_header;
+  if (!GetADTSHeader(buffer->size(), &adts_header))
+    return false;
+  buffer->insert(buffer->begin(), adts_header.begin(), adts_header.end());
+  return true;
+}
+
+bool AACAudioSpecificConfig::GetADTSHeader(
+    size_t data_size,
+    std::vector<uint8_t>* adts_header) const {
+  size_t size = data_size + kADTSHeaderSize;
 
   DCHECK(audio_object_type_ >= 1 && audio_object_type_ <= 4 &&
          frequency_index_ != 0xf && channel_config_ <= 7);
@@ -135,9 +145,9 @@ bool AACAudioSpecificConfig::ConvertToADTS(std::vector<uint8_t>* buffer) const {
   if (size >= (1 << 13))
     return false;
 
-  std::vector<uint8_t>& adts = *buffer;
+  adts_header->resize(kADTSHeaderSize);
+  std::vector<uint8_t>& adts = *adts_header;
 
-  adts.insert(buffer->begin(), kADTSHeaderSize, 0);
   adts[0] = 0xff;
   adts[1] = 0xf1;
   adts[2] = ((audio_object_type_ - 1) << 6) + (frequency_index_ << 2) +
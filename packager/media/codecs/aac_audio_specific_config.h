@@ -40,6 +40,16 @@ class AACAudioSpecificConfig {
   /// @return true on success, false otherwise.
   virtual bool ConvertToADTS(std::vector<uint8_t>* buffer) const;
 
+  /// Generate the ADTS header for a raw AAC frame of @a data_size bytes
+  /// without copying the frame itself, for callers that keep header and
+  /// frame separate.
+  /// @param data_size is the size of the raw AAC frame.
+  /// @param[out] adts_header is set to the ADTS header on success; it is
+  ///             untouched on failure.
+  /// @return true on success, false otherwise.
+  virtual bool GetADTSHeader(size_t data_size,
+                             std::vector<uint8_t>* adts_header) const;
+
   /// @param sbr_in_mimetype indicates whether SBR mode is specified in the
   ///        mimetype, i.e. codecs parameter contains mp4a.40.5.
   /// @return Output sample rate for the AAC stream.
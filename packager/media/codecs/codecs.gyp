@@ -49,6 +49,7 @@
         'vp8_parser.h',
         'vp9_parser.cc',
         'vp9_parser.h',
+        'vpx_parser.cc',
         'vpx_parser.h',
       ],
       'dependencies': [
@@ -28,6 +28,12 @@ bool H264ByteToUnitStreamConverter::GetDecoderConfigurationRecord(
     return false;
   }
 
+  if (!decoder_config_dirty_) {
+    // Parameter sets are unchanged; reuse the serialized record.
+    *decoder_config = decoder_config_;
+    return true;
+  }
+
   // Construct an AVCDecoderConfigurationRecord containing a single SPS and a
   // single PPS NALU. Please refer to ISO/IEC 14496-15 for format specifics.
   BufferWriter buffer(last_sps_.size() + last_pps_.size() + 11);
@@ -47,25 +53,28 @@ bool H264ByteToUnitStreamConverter::GetDecoderConfigurationRecord(
   buffer.AppendInt(static_cast<uint16_t>(last_pps_.size()));
   buffer.AppendVector(last_pps_);
 
-  buffer.SwapBuffer(decoder_config);
+  buffer.SwapBuffer(&decoder_config_);
+  decoder_config_dirty_ = false;
+  *decoder_config = decoder_config_;
   return true;
 }
 
 bool H264ByteToUnitStreamConverter::ProcessNalu(const Nalu& nalu) {
   DCHECK(nalu.data());
 
-  // Skip the start code, but keep the 1-byte NALU type.
-  const uint8_t* nalu_ptr = nalu.data();
-  const uint64_t nalu_size = nalu.payload_size() + nalu.header_size();
-
+  // Grabbed parameter sets skip the start code but keep the 1-byte NALU
+  // type. They invalidate the cached decoder configuration record only when
+  // the bytes actually changed.
   switch (nalu.type()) {
     case Nalu::H264_SPS:
       // Grab SPS NALU.
-      last_sps_.assign(nalu_ptr, nalu_ptr + nalu_size);
+      if (UpdateNaluData(nalu, &last_sps_))
+        decoder_config_dirty_ = true;
       return true;
     case Nalu::H264_PPS:
       // Grab PPS NALU.
-      last_pps_.assign(nalu_ptr, nalu_ptr + nalu_size);
+      if (UpdateNaluData(nalu, &last_pps_))
+        decoder_config_dirty_ = true;
       return true;
     case Nalu::H264_AUD:
       // Ignore AUD NALU.
@@ -44,6 +44,41 @@ TEST(H264ByteToUnitStreamConverter, ConversionSuccess) {
   EXPECT_EQ(expected_decoder_config, decoder_config);
 }
 
+TEST(H264ByteToUnitStreamConverter, InPlaceConversionSuccess) {
+  std::vector<uint8_t> frame = ReadTestDataFile("avc-byte-stream-frame.h264");
+  ASSERT_FALSE(frame.empty());
+
+  std::vector<uint8_t> expected_output_frame =
+      ReadTestDataFile("avc-unit-stream-frame.h264");
+  ASSERT_FALSE(expected_output_frame.empty());
+
+  H264ByteToUnitStreamConverter converter;
+  ASSERT_TRUE(converter.ConvertByteStreamToNalUnitStreamInPlace(&frame));
+  EXPECT_EQ(expected_output_frame, frame);
+}
+
+TEST(H264ByteToUnitStreamConverter, DecoderConfigCachedAcrossConversions) {
+  std::vector<uint8_t> input_frame =
+      ReadTestDataFile("avc-byte-stream-frame.h264");
+  ASSERT_FALSE(input_frame.empty());
+
+  std::vector<uint8_t> expected_decoder_config;
+  ASSERT_TRUE(base::HexStringToBytes(kExpectedConfigRecord,
+                                     &expected_decoder_config));
+
+  H264ByteToUnitStreamConverter converter;
+  std::vector<uint8_t> output_frame;
+  std::vector<uint8_t> decoder_config;
+  // Converting the same frame repeatedly, as a live stream repeating its
+  // parameter sets does, must keep producing the same record.
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_TRUE(converter.ConvertByteStreamToNalUnitStream(
+        input_frame.data(), input_frame.size(), &output_frame));
+    ASSERT_TRUE(converter.GetDecoderConfigurationRecord(&decoder_config));
+    EXPECT_EQ(expected_decoder_config, decoder_config);
+  }
+}
+
 TEST(H264ByteToUnitStreamConverter, ConversionFailure) {
   std::vector<uint8_t> input_frame(100, 0);
 
@@ -4,6 +4,8 @@
 
 #include "packager/media/codecs/h264_parser.h"
 
+#include <string.h>
+
 #include "packager/base/logging.h"
 #include "packager/base/memory/scoped_ptr.h"
 #include "packager/base/stl_util.h"
@@ -12,6 +14,24 @@
 namespace shaka {
 namespace media {
 
+namespace {
+// Returns the id of a stored parameter set whose raw bytes match |nalu|, or
+// -1 if there is none. The id is itself encoded in the bytes, so identical
+// bytes always parse to an identical structure with the same id, and the
+// stored structure can be reused as is.
+int FindCachedParamSet(const std::map<int, std::vector<uint8_t>>& raw_by_id,
+                       const Nalu& nalu) {
+  const uint64_t nalu_size = nalu.header_size() + nalu.payload_size();
+  for (const auto& entry : raw_by_id) {
+    if (entry.second.size() == nalu_size &&
+        memcmp(entry.second.data(), nalu.data(), nalu_size) == 0) {
+      return entry.first;
+    }
+  }
+  return -1;
+}
+}  // namespace
+
 // Implemented according to ISO/IEC 14496-10:2005 7.4.2.1 Sequence parameter set
 // RBSP semantics.
 bool ExtractResolutionFromSps(const H264Sps& sps,
@@ -182,7 +202,8 @@ static const int kTableSarHeight[] = {
 COMPILE_ASSERT(arraysize(kTableSarWidth) == arraysize(kTableSarHeight),
                sar_tables_must_have_same_size);
 
-H264Parser::H264Parser() {}
+H264Parser::H264Parser()
+    : last_slice_pps_id_(-1), last_slice_pps_(NULL), last_slice_sps_(NULL) {}
 
 H264Parser::~H264Parser() {
   STLDeleteValues(&active_SPSes_);
@@ -588,6 +609,12 @@ static void FillDefaultSeqScalingLists(H264Sps* sps) {
 
 H264Parser::Result H264Parser::ParseSps(const Nalu& nalu, int* sps_id) {
   // See 7.4.2.1.
+  const int cached_sps_id = FindCachedParamSet(sps_raw_data_, nalu);
+  if (cached_sps_id >= 0) {
+    *sps_id = cached_sps_id;
+    return kOk;
+  }
+
   int data;
   Result res;
   H26xBitReader reader;
@@ -704,12 +731,27 @@ H264Parser::Result H264Parser::ParseSps(const Nalu& nalu, int* sps_id) {
   *sps_id = sps->seq_parameter_set_id;
   delete active_SPSes_[*sps_id];
   active_SPSes_[*sps_id] = sps.release();
+  last_slice_pps_id_ = -1;
+  last_slice_pps_ = NULL;
+  last_slice_sps_ = NULL;
+
+  sps_raw_data_[*sps_id].assign(
+      nalu.data(), nalu.data() + nalu.header_size() + nalu.payload_size());
+  // Parsed PPS contents depend on the referenced SPS (scaling list fallback),
+  // so stored PPSes cannot be reused across an SPS change.
+  pps_raw_data_.clear();
 
   return kOk;
 }
 
 H264Parser::Result H264Parser::ParsePps(const Nalu& nalu, int* pps_id) {
   // See 7.4.2.2.
+  const int cached_pps_id = FindCachedParamSet(pps_raw_data_, nalu);
+  if (cached_pps_id >= 0) {
+    *pps_id = cached_pps_id;
+    return kOk;
+  }
+
   const H264Sps* sps;
   Result res;
   H26xBitReader reader;
@@ -778,6 +820,12 @@ H264Parser::Result H264Parser::ParsePps(const Nalu& nalu, int* pps_id) {
   *pps_id = pps->pic_parameter_set_id;
   delete active_PPSes_[*pps_id];
   active_PPSes_[*pps_id] = pps.release();
+  last_slice_pps_id_ = -1;
+  last_slice_pps_ = NULL;
+  last_slice_sps_ = NULL;
+
+  pps_raw_data_[*pps_id].assign(
+      nalu.data(), nalu.data() + nalu.header_size() + nalu.payload_size());
 
   return kOk;
 }
@@ -1000,11 +1048,21 @@ H264Parser::Result H264Parser::ParseSliceHeader(const Nalu& nalu,
 
   READ_UE_OR_RETURN(&shdr->pic_parameter_set_id);
 
-  pps = GetPps(shdr->pic_parameter_set_id);
-  TRUE_OR_RETURN(pps);
+  if (shdr->pic_parameter_set_id == last_slice_pps_id_ && last_slice_pps_) {
+    // Same PPS as the previous slice; skip the map lookups.
+    pps = last_slice_pps_;
+    sps = last_slice_sps_;
+  } else {
+    pps = GetPps(shdr->pic_parameter_set_id);
+    TRUE_OR_RETURN(pps);
 
-  sps = GetSps(pps->seq_parameter_set_id);
-  TRUE_OR_RETURN(sps);
+    sps = GetSps(pps->seq_parameter_set_id);
+    TRUE_OR_RETURN(sps);
+
+    last_slice_pps_id_ = shdr->pic_parameter_set_id;
+    last_slice_pps_ = pps;
+    last_slice_sps_ = sps;
+  }
 
   if (sps->separate_colour_plane_flag) {
     DVLOG(1) << "Interlaced streams not supported";
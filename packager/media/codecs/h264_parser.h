@@ -11,6 +11,7 @@
 #include <stdlib.h>
 
 #include <map>
+#include <vector>
 
 #include "packager/media/codecs/h26x_bit_reader.h"
 #include "packager/media/codecs/nalu_reader.h"
@@ -329,6 +330,21 @@ class H264Parser {
   SpsById active_SPSes_;
   PpsById active_PPSes_;
 
+  // Raw NALU bytes of the stored SPSes/PPSes, keyed by id. Encoders repeat
+  // parameter sets before every IDR; if the bytes match a previously parsed
+  // set, the parse is skipped and the stored structure reused.
+  typedef std::map<int, std::vector<uint8_t>> RawParamSetById;
+  RawParamSetById sps_raw_data_;
+  RawParamSetById pps_raw_data_;
+
+  // Parameter sets activated by the most recently parsed slice header.
+  // Consecutive slices overwhelmingly reference the same PPS, so caching
+  // the pair saves two map lookups per slice. Reset whenever a parameter
+  // set is actually (re)parsed, since that replaces the stored structures.
+  int last_slice_pps_id_;
+  const H264Pps* last_slice_pps_;
+  const H264Sps* last_slice_sps_;
+
   DISALLOW_COPY_AND_ASSIGN(H264Parser);
 };
 
@@ -90,6 +90,27 @@ TEST(H264ParserTest, ExtractResolutionFromSpsData) {
   EXPECT_EQ(9u, pixel_height);
 }
 
+TEST(H264ParserTest, ReusesCachedSps) {
+  const uint8_t kSps[] = {0x67, 0x64, 0x00, 0x1E, 0xAC, 0xD9, 0x40, 0xB4,
+                          0x2F, 0xF9, 0x7F, 0xF0, 0x00, 0x80, 0x00, 0x91,
+                          0x00, 0x00, 0x03, 0x03, 0xE9, 0x00, 0x00, 0xEA,
+                          0x60, 0x0F, 0x16, 0x2D, 0x96};
+
+  H264Parser parser;
+  int sps_id = 0;
+  Nalu nalu;
+  ASSERT_TRUE(nalu.Initialize(Nalu::kH264, kSps, arraysize(kSps)));
+  ASSERT_EQ(H264Parser::kOk, parser.ParseSps(nalu, &sps_id));
+  const H264Sps* sps = parser.GetSps(sps_id);
+  ASSERT_TRUE(sps);
+
+  // Parsing the same raw bytes again reuses the stored structure instead of
+  // re-parsing and replacing it.
+  ASSERT_TRUE(nalu.Initialize(Nalu::kH264, kSps, arraysize(kSps)));
+  ASSERT_EQ(H264Parser::kOk, parser.ParseSps(nalu, &sps_id));
+  EXPECT_EQ(sps, parser.GetSps(sps_id));
+}
+
 TEST(H264ParserTest, ExtractResolutionFromSpsDataWithCropping) {
   // 320x192 with frame_crop_bottom_offset of 6.
   const uint8_t kSps[] = {0x67, 0x64, 0x00, 0x0C, 0xAC, 0xD9, 0x41, 0x41, 0x9F,
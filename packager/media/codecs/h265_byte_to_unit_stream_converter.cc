@@ -29,6 +29,13 @@ bool H265ByteToUnitStreamConverter::GetDecoderConfigurationRecord(
     return false;
   }
 
+  if (!decoder_config_dirty_) {
+    // Parameter sets are unchanged; reuse the serialized record. This also
+    // skips the SPS re-parse below.
+    *decoder_config = decoder_config_;
+    return true;
+  }
+
   // We need to parse the SPS to get the data to add to the record.
   int id;
   Nalu nalu;
@@ -87,29 +94,33 @@ bool H265ByteToUnitStreamConverter::GetDecoderConfigurationRecord(
   buffer.AppendInt(static_cast<uint16_t>(last_vps_.size()));
   buffer.AppendVector(last_vps_);
 
-  buffer.SwapBuffer(decoder_config);
+  buffer.SwapBuffer(&decoder_config_);
+  decoder_config_dirty_ = false;
+  *decoder_config = decoder_config_;
   return true;
 }
 
 bool H265ByteToUnitStreamConverter::ProcessNalu(const Nalu& nalu) {
   DCHECK(nalu.data());
 
-  // Skip the start code, but keep the 2-byte NALU header.
-  const uint8_t* nalu_ptr = nalu.data();
-  const uint64_t nalu_size = nalu.payload_size() + nalu.header_size();
-
+  // Grabbed parameter sets skip the start code but keep the 2-byte NALU
+  // header. They invalidate the cached decoder configuration record only
+  // when the bytes actually changed.
   switch (nalu.type()) {
     case Nalu::H265_SPS:
       // Grab SPS NALU.
-      last_sps_.assign(nalu_ptr, nalu_ptr + nalu_size);
+      if (UpdateNaluData(nalu, &last_sps_))
+        decoder_config_dirty_ = true;
       return true;
     case Nalu::H265_PPS:
       // Grab PPS NALU.
-      last_pps_.assign(nalu_ptr, nalu_ptr + nalu_size);
+      if (UpdateNaluData(nalu, &last_pps_))
+        decoder_config_dirty_ = true;
       return true;
     case Nalu::H265_VPS:
       // Grab VPS NALU.
-      last_vps_.assign(nalu_ptr, nalu_ptr + nalu_size);
+      if (UpdateNaluData(nalu, &last_vps_))
+        decoder_config_dirty_ = true;
       return true;
     case Nalu::H265_AUD:
       // Ignore AUD NALU.
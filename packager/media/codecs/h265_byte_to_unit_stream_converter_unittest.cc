@@ -56,6 +56,19 @@ TEST(H265ByteToUnitStreamConverter, ConversionSuccess) {
   EXPECT_EQ(Nalu::H265_VPS, config.nalu(2).type());
 }
 
+TEST(H265ByteToUnitStreamConverter, InPlaceConversionSuccess) {
+  std::vector<uint8_t> frame = ReadTestDataFile("hevc-byte-stream-frame.h265");
+  ASSERT_FALSE(frame.empty());
+
+  std::vector<uint8_t> expected_output_frame =
+      ReadTestDataFile("hevc-unit-stream-frame.h265");
+  ASSERT_FALSE(expected_output_frame.empty());
+
+  H265ByteToUnitStreamConverter converter;
+  ASSERT_TRUE(converter.ConvertByteStreamToNalUnitStreamInPlace(&frame));
+  EXPECT_EQ(expected_output_frame, frame);
+}
+
 TEST(H265ByteToUnitStreamConverter, ConversionFailure) {
   std::vector<uint8_t> input_frame(100, 0);
 
@@ -6,8 +6,10 @@
 
 #include "packager/media/codecs/h265_parser.h"
 
-#include <algorithm>
 #include <math.h>
+#include <string.h>
+
+#include <algorithm>
 
 #include "packager/base/logging.h"
 #include "packager/base/stl_util.h"
@@ -33,6 +35,21 @@ namespace shaka {
 namespace media {
 
 namespace {
+// Returns the id of a stored parameter set whose raw bytes match |nalu|, or
+// -1 if there is none. Since the id is part of the bytes, identical bytes
+// parse to an identical structure with the same id.
+int FindCachedParamSet(const std::map<int, std::vector<uint8_t>>& raw_by_id,
+                       const Nalu& nalu) {
+  const uint64_t nalu_size = nalu.header_size() + nalu.payload_size();
+  for (const auto& entry : raw_by_id) {
+    if (entry.second.size() == nalu_size &&
+        memcmp(entry.second.data(), nalu.data(), nalu_size) == 0) {
+      return entry.first;
+    }
+  }
+  return -1;
+}
+
 int GetNumPicTotalCurr(const H265SliceHeader& slice_header,
                        const H265Sps& sps) {
   int num_pic_total_curr = 0;
@@ -178,7 +195,8 @@ H265ReferencePictureListModifications::
 H265SliceHeader::H265SliceHeader() {}
 H265SliceHeader::~H265SliceHeader() {}
 
-H265Parser::H265Parser() {}
+H265Parser::H265Parser()
+    : last_slice_pps_id_(-1), last_slice_pps_(NULL), last_slice_sps_(NULL) {}
 H265Parser::~H265Parser() {
   STLDeleteValues(&active_spses_);
   STLDeleteValues(&active_ppses_);
@@ -201,11 +219,24 @@ H265Parser::Result H265Parser::ParseSliceHeader(const Nalu& nalu,
   }
 
   TRUE_OR_RETURN(br->ReadUE(&slice_header->pic_parameter_set_id));
-  const H265Pps* pps = GetPps(slice_header->pic_parameter_set_id);
-  TRUE_OR_RETURN(pps);
+  const H265Pps* pps;
+  const H265Sps* sps;
+  if (slice_header->pic_parameter_set_id == last_slice_pps_id_ &&
+      last_slice_pps_) {
+    // Same PPS as the previous slice; skip the map lookups.
+    pps = last_slice_pps_;
+    sps = last_slice_sps_;
+  } else {
+    pps = GetPps(slice_header->pic_parameter_set_id);
+    TRUE_OR_RETURN(pps);
 
-  const H265Sps* sps = GetSps(pps->seq_parameter_set_id);
-  TRUE_OR_RETURN(sps);
+    sps = GetSps(pps->seq_parameter_set_id);
+    TRUE_OR_RETURN(sps);
+
+    last_slice_pps_id_ = slice_header->pic_parameter_set_id;
+    last_slice_pps_ = pps;
+    last_slice_sps_ = sps;
+  }
 
   if (!slice_header->first_slice_segment_in_pic_flag) {
     if (pps->dependent_slice_segments_enabled_flag) {
@@ -404,6 +435,12 @@ H265Parser::Result H265Parser::ParseSliceHeader(const Nalu& nalu,
 H265Parser::Result H265Parser::ParsePps(const Nalu& nalu, int* pps_id) {
   DCHECK_EQ(Nalu::H265_PPS, nalu.type());
 
+  const int cached_pps_id = FindCachedParamSet(pps_raw_data_, nalu);
+  if (cached_pps_id >= 0) {
+    *pps_id = cached_pps_id;
+    return kOk;
+  }
+
   // Reads most of the element, not reading the extension data.
   H26xBitReader reader;
   reader.Initialize(nalu.data() + nalu.header_size(), nalu.payload_size());
@@ -506,6 +543,12 @@ H265Parser::Result H265Parser::ParsePps(const Nalu& nalu, int* pps_id) {
   *pps_id = pps->pic_parameter_set_id;
   delete active_ppses_[*pps_id];
   active_ppses_[*pps_id] = pps.release();
+  last_slice_pps_id_ = -1;
+  last_slice_pps_ = NULL;
+  last_slice_sps_ = NULL;
+
+  pps_raw_data_[*pps_id].assign(
+      nalu.data(), nalu.data() + nalu.header_size() + nalu.payload_size());
 
   return kOk;
 }
@@ -513,6 +556,12 @@ H265Parser::Result H265Parser::ParsePps(const Nalu& nalu, int* pps_id) {
 H265Parser::Result H265Parser::ParseSps(const Nalu& nalu, int* sps_id) {
   DCHECK_EQ(Nalu::H265_SPS, nalu.type());
 
+  const int cached_sps_id = FindCachedParamSet(sps_raw_data_, nalu);
+  if (cached_sps_id >= 0) {
+    *sps_id = cached_sps_id;
+    return kOk;
+  }
+
   // Reads most of the element, not reading the extension data.
   H26xBitReader reader;
   reader.Initialize(nalu.data() + nalu.header_size(), nalu.payload_size());
@@ -623,6 +672,12 @@ H265Parser::Result H265Parser::ParseSps(const Nalu& nalu, int* sps_id) {
   *sps_id = sps->seq_parameter_set_id;
   delete active_spses_[*sps_id];
   active_spses_[*sps_id] = sps.release();
+  last_slice_pps_id_ = -1;
+  last_slice_pps_ = NULL;
+  last_slice_sps_ = NULL;
+
+  sps_raw_data_[*sps_id].assign(
+      nalu.data(), nalu.data() + nalu.header_size() + nalu.payload_size());
 
   return kOk;
 }
@@ -348,6 +348,21 @@ class H265Parser {
   SpsById active_spses_;
   PpsById active_ppses_;
 
+  // Raw NALU bytes of the stored SPSes/PPSes, keyed by id. Used to skip
+  // re-parsing parameter sets that encoders repeat before every IDR; if the
+  // bytes match a previously parsed set, the stored structure is reused.
+  typedef std::map<int, std::vector<uint8_t>> RawParamSetById;
+  RawParamSetById sps_raw_data_;
+  RawParamSetById pps_raw_data_;
+
+  // Parameter sets activated by the most recently parsed slice header.
+  // Consecutive slices overwhelmingly reference the same PPS, so caching
+  // the pair saves two map lookups per slice. Reset whenever a parameter
+  // set is actually (re)parsed, since that replaces the stored structures.
+  int last_slice_pps_id_;
+  const H265Pps* last_slice_pps_;
+  const H265Sps* last_slice_sps_;
+
   DISALLOW_COPY_AND_ASSIGN(H265Parser);
 };
 
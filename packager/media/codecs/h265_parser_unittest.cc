@@ -126,6 +126,35 @@ TEST(H265ParserTest, ParsePps) {
   EXPECT_EQ(0, pps->log2_parallel_merge_level_minus2);
 }
 
+TEST(H265ParserTest, ReusesCachedParameterSets) {
+  int id;
+  Nalu nalu;
+  H265Parser parser;
+  ASSERT_TRUE(nalu.Initialize(Nalu::kH265, kSpsData, arraysize(kSpsData)));
+  ASSERT_EQ(H265Parser::kOk, parser.ParseSps(nalu, &id));
+  ASSERT_EQ(0, id);
+  const H265Sps* sps = parser.GetSps(id);
+  ASSERT_TRUE(sps);
+
+  ASSERT_TRUE(nalu.Initialize(Nalu::kH265, kPpsData, arraysize(kPpsData)));
+  ASSERT_EQ(H265Parser::kOk, parser.ParsePps(nalu, &id));
+  ASSERT_EQ(0, id);
+  const H265Pps* pps = parser.GetPps(id);
+  ASSERT_TRUE(pps);
+
+  // Parsing the same raw bytes again reuses the stored structures instead of
+  // re-parsing and replacing them.
+  ASSERT_TRUE(nalu.Initialize(Nalu::kH265, kSpsData, arraysize(kSpsData)));
+  ASSERT_EQ(H265Parser::kOk, parser.ParseSps(nalu, &id));
+  ASSERT_EQ(0, id);
+  EXPECT_EQ(sps, parser.GetSps(id));
+
+  ASSERT_TRUE(nalu.Initialize(Nalu::kH265, kPpsData, arraysize(kPpsData)));
+  ASSERT_EQ(H265Parser::kOk, parser.ParsePps(nalu, &id));
+  ASSERT_EQ(0, id);
+  EXPECT_EQ(pps, parser.GetPps(id));
+}
+
 TEST(H265ParserTest, ExtractResolutionFromSpsData) {
   H265Parser parser;
   int sps_id = 0;
@@ -2,18 +2,39 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <string.h>
+
 #include "packager/base/logging.h"
 #include "packager/media/codecs/h26x_bit_reader.h"
 
 namespace shaka {
 namespace media {
 
+namespace {
+// Returns a pointer to the emulation prevention byte (the 0x03 of the first
+// 0x000003 sequence) in [data, data + size), or NULL if there is none.
+// memchr provides a vectorized search for the leading zero byte, so streams
+// without emulation prevention bytes are scanned at memory speed.
+const uint8_t* FindEmulationPreventionByte(const uint8_t* data, off_t size) {
+  const uint8_t* pos = data;
+  const uint8_t* end = data + size;
+  while (end - pos >= 3) {
+    pos = static_cast<const uint8_t*>(memchr(pos, 0, end - pos - 2));
+    if (pos == NULL)
+      return NULL;
+    if (pos[1] == 0x00 && pos[2] == 0x03)
+      return pos + 2;
+    ++pos;
+  }
+  return NULL;
+}
+}  // namespace
+
 H26xBitReader::H26xBitReader()
     : data_(NULL),
       bytes_left_(0),
       curr_byte_(0),
       num_remaining_bits_in_curr_byte_(0),
-      prev_two_bytes_(0),
       emulation_prevention_bytes_(0) {}
 
 H26xBitReader::~H26xBitReader() {}
@@ -24,13 +45,36 @@ bool H26xBitReader::Initialize(const uint8_t* data, off_t size) {
   if (size < 1)
     return false;
 
-  data_ = data;
-  bytes_left_ = size;
+  // Strip emulation prevention three-bytes (see spec) up front, so that the
+  // bit reading loops below run over clean RBSP without per-byte detection.
+  // In the common case of a stream without any, read the caller's buffer
+  // directly without copying.
   num_remaining_bits_in_curr_byte_ = 0;
-  // Initially set to 0xffff to accept all initial two-byte sequences.
-  prev_two_bytes_ = 0xffff;
   emulation_prevention_bytes_ = 0;
+  const uint8_t* epb = FindEmulationPreventionByte(data, size);
+  if (epb == NULL) {
+    data_ = data;
+    bytes_left_ = size;
+    return true;
+  }
 
+  rbsp_buffer_.clear();
+  rbsp_buffer_.reserve(size);
+  const uint8_t* pos = data;
+  const uint8_t* end = data + size;
+  while (epb != NULL) {
+    rbsp_buffer_.insert(rbsp_buffer_.end(), pos, epb);
+    ++emulation_prevention_bytes_;
+    // Skip the 0x03 byte. Another full three bytes are needed before the
+    // sequence can be detected again, which restarting the search after the
+    // stripped byte provides.
+    pos = epb + 1;
+    epb = FindEmulationPreventionByte(pos, end - pos);
+  }
+  rbsp_buffer_.insert(rbsp_buffer_.end(), pos, end);
+
+  data_ = rbsp_buffer_.data();
+  bytes_left_ = rbsp_buffer_.size();
   return true;
 }
 
@@ -38,27 +82,11 @@ bool H26xBitReader::UpdateCurrByte() {
   if (bytes_left_ < 1)
     return false;
 
-  // Emulation prevention three-byte detection.
-  // If a sequence of 0x000003 is found, skip (ignore) the last byte (0x03).
-  if (*data_ == 0x03 && (prev_two_bytes_ & 0xffff) == 0) {
-    // Detected 0x000003, skip last byte.
-    ++data_;
-    --bytes_left_;
-    ++emulation_prevention_bytes_;
-    // Need another full three bytes before we can detect the sequence again.
-    prev_two_bytes_ = 0xffff;
-
-    if (bytes_left_ < 1)
-      return false;
-  }
-
   // Load a new byte and advance pointers.
   curr_byte_ = *data_++ & 0xff;
   --bytes_left_;
   num_remaining_bits_in_curr_byte_ = 8;
 
-  prev_two_bytes_ = (prev_two_bytes_ << 8) | curr_byte_;
-
   return true;
 }
 
@@ -10,6 +10,8 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <vector>
+
 #include "packager/base/macros.h"
 
 namespace shaka {
@@ -64,7 +66,7 @@ class H26xBitReader {
   // See the definition of more_rbsp_data() in spec.
   bool HasMoreRBSPData();
 
-  // Return the number of emulation prevention bytes already read.
+  // Return the number of emulation prevention bytes stripped from the stream.
   size_t NumEmulationPreventionBytesRead();
 
  private:
@@ -72,7 +74,9 @@ class H26xBitReader {
   // Return false on end of stream.
   bool UpdateCurrByte();
 
-  // Pointer to the next unread (not in curr_byte_) byte in the stream.
+  // Pointer to the next unread (not in curr_byte_) byte in the stream. This
+  // points either into the caller's buffer (when it contains no emulation
+  // prevention bytes) or into |rbsp_buffer_|.
   const uint8_t* data_;
 
   // Bytes left in the stream (without the curr_byte_).
@@ -85,11 +89,11 @@ class H26xBitReader {
   // Number of bits remaining in curr_byte_
   int num_remaining_bits_in_curr_byte_;
 
-  // Used in emulation prevention three byte detection (see spec).
-  // Initially set to 0xffff to accept all initial two-byte sequences.
-  int prev_two_bytes_;
+  // Scratch buffer holding the stream with emulation prevention bytes
+  // stripped. Only populated by Initialize() when the stream contains any.
+  std::vector<uint8_t> rbsp_buffer_;
 
-  // Number of emulation preventation bytes (0x000003) we met.
+  // Number of emulation preventation bytes (0x000003) stripped.
   size_t emulation_prevention_bytes_;
 
   DISALLOW_COPY_AND_ASSIGN(H26xBitReader);
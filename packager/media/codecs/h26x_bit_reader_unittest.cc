@@ -97,6 +97,27 @@ TEST(H26xBitReaderTest, SkipBits) {
   EXPECT_FALSE(reader.SkipBits(5));
 }
 
+TEST(H26xBitReaderTest, StripsEmulationPreventionBytes) {
+  H26xBitReader reader;
+  // Two emulation prevention bytes: one followed by a regular byte, one
+  // followed by another 0x03, which must be kept.
+  const unsigned char rbsp[] = {0x00, 0x00, 0x03, 0x01, 0x00,
+                                0x00, 0x03, 0x03, 0x80};
+  int dummy = 0;
+
+  EXPECT_TRUE(reader.Initialize(rbsp, sizeof(rbsp)));
+  EXPECT_EQ(reader.NumBitsLeft(), 56);
+  EXPECT_EQ(2u, reader.NumEmulationPreventionBytesRead());
+
+  EXPECT_TRUE(reader.ReadBits(24, &dummy));
+  EXPECT_EQ(dummy, 0x000001);
+  EXPECT_TRUE(reader.ReadBits(24, &dummy));
+  EXPECT_EQ(dummy, 0x000003);
+  EXPECT_TRUE(reader.ReadBits(8, &dummy));
+  EXPECT_EQ(dummy, 0x80);
+  EXPECT_EQ(reader.NumBitsLeft(), 0);
+}
+
 TEST(H26xBitReaderTest, StopBitOccupyFullByte) {
   H26xBitReader reader;
   const unsigned char rbsp[] = {0xab, 0x80};
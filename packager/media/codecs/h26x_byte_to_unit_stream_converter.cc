@@ -6,6 +6,8 @@
 
 #include "packager/media/codecs/h26x_byte_to_unit_stream_converter.h"
 
+#include <string.h>
+
 #include <limits>
 
 #include "packager/base/logging.h"
@@ -22,9 +24,21 @@ const size_t kStreamConversionOverhead = 100;
 
 H26xByteToUnitStreamConverter::H26xByteToUnitStreamConverter(
     Nalu::CodecType type)
-    : type_(type) {}
+    : decoder_config_dirty_(true), type_(type) {}
 H26xByteToUnitStreamConverter::~H26xByteToUnitStreamConverter() {}
 
+bool H26xByteToUnitStreamConverter::UpdateNaluData(const Nalu& nalu,
+                                                   std::vector<uint8_t>* data) {
+  const uint8_t* nalu_ptr = nalu.data();
+  const uint64_t nalu_size = nalu.payload_size() + nalu.header_size();
+  if (data->size() == nalu_size &&
+      memcmp(data->data(), nalu_ptr, nalu_size) == 0) {
+    return false;
+  }
+  data->assign(nalu_ptr, nalu_ptr + nalu_size);
+  return true;
+}
+
 bool H26xByteToUnitStreamConverter::ConvertByteStreamToNalUnitStream(
     const uint8_t* input_frame,
     size_t input_frame_size,
@@ -57,6 +71,79 @@ bool H26xByteToUnitStreamConverter::ConvertByteStreamToNalUnitStream(
   return true;
 }
 
+bool H26xByteToUnitStreamConverter::ConvertByteStreamToNalUnitStreamInPlace(
+    std::vector<uint8_t>* frame) {
+  DCHECK(frame);
+
+  uint8_t* data = frame->data();
+  const size_t data_size = frame->size();
+
+  Nalu nalu;
+  NaluReader reader(type_, kIsAnnexbByteStream, data, data_size);
+  if (!reader.StartsWithStartCode()) {
+    LOG(ERROR) << "H.26x byte stream frame did not begin with start code.";
+    return false;
+  }
+
+  // First pass: locate the NAL units to keep. The in-place rewrite is safe as
+  // long as the write position never runs ahead of the input still to be
+  // consumed, which holds as long as start codes are 4 bytes; a 3-byte start
+  // code grows the frame by one byte, which is fine once enough slack has
+  // accumulated from dropped NAL units.
+  struct NaluRange {
+    size_t offset;
+    uint32_t size;
+  };
+  std::vector<NaluRange> kept_nalus;
+  bool in_place_safe = true;
+  size_t write_pos = 0;
+  while (reader.Advance(&nalu) == NaluReader::kOk) {
+    const uint64_t nalu_size = nalu.payload_size() + nalu.header_size();
+    DCHECK_LE(nalu_size, std::numeric_limits<uint32_t>::max());
+
+    if (ProcessNalu(nalu))
+      continue;
+
+    const size_t offset = nalu.data() - data;
+    if (write_pos + kUnitStreamNaluLengthSize > offset)
+      in_place_safe = false;
+    NaluRange range = {offset, static_cast<uint32_t>(nalu_size)};
+    kept_nalus.push_back(range);
+    write_pos += kUnitStreamNaluLengthSize + nalu_size;
+  }
+
+  if (!in_place_safe) {
+    // Fall back to a single copy, assembled from the ranges located above.
+    BufferWriter output_buffer(write_pos);
+    for (size_t i = 0; i < kept_nalus.size(); ++i) {
+      output_buffer.AppendInt(kept_nalus[i].size);
+      output_buffer.AppendArray(data + kept_nalus[i].offset,
+                                kept_nalus[i].size);
+    }
+    output_buffer.SwapBuffer(frame);
+    return true;
+  }
+
+  // Second pass: compact the kept NAL units towards the front, overwriting
+  // each start code with the NAL unit length. memmove degenerates to a no-op
+  // for a unit that is already in place, which is the common case for 4-byte
+  // start codes with nothing dropped in front of them.
+  write_pos = 0;
+  for (size_t i = 0; i < kept_nalus.size(); ++i) {
+    const size_t offset = kept_nalus[i].offset;
+    const uint32_t nalu_size = kept_nalus[i].size;
+    memmove(data + write_pos + kUnitStreamNaluLengthSize, data + offset,
+            nalu_size);
+    data[write_pos] = (nalu_size >> 24) & 0xff;
+    data[write_pos + 1] = (nalu_size >> 16) & 0xff;
+    data[write_pos + 2] = (nalu_size >> 8) & 0xff;
+    data[write_pos + 3] = nalu_size & 0xff;
+    write_pos += kUnitStreamNaluLengthSize + nalu_size;
+  }
+  frame->resize(write_pos);
+  return true;
+}
+
 }  // namespace media
 }  // namespace shaka
 
@@ -38,6 +38,18 @@ class H26xByteToUnitStreamConverter {
                                         size_t input_frame_size,
                                         std::vector<uint8_t>* output_frame);
 
+  /// Converts a whole byte stream encoded video frame to NAL unit stream
+  /// format in place, avoiding a copy of the frame payload. Start codes are
+  /// overwritten with 4-byte NAL unit lengths, and payload is only moved when
+  /// necessary, i.e. behind dropped NAL units (e.g. SPS/PPS/AUD) or 3-byte
+  /// start codes. A frame whose converted form would at some point run ahead
+  /// of the not-yet-consumed input falls back to a single copy internally.
+  /// @param frame contains a whole H.26x frame in byte stream format on
+  ///        input, and the converted frame in NAL unit stream format on
+  ///        successful return.
+  /// @return true if successful, false otherwise.
+  bool ConvertByteStreamToNalUnitStreamInPlace(std::vector<uint8_t>* frame);
+
   /// Creates either an AVCDecoderConfigurationRecord or a
   /// HEVCDecoderConfigurationRecord from the units extracted from the byte
   /// stream.
@@ -47,6 +59,19 @@ class H26xByteToUnitStreamConverter {
   virtual bool GetDecoderConfigurationRecord(
       std::vector<uint8_t>* decoder_config) const = 0;
 
+ protected:
+  // Replaces |data| with the NALU bytes (header + payload) and returns true
+  // if they differ. Returns false when the bytes are identical, which is the
+  // common case for parameter sets repeated at every key frame.
+  static bool UpdateNaluData(const Nalu& nalu, std::vector<uint8_t>* data);
+
+  // Serialized decoder configuration record built from the current parameter
+  // sets. GetDecoderConfigurationRecord() rebuilds it only when
+  // |decoder_config_dirty_| is set, i.e. when a parameter set actually
+  // changed, so identical configs are serialized once and reused.
+  mutable std::vector<uint8_t> decoder_config_;
+  mutable bool decoder_config_dirty_;
+
  private:
   // Process the given Nalu.  If this returns true, it was handled and should
   // not be copied to the buffer.
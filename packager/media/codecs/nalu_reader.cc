@@ -8,6 +8,18 @@
 
 #include <iostream>
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PACKAGER_NALU_SCAN_SSE2
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON__) || defined(__aarch64__)
+#define PACKAGER_NALU_SCAN_NEON
+#include <arm_neon.h>
+#endif
+
 #include "packager/base/logging.h"
 #include "packager/media/base/buffer_reader.h"
 #include "packager/media/codecs/h264_parser.h"
@@ -19,6 +31,49 @@ namespace {
 inline bool IsStartCode(const uint8_t* data) {
   return data[0] == 0x00 && data[1] == 0x00 && data[2] == 0x01;
 }
+
+// Returns the number of leading bytes in [data, data + size) before the first
+// zero byte, i.e. the offset of the first zero byte, or |size| if there is
+// none. A start code must begin with a zero byte, so the start code search can
+// skip this many bytes at once. Uses SIMD where available to process 16 to 32
+// bytes per iteration; byte streams consist mostly of non-zero payload bytes,
+// so this is where the scan spends nearly all of its time.
+uint64_t BytesUntilFirstZero(const uint8_t* data, uint64_t size) {
+  const uint8_t* p = data;
+  const uint8_t* end = data + size;
+#if defined(PACKAGER_NALU_SCAN_SSE2)
+#if defined(__AVX2__)
+  const __m256i kZero256 = _mm256_setzero_si256();
+  while (end - p >= 32) {
+    const __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, kZero256)) != 0)
+      break;
+    p += 32;
+  }
+#endif
+  const __m128i kZero128 = _mm_setzero_si128();
+  while (end - p >= 16) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(block, kZero128)) != 0)
+      break;
+    p += 16;
+  }
+#elif defined(PACKAGER_NALU_SCAN_NEON)
+  while (end - p >= 16) {
+    const uint8x16_t eq_zero = vceqq_u8(vld1q_u8(p), vdupq_n_u8(0));
+    const uint64x2_t eq_zero64 = vreinterpretq_u64_u8(eq_zero);
+    if ((vgetq_lane_u64(eq_zero64, 0) | vgetq_lane_u64(eq_zero64, 1)) != 0)
+      break;
+    p += 16;
+  }
+#endif
+  // Locates the zero byte within the last SIMD block, and covers the tail as
+  // well as builds without SIMD support.
+  while (p < end && *p != 0x00)
+    ++p;
+  return p - data;
+}
 }  // namespace
 
 Nalu::Nalu()
@@ -250,6 +305,17 @@ bool NaluReader::FindStartCode(const uint8_t* data,
   uint64_t bytes_left = data_size;
 
   while (bytes_left >= 3) {
+    if (data[0] != 0x00) {
+      // No start code can begin at a non-zero byte, so skip the whole run of
+      // them in one go. The skip is capped at |bytes_left| - 2 so that, as
+      // before, the last two bytes are never considered as a possible start
+      // of a start code.
+      const uint64_t skipped = BytesUntilFirstZero(data, bytes_left - 2);
+      data += skipped;
+      bytes_left -= skipped;
+      if (bytes_left < 3)
+        break;
+    }
     if (IsStartCode(data)) {
       // Found three-byte start code, set pointer at its beginning.
       *offset = data_size - bytes_left;
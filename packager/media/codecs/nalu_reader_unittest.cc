@@ -6,6 +6,8 @@
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 #include "packager/media/codecs/nalu_reader.h"
 
 namespace shaka {
@@ -75,6 +77,39 @@ TEST(NaluReaderTest, StartCodeSearchWithStartCodeInsideNalUnit) {
   EXPECT_EQ(NaluReader::kEOStream, reader.Advance(&nalu));
 }
 
+TEST(NaluReaderTest, StartCodeSearchWithLongNonZeroRuns) {
+  // Non-zero runs longer than the vectorized scan block (32 bytes) before and
+  // inside the NAL units, with the start codes at unaligned offsets.
+  std::vector<uint8_t> nalu_data(75, 0xab);
+  // First NALU, with a four-byte start code.
+  nalu_data[40] = 0x00;
+  nalu_data[41] = 0x00;
+  nalu_data[42] = 0x00;
+  nalu_data[43] = 0x01;
+  nalu_data[44] = 0x14;
+  // Second NALU.
+  nalu_data[70] = 0x00;
+  nalu_data[71] = 0x00;
+  nalu_data[72] = 0x01;
+  nalu_data[73] = 0x67;
+
+  NaluReader reader(Nalu::kH264, kIsAnnexbByteStream, nalu_data.data(),
+                    nalu_data.size());
+
+  Nalu nalu;
+  ASSERT_EQ(NaluReader::kOk, reader.Advance(&nalu));
+  EXPECT_EQ(nalu_data.data() + 44, nalu.data());
+  EXPECT_EQ(25u, nalu.payload_size());
+  EXPECT_EQ(0x14, nalu.type());
+
+  ASSERT_EQ(NaluReader::kOk, reader.Advance(&nalu));
+  EXPECT_EQ(nalu_data.data() + 73, nalu.data());
+  EXPECT_EQ(1u, nalu.payload_size());
+  EXPECT_EQ(7, nalu.type());
+
+  EXPECT_EQ(NaluReader::kEOStream, reader.Advance(&nalu));
+}
+
 TEST(NaluReaderTest, OneByteNaluLength) {
   const uint8_t kNaluData[] = {
       // First NALU
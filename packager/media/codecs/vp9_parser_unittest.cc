@@ -147,6 +147,36 @@ TEST(VP9ParserTest, KeyframeProfile3Chroma444) {
   EXPECT_THAT(frames, ElementsAre(EqualVPxFrame(arraysize(kData), 19u, true, 160u, 90u)));
 }
 
+TEST(VP9ParserTest, ParseMultipleCarriesState) {
+  const uint8_t kKeyframeData[] = {
+      0x82, 0x49, 0x83, 0x42, 0x00, 0x01, 0xf0, 0x00, 0x74, 0x04, 0x38, 0x24,
+      0x1c, 0x18, 0x34, 0x00, 0x00, 0x90, 0x3e, 0x9e, 0xe3, 0xe1, 0xdf, 0x9c,
+      0x6c, 0x00, 0x00, 0x41, 0x4d, 0xe4, 0x39, 0x94, 0xcd, 0x7b, 0x78, 0x30,
+      0x4e, 0xb5, 0xb1, 0x78, 0x40, 0x6f, 0xe5, 0x75, 0xa4, 0x28, 0x93, 0xf7,
+      0x97, 0x9f, 0x4f, 0xdf, 0xbf, 0xfc, 0xe2, 0x73, 0xfa, 0xef, 0xab, 0xcd,
+      0x2a, 0x93, 0xed, 0xfc, 0x17, 0x32, 0x8f, 0x40, 0x15, 0xfa, 0xd5, 0x3e,
+      0x35, 0x7a, 0x88, 0x69, 0xf7, 0x1f, 0x26, 0x8b,
+  };
+  const uint8_t kShowExistingData[] = {0x88};
+
+  VP9Parser parser;
+  std::vector<const uint8_t*> sample_datas = {kKeyframeData,
+                                              kShowExistingData};
+  std::vector<size_t> sample_sizes = {arraysize(kKeyframeData),
+                                      arraysize(kShowExistingData)};
+  std::vector<std::vector<VPxFrameInfo>> sample_frames;
+  ASSERT_TRUE(parser.ParseMultiple(sample_datas, sample_sizes, &sample_frames));
+  ASSERT_EQ(2u, sample_frames.size());
+  EXPECT_THAT(sample_frames[0], ElementsAre(EqualVPxFrame(
+                                    arraysize(kKeyframeData), 18u, true, 32u,
+                                    8u)));
+  // The show-existing frame reports the dimensions established by the
+  // keyframe parsed earlier in the batch.
+  EXPECT_THAT(sample_frames[1],
+              ElementsAre(EqualVPxFrame(arraysize(kShowExistingData), 1u,
+                                        false, 32u, 8u)));
+}
+
 TEST(VP9ParserTest, Intra) {
   const uint8_t kData[] = {
       0x84, 0xc9, 0x30, 0x68, 0x40, 0x20, 0x2b, 0xe0, 0x23, 0xe8, 0x18, 0x70,
@@ -0,0 +1,33 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/codecs/vpx_parser.h"
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+
+bool VPxParser::ParseMultiple(
+    const std::vector<const uint8_t*>& sample_datas,
+    const std::vector<size_t>& sample_sizes,
+    std::vector<std::vector<VPxFrameInfo>>* sample_frames) {
+  DCHECK(sample_frames);
+  DCHECK_EQ(sample_datas.size(), sample_sizes.size());
+
+  // resize() preserves the capacity of surviving entries and Parse() clears
+  // its output vector before filling it, so reusing |sample_frames| across
+  // calls avoids per-sample allocations.
+  sample_frames->resize(sample_datas.size());
+  for (size_t i = 0; i < sample_datas.size(); ++i) {
+    if (!Parse(sample_datas[i], sample_sizes[i], &(*sample_frames)[i]))
+      return false;
+  }
+  return true;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -39,6 +39,20 @@ class VPxParser {
                      size_t data_size,
                      std::vector<VPxFrameInfo>* vpx_frames) = 0;
 
+  /// Parse a batch of samples, e.g. all the samples of a cluster, in one
+  /// call. Parse state (frame dimensions, codec configuration) carries
+  /// across the samples in order, and a caller that keeps @a sample_frames
+  /// alive across calls reuses its storage instead of allocating per sample.
+  /// @param sample_datas is the list of pointers to sample data.
+  /// @param sample_sizes is the list of sample sizes in bytes, aligned with
+  ///        @a sample_datas.
+  /// @param[out] sample_frames receives one list of VPx frames per sample on
+  ///             success. Cannot be NULL.
+  /// @return true on success, false otherwise.
+  bool ParseMultiple(const std::vector<const uint8_t*>& sample_datas,
+                     const std::vector<size_t>& sample_sizes,
+                     std::vector<std::vector<VPxFrameInfo>>* sample_frames);
+
   /// @return VPx codec configuration extracted. Note that it is only valid
   ///         after parsing a keyframe or intra frame successfully.
   const VPCodecConfigurationRecord& codec_config() const {
@@ -0,0 +1,135 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/async_muxer_listener.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/media/base/stream_info.h"
+
+namespace shaka {
+namespace media {
+
+AsyncMuxerListener::AsyncMuxerListener(scoped_ptr<MuxerListener> listener)
+    : listener_(listener.Pass()),
+      event_queue_(kUnlimitedCapacity),
+      thread_("AsyncMuxerListener",
+              base::Bind(&AsyncMuxerListener::DeliverEvents,
+                         base::Unretained(this))) {
+  DCHECK(listener_);
+  thread_.Start();
+}
+
+AsyncMuxerListener::~AsyncMuxerListener() {
+  // Stop() lets the delivery thread finish the remaining events and exit.
+  event_queue_.Stop();
+  thread_.Join();
+}
+
+void AsyncMuxerListener::OnEncryptionInfoReady(
+    bool is_initial_encryption_info,
+    FourCC protection_scheme,
+    const std::vector<uint8_t>& default_key_id,
+    const std::vector<uint8_t>& iv,
+    const std::vector<ProtectionSystemSpecificInfo>& key_system_info) {
+  Post(base::Bind(&MuxerListener::OnEncryptionInfoReady,
+                  base::Unretained(listener_.get()),
+                  is_initial_encryption_info, protection_scheme,
+                  default_key_id, iv, key_system_info));
+}
+
+void AsyncMuxerListener::OnEncryptionStart() {
+  Post(base::Bind(&MuxerListener::OnEncryptionStart,
+                  base::Unretained(listener_.get())));
+}
+
+void AsyncMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
+                                      const StreamInfo& stream_info,
+                                      uint32_t time_scale,
+                                      ContainerType container_type) {
+  Post(base::Bind(&AsyncMuxerListener::DoOnMediaStart, base::Unretained(this),
+                  muxer_options, scoped_refptr<const StreamInfo>(&stream_info),
+                  time_scale, container_type));
+}
+
+void AsyncMuxerListener::OnSampleDurationReady(uint32_t sample_duration) {
+  Post(base::Bind(&MuxerListener::OnSampleDurationReady,
+                  base::Unretained(listener_.get()), sample_duration));
+}
+
+void AsyncMuxerListener::OnMediaEnd(bool has_init_range,
+                                    uint64_t init_range_start,
+                                    uint64_t init_range_end,
+                                    bool has_index_range,
+                                    uint64_t index_range_start,
+                                    uint64_t index_range_end,
+                                    float duration_seconds,
+                                    uint64_t file_size) {
+  MediaEndParameters params;
+  params.has_init_range = has_init_range;
+  params.init_range_start = init_range_start;
+  params.init_range_end = init_range_end;
+  params.has_index_range = has_index_range;
+  params.index_range_start = index_range_start;
+  params.index_range_end = index_range_end;
+  params.duration_seconds = duration_seconds;
+  params.file_size = file_size;
+  Post(base::Bind(&AsyncMuxerListener::DoOnMediaEnd, base::Unretained(this),
+                  params));
+  // This is the last event of the stream and segment production is over, so
+  // blocking here is free. The caller, and anything sequenced after it such
+  // as manifest flushes, can rely on all events having been consumed.
+  Drain();
+}
+
+void AsyncMuxerListener::OnNewSegment(const std::string& segment_name,
+                                      uint64_t start_time,
+                                      uint64_t duration,
+                                      uint64_t segment_file_size) {
+  Post(base::Bind(&MuxerListener::OnNewSegment,
+                  base::Unretained(listener_.get()), segment_name, start_time,
+                  duration, segment_file_size));
+}
+
+void AsyncMuxerListener::DoOnMediaStart(
+    const MuxerOptions& muxer_options,
+    scoped_refptr<const StreamInfo> stream_info,
+    uint32_t time_scale,
+    ContainerType container_type) {
+  listener_->OnMediaStart(muxer_options, *stream_info, time_scale,
+                          container_type);
+}
+
+void AsyncMuxerListener::DoOnMediaEnd(MediaEndParameters params) {
+  listener_->OnMediaEnd(params.has_init_range, params.init_range_start,
+                        params.init_range_end, params.has_index_range,
+                        params.index_range_start, params.index_range_end,
+                        params.duration_seconds, params.file_size);
+}
+
+void AsyncMuxerListener::Post(const base::Closure& closure) {
+  // The queue has unlimited capacity, so a push can only fail after Stop(),
+  // i.e. if an event is fired during destruction, which is a caller bug.
+  Status status = event_queue_.Push(closure, kInfiniteTimeout);
+  if (!status.ok())
+    LOG(DFATAL) << "Failed to queue muxer event: " << status.ToString();
+}
+
+void AsyncMuxerListener::Drain() {
+  base::WaitableEvent drained(false, false);
+  Post(base::Bind(&base::WaitableEvent::Signal, base::Unretained(&drained)));
+  drained.Wait();
+}
+
+void AsyncMuxerListener::DeliverEvents() {
+  base::Closure closure;
+  while (event_queue_.Pop(&closure, kInfiniteTimeout).ok())
+    closure.Run();
+}
+
+}  // namespace media
+}  // namespace shaka
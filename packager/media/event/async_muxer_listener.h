@@ -0,0 +1,114 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// MuxerListener decorator that delivers events on a dedicated thread.
+
+#ifndef MEDIA_EVENT_ASYNC_MUXER_LISTENER_H_
+#define MEDIA_EVENT_ASYNC_MUXER_LISTENER_H_
+
+#include <string>
+#include <vector>
+
+#include "packager/base/callback.h"
+#include "packager/base/compiler_specific.h"
+#include "packager/base/memory/ref_counted.h"
+#include "packager/base/memory/scoped_ptr.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/base/producer_consumer_queue.h"
+#include "packager/media/event/muxer_listener.h"
+
+namespace shaka {
+namespace media {
+
+/// Wraps another MuxerListener and delivers every event to it on a dedicated
+/// thread. Events are queued in arrival order and replayed in that order, so
+/// the wrapped listener observes exactly the sequence a synchronous listener
+/// would; only the calling thread changes. This keeps slow event consumers,
+/// e.g. manifest updates or media_info dumps, out of the segment production
+/// path: posting an event never blocks.
+/// OnMediaEnd() is delivered asynchronously like the other events but does
+/// not return until the queue has fully drained, so downstream state
+/// (manifests, media_info files) is complete by the time the muxer finishes.
+class AsyncMuxerListener : public MuxerListener {
+ public:
+  /// @param listener is the listener events are delivered to. Should not be
+  ///        NULL.
+  explicit AsyncMuxerListener(scoped_ptr<MuxerListener> listener);
+  /// The destructor delivers any events still queued before returning.
+  ~AsyncMuxerListener() override;
+
+  /// @name MuxerListener implementation overrides.
+  /// @{
+  void OnEncryptionInfoReady(bool is_initial_encryption_info,
+                             FourCC protection_scheme,
+                             const std::vector<uint8_t>& default_key_id,
+                             const std::vector<uint8_t>& iv,
+                             const std::vector<ProtectionSystemSpecificInfo>&
+                                 key_system_info) override;
+  void OnEncryptionStart() override;
+  void OnMediaStart(const MuxerOptions& muxer_options,
+                    const StreamInfo& stream_info,
+                    uint32_t time_scale,
+                    ContainerType container_type) override;
+  void OnSampleDurationReady(uint32_t sample_duration) override;
+  void OnMediaEnd(bool has_init_range,
+                  uint64_t init_range_start,
+                  uint64_t init_range_end,
+                  bool has_index_range,
+                  uint64_t index_range_start,
+                  uint64_t index_range_end,
+                  float duration_seconds,
+                  uint64_t file_size) override;
+  void OnNewSegment(const std::string& segment_name,
+                    uint64_t start_time,
+                    uint64_t duration,
+                    uint64_t segment_file_size) override;
+  /// @}
+
+ private:
+  // base::Bind is limited to seven bound arguments, so the eight OnMediaEnd()
+  // parameters travel to the delivery thread in a struct.
+  struct MediaEndParameters {
+    bool has_init_range;
+    uint64_t init_range_start;
+    uint64_t init_range_end;
+    bool has_index_range;
+    uint64_t index_range_start;
+    uint64_t index_range_end;
+    float duration_seconds;
+    uint64_t file_size;
+  };
+
+  // Delivery helpers which run on |thread_|. OnMediaStart() passes StreamInfo
+  // by reference, which may not outlive the posting call, so the closure holds
+  // a reference of its own.
+  void DoOnMediaStart(const MuxerOptions& muxer_options,
+                      scoped_refptr<const StreamInfo> stream_info,
+                      uint32_t time_scale,
+                      ContainerType container_type);
+  void DoOnMediaEnd(MediaEndParameters params);
+
+  // Appends |closure| to the delivery queue. Never blocks.
+  void Post(const base::Closure& closure);
+
+  // Blocks until every event queued so far has been delivered.
+  void Drain();
+
+  // Runs on |thread_|; delivers queued events until the queue is stopped and
+  // empty.
+  void DeliverEvents();
+
+  scoped_ptr<MuxerListener> listener_;
+  ProducerConsumerQueue<base::Closure> event_queue_;
+  ClosureThread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncMuxerListener);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_EVENT_ASYNC_MUXER_LISTENER_H_
@@ -0,0 +1,77 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "packager/base/memory/scoped_ptr.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/base/stream_info.h"
+#include "packager/media/event/async_muxer_listener.h"
+#include "packager/media/event/mock_muxer_listener.h"
+#include "packager/media/event/muxer_listener_test_helper.h"
+
+using ::testing::_;
+using ::testing::InSequence;
+
+namespace shaka {
+namespace media {
+
+class AsyncMuxerListenerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    scoped_ptr<MockMuxerListener> listener(new MockMuxerListener());
+    mock_listener_ = listener.get();
+    async_listener_.reset(new AsyncMuxerListener(listener.Pass()));
+  }
+
+  // Owned by |async_listener_|.
+  MockMuxerListener* mock_listener_;
+  scoped_ptr<AsyncMuxerListener> async_listener_;
+};
+
+// All events posted before OnMediaEnd() must reach the wrapped listener in
+// posting order, and must have been delivered by the time OnMediaEnd()
+// returns.
+TEST_F(AsyncMuxerListenerTest, EventsDeliveredInOrder) {
+  MuxerOptions muxer_options;
+  SetDefaultMuxerOptionsValues(&muxer_options);
+  scoped_refptr<StreamInfo> stream_info =
+      CreateVideoStreamInfo(GetDefaultVideoStreamInfoParams());
+  OnMediaEndParameters media_end = GetDefaultOnMediaEndParams();
+
+  InSequence s;
+  EXPECT_CALL(*mock_listener_,
+              OnMediaStart(_, _, 90000u, MuxerListener::kContainerMp4));
+  EXPECT_CALL(*mock_listener_, OnNewSegment("segment1", 0u, 100u, 1000u));
+  EXPECT_CALL(*mock_listener_, OnNewSegment("segment2", 100u, 100u, 1000u));
+  EXPECT_CALL(*mock_listener_, OnMediaEnd(_, _, _, _, _, _, _, _));
+
+  async_listener_->OnMediaStart(muxer_options, *stream_info, 90000,
+                                MuxerListener::kContainerMp4);
+  async_listener_->OnNewSegment("segment1", 0, 100, 1000);
+  async_listener_->OnNewSegment("segment2", 100, 100, 1000);
+  async_listener_->OnMediaEnd(
+      media_end.has_init_range, media_end.init_range_start,
+      media_end.init_range_end, media_end.has_index_range,
+      media_end.index_range_start, media_end.index_range_end,
+      media_end.duration_seconds, media_end.file_size);
+  // OnMediaEnd() drains the event queue, so the expectations above are
+  // satisfied here, without waiting for destruction.
+  ::testing::Mock::VerifyAndClearExpectations(mock_listener_);
+}
+
+// A stream that ends without OnMediaEnd(), e.g. on a failed job, still
+// delivers its pending events when the listener is destroyed.
+TEST_F(AsyncMuxerListenerTest, DestructorDrainsPendingEvents) {
+  EXPECT_CALL(*mock_listener_, OnNewSegment("segment1", 0u, 100u, 1000u));
+
+  async_listener_->OnNewSegment("segment1", 0, 100, 1000);
+  async_listener_.reset();
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,132 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/checkpoint_muxer_listener.h"
+
+#include "packager/base/logging.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/event/vod_media_info_dump_muxer_listener.h"
+#include "packager/media/file/file.h"
+#include "packager/mpd/base/media_info.pb.h"
+
+namespace shaka {
+namespace media {
+
+CheckpointMuxerListener::CheckpointMuxerListener(
+    const std::string& checkpoint_file_name,
+    double interval_seconds,
+    scoped_ptr<MuxerListener> listener)
+    : checkpoint_file_name_(checkpoint_file_name),
+      interval_seconds_(interval_seconds),
+      listener_(listener.Pass()),
+      time_scale_(0),
+      segment_start_number_(1),
+      num_completed_segments_(0),
+      completed_segment_bytes_(0),
+      last_segment_end_time_(0),
+      last_checkpoint_time_(0) {}
+
+CheckpointMuxerListener::~CheckpointMuxerListener() {}
+
+void CheckpointMuxerListener::OnEncryptionInfoReady(
+    bool is_initial_encryption_info,
+    FourCC protection_scheme,
+    const std::vector<uint8_t>& default_key_id,
+    const std::vector<uint8_t>& iv,
+    const std::vector<ProtectionSystemSpecificInfo>& key_system_info) {
+  if (listener_) {
+    listener_->OnEncryptionInfoReady(is_initial_encryption_info,
+                                     protection_scheme, default_key_id, iv,
+                                     key_system_info);
+  }
+}
+
+void CheckpointMuxerListener::OnEncryptionStart() {
+  if (listener_)
+    listener_->OnEncryptionStart();
+}
+
+void CheckpointMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
+                                           const StreamInfo& stream_info,
+                                           uint32_t time_scale,
+                                           ContainerType container_type) {
+  time_scale_ = time_scale;
+  segment_template_ = muxer_options.segment_template;
+  init_segment_name_ = muxer_options.output_file_name;
+  segment_start_number_ = muxer_options.segment_start_number;
+  if (listener_)
+    listener_->OnMediaStart(muxer_options, stream_info, time_scale,
+                            container_type);
+}
+
+void CheckpointMuxerListener::OnSampleDurationReady(uint32_t sample_duration) {
+  if (listener_)
+    listener_->OnSampleDurationReady(sample_duration);
+}
+
+void CheckpointMuxerListener::OnMediaEnd(bool has_init_range,
+                                         uint64_t init_range_start,
+                                         uint64_t init_range_end,
+                                         bool has_index_range,
+                                         uint64_t index_range_start,
+                                         uint64_t index_range_end,
+                                         float duration_seconds,
+                                         uint64_t file_size) {
+  // The stream completed; a checkpoint is no longer needed and a leftover
+  // file would wrongly mark the job as interrupted.
+  if (File::GetFileSize(checkpoint_file_name_.c_str()) >= 0 &&
+      !File::Delete(checkpoint_file_name_.c_str())) {
+    LOG(WARNING) << "Failed to delete checkpoint file "
+                 << checkpoint_file_name_;
+  }
+  if (listener_) {
+    listener_->OnMediaEnd(has_init_range, init_range_start, init_range_end,
+                          has_index_range, index_range_start, index_range_end,
+                          duration_seconds, file_size);
+  }
+}
+
+void CheckpointMuxerListener::OnNewSegment(const std::string& segment_name,
+                                           uint64_t start_time,
+                                           uint64_t duration,
+                                           uint64_t segment_file_size) {
+  ++num_completed_segments_;
+  completed_segment_bytes_ += segment_file_size;
+  last_segment_end_time_ = start_time + duration;
+  if (time_scale_ > 0 &&
+      last_segment_end_time_ - last_checkpoint_time_ >=
+          interval_seconds_ * time_scale_) {
+    WriteCheckpoint();
+    last_checkpoint_time_ = last_segment_end_time_;
+  }
+  if (listener_)
+    listener_->OnNewSegment(segment_name, start_time, duration,
+                            segment_file_size);
+}
+
+void CheckpointMuxerListener::WriteCheckpoint() {
+  DCHECK_GT(time_scale_, 0u);
+  MediaInfo checkpoint;
+  // The resume point: segments are cut at stream access points, so the end
+  // of the last completed segment is a time the clip-range fast remux can
+  // restart from exactly.
+  checkpoint.set_media_duration_seconds(
+      static_cast<double>(last_segment_end_time_) / time_scale_);
+  checkpoint.set_segment_start_number(segment_start_number_ +
+                                      num_completed_segments_);
+  checkpoint.set_checkpoint_bytes_written(completed_segment_bytes_);
+  checkpoint.set_segment_template(segment_template_);
+  checkpoint.set_init_segment_name(init_segment_name_);
+  checkpoint.set_reference_time_scale(time_scale_);
+  if (!VodMediaInfoDumpMuxerListener::WriteMediaInfoToFile(
+          checkpoint, checkpoint_file_name_)) {
+    LOG(WARNING) << "Failed to write checkpoint file "
+                 << checkpoint_file_name_;
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,101 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// MuxerListener decorator that periodically writes a resume checkpoint for
+// the stream as a MediaInfo text proto.
+
+#ifndef MEDIA_EVENT_CHECKPOINT_MUXER_LISTENER_H_
+#define MEDIA_EVENT_CHECKPOINT_MUXER_LISTENER_H_
+
+#include <string>
+#include <vector>
+
+#include "packager/base/compiler_specific.h"
+#include "packager/base/memory/scoped_ptr.h"
+#include "packager/media/event/muxer_listener.h"
+
+namespace shaka {
+namespace media {
+
+/// Wraps another MuxerListener (which may be NULL) and, after completed
+/// segments, writes a checkpoint file recording how far the stream has been
+/// durably packaged: the media time and segment number to resume from and
+/// the bytes of completed segments. The checkpoint is a MediaInfo text proto
+/// so the resume path reuses the MediaInfo reading infrastructure. The file
+/// is deleted when the stream completes, so a leftover checkpoint always
+/// marks an interrupted job. Only meaningful for
+/// multi-segment (segment template) output, where completed segments are
+/// independent files that a resumed job can append to.
+class CheckpointMuxerListener : public MuxerListener {
+ public:
+  /// @param checkpoint_file_name is the path the checkpoint is written to.
+  /// @param interval_seconds is the minimum media time between checkpoint
+  ///        writes; a value no larger than the segment duration writes a
+  ///        checkpoint after every segment.
+  /// @param listener is the listener to forward all events to. May be NULL.
+  CheckpointMuxerListener(const std::string& checkpoint_file_name,
+                          double interval_seconds,
+                          scoped_ptr<MuxerListener> listener);
+  ~CheckpointMuxerListener() override;
+
+  /// @name MuxerListener implementation overrides.
+  /// @{
+  void OnEncryptionInfoReady(bool is_initial_encryption_info,
+                             FourCC protection_scheme,
+                             const std::vector<uint8_t>& default_key_id,
+                             const std::vector<uint8_t>& iv,
+                             const std::vector<ProtectionSystemSpecificInfo>&
+                                 key_system_info) override;
+  void OnEncryptionStart() override;
+  void OnMediaStart(const MuxerOptions& muxer_options,
+                    const StreamInfo& stream_info,
+                    uint32_t time_scale,
+                    ContainerType container_type) override;
+  void OnSampleDurationReady(uint32_t sample_duration) override;
+  void OnMediaEnd(bool has_init_range,
+                  uint64_t init_range_start,
+                  uint64_t init_range_end,
+                  bool has_index_range,
+                  uint64_t index_range_start,
+                  uint64_t index_range_end,
+                  float duration_seconds,
+                  uint64_t file_size) override;
+  void OnNewSegment(const std::string& segment_name,
+                    uint64_t start_time,
+                    uint64_t duration,
+                    uint64_t segment_file_size) override;
+  /// @}
+
+ private:
+  // Writes the checkpoint file. Best effort: a failure is logged and the
+  // job continues; only resumability is lost.
+  void WriteCheckpoint();
+
+  std::string checkpoint_file_name_;
+  double interval_seconds_;
+  scoped_ptr<MuxerListener> listener_;
+
+  // Captured in OnMediaStart().
+  uint32_t time_scale_;
+  std::string segment_template_;
+  std::string init_segment_name_;
+  uint32_t segment_start_number_;
+
+  // Progress since OnMediaStart().
+  uint32_t num_completed_segments_;
+  uint64_t completed_segment_bytes_;
+  // End media time, in time_scale_ units, of the last completed segment and
+  // of the last checkpoint written.
+  uint64_t last_segment_end_time_;
+  uint64_t last_checkpoint_time_;
+
+  DISALLOW_COPY_AND_ASSIGN(CheckpointMuxerListener);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_EVENT_CHECKPOINT_MUXER_LISTENER_H_
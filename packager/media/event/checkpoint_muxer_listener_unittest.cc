@@ -0,0 +1,97 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <google/protobuf/text_format.h>
+#include <gtest/gtest.h>
+
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/event/checkpoint_muxer_listener.h"
+#include "packager/media/event/muxer_listener_test_helper.h"
+#include "packager/media/file/file.h"
+#include "packager/mpd/base/media_info.pb.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const uint32_t kReferenceTimeScale = 1000;
+const double kAnyIntervalSeconds = 1.0;
+}  // namespace
+
+class CheckpointMuxerListenerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(base::CreateTemporaryFile(&temp_file_path_));
+    listener_.reset(new CheckpointMuxerListener(temp_file_path_.value(),
+                                                kAnyIntervalSeconds,
+                                                scoped_ptr<MuxerListener>()));
+  }
+
+  void TearDown() override {
+    base::DeleteFile(temp_file_path_, false);
+  }
+
+  void FireOnMediaStart(uint32_t segment_start_number) {
+    MuxerOptions muxer_options;
+    SetDefaultMuxerOptionsValues(&muxer_options);
+    muxer_options.segment_template = "template$Number$.m4s";
+    muxer_options.segment_start_number = segment_start_number;
+    scoped_refptr<StreamInfo> stream_info =
+        CreateVideoStreamInfo(GetDefaultVideoStreamInfoParams());
+    listener_->OnMediaStart(muxer_options, *stream_info, kReferenceTimeScale,
+                            MuxerListener::kContainerMp4);
+  }
+
+  void ReadCheckpoint(MediaInfo* checkpoint) {
+    std::string content;
+    ASSERT_TRUE(File::ReadFileToString(temp_file_path_.value().c_str(),
+                                       &content));
+    ASSERT_TRUE(
+        ::google::protobuf::TextFormat::ParseFromString(content, checkpoint));
+  }
+
+  base::FilePath temp_file_path_;
+  scoped_ptr<CheckpointMuxerListener> listener_;
+};
+
+TEST_F(CheckpointMuxerListenerTest, WritesCheckpointAfterSegment) {
+  FireOnMediaStart(1u);
+  listener_->OnNewSegment("template1.m4s", 0, 2000, 1000);
+  listener_->OnNewSegment("template2.m4s", 2000, 2000, 1100);
+
+  MediaInfo checkpoint;
+  ASSERT_NO_FATAL_FAILURE(ReadCheckpoint(&checkpoint));
+  EXPECT_FLOAT_EQ(4.0f, checkpoint.media_duration_seconds());
+  EXPECT_EQ(3u, checkpoint.segment_start_number());
+  EXPECT_EQ(2100u, checkpoint.checkpoint_bytes_written());
+  EXPECT_EQ("template$Number$.m4s", checkpoint.segment_template());
+}
+
+// A resumed stream continues numbering from its segment_start_number.
+TEST_F(CheckpointMuxerListenerTest, ContinuesSegmentNumbering) {
+  FireOnMediaStart(43u);
+  listener_->OnNewSegment("template43.m4s", 84000, 2000, 1000);
+
+  MediaInfo checkpoint;
+  ASSERT_NO_FATAL_FAILURE(ReadCheckpoint(&checkpoint));
+  EXPECT_FLOAT_EQ(86.0f, checkpoint.media_duration_seconds());
+  EXPECT_EQ(44u, checkpoint.segment_start_number());
+}
+
+TEST_F(CheckpointMuxerListenerTest, DeletesCheckpointOnMediaEnd) {
+  FireOnMediaStart(1u);
+  listener_->OnNewSegment("template1.m4s", 0, 2000, 1000);
+  EXPECT_GE(File::GetFileSize(temp_file_path_.value().c_str()), 0);
+
+  listener_->OnMediaEnd(false, 0, 0, false, 0, 0, 2.0f, 1000);
+  EXPECT_LT(File::GetFileSize(temp_file_path_.value().c_str()), 0);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -13,6 +13,10 @@
       'target_name': 'media_event',
       'type': '<(component)',
       'sources': [
+        'async_muxer_listener.cc',
+        'async_muxer_listener.h',
+        'checkpoint_muxer_listener.cc',
+        'checkpoint_muxer_listener.h',
         'hls_notify_muxer_listener.cc',
         'hls_notify_muxer_listener.h',
         'mpd_notify_muxer_listener.cc',
@@ -20,6 +24,8 @@
         'muxer_listener.h',
         'muxer_listener_internal.cc',
         'muxer_listener_internal.h',
+        'segment_hash_muxer_listener.cc',
+        'segment_hash_muxer_listener.h',
         'vod_media_info_dump_muxer_listener.cc',
         'vod_media_info_dump_muxer_listener.h',
       ],
@@ -48,10 +54,13 @@
       'target_name': 'media_event_unittest',
       'type': '<(gtest_target_type)',
       'sources': [
+        'async_muxer_listener_unittest.cc',
+        'checkpoint_muxer_listener_unittest.cc',
         'hls_notify_muxer_listener_unittest.cc',
         'mpd_notify_muxer_listener_unittest.cc',
         'muxer_listener_test_helper.cc',
         'muxer_listener_test_helper.h',
+        'segment_hash_muxer_listener_unittest.cc',
         'vod_media_info_dump_muxer_listener_unittest.cc',
       ],
       'dependencies': [
@@ -64,6 +73,7 @@
         '../../third_party/protobuf/protobuf.gyp:protobuf_full_do_not_use',
         '../test/media_test.gyp:run_tests_with_atexit_manager',
         'media_event',
+        'mock_muxer_listener',
       ],
     },
   ],
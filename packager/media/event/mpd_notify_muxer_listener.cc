@@ -47,9 +47,9 @@ void MpdNotifyMuxerListener::OnEncryptionInfoReady(
 
   for (const ProtectionSystemSpecificInfo& info : key_system_info) {
     std::string drm_uuid = internal::CreateUUIDString(info.system_id());
-    std::vector<uint8_t> new_pssh = info.CreateBox();
+    scoped_refptr<const PsshBoxBlob> new_pssh = info.CreateBoxShared();
     bool updated = mpd_notifier_->NotifyEncryptionUpdate(
-        notification_id_, drm_uuid, key_id, new_pssh);
+        notification_id_, drm_uuid, key_id, new_pssh->bytes());
     LOG_IF(WARNING, !updated) << "Failed to update encryption info.";
   }
 }
@@ -139,10 +139,10 @@ void MpdNotifyMuxerListener::OnMediaEnd(bool has_init_range,
   uint32_t id;
   // TODO(kqyang): Check return result.
   mpd_notifier_->NotifyNewContainer(*media_info_, &id);
-  for (std::list<SubsegmentInfo>::const_iterator it = subsegments_.begin();
-       it != subsegments_.end(); ++it) {
-    mpd_notifier_->NotifyNewSegment(id, it->start_time, it->duration,
-                                    it->segment_file_size);
+  for (const SubsegmentInfo& subsegment : subsegments_) {
+    mpd_notifier_->NotifyNewSegment(id, subsegment.start_time,
+                                    subsegment.duration,
+                                    subsegment.segment_file_size);
   }
   subsegments_.clear();
   mpd_notifier_->Flush();
@@ -9,7 +9,6 @@
 #ifndef MEDIA_EVENT_MPD_NOTIFY_MUXER_LISTENER_H_
 #define MEDIA_EVENT_MPD_NOTIFY_MUXER_LISTENER_H_
 
-#include <list>
 #include <vector>
 
 #include "packager/base/compiler_specific.h"
@@ -80,8 +79,9 @@ class MpdNotifyMuxerListener : public MuxerListener {
   // Saves all the subsegment information for VOD. This should be used to call
   // MpdNotifier::NotifyNewSegment() after NotifyNewSegment() is called
   // (in OnMediaEnd). This is not used for live because NotifyNewSegment() is
-  // called immediately in OnNewSegment().
-  std::list<SubsegmentInfo> subsegments_;
+  // called immediately in OnNewSegment(). A vector of PODs so a segment event
+  // costs at most an amortized append, with no per-segment allocation.
+  std::vector<SubsegmentInfo> subsegments_;
 
   DISALLOW_COPY_AND_ASSIGN(MpdNotifyMuxerListener);
 };
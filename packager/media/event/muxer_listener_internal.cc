@@ -155,6 +155,8 @@ void SetMediaInfoMuxerOptions(const MuxerOptions& muxer_options,
   } else {
     media_info->set_init_segment_name(muxer_options.output_file_name);
     media_info->set_segment_template(muxer_options.segment_template);
+    if (muxer_options.segment_start_number > 1)
+      media_info->set_segment_start_number(muxer_options.segment_start_number);
   }
 }
 
@@ -237,8 +239,8 @@ void SetContentProtectionFields(
     if (!info.system_id().empty())
       entry->set_uuid(CreateUUIDString(info.system_id()));
 
-    const std::vector<uint8_t> pssh = info.CreateBox();
-    entry->set_pssh(pssh.data(), pssh.size());
+    scoped_refptr<const PsshBoxBlob> pssh = info.CreateBoxShared();
+    entry->set_pssh(pssh->data(), pssh->size());
   }
 }
 
@@ -0,0 +1,118 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/event/segment_hash_muxer_listener.h"
+
+#include "packager/base/logging.h"
+#include "packager/base/sha1.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/media/file/file.h"
+
+namespace shaka {
+namespace media {
+
+SegmentHashMuxerListener::SegmentHashMuxerListener(
+    const std::string& hash_file_name,
+    scoped_ptr<MuxerListener> listener)
+    : hash_file_name_(hash_file_name),
+      listener_(listener.Pass()),
+      hash_file_(NULL) {}
+
+SegmentHashMuxerListener::~SegmentHashMuxerListener() {
+  // OnMediaEnd() is not called if the job fails; do not leave the file open.
+  if (hash_file_)
+    hash_file_->Close();
+}
+
+void SegmentHashMuxerListener::OnEncryptionInfoReady(
+    bool is_initial_encryption_info,
+    FourCC protection_scheme,
+    const std::vector<uint8_t>& default_key_id,
+    const std::vector<uint8_t>& iv,
+    const std::vector<ProtectionSystemSpecificInfo>& key_system_info) {
+  if (listener_) {
+    listener_->OnEncryptionInfoReady(is_initial_encryption_info,
+                                     protection_scheme, default_key_id, iv,
+                                     key_system_info);
+  }
+}
+
+void SegmentHashMuxerListener::OnEncryptionStart() {
+  if (listener_)
+    listener_->OnEncryptionStart();
+}
+
+void SegmentHashMuxerListener::OnMediaStart(const MuxerOptions& muxer_options,
+                                            const StreamInfo& stream_info,
+                                            uint32_t time_scale,
+                                            ContainerType container_type) {
+  hash_file_ = File::Open(hash_file_name_.c_str(), "w");
+  if (!hash_file_)
+    LOG(WARNING) << "Failed to open segment hash file " << hash_file_name_;
+  if (listener_)
+    listener_->OnMediaStart(muxer_options, stream_info, time_scale,
+                            container_type);
+}
+
+void SegmentHashMuxerListener::OnSampleDurationReady(uint32_t sample_duration) {
+  if (listener_)
+    listener_->OnSampleDurationReady(sample_duration);
+}
+
+void SegmentHashMuxerListener::OnMediaEnd(bool has_init_range,
+                                          uint64_t init_range_start,
+                                          uint64_t init_range_end,
+                                          bool has_index_range,
+                                          uint64_t index_range_start,
+                                          uint64_t index_range_end,
+                                          float duration_seconds,
+                                          uint64_t file_size) {
+  if (hash_file_) {
+    if (!hash_file_->Close())
+      LOG(WARNING) << "Failed to close segment hash file " << hash_file_name_;
+    hash_file_ = NULL;
+  }
+  if (listener_) {
+    listener_->OnMediaEnd(has_init_range, init_range_start, init_range_end,
+                          has_index_range, index_range_start, index_range_end,
+                          duration_seconds, file_size);
+  }
+}
+
+void SegmentHashMuxerListener::OnNewSegment(const std::string& segment_name,
+                                            uint64_t start_time,
+                                            uint64_t duration,
+                                            uint64_t segment_file_size) {
+  if (hash_file_)
+    WriteHashLine(segment_name);
+  if (listener_)
+    listener_->OnNewSegment(segment_name, start_time, duration,
+                            segment_file_size);
+}
+
+void SegmentHashMuxerListener::WriteHashLine(const std::string& segment_name) {
+  DCHECK(hash_file_);
+  // The segment was just written, so this read is served from the page cache.
+  std::string content;
+  if (!File::ReadFileToString(segment_name.c_str(), &content)) {
+    LOG(WARNING) << "Failed to read back segment " << segment_name
+                 << " for hashing.";
+    return;
+  }
+  const std::string digest = base::SHA1HashString(content);
+  const std::string line =
+      base::StringToLowerASCII(
+          base::HexEncode(digest.data(), digest.size())) +
+      " " + base::Uint64ToString(content.size()) + " " + segment_name + "\n";
+  if (hash_file_->Write(line.data(), line.size()) !=
+      static_cast<int64_t>(line.size())) {
+    LOG(WARNING) << "Failed to write to segment hash file " << hash_file_name_;
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,90 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// MuxerListener decorator that records a content hash for every completed
+// segment, so a rerun's unchanged segments can be detected and skipped.
+
+#ifndef MEDIA_EVENT_SEGMENT_HASH_MUXER_LISTENER_H_
+#define MEDIA_EVENT_SEGMENT_HASH_MUXER_LISTENER_H_
+
+#include <string>
+#include <vector>
+
+#include "packager/base/compiler_specific.h"
+#include "packager/base/memory/scoped_ptr.h"
+#include "packager/media/event/muxer_listener.h"
+
+namespace shaka {
+namespace media {
+
+class File;
+
+/// Wraps another MuxerListener (which may be NULL) and appends a
+///   "sha1_hex size_bytes segment_name"
+/// line to a hash file for every completed segment. When the output is
+/// deterministic (see --deterministic_output), a repackaging run produces
+/// byte-identical segments for unchanged input, so an uploader can compare
+/// hashes against the previous run and skip segments it already has -
+/// effectively a segment-level output cache. Only meaningful for
+/// multi-segment (segment template) output, where segments are independent
+/// files.
+class SegmentHashMuxerListener : public MuxerListener {
+ public:
+  /// @param hash_file_name is the path the hash lines are written to. The
+  ///        file is recreated on every run.
+  /// @param listener is the listener to forward all events to. May be NULL.
+  SegmentHashMuxerListener(const std::string& hash_file_name,
+                           scoped_ptr<MuxerListener> listener);
+  ~SegmentHashMuxerListener() override;
+
+  /// @name MuxerListener implementation overrides.
+  /// @{
+  void OnEncryptionInfoReady(bool is_initial_encryption_info,
+                             FourCC protection_scheme,
+                             const std::vector<uint8_t>& default_key_id,
+                             const std::vector<uint8_t>& iv,
+                             const std::vector<ProtectionSystemSpecificInfo>&
+                                 key_system_info) override;
+  void OnEncryptionStart() override;
+  void OnMediaStart(const MuxerOptions& muxer_options,
+                    const StreamInfo& stream_info,
+                    uint32_t time_scale,
+                    ContainerType container_type) override;
+  void OnSampleDurationReady(uint32_t sample_duration) override;
+  void OnMediaEnd(bool has_init_range,
+                  uint64_t init_range_start,
+                  uint64_t init_range_end,
+                  bool has_index_range,
+                  uint64_t index_range_start,
+                  uint64_t index_range_end,
+                  float duration_seconds,
+                  uint64_t file_size) override;
+  void OnNewSegment(const std::string& segment_name,
+                    uint64_t start_time,
+                    uint64_t duration,
+                    uint64_t segment_file_size) override;
+  /// @}
+
+ private:
+  // Hashes the completed segment and appends its line to the hash file. Best
+  // effort: a failure is logged and the job continues; the uploader simply
+  // cannot skip that segment.
+  void WriteHashLine(const std::string& segment_name);
+
+  std::string hash_file_name_;
+  scoped_ptr<MuxerListener> listener_;
+
+  // Open between OnMediaStart() and OnMediaEnd(). NULL if the file could not
+  // be opened.
+  File* hash_file_;
+
+  DISALLOW_COPY_AND_ASSIGN(SegmentHashMuxerListener);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_EVENT_SEGMENT_HASH_MUXER_LISTENER_H_
@@ -0,0 +1,96 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/event/muxer_listener_test_helper.h"
+#include "packager/media/event/segment_hash_muxer_listener.h"
+#include "packager/media/file/file.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const uint32_t kAnyTimeScale = 1000;
+}  // namespace
+
+class SegmentHashMuxerListenerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(base::CreateTemporaryFile(&hash_file_path_));
+    listener_.reset(new SegmentHashMuxerListener(hash_file_path_.value(),
+                                                 scoped_ptr<MuxerListener>()));
+  }
+
+  void TearDown() override {
+    base::DeleteFile(hash_file_path_, false);
+    for (size_t i = 0; i < segment_file_paths_.size(); ++i)
+      base::DeleteFile(segment_file_paths_[i], false);
+  }
+
+  void FireOnMediaStart() {
+    MuxerOptions muxer_options;
+    SetDefaultMuxerOptionsValues(&muxer_options);
+    muxer_options.segment_template = "template$Number$.m4s";
+    scoped_refptr<StreamInfo> stream_info =
+        CreateVideoStreamInfo(GetDefaultVideoStreamInfoParams());
+    listener_->OnMediaStart(muxer_options, *stream_info, kAnyTimeScale,
+                            MuxerListener::kContainerMp4);
+  }
+
+  std::string WriteSegmentFile(const std::string& content) {
+    base::FilePath segment_file_path;
+    CHECK(base::CreateTemporaryFile(&segment_file_path));
+    CHECK_EQ(static_cast<int>(content.size()),
+             base::WriteFile(segment_file_path, content.data(),
+                             static_cast<int>(content.size())));
+    segment_file_paths_.push_back(segment_file_path);
+    return segment_file_path.value();
+  }
+
+  std::string ReadHashFile() {
+    std::string content;
+    CHECK(File::ReadFileToString(hash_file_path_.value().c_str(), &content));
+    return content;
+  }
+
+  base::FilePath hash_file_path_;
+  std::vector<base::FilePath> segment_file_paths_;
+  scoped_ptr<SegmentHashMuxerListener> listener_;
+};
+
+TEST_F(SegmentHashMuxerListenerTest, WritesHashLinePerSegment) {
+  FireOnMediaStart();
+  const std::string segment1 = WriteSegmentFile("abc");
+  const std::string segment2 = WriteSegmentFile("defgh");
+  listener_->OnNewSegment(segment1, 0, 2000, 3);
+  listener_->OnNewSegment(segment2, 2000, 2000, 5);
+  listener_->OnMediaEnd(false, 0, 0, false, 0, 0, 4.0f, 8);
+
+  const std::string expected =
+      "a9993e364706816aba3e25717850c26c9cd0d89d 3 " + segment1 + "\n" +
+      "28228736991419251835aacf178c476656d91dd7 5 " + segment2 + "\n";
+  EXPECT_EQ(expected, ReadHashFile());
+}
+
+// An unreadable segment loses its hash line but does not fail the job.
+TEST_F(SegmentHashMuxerListenerTest, SkipsUnreadableSegment) {
+  FireOnMediaStart();
+  const std::string segment = WriteSegmentFile("abc");
+  listener_->OnNewSegment("does_not_exist.m4s", 0, 2000, 100);
+  listener_->OnNewSegment(segment, 2000, 2000, 3);
+  listener_->OnMediaEnd(false, 0, 0, false, 0, 0, 4.0f, 3);
+
+  EXPECT_EQ("a9993e364706816aba3e25717850c26c9cd0d89d 3 " + segment + "\n",
+            ReadHashFile());
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,125 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/file/buffered_write_file.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+
+BufferedWriteFile::BufferedWriteFile(scoped_ptr<File, FileCloser> internal_file,
+                                     uint64_t buffer_size)
+    : File(internal_file->file_name()),
+      internal_file_(internal_file.Pass()),
+      buffer_size_(buffer_size) {
+  DCHECK(internal_file_);
+  DCHECK_GT(buffer_size_, 0u);
+  buffer_.reserve(buffer_size_);
+}
+
+BufferedWriteFile::~BufferedWriteFile() {}
+
+bool BufferedWriteFile::Open() {
+  DCHECK(internal_file_);
+  return internal_file_->Open();
+}
+
+bool BufferedWriteFile::Close() {
+  DCHECK(internal_file_);
+
+  bool result = DrainBuffer();
+  result &= internal_file_.release()->Close();
+  delete this;
+  return result;
+}
+
+int64_t BufferedWriteFile::Read(void* buffer, uint64_t length) {
+  NOTIMPLEMENTED();
+  return -1;
+}
+
+int BufferedWriteFile::GetOsFileDescriptor() {
+  if (!DrainBuffer())
+    return -1;
+  return internal_file_->GetOsFileDescriptor();
+}
+
+void BufferedWriteFile::SetFileSizeHint(uint64_t size_hint) {
+  internal_file_->SetFileSizeHint(size_hint);
+}
+
+int64_t BufferedWriteFile::Write(const void* buffer, uint64_t length) {
+  DCHECK(buffer);
+
+  const uint8_t* data = static_cast<const uint8_t*>(buffer);
+  uint64_t bytes_left = length;
+  while (bytes_left > 0) {
+    if (buffer_.empty() && bytes_left >= buffer_size_) {
+      // Large writes bypass the buffer.
+      const int64_t written = internal_file_->Write(data, bytes_left);
+      if (written < 0)
+        return written;
+      data += written;
+      bytes_left -= written;
+      continue;
+    }
+    const uint64_t to_copy =
+        std::min(bytes_left, buffer_size_ - buffer_.size());
+    buffer_.insert(buffer_.end(), data, data + to_copy);
+    data += to_copy;
+    bytes_left -= to_copy;
+    if (buffer_.size() == buffer_size_ && !DrainBuffer())
+      return -1;
+  }
+  return length;
+}
+
+int64_t BufferedWriteFile::Size() {
+  if (!DrainBuffer())
+    return -1;
+  return internal_file_->Size();
+}
+
+bool BufferedWriteFile::Flush() {
+  return DrainBuffer() && internal_file_->Flush();
+}
+
+bool BufferedWriteFile::Seek(uint64_t position) {
+  if (!DrainBuffer())
+    return false;
+  return internal_file_->Seek(position);
+}
+
+bool BufferedWriteFile::Tell(uint64_t* position) {
+  DCHECK(position);
+
+  if (!internal_file_->Tell(position))
+    return false;
+  *position += buffer_.size();
+  return true;
+}
+
+bool BufferedWriteFile::DrainBuffer() {
+  uint64_t total_bytes_written = 0;
+  while (total_bytes_written < buffer_.size()) {
+    const int64_t written =
+        internal_file_->Write(&buffer_[total_bytes_written],
+                              buffer_.size() - total_bytes_written);
+    if (written < 0)
+      return false;
+    total_bytes_written += written;
+  }
+  buffer_.clear();
+  return true;
+}
+
+}  // namespace media
+}  // namespace shaka
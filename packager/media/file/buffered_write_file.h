@@ -0,0 +1,65 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_BUFFERED_WRITE_FILE_H_
+#define PACKAGER_FILE_BUFFERED_WRITE_FILE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "packager/base/memory/scoped_ptr.h"
+#include "packager/media/file/file.h"
+#include "packager/media/file/file_closer.h"
+
+namespace shaka {
+namespace media {
+
+/// Declaration of class which implements a write-coalescing decorator for
+/// output files. Muxers issue many small writes (per TS packet group, per
+/// EBML element); this class collects them into large blocks before they hit
+/// the wrapped file, so each block crosses the I/O cache lock only once.
+class BufferedWriteFile : public File {
+ public:
+  /// @param internal_file The file to wrap. Must be in a write mode.
+  /// @param buffer_size is the size of the coalescing buffer in bytes.
+  BufferedWriteFile(scoped_ptr<File, FileCloser> internal_file,
+                    uint64_t buffer_size);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int GetOsFileDescriptor() override;
+  void SetFileSizeHint(uint64_t size_hint) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+ protected:
+  ~BufferedWriteFile() override;
+
+  bool Open() override;
+
+ private:
+  // Drains the coalescing buffer into the wrapped file. Unlike Flush(), does
+  // not ask the wrapped file to flush.
+  bool DrainBuffer();
+
+  scoped_ptr<File, FileCloser> internal_file_;
+  const uint64_t buffer_size_;
+  std::vector<uint8_t> buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(BufferedWriteFile);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_BUFFERED_WRITE_FILE_H_
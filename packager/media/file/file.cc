@@ -7,12 +7,25 @@
 #include "packager/media/file/file.h"
 
 #include <gflags/gflags.h>
+
+#if defined(OS_LINUX)
+#include <errno.h>
+#include <sys/sendfile.h>
+#endif
+
 #include <algorithm>
+#include <vector>
 
+#include "packager/base/bind.h"
+#include "packager/base/location.h"
 #include "packager/base/logging.h"
 #include "packager/base/memory/scoped_ptr.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/media/file/buffered_write_file.h"
+#include "packager/media/file/http_file.h"
 #include "packager/media/file/local_file.h"
 #include "packager/media/file/memory_file.h"
+#include "packager/media/file/shared_memory_file.h"
 #include "packager/media/file/threaded_io_file.h"
 #include "packager/media/file/udp_file.h"
 #include "packager/base/strings/string_util.h"
@@ -24,6 +37,12 @@ DEFINE_uint64(io_cache_size,
 DEFINE_uint64(io_block_size,
               2ULL << 20,
               "Size of the block size used for threaded I/O, in bytes.");
+DEFINE_uint64(write_buffer_size,
+              1ULL << 20,
+              "Size of the write-coalescing buffer applied to output files, "
+              "in bytes. Collects the muxers' many small writes into large "
+              "blocks before they reach the I/O cache. Specify 0 to disable "
+              "write coalescing.");
 
 namespace shaka {
 namespace media {
@@ -31,19 +50,58 @@ namespace media {
 const char* kLocalFilePrefix = "file://";
 const char* kUdpFilePrefix = "udp://";
 const char* kMemoryFilePrefix = "memory://";
+const char* kShmFilePrefix = "shm://";
+const char* kHttpFilePrefix = "http://";
+const char* kHttpsFilePrefix = "https://";
 
 namespace {
 
-typedef File* (*FileFactoryFunction)(const char* file_name, const char* mode);
-typedef bool (*FileDeleteFunction)(const char* file_name);
-
 struct SupportedTypeInfo {
   const char* type;
   size_t type_length;
-  const FileFactoryFunction factory_function;
-  const FileDeleteFunction delete_function;
+  const File::FileFactoryFunction factory_function;
+  const File::FileDeleteFunction delete_function;
+};
+
+// Like SupportedTypeInfo, but for protocols added at runtime through
+// File::RegisterProtocol(), which have to own their prefix string.
+struct CustomTypeInfo {
+  std::string type;
+  File::FileFactoryFunction factory_function;
+  File::FileDeleteFunction delete_function;
 };
 
+// Intentionally leaked: files of custom protocols may still be in use at
+// shutdown. NULL until the first registration.
+std::vector<CustomTypeInfo>* g_custom_type_info = NULL;
+
+// Worker tasks backing the asynchronous I/O extensions; see
+// File::ReadAsync and File::WriteAsync.
+void ReadAndRunCallback(File* file,
+                        void* buffer,
+                        uint64_t length,
+                        const File::CompletionCallback& callback) {
+  callback.Run(file->Read(buffer, length));
+}
+
+void WriteAllAndRunCallback(File* file,
+                            const void* buffer,
+                            uint64_t length,
+                            const File::CompletionCallback& callback) {
+  const uint8_t* data = static_cast<const uint8_t*>(buffer);
+  uint64_t total_bytes_written = 0;
+  int64_t bytes_written = 0;
+  while (total_bytes_written < length) {
+    bytes_written = file->Write(data + total_bytes_written,
+                                length - total_bytes_written);
+    if (bytes_written < 0)
+      break;
+    total_bytes_written += bytes_written;
+  }
+  callback.Run(bytes_written < 0 ? bytes_written
+                                 : static_cast<int64_t>(length));
+}
+
 File* CreateLocalFile(const char* file_name, const char* mode) {
   return new LocalFile(file_name, mode);
 }
@@ -60,6 +118,22 @@ File* CreateUdpFile(const char* file_name, const char* mode) {
   return new UdpFile(file_name);
 }
 
+File* CreateHttpFile(const char* file_name, const char* mode) {
+  if (base::strcasecmp(mode, "w")) {
+    NOTIMPLEMENTED() << "HttpFile only supports write (upload) mode.";
+    return NULL;
+  }
+  return new HttpFile(file_name, false);
+}
+
+File* CreateHttpsFile(const char* file_name, const char* mode) {
+  if (base::strcasecmp(mode, "w")) {
+    NOTIMPLEMENTED() << "HttpFile only supports write (upload) mode.";
+    return NULL;
+  }
+  return new HttpFile(file_name, true);
+}
+
 File* CreateMemoryFile(const char* file_name, const char* mode) {
   return new MemoryFile(file_name, mode);
 }
@@ -69,6 +143,14 @@ bool DeleteMemoryFile(const char* file_name) {
   return true;
 }
 
+File* CreateShmFile(const char* file_name, const char* mode) {
+  return new SharedMemoryFile(file_name, mode);
+}
+
+bool DeleteShmFile(const char* file_name) {
+  return SharedMemoryFile::Delete(file_name);
+}
+
 static const SupportedTypeInfo kSupportedTypeInfo[] = {
   {
     kLocalFilePrefix,
@@ -88,6 +170,24 @@ static const SupportedTypeInfo kSupportedTypeInfo[] = {
     &CreateMemoryFile,
     &DeleteMemoryFile
   },
+  {
+    kShmFilePrefix,
+    strlen(kShmFilePrefix),
+    &CreateShmFile,
+    &DeleteShmFile
+  },
+  {
+    kHttpFilePrefix,
+    strlen(kHttpFilePrefix),
+    &CreateHttpFile,
+    NULL
+  },
+  {
+    kHttpsFilePrefix,
+    strlen(kHttpsFilePrefix),
+    &CreateHttpsFile,
+    NULL
+  },
 };
 
 }  // namespace
@@ -96,8 +196,16 @@ File* File::Create(const char* file_name, const char* mode) {
   scoped_ptr<File, FileCloser> internal_file(
       CreateInternalFile(file_name, mode));
 
-  if (!strncmp(file_name, kMemoryFilePrefix, strlen(kMemoryFilePrefix))) {
-    // Disable caching for memory files.
+  if (!strncmp(file_name, kMemoryFilePrefix, strlen(kMemoryFilePrefix)) ||
+      !strncmp(file_name, kShmFilePrefix, strlen(kShmFilePrefix))) {
+    // Disable caching for memory and shared memory files; their writes are
+    // memcpys into RAM already, so the cache would only add a copy.
+    return internal_file.release();
+  }
+
+  if (!strncmp(file_name, kHttpFilePrefix, strlen(kHttpFilePrefix)) ||
+      !strncmp(file_name, kHttpsFilePrefix, strlen(kHttpsFilePrefix))) {
+    // HttpFile already buffers writes and uploads on its own thread.
     return internal_file.release();
   }
 
@@ -109,20 +217,50 @@ File* File::Create(const char* file_name, const char* mode) {
                                 FLAGS_io_cache_size,
                                 FLAGS_io_block_size);
     } else if (!strcmp(mode, "w") || !strcmp(mode, "a")) {
-      return new ThreadedIoFile(internal_file.Pass(),
-                                ThreadedIoFile::kOutputMode,
-                                FLAGS_io_cache_size,
-                                FLAGS_io_block_size);
+      internal_file.reset(new ThreadedIoFile(internal_file.Pass(),
+                                             ThreadedIoFile::kOutputMode,
+                                             FLAGS_io_cache_size,
+                                             FLAGS_io_block_size));
     }
+  } else {
+    DLOG(WARNING) << "Threaded I/O is disabled. Performance may be decreased.";
   }
 
-  // Threaded I/O is disabled.
-  DLOG(WARNING) << "Threaded I/O is disabled. Performance may be decreased.";
+  if (FLAGS_write_buffer_size && (!strcmp(mode, "w") || !strcmp(mode, "a"))) {
+    // Coalesce small writes before they cross the I/O cache lock.
+    return new BufferedWriteFile(internal_file.Pass(),
+                                 FLAGS_write_buffer_size);
+  }
   return internal_file.release();
 }
 
+void File::RegisterProtocol(const std::string& prefix,
+                            FileFactoryFunction factory_function,
+                            FileDeleteFunction delete_function) {
+  DCHECK(!prefix.empty());
+  DCHECK(factory_function);
+
+  if (!g_custom_type_info)
+    g_custom_type_info = new std::vector<CustomTypeInfo>;
+  CustomTypeInfo type_info;
+  type_info.type = prefix;
+  type_info.factory_function = factory_function;
+  type_info.delete_function = delete_function;
+  g_custom_type_info->push_back(type_info);
+}
+
 File* File::CreateInternalFile(const char* file_name, const char* mode) {
   scoped_ptr<File, FileCloser> internal_file;
+  if (g_custom_type_info) {
+    for (size_t i = 0; i < g_custom_type_info->size(); ++i) {
+      const CustomTypeInfo& type_info = (*g_custom_type_info)[i];
+      if (strncmp(type_info.type.c_str(), file_name,
+                  type_info.type.size()) == 0) {
+        return type_info.factory_function(file_name + type_info.type.size(),
+                                          mode);
+      }
+    }
+  }
   for (size_t i = 0; i < arraysize(kSupportedTypeInfo); ++i) {
     const SupportedTypeInfo& type_info = kSupportedTypeInfo[i];
     if (strncmp(type_info.type, file_name, type_info.type_length) == 0) {
@@ -159,7 +297,55 @@ File* File::OpenWithNoBuffering(const char* file_name, const char* mode) {
   return file;
 }
 
+bool File::MapReadOnly(const uint8_t** data, uint64_t* size) {
+  // Mapping is an optional optimization; file types that do not support it
+  // fall back to Read().
+  return false;
+}
+
+void File::ReadAsync(void* buffer,
+                     uint64_t length,
+                     const CompletionCallback& callback) {
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&ReadAndRunCallback, base::Unretained(this), buffer, length,
+                 callback),
+      true /* task_is_slow */);
+}
+
+void File::WriteAsync(const void* buffer,
+                      uint64_t length,
+                      const CompletionCallback& callback) {
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&WriteAllAndRunCallback, base::Unretained(this), buffer,
+                 length, callback),
+      true /* task_is_slow */);
+}
+
+int File::GetOsFileDescriptor() {
+  // Exposing a descriptor is an optional optimization; file types that do
+  // not support it fall back to Read()/Write() based copies.
+  return -1;
+}
+
+void File::SetFileSizeHint(uint64_t size_hint) {
+  // Pre-allocation is an optional optimization; most file types grow as
+  // written.
+}
+
 bool File::Delete(const char* file_name) {
+  if (g_custom_type_info) {
+    for (size_t i = 0; i < g_custom_type_info->size(); ++i) {
+      const CustomTypeInfo& type_info = (*g_custom_type_info)[i];
+      if (strncmp(type_info.type.c_str(), file_name,
+                  type_info.type.size()) == 0) {
+        return type_info.delete_function ?
+            type_info.delete_function(file_name + type_info.type.size()) :
+            false;
+      }
+    }
+  }
   for (size_t i = 0; i < arraysize(kSupportedTypeInfo); ++i) {
     const SupportedTypeInfo& type_info = kSupportedTypeInfo[i];
     if (strncmp(type_info.type, file_name, type_info.type_length) == 0) {
@@ -232,12 +418,89 @@ int64_t File::CopyFile(File* source, File* destination) {
   return CopyFile(source, destination, kWholeFile);
 }
 
+#if defined(OS_LINUX)
+namespace {
+
+// Copies up to |max_copy| bytes from |source| to |destination| inside the
+// kernel with sendfile(), without bouncing through a userspace buffer.
+// Returns the number of bytes copied, a value < 0 on error, or false in
+// |*supported| if the files or the filesystem cannot take this path (in
+// which case the files' logical positions are unchanged).
+int64_t CopyFileZeroCopy(File* source,
+                         File* destination,
+                         int64_t max_copy,
+                         bool* supported) {
+  // sendfile() caps a single call at this count.
+  const int64_t kSendfileMaxChunk = 0x7ffff000;
+
+  *supported = false;
+  uint64_t source_position;
+  uint64_t destination_position;
+  if (!source->Tell(&source_position) ||
+      !destination->Tell(&destination_position)) {
+    return 0;
+  }
+  const int source_fd = source->GetOsFileDescriptor();
+  if (source_fd < 0)
+    return 0;
+  const int destination_fd = destination->GetOsFileDescriptor();
+
+  int64_t bytes_copied = 0;
+  if (destination_fd >= 0) {
+    *supported = true;
+    while (bytes_copied < max_copy) {
+      const size_t count =
+          std::min(kSendfileMaxChunk, max_copy - bytes_copied);
+      const ssize_t result = sendfile(destination_fd, source_fd, NULL, count);
+      if (result < 0) {
+        if (errno == EINTR)
+          continue;
+        if (bytes_copied == 0 && (errno == EINVAL || errno == ENOSYS)) {
+          // The filesystem cannot do this copy; have the caller fall back.
+          *supported = false;
+          break;
+        }
+        LOG(ERROR) << "sendfile() failed, errno: " << errno;
+        return -1;
+      }
+      if (result == 0)
+        break;  // EOF.
+      bytes_copied += result;
+    }
+  }
+
+  // Re-synchronize the logical positions with the descriptor offsets. Also
+  // needed when unsupported, to restore the files for the fallback path.
+  // Skip the destination if its descriptor was never taken (it may not even
+  // support Seek(), e.g. an HTTP output file).
+  if (!source->Seek(source_position + bytes_copied))
+    return -1;
+  if (destination_fd >= 0 &&
+      !destination->Seek(destination_position + bytes_copied)) {
+    return -1;
+  }
+  return bytes_copied;
+}
+
+}  // anonymous namespace
+#endif  // defined(OS_LINUX)
+
 int64_t File::CopyFile(File* source, File* destination, int64_t max_copy) {
   DCHECK(source);
   DCHECK(destination);
   if (max_copy < 0)
     max_copy = std::numeric_limits<int64_t>::max();
 
+#if defined(OS_LINUX)
+  bool zero_copy_supported;
+  const int64_t zero_copy_result =
+      CopyFileZeroCopy(source, destination, max_copy, &zero_copy_supported);
+  if (zero_copy_supported)
+    return zero_copy_result;
+  if (zero_copy_result < 0)
+    return zero_copy_result;
+#endif
+
   const int64_t kBufferSize = 0x40000;  // 256KB.
   scoped_ptr<uint8_t[]> buffer(new uint8_t[kBufferSize]);
   int64_t bytes_copied = 0;
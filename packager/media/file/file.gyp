@@ -13,15 +13,26 @@
       'target_name': 'file',
       'type': '<(component)',
       'sources': [
+        'buffered_write_file.cc',
+        'buffered_write_file.h',
         'file.cc',
         'file.h',
         'file_closer.h',
+        'gzip_file.cc',
+        'gzip_file.h',
+        'http_file.cc',
+        'http_file.h',
         'io_cache.cc',
         'io_cache.h',
+        'io_scheduler.cc',
+        'io_scheduler.h',
         'local_file.cc',
         'local_file.h',
         'memory_file.cc',
         'memory_file.h',
+        'rtp_jitter_buffer.cc',
+        'rtp_jitter_buffer.h',
+        'shared_memory_file.h',
         'threaded_io_file.cc',
         'threaded_io_file.h',
         'udp_file.h',
@@ -29,17 +40,21 @@
       'conditions': [
         ['OS == "win"', {
           'sources': [
+            'shared_memory_file_win.cc',
             'udp_file_win.cc',
           ],
         }, {
           'sources': [
+            'shared_memory_file_posix.cc',
             'udp_file_posix.cc',
           ],
         }],
       ],
       'dependencies': [
         '../../base/base.gyp:base',
+        '../../third_party/curl/curl.gyp:libcurl',
         '../../third_party/gflags/gflags.gyp:gflags',
+        '../../third_party/zlib/zlib.gyp:zlib',
         '../base/media_base.gyp:media_base',
       ],
     },
@@ -49,7 +64,16 @@
       'sources': [
         'file_unittest.cc',
         'io_cache_unittest.cc',
+        'io_scheduler_unittest.cc',
         'memory_file_unittest.cc',
+        'rtp_jitter_buffer_unittest.cc',
+      ],
+      'conditions': [
+        ['OS != "win"', {
+          'sources': [
+            'shared_memory_file_unittest.cc',
+          ],
+        }],
       ],
       'dependencies': [
         '../../testing/gtest.gyp:gtest',
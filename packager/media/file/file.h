@@ -11,6 +11,7 @@
 
 #include <string>
 
+#include "packager/base/callback.h"
 #include "packager/base/macros.h"
 
 namespace shaka {
@@ -23,6 +24,30 @@ const int64_t kWholeFile = -1;
 /// Define an abstract file interface.
 class File {
  public:
+  /// Factory function signature for custom protocols. Receives the file name
+  /// with the protocol prefix stripped, and the open mode.
+  typedef File* (*FileFactoryFunction)(const char* file_name,
+                                       const char* mode);
+  /// Delete function signature for custom protocols. Receives the file name
+  /// with the protocol prefix stripped.
+  typedef bool (*FileDeleteFunction)(const char* file_name);
+
+  /// Register a custom protocol with the file factory, so deployments can
+  /// plug in their own I/O backends (e.g. an object-store client) without
+  /// modifying the built-in table. Once registered, File::Open and
+  /// File::Delete on a name starting with @a prefix dispatch to the given
+  /// functions. Registered protocols take precedence over built-in ones.
+  /// Registration must complete before any file operation; it is not
+  /// thread-safe against concurrent Open or Delete calls.
+  /// @param prefix is the protocol prefix including the separator,
+  ///        e.g. "objstore://".
+  /// @param factory_function creates a File instance for the protocol.
+  /// @param delete_function deletes a file of the protocol. May be NULL if
+  ///        the protocol does not support deletion.
+  static void RegisterProtocol(const std::string& prefix,
+                               FileFactoryFunction factory_function,
+                               FileDeleteFunction delete_function);
+
   /// Open the specified file.
   /// This is a file factory method, it opens a proper file automatically
   /// based on prefix, e.g. "file://" for LocalFile.
@@ -59,6 +84,62 @@ class File {
   ///         Zero on end-of-file, or if 'length' is zero.
   virtual int64_t Read(void* buffer, uint64_t length) = 0;
 
+  /// Map the whole file read-only into memory, if the file type supports it.
+  /// The mapping is independent of the read position and stays valid until
+  /// Close(). Callers must be prepared for this to fail and fall back to
+  /// Read(); the base implementation always fails.
+  /// @param[out] data is set to the start of the mapped bytes on success.
+  /// @param[out] size is set to the size of the mapping on success.
+  /// @return true if the file was mapped, false if mapping is not supported
+  ///         or failed.
+  virtual bool MapReadOnly(const uint8_t** data, uint64_t* size);
+
+  /// Completion callback type for the asynchronous I/O extensions. Receives
+  /// the operation result: the number of bytes read or written, or a value
+  /// < 0 on error.
+  typedef base::Callback<void(int64_t)> CompletionCallback;
+
+  /// Read asynchronously. Returns immediately; the read and @a callback run
+  /// on a worker thread. @a buffer must stay valid and the file must not be
+  /// used again until the callback has run.
+  /// @param[out] buffer points to a block of memory with a size of at least
+  ///             @a length bytes.
+  /// @param length indicates number of bytes to be read.
+  /// @param callback receives the result of the read.
+  virtual void ReadAsync(void* buffer,
+                         uint64_t length,
+                         const CompletionCallback& callback);
+
+  /// Write asynchronously. Returns immediately; the write and @a callback
+  /// run on a worker thread. Unlike Write(), the whole block is written
+  /// before the callback runs, so the callback receives either @a length or
+  /// a value < 0. @a buffer must stay valid and the file must not be used
+  /// again until the callback has run.
+  /// @param buffer points to a block of memory with at least @a length bytes.
+  /// @param length indicates number of bytes to write.
+  /// @param callback receives the result of the write.
+  virtual void WriteAsync(const void* buffer,
+                          uint64_t length,
+                          const CompletionCallback& callback);
+
+  /// Get the platform file descriptor backing this file, with its offset
+  /// synchronized to the logical read/write position, for OS-assisted bulk
+  /// copies (see File::CopyFile). The descriptor stays owned by the File.
+  /// After operating on the descriptor directly, the caller must
+  /// re-synchronize the File with Seek() before using it again. The base
+  /// implementation reports no descriptor.
+  /// @return the file descriptor, or -1 if this file type is not backed by
+  ///         one.
+  virtual int GetOsFileDescriptor();
+
+  /// Hint the expected final size of the file, so the implementation may
+  /// pre-allocate backing storage as one extent instead of growing it write
+  /// by write. Purely best-effort: the hint may be approximate or ignored
+  /// entirely, and it never affects the bytes written or the size reported
+  /// by Size(). The base implementation ignores the hint.
+  /// @param size_hint is the expected final size of the file in bytes.
+  virtual void SetFileSizeHint(uint64_t size_hint);
+
   /// Write block of data.
   /// @param buffer points to a block of memory with at least @a length bytes.
   /// @param length indicates number of bytes to write.
@@ -135,6 +216,7 @@ class File {
   virtual bool Open() = 0;
 
  private:
+  friend class BufferedWriteFile;
   friend class ThreadedIoFile;
 
   // This is a file factory method, it creates a proper file, e.g.
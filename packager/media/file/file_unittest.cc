@@ -6,9 +6,11 @@
 
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
+#include <string.h>
 
 #include "packager/base/files/file_util.h"
 #include "packager/media/file/file.h"
+#include "packager/media/file/memory_file.h"
 
 DECLARE_uint64(io_cache_size);
 DECLARE_uint64(io_block_size);
@@ -105,6 +107,22 @@ TEST_F(LocalFileTest, Write) {
   EXPECT_EQ(data_, read_data);
 }
 
+TEST_F(LocalFileTest, SizeHintDoesNotChangeSize) {
+  // A size hint pre-allocates storage but must not affect the logical file
+  // size or the bytes written, even when it overestimates.
+  File* file = File::Open(local_file_name_.c_str(), "w");
+  ASSERT_TRUE(file != NULL);
+  file->SetFileSizeHint(kDataSize * 10);
+  EXPECT_EQ(kDataSize, file->Write(&data_[0], kDataSize));
+  EXPECT_EQ(kDataSize, file->Size());
+  EXPECT_TRUE(file->Close());
+
+  std::string read_data(kDataSize, 0);
+  ASSERT_EQ(kDataSize,
+            base::ReadFile(test_file_path_, &read_data[0], kDataSize));
+  EXPECT_EQ(data_, read_data);
+}
+
 TEST_F(LocalFileTest, Read_And_Eof) {
   // Write file using file_util API.
   ASSERT_EQ(kDataSize,
@@ -251,6 +269,41 @@ TEST_F(LocalFileTest, DISABLED_WriteSeekOutOfBounds) {
   EXPECT_EQ(kFileSize + 1, file->Size());
 }
 
+namespace {
+
+// Factory for the registration test below. Records the name it received so
+// the test can verify that the protocol prefix has been stripped; the file
+// itself is backed by a MemoryFile.
+std::string* g_custom_file_name = NULL;
+
+File* CreateCustomFile(const char* file_name, const char* mode) {
+  if (!g_custom_file_name)
+    g_custom_file_name = new std::string;
+  *g_custom_file_name = file_name;
+  return new MemoryFile(std::string("custom/") + file_name, mode);
+}
+
+}  // namespace
+
+TEST(CustomProtocolTest, RegisterProtocol) {
+  File::RegisterProtocol("custom://", &CreateCustomFile, NULL);
+
+  const char kData[] = "test data";
+  File* file = File::Open("custom://test_file", "w");
+  ASSERT_TRUE(file != NULL);
+  EXPECT_EQ("test_file", *g_custom_file_name);
+  EXPECT_EQ(static_cast<int64_t>(strlen(kData)),
+            file->Write(kData, strlen(kData)));
+  EXPECT_TRUE(file->Close());
+
+  // The custom file is backed by a memory file; verify the bytes through the
+  // built-in protocol.
+  std::string contents;
+  ASSERT_TRUE(File::ReadFileToString("memory://custom/test_file", &contents));
+  EXPECT_EQ(kData, contents);
+  MemoryFile::DeleteAll();
+}
+
 // This test should only be enabled for filesystems which do not allow seeking
 // past EOF.
 TEST_F(LocalFileTest, DISABLED_ReadSeekOutOfBounds) {
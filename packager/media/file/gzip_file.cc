@@ -0,0 +1,185 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/file/gzip_file.h"
+
+#include <algorithm>
+
+#include "packager/base/lazy_instance.h"
+#include "packager/base/logging.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/third_party/zlib/zlib.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kCompressedBufferSize = 64 * 1024;
+
+// 15 window bits plus 16 selects gzip framing instead of a raw zlib stream.
+const int kWindowBitsGzip = 15 + 16;
+const int kMemLevel = 8;
+
+// Upper bound on pooled idle contexts. Each context holds a compression
+// window of a few hundred KB; one or two are enough for the usual case of an
+// MPD and a couple of playlists being republished.
+const size_t kMaxFreeContexts = 4;
+
+class DeflateContextPool {
+ public:
+  DeflateContextPool() {}
+  ~DeflateContextPool() {
+    // The pool is leaky; this is never run.
+    NOTREACHED();
+  }
+
+  z_stream* Take() {
+    {
+      base::AutoLock auto_lock(lock_);
+      if (!free_contexts_.empty()) {
+        z_stream* context = free_contexts_.back();
+        free_contexts_.pop_back();
+        return context;
+      }
+    }
+    z_stream* context = new z_stream();
+    CHECK_EQ(Z_OK,
+             deflateInit2(context, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                          kWindowBitsGzip, kMemLevel, Z_DEFAULT_STRATEGY));
+    return context;
+  }
+
+  void Put(z_stream* context) {
+    DCHECK(context);
+    if (deflateReset(context) == Z_OK) {
+      base::AutoLock auto_lock(lock_);
+      if (free_contexts_.size() < kMaxFreeContexts) {
+        free_contexts_.push_back(context);
+        return;
+      }
+    }
+    deflateEnd(context);
+    delete context;
+  }
+
+ private:
+  base::Lock lock_;
+  std::vector<z_stream*> free_contexts_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeflateContextPool);
+};
+
+base::LazyInstance<DeflateContextPool>::Leaky g_deflate_context_pool =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+GzipFile::GzipFile(scoped_ptr<File, FileCloser> internal_file)
+    : File(internal_file->file_name()),
+      internal_file_(internal_file.Pass()),
+      context_(g_deflate_context_pool.Get().Take()),
+      compressed_buffer_(kCompressedBufferSize) {
+  DCHECK(internal_file_);
+}
+
+GzipFile::~GzipFile() {}
+
+bool GzipFile::Open() {
+  DCHECK(internal_file_);
+  return internal_file_->Open();
+}
+
+bool GzipFile::Close() {
+  bool result = Deflate(NULL, 0, Z_FINISH);
+  g_deflate_context_pool.Get().Put(context_);
+  context_ = NULL;
+  result &= internal_file_.release()->Close();
+  delete this;
+  return result;
+}
+
+int64_t GzipFile::Read(void* buffer, uint64_t length) {
+  NOTIMPLEMENTED();
+  return -1;
+}
+
+int GzipFile::GetOsFileDescriptor() {
+  NOTIMPLEMENTED();
+  return -1;
+}
+
+int64_t GzipFile::Write(const void* buffer, uint64_t length) {
+  DCHECK(buffer);
+
+  if (!Deflate(buffer, length, Z_NO_FLUSH))
+    return -1;
+  return length;
+}
+
+int64_t GzipFile::Size() {
+  NOTIMPLEMENTED();
+  return -1;
+}
+
+bool GzipFile::Flush() {
+  return Deflate(NULL, 0, Z_SYNC_FLUSH) && internal_file_->Flush();
+}
+
+bool GzipFile::Seek(uint64_t position) {
+  NOTIMPLEMENTED();
+  return false;
+}
+
+bool GzipFile::Tell(uint64_t* position) {
+  NOTIMPLEMENTED();
+  return false;
+}
+
+bool GzipFile::Deflate(const void* buffer, uint64_t length, int flush_mode) {
+  DCHECK(context_);
+
+  const uint8_t* data = static_cast<const uint8_t*>(buffer);
+  do {
+    // z_stream counts input in 32 bits; feed large writes in chunks.
+    const uInt chunk_size = static_cast<uInt>(
+        std::min(length, static_cast<uint64_t>(1) << 30));
+    context_->next_in = const_cast<Bytef*>(data);
+    context_->avail_in = chunk_size;
+    do {
+      context_->next_out = &compressed_buffer_[0];
+      context_->avail_out = compressed_buffer_.size();
+      const int result = deflate(context_, flush_mode);
+      if (result == Z_STREAM_ERROR) {
+        LOG(ERROR) << "deflate failed for file '" << file_name() << "'.";
+        return false;
+      }
+      const size_t compressed_size =
+          compressed_buffer_.size() - context_->avail_out;
+      if (compressed_size > 0 && !WriteCompressed(compressed_size))
+        return false;
+    } while (context_->avail_out == 0);
+    DCHECK_EQ(0u, context_->avail_in);
+    data += chunk_size;
+    length -= chunk_size;
+  } while (length > 0);
+  return true;
+}
+
+bool GzipFile::WriteCompressed(size_t size) {
+  size_t total_bytes_written = 0;
+  while (total_bytes_written < size) {
+    const int64_t written =
+        internal_file_->Write(&compressed_buffer_[total_bytes_written],
+                              size - total_bytes_written);
+    if (written < 0)
+      return false;
+    total_bytes_written += written;
+  }
+  return true;
+}
+
+}  // namespace media
+}  // namespace shaka
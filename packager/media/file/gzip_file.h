@@ -0,0 +1,75 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_GZIP_FILE_H_
+#define PACKAGER_FILE_GZIP_FILE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "packager/base/memory/scoped_ptr.h"
+#include "packager/media/file/file.h"
+#include "packager/media/file/file_closer.h"
+
+typedef struct z_stream_s z_stream;
+
+namespace shaka {
+namespace media {
+
+/// Declaration of class which implements a gzip-compressing decorator for
+/// output files. Bytes written through it are streamed through a zlib
+/// deflate context and the gzip framed result is written to the wrapped
+/// file, so callers publish compressed output without a separate
+/// read-compress-write pass. The deflate contexts, and the compression
+/// windows they hold, are recycled through a small process-wide pool, so
+/// periodically republished outputs (e.g. live manifests) do not set up a
+/// new context on every update.
+class GzipFile : public File {
+ public:
+  /// @param internal_file The file to wrap. Must be in a write mode.
+  explicit GzipFile(scoped_ptr<File, FileCloser> internal_file);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int GetOsFileDescriptor() override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+ protected:
+  ~GzipFile() override;
+
+  bool Open() override;
+
+ private:
+  // Runs |buffer| through the deflate context with |flush_mode| and writes
+  // whatever compressed bytes become available to the wrapped file. |buffer|
+  // may be NULL iff |length| is 0, e.g. when flushing or finishing.
+  bool Deflate(const void* buffer, uint64_t length, int flush_mode);
+
+  // Writes the first |size| bytes of |compressed_buffer_| to the wrapped
+  // file, handling partial writes.
+  bool WriteCompressed(size_t size);
+
+  scoped_ptr<File, FileCloser> internal_file_;
+  // Owned by the process-wide context pool; taken on construction and
+  // returned on Close().
+  z_stream* context_;
+  std::vector<uint8_t> compressed_buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(GzipFile);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_GZIP_FILE_H_
@@ -0,0 +1,305 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/file/http_file.h"
+
+#include <curl/curl.h>
+#include <gflags/gflags.h>
+
+#include "packager/base/bind.h"
+#include "packager/base/lazy_instance.h"
+#include "packager/base/location.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/threading/worker_pool.h"
+
+DEFINE_uint64(http_file_cache_size,
+              8ULL << 20,
+              "Size of the buffer between the writer and the upload thread "
+              "of an HTTP output file, in bytes. The writer blocks when the "
+              "buffer is full.");
+DEFINE_uint64(max_concurrent_http_uploads,
+              8,
+              "Maximum number of HTTP uploads running at once. Additional "
+              "uploads buffer their data until a slot frees up.");
+DEFINE_uint64(http_connect_timeout_ms,
+              10000,
+              "Bound on name resolution plus TCP/TLS connect for an HTTP "
+              "upload, in milliseconds. 0 uses curl's default. An "
+              "unreachable origin fails fast instead of holding its upload "
+              "slot indefinitely.");
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+const char kUserAgentString[] = "shaka-packager-http_file/1.0";
+
+// How long resolved names stay valid in the shared DNS cache; see
+// CurlShareManager below. curl's default is 60 seconds.
+const long kDnsCacheTimeoutSeconds = 300;
+
+class LibCurlInitializer {
+ public:
+  LibCurlInitializer() : initialized_(false) {
+    base::AutoLock lock(lock_);
+    if (!initialized_) {
+      curl_global_init(CURL_GLOBAL_DEFAULT);
+      initialized_ = true;
+    }
+  }
+
+  ~LibCurlInitializer() {
+    base::AutoLock lock(lock_);
+    if (initialized_) {
+      curl_global_cleanup();
+      initialized_ = false;
+    }
+  }
+
+ private:
+  base::Lock lock_;
+  bool initialized_;
+
+  DISALLOW_COPY_AND_ASSIGN(LibCurlInitializer);
+};
+
+// Process-wide curl share handle. Each upload runs on a fresh easy handle,
+// which would otherwise resolve the origin's name and negotiate a new TLS
+// session from scratch; sharing the DNS cache and TLS sessions means only
+// the first segment to an origin pays those costs. Resolution itself is
+// still synchronous within curl, but it happens on the upload thread, never
+// on the thread producing media data.
+class CurlShareManager {
+ public:
+  CurlShareManager() : share_(curl_share_init()) {
+    if (!share_) {
+      LOG(WARNING) << "curl_share_init() failed; DNS results and TLS "
+                      "sessions will not be reused across uploads.";
+      return;
+    }
+    curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &CurlShareManager::Lock);
+    curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &CurlShareManager::Unlock);
+    curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  }
+
+  CURLSH* share() { return share_; }
+
+ private:
+  static void Lock(CURL* handle,
+                   curl_lock_data data,
+                   curl_lock_access access,
+                   void* userp) {
+    static_cast<CurlShareManager*>(userp)->locks_[data].Acquire();
+  }
+
+  static void Unlock(CURL* handle, curl_lock_data data, void* userp) {
+    static_cast<CurlShareManager*>(userp)->locks_[data].Release();
+  }
+
+  CURLSH* share_;
+  base::Lock locks_[CURL_LOCK_DATA_LAST];
+
+  DISALLOW_COPY_AND_ASSIGN(CurlShareManager);
+};
+
+// Leaky: uploads may still be in flight at shutdown.
+base::LazyInstance<CurlShareManager>::Leaky g_curl_share =
+    LAZY_INSTANCE_INITIALIZER;
+
+// Bounds the number of uploads running at once across all HttpFile
+// instances, so a burst of short segments does not open an unbounded number
+// of connections to the origin. Uploads waiting for a slot keep buffering
+// written bytes in their cache in the meantime.
+class UploadSlotPool {
+ public:
+  UploadSlotPool() : slot_free_event_(false, false), in_flight_(0) {}
+
+  void Acquire() {
+    base::AutoLock lock(lock_);
+    while (in_flight_ >= FLAGS_max_concurrent_http_uploads) {
+      base::AutoUnlock unlock(lock_);
+      slot_free_event_.Wait();
+    }
+    ++in_flight_;
+  }
+
+  void Release() {
+    base::AutoLock lock(lock_);
+    DCHECK_GT(in_flight_, 0u);
+    --in_flight_;
+    slot_free_event_.Signal();
+  }
+
+ private:
+  base::Lock lock_;
+  base::WaitableEvent slot_free_event_;
+  uint64_t in_flight_;
+
+  DISALLOW_COPY_AND_ASSIGN(UploadSlotPool);
+};
+
+UploadSlotPool* GetUploadSlotPool() {
+  // Intentionally leaked: uploads may still be in flight at shutdown.
+  static UploadSlotPool* const pool = new UploadSlotPool;
+  return pool;
+}
+
+}  // anonymous namespace
+
+HttpFile::HttpFile(const char* file_name, bool https)
+    : File(file_name),
+      url_((https ? "https://" : "http://") + std::string(file_name)),
+      cache_(FLAGS_http_file_cache_size),
+      position_(0),
+      upload_failed_(0),
+      task_exit_event_(false, false) {}
+
+HttpFile::~HttpFile() {}
+
+bool HttpFile::Open() {
+  VLOG(1) << "Opening " << url_ << " for upload.";
+
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&HttpFile::UploadTask, base::Unretained(this)),
+      true /* task_is_slow */);
+  return true;
+}
+
+bool HttpFile::Close() {
+  cache_.Close();
+  task_exit_event_.Wait();
+
+  bool result = !base::subtle::NoBarrier_Load(&upload_failed_);
+  delete this;
+  return result;
+}
+
+int64_t HttpFile::Read(void* buffer, uint64_t length) {
+  NOTIMPLEMENTED();
+  return -1;
+}
+
+int64_t HttpFile::Write(const void* buffer, uint64_t length) {
+  DCHECK(buffer);
+
+  if (base::subtle::NoBarrier_Load(&upload_failed_))
+    return -1;
+
+  uint64_t bytes_written = cache_.Write(buffer, length);
+  if (bytes_written == 0) {
+    // The upload thread closed the cache because the upload failed.
+    return -1;
+  }
+  position_ += bytes_written;
+  return bytes_written;
+}
+
+int64_t HttpFile::Size() {
+  return position_;
+}
+
+bool HttpFile::Flush() {
+  // All written bytes have been handed to the upload thread; wait for it to
+  // drain them onto the wire.
+  cache_.WaitUntilEmptyOrClosed();
+  return !base::subtle::NoBarrier_Load(&upload_failed_);
+}
+
+bool HttpFile::Seek(uint64_t position) {
+  NOTIMPLEMENTED();
+  return false;
+}
+
+bool HttpFile::Tell(uint64_t* position) {
+  DCHECK(position);
+
+  *position = position_;
+  return true;
+}
+
+void HttpFile::UploadTask() {
+  static LibCurlInitializer lib_curl_initializer;
+
+  GetUploadSlotPool()->Acquire();
+
+  CURL* curl = curl_easy_init();
+  if (!curl) {
+    LOG(ERROR) << "curl_easy_init() failed.";
+    base::subtle::NoBarrier_Store(&upload_failed_, 1);
+    cache_.Close();
+    GetUploadSlotPool()->Release();
+    task_exit_event_.Signal();
+    return;
+  }
+
+  // No CURLOPT_INFILESIZE is set, so the body is sent with chunked transfer
+  // encoding. Suppress the "Expect: 100-continue" handshake; it adds a round
+  // trip before the first byte of every segment.
+  curl_slist* headers = curl_slist_append(NULL, "Expect:");
+
+  curl_easy_setopt(curl, CURLOPT_URL, url_.c_str());
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, kUserAgentString);
+  curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+  curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  // Uploads run on worker pool threads; curl's signal-based resolver timeout
+  // uses SIGALRM and is not thread-safe, so disable signals and bound the
+  // connect phase explicitly.
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  if (FLAGS_http_connect_timeout_ms > 0) {
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS,
+                     static_cast<long>(FLAGS_http_connect_timeout_ms));
+  }
+  curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, kDnsCacheTimeoutSeconds);
+  if (g_curl_share.Get().share())
+    curl_easy_setopt(curl, CURLOPT_SHARE, g_curl_share.Get().share());
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  curl_easy_setopt(curl, CURLOPT_READFUNCTION, CurlReadCallback);
+  curl_easy_setopt(curl, CURLOPT_READDATA, this);
+
+  CURLcode res = curl_easy_perform(curl);
+  if (res != CURLE_OK) {
+    std::string error_message = base::StringPrintf(
+        "Upload to %s failed: %s.", url_.c_str(), curl_easy_strerror(res));
+    if (res == CURLE_HTTP_RETURNED_ERROR) {
+      long response_code = 0;
+      curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+      error_message +=
+          base::StringPrintf(" Response code: %ld.", response_code);
+    }
+    LOG(ERROR) << error_message;
+
+    base::subtle::NoBarrier_Store(&upload_failed_, 1);
+    // Unblock a writer stuck in Write() on a full cache.
+    cache_.Close();
+  }
+
+  curl_slist_free_all(headers);
+  curl_easy_cleanup(curl);
+  GetUploadSlotPool()->Release();
+  task_exit_event_.Signal();
+}
+
+// static
+size_t HttpFile::CurlReadCallback(char* buffer,
+                                  size_t size,
+                                  size_t nmemb,
+                                  void* user_data) {
+  HttpFile* file = static_cast<HttpFile*>(user_data);
+  // Returns 0 once the cache has been closed and drained, which terminates
+  // the chunked body.
+  return file->cache_.Read(buffer, size * nmemb);
+}
+
+}  // namespace media
+}  // namespace shaka
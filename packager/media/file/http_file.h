@@ -0,0 +1,74 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_HTTP_FILE_H_
+#define PACKAGER_FILE_HTTP_FILE_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "packager/base/atomicops.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/media/file/file.h"
+#include "packager/media/file/io_cache.h"
+
+namespace shaka {
+namespace media {
+
+/// Implements HttpFile, which uploads data written to it to an HTTP(S)
+/// server using chunked transfer encoding. The upload runs on a worker
+/// thread and streams bytes as they are written, so a segment starts
+/// arriving at the origin while the muxer is still producing it. Only
+/// write mode is supported.
+class HttpFile : public File {
+ public:
+  /// @param file_name is the URL of the resource, without the scheme prefix.
+  /// @param https is true to upload over TLS, false for plain HTTP.
+  HttpFile(const char* file_name, bool https);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+ protected:
+  ~HttpFile() override;
+
+  bool Open() override;
+
+ private:
+  // Runs on a worker thread: acquires an upload slot, then performs the
+  // upload, pulling the bytes written to this file out of |cache_|.
+  void UploadTask();
+
+  // libcurl read callback; supplies the next piece of the request body.
+  static size_t CurlReadCallback(char* buffer,
+                                 size_t size,
+                                 size_t nmemb,
+                                 void* user_data);
+
+  const std::string url_;
+  IoCache cache_;
+  uint64_t position_;
+  // Nonzero if the upload failed. Set by the upload thread only.
+  base::subtle::Atomic32 upload_failed_;
+  // Signalled when the upload task exits.
+  base::WaitableEvent task_exit_event_;
+
+  DISALLOW_COPY_AND_ASSIGN(HttpFile);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_HTTP_FILE_H_
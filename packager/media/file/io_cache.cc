@@ -11,6 +11,8 @@
 #include <algorithm>
 
 #include "packager/base/logging.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/media/base/pipeline_stats.h"
 
 namespace shaka {
 
@@ -18,9 +20,24 @@ using base::AutoLock;
 using base::AutoUnlock;
 
 namespace media {
+namespace {
 
-IoCache::IoCache(uint64_t cache_size)
+// Number of spin probes before each one is followed by a processor yield,
+// mirroring the spin behavior of SpscRingQueue.
+const uint32_t kSpinsBeforeYield = 1000;
+
+}  // namespace
+
+IoCache::IoCache(uint64_t cache_size) : IoCache(cache_size, 1, 1) {}
+
+IoCache::IoCache(uint64_t cache_size,
+                 uint64_t low_watermark,
+                 uint64_t high_watermark)
     : cache_size_(cache_size),
+      low_watermark_(
+          std::max<uint64_t>(1, std::min(low_watermark, cache_size))),
+      high_watermark_(
+          std::max<uint64_t>(1, std::min(high_watermark, cache_size))),
       read_event_(false, false),
       write_event_(false, false),
       // Make the buffer one byte larger than the cache so that when the
@@ -29,15 +46,23 @@ IoCache::IoCache(uint64_t cache_size)
       end_ptr_(&circular_buffer_[0] + cache_size + 1),
       r_ptr_(circular_buffer_.data()),
       w_ptr_(circular_buffer_.data()),
-      closed_(false) {}
+      closed_(false),
+      spin_count_(0),
+      cached_bytes_hint_(0) {
+  pipeline_stats::RecordMemoryAllocated(pipeline_stats::kMemoryIoCache,
+                                        circular_buffer_.size());
+}
 
 IoCache::~IoCache() {
   Close();
+  pipeline_stats::RecordMemoryFreed(pipeline_stats::kMemoryIoCache,
+                                    circular_buffer_.size());
 }
 
 uint64_t IoCache::Read(void* buffer, uint64_t size) {
   DCHECK(buffer);
 
+  SpinUntilDataAvailable();
   AutoLock lock(lock_);
   while (!closed_ && (BytesCachedInternal() == 0)) {
     AutoUnlock unlock(lock_);
@@ -59,7 +84,7 @@ uint64_t IoCache::Read(void* buffer, uint64_t size) {
     r_ptr_ += second_chunk_size;
     DCHECK_GT(end_ptr_, r_ptr_);
   }
-  read_event_.Signal();
+  SignalReadEventIfNeeded();
   return size;
 }
 
@@ -69,6 +94,7 @@ uint64_t IoCache::Write(const void* buffer, uint64_t size) {
   const uint8_t* r_ptr(static_cast<const uint8_t*>(buffer));
   uint64_t bytes_left(size);
   while (bytes_left) {
+    SpinUntilSpaceAvailable();
     AutoLock lock(lock_);
     while (!closed_ && (BytesFreeInternal() == 0)) {
       AutoUnlock unlock(lock_);
@@ -94,14 +120,73 @@ uint64_t IoCache::Write(const void* buffer, uint64_t size) {
       r_ptr += second_chunk_size;
     }
     bytes_left -= write_size;
-    write_event_.Signal();
+    SignalWriteEventIfNeeded();
   }
   return size;
 }
 
+uint64_t IoCache::AcquireReadRegion(const uint8_t** data) {
+  DCHECK(data);
+
+  SpinUntilDataAvailable();
+  AutoLock lock(lock_);
+  while (!closed_ && (BytesCachedInternal() == 0)) {
+    AutoUnlock unlock(lock_);
+    write_event_.Wait();
+  }
+
+  uint64_t region_size(std::min(BytesCachedInternal(),
+                                static_cast<uint64_t>(end_ptr_ - r_ptr_)));
+  *data = region_size ? r_ptr_ : NULL;
+  return region_size;
+}
+
+void IoCache::CommitRead(uint64_t size) {
+  AutoLock lock(lock_);
+  DCHECK_LE(size, BytesCachedInternal());
+  DCHECK_LE(size, static_cast<uint64_t>(end_ptr_ - r_ptr_));
+
+  r_ptr_ += size;
+  if (r_ptr_ == end_ptr_)
+    r_ptr_ = &circular_buffer_[0];
+  SignalReadEventIfNeeded();
+}
+
+uint64_t IoCache::AcquireWriteRegion(uint8_t** data) {
+  DCHECK(data);
+
+  SpinUntilSpaceAvailable();
+  AutoLock lock(lock_);
+  while (!closed_ && (BytesFreeInternal() == 0)) {
+    AutoUnlock unlock(lock_);
+    read_event_.Wait();
+  }
+  if (closed_) {
+    *data = NULL;
+    return 0;
+  }
+
+  uint64_t region_size(std::min(BytesFreeInternal(),
+                                static_cast<uint64_t>(end_ptr_ - w_ptr_)));
+  *data = w_ptr_;
+  return region_size;
+}
+
+void IoCache::CommitWrite(uint64_t size) {
+  AutoLock lock(lock_);
+  DCHECK_LE(size, BytesFreeInternal());
+  DCHECK_LE(size, static_cast<uint64_t>(end_ptr_ - w_ptr_));
+
+  w_ptr_ += size;
+  if (w_ptr_ == end_ptr_)
+    w_ptr_ = &circular_buffer_[0];
+  SignalWriteEventIfNeeded();
+}
+
 void IoCache::Clear() {
   AutoLock lock(lock_);
   r_ptr_ = w_ptr_ = circular_buffer_.data();
+  UpdateCachedBytesHint();
   // Let any writers know that there is room in the cache.
   read_event_.Signal();
 }
@@ -117,6 +202,7 @@ void IoCache::Reopen() {
   AutoLock lock(lock_);
   CHECK(closed_);
   r_ptr_ = w_ptr_ = circular_buffer_.data();
+  UpdateCachedBytesHint();
   closed_ = false;
   read_event_.Reset();
   write_event_.Reset();
@@ -142,6 +228,47 @@ uint64_t IoCache::BytesFreeInternal() {
   return cache_size_ - BytesCachedInternal();
 }
 
+void IoCache::SpinUntilDataAvailable() {
+  for (uint32_t spin = 0; spin < spin_count_; ++spin) {
+    if (base::subtle::Acquire_Load(&cached_bytes_hint_) != 0)
+      return;
+    if (spin >= kSpinsBeforeYield)
+      base::PlatformThread::YieldCurrentThread();
+  }
+}
+
+void IoCache::SpinUntilSpaceAvailable() {
+  for (uint32_t spin = 0; spin < spin_count_; ++spin) {
+    if (static_cast<uint64_t>(base::subtle::Acquire_Load(
+            &cached_bytes_hint_)) < cache_size_) {
+      return;
+    }
+    if (spin >= kSpinsBeforeYield)
+      base::PlatformThread::YieldCurrentThread();
+  }
+}
+
+void IoCache::UpdateCachedBytesHint() {
+  base::subtle::Release_Store(&cached_bytes_hint_, BytesCachedInternal());
+}
+
+void IoCache::SignalReadEventIfNeeded() {
+  UpdateCachedBytesHint();
+  // Wake a blocked writer once a burst worth of space is free. Also signal
+  // when the cache drains completely, both so that small caches make
+  // progress and because WaitUntilEmptyOrClosed() waits on this event.
+  if (BytesFreeInternal() >= low_watermark_ || BytesCachedInternal() == 0)
+    read_event_.Signal();
+}
+
+void IoCache::SignalWriteEventIfNeeded() {
+  UpdateCachedBytesHint();
+  // Wake a blocked reader once a burst worth of data is cached. A full cache
+  // always qualifies because the watermark is clamped to the cache size.
+  if (BytesCachedInternal() >= high_watermark_)
+    write_event_.Signal();
+}
+
 void IoCache::WaitUntilEmptyOrClosed() {
   AutoLock lock(lock_);
   while (!closed_ && BytesCachedInternal()) {
@@ -9,6 +9,7 @@
 
 #include <stdint.h>
 #include <vector>
+#include "packager/base/atomicops.h"
 #include "packager/base/macros.h"
 #include "packager/base/synchronization/lock.h"
 #include "packager/base/synchronization/waitable_event.h"
@@ -20,6 +21,19 @@ namespace media {
 class IoCache {
  public:
   explicit IoCache(uint64_t cache_size);
+
+  /// Create a cache with explicit wakeup watermarks, for high-rate sources
+  /// where waking the other side on every operation costs too much.
+  /// @param cache_size is the size of the cache in bytes.
+  /// @param low_watermark is the number of free bytes at which a blocked
+  ///        writer is woken. 1 wakes the writer on every read.
+  /// @param high_watermark is the number of cached bytes at which a blocked
+  ///        reader is woken. 1 wakes the reader on every write.
+  ///        Both watermarks are clamped to the cache size; Close() always
+  ///        wakes both sides regardless of the watermarks.
+  IoCache(uint64_t cache_size,
+          uint64_t low_watermark,
+          uint64_t high_watermark);
   ~IoCache();
 
   /// Read data from the cache. This function may block until there is data in
@@ -39,6 +53,36 @@ class IoCache {
   ///         closed.
   uint64_t Write(const void* buffer, uint64_t size);
 
+  /// Get direct access to a contiguous region of cached data without
+  /// copying. This function may block until there is data in the cache.
+  /// The region stays valid until the matching CommitRead(); only the
+  /// reading thread may use this function.
+  /// @param[out] data is set to the start of the region, or NULL if the
+  ///             cache has been closed and is empty.
+  /// @return the size of the region, or 0 if the call unblocked because the
+  ///         cache has been closed and is empty.
+  uint64_t AcquireReadRegion(const uint8_t** data);
+
+  /// Release the first @a size bytes of the region returned by
+  /// AcquireReadRegion() back to the cache.
+  /// @param size must not be larger than the acquired region.
+  void CommitRead(uint64_t size);
+
+  /// Get direct access to a contiguous region of free space in the cache
+  /// without copying. This function may block until there is room in the
+  /// cache. The region stays valid until the matching CommitWrite(); only
+  /// the writing thread may use this function.
+  /// @param[out] data is set to the start of the region, or NULL if the
+  ///             cache has been closed.
+  /// @return the size of the region, or 0 if the call unblocked because the
+  ///         cache has been closed.
+  uint64_t AcquireWriteRegion(uint8_t** data);
+
+  /// Publish the first @a size bytes of the region returned by
+  /// AcquireWriteRegion() as cached data.
+  /// @param size must not be larger than the acquired region.
+  void CommitWrite(uint64_t size);
+
   /// Empties the cache.
   void Clear();
 
@@ -63,11 +107,38 @@ class IoCache {
   /// Waits until the cache is empty or has been closed.
   void WaitUntilEmptyOrClosed();
 
+  /// Set the number of bounded spin probes a blocked read or write performs
+  /// before parking on an event. At high transfer rates the other side
+  /// usually catches up within microseconds, and spinning briefly avoids a
+  /// futex sleep/wake round trip per stall; spinning burns the waiting core,
+  /// so reserve it for hot caches. The default of 0 parks immediately.
+  void set_spin_count(uint32_t spin_count) { spin_count_ = spin_count; }
+
  private:
   uint64_t BytesCachedInternal();
   uint64_t BytesFreeInternal();
 
+  // Wake a blocked writer if enough space has been freed, per the low
+  // watermark. Must be called with lock_ held.
+  void SignalReadEventIfNeeded();
+  // Wake a blocked reader if enough data has accumulated, per the high
+  // watermark. Must be called with lock_ held.
+  void SignalWriteEventIfNeeded();
+
+  // Bounded spin (per spin_count_) until the cache looks non-empty / has
+  // free space, probing |cached_bytes_hint_| without taking the lock. Called
+  // before the blocking wait loops; purely an optimization, the loops remain
+  // authoritative.
+  void SpinUntilDataAvailable();
+  void SpinUntilSpaceAvailable();
+
+  // Refresh |cached_bytes_hint_|. Must be called with lock_ held after any
+  // change to the cached byte count.
+  void UpdateCachedBytesHint();
+
   const uint64_t cache_size_;
+  const uint64_t low_watermark_;
+  const uint64_t high_watermark_;
   base::Lock lock_;
   base::WaitableEvent read_event_;
   base::WaitableEvent write_event_;
@@ -76,6 +147,9 @@ class IoCache {
   uint8_t* r_ptr_;
   uint8_t* w_ptr_;
   bool closed_;
+  uint32_t spin_count_;
+  // Lock-free mirror of BytesCachedInternal() for the spin probes.
+  base::subtle::AtomicWord cached_bytes_hint_;
 
   DISALLOW_COPY_AND_ASSIGN(IoCache);
 };
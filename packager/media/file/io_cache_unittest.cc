@@ -246,6 +246,101 @@ TEST_F(IoCacheTest, SingleLargeWrite) {
   EXPECT_EQ(write_buffer, read_buffer);
 }
 
+TEST_F(IoCacheTest, WriteRegion) {
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(kBlockSize, &write_buffer);
+
+  uint8_t* region(NULL);
+  uint64_t region_size(cache_->AcquireWriteRegion(&region));
+  ASSERT_TRUE(region);
+  ASSERT_GE(region_size, kBlockSize);
+  memcpy(region, write_buffer.data(), kBlockSize);
+  cache_->CommitWrite(kBlockSize);
+  EXPECT_EQ(kBlockSize, cache_->BytesCached());
+
+  std::vector<uint8_t> read_buffer(kBlockSize);
+  EXPECT_EQ(kBlockSize, cache_->Read(read_buffer.data(), kBlockSize));
+  EXPECT_EQ(write_buffer, read_buffer);
+}
+
+TEST_F(IoCacheTest, ReadRegion) {
+  const uint64_t kNumWrites(kCacheSize * 10 / kBlockSize);
+
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(kBlockSize, &write_buffer);
+  WriteToCacheThreaded(write_buffer, kNumWrites, 0, true);
+
+  std::vector<uint8_t> read_data;
+  while (true) {
+    const uint8_t* region(NULL);
+    uint64_t region_size(cache_->AcquireReadRegion(&region));
+    if (!region_size)
+      break;
+    read_data.insert(read_data.end(), region, region + region_size);
+    cache_->CommitRead(region_size);
+  }
+
+  std::vector<uint8_t> verify_buffer;
+  for (uint64_t idx = 0; idx < kNumWrites; ++idx) {
+    verify_buffer.insert(verify_buffer.end(),
+                         write_buffer.begin(),
+                         write_buffer.end());
+  }
+  EXPECT_EQ(verify_buffer, read_data);
+}
+
+TEST_F(IoCacheTest, Watermarks) {
+  const uint64_t kNumWrites(kCacheSize * 10 / kBlockSize);
+
+  cache_.reset(new IoCache(kCacheSize, kCacheSize / 2, kCacheSize / 2));
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(kBlockSize, &write_buffer);
+  WriteToCacheThreaded(write_buffer, kNumWrites, 0, true);
+
+  std::vector<uint8_t> verify_buffer;
+  for (uint64_t idx = 0; idx < kNumWrites; ++idx) {
+    verify_buffer.insert(verify_buffer.end(),
+                         write_buffer.begin(),
+                         write_buffer.end());
+  }
+  std::vector<uint8_t> read_data;
+  while (read_data.size() < verify_buffer.size()) {
+    std::vector<uint8_t> read_buffer(kBlockSize);
+    uint64_t bytes_read = cache_->Read(read_buffer.data(), kBlockSize);
+    ASSERT_NE(0U, bytes_read);
+    read_data.insert(read_data.end(),
+                     read_buffer.begin(),
+                     read_buffer.begin() + bytes_read);
+  }
+  EXPECT_EQ(verify_buffer, read_data);
+}
+
+TEST_F(IoCacheTest, SpinCount) {
+  const uint64_t kNumWrites(kCacheSize * 10 / kBlockSize);
+
+  cache_->set_spin_count(100);
+  std::vector<uint8_t> write_buffer;
+  GenerateTestBuffer(kBlockSize, &write_buffer);
+  WriteToCacheThreaded(write_buffer, kNumWrites, 0, true);
+
+  std::vector<uint8_t> verify_buffer;
+  for (uint64_t idx = 0; idx < kNumWrites; ++idx) {
+    verify_buffer.insert(verify_buffer.end(),
+                         write_buffer.begin(),
+                         write_buffer.end());
+  }
+  std::vector<uint8_t> read_data;
+  while (read_data.size() < verify_buffer.size()) {
+    std::vector<uint8_t> read_buffer(kBlockSize);
+    uint64_t bytes_read = cache_->Read(read_buffer.data(), kBlockSize);
+    ASSERT_NE(0U, bytes_read);
+    read_data.insert(read_data.end(),
+                     read_buffer.begin(),
+                     read_buffer.begin() + bytes_read);
+  }
+  EXPECT_EQ(verify_buffer, read_data);
+}
+
 TEST_F(IoCacheTest, LargeRead) {
   const uint64_t kNumWrites(kCacheSize * 10 / kBlockSize);
 
@@ -0,0 +1,107 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/file/io_scheduler.h"
+
+#include "packager/base/lazy_instance.h"
+#include "packager/base/logging.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+namespace media {
+namespace io_scheduler {
+namespace {
+
+// Upper bound for how long one bulk block write may be held back. With the
+// default io_block_size a released block drains quickly, so this bounds bulk
+// starvation without letting bulk writes pile up behind live traffic.
+const int64_t kMaxBulkStallMs = 100;
+
+class Scheduler {
+ public:
+  Scheduler()
+      : process_priority_(kPriorityLive),
+        write_finished_(&lock_),
+        live_writes_(0),
+        bulk_writes_(0) {}
+
+  void set_process_priority(IoPriority priority) {
+    base::AutoLock auto_lock(lock_);
+    process_priority_ = priority;
+  }
+
+  IoPriority process_priority() {
+    base::AutoLock auto_lock(lock_);
+    return process_priority_;
+  }
+
+  void BeginWrite(IoPriority priority) {
+    base::AutoLock auto_lock(lock_);
+    if (priority == kPriorityLive) {
+      ++live_writes_;
+      return;
+    }
+    // Bulk: wait until in-flight live writes drain and no other bulk block
+    // is being written, but never past the stall bound.
+    const base::TimeTicks deadline =
+        base::TimeTicks::Now() +
+        base::TimeDelta::FromMilliseconds(kMaxBulkStallMs);
+    while (live_writes_ > 0 || bulk_writes_ > 0) {
+      const base::TimeDelta remaining = deadline - base::TimeTicks::Now();
+      if (remaining <= base::TimeDelta())
+        break;
+      write_finished_.TimedWait(remaining);
+    }
+    ++bulk_writes_;
+  }
+
+  void EndWrite(IoPriority priority) {
+    base::AutoLock auto_lock(lock_);
+    if (priority == kPriorityLive) {
+      DCHECK_GT(live_writes_, 0);
+      --live_writes_;
+    } else {
+      DCHECK_GT(bulk_writes_, 0);
+      --bulk_writes_;
+    }
+    write_finished_.Broadcast();
+  }
+
+ private:
+  base::Lock lock_;
+  base::ConditionVariable write_finished_;
+  IoPriority process_priority_;
+  int live_writes_;
+  int bulk_writes_;
+
+  DISALLOW_COPY_AND_ASSIGN(Scheduler);
+};
+
+base::LazyInstance<Scheduler>::Leaky g_scheduler = LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+void SetProcessPriority(IoPriority priority) {
+  g_scheduler.Get().set_process_priority(priority);
+}
+
+IoPriority GetProcessPriority() {
+  return g_scheduler.Get().process_priority();
+}
+
+void BeginWrite(IoPriority priority) {
+  g_scheduler.Get().BeginWrite(priority);
+}
+
+void EndWrite(IoPriority priority) {
+  g_scheduler.Get().EndWrite(priority);
+}
+
+}  // namespace io_scheduler
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,63 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_IO_SCHEDULER_H_
+#define PACKAGER_FILE_IO_SCHEDULER_H_
+
+#include "packager/base/macros.h"
+
+namespace shaka {
+namespace media {
+
+/// Process-wide write scheduling behind ThreadedIoFile, for hosts where
+/// latency-sensitive (live) and throughput (bulk VOD) packager processes
+/// share storage. Live writes always go straight to the device. Bulk writes
+/// queue behind in-flight live writes and are released one block at a time,
+/// keeping the device queue shallow so live segment publication stays fast.
+/// A bulk block is never stalled longer than a fixed bound, so bulk jobs keep
+/// making progress under sustained live traffic.
+/// All functions are thread safe.
+namespace io_scheduler {
+
+enum IoPriority {
+  /// Latency-sensitive writes, e.g. live segment publication. Never delayed.
+  kPriorityLive,
+  /// Throughput writes, e.g. bulk VOD packaging. Yield to live writes and
+  /// self-limit to one in-flight block write.
+  kPriorityBulk,
+};
+
+/// Set the priority new ThreadedIoFile writers pick up. Typically set once at
+/// process startup from --io_priority; the default is kPriorityLive, which
+/// leaves write scheduling unchanged.
+void SetProcessPriority(IoPriority priority);
+IoPriority GetProcessPriority();
+
+/// Announce a block write about to be issued at @a priority; blocks (bounded)
+/// for bulk writers while the device is busy. Each BeginWrite() must be
+/// paired with an EndWrite() at the same priority once the write returns.
+void BeginWrite(IoPriority priority);
+void EndWrite(IoPriority priority);
+
+/// Scopes BeginWrite/EndWrite around one block write.
+class ScopedWrite {
+ public:
+  explicit ScopedWrite(IoPriority priority) : priority_(priority) {
+    BeginWrite(priority_);
+  }
+  ~ScopedWrite() { EndWrite(priority_); }
+
+ private:
+  const IoPriority priority_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedWrite);
+};
+
+}  // namespace io_scheduler
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_IO_SCHEDULER_H_
@@ -0,0 +1,61 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include "packager/base/bind.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/file/io_scheduler.h"
+
+namespace shaka {
+namespace media {
+namespace io_scheduler {
+
+namespace {
+
+void DoBulkWrite(base::WaitableEvent* write_done) {
+  ScopedWrite scoped_write(kPriorityBulk);
+  write_done->Signal();
+}
+
+}  // namespace
+
+// The scheduler is process-wide state, so all assertions live in one test.
+TEST(IoSchedulerTest, PrioritiesAndRelease) {
+  // The default priority leaves write scheduling unchanged.
+  EXPECT_EQ(kPriorityLive, GetProcessPriority());
+  SetProcessPriority(kPriorityBulk);
+  EXPECT_EQ(kPriorityBulk, GetProcessPriority());
+  SetProcessPriority(kPriorityLive);
+
+  // Live writes are never delayed, even while another live write is in
+  // flight.
+  BeginWrite(kPriorityLive);
+  BeginWrite(kPriorityLive);
+  EndWrite(kPriorityLive);
+
+  // A bulk write queued behind the remaining live write completes once that
+  // write finishes (or the stall bound elapses); either way the writer is
+  // released and the test does not hang.
+  base::WaitableEvent write_done(false, false);
+  ClosureThread bulk_thread(
+      "BulkWriterThread",
+      base::Bind(&DoBulkWrite, base::Unretained(&write_done)));
+  bulk_thread.Start();
+  EndWrite(kPriorityLive);
+  write_done.Wait();
+  bulk_thread.Join();
+
+  // Back-to-back bulk writes from one writer make progress.
+  for (int i = 0; i < 3; ++i) {
+    ScopedWrite scoped_write(kPriorityBulk);
+  }
+}
+
+}  // namespace io_scheduler
+}  // namespace media
+}  // namespace shaka
@@ -8,14 +8,36 @@
 
 #include <stdio.h>
 
+#if defined(OS_LINUX)
+#include <fcntl.h>
+#endif
+#if !defined(OS_WIN)
+#include <unistd.h>
+#endif
+
+#include <gflags/gflags.h>
+
 #include "packager/base/files/file_util.h"
+#include "packager/base/files/memory_mapped_file.h"
 #include "packager/base/logging.h"
 
+DEFINE_uint64(file_writeback_hint_bytes,
+              0,
+              "If nonzero, local file writes initiate asynchronous kernel "
+              "writeback every this many bytes and evict already written-back "
+              "pages from the page cache (supported platforms only). This "
+              "keeps large segment writes from piling up dirty pages that "
+              "stall the writer at segment boundaries. 0 disables the hints.");
+
 namespace shaka {
 namespace media {
 
 LocalFile::LocalFile(const char* file_name, const char* mode)
-    : File(file_name), file_mode_(mode), internal_file_(NULL) {}
+    : File(file_name),
+      file_mode_(mode),
+      internal_file_(NULL),
+      writeback_synced_end_(0),
+      writeback_evicted_end_(0) {}
 
 bool LocalFile::Close() {
   bool result = true;
@@ -33,10 +55,105 @@ int64_t LocalFile::Read(void* buffer, uint64_t length) {
   return fread(buffer, sizeof(char), length, internal_file_);
 }
 
+bool LocalFile::MapReadOnly(const uint8_t** data, uint64_t* size) {
+  DCHECK(data != NULL);
+  DCHECK(size != NULL);
+
+  // Only plain read modes are mappable; a writer through the same object
+  // could invalidate the view.
+  if (file_mode_.find('r') == std::string::npos ||
+      file_mode_.find('+') != std::string::npos) {
+    return false;
+  }
+
+  if (!mapped_file_) {
+    scoped_ptr<base::MemoryMappedFile> mapped_file(new base::MemoryMappedFile);
+    if (!mapped_file->Initialize(base::FilePath(file_name()))) {
+      LOG(WARNING) << "Failed to memory-map file " << file_name();
+      return false;
+    }
+    mapped_file_ = mapped_file.Pass();
+  }
+  *data = mapped_file_->data();
+  *size = mapped_file_->length();
+  return true;
+}
+
+int LocalFile::GetOsFileDescriptor() {
+#if defined(OS_WIN)
+  return -1;
+#else
+  DCHECK(internal_file_ != NULL);
+
+  // Push out any buffered data and align the descriptor offset with the
+  // stdio position, so the descriptor can be used directly.
+  if (fflush(internal_file_) != 0)
+    return -1;
+  const int fd = fileno(internal_file_);
+  const off_t position = ftello(internal_file_);
+  if (position < 0 || lseek(fd, position, SEEK_SET) != position)
+    return -1;
+  return fd;
+#endif
+}
+
+void LocalFile::SetFileSizeHint(uint64_t size_hint) {
+#if defined(OS_LINUX)
+  DCHECK(internal_file_ != NULL);
+  if (size_hint == 0)
+    return;
+  // KEEP_SIZE allocates the extents without changing the logical file size,
+  // so an overestimated hint does not leave a zero-filled tail if the file
+  // comes up short. Best-effort: not every filesystem supports fallocate.
+  if (fallocate(fileno(internal_file_), FALLOC_FL_KEEP_SIZE, 0, size_hint) !=
+      0) {
+    VLOG(1) << "fallocate of " << size_hint << " bytes failed for "
+            << file_name() << "; extents will be allocated incrementally.";
+  }
+#endif  // defined(OS_LINUX)
+}
+
 int64_t LocalFile::Write(const void* buffer, uint64_t length) {
   DCHECK(buffer != NULL);
   DCHECK(internal_file_ != NULL);
-  return fwrite(buffer, sizeof(char), length, internal_file_);
+  size_t bytes_written = fwrite(buffer, sizeof(char), length, internal_file_);
+  if (FLAGS_file_writeback_hint_bytes != 0 && bytes_written > 0) {
+    off_t position = ftello(internal_file_);
+    if (position >= 0)
+      MaybeHintWriteback(position);
+  }
+  return bytes_written;
+}
+
+void LocalFile::MaybeHintWriteback(uint64_t end_position) {
+#if defined(OS_LINUX)
+  // Backward seeks (e.g. box size rewrites at finalization) make
+  // |end_position| fall behind; skip hinting, the flusher picks those pages
+  // up eventually.
+  if (end_position <
+      writeback_synced_end_ + FLAGS_file_writeback_hint_bytes) {
+    return;
+  }
+
+  // Push the stdio buffer out so the range is in the page cache.
+  if (fflush(internal_file_) != 0)
+    return;
+  const int fd = fileno(internal_file_);
+
+  // Start asynchronous writeback of the newly written range, and evict the
+  // range submitted on the previous round, which has had time to reach the
+  // disk. Both calls are best-effort hints.
+  sync_file_range(fd, writeback_synced_end_,
+                  end_position - writeback_synced_end_,
+                  SYNC_FILE_RANGE_WRITE);
+  if (writeback_synced_end_ > writeback_evicted_end_) {
+    posix_fadvise(fd, writeback_evicted_end_,
+                  writeback_synced_end_ - writeback_evicted_end_,
+                  POSIX_FADV_DONTNEED);
+    writeback_evicted_end_ = writeback_synced_end_;
+  }
+  writeback_synced_end_ = end_position;
+#endif  // defined(OS_LINUX)
 }
 
 int64_t LocalFile::Size() {
@@ -12,8 +12,13 @@
 #include <string>
 
 #include "packager/base/compiler_specific.h"
+#include "packager/base/memory/scoped_ptr.h"
 #include "packager/media/file/file.h"
 
+namespace base {
+class MemoryMappedFile;
+}  // namespace base
+
 namespace shaka {
 namespace media {
 
@@ -29,6 +34,9 @@ class LocalFile : public File {
   /// @{
   bool Close() override;
   int64_t Read(void* buffer, uint64_t length) override;
+  bool MapReadOnly(const uint8_t** data, uint64_t* size) override;
+  int GetOsFileDescriptor() override;
+  void SetFileSizeHint(uint64_t size_hint) override;
   int64_t Write(const void* buffer, uint64_t length) override;
   int64_t Size() override;
   bool Flush() override;
@@ -47,8 +55,19 @@ class LocalFile : public File {
   bool Open() override;
 
  private:
+  // Starts asynchronous writeback of written bytes and evicts written-back
+  // pages from the page cache once enough bytes have accumulated. No-op on
+  // platforms without the required syscalls or when the feature is disabled
+  // (see --file_writeback_hint_bytes).
+  void MaybeHintWriteback(uint64_t end_position);
+
   std::string file_mode_;
   FILE* internal_file_;
+  // Lazily created by MapReadOnly(); released when the file is closed.
+  scoped_ptr<base::MemoryMappedFile> mapped_file_;
+  // Writeback hint bookkeeping; see MaybeHintWriteback().
+  uint64_t writeback_synced_end_;
+  uint64_t writeback_evicted_end_;
 
   DISALLOW_COPY_AND_ASSIGN(LocalFile);
 };
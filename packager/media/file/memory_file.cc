@@ -8,54 +8,216 @@
 
 #include <string.h>  // for memcpy
 
+#include <algorithm>
 #include <map>
+#include <vector>
 
+#include "packager/base/hash.h"
+#include "packager/base/lazy_instance.h"
 #include "packager/base/logging.h"
-#include "packager/base/memory/scoped_ptr.h"
+#include "packager/base/synchronization/lock.h"
 
 namespace shaka {
 namespace media {
 namespace {
 
-// A helper filesystem object.  This holds the data for the memory files.
+// Rope chunk size. Large enough that a typical media segment spans only a
+// handful of chunks, small enough that short files do not waste much.
+const uint64_t kChunkSize = 256 * 1024;
+
+// Registry shard count; see FileSystem below.
+const size_t kNumShards = 16;
+
+}  // namespace
+
+// The reference counted contents of one memory file. Stored as fixed-size
+// chunks so growing the file never copies the bytes already written, and
+// reference counted so handles stay valid when the registry entry is
+// replaced or deleted. Safe for concurrent use by multiple handles.
+class MemoryFileData : public base::RefCountedThreadSafe<MemoryFileData> {
+ public:
+  MemoryFileData() : size_(0) {}
+
+  // Reads up to |length| bytes at |position|. Returns the number of bytes
+  // read, 0 at or past the end of the file.
+  int64_t Read(uint64_t position, void* buffer, uint64_t length);
+  // Writes |length| bytes at |position|, growing the file as needed. Returns
+  // |length|, or -1 if growing would exceed the memory file size limit.
+  int64_t Write(uint64_t position, const void* buffer, uint64_t length);
+
+  uint64_t size();
+
+ private:
+  friend class base::RefCountedThreadSafe<MemoryFileData>;
+  ~MemoryFileData();
+
+  // Guards |chunks_| and |size_|.
+  base::Lock lock_;
+  std::vector<std::vector<uint8_t>*> chunks_;
+  uint64_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemoryFileData);
+};
+
+namespace {
+
+// A helper filesystem object. This holds the contents of the memory files,
+// sharded by file name hash so concurrent create/read/delete cycles on
+// different names (e.g. per-segment handoff from many streams) do not
+// serialize on a single registry lock.
 class FileSystem {
  public:
+  FileSystem() : size_limit_(0), allocated_(0) {}
   ~FileSystem() {}
 
-  static FileSystem* Instance() {
-    if (!g_file_system_)
-      g_file_system_.reset(new FileSystem());
+  scoped_refptr<MemoryFileData> OpenForRead(const std::string& file_name) {
+    Shard& shard = ShardFor(file_name);
+    base::AutoLock lock(shard.lock);
+    FileMap::const_iterator it = shard.files.find(file_name);
+    return it == shard.files.end() ? scoped_refptr<MemoryFileData>()
+                                   : it->second;
+  }
+
+  scoped_refptr<MemoryFileData> OpenForWrite(const std::string& file_name) {
+    scoped_refptr<MemoryFileData> data(new MemoryFileData());
+    Shard& shard = ShardFor(file_name);
+    base::AutoLock lock(shard.lock);
+    // Rewriting replaces the registry entry. Handles still open on the old
+    // contents keep them alive until closed.
+    shard.files[file_name] = data;
+    return data;
+  }
 
-    return g_file_system_.get();
+  void Delete(const std::string& file_name) {
+    Shard& shard = ShardFor(file_name);
+    base::AutoLock lock(shard.lock);
+    shard.files.erase(file_name);
   }
 
-  bool Exists(const std::string& file_name) const {
-    return files_.find(file_name) != files_.end();
+  void DeleteAll() {
+    for (size_t i = 0; i < kNumShards; ++i) {
+      base::AutoLock lock(shards_[i].lock);
+      shards_[i].files.clear();
+    }
   }
 
-  std::vector<uint8_t>* GetFile(const std::string& file_name) {
-    return &files_[file_name];
+  // Reserves one storage chunk against the size limit. Returns false if the
+  // limit would be exceeded.
+  bool ReserveChunk() {
+    base::AutoLock lock(quota_lock_);
+    if (size_limit_ != 0 && allocated_ + kChunkSize > size_limit_)
+      return false;
+    allocated_ += kChunkSize;
+    return true;
   }
 
-  void Delete(const std::string& file_name) { files_.erase(file_name); }
+  void ReleaseChunks(size_t num_chunks) {
+    base::AutoLock lock(quota_lock_);
+    DCHECK_GE(allocated_, num_chunks * kChunkSize);
+    allocated_ -= num_chunks * kChunkSize;
+  }
 
-  void DeleteAll() { files_.clear(); }
+  void set_size_limit(uint64_t size_limit) {
+    base::AutoLock lock(quota_lock_);
+    size_limit_ = size_limit;
+  }
 
  private:
-  FileSystem() {}
+  typedef std::map<std::string, scoped_refptr<MemoryFileData> > FileMap;
+  struct Shard {
+    base::Lock lock;
+    FileMap files;
+  };
+
+  Shard& ShardFor(const std::string& file_name) {
+    return shards_[base::Hash(file_name) % kNumShards];
+  }
 
-  static scoped_ptr<FileSystem> g_file_system_;
+  Shard shards_[kNumShards];
+
+  // The size limit and total allocation are tracked globally; this lock is
+  // only taken when a chunk is allocated or freed, not per write.
+  base::Lock quota_lock_;
+  uint64_t size_limit_;
+  uint64_t allocated_;
 
-  std::map<std::string, std::vector<uint8_t> > files_;
   DISALLOW_COPY_AND_ASSIGN(FileSystem);
 };
 
-scoped_ptr<FileSystem> FileSystem::g_file_system_;
+base::LazyInstance<FileSystem>::Leaky g_file_system = LAZY_INSTANCE_INITIALIZER;
 
 }  // namespace
 
+int64_t MemoryFileData::Read(uint64_t position, void* buffer,
+                             uint64_t length) {
+  base::AutoLock lock(lock_);
+  if (position >= size_)
+    return 0;
+
+  const uint64_t bytes_to_read = std::min(length, size_ - position);
+  uint8_t* out = static_cast<uint8_t*>(buffer);
+  uint64_t pos = position;
+  uint64_t remaining = bytes_to_read;
+  while (remaining > 0) {
+    const size_t chunk = static_cast<size_t>(pos / kChunkSize);
+    const size_t offset = static_cast<size_t>(pos % kChunkSize);
+    const size_t count =
+        static_cast<size_t>(std::min<uint64_t>(remaining, kChunkSize - offset));
+    memcpy(out, &(*chunks_[chunk])[offset], count);
+    out += count;
+    pos += count;
+    remaining -= count;
+  }
+  return bytes_to_read;
+}
+
+int64_t MemoryFileData::Write(uint64_t position, const void* buffer,
+                              uint64_t length) {
+  base::AutoLock lock(lock_);
+  const uint64_t end = position + length;
+  const size_t chunks_needed = static_cast<size_t>(
+      (std::max(end, size_) + kChunkSize - 1) / kChunkSize);
+  while (chunks_.size() < chunks_needed) {
+    if (!g_file_system.Pointer()->ReserveChunk()) {
+      LOG(ERROR) << "Memory file size limit reached.";
+      return -1;
+    }
+    // Chunks are zero initialized so a write past the current size leaves a
+    // gap of zeros, matching what growing a flat buffer would produce.
+    chunks_.push_back(new std::vector<uint8_t>(kChunkSize));
+  }
+
+  const uint8_t* in = static_cast<const uint8_t*>(buffer);
+  uint64_t pos = position;
+  uint64_t remaining = length;
+  while (remaining > 0) {
+    const size_t chunk = static_cast<size_t>(pos / kChunkSize);
+    const size_t offset = static_cast<size_t>(pos % kChunkSize);
+    const size_t count =
+        static_cast<size_t>(std::min<uint64_t>(remaining, kChunkSize - offset));
+    memcpy(&(*chunks_[chunk])[offset], in, count);
+    in += count;
+    pos += count;
+    remaining -= count;
+  }
+  if (end > size_)
+    size_ = end;
+  return length;
+}
+
+uint64_t MemoryFileData::size() {
+  base::AutoLock lock(lock_);
+  return size_;
+}
+
+MemoryFileData::~MemoryFileData() {
+  for (size_t i = 0; i < chunks_.size(); ++i)
+    delete chunks_[i];
+  g_file_system.Pointer()->ReleaseChunks(chunks_.size());
+}
+
 MemoryFile::MemoryFile(const std::string& file_name, const std::string& mode)
-    : File(file_name), mode_(mode), file_(NULL), position_(0) {}
+    : File(file_name), mode_(mode), position_(0) {}
 
 MemoryFile::~MemoryFile() {}
 
@@ -65,26 +227,17 @@ bool MemoryFile::Close() {
 }
 
 int64_t MemoryFile::Read(void* buffer, uint64_t length) {
-  const uint64_t size = Size();
-  DCHECK_LE(position_, size);
-  if (position_ >= size)
-    return 0;
-
-  const uint64_t bytes_to_read = std::min(length, size - position_);
-  memcpy(buffer, &(*file_)[position_], bytes_to_read);
-  position_ += bytes_to_read;
-  return bytes_to_read;
+  const int64_t bytes_read = file_->Read(position_, buffer, length);
+  if (bytes_read > 0)
+    position_ += bytes_read;
+  return bytes_read;
 }
 
 int64_t MemoryFile::Write(const void* buffer, uint64_t length) {
-  const uint64_t size = Size();
-  if (size < position_ + length) {
-    file_->resize(position_ + length);
-  }
-
-  memcpy(&(*file_)[position_], buffer, length);
-  position_ += length;
-  return length;
+  const int64_t bytes_written = file_->Write(position_, buffer, length);
+  if (bytes_written > 0)
+    position_ += bytes_written;
+  return bytes_written;
 }
 
 int64_t MemoryFile::Size() {
@@ -97,7 +250,7 @@ bool MemoryFile::Flush() {
 }
 
 bool MemoryFile::Seek(uint64_t position) {
-  if (Size() < static_cast<int64_t>(position))
+  if (file_->size() < position)
     return false;
 
   position_ = position;
@@ -110,31 +263,32 @@ bool MemoryFile::Tell(uint64_t* position) {
 }
 
 bool MemoryFile::Open() {
-  FileSystem* file_system = FileSystem::Instance();
   if (mode_ == "r") {
-    if (!file_system->Exists(file_name()))
+    file_ = g_file_system.Pointer()->OpenForRead(file_name());
+    if (!file_)
       return false;
   } else if (mode_ == "w") {
-    file_system->Delete(file_name());
+    file_ = g_file_system.Pointer()->OpenForWrite(file_name());
   } else {
     NOTIMPLEMENTED() << "File mode " << mode_ << " not supported by MemoryFile";
     return false;
   }
 
-  file_ = file_system->GetFile(file_name());
-  DCHECK(file_);
   position_ = 0;
   return true;
 }
 
+void MemoryFile::SetSizeLimit(uint64_t size_limit) {
+  g_file_system.Pointer()->set_size_limit(size_limit);
+}
+
 void MemoryFile::DeleteAll() {
-  FileSystem::Instance()->DeleteAll();
+  g_file_system.Pointer()->DeleteAll();
 }
 
 void MemoryFile::Delete(const std::string& file_name) {
-  FileSystem::Instance()->Delete(file_name);
+  g_file_system.Pointer()->Delete(file_name);
 }
 
 }  // namespace media
 }  // namespace shaka
-
@@ -10,15 +10,23 @@
 #include <stdint.h>
 
 #include <string>
-#include <vector>
 
+#include "packager/base/memory/ref_counted.h"
 #include "packager/media/file/file.h"
 
 namespace shaka {
 namespace media {
 
-/// Implements a File that is stored in memory.  This should be only used for
-/// testing, since this does not support larger files.
+class MemoryFileData;
+
+/// Implements a File that is stored in memory. Files live in a global,
+/// sharded registry keyed by name, so one stage of a pipeline can write
+/// 'memory://...' output and hand just the name to the next stage (e.g.
+/// segmenter to uploader). Contents are stored as fixed-size chunks, so
+/// growing a large file never copies the bytes already written. A handle
+/// keeps the contents it opened alive: deleting or rewriting a name detaches
+/// the old contents from the registry, but handles still open on them stay
+/// valid until closed.
 class MemoryFile : public File {
  public:
   MemoryFile(const std::string& file_name, const std::string& mode);
@@ -34,12 +42,17 @@ class MemoryFile : public File {
   bool Tell(uint64_t* position) override;
   /// @}
 
-  /// Deletes all memory file data created.  This assumes that there are no
-  /// MemoryFile objects alive.  Any alive objects will be in an undefined
-  /// state.
+  /// Limits the total bytes held by all memory files combined. Writes that
+  /// would allocate beyond the limit fail instead, so a stalled consumer
+  /// cannot grow memory-file handoff without bound. 0 (the default) means no
+  /// limit. Enforced at storage chunk granularity.
+  static void SetSizeLimit(uint64_t size_limit);
+
+  /// Removes all memory files from the registry. Open handles keep their
+  /// contents alive until closed.
   static void DeleteAll();
-  /// Deletes the memory file data with the given file_name.  Any objects open
-  /// with that file name will be in an undefined state.
+  /// Removes the memory file with the given @a file_name from the registry.
+  /// Handles still open on it keep its contents alive until closed.
   static void Delete(const std::string& file_name);
 
  protected:
@@ -48,7 +61,7 @@ class MemoryFile : public File {
 
  private:
   std::string mode_;
-  std::vector<uint8_t>* file_;
+  scoped_refptr<MemoryFileData> file_;
   uint64_t position_;
 
   DISALLOW_COPY_AND_ASSIGN(MemoryFile);
@@ -58,4 +71,3 @@ class MemoryFile : public File {
 }  // namespace shaka
 
 #endif  // MEDIA_FILE_MEDIA_FILE_H_
-
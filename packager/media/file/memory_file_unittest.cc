@@ -4,6 +4,9 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "packager/base/memory/scoped_ptr.h"
 #include "packager/media/file/file.h"
 #include "packager/media/file/file_closer.h"
@@ -21,6 +24,7 @@ const int64_t kWriteBufferSize = sizeof(kWriteBuffer);
 class MemoryFileTest : public testing::Test {
  protected:
   void TearDown() override {
+    MemoryFile::SetSizeLimit(0);
     MemoryFile::DeleteAll();
   }
 };
@@ -101,6 +105,64 @@ TEST_F(MemoryFileTest, ReadMissingFileFails) {
   EXPECT_FALSE(file);
 }
 
+TEST_F(MemoryFileTest, ChunkedStorageLargeFile) {
+  // Larger than one storage chunk, so reads and writes cross chunk
+  // boundaries.
+  const size_t kFileSize = 1024 * 1024 + 123;
+  std::vector<uint8_t> contents(kFileSize);
+  for (size_t i = 0; i < kFileSize; ++i)
+    contents[i] = static_cast<uint8_t>(i * 7);
+
+  scoped_ptr<File, FileCloser> writer(File::Open("memory://file1", "w"));
+  ASSERT_TRUE(writer);
+  // Write in odd-sized pieces so the piece boundaries do not line up with
+  // the chunk boundaries.
+  const size_t kPieceSize = 100001;
+  for (size_t offset = 0; offset < kFileSize; offset += kPieceSize) {
+    const size_t count = std::min(kPieceSize, kFileSize - offset);
+    ASSERT_EQ(static_cast<int64_t>(count),
+              writer->Write(&contents[offset], count));
+  }
+  EXPECT_EQ(static_cast<int64_t>(kFileSize), writer->Size());
+
+  scoped_ptr<File, FileCloser> reader(File::Open("memory://file1", "r"));
+  ASSERT_TRUE(reader);
+  std::vector<uint8_t> read_back(kFileSize);
+  ASSERT_EQ(static_cast<int64_t>(kFileSize),
+            reader->Read(&read_back[0], kFileSize));
+  EXPECT_EQ(contents, read_back);
+}
+
+TEST_F(MemoryFileTest, OpenHandleSurvivesDelete) {
+  scoped_ptr<File, FileCloser> writer(File::Open("memory://file1", "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(kWriteBufferSize, writer->Write(kWriteBuffer, kWriteBufferSize));
+
+  scoped_ptr<File, FileCloser> reader(File::Open("memory://file1", "r"));
+  ASSERT_TRUE(reader);
+  MemoryFile::Delete("memory://file1");
+
+  // The open handle keeps the contents alive; only the name is gone.
+  uint8_t read_buffer[kWriteBufferSize];
+  ASSERT_EQ(kWriteBufferSize, reader->Read(read_buffer, kWriteBufferSize));
+  EXPECT_EQ(0, memcmp(kWriteBuffer, read_buffer, kWriteBufferSize));
+
+  scoped_ptr<File, FileCloser> reader2(File::Open("memory://file1", "r"));
+  EXPECT_FALSE(reader2);
+}
+
+TEST_F(MemoryFileTest, SizeLimitFailsWrites) {
+  MemoryFile::SetSizeLimit(1);
+
+  scoped_ptr<File, FileCloser> file(File::Open("memory://file1", "w"));
+  ASSERT_TRUE(file);
+  EXPECT_EQ(-1, file->Write(kWriteBuffer, kWriteBufferSize));
+
+  // Lifting the limit makes the same handle writable again.
+  MemoryFile::SetSizeLimit(0);
+  EXPECT_EQ(kWriteBufferSize, file->Write(kWriteBuffer, kWriteBufferSize));
+}
+
 TEST_F(MemoryFileTest, WriteExistingFileDeletes) {
   scoped_ptr<File, FileCloser> file1(File::Open("memory://file1", "w"));
   ASSERT_TRUE(file1);
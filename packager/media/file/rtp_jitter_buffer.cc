@@ -0,0 +1,152 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/file/rtp_jitter_buffer.h"
+
+#include <string.h>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+const size_t kRtpHeaderSize = 12;
+const uint64_t kSequenceNumberRange = 0x10000;
+
+}  // namespace
+
+RtpJitterBuffer::RtpJitterBuffer(size_t depth)
+    : depth_(depth),
+      initialized_(false),
+      next_sequence_number_(0),
+      highest_sequence_number_(0),
+      packets_lost_(0),
+      packets_discarded_(0) {}
+
+RtpJitterBuffer::~RtpJitterBuffer() {}
+
+bool RtpJitterBuffer::AddPacket(const uint8_t* data, size_t size) {
+  DCHECK(data);
+
+  // Fixed header: V=2, optional padding/extension/CSRC fields. Anything that
+  // does not carry the version bits is not RTP; the source is likely sending
+  // raw TS datagrams.
+  if (size < kRtpHeaderSize || (data[0] >> 6) != 2)
+    return false;
+
+  const bool has_padding = (data[0] & 0x20) != 0;
+  const bool has_extension = (data[0] & 0x10) != 0;
+  const size_t csrc_count = data[0] & 0x0f;
+  const uint16_t sequence_number = (data[2] << 8) | data[3];
+
+  size_t payload_offset = kRtpHeaderSize + 4 * csrc_count;
+  if (has_extension) {
+    if (size < payload_offset + 4)
+      return false;
+    const size_t extension_words =
+        (data[payload_offset + 2] << 8) | data[payload_offset + 3];
+    payload_offset += 4 + 4 * extension_words;
+  }
+  size_t payload_size = size;
+  if (has_padding) {
+    // The last octet of the padding holds the padding length, itself
+    // included.
+    const size_t padding = data[size - 1];
+    if (padding == 0 || padding > size)
+      return false;
+    payload_size -= padding;
+  }
+  if (payload_offset > payload_size)
+    return false;
+  payload_size -= payload_offset;
+
+  if (!initialized_) {
+    // Anchor the extended sequence space well above zero so reordered
+    // packets from just before the first one still extend to positive
+    // values.
+    initialized_ = true;
+    highest_sequence_number_ = kSequenceNumberRange + sequence_number;
+    next_sequence_number_ = highest_sequence_number_;
+  }
+
+  const uint64_t extended = ExtendSequenceNumber(sequence_number);
+  if (extended < next_sequence_number_ || packets_.count(extended) > 0) {
+    // Duplicate, or a packet that was already declared lost.
+    ++packets_discarded_;
+    return true;
+  }
+  if (extended > highest_sequence_number_)
+    highest_sequence_number_ = extended;
+
+  std::vector<uint8_t>& payload = packets_[extended];
+  payload.assign(data + payload_offset, data + payload_offset + payload_size);
+  return true;
+}
+
+size_t RtpJitterBuffer::NextPayload(uint8_t* buffer, size_t buffer_size) {
+  DCHECK(buffer);
+
+  if (packets_.empty())
+    return 0;
+
+  std::map<uint64_t, std::vector<uint8_t> >::iterator front = packets_.begin();
+  if (front->first != next_sequence_number_) {
+    // A packet is missing. Hold delivery until the reordering window fills;
+    // only then is the packet declared lost.
+    if (packets_.size() <= depth_)
+      return 0;
+    packets_lost_ += front->first - next_sequence_number_;
+    LOG_IF(WARNING, packets_lost_ == 1 || (packets_lost_ % 1000) == 0)
+        << "RTP jitter buffer declared " << packets_lost_
+        << " packet(s) lost so far.";
+  }
+
+  const std::vector<uint8_t>& payload = front->second;
+  if (payload.size() > buffer_size) {
+    LOG(ERROR) << "RTP payload of " << payload.size()
+               << " bytes does not fit in the read buffer; dropped.";
+    next_sequence_number_ = front->first + 1;
+    packets_.erase(front);
+    return 0;
+  }
+  const size_t payload_size = payload.size();
+  if (payload_size > 0)
+    memcpy(buffer, &payload[0], payload_size);
+  next_sequence_number_ = front->first + 1;
+  packets_.erase(front);
+  return payload_size;
+}
+
+uint64_t RtpJitterBuffer::ExtendSequenceNumber(
+    uint16_t sequence_number) const {
+  // Candidates in the cycle containing the highest sequence number seen and
+  // its neighbors; pick the one closest to the highest.
+  const uint64_t cycle_start =
+      (highest_sequence_number_ / kSequenceNumberRange) * kSequenceNumberRange;
+  uint64_t best = cycle_start + sequence_number;
+  uint64_t best_distance = kSequenceNumberRange;
+  for (int cycle = -1; cycle <= 1; ++cycle) {
+    const int64_t candidate_signed =
+        static_cast<int64_t>(cycle_start + sequence_number) +
+        cycle * static_cast<int64_t>(kSequenceNumberRange);
+    if (candidate_signed < 0)
+      continue;
+    const uint64_t candidate = candidate_signed;
+    const uint64_t distance = candidate > highest_sequence_number_
+                                  ? candidate - highest_sequence_number_
+                                  : highest_sequence_number_ - candidate;
+    if (distance < best_distance) {
+      best_distance = distance;
+      best = candidate;
+    }
+  }
+  return best;
+}
+
+}  // namespace media
+}  // namespace shaka
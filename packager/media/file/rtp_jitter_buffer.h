@@ -0,0 +1,81 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_FILE_RTP_JITTER_BUFFER_H_
+#define MEDIA_FILE_RTP_JITTER_BUFFER_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <vector>
+
+#include "packager/base/macros.h"
+
+namespace shaka {
+namespace media {
+
+/// Reorders RTP packets by sequence number before their payloads are handed
+/// to the demuxer. Network microbursts reorder or drop multicast datagrams;
+/// without reordering, every swapped pair of TS packets looks like a
+/// discontinuity to the parser and forces a full PSI reacquisition.
+///
+/// In-order packets are released immediately, so the buffer adds no latency
+/// on a healthy network. When a gap appears, delivery stalls until either
+/// the missing packet arrives or @a depth packets have queued up behind the
+/// gap, at which point the packet is declared lost and delivery resumes, so
+/// the added latency is bounded by the configured depth.
+class RtpJitterBuffer {
+ public:
+  /// @param depth is the maximum number of packets held back waiting for a
+  ///        missing sequence number before it is declared lost.
+  explicit RtpJitterBuffer(size_t depth);
+  ~RtpJitterBuffer();
+
+  /// Add one received datagram to the buffer.
+  /// @param data points to the datagram bytes.
+  /// @param size is the size of the datagram in bytes.
+  /// @return true if the datagram was consumed as an RTP packet, false if it
+  ///         does not parse as RTP (version 2), in which case the caller
+  ///         should pass the datagram through untouched.
+  bool AddPacket(const uint8_t* data, size_t size);
+
+  /// Pop the payload of the next deliverable packet, if any.
+  /// @param[out] buffer receives the payload bytes.
+  /// @param buffer_size is the capacity of @a buffer; payloads larger than
+  ///        this are dropped with an error.
+  /// @return The payload size in bytes, or 0 if no packet is deliverable
+  ///         yet.
+  size_t NextPayload(uint8_t* buffer, size_t buffer_size);
+
+  /// @return The number of packets declared lost so far.
+  uint64_t packets_lost() const { return packets_lost_; }
+  /// @return The number of duplicate or too-late packets discarded so far.
+  uint64_t packets_discarded() const { return packets_discarded_; }
+
+ private:
+  // Extend a 16-bit RTP sequence number to 64 bits, picking the value
+  // closest to the highest sequence number seen so far.
+  uint64_t ExtendSequenceNumber(uint16_t sequence_number) const;
+
+  const size_t depth_;
+  // Buffered packets keyed by extended sequence number. The values are the
+  // RTP payloads with the header already stripped.
+  std::map<uint64_t, std::vector<uint8_t> > packets_;
+  bool initialized_;
+  // Extended sequence number of the next packet to deliver.
+  uint64_t next_sequence_number_;
+  // Highest extended sequence number seen; anchors sequence extension.
+  uint64_t highest_sequence_number_;
+  uint64_t packets_lost_;
+  uint64_t packets_discarded_;
+
+  DISALLOW_COPY_AND_ASSIGN(RtpJitterBuffer);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_FILE_RTP_JITTER_BUFFER_H_
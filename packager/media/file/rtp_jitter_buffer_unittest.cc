@@ -0,0 +1,144 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "packager/media/file/rtp_jitter_buffer.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+const size_t kDepth = 4;
+const size_t kBufferSize = 2048;
+
+// Build a minimal RTP packet (V=2, no padding/extension/CSRC) with the given
+// sequence number and a one-byte payload identifying the packet.
+std::vector<uint8_t> MakePacket(uint16_t sequence_number, uint8_t payload) {
+  std::vector<uint8_t> packet(12, 0);
+  packet[0] = 0x80;  // V=2.
+  packet[1] = 33;    // PT: MP2T.
+  packet[2] = sequence_number >> 8;
+  packet[3] = sequence_number & 0xff;
+  packet.push_back(payload);
+  return packet;
+}
+
+}  // namespace
+
+class RtpJitterBufferTest : public testing::Test {
+ protected:
+  RtpJitterBufferTest() : jitter_buffer_(kDepth) {}
+
+  // Add the packet and expect it to be consumed as RTP.
+  void Add(uint16_t sequence_number, uint8_t payload) {
+    std::vector<uint8_t> packet = MakePacket(sequence_number, payload);
+    EXPECT_TRUE(jitter_buffer_.AddPacket(&packet[0], packet.size()));
+  }
+
+  // Pop the next payload; returns -1 if nothing is deliverable, the one-byte
+  // payload value otherwise.
+  int Next() {
+    uint8_t buffer[kBufferSize];
+    const size_t size = jitter_buffer_.NextPayload(buffer, kBufferSize);
+    if (size == 0)
+      return -1;
+    EXPECT_EQ(1u, size);
+    return buffer[0];
+  }
+
+  RtpJitterBuffer jitter_buffer_;
+};
+
+TEST_F(RtpJitterBufferTest, InOrderPacketsDeliverImmediately) {
+  for (int i = 0; i < 10; ++i) {
+    Add(100 + i, i);
+    EXPECT_EQ(i, Next());
+    EXPECT_EQ(-1, Next());
+  }
+  EXPECT_EQ(0u, jitter_buffer_.packets_lost());
+}
+
+TEST_F(RtpJitterBufferTest, ReorderedPacketsDeliverInSequenceOrder) {
+  Add(100, 0);
+  EXPECT_EQ(0, Next());
+  // 101 and 102 swapped on the wire.
+  Add(102, 2);
+  EXPECT_EQ(-1, Next());  // Held back waiting for 101.
+  Add(101, 1);
+  EXPECT_EQ(1, Next());
+  EXPECT_EQ(2, Next());
+  EXPECT_EQ(-1, Next());
+  EXPECT_EQ(0u, jitter_buffer_.packets_lost());
+}
+
+TEST_F(RtpJitterBufferTest, MissingPacketDeclaredLostAfterDepth) {
+  Add(100, 0);
+  EXPECT_EQ(0, Next());
+  // 101 never arrives; delivery stalls until kDepth + 1 packets queue up
+  // behind the gap.
+  for (size_t i = 0; i <= kDepth; ++i) {
+    EXPECT_EQ(-1, Next());
+    Add(102 + i, 2 + i);
+  }
+  EXPECT_EQ(2, Next());
+  EXPECT_EQ(3, Next());
+  EXPECT_EQ(1u, jitter_buffer_.packets_lost());
+}
+
+TEST_F(RtpJitterBufferTest, DuplicatesAndLatePacketsDiscarded) {
+  Add(100, 0);
+  Add(100, 0);  // Duplicate.
+  EXPECT_EQ(0, Next());
+  Add(100, 0);  // Late; already delivered.
+  EXPECT_EQ(-1, Next());
+  EXPECT_EQ(2u, jitter_buffer_.packets_discarded());
+}
+
+TEST_F(RtpJitterBufferTest, SequenceNumberWraparound) {
+  Add(0xfffe, 0);
+  EXPECT_EQ(0, Next());
+  // 0x0000 and 0xffff swapped across the wrap.
+  Add(0x0000, 2);
+  EXPECT_EQ(-1, Next());
+  Add(0xffff, 1);
+  EXPECT_EQ(1, Next());
+  EXPECT_EQ(2, Next());
+  Add(0x0001, 3);
+  EXPECT_EQ(3, Next());
+  EXPECT_EQ(0u, jitter_buffer_.packets_lost());
+}
+
+TEST_F(RtpJitterBufferTest, NonRtpDatagramRejected) {
+  // A TS packet starts with the 0x47 sync byte: version bits are 01.
+  std::vector<uint8_t> ts_packet(188, 0);
+  ts_packet[0] = 0x47;
+  EXPECT_FALSE(jitter_buffer_.AddPacket(&ts_packet[0], ts_packet.size()));
+  // Too short to carry an RTP header.
+  const uint8_t short_packet[] = {0x80, 33, 0, 0};
+  EXPECT_FALSE(
+      jitter_buffer_.AddPacket(short_packet, sizeof(short_packet)));
+}
+
+TEST_F(RtpJitterBufferTest, PaddingAndCsrcStripped) {
+  // V=2, padding set, two CSRC entries, three padding octets.
+  std::vector<uint8_t> packet(12 + 8, 0);
+  packet[0] = 0x80 | 0x20 | 0x02;
+  packet[2] = 0;
+  packet[3] = 100;
+  packet.push_back(42);  // Payload.
+  packet.push_back(0);
+  packet.push_back(0);
+  packet.push_back(3);  // Padding length, itself included.
+  EXPECT_TRUE(jitter_buffer_.AddPacket(&packet[0], packet.size()));
+  EXPECT_EQ(42, Next());
+}
+
+}  // namespace media
+}  // namespace shaka
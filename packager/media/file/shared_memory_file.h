@@ -0,0 +1,74 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_FILE_SHARED_MEMORY_FILE_H_
+#define MEDIA_FILE_SHARED_MEMORY_FILE_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "packager/media/file/file.h"
+
+namespace shaka {
+namespace media {
+
+/// Implements a File backed by a named POSIX shared memory object:
+/// 'shm://segment1' maps to shm_open("/segment1"). A cooperating process
+/// (e.g. an uploader daemon) can map the same object by name, so segments
+/// cross the process boundary without a disk or socket copy. A small header
+/// at the start of the object carries the handshake: the writer marks the
+/// object complete on Close(), and opening for read fails until it does.
+/// Writers reserve --shm_file_reserved_size of address space up front;
+/// physical pages are only allocated for the bytes actually written. Not
+/// supported on Windows.
+class SharedMemoryFile : public File {
+ public:
+  /// @param file_name is the object name without the 'shm://' prefix. It
+  ///        must not contain '/'.
+  /// @param mode is the file open mode, "r" or "w".
+  SharedMemoryFile(const std::string& file_name, const std::string& mode);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  bool MapReadOnly(const uint8_t** data, uint64_t* size) override;
+  /// @}
+
+  /// Removes the shared memory object with the given @a file_name (without
+  /// the 'shm://' prefix). Processes that have it mapped keep their mapping
+  /// until they unmap it.
+  /// @return true on success.
+  static bool Delete(const char* file_name);
+
+ protected:
+  ~SharedMemoryFile() override;
+  bool Open() override;
+
+ private:
+  std::string mode_;
+  int shm_fd_;
+  // The whole mapped object, header included. NULL when not open.
+  uint8_t* map_;
+  uint64_t map_size_;
+  // Payload capacity and size, not counting the header.
+  uint64_t capacity_;
+  uint64_t size_;
+  uint64_t position_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedMemoryFile);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_FILE_SHARED_MEMORY_FILE_H_
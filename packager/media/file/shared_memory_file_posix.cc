@@ -0,0 +1,262 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/file/shared_memory_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <gflags/gflags.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "packager/base/atomicops.h"
+#include "packager/base/logging.h"
+
+DEFINE_uint64(shm_file_reserved_size,
+              256ULL << 20,
+              "Address space reserved for each shm:// file, in bytes. This "
+              "is the maximum size of one shared memory file; physical pages "
+              "are only allocated for the bytes actually written.");
+
+namespace shaka {
+namespace media {
+
+namespace {
+
+const int kInvalidFd = -1;
+
+// The handshake header at the start of every shared memory object. The
+// writer publishes |size| and then |state|; a consumer process must check
+// that |state| is kStateComplete before trusting |size| or the payload.
+const uint32_t kSharedMemoryMagic = 0x53504d53;  // 'SPMS'.
+const uint32_t kSharedMemoryVersion = 1;
+const uint32_t kStateWriting = 1;
+const uint32_t kStateComplete = 2;
+
+struct SharedMemoryHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t state;
+  uint32_t reserved;
+  uint64_t size;
+};
+
+// shm_open() requires a name of the form "/somename" with no further
+// slashes. Returns an empty string if |file_name| cannot be mapped to one.
+std::string PosixName(const std::string& file_name) {
+  if (file_name.empty() || file_name.find('/') != std::string::npos)
+    return std::string();
+  return "/" + file_name;
+}
+
+}  // namespace
+
+SharedMemoryFile::SharedMemoryFile(const std::string& file_name,
+                                   const std::string& mode)
+    : File(file_name),
+      mode_(mode),
+      shm_fd_(kInvalidFd),
+      map_(NULL),
+      map_size_(0),
+      capacity_(0),
+      size_(0),
+      position_(0) {}
+
+SharedMemoryFile::~SharedMemoryFile() {
+  // Normal deallocation is through Close(); this cleans up after a failed
+  // Open(), where the caller deletes the file directly.
+  if (map_)
+    munmap(map_, map_size_);
+  if (shm_fd_ != kInvalidFd)
+    close(shm_fd_);
+}
+
+bool SharedMemoryFile::Close() {
+  if (map_) {
+    if (mode_ == "w") {
+      // Publish the payload for consumer processes: size first, then the
+      // completion mark, with a barrier so another core cannot observe the
+      // state change before the size.
+      SharedMemoryHeader* header =
+          reinterpret_cast<SharedMemoryHeader*>(map_);
+      header->size = size_;
+      base::subtle::MemoryBarrier();
+      header->state = kStateComplete;
+    }
+    munmap(map_, map_size_);
+    map_ = NULL;
+  }
+  if (shm_fd_ != kInvalidFd) {
+    close(shm_fd_);
+    shm_fd_ = kInvalidFd;
+  }
+  delete this;
+  return true;
+}
+
+int64_t SharedMemoryFile::Read(void* buffer, uint64_t length) {
+  DCHECK(buffer);
+  DCHECK(map_);
+  if (position_ >= size_)
+    return 0;
+
+  const uint64_t bytes_to_read = std::min(length, size_ - position_);
+  memcpy(buffer, map_ + sizeof(SharedMemoryHeader) + position_,
+         bytes_to_read);
+  position_ += bytes_to_read;
+  return bytes_to_read;
+}
+
+int64_t SharedMemoryFile::Write(const void* buffer, uint64_t length) {
+  DCHECK(buffer);
+  DCHECK(map_);
+  if (mode_ != "w") {
+    NOTIMPLEMENTED() << "Cannot write to a read-only shm file.";
+    return -1;
+  }
+  if (position_ + length > capacity_) {
+    LOG(ERROR) << "Shared memory file exceeds --shm_file_reserved_size ("
+               << capacity_ << " bytes).";
+    return -1;
+  }
+
+  memcpy(map_ + sizeof(SharedMemoryHeader) + position_, buffer, length);
+  position_ += length;
+  if (position_ > size_)
+    size_ = position_;
+  return length;
+}
+
+int64_t SharedMemoryFile::Size() {
+  return size_;
+}
+
+bool SharedMemoryFile::Flush() {
+  // Writes go straight into the shared pages; there is nothing to flush.
+  return true;
+}
+
+bool SharedMemoryFile::Seek(uint64_t position) {
+  if (position > (mode_ == "w" ? capacity_ : size_))
+    return false;
+  position_ = position;
+  return true;
+}
+
+bool SharedMemoryFile::Tell(uint64_t* position) {
+  DCHECK(position);
+  *position = position_;
+  return true;
+}
+
+bool SharedMemoryFile::MapReadOnly(const uint8_t** data, uint64_t* size) {
+  DCHECK(data);
+  DCHECK(size);
+  if (mode_ != "r" || !map_)
+    return false;
+  *data = map_ + sizeof(SharedMemoryHeader);
+  *size = size_;
+  return true;
+}
+
+bool SharedMemoryFile::Open() {
+  DCHECK_EQ(kInvalidFd, shm_fd_);
+
+  const std::string name = PosixName(file_name());
+  if (name.empty()) {
+    LOG(ERROR) << "Malformed shm file name '" << file_name()
+               << "': must be non-empty and must not contain '/'.";
+    return false;
+  }
+
+  if (mode_ == "w") {
+    shm_fd_ = shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (shm_fd_ == kInvalidFd) {
+      LOG(ERROR) << "Cannot create shared memory object '" << name
+                 << "', errno: " << errno;
+      return false;
+    }
+    map_size_ = sizeof(SharedMemoryHeader) + FLAGS_shm_file_reserved_size;
+    if (ftruncate(shm_fd_, map_size_) != 0) {
+      LOG(ERROR) << "Cannot size shared memory object '" << name
+                 << "', errno: " << errno;
+      return false;
+    }
+    map_ = static_cast<uint8_t*>(mmap(NULL, map_size_,
+                                      PROT_READ | PROT_WRITE, MAP_SHARED,
+                                      shm_fd_, 0));
+    if (map_ == MAP_FAILED) {
+      LOG(ERROR) << "Cannot map shared memory object '" << name
+                 << "', errno: " << errno;
+      map_ = NULL;
+      return false;
+    }
+    SharedMemoryHeader* header = reinterpret_cast<SharedMemoryHeader*>(map_);
+    header->magic = kSharedMemoryMagic;
+    header->version = kSharedMemoryVersion;
+    header->state = kStateWriting;
+    header->reserved = 0;
+    header->size = 0;
+    capacity_ = FLAGS_shm_file_reserved_size;
+  } else if (mode_ == "r") {
+    shm_fd_ = shm_open(name.c_str(), O_RDONLY, 0);
+    if (shm_fd_ == kInvalidFd)
+      return false;
+    struct stat info;
+    if (fstat(shm_fd_, &info) != 0 ||
+        static_cast<uint64_t>(info.st_size) < sizeof(SharedMemoryHeader)) {
+      return false;
+    }
+    map_size_ = info.st_size;
+    map_ = static_cast<uint8_t*>(
+        mmap(NULL, map_size_, PROT_READ, MAP_SHARED, shm_fd_, 0));
+    if (map_ == MAP_FAILED) {
+      LOG(ERROR) << "Cannot map shared memory object '" << name
+                 << "', errno: " << errno;
+      map_ = NULL;
+      return false;
+    }
+    const SharedMemoryHeader* header =
+        reinterpret_cast<const SharedMemoryHeader*>(map_);
+    if (header->magic != kSharedMemoryMagic ||
+        header->version != kSharedMemoryVersion) {
+      LOG(ERROR) << "'" << name << "' is not a packager shared memory file.";
+      return false;
+    }
+    if (header->state != kStateComplete) {
+      // The writer has not finished; the caller may retry later.
+      VLOG(1) << "Shared memory file '" << name << "' is still being written.";
+      return false;
+    }
+    base::subtle::MemoryBarrier();
+    if (header->size > map_size_ - sizeof(SharedMemoryHeader)) {
+      LOG(ERROR) << "Shared memory file '" << name << "' has a corrupt size.";
+      return false;
+    }
+    size_ = header->size;
+  } else {
+    NOTIMPLEMENTED() << "File mode " << mode_
+                     << " not supported by SharedMemoryFile.";
+    return false;
+  }
+
+  position_ = 0;
+  return true;
+}
+
+bool SharedMemoryFile::Delete(const char* file_name) {
+  const std::string name = PosixName(file_name);
+  if (name.empty())
+    return false;
+  return shm_unlink(name.c_str()) == 0;
+}
+
+}  // namespace media
+}  // namespace shaka
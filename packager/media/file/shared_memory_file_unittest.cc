@@ -0,0 +1,96 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include "packager/base/memory/scoped_ptr.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/media/file/file.h"
+#include "packager/media/file/file_closer.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const uint8_t kWriteBuffer[] = {1, 2, 3, 4, 5, 6, 7, 8};
+const int64_t kWriteBufferSize = sizeof(kWriteBuffer);
+
+}  // namespace
+
+class SharedMemoryFileTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    // Include the pid so concurrent test runs on the same machine do not
+    // collide in the system-wide shared memory namespace.
+    file_name_ = base::StringPrintf("shm://packager_test_%d", getpid());
+  }
+
+  void TearDown() override { File::Delete(file_name_.c_str()); }
+
+  std::string file_name_;
+};
+
+TEST_F(SharedMemoryFileTest, WriteReadRoundTrip) {
+  scoped_ptr<File, FileCloser> writer(File::Open(file_name_.c_str(), "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(kWriteBufferSize, writer->Write(kWriteBuffer, kWriteBufferSize));
+  EXPECT_EQ(kWriteBufferSize, writer->Size());
+  ASSERT_TRUE(writer.release()->Close());
+
+  scoped_ptr<File, FileCloser> reader(File::Open(file_name_.c_str(), "r"));
+  ASSERT_TRUE(reader);
+  EXPECT_EQ(kWriteBufferSize, reader->Size());
+
+  uint8_t read_buffer[kWriteBufferSize];
+  ASSERT_EQ(kWriteBufferSize, reader->Read(read_buffer, kWriteBufferSize));
+  EXPECT_EQ(0, memcmp(kWriteBuffer, read_buffer, kWriteBufferSize));
+  EXPECT_EQ(0, reader->Read(read_buffer, kWriteBufferSize));
+}
+
+TEST_F(SharedMemoryFileTest, ReadFailsUntilWriterCloses) {
+  scoped_ptr<File, FileCloser> writer(File::Open(file_name_.c_str(), "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(kWriteBufferSize, writer->Write(kWriteBuffer, kWriteBufferSize));
+
+  // The handshake header is not marked complete yet.
+  scoped_ptr<File, FileCloser> reader(File::Open(file_name_.c_str(), "r"));
+  EXPECT_FALSE(reader);
+
+  ASSERT_TRUE(writer.release()->Close());
+  reader.reset(File::Open(file_name_.c_str(), "r"));
+  EXPECT_TRUE(reader);
+}
+
+TEST_F(SharedMemoryFileTest, MapReadOnly) {
+  scoped_ptr<File, FileCloser> writer(File::Open(file_name_.c_str(), "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(kWriteBufferSize, writer->Write(kWriteBuffer, kWriteBufferSize));
+  ASSERT_TRUE(writer.release()->Close());
+
+  scoped_ptr<File, FileCloser> reader(File::Open(file_name_.c_str(), "r"));
+  ASSERT_TRUE(reader);
+
+  const uint8_t* data = NULL;
+  uint64_t size = 0;
+  ASSERT_TRUE(reader->MapReadOnly(&data, &size));
+  ASSERT_EQ(static_cast<uint64_t>(kWriteBufferSize), size);
+  EXPECT_EQ(0, memcmp(kWriteBuffer, data, kWriteBufferSize));
+}
+
+TEST_F(SharedMemoryFileTest, DeleteRemovesName) {
+  scoped_ptr<File, FileCloser> writer(File::Open(file_name_.c_str(), "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(kWriteBufferSize, writer->Write(kWriteBuffer, kWriteBufferSize));
+  ASSERT_TRUE(writer.release()->Close());
+
+  EXPECT_TRUE(File::Delete(file_name_.c_str()));
+  scoped_ptr<File, FileCloser> reader(File::Open(file_name_.c_str(), "r"));
+  EXPECT_FALSE(reader);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,79 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/file/shared_memory_file.h"
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+
+SharedMemoryFile::SharedMemoryFile(const std::string& file_name,
+                                   const std::string& mode)
+    : File(file_name),
+      mode_(mode),
+      shm_fd_(-1),
+      map_(NULL),
+      map_size_(0),
+      capacity_(0),
+      size_(0),
+      position_(0) {}
+
+SharedMemoryFile::~SharedMemoryFile() {}
+
+bool SharedMemoryFile::Close() {
+  NOTIMPLEMENTED();
+  delete this;
+  return false;
+}
+
+int64_t SharedMemoryFile::Read(void* buffer, uint64_t length) {
+  NOTIMPLEMENTED();
+  return -1;
+}
+
+int64_t SharedMemoryFile::Write(const void* buffer, uint64_t length) {
+  NOTIMPLEMENTED();
+  return -1;
+}
+
+int64_t SharedMemoryFile::Size() {
+  NOTIMPLEMENTED();
+  return -1;
+}
+
+bool SharedMemoryFile::Flush() {
+  NOTIMPLEMENTED();
+  return false;
+}
+
+bool SharedMemoryFile::Seek(uint64_t position) {
+  NOTIMPLEMENTED();
+  return false;
+}
+
+bool SharedMemoryFile::Tell(uint64_t* position) {
+  NOTIMPLEMENTED();
+  return false;
+}
+
+bool SharedMemoryFile::MapReadOnly(const uint8_t** data, uint64_t* size) {
+  NOTIMPLEMENTED();
+  return false;
+}
+
+bool SharedMemoryFile::Open() {
+  NOTIMPLEMENTED();
+  return false;
+}
+
+bool SharedMemoryFile::Delete(const char* file_name) {
+  NOTIMPLEMENTED();
+  return false;
+}
+
+}  // namespace media
+}  // namespace shaka
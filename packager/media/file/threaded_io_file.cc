@@ -6,13 +6,25 @@
 
 #include "packager/media/file/threaded_io_file.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "packager/base/bind.h"
 #include "packager/base/bind_helpers.h"
 #include "packager/base/location.h"
 #include "packager/base/threading/worker_pool.h"
+#include "packager/media/base/pipeline_stats.h"
 
 namespace shaka {
 namespace media {
+namespace {
+
+// The cache sits between file IO and the packaging pipeline, both of which
+// move data in large blocks, so a stalled side typically unblocks within
+// microseconds; spin briefly before parking on an event.
+const uint32_t kIoCacheSpinCount = 2000;
+
+}  // namespace
 
 using base::subtle::NoBarrier_Load;
 using base::subtle::NoBarrier_Store;
@@ -25,15 +37,18 @@ ThreadedIoFile::ThreadedIoFile(scoped_ptr<File, FileCloser> internal_file,
       internal_file_(internal_file.Pass()),
       mode_(mode),
       cache_(io_cache_size),
-      io_buffer_(io_block_size),
+      io_block_size_(io_block_size),
+      io_priority_(io_scheduler::GetProcessPriority()),
       position_(0),
       size_(0),
       eof_(false),
+      size_hint_(0),
       flushing_(false),
       flush_complete_event_(false, false),
       internal_file_error_(0),
-      task_exit_event_(false, false) {
+      task_exit_event_(true, false) {
   DCHECK(internal_file_);
+  cache_.set_spin_count(kIoCacheSpinCount);
 }
 
 ThreadedIoFile::~ThreadedIoFile() {}
@@ -47,6 +62,7 @@ bool ThreadedIoFile::Open() {
   position_ = 0;
   size_ = internal_file_->Size();
 
+  task_exit_event_.Reset();
   base::WorkerPool::PostTask(FROM_HERE, base::Bind(&ThreadedIoFile::TaskHandler,
                                                    base::Unretained(this)),
                              true /* task_is_slow */);
@@ -84,6 +100,50 @@ int64_t ThreadedIoFile::Read(void* buffer, uint64_t length) {
   return bytes_read;
 }
 
+bool ThreadedIoFile::MapReadOnly(const uint8_t** data, uint64_t* size) {
+  DCHECK(internal_file_);
+
+  if (mode_ != kInputMode)
+    return false;
+  if (!internal_file_->MapReadOnly(data, size))
+    return false;
+
+  // The caller reads from the mapping from now on; stop the thread task so
+  // it does not keep pulling the file into the cache.
+  cache_.Close();
+  task_exit_event_.Wait();
+  return true;
+}
+
+int ThreadedIoFile::GetOsFileDescriptor() {
+  DCHECK(internal_file_);
+
+  if (mode_ == kInputMode) {
+    // Stop the thread task and rewind the internal file to the logical read
+    // position; the cache may have prefetched past it. Seek() restarts the
+    // task, per the contract on File::GetOsFileDescriptor().
+    cache_.Close();
+    task_exit_event_.Wait();
+    if (!internal_file_->Seek(position_))
+      return -1;
+  } else {
+    // Drain the cache so the descriptor offset matches the logical write
+    // position. The thread task keeps running; it stays blocked on the
+    // empty cache while the caller uses the descriptor.
+    if (!Flush())
+      return -1;
+  }
+  return internal_file_->GetOsFileDescriptor();
+}
+
+void ThreadedIoFile::SetFileSizeHint(uint64_t size_hint) {
+  // The IO thread owns |internal_file_| while the task runs; park the hint
+  // and let the thread apply it before its next write.
+  base::subtle::NoBarrier_Store(&size_hint_,
+                                static_cast<base::subtle::AtomicWord>(
+                                    size_hint));
+}
+
 int64_t ThreadedIoFile::Write(const void* buffer, uint64_t length) {
   DCHECK(internal_file_);
   DCHECK_EQ(kOutputMode, mode_);
@@ -134,6 +194,7 @@ bool ThreadedIoFile::Seek(uint64_t position) {
     }
     cache_.Reopen();
     eof_ = false;
+    task_exit_event_.Reset();
     base::WorkerPool::PostTask(
         FROM_HERE,
         base::Bind(&ThreadedIoFile::TaskHandler, base::Unretained(this)),
@@ -141,6 +202,13 @@ bool ThreadedIoFile::Seek(uint64_t position) {
     if (!result) return false;
   }
   position_ = position;
+  if (mode_ == kOutputMode) {
+    // Direct descriptor writes (see GetOsFileDescriptor()) bypass Write();
+    // refresh the size from the internal file, which has just been flushed.
+    const int64_t size = internal_file_->Size();
+    if (size >= 0)
+      size_ = size;
+  }
   return true;
 }
 
@@ -163,17 +231,49 @@ void ThreadedIoFile::RunInInputMode() {
   DCHECK(internal_file_);
   DCHECK_EQ(kInputMode, mode_);
 
+  // Datagram sources (UdpFile) need a buffer large enough for a whole
+  // datagram on every read; a contiguous ring region near the wrap point can
+  // be smaller than that, in which case the read goes through a bounce
+  // buffer instead.
+  const uint64_t kMinDirectReadSize(65536);
+  std::vector<uint8_t> bounce_buffer;
+
   while (true) {
-    int64_t read_result = internal_file_->Read(&io_buffer_[0],
-                                               io_buffer_.size());
+    // Read from the source directly into free space of the cache ring so
+    // the bytes are only copied once, by the consumer.
+    uint8_t* region(NULL);
+    uint64_t region_size(cache_.AcquireWriteRegion(&region));
+    if (region_size == 0) {
+      // Cache was closed, e.g. by Seek() or Close().
+      return;
+    }
+    region_size = std::min(region_size, io_block_size_);
+
+    const bool use_bounce_buffer =
+        region_size < std::min(kMinDirectReadSize, io_block_size_);
+    if (use_bounce_buffer) {
+      bounce_buffer.resize(io_block_size_);
+      region = bounce_buffer.data();
+      region_size = io_block_size_;
+    }
+
+    int64_t read_result;
+    {
+      pipeline_stats::ScopedStageTimer timer(pipeline_stats::kStageFileRead);
+      read_result = internal_file_->Read(region, region_size);
+    }
+    pipeline_stats::RecordBytes(pipeline_stats::kStageFileRead, read_result);
     if (read_result <= 0) {
       NoBarrier_Store(&eof_, read_result == 0);
       NoBarrier_Store(&internal_file_error_, read_result);
       cache_.Close();
       return;
     }
-    if (cache_.Write(&io_buffer_[0], read_result) == 0) {
-      return;
+    if (use_bounce_buffer) {
+      if (cache_.Write(region, read_result) == 0)
+        return;
+    } else {
+      cache_.CommitWrite(read_result);
     }
   }
 }
@@ -183,7 +283,11 @@ void ThreadedIoFile::RunInOutputMode() {
   DCHECK_EQ(kOutputMode, mode_);
 
   while (true) {
-    uint64_t write_bytes = cache_.Read(&io_buffer_[0], io_buffer_.size());
+    // Write straight out of the cache ring. The producer keeps filling the
+    // free part of the ring while this write is in flight, so the two
+    // halves act as alternating buffers without any copy in between.
+    const uint8_t* region(NULL);
+    uint64_t write_bytes = cache_.AcquireReadRegion(&region);
     if (write_bytes == 0) {
       if (flushing_) {
         cache_.Reopen();
@@ -193,10 +297,21 @@ void ThreadedIoFile::RunInOutputMode() {
         return;
       }
     } else {
+      const base::subtle::AtomicWord size_hint =
+          base::subtle::NoBarrier_AtomicExchange(&size_hint_, 0);
+      if (size_hint != 0)
+        internal_file_->SetFileSizeHint(static_cast<uint64_t>(size_hint));
+      write_bytes = std::min(write_bytes, io_block_size_);
+      // Acquired before the stage timer starts, so scheduling stalls do not
+      // count as write time.
+      io_scheduler::ScopedWrite scoped_write(io_priority_);
+      pipeline_stats::ScopedStageTimer timer(pipeline_stats::kStageFileWrite);
+      pipeline_stats::RecordBytes(pipeline_stats::kStageFileWrite,
+                                  write_bytes);
       uint64_t bytes_written(0);
       while (bytes_written < write_bytes) {
         int64_t write_result = internal_file_->Write(
-            &io_buffer_[bytes_written], write_bytes - bytes_written);
+            region + bytes_written, write_bytes - bytes_written);
         if (write_result < 0) {
           NoBarrier_Store(&internal_file_error_, write_result);
           cache_.Close();
@@ -204,6 +319,7 @@ void ThreadedIoFile::RunInOutputMode() {
         }
         bytes_written += write_result;
       }
+      cache_.CommitRead(write_bytes);
     }
   }
 }
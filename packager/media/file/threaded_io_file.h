@@ -13,6 +13,7 @@
 #include "packager/media/file/file.h"
 #include "packager/media/file/file_closer.h"
 #include "packager/media/file/io_cache.h"
+#include "packager/media/file/io_scheduler.h"
 
 namespace shaka {
 namespace media {
@@ -34,6 +35,9 @@ class ThreadedIoFile : public File {
   /// @{
   bool Close() override;
   int64_t Read(void* buffer, uint64_t length) override;
+  bool MapReadOnly(const uint8_t** data, uint64_t* size) override;
+  int GetOsFileDescriptor() override;
+  void SetFileSizeHint(uint64_t size_hint) override;
   int64_t Write(const void* buffer, uint64_t length) override;
   int64_t Size() override;
   bool Flush() override;
@@ -56,14 +60,27 @@ class ThreadedIoFile : public File {
   scoped_ptr<File, FileCloser> internal_file_;
   const Mode mode_;
   IoCache cache_;
-  std::vector<uint8_t> io_buffer_;
+  // Upper bound for the size of an individual read/write on
+  // |internal_file_|. The IO thread works directly on regions of the cache
+  // ring (see IoCache::AcquireReadRegion), so no intermediate buffer is
+  // needed.
+  const uint64_t io_block_size_;
+  // Write priority this file was opened under; block writes on the IO thread
+  // go through the process-wide scheduler at this priority.
+  const io_scheduler::IoPriority io_priority_;
   uint64_t position_;
   uint64_t size_;
   base::subtle::Atomic32 eof_;
+  // Pending size hint for |internal_file_|, applied by the IO thread before
+  // its next write; the internal file must not be touched from other threads
+  // while the IO task runs. 0 means no hint is pending.
+  base::subtle::AtomicWord size_hint_;
   bool flushing_;
   base::WaitableEvent flush_complete_event_;
   base::subtle::Atomic32 internal_file_error_;
-  // Signalled when thread task exits.
+  // Signalled when the thread task exits. Manual-reset, because it may be
+  // waited on more than once (e.g. GetOsFileDescriptor() followed by Seek()
+  // or Close()); reset before each task is posted.
   base::WaitableEvent task_exit_event_;
 
   DISALLOW_COPY_AND_ASSIGN(ThreadedIoFile);
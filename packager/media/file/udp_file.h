@@ -12,11 +12,14 @@
 #include <string>
 
 #include "packager/base/compiler_specific.h"
+#include "packager/base/memory/scoped_ptr.h"
 #include "packager/media/file/file.h"
 
 namespace shaka {
 namespace media {
 
+class RtpJitterBuffer;
+
 /// Implements UdpFile, which receives UDP unicast and multicast streams.
 class UdpFile : public File {
  public:
@@ -42,6 +45,10 @@ class UdpFile : public File {
 
  private:
   int socket_;
+  // Reorders RTP packets by sequence number before the demuxer sees their
+  // payloads. NULL unless enabled with --udp_rtp_jitter_buffer_packets;
+  // also reset to NULL if the stream turns out not to be RTP.
+  scoped_ptr<RtpJitterBuffer> jitter_buffer_;
 
   DISALLOW_COPY_AND_ASSIGN(UdpFile);
 };
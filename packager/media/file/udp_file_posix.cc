@@ -9,14 +9,17 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <gflags/gflags.h>
+#include <string.h>
 #include <strings.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <limits>
 
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/media/file/rtp_jitter_buffer.h"
 
 // TODO(tinskip): Adapt to work with winsock.
 
@@ -24,6 +27,31 @@ DEFINE_string(udp_interface_address,
               "0.0.0.0",
               "IP address of the interface over which to receive UDP unicast"
               " or multicast streams");
+DEFINE_uint64(udp_receive_buffer_size,
+              0,
+              "Socket receive buffer size (SO_RCVBUF) in bytes for UDP "
+              "streams. 0 keeps the system default. Larger buffers absorb "
+              "scheduling hiccups on high-rate streams.");
+DEFINE_bool(udp_reuse_port,
+            false,
+            "Set SO_REUSEPORT on UDP sockets, allowing multiple processes or "
+            "threads to bind the same multicast group and port and spread "
+            "reception across cores. Not supported on all platforms.");
+DEFINE_uint64(udp_receive_batch_size,
+              32,
+              "Maximum number of datagrams to receive per syscall, on "
+              "platforms with recvmmsg. 1 disables batching. Only effective "
+              "when the read buffer is large enough to hold multiple "
+              "maximum-size datagrams.");
+DEFINE_uint64(udp_rtp_jitter_buffer_packets,
+              0,
+              "Depth of the reordering buffer for RTP-encapsulated UDP "
+              "streams, in packets. Packets are reordered by RTP sequence "
+              "number before the demuxer sees them, so a reordered burst "
+              "does not force a TS parser resync; a missing packet stalls "
+              "delivery for at most this many packets before being declared "
+              "lost. 0 disables reordering. Ignored if the stream is not "
+              "RTP.");
 
 namespace shaka {
 namespace media {
@@ -32,6 +60,14 @@ namespace {
 
 const int kInvalidSocket(-1);
 
+// Maximum size of a UDP datagram; also the per-datagram slot size used for
+// batched reception.
+const uint64_t kMaxDatagramSize(65536);
+
+// Upper bound for --udp_receive_batch_size, so the reception arrays can live
+// on the stack.
+const uint64_t kMaxReceiveBatchSize(64);
+
 bool StringToIpv4Address(const std::string& addr_in, uint32_t* addr_out) {
   DCHECK(addr_out);
 
@@ -104,6 +140,74 @@ int64_t UdpFile::Read(void* buffer, uint64_t length) {
   if (socket_ == kInvalidSocket)
     return -1;
 
+  if (jitter_buffer_) {
+    // Receive single datagrams into the caller's buffer and run them
+    // through the reordering buffer; a payload is handed out as soon as one
+    // is deliverable in sequence order.
+    for (;;) {
+      const size_t payload_size = jitter_buffer_->NextPayload(
+          static_cast<uint8_t*>(buffer), length);
+      if (payload_size > 0)
+        return payload_size;
+
+      int64_t result;
+      do {
+        result = recvfrom(socket_, buffer, length, 0, NULL, 0);
+      } while ((result == -1) && (errno == EINTR));
+      if (result <= 0)
+        return result;
+
+      if (!jitter_buffer_->AddPacket(static_cast<const uint8_t*>(buffer),
+                                     result)) {
+        // Not RTP after all; deliver raw datagrams from here on.
+        LOG(WARNING) << "Stream " << file_name()
+                     << " does not look like RTP; disabling the jitter "
+                        "buffer.";
+        jitter_buffer_.reset();
+        return result;
+      }
+    }
+  }
+
+#if defined(OS_LINUX)
+  // Receive a batch of datagrams with a single syscall when the buffer has
+  // room for several maximum-size datagrams.
+  uint64_t num_slots =
+      std::min(std::min(FLAGS_udp_receive_batch_size, kMaxReceiveBatchSize),
+               length / kMaxDatagramSize);
+  if (num_slots > 1) {
+    struct mmsghdr msgs[kMaxReceiveBatchSize];
+    struct iovec iovs[kMaxReceiveBatchSize];
+    uint8_t* base = static_cast<uint8_t*>(buffer);
+    memset(msgs, 0, num_slots * sizeof(msgs[0]));
+    for (uint64_t i = 0; i < num_slots; ++i) {
+      iovs[i].iov_base = base + i * kMaxDatagramSize;
+      iovs[i].iov_len = kMaxDatagramSize;
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int num_received;
+    do {
+      // Block for the first datagram only; return with whatever else is
+      // already queued instead of waiting for a full batch.
+      num_received =
+          recvmmsg(socket_, msgs, num_slots, MSG_WAITFORONE, NULL);
+    } while ((num_received == -1) && (errno == EINTR));
+    if (num_received == -1)
+      return -1;
+
+    // Compact the datagrams so the caller sees one contiguous byte stream.
+    uint64_t total_size = msgs[0].msg_len;
+    for (int i = 1; i < num_received; ++i) {
+      memmove(base + total_size, base + i * kMaxDatagramSize,
+              msgs[i].msg_len);
+      total_size += msgs[i].msg_len;
+    }
+    return total_size;
+  }
+#endif  // defined(OS_LINUX)
+
   int64_t result;
   do {
     result = recvfrom(socket_, buffer, length, 0, NULL, 0);
@@ -182,6 +286,31 @@ bool UdpFile::Open() {
     return false;
   }
 
+  if (FLAGS_udp_reuse_port) {
+#if defined(SO_REUSEPORT)
+    const int optval(1);
+    if (setsockopt(new_socket.get(), SOL_SOCKET, SO_REUSEPORT, &optval,
+                   sizeof(optval)) < 0) {
+      LOG(ERROR) << "Could not set SO_REUSEPORT.";
+      return false;
+    }
+#else
+    LOG(ERROR) << "--udp_reuse_port is not supported on this platform.";
+    return false;
+#endif
+  }
+
+  if (FLAGS_udp_receive_buffer_size > 0) {
+    const int receive_buffer_size(std::min(
+        FLAGS_udp_receive_buffer_size,
+        static_cast<uint64_t>(std::numeric_limits<int>::max())));
+    if (setsockopt(new_socket.get(), SOL_SOCKET, SO_RCVBUF,
+                   &receive_buffer_size, sizeof(receive_buffer_size)) < 0) {
+      LOG(WARNING) << "Could not set SO_RCVBUF to "
+                   << receive_buffer_size << ".";
+    }
+  }
+
   struct sockaddr_in local_sock_addr;
   bzero(&local_sock_addr, sizeof(local_sock_addr));
   local_sock_addr.sin_family = AF_INET;
@@ -213,6 +342,11 @@ bool UdpFile::Open() {
     }
   }
 
+  if (FLAGS_udp_rtp_jitter_buffer_packets > 0) {
+    jitter_buffer_.reset(
+        new RtpJitterBuffer(FLAGS_udp_rtp_jitter_buffer_packets));
+  }
+
   socket_ = new_socket.release();
   return true;
 }
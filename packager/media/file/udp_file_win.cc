@@ -7,6 +7,7 @@
 #include "packager/media/file/udp_file.h"
 
 #include "packager/base/logging.h"
+#include "packager/media/file/rtp_jitter_buffer.h"
 
 namespace shaka {
 namespace media {
@@ -0,0 +1,42 @@
+# Copyright 2016 Google Inc. All rights reserved.
+#
+# Use of this source code is governed by a BSD-style
+# license that can be found in the LICENSE file or at
+# https://developers.google.com/open-source/licenses/bsd
+
+{
+  'includes': [
+    '../../../common.gypi',
+  ],
+  'targets': [
+    {
+      'target_name': 'escache',
+      'type': '<(component)',
+      'sources': [
+        'es_cache_format.h',
+        'es_cache_media_parser.cc',
+        'es_cache_media_parser.h',
+        'es_cache_writer.cc',
+        'es_cache_writer.h',
+      ],
+      'dependencies': [
+        '../../../base/base.gyp:base',
+        '../../base/media_base.gyp:media_base',
+        '../../file/file.gyp:file',
+      ],
+    },
+    {
+      'target_name': 'escache_unittest',
+      'type': '<(gtest_target_type)',
+      'sources': [
+        'es_cache_unittest.cc',
+      ],
+      'dependencies': [
+        '../../../testing/gmock.gyp:gmock',
+        '../../../testing/gtest.gyp:gtest',
+        '../../test/media_test.gyp:media_test_support',
+        'escache',
+      ]
+    },
+  ],
+}
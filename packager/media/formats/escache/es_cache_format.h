@@ -0,0 +1,55 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// Constants shared by the elementary-stream cache writer and parser.
+//
+// The cache is a compact serialization of what a demuxer emits: the parsed
+// StreamInfos followed by length-prefixed sample records. Re-packaging jobs
+// read it back with near-zero parse cost instead of demuxing the mezzanine
+// again. All integers are in network byte order (BufferWriter/BufferReader
+// convention).
+//
+// The format doubles as the trusted raw ingest interface for
+// encoder-adjacent deployments: an upstream encoder that already knows its
+// access unit boundaries and timing can emit this layout directly (select it
+// with input_format=escache in the stream descriptor) and samples are
+// constructed with no scanning at all. The layout is versioned and stable
+// within a version for that reason.
+//
+// Layout:
+//   magic (u32) | version (u8) | stream count (u8) | streams | samples
+//
+// Each stream starts with its StreamType (u8) followed by the common
+// StreamInfo fields and the type specific fields; strings and the codec
+// config are length prefixed. Each sample record is:
+//   track id (u32) | pts (s64) | dts (s64) | duration (s64) |
+//   key frame (u8) | data size (u32) | data | side data size (u32) | side data
+// A record with the reserved track id kEsCacheEndTrackId marks a cleanly
+// finalized cache; its absence means the writer died mid-write and the cache
+// must be rejected.
+
+#ifndef MEDIA_FORMATS_ESCACHE_ES_CACHE_FORMAT_H_
+#define MEDIA_FORMATS_ESCACHE_ES_CACHE_FORMAT_H_
+
+#include <stdint.h>
+
+namespace shaka {
+namespace media {
+
+/// File magic, "SPES" (Shaka Packager Elementary Stream).
+const uint32_t kEsCacheMagic = 0x53504553;
+
+/// Current format version. Bumped on any layout change; old caches are
+/// rejected and simply regenerated from the mezzanine.
+const uint8_t kEsCacheVersion = 1;
+
+/// Reserved track id marking the end-of-stream record.
+const uint32_t kEsCacheEndTrackId = 0xFFFFFFFF;
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_FORMATS_ESCACHE_ES_CACHE_FORMAT_H_
@@ -0,0 +1,257 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/escache/es_cache_media_parser.h"
+
+#include "packager/base/logging.h"
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/buffer_reader.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/rcheck.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/formats/escache/es_cache_format.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+// Reads a length-prefixed string. Sets |*need_more_data| if the buffered
+// bytes run out.
+bool ReadString(BufferReader* reader, std::string* str, bool* need_more_data) {
+  uint16_t length;
+  if (!reader->Read2(&length) || !reader->ReadToString(str, length)) {
+    *need_more_data = true;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+EsCacheMediaParser::EsCacheMediaParser()
+    : header_parsed_(false), end_record_seen_(false) {}
+
+EsCacheMediaParser::~EsCacheMediaParser() {}
+
+bool EsCacheMediaParser::IsEsCache(const uint8_t* buf, size_t size) {
+  BufferReader reader(buf, size);
+  uint32_t magic;
+  return reader.Read4(&magic) && magic == kEsCacheMagic;
+}
+
+void EsCacheMediaParser::Init(const InitCB& init_cb,
+                              const NewSampleCB& new_sample_cb,
+                              KeySource* decryption_key_source) {
+  DCHECK(init_cb_.is_null());
+  DCHECK(!init_cb.is_null());
+  DCHECK(!new_sample_cb.is_null());
+  // The cache stores samples exactly as the original demux emitted them, so
+  // no decryption is performed on read-back.
+  init_cb_ = init_cb;
+  new_sample_cb_ = new_sample_cb;
+}
+
+bool EsCacheMediaParser::Flush() {
+  if (!header_parsed_ || !end_record_seen_ || !buffer_.empty()) {
+    LOG(ERROR) << "Elementary-stream cache is truncated or corrupt; "
+                  "regenerate it from the original input.";
+    return false;
+  }
+  return true;
+}
+
+bool EsCacheMediaParser::Parse(const uint8_t* buf, int size) {
+  DCHECK(!init_cb_.is_null());
+  if (end_record_seen_) {
+    if (size > 0) {
+      LOG(ERROR) << "Unexpected data after the elementary-stream cache "
+                    "end-of-stream record.";
+      return false;
+    }
+    return true;
+  }
+  buffer_.insert(buffer_.end(), buf, buf + size);
+
+  size_t pos = 0;
+  while (pos < buffer_.size() && !end_record_seen_) {
+    BufferReader reader(buffer_.data() + pos, buffer_.size() - pos);
+    bool need_more_data = false;
+    if (!header_parsed_) {
+      if (!ParseHeader(&reader, &need_more_data))
+        return false;
+      if (need_more_data)
+        break;
+      header_parsed_ = true;
+    } else {
+      if (!ParseSampleRecord(&reader, &need_more_data))
+        return false;
+      if (need_more_data)
+        break;
+    }
+    pos += reader.pos();
+  }
+  if (end_record_seen_ && pos != buffer_.size()) {
+    LOG(ERROR) << "Unexpected data after the elementary-stream cache "
+                  "end-of-stream record.";
+    return false;
+  }
+  buffer_.erase(buffer_.begin(), buffer_.begin() + pos);
+  return true;
+}
+
+bool EsCacheMediaParser::ParseHeader(BufferReader* reader,
+                                     bool* need_more_data) {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t stream_count;
+  if (!reader->Read4(&magic) || !reader->Read1(&version) ||
+      !reader->Read1(&stream_count)) {
+    *need_more_data = true;
+    return true;
+  }
+  RCHECK(magic == kEsCacheMagic);
+  if (version != kEsCacheVersion) {
+    LOG(ERROR) << "Unsupported elementary-stream cache version "
+               << static_cast<int>(version) << "; regenerate the cache.";
+    return false;
+  }
+  RCHECK(stream_count > 0);
+
+  // The whole header is parsed in one pass: if the buffered bytes run out the
+  // partially constructed stream infos are discarded and the header is parsed
+  // again on the next call. The header is small, so the re-parse is cheap.
+  std::vector<scoped_refptr<StreamInfo> > stream_infos;
+  for (uint8_t i = 0; i < stream_count; ++i) {
+    uint8_t stream_type;
+    uint32_t track_id;
+    uint32_t time_scale;
+    uint64_t duration;
+    std::string codec_string;
+    std::string language;
+    uint8_t is_encrypted;
+    uint32_t codec_config_size;
+    std::vector<uint8_t> codec_config;
+    uint32_t codec;
+    if (!reader->Read1(&stream_type)) {
+      *need_more_data = true;
+      return true;
+    }
+    RCHECK(stream_type == kStreamAudio || stream_type == kStreamVideo);
+    if (!reader->Read4(&track_id) || !reader->Read4(&time_scale) ||
+        !reader->Read8(&duration) ||
+        !ReadString(reader, &codec_string, need_more_data) ||
+        !ReadString(reader, &language, need_more_data) ||
+        !reader->Read1(&is_encrypted) || !reader->Read4(&codec_config_size) ||
+        !reader->ReadToVector(&codec_config, codec_config_size) ||
+        !reader->Read4(&codec)) {
+      *need_more_data = true;
+      return true;
+    }
+    const uint8_t* codec_config_data =
+        codec_config.empty() ? NULL : codec_config.data();
+    if (stream_type == kStreamVideo) {
+      uint16_t width;
+      uint16_t height;
+      uint32_t pixel_width;
+      uint32_t pixel_height;
+      int16_t trick_play_rate;
+      uint8_t nalu_length_size;
+      if (!reader->Read2(&width) || !reader->Read2(&height) ||
+          !reader->Read4(&pixel_width) || !reader->Read4(&pixel_height) ||
+          !reader->Read2s(&trick_play_rate) ||
+          !reader->Read1(&nalu_length_size)) {
+        *need_more_data = true;
+        return true;
+      }
+      stream_infos.push_back(new VideoStreamInfo(
+          track_id, time_scale, duration, static_cast<VideoCodec>(codec),
+          codec_string, language, width, height, pixel_width, pixel_height,
+          trick_play_rate, nalu_length_size, codec_config_data,
+          codec_config.size(), is_encrypted != 0));
+    } else {
+      uint8_t sample_bits;
+      uint8_t num_channels;
+      uint32_t sampling_frequency;
+      uint64_t seek_preroll_ns;
+      uint64_t codec_delay_ns;
+      uint32_t max_bitrate;
+      uint32_t avg_bitrate;
+      if (!reader->Read1(&sample_bits) || !reader->Read1(&num_channels) ||
+          !reader->Read4(&sampling_frequency) ||
+          !reader->Read8(&seek_preroll_ns) || !reader->Read8(&codec_delay_ns) ||
+          !reader->Read4(&max_bitrate) || !reader->Read4(&avg_bitrate)) {
+        *need_more_data = true;
+        return true;
+      }
+      stream_infos.push_back(new AudioStreamInfo(
+          track_id, time_scale, duration, static_cast<AudioCodec>(codec),
+          codec_string, language, sample_bits, num_channels,
+          sampling_frequency, seek_preroll_ns, codec_delay_ns, max_bitrate,
+          avg_bitrate, codec_config_data, codec_config.size(),
+          is_encrypted != 0));
+    }
+  }
+  init_cb_.Run(stream_infos);
+  return true;
+}
+
+bool EsCacheMediaParser::ParseSampleRecord(BufferReader* reader,
+                                           bool* need_more_data) {
+  uint32_t track_id;
+  if (!reader->Read4(&track_id)) {
+    *need_more_data = true;
+    return true;
+  }
+  if (track_id == kEsCacheEndTrackId) {
+    end_record_seen_ = true;
+    return true;
+  }
+
+  int64_t pts;
+  int64_t dts;
+  int64_t duration;
+  uint8_t is_key_frame;
+  uint32_t data_size;
+  if (!reader->Read8s(&pts) || !reader->Read8s(&dts) ||
+      !reader->Read8s(&duration) || !reader->Read1(&is_key_frame) ||
+      !reader->Read4(&data_size)) {
+    *need_more_data = true;
+    return true;
+  }
+  RCHECK(data_size > 0);
+  if (!reader->HasBytes(data_size)) {
+    *need_more_data = true;
+    return true;
+  }
+  const uint8_t* data = reader->data() + reader->pos();
+  RCHECK(reader->SkipBytes(data_size));
+
+  uint32_t side_data_size;
+  if (!reader->Read4(&side_data_size)) {
+    *need_more_data = true;
+    return true;
+  }
+  if (!reader->HasBytes(side_data_size)) {
+    *need_more_data = true;
+    return true;
+  }
+  const uint8_t* side_data = reader->data() + reader->pos();
+  RCHECK(reader->SkipBytes(side_data_size));
+
+  scoped_refptr<MediaSample> sample =
+      side_data_size > 0
+          ? MediaSample::CopyFrom(data, data_size, side_data, side_data_size,
+                                  is_key_frame != 0)
+          : MediaSample::CopyFrom(data, data_size, is_key_frame != 0);
+  sample->set_pts(pts);
+  sample->set_dts(dts);
+  sample->set_duration(duration);
+  RCHECK(new_sample_cb_.Run(track_id, sample));
+  return true;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,65 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_FORMATS_ESCACHE_ES_CACHE_MEDIA_PARSER_H_
+#define MEDIA_FORMATS_ESCACHE_ES_CACHE_MEDIA_PARSER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "packager/media/base/media_parser.h"
+
+namespace shaka {
+namespace media {
+
+class BufferReader;
+
+/// Reads back an elementary-stream cache file (see es_cache_format.h).
+/// Stream configurations and samples are deserialized directly, bypassing the
+/// container and codec parsers entirely.
+class EsCacheMediaParser : public MediaParser {
+ public:
+  EsCacheMediaParser();
+  ~EsCacheMediaParser() override;
+
+  /// @return true if @a buf starts with the elementary-stream cache magic.
+  static bool IsEsCache(const uint8_t* buf, size_t size);
+
+  /// @name MediaParser implementation overrides.
+  /// @{
+  void Init(const InitCB& init_cb,
+            const NewSampleCB& new_sample_cb,
+            KeySource* decryption_key_source) override;
+  bool Flush() override WARN_UNUSED_RESULT;
+  bool Parse(const uint8_t* buf, int size) override WARN_UNUSED_RESULT;
+  /// @}
+
+ private:
+  // Parses the header including all stream configurations and fires the init
+  // callback. Returns false on error; sets |*need_more_data| if the buffered
+  // bytes do not yet contain the whole header.
+  bool ParseHeader(BufferReader* reader, bool* need_more_data);
+
+  // Parses one sample record and fires the sample callback. Returns false on
+  // error; sets |*need_more_data| if the record is incomplete.
+  bool ParseSampleRecord(BufferReader* reader, bool* need_more_data);
+
+  InitCB init_cb_;
+  NewSampleCB new_sample_cb_;
+
+  // Bytes received but not yet consumed.
+  std::vector<uint8_t> buffer_;
+  bool header_parsed_;
+  bool end_record_seen_;
+
+  DISALLOW_COPY_AND_ASSIGN(EsCacheMediaParser);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_FORMATS_ESCACHE_ES_CACHE_MEDIA_PARSER_H_
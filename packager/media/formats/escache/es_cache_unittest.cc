@@ -0,0 +1,169 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "packager/base/bind.h"
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/file/file.h"
+#include "packager/media/formats/escache/es_cache_media_parser.h"
+#include "packager/media/formats/escache/es_cache_writer.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const char kCacheFile[] = "memory://test/es_cache.spes";
+
+const uint8_t kVideoCodecConfig[] = {0x01, 0x64, 0x00, 0x1f, 0xff};
+const uint8_t kAudioCodecConfig[] = {0x12, 0x10};
+const uint8_t kVideoFrame[] = {0x00, 0x00, 0x00, 0x04, 0x65, 0x01, 0x02, 0x03};
+const uint8_t kAudioFrame[] = {0x21, 0x1a, 0xd4};
+
+}  // namespace
+
+class EsCacheTest : public testing::Test {
+ public:
+  void OnInit(const std::vector<scoped_refptr<StreamInfo> >& stream_infos) {
+    stream_infos_ = stream_infos;
+  }
+
+  bool OnNewSample(uint32_t track_id,
+                   const scoped_refptr<MediaSample>& sample) {
+    track_ids_.push_back(track_id);
+    samples_.push_back(sample);
+    return true;
+  }
+
+ protected:
+  void TearDown() override { File::Delete(kCacheFile); }
+
+  void WriteCache(bool finalize) {
+    std::vector<scoped_refptr<StreamInfo> > stream_infos;
+    stream_infos.push_back(new VideoStreamInfo(
+        1, 90000, 180000, kCodecH264, "avc1.64001f", "", 1280, 720, 1, 1, 0, 4,
+        kVideoCodecConfig, sizeof(kVideoCodecConfig), false));
+    stream_infos.push_back(new AudioStreamInfo(
+        2, 44100, 88200, kCodecAAC, "mp4a.40.2", "eng", 16, 2, 44100, 0, 0,
+        128000, 96000, kAudioCodecConfig, sizeof(kAudioCodecConfig), false));
+
+    EsCacheWriter writer(kCacheFile);
+    ASSERT_TRUE(writer.Open());
+    ASSERT_TRUE(writer.WriteStreamInfos(stream_infos));
+
+    scoped_refptr<MediaSample> video_sample =
+        MediaSample::CopyFrom(kVideoFrame, sizeof(kVideoFrame), true);
+    video_sample->set_pts(3000);
+    video_sample->set_dts(0);
+    video_sample->set_duration(3000);
+    ASSERT_TRUE(writer.WriteSample(1, video_sample));
+
+    scoped_refptr<MediaSample> audio_sample =
+        MediaSample::CopyFrom(kAudioFrame, sizeof(kAudioFrame), false);
+    audio_sample->set_pts(1024);
+    audio_sample->set_dts(1024);
+    audio_sample->set_duration(1024);
+    ASSERT_TRUE(writer.WriteSample(2, audio_sample));
+
+    if (finalize)
+      ASSERT_TRUE(writer.Close());
+  }
+
+  // Feeds the cache contents to the parser in small chunks to exercise
+  // incremental parsing, then returns the result of Flush().
+  bool ParseCache(size_t chunk_size) {
+    std::string contents;
+    if (!File::ReadFileToString(kCacheFile, &contents))
+      return false;
+    EsCacheMediaParser parser;
+    parser.Init(base::Bind(&EsCacheTest::OnInit, base::Unretained(this)),
+                base::Bind(&EsCacheTest::OnNewSample, base::Unretained(this)),
+                NULL);
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(contents.data());
+    for (size_t pos = 0; pos < contents.size(); pos += chunk_size) {
+      const size_t size = std::min(chunk_size, contents.size() - pos);
+      if (!parser.Parse(data + pos, size))
+        return false;
+    }
+    return parser.Flush();
+  }
+
+  std::vector<scoped_refptr<StreamInfo> > stream_infos_;
+  std::vector<uint32_t> track_ids_;
+  std::vector<scoped_refptr<MediaSample> > samples_;
+};
+
+TEST_F(EsCacheTest, RoundTrip) {
+  WriteCache(true);
+  ASSERT_TRUE(ParseCache(7));
+
+  ASSERT_EQ(2u, stream_infos_.size());
+  EXPECT_EQ(kStreamVideo, stream_infos_[0]->stream_type());
+  EXPECT_EQ(1u, stream_infos_[0]->track_id());
+  EXPECT_EQ(90000u, stream_infos_[0]->time_scale());
+  EXPECT_EQ(180000u, stream_infos_[0]->duration());
+  EXPECT_EQ("avc1.64001f", stream_infos_[0]->codec_string());
+  const VideoStreamInfo* video =
+      static_cast<const VideoStreamInfo*>(stream_infos_[0].get());
+  EXPECT_EQ(kCodecH264, video->codec());
+  EXPECT_EQ(1280u, video->width());
+  EXPECT_EQ(720u, video->height());
+  EXPECT_EQ(4u, video->nalu_length_size());
+  EXPECT_EQ(std::vector<uint8_t>(
+                kVideoCodecConfig,
+                kVideoCodecConfig + sizeof(kVideoCodecConfig)),
+            video->codec_config());
+
+  EXPECT_EQ(kStreamAudio, stream_infos_[1]->stream_type());
+  EXPECT_EQ("eng", stream_infos_[1]->language());
+  const AudioStreamInfo* audio =
+      static_cast<const AudioStreamInfo*>(stream_infos_[1].get());
+  EXPECT_EQ(kCodecAAC, audio->codec());
+  EXPECT_EQ(2u, audio->num_channels());
+  EXPECT_EQ(44100u, audio->sampling_frequency());
+  EXPECT_EQ(128000u, audio->max_bitrate());
+  EXPECT_EQ(96000u, audio->avg_bitrate());
+
+  ASSERT_EQ(2u, samples_.size());
+  EXPECT_EQ(1u, track_ids_[0]);
+  EXPECT_TRUE(samples_[0]->is_key_frame());
+  EXPECT_EQ(3000, samples_[0]->pts());
+  EXPECT_EQ(0, samples_[0]->dts());
+  EXPECT_EQ(3000, samples_[0]->duration());
+  ASSERT_EQ(sizeof(kVideoFrame), samples_[0]->data_size());
+  EXPECT_EQ(0, memcmp(kVideoFrame, samples_[0]->data(), sizeof(kVideoFrame)));
+
+  EXPECT_EQ(2u, track_ids_[1]);
+  EXPECT_FALSE(samples_[1]->is_key_frame());
+  ASSERT_EQ(sizeof(kAudioFrame), samples_[1]->data_size());
+  EXPECT_EQ(0, memcmp(kAudioFrame, samples_[1]->data(), sizeof(kAudioFrame)));
+}
+
+TEST_F(EsCacheTest, RejectsUnfinalizedCache) {
+  // Without Close() there is no end-of-stream record, so the cache must be
+  // treated as truncated.
+  WriteCache(false);
+  EXPECT_FALSE(ParseCache(64));
+}
+
+TEST_F(EsCacheTest, IsEsCache) {
+  WriteCache(true);
+  std::string contents;
+  ASSERT_TRUE(File::ReadFileToString(kCacheFile, &contents));
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(contents.data());
+  EXPECT_TRUE(EsCacheMediaParser::IsEsCache(data, contents.size()));
+
+  const uint8_t kNotACache[] = {'f', 't', 'y', 'p'};
+  EXPECT_FALSE(EsCacheMediaParser::IsEsCache(kNotACache, sizeof(kNotACache)));
+}
+
+}  // namespace media
+}  // namespace shaka
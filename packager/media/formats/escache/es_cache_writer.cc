@@ -0,0 +1,144 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/escache/es_cache_writer.h"
+
+#include "packager/base/logging.h"
+#include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/file/file.h"
+#include "packager/media/formats/escache/es_cache_format.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+void AppendString(const std::string& str, BufferWriter* writer) {
+  DCHECK_LE(str.size(), 0xFFFFu);
+  writer->AppendInt(static_cast<uint16_t>(str.size()));
+  writer->AppendArray(reinterpret_cast<const uint8_t*>(str.data()), str.size());
+}
+
+}  // namespace
+
+EsCacheWriter::EsCacheWriter(const std::string& file_path)
+    : file_path_(file_path), file_(NULL) {}
+
+EsCacheWriter::~EsCacheWriter() {
+  // Closing without the end-of-stream record leaves the cache truncated,
+  // which the parser rejects; a partial cache is never mistaken for a
+  // complete one.
+  if (file_)
+    file_->Close();
+}
+
+bool EsCacheWriter::Open() {
+  DCHECK(!file_);
+  file_ = File::Open(file_path_.c_str(), "w");
+  if (!file_) {
+    LOG(ERROR) << "Cannot open elementary-stream cache file for writing: "
+               << file_path_;
+    return false;
+  }
+  buffer_.AppendInt(kEsCacheMagic);
+  buffer_.AppendInt(kEsCacheVersion);
+  return true;
+}
+
+bool EsCacheWriter::WriteStreamInfos(
+    const std::vector<scoped_refptr<StreamInfo> >& stream_infos) {
+  DCHECK(file_);
+  DCHECK_LT(stream_infos.size(), 0x100u);
+  buffer_.AppendInt(static_cast<uint8_t>(stream_infos.size()));
+  for (size_t i = 0; i < stream_infos.size(); ++i) {
+    const StreamInfo& info = *stream_infos[i];
+    if (info.stream_type() != kStreamAudio &&
+        info.stream_type() != kStreamVideo) {
+      LOG(INFO) << "Stream type " << info.stream_type()
+                << " is not cacheable.";
+      return false;
+    }
+    buffer_.AppendInt(static_cast<uint8_t>(info.stream_type()));
+    buffer_.AppendInt(info.track_id());
+    buffer_.AppendInt(info.time_scale());
+    buffer_.AppendInt(info.duration());
+    AppendString(info.codec_string(), &buffer_);
+    AppendString(info.language(), &buffer_);
+    buffer_.AppendInt(static_cast<uint8_t>(info.is_encrypted() ? 1 : 0));
+    DCHECK_LE(info.codec_config().size(), 0xFFFFFFFFu);
+    buffer_.AppendInt(static_cast<uint32_t>(info.codec_config().size()));
+    buffer_.AppendVector(info.codec_config());
+    if (info.stream_type() == kStreamVideo) {
+      const VideoStreamInfo& video = static_cast<const VideoStreamInfo&>(info);
+      buffer_.AppendInt(static_cast<uint32_t>(video.codec()));
+      buffer_.AppendInt(video.width());
+      buffer_.AppendInt(video.height());
+      buffer_.AppendInt(video.pixel_width());
+      buffer_.AppendInt(video.pixel_height());
+      buffer_.AppendInt(video.trick_play_rate());
+      buffer_.AppendInt(video.nalu_length_size());
+    } else {
+      const AudioStreamInfo& audio = static_cast<const AudioStreamInfo&>(info);
+      buffer_.AppendInt(static_cast<uint32_t>(audio.codec()));
+      buffer_.AppendInt(audio.sample_bits());
+      buffer_.AppendInt(audio.num_channels());
+      buffer_.AppendInt(audio.sampling_frequency());
+      buffer_.AppendInt(audio.seek_preroll_ns());
+      buffer_.AppendInt(audio.codec_delay_ns());
+      buffer_.AppendInt(audio.max_bitrate());
+      buffer_.AppendInt(audio.avg_bitrate());
+    }
+  }
+  return FlushBuffer();
+}
+
+bool EsCacheWriter::WriteSample(uint32_t track_id,
+                                const scoped_refptr<MediaSample>& sample) {
+  DCHECK(file_);
+  DCHECK(!sample->end_of_stream());
+  DCHECK_NE(kEsCacheEndTrackId, track_id);
+  buffer_.AppendInt(track_id);
+  buffer_.AppendInt(sample->pts());
+  buffer_.AppendInt(sample->dts());
+  buffer_.AppendInt(sample->duration());
+  buffer_.AppendInt(static_cast<uint8_t>(sample->is_key_frame() ? 1 : 0));
+  buffer_.AppendInt(static_cast<uint32_t>(sample->data_size()));
+  buffer_.AppendArray(sample->data(), sample->data_size());
+  const uint32_t side_data_size =
+      static_cast<uint32_t>(sample->side_data_size());
+  buffer_.AppendInt(side_data_size);
+  if (side_data_size > 0)
+    buffer_.AppendArray(sample->side_data(), side_data_size);
+  return FlushBuffer();
+}
+
+bool EsCacheWriter::Close() {
+  DCHECK(file_);
+  buffer_.AppendInt(kEsCacheEndTrackId);
+  if (!FlushBuffer())
+    return false;
+  File* file = file_;
+  file_ = NULL;
+  if (!file->Close()) {
+    LOG(ERROR) << "Cannot close elementary-stream cache file: " << file_path_;
+    return false;
+  }
+  return true;
+}
+
+bool EsCacheWriter::FlushBuffer() {
+  Status status = buffer_.WriteToFile(file_);
+  if (!status.ok()) {
+    LOG(ERROR) << "Cannot write elementary-stream cache file " << file_path_
+               << ": " << status.ToString();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace media
+}  // namespace shaka
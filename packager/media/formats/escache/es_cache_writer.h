@@ -0,0 +1,68 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_FORMATS_ESCACHE_ES_CACHE_WRITER_H_
+#define MEDIA_FORMATS_ESCACHE_ES_CACHE_WRITER_H_
+
+#include <string>
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/base/memory/ref_counted.h"
+#include "packager/media/base/buffer_writer.h"
+
+namespace shaka {
+namespace media {
+
+class File;
+class MediaSample;
+class StreamInfo;
+
+/// Writes an elementary-stream cache file (see es_cache_format.h) as a tee of
+/// the demuxer's init and sample events. Caching is best effort: any failure
+/// should be reported and the writer dropped without failing the packaging
+/// job. A cache that is not finalized with Close() is left truncated and is
+/// rejected by the parser on read-back.
+class EsCacheWriter {
+ public:
+  explicit EsCacheWriter(const std::string& file_path);
+  ~EsCacheWriter();
+
+  /// Open the cache file for writing and write the file header.
+  /// @return true on success.
+  bool Open();
+
+  /// Serialize the stream configurations. Must be called exactly once, before
+  /// any samples.
+  /// @return true on success, false on write failure or if any stream type is
+  ///         not cacheable (e.g. text).
+  bool WriteStreamInfos(
+      const std::vector<scoped_refptr<StreamInfo> >& stream_infos);
+
+  /// Append one sample record.
+  /// @return true on success.
+  bool WriteSample(uint32_t track_id, const scoped_refptr<MediaSample>& sample);
+
+  /// Write the end-of-stream record and close the file, marking the cache as
+  /// complete.
+  /// @return true on success.
+  bool Close();
+
+ private:
+  // Flushes |buffer_| to |file_| and clears it.
+  bool FlushBuffer();
+
+  const std::string file_path_;
+  File* file_;
+  BufferWriter buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(EsCacheWriter);
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_FORMATS_ESCACHE_ES_CACHE_WRITER_H_
@@ -41,6 +41,12 @@ class EsParser {
   // Reset the state of the ES parser.
   virtual void Reset() = 0;
 
+  // Drop buffered ES bytes after a TS discontinuity but keep the acquired
+  // stream context (decoder configs, parameter sets, timestamp helpers), so
+  // that emission resumes at the next access unit - for video, at the next
+  // key frame - instead of after a full reacquisition.
+  virtual void ResetOnDiscontinuity() = 0;
+
   uint32_t pid() { return pid_; }
 
  private:
@@ -5,6 +5,7 @@
 #include "packager/media/formats/mp2t/es_parser_adts.h"
 
 #include <stdint.h>
+#include <string.h>
 
 #include <list>
 
@@ -28,6 +29,9 @@ static bool isAdtsSyncWord(const uint8_t* buf) {
 }
 
 // Look for an ADTS syncword.
+// |known_frame_size| is the frame size already validated at |pos| by an
+// earlier scan (0 if unknown); it skips re-validating the syncword and
+// re-reading the frame size for that offset.
 // |new_pos| returns
 // - either the byte position of the ADTS frame (if found)
 // - or the byte position of 1st byte that was not processed (if not found).
@@ -37,6 +41,7 @@ static bool isAdtsSyncWord(const uint8_t* buf) {
 static bool LookForSyncWord(const uint8_t* raw_es,
                             int raw_es_size,
                             int pos,
+                            int known_frame_size,
                             int* new_pos,
                             int* frame_sz) {
   DCHECK_GE(pos, 0);
@@ -57,16 +62,22 @@ static bool LookForSyncWord(const uint8_t* raw_es,
   for (int offset = pos; offset < max_offset; offset++) {
     const uint8_t* cur_buf = &raw_es[offset];
 
-    if (!isAdtsSyncWord(cur_buf))
-      // The first 12 bits must be 1.
-      // The layer field (2 bits) must be set to 0.
-      continue;
-
-    int frame_size =
-        mp2t::AdtsHeader::GetAdtsFrameSize(cur_buf, kAdtsHeaderMinSize);
-    if (frame_size < kAdtsHeaderMinSize) {
-      // Too short to be an ADTS frame.
-      continue;
+    int frame_size;
+    if (offset == pos && known_frame_size > 0) {
+      // The header at this offset was validated by an earlier scan.
+      frame_size = known_frame_size;
+    } else {
+      if (!isAdtsSyncWord(cur_buf))
+        // The first 12 bits must be 1.
+        // The layer field (2 bits) must be set to 0.
+        continue;
+
+      frame_size =
+          mp2t::AdtsHeader::GetAdtsFrameSize(cur_buf, kAdtsHeaderMinSize);
+      if (frame_size < kAdtsHeaderMinSize) {
+        // Too short to be an ADTS frame.
+        continue;
+      }
     }
 
     // Check whether there is another frame
@@ -95,7 +106,9 @@ EsParserAdts::EsParserAdts(uint32_t pid,
     : EsParser(pid),
       new_stream_info_cb_(new_stream_info_cb),
       emit_sample_cb_(emit_sample_cb),
-      sbr_in_mimetype_(sbr_in_mimetype) {
+      sbr_in_mimetype_(sbr_in_mimetype),
+      pending_frame_size_(0) {
+  memset(last_fixed_header_, 0, sizeof(last_fixed_header_));
 }
 
 EsParserAdts::~EsParserAdts() {
@@ -122,8 +135,14 @@ bool EsParserAdts::Parse(const uint8_t* buf,
   // Look for every ADTS frame in the ES buffer starting at offset = 0
   int es_position = 0;
   int frame_size;
+  // Frame size validated at the head of the ES buffer by an earlier Parse
+  // call, or 0 if unknown. It saves re-scanning the header of a frame whose
+  // payload arrives across several calls.
+  int validated_frame_size = pending_frame_size_;
+  pending_frame_size_ = 0;
   while (LookForSyncWord(raw_es, raw_es_size, es_position,
-                         &es_position, &frame_size)) {
+                         validated_frame_size, &es_position, &frame_size)) {
+    validated_frame_size = 0;
     const uint8_t* frame_ptr = raw_es + es_position;
     DVLOG(LOG_LEVEL_ES)
         << "ADTS syncword @ pos=" << es_position
@@ -132,10 +151,14 @@ bool EsParserAdts::Parse(const uint8_t* buf,
         << "ADTS header: "
         << base::HexEncode(frame_ptr, kAdtsHeaderMinSize);
 
-    // Do not process the frame if this one is a partial frame.
+    // Do not process the frame if this one is a partial frame. Remember its
+    // size so the next Parse call resumes here without re-scanning the
+    // header.
     int remaining_size = raw_es_size - es_position;
-    if (frame_size > remaining_size)
+    if (frame_size > remaining_size) {
+      pending_frame_size_ = frame_size;
       break;
+    }
 
     size_t header_size = AdtsHeader::GetAdtsHeaderSize(frame_ptr, frame_size);
 
@@ -175,6 +198,11 @@ bool EsParserAdts::Parse(const uint8_t* buf,
     es_position += frame_size;
   }
 
+  // If the scan exited without examining any byte (not enough data beyond
+  // the validated head frame), keep the validated size for the next call.
+  if (validated_frame_size > 0 && es_position == 0)
+    pending_frame_size_ = validated_frame_size;
+
   // Discard all the bytes that have been processed.
   DiscardEs(es_position);
 
@@ -188,12 +216,33 @@ void EsParserAdts::Reset() {
   es_byte_queue_.Reset();
   pts_list_.clear();
   last_audio_decoder_config_ = scoped_refptr<AudioStreamInfo>();
+  pending_frame_size_ = 0;
+}
+
+void EsParserAdts::ResetOnDiscontinuity() {
+  // Drop the buffered ES bytes but keep the accepted audio config and the
+  // timestamp helper: the first PES after the discontinuity carries a PTS
+  // that rebases the helper before any frame is emitted.
+  es_byte_queue_.Reset();
+  pts_list_.clear();
+  pending_frame_size_ = 0;
 }
 
 bool EsParserAdts::UpdateAudioConfiguration(const uint8_t* adts_frame,
                                             size_t adts_frame_size) {
   const uint8_t kAacSampleSizeBits(16);
 
+  // Every field the audio configuration depends on lives in the
+  // adts_fixed_header, i.e. the first 28 bits of the frame. Consecutive
+  // frames almost always carry a byte-identical fixed header, so compare it
+  // against the last accepted one before re-parsing the header.
+  const uint8_t fixed_header[4] = {adts_frame[0], adts_frame[1], adts_frame[2],
+                                   static_cast<uint8_t>(adts_frame[3] & 0xf0)};
+  if (last_audio_decoder_config_ &&
+      memcmp(fixed_header, last_fixed_header_, sizeof(fixed_header)) == 0) {
+    return true;
+  }
+
   AdtsHeader adts_header;
   if (!adts_header.Parse(adts_frame, adts_frame_size)) {
     LOG(ERROR) << "Error parsing ADTS frame header.";
@@ -203,6 +252,8 @@ bool EsParserAdts::UpdateAudioConfiguration(const uint8_t* adts_frame,
   if (!adts_header.GetAudioSpecificConfig(&audio_specific_config))
     return false;
 
+  memcpy(last_fixed_header_, fixed_header, sizeof(last_fixed_header_));
+
   if (last_audio_decoder_config_) {
     // Verify that the audio decoder config has not changed.
     if (last_audio_decoder_config_->codec_config() == audio_specific_config) {
@@ -34,6 +34,7 @@ class EsParserAdts : public EsParser {
   bool Parse(const uint8_t* buf, int size, int64_t pts, int64_t dts) override;
   void Flush() override;
   void Reset() override;
+  void ResetOnDiscontinuity() override;
 
  private:
   // Used to link a PTS with a byte position in the ES stream.
@@ -69,6 +70,17 @@ class EsParserAdts : public EsParser {
 
   scoped_refptr<StreamInfo> last_audio_decoder_config_;
 
+  // Size of a validated ADTS frame whose payload has not fully arrived yet.
+  // The frame starts at the head of the ES queue; 0 if there is none. It
+  // lets Parse resume without re-scanning the frame header on every call
+  // while the payload trickles in.
+  int pending_frame_size_;
+
+  // The adts_fixed_header of the last frame whose configuration was
+  // accepted, with the bits of the variable header masked out of the last
+  // byte. Valid only when |last_audio_decoder_config_| is set.
+  uint8_t last_fixed_header_[4];
+
   DISALLOW_COPY_AND_ASSIGN(EsParserAdts);
 };
 
@@ -73,6 +73,13 @@ bool EsParserH264::ProcessNalu(const Nalu& nalu,
     case Nalu::H264_NonIDRSlice: {
       *is_key_frame = (nalu.type() == Nalu::H264_IDRSlice);
       DVLOG(LOG_LEVEL_ES) << "Nalu: slice IDR=" << is_key_frame;
+      // The key frame flag above only needs the NAL unit type. The slice
+      // header is parsed solely for the PPS id consumed by
+      // UpdateVideoDecoderConfig, so skip it when no decoder config check is
+      // pending or when an earlier slice of this access unit already
+      // provided the id.
+      if (!decoder_config_check_pending_ || *pps_id_for_access_unit >= 0)
+        break;
       H264SliceHeader shdr;
       if (h264_parser_->ParseSliceHeader(nalu, &shdr) != H264Parser::kOk) {
         // Only accept an invalid SPS/PPS at the beginning when the stream
@@ -77,6 +77,13 @@ bool EsParserH265::ProcessNalu(const Nalu& nalu,
         *is_key_frame = nalu.type() == Nalu::H265_IDR_W_RADL ||
                         nalu.type() == Nalu::H265_IDR_N_LP;
         DVLOG(LOG_LEVEL_ES) << "Nalu: slice KeyFrame=" << is_key_frame;
+        // The key frame flag above only needs the NAL unit type. The slice
+        // header is parsed solely for the PPS id consumed by
+        // UpdateVideoDecoderConfig, so skip it when no decoder config check
+        // is pending or when an earlier slice of this access unit already
+        // provided the id.
+        if (!decoder_config_check_pending_ || *pps_id_for_access_unit >= 0)
+          break;
         H265SliceHeader shdr;
         if (h265_parser_->ParseSliceHeader(nalu, &shdr) != H265Parser::kOk) {
           // Only accept an invalid SPS/PPS at the beginning when the stream
@@ -25,6 +25,13 @@ const int kStartCodeSize = 3;
 const int kH264NaluHeaderSize = 1;
 const int kH265NaluHeaderSize = 2;
 
+// Limit on the ES bytes buffered without emitting an access unit. The queue
+// is trimmed whenever an access unit completes, so it only grows past a few
+// frames when the stream misbehaves: garbage with no start codes, no VCL NAL
+// units, etc. When the limit is hit, the buffered bytes are dropped and
+// parsing restarts at the next key frame instead of growing without bound.
+const int64_t kMaxPendingEsBytes = 32 * 1024 * 1024;
+
 }  // namespace
 
 
@@ -81,7 +88,18 @@ bool EsParserH26x::Parse(const uint8_t* buf,
   DCHECK(!access_unit_nalus_.empty());
   DCHECK(access_unit_nalus_.front().nalu.can_start_access_unit());
 
-  return ParseInternal();
+  if (!ParseInternal())
+    return false;
+
+  // Enforce the cap on the ES buffer; see kMaxPendingEsBytes.
+  const int64_t pending_bytes = es_queue_->tail() - es_queue_->head();
+  if (pending_bytes > kMaxPendingEsBytes) {
+    LOG(WARNING) << "Dropping " << pending_bytes
+                 << " buffered ES bytes without a complete access unit for "
+                 << "PID " << pid() << "; resuming at the next key frame.";
+    Reset();
+  }
+  return true;
 }
 
 void EsParserH26x::Flush() {
@@ -126,6 +144,16 @@ void EsParserH26x::Reset() {
   waiting_for_key_frame_ = true;
 }
 
+void EsParserH26x::ResetOnDiscontinuity() {
+  // Calling Reset() non-virtually drops only the buffered ES bytes and arms
+  // the key frame wait. The stream converter and the parameter set/decoder
+  // config state of the codec-specific subclass are kept, so the next key
+  // frame can be emitted even if its access unit does not repeat the
+  // SPS/PPS. A changed configuration is still caught: in-band parameter
+  // sets are always parsed and trigger a decoder config check.
+  EsParserH26x::Reset();
+}
+
 bool EsParserH26x::SkipToFirstAccessUnit() {
   DCHECK(access_unit_nalus_.empty());
   while (access_unit_nalus_.empty()) {
@@ -164,7 +192,10 @@ bool EsParserH26x::SearchForNextNalu() {
   const int64_t next_nalu_size = es_size - start_code_offset - start_code_size;
   if (next_nalu_size <
       (type_ == Nalu::kH264 ? kH264NaluHeaderSize : kH265NaluHeaderSize)) {
-    // There was not enough data, wait for more.
+    // There was not enough data, wait for more. The bytes before the start
+    // code have been searched already, so resume at the start code itself
+    // instead of re-scanning them on the next call.
+    current_search_position_ += start_code_offset;
     return false;
   }
 
@@ -37,6 +37,7 @@ class EsParserH26x : public EsParser {
   bool Parse(const uint8_t* buf, int size, int64_t pts, int64_t dts) override;
   void Flush() override;
   void Reset() override;
+  void ResetOnDiscontinuity() override;
 
  protected:
   const H26xByteToUnitStreamConverter* stream_converter() const {
@@ -59,6 +59,12 @@ class PidState {
   void Disable();
   bool IsEnabled() const;
 
+  // Skip the per-packet continuity-counter check; see
+  // Mp2tMediaParser::set_trusted_input().
+  void set_trusted_input(bool trusted_input) {
+    trusted_input_ = trusted_input;
+  }
+
   PidType pid_type() const { return pid_type_; }
 
   scoped_refptr<StreamInfo>& config() { return config_; }
@@ -74,6 +80,7 @@ class PidState {
   scoped_ptr<TsSection> section_parser_;
 
   bool enable_;
+  bool trusted_input_;
   int continuity_counter_;
   scoped_refptr<StreamInfo> config_;
   SampleQueue sample_queue_;
@@ -85,6 +92,7 @@ PidState::PidState(int pid, PidType pid_type,
       pid_type_(pid_type),
       section_parser_(section_parser.Pass()),
       enable_(false),
+      trusted_input_(false),
       continuity_counter_(-1) {
   DCHECK(section_parser_);
 }
@@ -97,12 +105,31 @@ bool PidState::PushTsPacket(const TsPacket& ts_packet) {
   if (!enable_)
     return true;
 
-  int expected_continuity_counter = (continuity_counter_ + 1) % 16;
-  if (continuity_counter_ >= 0 &&
-      ts_packet.continuity_counter() != expected_continuity_counter) {
-    DVLOG(1) << "TS discontinuity detected for pid: " << pid_;
-    // TODO(tinskip): Handle discontinuity better.
-    return false;
+  // The continuity counter only advances on packets that carry payload;
+  // adaptation-field-only packets (e.g. PCR carriers) repeat the previous
+  // value and are excluded from the check.
+  if (!trusted_input_ && ts_packet.payload_size() > 0) {
+    int expected_continuity_counter = (continuity_counter_ + 1) % 16;
+    if (continuity_counter_ >= 0 &&
+        ts_packet.continuity_counter() != expected_continuity_counter) {
+      // The spec allows a packet to be transmitted twice; discard the
+      // duplicate without disturbing the section parser.
+      if (ts_packet.continuity_counter() == continuity_counter_)
+        return true;
+      DVLOG(1) << "TS discontinuity detected for pid: " << pid_;
+      // An unsignalled discontinuity means packet loss rather than a splice
+      // point; recovery is the same but it is worth a warning.
+      LOG_IF(WARNING, !ts_packet.discontinuity_indicator())
+          << "Unsignalled TS discontinuity for pid: " << pid_;
+      // Resync instead of failing the parse: only the partially reassembled
+      // section is dropped, while the acquired stream context (parsed
+      // tables, codec configs, parameter sets, timestamp unroll state) is
+      // kept. Parsing restarts at the next payload unit start, so sample
+      // emission resumes at the first key frame after the discontinuity
+      // instead of after a full reacquisition.
+      section_parser_->ResetOnDiscontinuity();
+    }
+    continuity_counter_ = ts_packet.continuity_counter();
   }
 
   bool status = section_parser_->Parse(
@@ -148,7 +175,12 @@ void PidState::ResetState() {
 
 Mp2tMediaParser::Mp2tMediaParser()
     : sbr_in_mimetype_(false),
+      select_audio_(true),
+      select_video_(true),
+      trusted_input_(false),
       is_initialized_(false) {
+  // Until the PAT maps a program, it is the only PID of interest.
+  pid_filter_.set(TsSection::kPidPat);
 }
 
 Mp2tMediaParser::~Mp2tMediaParser() {
@@ -184,6 +216,10 @@ bool Mp2tMediaParser::Flush() {
   // Remove any bytes left in the TS buffer.
   // (i.e. any partial TS packet => less than 188 bytes).
   ts_byte_queue_.Reset();
+
+  // The PID states are gone; start over from the PAT.
+  pid_filter_.reset();
+  pid_filter_.set(TsSection::kPidPat);
   return result;
 }
 
@@ -209,6 +245,17 @@ bool Mp2tMediaParser::Parse(const uint8_t* buf, int size) {
       continue;
     }
 
+    // Cheap PID pre-filter: the PID sits at a fixed offset in the header, so
+    // packets for PIDs nobody tracks (null packets, SI tables that are
+    // ignored, other programs of an MPTS) are dropped whole before a TsPacket
+    // is even constructed.
+    const int pid = ((ts_buffer[1] & 0x1F) << 8) | ts_buffer[2];
+    if (!pid_filter_.test(pid)) {
+      DVLOG(LOG_LEVEL_TS) << "Ignoring TS packet for pid: " << pid;
+      ts_byte_queue_.Pop(TsPacket::kPacketSize);
+      continue;
+    }
+
     // Parse the TS header, skipping 1 byte if the header is invalid.
     scoped_ptr<TsPacket> ts_packet(TsPacket::Parse(ts_buffer, ts_buffer_size));
     if (!ts_packet) {
@@ -225,13 +272,15 @@ bool Mp2tMediaParser::Parse(const uint8_t* buf, int size) {
     if (it == pids_.end() &&
         ts_packet->pid() == TsSection::kPidPat) {
       // Create the PAT state here if needed.
-      scoped_ptr<TsSection> pat_section_parser(
+      scoped_ptr<TsSectionPat> pat_section_parser(
           new TsSectionPat(
               base::Bind(&Mp2tMediaParser::RegisterPmt,
                          base::Unretained(this))));
+      pat_section_parser->set_trusted(trusted_input_);
       scoped_ptr<PidState> pat_pid_state(
           new PidState(ts_packet->pid(), PidState::kPidPat,
                        pat_section_parser.Pass()));
+      pat_pid_state->set_trusted_input(trusted_input_);
       pat_pid_state->Enable();
       it = pids_.insert(
           std::pair<int, PidState*>(ts_packet->pid(),
@@ -271,14 +320,17 @@ void Mp2tMediaParser::RegisterPmt(int program_number, int pmt_pid) {
 
   // Create the PMT state here if needed.
   DVLOG(1) << "Create a new PMT parser";
-  scoped_ptr<TsSection> pmt_section_parser(
+  scoped_ptr<TsSectionPmt> pmt_section_parser(
       new TsSectionPmt(
           base::Bind(&Mp2tMediaParser::RegisterPes,
                      base::Unretained(this), pmt_pid)));
+  pmt_section_parser->set_trusted(trusted_input_);
   scoped_ptr<PidState> pmt_pid_state(
       new PidState(pmt_pid, PidState::kPidPmt, pmt_section_parser.Pass()));
+  pmt_pid_state->set_trusted_input(trusted_input_);
   pmt_pid_state->Enable();
   pids_.insert(std::pair<int, PidState*>(pmt_pid, pmt_pid_state.release()));
+  pid_filter_.set(pmt_pid);
 }
 
 void Mp2tMediaParser::RegisterPes(int pmt_pid,
@@ -291,6 +343,16 @@ void Mp2tMediaParser::RegisterPes(int pmt_pid,
   if (it != pids_.end())
     return;
 
+  // Leave the pids of unselected stream types unregistered: their packets
+  // are then dropped by the pid filter before any elementary stream work.
+  const bool is_video_type =
+      stream_type == kStreamTypeAVC || stream_type == kStreamTypeHEVC;
+  const bool is_audio_type = stream_type == kStreamTypeAAC;
+  if ((is_video_type && !select_video_) || (is_audio_type && !select_audio_)) {
+    DVLOG(1) << "Skipping unselected pes_pid=" << pes_pid;
+    return;
+  }
+
   // Create a stream parser corresponding to the stream type.
   bool is_audio = false;
   scoped_ptr<EsParser> es_parser;
@@ -332,8 +394,10 @@ void Mp2tMediaParser::RegisterPes(int pmt_pid,
       is_audio ? PidState::kPidAudioPes : PidState::kPidVideoPes;
   scoped_ptr<PidState> pes_pid_state(
       new PidState(pes_pid, pid_type, pes_section_parser.Pass()));
+  pes_pid_state->set_trusted_input(trusted_input_);
   pes_pid_state->Enable();
   pids_.insert(std::pair<int, PidState*>(pes_pid, pes_pid_state.release()));
+  pid_filter_.set(pes_pid);
 }
 
 void Mp2tMediaParser::OnNewStreamInfo(
@@ -417,17 +481,15 @@ bool Mp2tMediaParser::EmitRemainingSamples() {
   if (!is_initialized_)
     return true;
 
-  // Buffer emission.
+  // Buffer emission: each pid's pending samples form one contiguous batch.
   for (PidMap::const_iterator pid_iter = pids_.begin(); pid_iter != pids_.end();
        ++pid_iter) {
     SampleQueue& sample_queue = pid_iter->second->sample_queue();
-    for (SampleQueue::iterator sample_iter = sample_queue.begin();
-         sample_iter != sample_queue.end();
-         ++sample_iter) {
-      if (!new_sample_cb_.Run(pid_iter->first, *sample_iter)) {
-        // Error processing sample. Propagate error condition.
-        return false;
-      }
+    if (sample_queue.empty())
+      continue;
+    if (!DeliverSampleBatch(pid_iter->first, sample_queue, new_sample_cb_)) {
+      // Error processing sample. Propagate error condition.
+      return false;
     }
     sample_queue.clear();
   }
@@ -5,8 +5,9 @@
 #ifndef MEDIA_FORMATS_MP2T_MP2T_MEDIA_PARSER_H_
 #define MEDIA_FORMATS_MP2T_MP2T_MEDIA_PARSER_H_
 
-#include <deque>
+#include <bitset>
 #include <map>
+#include <vector>
 
 #include "packager/base/compiler_specific.h"
 #include "packager/base/memory/ref_counted.h"
@@ -26,7 +27,10 @@ class PidState;
 class TsPacket;
 class TsSection;
 
-typedef std::deque<scoped_refptr<MediaSample> > SampleQueue;
+// Samples pending emission for one pid, in decode order. Delivered and
+// cleared as a whole in EmitRemainingSamples(), so a contiguous vector also
+// serves as the batch for the batch sample callback.
+typedef std::vector<scoped_refptr<MediaSample> > SampleQueue;
 
 class Mp2tMediaParser : public MediaParser {
  public:
@@ -42,6 +46,26 @@ class Mp2tMediaParser : public MediaParser {
   bool Parse(const uint8_t* buf, int size) override WARN_UNUSED_RESULT;
   /// @}
 
+  /// Restricts parsing to streams of the selected types. The PES pids of
+  /// unselected streams are never registered, so their packets are discarded
+  /// by the pid filter without any elementary stream (e.g. H.26x slice)
+  /// work. Must be called before the PMT is parsed.
+  /// @param audio selects audio streams.
+  /// @param video selects video streams.
+  void SelectStreamTypes(bool audio, bool video) {
+    select_audio_ = audio;
+    select_video_ = video;
+  }
+
+  /// Treat the input as trusted (e.g. produced by our own encoder) and elide
+  /// validation that the source has already performed: PSI CRCs are only
+  /// verified at a sampled rate, byte-identical PSI repetitions are not
+  /// re-parsed, and the per-packet continuity check is skipped. Must be
+  /// called before parsing starts.
+  void set_trusted_input(bool trusted_input) {
+    trusted_input_ = trusted_input;
+  }
+
  private:
   typedef std::map<int, PidState*> PidMap;
 
@@ -80,12 +104,25 @@ class Mp2tMediaParser : public MediaParser {
 
   bool sbr_in_mimetype_;
 
+  // Stream type selection; see SelectStreamTypes().
+  bool select_audio_;
+  bool select_video_;
+
+  // Trusted-input validation elision; see set_trusted_input().
+  bool trusted_input_;
+
   // Bytes of the TS media.
   ByteQueue ts_byte_queue_;
 
   // List of PIDs and their states.
   PidMap pids_;
 
+  // One bit per possible PID (13 bits). A set bit means packets with that PID
+  // are of interest; packets with any other PID (null packets, SI tables that
+  // are not tracked, other programs of an MPTS) are dropped in Parse() before
+  // a TsPacket is even constructed. Kept in sync with |pids_| plus the PAT.
+  std::bitset<8192> pid_filter_;
+
   // Whether |init_cb_| has been invoked.
   bool is_initialized_;
 
@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include "packager/base/bind.h"
 #include "packager/base/bind_helpers.h"
@@ -17,6 +18,7 @@
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/formats/mp2t/mp2t_common.h"
 #include "packager/media/formats/mp2t/mp2t_media_parser.h"
+#include "packager/media/formats/mp2t/ts_packet.h"
 #include "packager/media/test/test_data_util.h"
 
 namespace shaka {
@@ -151,6 +153,38 @@ TEST_F(Mp2tMediaParserTest, UnalignedAppend512_H265) {
   EXPECT_EQ(82, video_frame_count_);
 }
 
+TEST_F(Mp2tMediaParserTest, TrustedInput) {
+  // Trusted input elides PSI CRC checks and duplicate section re-parses; the
+  // parse result must not change.
+  parser_->set_trusted_input(true);
+  ParseMpeg2TsFile("bear-640x360.ts", 512);
+  EXPECT_EQ(79, video_frame_count_);
+  EXPECT_TRUE(parser_->Flush());
+  EXPECT_EQ(82, video_frame_count_);
+}
+
+TEST_F(Mp2tMediaParserTest, Discontinuity) {
+  // Drop a run of TS packets from the middle of the stream. The continuity
+  // counter breaks on every pid; parsing must resync and resume sample
+  // emission at the next key frame instead of failing.
+  InitializeParser();
+
+  std::vector<uint8_t> buffer = ReadTestDataFile("bear-640x360.ts");
+  const size_t num_packets = buffer.size() / TsPacket::kPacketSize;
+  const size_t kPacketsToDrop = 100;
+  ASSERT_GT(num_packets, 2 * kPacketsToDrop);
+  std::vector<uint8_t>::iterator drop_start =
+      buffer.begin() + (num_packets / 2) * TsPacket::kPacketSize;
+  buffer.erase(drop_start, drop_start + kPacketsToDrop * TsPacket::kPacketSize);
+
+  // OnNewSample verifies that the DTS of the emitted samples are still
+  // strictly increasing across the discontinuity.
+  EXPECT_TRUE(AppendDataInPieces(buffer.data(), buffer.size(), 512));
+  EXPECT_TRUE(parser_->Flush());
+  EXPECT_GT(video_frame_count_, 0);
+  EXPECT_LT(video_frame_count_, 82);
+}
+
 TEST_F(Mp2tMediaParserTest, TimestampWrapAround) {
   // "bear-640x360.ts" has been transcoded from bear-640x360.mp4 by applying a
   // time offset of 95442s (close to 2^33 / 90000) which results in timestamps
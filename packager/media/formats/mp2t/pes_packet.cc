@@ -6,6 +6,8 @@
 
 #include "packager/media/formats/mp2t/pes_packet.h"
 
+#include "packager/base/logging.h"
+
 namespace shaka {
 namespace media {
 namespace mp2t {
@@ -13,6 +15,20 @@ namespace mp2t {
 PesPacket::PesPacket() {}
 PesPacket::~PesPacket() {}
 
+void PesPacket::SetSampleData(scoped_refptr<MediaSample> sample,
+                              size_t offset,
+                              size_t size) {
+  DCHECK(sample);
+  DCHECK_LE(offset + size, sample->data_size());
+  sample_ = sample;
+  sample_data_offset_ = offset;
+  sample_data_size_ = size;
+}
+
+const uint8_t* PesPacket::sample_data() const {
+  return sample_ ? sample_->data() + sample_data_offset_ : NULL;
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
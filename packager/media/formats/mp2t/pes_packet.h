@@ -11,6 +11,8 @@
 #include <vector>
 
 #include "packager/base/macros.h"
+#include "packager/base/memory/ref_counted.h"
+#include "packager/media/base/media_sample.h"
 
 namespace shaka {
 namespace media {
@@ -50,6 +52,23 @@ class PesPacket {
   /// @return mutable data for this PES.
   std::vector<uint8_t>* mutable_data() { return &data_; }
 
+  /// Sets a payload continuation backed by @a sample. The bytes in
+  /// [@a offset, @a offset + @a size) of the sample data logically follow
+  /// data() in the PES payload; the sample is ref-counted, so the bytes are
+  /// consumed by the packetizer without being copied into this packet.
+  void SetSampleData(scoped_refptr<MediaSample> sample,
+                     size_t offset,
+                     size_t size);
+  /// @return Pointer to the sample-backed payload continuation; NULL if not
+  ///         set.
+  const uint8_t* sample_data() const;
+  /// @return Size of the sample-backed payload continuation; 0 if not set.
+  size_t sample_data_size() const { return sample_data_size_; }
+
+  /// @return Total payload size, i.e. data() plus the sample-backed
+  ///         continuation.
+  size_t payload_size() const { return data_.size() + sample_data_size_; }
+
  private:
   uint8_t stream_id_ = 0;
 
@@ -59,6 +78,11 @@ class PesPacket {
 
   std::vector<uint8_t> data_;
 
+  // Sample-backed payload continuation; see SetSampleData().
+  scoped_refptr<MediaSample> sample_;
+  size_t sample_data_offset_ = 0;
+  size_t sample_data_size_ = 0;
+
   DISALLOW_COPY_AND_ASSIGN(PesPacket);
 };
 
@@ -28,7 +28,11 @@ namespace {
 const bool kEscapeData = true;
 const uint8_t kVideoStreamId = 0xE0;
 const uint8_t kAudioStreamId = 0xC0;
-const double kTsTimescale = 90000.0;
+const uint32_t kTsTimescale = 90000;
+
+// Number of bytes at the start of an AAC frame that are left clear by
+// sample-AES.
+const size_t kAacUnencryptedLeaderSize = 16;
 
 // |target_data| is input as well as output. On success |target_data| contains
 // the encrypted sample. The input data should be Nal unit byte stream.
@@ -77,12 +81,11 @@ bool EncryptH264Sample(AesCryptor* encryptor,
 
 bool EncryptAacSample(AesCryptor* encryptor,
                       std::vector<uint8_t>* target_data) {
-  const int kUnencryptedLeaderSize = 16;
-  if (target_data->size() <= kUnencryptedLeaderSize)
+  if (target_data->size() <= kAacUnencryptedLeaderSize)
     return true;
-  uint8_t* data_ptr = target_data->data() + kUnencryptedLeaderSize;
+  uint8_t* data_ptr = target_data->data() + kAacUnencryptedLeaderSize;
   return encryptor->Crypt(
-      data_ptr, target_data->size() - kUnencryptedLeaderSize, data_ptr);
+      data_ptr, target_data->size() - kAacUnencryptedLeaderSize, data_ptr);
 }
 }  // namespace
 
@@ -102,7 +105,8 @@ bool PesPacketGenerator::Initialize(const StreamInfo& stream_info) {
                        << " is not supported.";
       return false;
     }
-    timescale_scale_ = kTsTimescale / video_stream_info.time_scale();
+    rescaler_ =
+        TimestampRescaler(video_stream_info.time_scale(), kTsTimescale);
     converter_.reset(new NalUnitToByteStreamConverter());
     return converter_->Initialize(video_stream_info.codec_config().data(),
                                   video_stream_info.codec_config().size(),
@@ -115,7 +119,8 @@ bool PesPacketGenerator::Initialize(const StreamInfo& stream_info) {
                        << " is not supported yet.";
       return false;
     }
-    timescale_scale_ = kTsTimescale / audio_stream_info.time_scale();
+    rescaler_ =
+        TimestampRescaler(audio_stream_info.time_scale(), kTsTimescale);
     adts_converter_.reset(new AACAudioSpecificConfig());
     return adts_converter_->Parse(audio_stream_info.codec_config());
   }
@@ -128,8 +133,8 @@ bool PesPacketGenerator::PushSample(scoped_refptr<MediaSample> sample) {
   if (!current_processing_pes_)
     current_processing_pes_.reset(new PesPacket());
 
-  current_processing_pes_->set_pts(timescale_scale_ * sample->pts());
-  current_processing_pes_->set_dts(timescale_scale_ * sample->dts());
+  current_processing_pes_->set_pts(rescaler_.Rescale(sample->pts()));
+  current_processing_pes_->set_dts(rescaler_.Rescale(sample->dts()));
   if (stream_type_ == kStreamVideo) {
     DCHECK(converter_);
     std::vector<uint8_t> byte_stream;
@@ -140,7 +145,7 @@ bool PesPacketGenerator::PushSample(scoped_refptr<MediaSample> sample) {
       return false;
     }
 
-    if (encryptor_) {
+    if (encryptor_ && !defer_encryption_) {
       if (!EncryptH264Sample(encryptor_.get(), &byte_stream)) {
         LOG(ERROR) << "Failed to encrypt byte stream.";
         return false;
@@ -154,26 +159,40 @@ bool PesPacketGenerator::PushSample(scoped_refptr<MediaSample> sample) {
   DCHECK_EQ(stream_type_, kStreamAudio);
   DCHECK(adts_converter_);
 
-  std::vector<uint8_t> aac_frame(sample->data(),
-                                 sample->data() + sample->data_size());
-
-  if (encryptor_) {
+  if (encryptor_ && defer_encryption_) {
+    // Encryption happens later in EncryptPesPacket(). Lay the frame out after
+    // the ADTS header now so it can be encrypted in place.
+    std::vector<uint8_t> adts_frame;
+    if (!adts_converter_->GetADTSHeader(sample->data_size(), &adts_frame))
+      return false;
+    adts_header_size_ = adts_frame.size();
+    adts_frame.insert(adts_frame.end(), sample->data(),
+                      sample->data() + sample->data_size());
+    current_processing_pes_->mutable_data()->swap(adts_frame);
+  } else if (encryptor_) {
+    // Encryption rewrites the frame bytes, so the sample has to be copied.
+    std::vector<uint8_t> aac_frame(sample->data(),
+                                   sample->data() + sample->data_size());
     if (!EncryptAacSample(encryptor_.get(), &aac_frame)) {
       LOG(ERROR) << "Failed to encrypt ADTS AAC.";
       return false;
     }
+    if (!adts_converter_->ConvertToADTS(&aac_frame))
+      return false;
+    current_processing_pes_->mutable_data()->swap(aac_frame);
+  } else {
+    // Clear content: only the ADTS header is generated; the frame itself is
+    // carried as a ref-counted view of the sample and packetized in place,
+    // without being copied.
+    std::vector<uint8_t> adts_header;
+    if (!adts_converter_->GetADTSHeader(sample->data_size(), &adts_header))
+      return false;
+    current_processing_pes_->mutable_data()->swap(adts_header);
+    current_processing_pes_->SetSampleData(sample, 0, sample->data_size());
   }
 
-  // TODO(rkuroiwa): ConvertToADTS() makes another copy of aac_frame internally.
-  // Optimize copying in this function, possibly by adding a method on
-  // AACAudioSpecificConfig that takes {pointer, length} pair and returns a
-  // vector that has the ADTS header.
-  if (!adts_converter_->ConvertToADTS(&aac_frame))
-    return false;
-
   // TODO(rkuriowa): Put multiple samples in the PES packet to reduce # of PES
   // packets.
-  current_processing_pes_->mutable_data()->swap(aac_frame);
   current_processing_pes_->set_stream_id(kAudioStreamId);
   pes_packets_.push_back(current_processing_pes_.release());
   return true;
@@ -203,6 +222,29 @@ bool PesPacketGenerator::SetEncryptionKey(
   return encryptor_->InitializeWithIv(encryption_key->key, encryption_key->iv);
 }
 
+void PesPacketGenerator::SetDeferEncryption(bool defer_encryption) {
+  defer_encryption_ = defer_encryption;
+}
+
+bool PesPacketGenerator::EncryptPesPacket(PesPacket* pes_packet) {
+  DCHECK(defer_encryption_);
+  DCHECK(encryptor_);
+  std::vector<uint8_t>* data = pes_packet->mutable_data();
+  if (stream_type_ == kStreamVideo)
+    return EncryptH264Sample(encryptor_.get(), data);
+
+  DCHECK_EQ(stream_type_, kStreamAudio);
+  // Skip the ADTS header and the clear leader of the frame; the rest is
+  // encrypted in place. This matches EncryptAacSample() applied to the bare
+  // frame before the header is prepended.
+  const size_t clear_prefix_size = adts_header_size_ + kAacUnencryptedLeaderSize;
+  if (data->size() <= clear_prefix_size)
+    return true;
+  uint8_t* data_ptr = data->data() + clear_prefix_size;
+  return encryptor_->Crypt(data_ptr, data->size() - clear_prefix_size,
+                           data_ptr);
+}
+
 size_t PesPacketGenerator::NumberOfReadyPesPackets() {
   return pes_packets_.size();
 }
@@ -15,6 +15,7 @@
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/media/base/timestamp_rescaler.h"
 
 namespace shaka {
 namespace media {
@@ -53,6 +54,19 @@ class PesPacketGenerator {
   /// @return true on success, false otherwise.
   virtual bool SetEncryptionKey(scoped_ptr<EncryptionKey> encryption_key);
 
+  /// When set, PushSample() leaves the sample data clear even after an
+  /// encryption key has been set; the caller is responsible for encrypting
+  /// each generated packet with EncryptPesPacket(). Must be enabled before
+  /// the first encrypted sample is pushed.
+  virtual void SetDeferEncryption(bool defer_encryption);
+
+  /// Encrypt in place a PES packet generated while deferred encryption was
+  /// enabled. May be called from a different thread than PushSample() as long
+  /// as the packet handoff is synchronized: the encryptor is the only state
+  /// this touches and PushSample() does not use it in deferred mode.
+  /// @return true on success, false otherwise.
+  virtual bool EncryptPesPacket(PesPacket* pes_packet);
+
   /// @return The number of PES packets that are ready to be consumed.
   virtual size_t NumberOfReadyPesPackets();
 
@@ -71,9 +85,11 @@ class PesPacketGenerator {
 
   StreamType stream_type_;
 
-  // Calculated by 90000 / input stream's timescale. This is used to scale the
-  // timestamps.
-  double timescale_scale_ = 0.0;
+  // Rescales timestamps from the input stream's timescale to 90000. The
+  // coefficients are fixed at Initialize(); for timescales that divide 90000
+  // each conversion is a single multiply, and unlike the double scale factor
+  // used previously the conversion is exact for the other timescales too.
+  TimestampRescaler rescaler_;
 
   scoped_ptr<NalUnitToByteStreamConverter> converter_;
   scoped_ptr<AACAudioSpecificConfig> adts_converter_;
@@ -88,6 +104,13 @@ class PesPacketGenerator {
   // Current encryption key.
   scoped_ptr<AesCryptor> encryptor_;
 
+  // If true, PushSample() does not encrypt; EncryptPesPacket() does.
+  bool defer_encryption_ = false;
+
+  // Size of the ADTS header generated for audio packets. Needed by
+  // EncryptPesPacket() to locate the frame within the packet data.
+  size_t adts_header_size_ = 0;
+
   DISALLOW_COPY_AND_ASSIGN(PesPacketGenerator);
 };
 
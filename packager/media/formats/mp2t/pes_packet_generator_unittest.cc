@@ -100,6 +100,8 @@ class MockAACAudioSpecificConfig : public AACAudioSpecificConfig {
  public:
   MOCK_METHOD1(Parse, bool(const std::vector<uint8_t>& data));
   MOCK_CONST_METHOD1(ConvertToADTS, bool(std::vector<uint8_t>* buffer));
+  MOCK_CONST_METHOD2(GetADTSHeader,
+                     bool(size_t data_size, std::vector<uint8_t>* adts_header));
 };
 
 scoped_refptr<VideoStreamInfo> CreateVideoStreamInfo(VideoCodec codec) {
@@ -138,7 +140,8 @@ class PesPacketGeneratorTest : public ::testing::Test {
   void H264EncryptionTest(const uint8_t* input,
                           size_t input_size,
                           const uint8_t* expected_output,
-                          size_t expected_output_size) {
+                          size_t expected_output_size,
+                          bool defer_encryption = false) {
     scoped_refptr<VideoStreamInfo> stream_info(
         CreateVideoStreamInfo(kH264VideoCodec));
     EXPECT_TRUE(generator_.Initialize(*stream_info));
@@ -167,12 +170,20 @@ class PesPacketGeneratorTest : public ::testing::Test {
     encryption_key->key = all_zero;
     encryption_key->iv = all_zero;
     EXPECT_TRUE(generator_.SetEncryptionKey(encryption_key.Pass()));
+    if (defer_encryption)
+      generator_.SetDeferEncryption(true);
 
     EXPECT_TRUE(generator_.PushSample(sample));
     EXPECT_EQ(1u, generator_.NumberOfReadyPesPackets());
     scoped_ptr<PesPacket> pes_packet = generator_.GetNextPesPacket();
     ASSERT_TRUE(pes_packet);
 
+    if (defer_encryption) {
+      // The packet is still clear; encryption happens in EncryptPesPacket().
+      EXPECT_EQ(clear_data, pes_packet->data());
+      EXPECT_TRUE(generator_.EncryptPesPacket(pes_packet.get()));
+    }
+
     std::vector<uint8_t> expected(expected_output,
                                   expected_output + expected_output_size);
     ASSERT_EQ(expected.size(), pes_packet->data().size());
@@ -187,7 +198,8 @@ class PesPacketGeneratorTest : public ::testing::Test {
   void AacEncryptionTest(const uint8_t* input,
                          size_t input_size,
                          const uint8_t* expected_output,
-                         size_t expected_output_size) {
+                         size_t expected_output_size,
+                         bool defer_encryption = false) {
     scoped_refptr<AudioStreamInfo> stream_info(
         CreateAudioStreamInfo(kAacAudioCodec));
     EXPECT_TRUE(generator_.Initialize(*stream_info));
@@ -200,7 +212,12 @@ class PesPacketGeneratorTest : public ::testing::Test {
 
     scoped_ptr<MockAACAudioSpecificConfig> mock(
         new MockAACAudioSpecificConfig());
-    EXPECT_CALL(*mock, ConvertToADTS(_)).WillOnce(Return(true));
+    if (defer_encryption) {
+      // Empty ADTS header so that the packet data is the frame itself.
+      EXPECT_CALL(*mock, GetADTSHeader(input_size, _)).WillOnce(Return(true));
+    } else {
+      EXPECT_CALL(*mock, ConvertToADTS(_)).WillOnce(Return(true));
+    }
 
     UseMockAACAudioSpecificConfig(mock.Pass());
 
@@ -209,12 +226,21 @@ class PesPacketGeneratorTest : public ::testing::Test {
     encryption_key->key = all_zero;
     encryption_key->iv = all_zero;
     EXPECT_TRUE(generator_.SetEncryptionKey(encryption_key.Pass()));
+    if (defer_encryption)
+      generator_.SetDeferEncryption(true);
 
     EXPECT_TRUE(generator_.PushSample(sample));
     EXPECT_EQ(1u, generator_.NumberOfReadyPesPackets());
     scoped_ptr<PesPacket> pes_packet = generator_.GetNextPesPacket();
     ASSERT_TRUE(pes_packet);
 
+    if (defer_encryption) {
+      // The packet is still clear; encryption happens in EncryptPesPacket().
+      std::vector<uint8_t> clear(input, input + input_size);
+      EXPECT_EQ(clear, pes_packet->data());
+      EXPECT_TRUE(generator_.EncryptPesPacket(pes_packet.get()));
+    }
+
     std::vector<uint8_t> expected(expected_output,
                                   expected_output + expected_output_size);
     EXPECT_EQ(expected, pes_packet->data());
@@ -324,11 +350,11 @@ TEST_F(PesPacketGeneratorTest, AddAudioSample) {
   scoped_refptr<MediaSample> sample =
       MediaSample::CopyFrom(kAnyData, arraysize(kAnyData), kIsKeyFrame);
 
-  std::vector<uint8_t> expected_data(kAnyData, kAnyData + arraysize(kAnyData));
+  const std::vector<uint8_t> adts_header(7, 0x55);
 
   scoped_ptr<MockAACAudioSpecificConfig> mock(new MockAACAudioSpecificConfig());
-  EXPECT_CALL(*mock, ConvertToADTS(_))
-      .WillOnce(DoAll(SetArgPointee<0>(expected_data), Return(true)));
+  EXPECT_CALL(*mock, GetADTSHeader(arraysize(kAnyData), _))
+      .WillOnce(DoAll(SetArgPointee<1>(adts_header), Return(true)));
 
   UseMockAACAudioSpecificConfig(mock.Pass());
 
@@ -339,7 +365,16 @@ TEST_F(PesPacketGeneratorTest, AddAudioSample) {
   EXPECT_EQ(0u, generator_.NumberOfReadyPesPackets());
 
   EXPECT_EQ(0xc0, pes_packet->stream_id());
-  EXPECT_EQ(expected_data, pes_packet->data());
+  // Clear content carries the ADTS header in data() and the frame itself as
+  // a ref-counted view of the sample.
+  EXPECT_EQ(adts_header, pes_packet->data());
+  ASSERT_EQ(arraysize(kAnyData), pes_packet->sample_data_size());
+  const std::vector<uint8_t> sample_view(
+      pes_packet->sample_data(),
+      pes_packet->sample_data() + pes_packet->sample_data_size());
+  const std::vector<uint8_t> expected_data(kAnyData,
+                                           kAnyData + arraysize(kAnyData));
+  EXPECT_EQ(expected_data, sample_view);
 
   EXPECT_TRUE(generator_.Flush());
 }
@@ -354,7 +389,8 @@ TEST_F(PesPacketGeneratorTest, AddAudioSampleFailedToConvert) {
       MediaSample::CopyFrom(kAnyData, arraysize(kAnyData), kIsKeyFrame);
 
   scoped_ptr<MockAACAudioSpecificConfig> mock(new MockAACAudioSpecificConfig());
-  EXPECT_CALL(*mock, ConvertToADTS(_)).WillOnce(Return(false));
+  EXPECT_CALL(*mock, GetADTSHeader(arraysize(kAnyData), _))
+      .WillOnce(Return(false));
 
   UseMockAACAudioSpecificConfig(mock.Pass());
 
@@ -491,6 +527,13 @@ TEST_F(PesPacketGeneratorTest, H264SampleEncryption) {
   ASSERT_NO_FATAL_FAILURE(H264EncryptionTest(kNaluData, arraysize(kNaluData),
                                              kEncryptedNaluData,
                                              arraysize(kEncryptedNaluData)));
+
+  // With deferred encryption, PushSample() leaves the packet clear and
+  // EncryptPesPacket() produces the same bytes as the inline path.
+  const bool kDeferEncryption = true;
+  ASSERT_NO_FATAL_FAILURE(
+      H264EncryptionTest(kNaluData, arraysize(kNaluData), kEncryptedNaluData,
+                         arraysize(kEncryptedNaluData), kDeferEncryption));
 }
 
 // If any block is encrypted, then the whole nal unit must be re-escaped.
@@ -689,6 +732,13 @@ TEST_F(PesPacketGeneratorTest, AacSampleEncryption) {
   ASSERT_NO_FATAL_FAILURE(AacEncryptionTest(kClearData, arraysize(kClearData),
                                             kExpectedOutputData,
                                             arraysize(kExpectedOutputData)));
+
+  // With deferred encryption, PushSample() leaves the packet clear and
+  // EncryptPesPacket() produces the same bytes as the inline path.
+  const bool kDeferEncryption = true;
+  ASSERT_NO_FATAL_FAILURE(
+      AacEncryptionTest(kClearData, arraysize(kClearData), kExpectedOutputData,
+                        arraysize(kExpectedOutputData), kDeferEncryption));
 }
 
 // Verify that all the bytes after the leading few bytes are encrypted.
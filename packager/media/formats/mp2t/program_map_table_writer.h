@@ -58,6 +58,11 @@ class H264ProgramMapTableWriter : public ProgramMapTableWriter {
   // Set to true if ClearLeadSegmentPmt() has been called. This determines the
   // version number set in EncryptedSegmentPmt().
   bool has_clear_lead_ = false;
+  // TS-packetized PMTs, generated on first use. Only the continuity_counter
+  // changes between segments, so the packets are reused with that field
+  // patched instead of reserializing the section and recomputing the CRC.
+  std::vector<uint8_t> clear_pmt_;
+  std::vector<uint8_t> encrypted_pmt_;
 
   DISALLOW_COPY_AND_ASSIGN(H264ProgramMapTableWriter);
 };
@@ -79,6 +84,7 @@ class AacProgramMapTableWriter : public ProgramMapTableWriter {
  private:
   bool EncryptedSegmentPmtWithParameters(int version,
                                          int current_next_indicator,
+                                         ContinuityCounter* continuity_counter,
                                          BufferWriter* writer);
 
   const std::vector<uint8_t> aac_audio_specific_config_;
@@ -86,6 +92,11 @@ class AacProgramMapTableWriter : public ProgramMapTableWriter {
   // Set to true if ClearLeadSegmentPmt() has been called. This determines the
   // version number set in EncryptedSegmentPmt().
   bool has_clear_lead_ = false;
+  // TS-packetized PMTs, generated on first use. Only the continuity_counter
+  // changes between segments, so the packets are reused with that field
+  // patched instead of reserializing the section and recomputing the CRC.
+  std::vector<uint8_t> clear_pmt_;
+  std::vector<uint8_t> encrypted_pmt_;
 
   DISALLOW_COPY_AND_ASSIGN(AacProgramMapTableWriter);
 };
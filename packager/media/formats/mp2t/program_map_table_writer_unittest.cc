@@ -178,6 +178,26 @@ TEST_F(ProgramMapTableWriterTest, EncryptedSegmentsH264Pmt) {
       kPmtEncryptedH264, arraysize(kPmtEncryptedH264), buffer.Buffer()));
 }
 
+// The TS packets for the PMT are cached after the first segment; verify that
+// repeated emissions differ only in the continuity counter.
+TEST_F(ProgramMapTableWriterTest, RepeatedPmtOnlyChangesContinuityCounter) {
+  ContinuityCounter counter;
+  H264ProgramMapTableWriter writer(&counter);
+  BufferWriter first;
+  writer.ClearSegmentPmt(&first);
+  BufferWriter second;
+  writer.ClearSegmentPmt(&second);
+
+  ASSERT_EQ(kTsPacketSize, first.Size());
+  ASSERT_EQ(kTsPacketSize, second.Size());
+  EXPECT_EQ(0x30, first.Buffer()[3]);   // counter = 0.
+  EXPECT_EQ(0x31, second.Buffer()[3]);  // counter = 1.
+  EXPECT_EQ(
+      std::vector<uint8_t>(first.Buffer() + 4, first.Buffer() + kTsPacketSize),
+      std::vector<uint8_t>(second.Buffer() + 4,
+                           second.Buffer() + kTsPacketSize));
+}
+
 TEST_F(ProgramMapTableWriterTest, ClearAac) {
   ContinuityCounter counter;
   const std::vector<uint8_t> aac_audio_specific_config(
@@ -22,6 +22,7 @@ Status TsMuxer::Initialize() {
     return Status(error::MUXER_FAILURE, "Cannot handle more than one streams.");
 
   segmenter_.reset(new TsSegmenter(options(), muxer_listener()));
+  segmenter_->set_media_stream(streams()[0]);
   Status status =
       segmenter_->Initialize(*streams()[0]->info(), encryption_key_source(),
                              max_sd_pixels(), clear_lead_in_seconds());
@@ -50,8 +51,9 @@ void TsMuxer::FireOnMediaEndEvent() {
   if (!muxer_listener())
     return;
 
-  // For now, there is no single file TS segmenter. So all the values passed
-  // here are false and 0. Called just to notify the MuxerListener.
+  // TS output has no init or index ranges, even in single file mode. So all
+  // the values passed here are false and 0. Called just to notify the
+  // MuxerListener.
   const bool kHasInitRange = true;
   const bool kHasIndexRange = true;
   muxer_listener()->OnMediaEnd(!kHasInitRange, 0, 0, !kHasIndexRange, 0, 0, 0,
@@ -4,6 +4,15 @@
 
 #include "packager/media/formats/mp2t/ts_packet.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PACKAGER_TS_SYNC_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__aarch64__)
+#define PACKAGER_TS_SYNC_NEON
+#include <arm_neon.h>
+#endif
+
 #include "packager/base/memory/scoped_ptr.h"
 #include "packager/media/base/bit_reader.h"
 #include "packager/media/formats/mp2t/mp2t_common.h"
@@ -14,14 +23,57 @@ namespace mp2t {
 
 static const uint8_t kTsHeaderSyncword = 0x47;
 
+namespace {
+
+// Returns the offset of the first syncword byte in [data, data + size), or
+// |size| if there is none. A resync scan spends nearly all of its time on
+// bytes that are not 0x47, so SIMD is used where available to reject 16 bytes
+// per iteration.
+int BytesUntilSyncword(const uint8_t* data, int size) {
+  const uint8_t* p = data;
+  const uint8_t* end = data + size;
+#if defined(PACKAGER_TS_SYNC_SSE2)
+  const __m128i kSyncword128 = _mm_set1_epi8(kTsHeaderSyncword);
+  while (end - p >= 16) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(block, kSyncword128)) != 0)
+      break;
+    p += 16;
+  }
+#elif defined(PACKAGER_TS_SYNC_NEON)
+  while (end - p >= 16) {
+    const uint8x16_t eq_syncword =
+        vceqq_u8(vld1q_u8(p), vdupq_n_u8(kTsHeaderSyncword));
+    const uint64x2_t eq_syncword64 = vreinterpretq_u64_u8(eq_syncword);
+    if ((vgetq_lane_u64(eq_syncword64, 0) |
+         vgetq_lane_u64(eq_syncword64, 1)) != 0) {
+      break;
+    }
+    p += 16;
+  }
+#endif
+  // Finds the syncword within the last SIMD block, and covers the tail as
+  // well as builds without SIMD support.
+  while (p < end && *p != kTsHeaderSyncword)
+    ++p;
+  return p - data;
+}
+
+}  // namespace
+
 // static
 int TsPacket::Sync(const uint8_t* buf, int size) {
   int k = 0;
-  for (; k < size; k++) {
+  while (k < size) {
+    // Jump straight to the next syncword candidate.
+    k += BytesUntilSyncword(buf + k, size - k);
+    if (k >= size)
+      break;
+
     // Verify that we have 4 syncwords in a row when possible,
     // this should improve synchronization robustness.
     bool is_header = true;
-    for (int i = 0; i < 4; i++) {
+    for (int i = 1; i < 4; i++) {
       int idx = k + i * kPacketSize;
       if (idx >= size)
         break;
@@ -35,6 +87,7 @@ int TsPacket::Sync(const uint8_t* buf, int size) {
     }
     if (is_header)
       break;
+    k++;
   }
 
   DVLOG_IF(1, k != 0) << "SYNC: nbytes_skipped=" << k;
@@ -6,6 +6,10 @@
 
 #include "packager/media/formats/mp2t/ts_packet_writer_util.h"
 
+#include <string.h>
+
+#include <algorithm>
+
 #include "packager/base/logging.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/formats/mp2t/continuity_counter.h"
@@ -26,47 +30,19 @@ const int kTsPacketSize = 188;
 const int kTsPacketMaximumPayloadSize =
     kTsPacketSize - kTsPacketHeaderSize;
 
-// Used for adaptation field padding bytes.
-const uint8_t kPaddingBytes[] = {
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-  0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
-};
-static_assert(arraysize(kPaddingBytes) >= kTsPacketMaximumPayloadSize,
-              "Padding array is not big enough.");
-
+// Writes the adaptation field into |buf|, which points at the byte right
+// after the TS packet header, and returns the number of bytes it occupies.
 // |remaining_data_size| is the amount of data that has to be written. This may
 // be bigger than a TS packet size.
 // |remaining_data_size| matters if it is short and requires padding.
-void WriteAdaptationField(bool has_pcr,
-                          uint64_t pcr_base,
-                          size_t remaining_data_size,
-                          BufferWriter* writer) {
+size_t WriteAdaptationField(bool has_pcr,
+                            uint64_t pcr_base,
+                            size_t remaining_data_size,
+                            uint8_t* buf) {
   // Special case where a TS packet requires 1 byte padding.
   if (!has_pcr && remaining_data_size == kTsPacketMaximumPayloadSize - 1) {
-    writer->AppendInt(static_cast<uint8_t>(0));
-    return;
+    buf[0] = 0;
+    return 1;
   }
 
   // The size of the field itself.
@@ -85,12 +61,11 @@ void WriteAdaptationField(bool has_pcr,
     }
   }
 
-  writer->AppendInt(static_cast<uint8_t>(adaptation_field_length));
-  int remaining_bytes = adaptation_field_length;
-  writer->AppendInt(static_cast<uint8_t>(
-      // All flags except PCR_flag are 0.
-      static_cast<uint8_t>(has_pcr) << 4));
-  remaining_bytes -= 1;
+  buf[0] = static_cast<uint8_t>(adaptation_field_length);
+  // All flags except PCR_flag are 0.
+  buf[1] = static_cast<uint8_t>(has_pcr) << 4;
+  size_t pos = 2;
+  int remaining_bytes = adaptation_field_length - 1;
 
   if (has_pcr) {
     // program_clock_reference_extension = 0.
@@ -98,16 +73,18 @@ void WriteAdaptationField(bool has_pcr,
         static_cast<uint32_t>(pcr_base >> 1);
     const uint16_t pcr_last_bit_reserved_and_pcr_extension =
         ((pcr_base & 1) << 15);
-    writer->AppendInt(most_significant_32bits_pcr);
-    writer->AppendInt(pcr_last_bit_reserved_and_pcr_extension);
+    buf[pos++] = (most_significant_32bits_pcr >> 24) & 0xFF;
+    buf[pos++] = (most_significant_32bits_pcr >> 16) & 0xFF;
+    buf[pos++] = (most_significant_32bits_pcr >> 8) & 0xFF;
+    buf[pos++] = most_significant_32bits_pcr & 0xFF;
+    buf[pos++] = (pcr_last_bit_reserved_and_pcr_extension >> 8) & 0xFF;
+    buf[pos++] = pcr_last_bit_reserved_and_pcr_extension & 0xFF;
     remaining_bytes -= kPcrFieldsSize;
   }
   DCHECK_GE(remaining_bytes, 0);
-  if (remaining_bytes == 0)
-    return;
-
-  DCHECK_GE(static_cast<int>(arraysize(kPaddingBytes)), remaining_bytes);
-  writer->AppendArray(kPaddingBytes, remaining_bytes);
+  // Adaptation field padding bytes.
+  memset(buf + pos, 0xFF, remaining_bytes);
+  return pos + remaining_bytes;
 }
 
 }  // namespace
@@ -120,39 +97,73 @@ void WritePayloadToBufferWriter(const uint8_t* payload,
                                 uint64_t pcr_base,
                                 ContinuityCounter* continuity_counter,
                                 BufferWriter* writer) {
+  PayloadSpan span = {payload, payload_size};
+  WriteMultiSpanPayloadToBufferWriter(&span, 1, payload_unit_start_indicator,
+                                      pid, has_pcr, pcr_base,
+                                      continuity_counter, writer);
+}
+
+void WriteMultiSpanPayloadToBufferWriter(const PayloadSpan* spans,
+                                         size_t num_spans,
+                                         bool payload_unit_start_indicator,
+                                         int pid,
+                                         bool has_pcr,
+                                         uint64_t pcr_base,
+                                         ContinuityCounter* continuity_counter,
+                                         BufferWriter* writer) {
+  size_t payload_size = 0;
+  for (size_t i = 0; i < num_spans; ++i)
+    payload_size += spans[i].size;
+
   size_t payload_bytes_written = 0;
+  size_t span_index = 0;
+  size_t span_offset = 0;
 
+  // Each packet is assembled in a local buffer with direct byte writes and
+  // appended to |writer| whole, so the loop body stays free of per-field
+  // append overhead.
+  uint8_t packet[kTsPacketSize];
   do {
     const bool must_write_adaptation_header = has_pcr;
     const size_t bytes_left = payload_size - payload_bytes_written;
     const bool has_adaptation_field = must_write_adaptation_header ||
                                       bytes_left < kTsPacketMaximumPayloadSize;
 
-    writer->AppendInt(kSyncByte);
-    writer->AppendInt(static_cast<uint16_t>(
-        // transport_error_indicator and transport_priority are both '0'.
-        static_cast<int>(payload_unit_start_indicator) << 14 | pid));
+    packet[0] = kSyncByte;
+    // transport_error_indicator and transport_priority are both '0'.
+    packet[1] = static_cast<int>(payload_unit_start_indicator) << 6 |
+                ((pid >> 8) & 0x1F);
+    packet[2] = pid & 0xFF;
 
     const uint8_t adaptation_field_control =
         ((has_adaptation_field ? 1 : 0) << 1) | ((bytes_left != 0) ? 1 : 0);
     // transport_scrambling_control is '00'.
-    writer->AppendInt(static_cast<uint8_t>(adaptation_field_control << 4 |
-                                           continuity_counter->GetNext()));
-
-    if (has_adaptation_field) {
-      const size_t before = writer->Size();
-      WriteAdaptationField(has_pcr, pcr_base, bytes_left, writer);
-      const size_t bytes_for_adaptation_field = writer->Size() - before;
-
-      const int write_bytes =
-          kTsPacketMaximumPayloadSize - bytes_for_adaptation_field;
-      writer->AppendArray(payload + payload_bytes_written, write_bytes);
+    packet[3] = adaptation_field_control << 4 | continuity_counter->GetNext();
+
+    size_t pos = kTsPacketHeaderSize;
+    if (has_adaptation_field)
+      pos += WriteAdaptationField(has_pcr, pcr_base, bytes_left, packet + pos);
+
+    // Gather the packet payload from the spans; the adaptation field is
+    // sized so that the packet is filled exactly unless the payload runs
+    // out on the last packet.
+    while (pos < kTsPacketSize && span_index < num_spans) {
+      const size_t span_bytes_left = spans[span_index].size - span_offset;
+      if (span_bytes_left == 0) {
+        ++span_index;
+        span_offset = 0;
+        continue;
+      }
+      const size_t write_bytes =
+          std::min(kTsPacketSize - pos, span_bytes_left);
+      memcpy(packet + pos, spans[span_index].data + span_offset, write_bytes);
+      pos += write_bytes;
+      span_offset += write_bytes;
       payload_bytes_written += write_bytes;
-    } else {
-      writer->AppendArray(payload + payload_bytes_written,
-                          kTsPacketMaximumPayloadSize);
-      payload_bytes_written += kTsPacketMaximumPayloadSize;
     }
+    DCHECK_EQ(kTsPacketSize, static_cast<int>(pos));
+
+    writer->AppendArray(packet, kTsPacketSize);
 
     // Once written, not needed for this payload.
     has_pcr = false;
@@ -160,6 +171,20 @@ void WritePayloadToBufferWriter(const uint8_t* payload,
   } while (payload_bytes_written < payload_size);
 }
 
+void WritePsiPacketsFromCache(std::vector<uint8_t>* cached_packets,
+                              ContinuityCounter* continuity_counter,
+                              BufferWriter* writer) {
+  DCHECK_EQ(0u, cached_packets->size() % kTsPacketSize);
+  for (size_t i = 0; i < cached_packets->size(); i += kTsPacketSize) {
+    // The continuity_counter is the low 4 bits of the last TS header byte;
+    // everything else in the packet is reused as is.
+    uint8_t& last_header_byte = (*cached_packets)[i + 3];
+    last_header_byte =
+        (last_header_byte & 0xF0) | continuity_counter->GetNext();
+  }
+  writer->AppendVector(*cached_packets);
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
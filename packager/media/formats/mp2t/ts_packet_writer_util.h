@@ -12,6 +12,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <vector>
+
 namespace shaka {
 namespace media {
 
@@ -40,6 +42,41 @@ void WritePayloadToBufferWriter(const uint8_t* payload,
                                 ContinuityCounter* continuity_counter,
                                 BufferWriter* output);
 
+/// A contiguous piece of a payload to be packetized. Spans of size 0 are
+/// allowed and skipped.
+struct PayloadSpan {
+  const uint8_t* data;
+  size_t size;
+};
+
+/// Same as WritePayloadToBufferWriter() except that the payload is gathered
+/// from @a num_spans non-contiguous spans, so callers can mix header bytes
+/// with sample-backed data without first copying everything into one
+/// contiguous buffer. The output is identical to packetizing the
+/// concatenation of the spans.
+void WriteMultiSpanPayloadToBufferWriter(const PayloadSpan* spans,
+                                         size_t num_spans,
+                                         bool payload_unit_start_indicator,
+                                         int pid,
+                                         bool has_pcr,
+                                         uint64_t pcr_base,
+                                         ContinuityCounter* continuity_counter,
+                                         BufferWriter* output);
+
+/// Appends TS packets previously produced by WritePayloadToBufferWriter() to
+/// @a output, patching the continuity_counter field of each packet header
+/// with values from @a continuity_counter. This is intended for PSI (PAT and
+/// PMT) packets, which are byte-identical from segment to segment except for
+/// the continuity_counter, so the section serialization and CRC32 do not have
+/// to be redone.
+/// @param cached_packets must be a whole number of TS packets; it is patched
+///        in place.
+/// @param continuity_counter is the continuity_counter for these TS packets.
+/// @param output is where the TS packets get written.
+void WritePsiPacketsFromCache(std::vector<uint8_t>* cached_packets,
+                              ContinuityCounter* continuity_counter,
+                              BufferWriter* output);
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
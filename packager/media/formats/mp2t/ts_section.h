@@ -34,6 +34,11 @@ class TsSection {
 
   // Reset the state of the parser to its initial state.
   virtual void Reset() = 0;
+
+  // Drop the section being reassembled after a TS discontinuity, keeping any
+  // acquired stream context (parsed tables, codec configs, parameter sets),
+  // so that parsing resumes at the next payload unit start.
+  virtual void ResetOnDiscontinuity() = 0;
 };
 
 }  // namespace mp2t
@@ -13,6 +13,15 @@
 
 static const int kPesStartCode = 0x000001;
 
+// Limit on the bytes buffered while reassembling one PES packet. A PES packet
+// with a coded length is at most 64KB plus headers; video PES packets with an
+// unknown length hold one access unit, which is at most a few MB even for
+// high bitrate streams. A buffer well beyond that means the packet boundary
+// was lost (corrupted length field or dropped payload unit start indicator),
+// in which case the buffered bytes are dropped and reassembly resumes at the
+// next payload unit start, instead of growing without bound.
+static const int kMaxPendingPesBytes = 32 * 1024 * 1024;
+
 // Given that |time| is coded using 33 bits,
 // UnrollTimestamp returns the corresponding unrolled timestamp.
 // The unrolled timestamp is defined by:
@@ -125,7 +134,21 @@ bool TsSectionPes::Parse(bool payload_unit_start_indicator,
     pes_byte_queue_.Push(buf, size);
 
   // Try emitting the current PES packet.
-  return (parse_result && Emit(false));
+  if (!Emit(false))
+    parse_result = false;
+
+  // Enforce the cap on the reassembly buffer; see kMaxPendingPesBytes.
+  int pending_size;
+  const uint8_t* pending;
+  pes_byte_queue_.Peek(&pending, &pending_size);
+  if (pending_size > kMaxPendingPesBytes) {
+    LOG(WARNING) << "Dropping " << pending_size
+                 << " buffered PES bytes without finding a complete packet; "
+                 << "resynchronizing at the next payload unit start.";
+    ResetPesState();
+  }
+
+  return parse_result;
 }
 
 void TsSectionPes::Flush() {
@@ -148,6 +171,15 @@ void TsSectionPes::Reset() {
   es_parser_->Reset();
 }
 
+void TsSectionPes::ResetOnDiscontinuity() {
+  // Drop the partially reassembled PES and wait for the next payload unit
+  // start. The PTS/DTS unroll state is kept: the timeline usually resumes
+  // close to where it left off, and a far jump is unrolled the same way a
+  // regular timestamp wraparound is.
+  ResetPesState();
+  es_parser_->ResetOnDiscontinuity();
+}
+
 bool TsSectionPes::Emit(bool emit_for_unknown_size) {
   int raw_pes_size;
   const uint8_t* raw_pes;
@@ -29,6 +29,7 @@ class TsSectionPes : public TsSection {
              int size) override;
   void Flush() override;
   void Reset() override;
+  void ResetOnDiscontinuity() override;
 
  private:
   // Emit a reassembled PES packet.
@@ -5,43 +5,35 @@
 #include "packager/media/formats/mp2t/ts_section_psi.h"
 
 #include <stdint.h>
+#include <string.h>
 
 #include "packager/base/logging.h"
 #include "packager/media/base/bit_reader.h"
+#include "packager/media/base/crc32.h"
 #include "packager/media/formats/mp2t/mp2t_common.h"
 
-static bool IsCrcValid(const uint8_t* buf, int size) {
-  uint32_t crc = 0xffffffffu;
-  const uint32_t kCrcPoly = 0x4c11db7;
-
-  for (int k = 0; k < size; k++) {
-    int nbits = 8;
-    uint32_t data_msb_aligned = buf[k];
-    data_msb_aligned <<= (32 - nbits);
-
-    while (nbits > 0) {
-      if ((data_msb_aligned ^ crc) & 0x80000000) {
-        crc <<= 1;
-        crc ^= kCrcPoly;
-      } else {
-        crc <<= 1;
-      }
-
-      data_msb_aligned <<= 1;
-      nbits--;
-    }
-  }
-
-  return (crc == 0);
-}
-
 namespace shaka {
 namespace media {
 namespace mp2t {
 
+namespace {
+
+// A PSI section followed by its own CRC computes to zero.
+bool IsCrcValid(const uint8_t* buf, int size) {
+  return Crc32Mpeg2(buf, size) == 0;
+}
+
+// In trusted mode, one in this many section occurrences still takes the full
+// CRC + parse path as a safety net.
+const uint32_t kTrustedVerificationInterval = 16;
+
+}  // namespace
+
 TsSectionPsi::TsSectionPsi()
     : wait_for_pusi_(true),
-      leading_bytes_to_discard_(0) {
+      leading_bytes_to_discard_(0),
+      trusted_(false),
+      section_count_(0) {
 }
 
 TsSectionPsi::~TsSectionPsi() {
@@ -104,14 +96,32 @@ bool TsSectionPsi::Parse(bool payload_unit_start_indicator,
       << "Trailing bytes after a PSI section: "
       << psi_length << " vs " << raw_psi_size;
 
+  if (trusted_) {
+    // A byte-identical repetition of the last accepted section would parse to
+    // the same result, so skip the CRC and the re-parse entirely, except for
+    // sampled occurrences which still go through full verification. Changed
+    // sections are rare and always verified.
+    const bool unchanged =
+        last_section_.size() == static_cast<size_t>(psi_length) &&
+        memcmp(&last_section_[0], raw_psi, psi_length) == 0;
+    const bool sampled = (section_count_++ % kTrustedVerificationInterval) == 0;
+    if (unchanged && !sampled) {
+      ResetPsiState();
+      return true;
+    }
+  }
+
   // Verify the CRC.
   RCHECK(IsCrcValid(raw_psi, psi_length));
 
   // Parse the PSI section.
   BitReader bit_reader(raw_psi, raw_psi_size);
   bool status = ParsePsiSection(&bit_reader);
-  if (status)
+  if (status) {
+    if (trusted_)
+      last_section_.assign(raw_psi, raw_psi + psi_length);
     ResetPsiState();
+  }
 
   return status;
 }
@@ -122,6 +132,14 @@ void TsSectionPsi::Flush() {
 void TsSectionPsi::Reset() {
   ResetPsiSection();
   ResetPsiState();
+  last_section_.clear();
+}
+
+void TsSectionPsi::ResetOnDiscontinuity() {
+  // Drop the partial section. The tables parsed so far stay valid: a table
+  // that did change across the discontinuity is byte-different and thus
+  // still CRC-checked and re-parsed when it shows up.
+  ResetPsiState();
 }
 
 void TsSectionPsi::ResetPsiState() {
@@ -5,6 +5,8 @@
 #ifndef MEDIA_FORMATS_MP2T_TS_SECTION_PSI_H_
 #define MEDIA_FORMATS_MP2T_TS_SECTION_PSI_H_
 
+#include <vector>
+
 #include "packager/base/compiler_specific.h"
 #include "packager/media/base/byte_queue.h"
 #include "packager/media/formats/mp2t/ts_section.h"
@@ -27,6 +29,7 @@ class TsSectionPsi : public TsSection {
              int size) override;
   void Flush() override;
   void Reset() override;
+  void ResetOnDiscontinuity() override;
 
   // Parse the content of the PSI section.
   virtual bool ParsePsiSection(BitReader* bit_reader) = 0;
@@ -34,6 +37,12 @@ class TsSectionPsi : public TsSection {
   // Reset the state of the PSI section.
   virtual void ResetPsiSection() = 0;
 
+  // Treat the input as trusted: byte-identical repetitions of the last
+  // accepted section are not CRC-checked or re-parsed (tables are typically
+  // repeated unchanged every ~100 ms), and the CRC of new sections is only
+  // verified at a sampled rate. Changed sections are still parsed.
+  void set_trusted(bool trusted) { trusted_ = trusted; }
+
  private:
   void ResetPsiState();
 
@@ -46,6 +55,11 @@ class TsSectionPsi : public TsSection {
   // Number of leading bytes to discard (pointer field).
   int leading_bytes_to_discard_;
 
+  // Trusted-input state; see set_trusted().
+  bool trusted_;
+  uint32_t section_count_;
+  std::vector<uint8_t> last_section_;
+
   DISALLOW_COPY_AND_ASSIGN(TsSectionPsi);
 };
 
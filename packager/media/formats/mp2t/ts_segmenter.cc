@@ -8,13 +8,17 @@
 
 #include <memory>
 
+#include "packager/base/bind.h"
 #include "packager/media/base/aes_encryptor.h"
+#include "packager/media/base/closure_thread.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/media/base/producer_consumer_queue.h"  // For kInfiniteTimeout.
 #include "packager/media/base/status.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/event/muxer_listener.h"
 #include "packager/media/event/progress_listener.h"
+#include "packager/media/formats/mp2t/pes_packet.h"
 
 namespace shaka {
 namespace media {
@@ -22,21 +26,46 @@ namespace mp2t {
 
 namespace {
 const double kTsTimescale = 90000;
+
+// Capacity of each pipeline queue, in items. An item is roughly one sample,
+// so this bounds the look-ahead of each stage without stalling handoffs.
+const size_t kPipelineQueueCapacity = 128u;
 }  // namespace
 
+TsSegmenter::PipelineItem::PipelineItem()
+    : type(kSample), pes_packet(NULL), encrypt(false), segment_duration(0.0) {}
+
 TsSegmenter::TsSegmenter(const MuxerOptions& options, MuxerListener* listener)
     : muxer_options_(options),
       listener_(listener),
       ts_writer_(new TsWriter()),
       pes_packet_generator_(new PesPacketGenerator()) {}
-TsSegmenter::~TsSegmenter() {}
+
+TsSegmenter::~TsSegmenter() {
+  // Normally Finalize() has stopped the pipeline already; make sure the
+  // workers exit if the segmenter is torn down early.
+  if (pipeline_started_)
+    StopPipeline();
+}
 
 Status TsSegmenter::Initialize(const StreamInfo& stream_info,
                                KeySource* encryption_key_source,
                                uint32_t max_sd_pixels,
                                double clear_lead_in_seconds) {
-  if (muxer_options_.segment_template.empty())
-    return Status(error::MUXER_FAILURE, "Segment template not specified.");
+  if (muxer_options_.segment_template.empty()) {
+    // |single_segment| also controls how the output is advertised in
+    // MediaInfo, so it has to be consistent with the mode used here.
+    if (!muxer_options_.single_segment ||
+        muxer_options_.output_file_name.empty()) {
+      return Status(error::MUXER_FAILURE, "Segment template not specified.");
+    }
+    // All the segments are appended to one continuous output file, and the
+    // playlist refers to them by byte range. Listeners still get one
+    // OnNewSegment() event per segment.
+    single_file_mode_ = true;
+  } else {
+    segment_name_template_.Compile(muxer_options_.segment_template);
+  }
   if (!ts_writer_->Initialize(stream_info))
     return Status(error::MUXER_FAILURE, "Failed to initialize TsWriter.");
   if (!pes_packet_generator_->Initialize(stream_info)) {
@@ -60,6 +89,7 @@ Status TsSegmenter::Initialize(const StreamInfo& stream_info,
 
     encryption_key_ = encryption_key.Pass();
     clear_lead_in_seconds_ = clear_lead_in_seconds;
+    has_encryption_key_ = true;
 
     if (listener_) {
       // For now this only happens once, so send true.
@@ -75,20 +105,52 @@ Status TsSegmenter::Initialize(const StreamInfo& stream_info,
   }
 
   timescale_scale_ = kTsTimescale / stream_info.time_scale();
+  stream_timescale_ = stream_info.time_scale();
+  if (stream_info.stream_type() == kStreamVideo) {
+    video_stream_info_ = scoped_refptr<const VideoStreamInfo>(
+        static_cast<const VideoStreamInfo*>(&stream_info));
+  }
+
+  // With encrypted output, PES generation, sample encryption and TS
+  // packetization are pipelined across threads; they have no data dependency
+  // across samples.
+  if (has_encryption_key_ && muxer_options_.num_encryption_threads > 1)
+    StartPipeline();
   return Status::OK;
 }
 
 Status TsSegmenter::Finalize() {
-  return Flush();
+  Status status;
+  if (!pipeline_enabled_) {
+    status = Flush();
+  } else {
+    PipelineItem end_segment;
+    end_segment.type = PipelineItem::kEndSegment;
+    end_segment.segment_duration = current_segment_total_sample_duration_;
+    status = sample_queue_->Push(end_segment, kInfiniteTimeout);
+    total_duration_in_seconds_ += current_segment_total_sample_duration_;
+    current_segment_total_sample_duration_ = 0.0;
+    status.Update(StopPipeline());
+  }
+
+  // In single file mode the file stays open across segments; close it now
+  // that the last segment has been written.
+  if (single_file_opened_) {
+    if (!ts_writer_->CloseFile())
+      status.Update(Status(error::MUXER_FAILURE, "Failed to close file."));
+    single_file_opened_ = false;
+  }
+  return status;
 }
 
 // First checks whether the sample is a key frame. If so and the segment has
 // passed the segment duration, then flush the generator and write all the data
 // to file.
 Status TsSegmenter::AddSample(scoped_refptr<MediaSample> sample) {
-  const bool passed_segment_duration =
-      current_segment_total_sample_duration_ > muxer_options_.segment_duration;
-  if (sample->is_key_frame() && passed_segment_duration) {
+  if (pipeline_enabled_)
+    return AddSampleToPipeline(sample);
+
+  if (ShouldCutSegment(*sample)) {
     Status status = Flush();
     if (!status.ok())
       return status;
@@ -125,13 +187,25 @@ void TsSegmenter::SetTsWriterFileOpenedForTesting(bool value) {
 Status TsSegmenter::OpenNewSegmentIfClosed(uint32_t next_pts) {
   if (ts_writer_file_opened_)
     return Status::OK;
-  const std::string segment_name =
-      GetSegmentName(muxer_options_.segment_template, next_pts,
-                     segment_number_++, muxer_options_.bandwidth);
-  if (!ts_writer_->NewSegment(segment_name))
-    return Status(error::MUXER_FAILURE, "Failed to initilize TsPacketWriter.");
+  if (single_file_mode_) {
+    if (!single_file_opened_) {
+      if (!ts_writer_->NewSegment(muxer_options_.output_file_name)) {
+        return Status(error::MUXER_FAILURE,
+                      "Failed to initilize TsPacketWriter.");
+      }
+      single_file_opened_ = true;
+    } else if (!ts_writer_->NewSegmentInCurrentFile()) {
+      return Status(error::MUXER_FAILURE, "Failed to start a new segment.");
+    }
+    current_segment_path_ = muxer_options_.output_file_name;
+  } else {
+    const std::string& segment_name = segment_name_template_.GetSegmentName(
+        next_pts, segment_number_++, muxer_options_.bandwidth);
+    if (!ts_writer_->NewSegment(segment_name))
+      return Status(error::MUXER_FAILURE, "Failed to initilize TsPacketWriter.");
+    current_segment_path_ = segment_name;
+  }
   current_segment_start_time_ = next_pts;
-  current_segment_path_ = segment_name;
   ts_writer_file_opened_ = true;
   return Status::OK;
 }
@@ -163,23 +237,43 @@ Status TsSegmenter::Flush() {
   // This method may be called from Finalize() so ts_writer_file_opened_ could
   // be false.
   if (ts_writer_file_opened_) {
+    status = FinalizeCurrentSegment(current_segment_total_sample_duration_);
+    if (!status.ok())
+      return status;
+    total_duration_in_seconds_ += current_segment_total_sample_duration_;
+  }
+  current_segment_total_sample_duration_ = 0.0;
+  current_segment_start_time_ = 0;
+  current_segment_path_.clear();
+  return NotifyEncrypted();
+}
+
+Status TsSegmenter::FinalizeCurrentSegment(double duration_in_seconds) {
+  DCHECK(ts_writer_file_opened_);
+  if (single_file_mode_) {
+    uint64_t segment_size = 0;
+    if (!ts_writer_->FinalizeSegmentKeepFileOpen(&segment_size)) {
+      return Status(error::MUXER_FAILURE, "Failed to finalize TsWriter.");
+    }
+    if (listener_) {
+      listener_->OnNewSegment(current_segment_path_,
+                              current_segment_start_time_,
+                              duration_in_seconds * kTsTimescale, segment_size);
+    }
+  } else {
     if (!ts_writer_->FinalizeSegment()) {
       return Status(error::MUXER_FAILURE, "Failed to finalize TsWriter.");
     }
     if (listener_) {
       const int64_t file_size =
           File::GetFileSize(current_segment_path_.c_str());
-      listener_->OnNewSegment(
-          current_segment_path_, current_segment_start_time_,
-          current_segment_total_sample_duration_ * kTsTimescale, file_size);
+      listener_->OnNewSegment(current_segment_path_,
+                              current_segment_start_time_,
+                              duration_in_seconds * kTsTimescale, file_size);
     }
-    ts_writer_file_opened_ = false;
-    total_duration_in_seconds_ += current_segment_total_sample_duration_;
   }
-  current_segment_total_sample_duration_ = 0.0;
-  current_segment_start_time_ = 0;
-  current_segment_path_.clear();
-  return NotifyEncrypted();
+  ts_writer_file_opened_ = false;
+  return Status::OK;
 }
 
 Status TsSegmenter::NotifyEncrypted() {
@@ -190,10 +284,264 @@ Status TsSegmenter::NotifyEncrypted() {
     if (!pes_packet_generator_->SetEncryptionKey(encryption_key_.Pass()))
       return Status(error::INTERNAL_ERROR, "Failed to set encryption key.");
     ts_writer_->SignalEncrypted();
+    encryption_started_ = true;
+    encryption_marker_sent_ = true;
   }
   return Status::OK;
 }
 
+bool TsSegmenter::ShouldCutSegment(const MediaSample& sample) const {
+  if (!sample.is_key_frame())
+    return false;
+  if (current_segment_total_sample_duration_ > muxer_options_.segment_duration)
+    return true;
+  if (stream_timescale_ == 0 ||
+      current_segment_total_sample_duration_ == 0.0) {
+    return false;
+  }
+  // The target has not been reached yet, but with variable GOPs the GOP
+  // starting at this key frame may blow far past it. When the parser built a
+  // key frame index for the stream, look the next key frame up there;
+  // otherwise peek at the staged samples (threaded push mode). Cut here if
+  // that leaves the segment closer to the target than cutting there would.
+  int64_t next_key_frame_timestamp = 0;
+  bool have_next_key_frame = false;
+  if (video_stream_info_ && video_stream_info_->has_key_frame_index()) {
+    have_next_key_frame = video_stream_info_->FindNextKeyFrameTimestamp(
+        sample.dts(), &next_key_frame_timestamp);
+  }
+  if (!have_next_key_frame && media_stream_) {
+    have_next_key_frame =
+        media_stream_->PeekNextKeyFrameTimestamp(&next_key_frame_timestamp);
+  }
+  if (!have_next_key_frame)
+    return false;
+  const double gop_duration =
+      static_cast<double>(next_key_frame_timestamp - sample.dts()) /
+      stream_timescale_;
+  if (gop_duration <= 0.0)
+    return false;
+  const double undershoot =
+      muxer_options_.segment_duration - current_segment_total_sample_duration_;
+  const double overshoot = current_segment_total_sample_duration_ +
+                           gop_duration - muxer_options_.segment_duration;
+  return overshoot > undershoot;
+}
+
+Status TsSegmenter::AddSampleToPipeline(scoped_refptr<MediaSample> sample) {
+  Status status = pipeline_status();
+  if (!status.ok())
+    return status;
+
+  if (ShouldCutSegment(*sample)) {
+    PipelineItem end_segment;
+    end_segment.type = PipelineItem::kEndSegment;
+    end_segment.segment_duration = current_segment_total_sample_duration_;
+    status = sample_queue_->Push(end_segment, kInfiniteTimeout);
+    if (!status.ok())
+      return status;
+    total_duration_in_seconds_ += current_segment_total_sample_duration_;
+    current_segment_total_sample_duration_ = 0.0;
+    segment_expected_open_ = false;
+
+    if (has_encryption_key_ && !encryption_marker_sent_ &&
+        total_duration_in_seconds_ >= clear_lead_in_seconds_) {
+      PipelineItem signal_encrypted;
+      signal_encrypted.type = PipelineItem::kSignalEncrypted;
+      status = sample_queue_->Push(signal_encrypted, kInfiniteTimeout);
+      if (!status.ok())
+        return status;
+      encryption_marker_sent_ = true;
+    }
+  }
+
+  if (!segment_expected_open_ && !sample->is_key_frame())
+    LOG(WARNING) << "A segment will start with a non key frame.";
+  segment_expected_open_ = true;
+
+  PipelineItem item;
+  item.type = PipelineItem::kSample;
+  item.sample = sample;
+  status = sample_queue_->Push(item, kInfiniteTimeout);
+  if (!status.ok())
+    return status;
+
+  const double scaled_sample_duration = sample->duration() * timescale_scale_;
+  current_segment_total_sample_duration_ +=
+      scaled_sample_duration / kTsTimescale;
+  return Status::OK;
+}
+
+void TsSegmenter::StartPipeline() {
+  DCHECK(!pipeline_started_);
+  pipeline_enabled_ = true;
+  pes_packet_generator_->SetDeferEncryption(true);
+  sample_queue_.reset(new SpscRingQueue<PipelineItem>(kPipelineQueueCapacity));
+  pes_queue_.reset(new SpscRingQueue<PipelineItem>(kPipelineQueueCapacity));
+  ts_queue_.reset(new SpscRingQueue<PipelineItem>(kPipelineQueueCapacity));
+  pes_thread_.reset(new ClosureThread(
+      "TsSegmenterPes",
+      base::Bind(&TsSegmenter::PesWorkerTask, base::Unretained(this))));
+  encrypt_thread_.reset(new ClosureThread(
+      "TsSegmenterEncrypt",
+      base::Bind(&TsSegmenter::EncryptWorkerTask, base::Unretained(this))));
+  packetize_thread_.reset(new ClosureThread(
+      "TsSegmenterPacketize",
+      base::Bind(&TsSegmenter::PacketizeWorkerTask, base::Unretained(this))));
+  pes_thread_->Start();
+  encrypt_thread_->Start();
+  packetize_thread_->Start();
+  pipeline_started_ = true;
+}
+
+Status TsSegmenter::StopPipeline() {
+  DCHECK(pipeline_started_);
+  PipelineItem stop_item;
+  stop_item.type = PipelineItem::kStop;
+  Status status = sample_queue_->Push(stop_item, kInfiniteTimeout);
+  if (!status.ok()) {
+    // The push cannot fail unless the queues have been stopped; make sure
+    // the workers are unblocked regardless.
+    sample_queue_->Stop();
+    pes_queue_->Stop();
+    ts_queue_->Stop();
+  }
+  pes_thread_->Join();
+  encrypt_thread_->Join();
+  packetize_thread_->Join();
+  pipeline_started_ = false;
+  status.Update(pipeline_status());
+  return status;
+}
+
+void TsSegmenter::PesWorkerTask() {
+  // Whether PES packets generated from now on have to be encrypted
+  // downstream. The key may have been applied before the pipeline started if
+  // there is no clear lead.
+  bool encrypted = encryption_started_;
+  PipelineItem item;
+  while (sample_queue_->Pop(&item, kInfiniteTimeout).ok()) {
+    switch (item.type) {
+      case PipelineItem::kSample:
+        if (pipeline_status().ok() &&
+            !pes_packet_generator_->PushSample(item.sample)) {
+          SetPipelineStatus(Status(
+              error::MUXER_FAILURE,
+              "Failed to add sample to PesPacketGenerator."));
+        }
+        ForwardReadyPesPackets(encrypted);
+        // Samples are not forwarded; they end here.
+        continue;
+      case PipelineItem::kEndSegment:
+        if (pipeline_status().ok() && !pes_packet_generator_->Flush()) {
+          SetPipelineStatus(Status(error::MUXER_FAILURE,
+                                   "Failed to flush PesPacketGenerator."));
+        }
+        ForwardReadyPesPackets(encrypted);
+        break;
+      case PipelineItem::kSignalEncrypted:
+        // Packets already generated are still clear; forward them before the
+        // marker.
+        ForwardReadyPesPackets(encrypted);
+        if (pipeline_status().ok() &&
+            !pes_packet_generator_->SetEncryptionKey(encryption_key_.Pass())) {
+          SetPipelineStatus(
+              Status(error::INTERNAL_ERROR, "Failed to set encryption key."));
+        }
+        encrypted = true;
+        break;
+      case PipelineItem::kStop:
+        ForwardReadyPesPackets(encrypted);
+        break;
+      default:
+        break;
+    }
+
+    pes_queue_->Push(item, kInfiniteTimeout);
+    if (item.type == PipelineItem::kStop)
+      return;
+  }
+}
+
+void TsSegmenter::ForwardReadyPesPackets(bool encrypt) {
+  while (pes_packet_generator_->NumberOfReadyPesPackets() > 0u) {
+    PipelineItem pes_item;
+    pes_item.type = PipelineItem::kPesPacket;
+    pes_item.pes_packet = pes_packet_generator_->GetNextPesPacket().release();
+    pes_item.encrypt = encrypt;
+    if (!pes_queue_->Push(pes_item, kInfiniteTimeout).ok()) {
+      delete pes_item.pes_packet;
+      return;
+    }
+  }
+}
+
+void TsSegmenter::EncryptWorkerTask() {
+  PipelineItem item;
+  while (pes_queue_->Pop(&item, kInfiniteTimeout).ok()) {
+    if (item.type == PipelineItem::kPesPacket && item.encrypt &&
+        pipeline_status().ok() &&
+        !pes_packet_generator_->EncryptPesPacket(item.pes_packet)) {
+      SetPipelineStatus(
+          Status(error::INTERNAL_ERROR, "Failed to encrypt PES packet."));
+    }
+    if (!ts_queue_->Push(item, kInfiniteTimeout).ok()) {
+      if (item.type == PipelineItem::kPesPacket)
+        delete item.pes_packet;
+      return;
+    }
+    if (item.type == PipelineItem::kStop)
+      return;
+  }
+}
+
+void TsSegmenter::PacketizeWorkerTask() {
+  PipelineItem item;
+  while (ts_queue_->Pop(&item, kInfiniteTimeout).ok()) {
+    switch (item.type) {
+      case PipelineItem::kPesPacket: {
+        scoped_ptr<PesPacket> pes_packet(item.pes_packet);
+        item.pes_packet = NULL;
+        if (!pipeline_status().ok())
+          break;
+        Status status = OpenNewSegmentIfClosed(pes_packet->pts());
+        if (!status.ok()) {
+          SetPipelineStatus(status);
+          break;
+        }
+        if (!ts_writer_->AddPesPacket(pes_packet.Pass())) {
+          SetPipelineStatus(
+              Status(error::MUXER_FAILURE, "Failed to add PES packet."));
+        }
+        break;
+      }
+      case PipelineItem::kEndSegment:
+        if (pipeline_status().ok() && ts_writer_file_opened_)
+          SetPipelineStatus(FinalizeCurrentSegment(item.segment_duration));
+        break;
+      case PipelineItem::kSignalEncrypted:
+        if (listener_)
+          listener_->OnEncryptionStart();
+        ts_writer_->SignalEncrypted();
+        break;
+      case PipelineItem::kStop:
+        return;
+      default:
+        break;
+    }
+  }
+}
+
+Status TsSegmenter::pipeline_status() {
+  base::AutoLock auto_lock(pipeline_status_lock_);
+  return pipeline_status_;
+}
+
+void TsSegmenter::SetPipelineStatus(const Status& status) {
+  base::AutoLock auto_lock(pipeline_status_lock_);
+  pipeline_status_.Update(status);
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
@@ -8,9 +8,13 @@
 #define PACKAGER_MEDIA_FORMATS_MP2T_TS_SEGMENTER_H_
 
 #include "packager/base/memory/scoped_ptr.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/media/base/media_stream.h"
 #include "packager/media/base/muxer_options.h"
+#include "packager/media/base/muxer_util.h"
+#include "packager/media/base/spsc_ring_queue.h"
 #include "packager/media/base/status.h"
+#include "packager/media/base/video_stream_info.h"
 #include "packager/media/file/file.h"
 #include "packager/media/formats/mp2t/pes_packet_generator.h"
 #include "packager/media/formats/mp2t/ts_writer.h"
@@ -18,14 +22,17 @@
 namespace shaka {
 namespace media {
 
+class ClosureThread;
 class KeySource;
 class MuxerListener;
 
 namespace mp2t {
 
-// TODO(rkuroiwa): For now, this implements multifile segmenter. Like other
-// make this an abstract super class and implement multifile and single file
-// segmenters.
+class PesPacket;
+
+// Writes one file per segment if a segment template is specified in the
+// muxer options; otherwise all the segments are appended to the output file
+// and referenced by byte range.
 class TsSegmenter {
  public:
   // TODO(rkuroiwa): Add progress listener?
@@ -53,6 +60,12 @@ class TsSegmenter {
   /// @return OK on success.
   Status AddSample(scoped_refptr<MediaSample> sample);
 
+  /// Set the stream the samples come from, enabling GOP lookahead when
+  /// deciding segment cut points; see MediaStream::PeekNextKeyFrameTimestamp.
+  /// @param stream may be NULL, which disables lookahead. The caller retains
+  ///        ownership.
+  void set_media_stream(const MediaStream* stream) { media_stream_ = stream; }
+
   /// Only for testing.
   void InjectTsWriterForTesting(scoped_ptr<TsWriter> writer);
 
@@ -64,6 +77,33 @@ class TsSegmenter {
   void SetTsWriterFileOpenedForTesting(bool value);
 
  private:
+  // One unit of work flowing through the sample-AES pipeline. Which payload
+  // field is meaningful depends on |type|; the others are left default.
+  struct PipelineItem {
+    enum Type {
+      // |sample| is set. Only appears on the sample queue.
+      kSample,
+      // |pes_packet| (owned) and |encrypt| are set. Only appears on the PES
+      // and TS queues.
+      kPesPacket,
+      // |segment_duration| is set. Ends the current segment.
+      kEndSegment,
+      // PES packets after this marker are encrypted.
+      kSignalEncrypted,
+      // Last item pushed; makes the workers exit.
+      kStop,
+    };
+
+    PipelineItem();
+
+    Type type;
+    scoped_refptr<MediaSample> sample;
+    PesPacket* pes_packet;
+    bool encrypt;
+    // Duration in seconds of the segment ended by a kEndSegment item.
+    double segment_duration;
+  };
+
   Status OpenNewSegmentIfClosed(uint32_t next_pts);
 
   // Writes PES packets (carried in TsPackets) to a file. If a file is not open,
@@ -75,9 +115,48 @@ class TsSegmenter {
   // before calling this, this will open one and write them to file.
   Status Flush();
 
+  // Finalizes the currently open segment file and notifies the listener with
+  // @a duration_in_seconds as the segment duration. A segment file must be
+  // open.
+  Status FinalizeCurrentSegment(double duration_in_seconds);
+
   // If conditions are met, notify objects that the data is encrypted.
   Status NotifyEncrypted();
 
+  // Returns true if the current segment should end before |sample|, i.e.
+  // |sample| starts the next segment. True at the first key frame past the
+  // target duration, or earlier when GOP lookahead (see set_media_stream())
+  // shows that appending the GOP starting at |sample| would leave the segment
+  // further past the target than cutting now leaves it short.
+  bool ShouldCutSegment(const MediaSample& sample) const;
+
+  // AddSample() for the threaded pipeline; pushes the sample and any segment
+  // or encryption markers onto the sample queue instead of processing them
+  // inline.
+  Status AddSampleToPipeline(scoped_refptr<MediaSample> sample);
+
+  // Creates the pipeline queues and starts the three worker threads. Must be
+  // called at most once, after the generator and writer are initialized.
+  void StartPipeline();
+
+  // Pushes the stop marker through the pipeline and joins the worker threads.
+  // @return the accumulated pipeline status.
+  Status StopPipeline();
+
+  // Stage 1: generates (but does not encrypt) PES packets from samples.
+  void PesWorkerTask();
+  // Stage 2: encrypts PES packets in place.
+  void EncryptWorkerTask();
+  // Stage 3: packetizes PES packets into TS and writes segment files.
+  void PacketizeWorkerTask();
+
+  // Moves all ready PES packets from the generator onto the PES queue.
+  void ForwardReadyPesPackets(bool encrypt);
+
+  Status pipeline_status();
+  // Records @a status; earlier errors win over later ones.
+  void SetPipelineStatus(const Status& status);
+
   const MuxerOptions& muxer_options_;
   MuxerListener* const listener_;
 
@@ -85,6 +164,17 @@ class TsSegmenter {
   // Used for calculating the duration in seconds fo the current segment.
   double timescale_scale_ = 1.0;
 
+  // The input stream's timescale, for converting lookahead timestamps to
+  // seconds. Set in Initialize().
+  uint32_t stream_timescale_ = 0;
+
+  // Set in Initialize() for video streams; its key frame index, when the
+  // parser built one, answers next-key-frame queries for segment planning.
+  scoped_refptr<const VideoStreamInfo> video_stream_info_;
+
+  // Not owned, may be NULL. See set_media_stream().
+  const MediaStream* media_stream_ = NULL;
+
   // This is the sum of the durations of the samples that were added to
   // PesPacketGenerator for the current segment (in seconds). Note that this is
   // not necessarily the same as the length of the PesPackets that have been
@@ -93,6 +183,16 @@ class TsSegmenter {
 
   // Used for segment template.
   uint64_t segment_number_ = 0;
+  // Segment name template compiled once in Initialize(); segment names are
+  // rendered from it for every segment.
+  SegmentNameTemplate segment_name_template_;
+
+  // True if there is no segment template: all the segments are appended to
+  // |muxer_options_.output_file_name| and referenced by byte range.
+  bool single_file_mode_ = false;
+  // True while the single output file is open, i.e. between the first
+  // segment's NewSegment() and Finalize().
+  bool single_file_opened_ = false;
 
   scoped_ptr<TsWriter> ts_writer_;
   // Set to true if TsWriter::NewFile() succeeds, set to false after
@@ -109,6 +209,33 @@ class TsSegmenter {
   scoped_ptr<EncryptionKey> encryption_key_;
   double clear_lead_in_seconds_ = 0;
 
+  // Sample-AES pipeline state. The pipeline is enabled when the output is
+  // encrypted and |muxer_options_.num_encryption_threads| is greater than
+  // one: PES generation, sample encryption and TS packetization then each run
+  // on their own thread with bounded queues in between. With the pipeline
+  // enabled, members below the queues are only touched by the indicated
+  // worker thread; ordering between the muxer thread and the workers is
+  // established by the queue handoffs.
+  bool pipeline_enabled_ = false;
+  bool pipeline_started_ = false;
+  // True once the encryption key has been applied (inline) or the
+  // kSignalEncrypted marker has been pushed (pipeline), so it happens once.
+  bool encryption_marker_sent_ = false;
+  // True if the key was applied before the pipeline started (no clear lead).
+  bool encryption_started_ = false;
+  bool has_encryption_key_ = false;
+  // Muxer-thread mirror of whether a segment is expected to be open; only
+  // used for the non-key-frame warning in pipeline mode.
+  bool segment_expected_open_ = false;
+  scoped_ptr<SpscRingQueue<PipelineItem> > sample_queue_;
+  scoped_ptr<SpscRingQueue<PipelineItem> > pes_queue_;
+  scoped_ptr<SpscRingQueue<PipelineItem> > ts_queue_;
+  scoped_ptr<ClosureThread> pes_thread_;
+  scoped_ptr<ClosureThread> encrypt_thread_;
+  scoped_ptr<ClosureThread> packetize_thread_;
+  base::Lock pipeline_status_lock_;
+  Status pipeline_status_;
+
   // The total duration of the segments that it has segmented. This only
   // includes segments that have been finailzed. IOW, this does not count the
   // current segments duration.
@@ -18,9 +18,11 @@ namespace shaka {
 namespace media {
 namespace mp2t {
 
+using ::testing::DoAll;
 using ::testing::InSequence;
 using ::testing::Return;
 using ::testing::Sequence;
+using ::testing::SetArgPointee;
 using ::testing::StrEq;
 using ::testing::_;
 
@@ -75,8 +77,11 @@ class MockTsWriter : public TsWriter {
  public:
   MOCK_METHOD1(Initialize, bool(const StreamInfo& stream_info));
   MOCK_METHOD1(NewSegment, bool(const std::string& file_name));
+  MOCK_METHOD0(NewSegmentInCurrentFile, bool());
   MOCK_METHOD0(SignalEncrypted, void());
   MOCK_METHOD0(FinalizeSegment, bool());
+  MOCK_METHOD1(FinalizeSegmentKeepFileOpen, bool(uint64_t* segment_size));
+  MOCK_METHOD0(CloseFile, bool());
 
   // Similar to the hack above but takes a scoped_ptr.
   MOCK_METHOD1(AddPesPacketMock, bool(PesPacket* pes_packet));
@@ -278,6 +283,123 @@ TEST_F(TsSegmenterTest, PassedSegmentDuration) {
   EXPECT_OK(segmenter.AddSample(sample2));
 }
 
+// Without a segment template, all the segments should be appended to the
+// output file, which is kept open until Finalize().
+TEST_F(TsSegmenterTest, SingleFileMode) {
+  const uint32_t kInputTimescale = 1001;
+  scoped_refptr<VideoStreamInfo> stream_info(new VideoStreamInfo(
+      kTrackId, kInputTimescale, kDuration, kH264VideoCodec, kCodecString,
+      kLanguage, kWidth, kHeight, kPixelWidth, kPixelHeight, kTrickPlayRate,
+      kNaluLengthSize, kExtraData, arraysize(kExtraData), kIsEncrypted));
+  MuxerOptions options;
+  options.segment_duration = 10.0;
+  options.single_segment = true;
+  options.output_file_name = "file.ts";
+
+  MockMuxerListener mock_listener;
+  TsSegmenter segmenter(options, &mock_listener);
+
+  const uint32_t kFirstPts = 1000;
+  const uint64_t kFirstSegmentSize = 123456;
+
+  EXPECT_CALL(*mock_ts_writer_, Initialize(_)).WillOnce(Return(true));
+  EXPECT_CALL(*mock_pes_packet_generator_, Initialize(_))
+      .WillOnce(Return(true));
+
+  scoped_refptr<MediaSample> sample1 =
+      MediaSample::CopyFrom(kAnyData, arraysize(kAnyData), kIsKeyFrame);
+  scoped_refptr<MediaSample> sample2 =
+      MediaSample::CopyFrom(kAnyData, arraysize(kAnyData), kIsKeyFrame);
+
+  // 11 seconds > 10 seconds (segment duration), so the first segment is
+  // finalized when the second sample is added.
+  sample1->set_duration(kInputTimescale * 11);
+  sample2->set_duration(kInputTimescale * 7);
+
+  // Both segment events should report the output file. The first one should
+  // get the size reported by FinalizeSegmentKeepFileOpen().
+  Sequence listener_sequence;
+  EXPECT_CALL(
+      mock_listener,
+      OnNewSegment("file.ts", kFirstPts, kTimeScale * 11, kFirstSegmentSize))
+      .InSequence(listener_sequence);
+  EXPECT_CALL(mock_listener, OnNewSegment("file.ts", _, _, _))
+      .InSequence(listener_sequence);
+
+  Sequence writer_sequence;
+  // The file is opened once; the second segment is appended to it.
+  EXPECT_CALL(*mock_ts_writer_, NewSegment(StrEq("file.ts")))
+      .InSequence(writer_sequence)
+      .WillOnce(Return(true));
+  EXPECT_CALL(*mock_ts_writer_, FinalizeSegmentKeepFileOpen(_))
+      .InSequence(writer_sequence)
+      .WillOnce(DoAll(SetArgPointee<0>(kFirstSegmentSize), Return(true)));
+  EXPECT_CALL(*mock_ts_writer_, NewSegmentInCurrentFile())
+      .InSequence(writer_sequence)
+      .WillOnce(Return(true));
+  EXPECT_CALL(*mock_ts_writer_, FinalizeSegmentKeepFileOpen(_))
+      .InSequence(writer_sequence)
+      .WillOnce(DoAll(SetArgPointee<0>(1u), Return(true)));
+  EXPECT_CALL(*mock_ts_writer_, CloseFile())
+      .InSequence(writer_sequence)
+      .WillOnce(Return(true));
+
+  EXPECT_CALL(*mock_pes_packet_generator_, PushSample(_))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+
+  Sequence ready_pes_sequence;
+  // First AddSample().
+  EXPECT_CALL(*mock_pes_packet_generator_, NumberOfReadyPesPackets())
+      .InSequence(ready_pes_sequence)
+      .WillOnce(Return(1u));
+  EXPECT_CALL(*mock_pes_packet_generator_, NumberOfReadyPesPackets())
+      .InSequence(ready_pes_sequence)
+      .WillOnce(Return(0u));
+  // When Flush() is called, inside second AddSample().
+  EXPECT_CALL(*mock_pes_packet_generator_, NumberOfReadyPesPackets())
+      .InSequence(ready_pes_sequence)
+      .WillOnce(Return(0u));
+  // Still inside AddSample() but after Flush().
+  EXPECT_CALL(*mock_pes_packet_generator_, NumberOfReadyPesPackets())
+      .InSequence(ready_pes_sequence)
+      .WillOnce(Return(1u));
+  EXPECT_CALL(*mock_pes_packet_generator_, NumberOfReadyPesPackets())
+      .InSequence(ready_pes_sequence)
+      .WillOnce(Return(0u));
+  // Inside Finalize().
+  EXPECT_CALL(*mock_pes_packet_generator_, NumberOfReadyPesPackets())
+      .InSequence(ready_pes_sequence)
+      .WillOnce(Return(0u));
+
+  EXPECT_CALL(*mock_pes_packet_generator_, Flush())
+      .Times(2)
+      .WillRepeatedly(Return(true));
+
+  EXPECT_CALL(*mock_ts_writer_, AddPesPacketMock(_))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+
+  // The pointers are released inside the segmenter.
+  Sequence pes_packet_sequence;
+  PesPacket* first_pes = new PesPacket();
+  first_pes->set_pts(kFirstPts);
+  EXPECT_CALL(*mock_pes_packet_generator_, GetNextPesPacketMock())
+      .InSequence(pes_packet_sequence)
+      .WillOnce(Return(first_pes));
+  EXPECT_CALL(*mock_pes_packet_generator_, GetNextPesPacketMock())
+      .InSequence(pes_packet_sequence)
+      .WillOnce(Return(new PesPacket()));
+
+  segmenter.InjectTsWriterForTesting(mock_ts_writer_.Pass());
+  segmenter.InjectPesPacketGeneratorForTesting(
+      mock_pes_packet_generator_.Pass());
+  EXPECT_OK(segmenter.Initialize(*stream_info, nullptr, 0, 0));
+  EXPECT_OK(segmenter.AddSample(sample1));
+  EXPECT_OK(segmenter.AddSample(sample2));
+  EXPECT_OK(segmenter.Finalize());
+}
+
 // Finalize right after Initialize(). The writer will not be initialized.
 TEST_F(TsSegmenterTest, InitializeThenFinalize) {
   scoped_refptr<VideoStreamInfo> stream_info(new VideoStreamInfo(
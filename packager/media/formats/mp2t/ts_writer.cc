@@ -6,7 +6,7 @@
 
 #include "packager/media/formats/mp2t/ts_writer.h"
 
-#include <algorithm>
+#include "packager/media/base/trace_span.h"
 
 #include "packager/base/logging.h"
 #include "packager/media/base/audio_stream_info.h"
@@ -47,12 +47,7 @@ const uint8_t kPat[] = {
 const bool kHasPcr = true;
 const bool kPayloadUnitStartIndicator = true;
 
-// This is the size of the first few fields in a TS packet, i.e. TS packet size
-// without adaptation field or the payload.
-const int kTsPacketHeaderSize = 4;
 const int kTsPacketSize = 188;
-const int kTsPacketMaximumPayloadSize =
-    kTsPacketSize - kTsPacketHeaderSize;
 
 const size_t kMaxPesPacketLengthValue = 0xFFFF;
 
@@ -87,17 +82,9 @@ void WritePtsOrDts(uint8_t leading_bits,
   writer->AppendInt(fifth_byte);
 }
 
-bool WritePesToFile(const PesPacket& pes,
-                    ContinuityCounter* continuity_counter,
-                    File* file) {
-  // The size of the length field.
-  const int kAdaptationFieldLengthSize = 1;
-  // The size of the flags field.
-  const int kAdaptationFieldHeaderSize = 1;
-  const int kPcrFieldSize = 6;
-  const int kTsPacketMaxPayloadWithPcr =
-      kTsPacketMaximumPayloadSize - kAdaptationFieldLengthSize -
-      kAdaptationFieldHeaderSize - kPcrFieldSize;
+void WritePesToBuffer(const PesPacket& pes,
+                      ContinuityCounter* continuity_counter,
+                      BufferWriter* segment_buffer) {
   const uint64_t pcr_base = pes.has_dts() ? pes.dts() : pes.pts();
   const int pid = ProgramMapTableWriter::kElementaryPid;
 
@@ -125,36 +112,29 @@ bool WritePesToFile(const PesPacket& pes,
     WritePtsOrDts(0x02, pes.pts(), &pes_header_writer);
   }
 
-  // Put the first TS packet's payload into a buffer. This contains the PES
-  // packet's header.
-  BufferWriter first_ts_packet_buffer(kTsPacketSize);
-  first_ts_packet_buffer.AppendNBytes(static_cast<uint64_t>(0x000001), 3);
-  first_ts_packet_buffer.AppendInt(pes.stream_id());
-  const size_t pes_packet_length = pes.data().size() + pes_header_writer.Size();
-  first_ts_packet_buffer.AppendInt(static_cast<uint16_t>(
+  // PES packet start code, stream id and length, followed by the optional
+  // fields built above.
+  BufferWriter pes_prefix_writer(kTsPacketSize);
+  pes_prefix_writer.AppendNBytes(static_cast<uint64_t>(0x000001), 3);
+  pes_prefix_writer.AppendInt(pes.stream_id());
+  const size_t pes_packet_length =
+      pes.payload_size() + pes_header_writer.Size();
+  pes_prefix_writer.AppendInt(static_cast<uint16_t>(
       pes_packet_length > kMaxPesPacketLengthValue ? 0 : pes_packet_length));
-  first_ts_packet_buffer.AppendBuffer(pes_header_writer);
-
-  const int available_payload =
-      kTsPacketMaxPayloadWithPcr - first_ts_packet_buffer.Size();
-  const int bytes_consumed =
-      std::min(static_cast<int>(pes.data().size()), available_payload);
-  first_ts_packet_buffer.AppendArray(pes.data().data(), bytes_consumed);
-
-  BufferWriter output_writer;
-  WritePayloadToBufferWriter(first_ts_packet_buffer.Buffer(),
-                             first_ts_packet_buffer.Size(),
-                             kPayloadUnitStartIndicator, pid, kHasPcr, pcr_base,
-                             continuity_counter, &output_writer);
-
-  const size_t remaining_pes_data_size = pes.data().size() - bytes_consumed;
-  if (remaining_pes_data_size > 0) {
-    WritePayloadToBufferWriter(pes.data().data() + bytes_consumed,
-                               remaining_pes_data_size,
-                               !kPayloadUnitStartIndicator, pid, !kHasPcr, 0,
-                               continuity_counter, &output_writer);
-  }
-  return output_writer.WriteToFile(file).ok();
+  pes_prefix_writer.AppendBuffer(pes_header_writer);
+
+  // The PES prefix and the payload slices are packetized in one pass. The
+  // sample-backed slice, if any, is consumed where it is instead of being
+  // copied into a contiguous buffer first.
+  const PayloadSpan spans[] = {
+      {pes_prefix_writer.Buffer(), pes_prefix_writer.Size()},
+      {pes.data().data(), pes.data().size()},
+      {pes.sample_data(), pes.sample_data_size()},
+  };
+  WriteMultiSpanPayloadToBufferWriter(spans, arraysize(spans),
+                                      kPayloadUnitStartIndicator, pid, kHasPcr,
+                                      pcr_base, continuity_counter,
+                                      segment_buffer);
 }
 
 }  // namespace
@@ -206,24 +186,41 @@ bool TsWriter::NewSegment(const std::string& file_name) {
     LOG(ERROR) << "Failed to open file " << file_name;
     return false;
   }
+  return StartSegmentBuffer();
+}
 
-  BufferWriter psi;
-  WritePatToBuffer(kPat, arraysize(kPat), &pat_continuity_counter_, &psi);
+bool TsWriter::NewSegmentInCurrentFile() {
+  if (!current_file_) {
+    LOG(ERROR) << "No file open to append a segment to.";
+    return false;
+  }
+  return StartSegmentBuffer();
+}
+
+bool TsWriter::StartSegmentBuffer() {
+  // The PSI goes into the segment buffer like everything else; the whole
+  // segment is written to file at FinalizeSegment().
+  DCHECK_EQ(0u, segment_buffer_.Size());
+  if (pat_packets_.empty()) {
+    BufferWriter pat_writer;
+    ContinuityCounter temp_continuity_counter;
+    WritePatToBuffer(kPat, arraysize(kPat), &temp_continuity_counter,
+                     &pat_writer);
+    pat_packets_.assign(pat_writer.Buffer(),
+                        pat_writer.Buffer() + pat_writer.Size());
+  }
+  WritePsiPacketsFromCache(&pat_packets_, &pat_continuity_counter_,
+                           &segment_buffer_);
   if (encrypted_) {
-    if (!pmt_writer_->EncryptedSegmentPmt(&psi)) {
+    if (!pmt_writer_->EncryptedSegmentPmt(&segment_buffer_)) {
       return false;
     }
   } else {
-    if (!pmt_writer_->ClearSegmentPmt(&psi)) {
+    if (!pmt_writer_->ClearSegmentPmt(&segment_buffer_)) {
       return false;
     }
   }
 
-  if (!psi.WriteToFile(current_file_.get()).ok()) {
-    LOG(ERROR) << "Failed to write PSI to file.";
-    return false;
-  }
-
   return true;
 }
 
@@ -232,16 +229,36 @@ void TsWriter::SignalEncrypted() {
 }
 
 bool TsWriter::FinalizeSegment() {
+  if (!WriteSegmentBufferToFile())
+    return false;
   return current_file_.release()->Close();
 }
 
-bool TsWriter::AddPesPacket(scoped_ptr<PesPacket> pes_packet) {
-  DCHECK(current_file_);
-  if (!WritePesToFile(*pes_packet, &elementary_stream_continuity_counter_,
-                      current_file_.get())) {
-    LOG(ERROR) << "Failed to write pes to file.";
+bool TsWriter::FinalizeSegmentKeepFileOpen(uint64_t* segment_size) {
+  DCHECK(segment_size);
+  *segment_size = segment_buffer_.Size();
+  return WriteSegmentBufferToFile();
+}
+
+bool TsWriter::CloseFile() {
+  if (!current_file_)
+    return true;
+  return current_file_.release()->Close();
+}
+
+bool TsWriter::WriteSegmentBufferToFile() {
+  TRACE_SPAN("mux", "TsWriter::WriteSegment");
+  if (!segment_buffer_.WriteToFile(current_file_.get()).ok()) {
+    LOG(ERROR) << "Failed to write segment to file.";
     return false;
   }
+  return true;
+}
+
+bool TsWriter::AddPesPacket(scoped_ptr<PesPacket> pes_packet) {
+  DCHECK(current_file_);
+  WritePesToBuffer(*pes_packet, &elementary_stream_continuity_counter_,
+                   &segment_buffer_);
 
   // No need to keep pes_packet around so not passing it anywhere.
   return true;
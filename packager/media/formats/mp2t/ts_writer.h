@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "packager/base/memory/scoped_ptr.h"
+#include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/media_stream.h"
 #include "packager/media/file/file.h"
 #include "packager/media/file/file_closer.h"
@@ -41,6 +42,12 @@ class TsWriter {
   /// @return true on success, false otherwise.
   virtual bool NewSegment(const std::string& file_name);
 
+  /// Starts a new segment that is appended to the file opened by
+  /// NewSegment(), for single file (byte range) output. The previous segment
+  /// must have been finalized with FinalizeSegmentKeepFileOpen().
+  /// @return true on success, false otherwise.
+  virtual bool NewSegmentInCurrentFile();
+
   /// Signals the writer that the rest of the segments are encrypted.
   virtual void SignalEncrypted();
 
@@ -49,6 +56,16 @@ class TsWriter {
   /// @return true on success, false otherwise.
   virtual bool FinalizeSegment();
 
+  /// Same as FinalizeSegment() but keeps the file open, so that the next
+  /// segment can be appended to it with NewSegmentInCurrentFile().
+  /// @param segment_size gets the size of the finalized segment in bytes.
+  /// @return true on success, false otherwise.
+  virtual bool FinalizeSegmentKeepFileOpen(uint64_t* segment_size);
+
+  /// Closes the file opened by NewSegment(). No-op if no file is open.
+  /// @return true on success, false otherwise.
+  virtual bool CloseFile();
+
   /// Add PesPacket to the instance. PesPacket might not get written to file
   /// immediately.
   /// @param pes_packet gets added to the writer.
@@ -60,6 +77,12 @@ class TsWriter {
       scoped_ptr<ProgramMapTableWriter> table_writer);
 
  private:
+  // Writes the PSI at the beginning of a new segment into |segment_buffer_|.
+  bool StartSegmentBuffer();
+
+  // Writes |segment_buffer_| to |current_file_|.
+  bool WriteSegmentBufferToFile();
+
   // True if further segments generated by this instance should be encrypted.
   bool encrypted_ = false;
 
@@ -67,10 +90,20 @@ class TsWriter {
   ContinuityCounter pat_continuity_counter_;
   ContinuityCounter elementary_stream_continuity_counter_;
 
+  // TS-packetized PAT, generated on first use. The PAT is the same for every
+  // segment except for the continuity_counter, so the packets are reused with
+  // that field patched per segment.
+  std::vector<uint8_t> pat_packets_;
+
   scoped_ptr<ProgramMapTableWriter> pmt_writer_;
 
   scoped_ptr<File, FileCloser> current_file_;
 
+  // The current segment is assembled here and written to file in one go at
+  // FinalizeSegment(). The buffer is cleared by the write but keeps its
+  // capacity, so it is reused across segments.
+  BufferWriter segment_buffer_;
+
   DISALLOW_COPY_AND_ASSIGN(TsWriter);
 };
 
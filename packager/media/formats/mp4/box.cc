@@ -23,14 +23,19 @@ bool Box::Parse(BoxReader* reader) {
 }
 
 void Box::Write(BufferWriter* writer) {
-  DCHECK(writer);
   // Compute and update box size.
   uint32_t size = ComputeSize();
   DCHECK_EQ(size, box_size_);
 
+  WriteUsingComputedSize(writer);
+}
+
+void Box::WriteUsingComputedSize(BufferWriter* writer) {
+  DCHECK(writer);
   size_t buffer_size_before_write = writer->Size();
   BoxBuffer buffer(writer);
   CHECK(ReadWriteInternal(&buffer));
+  // Written size must agree with the (possibly precomputed) box size.
   DCHECK_EQ(box_size_, writer->Size() - buffer_size_before_write)
       << FourCCToString(BoxType());
 }
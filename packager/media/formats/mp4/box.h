@@ -36,6 +36,12 @@ struct Box {
   /// @param writer points to a BufferWriter object which wraps the buffer for
   ///        writing.
   void Write(BufferWriter* writer);
+  /// Write the box to buffer, reusing the box sizes set by an earlier
+  /// ComputeSize() call instead of re-walking the box tree. The box contents
+  /// must not have changed in a size-affecting way since that call.
+  /// @param writer points to a BufferWriter object which wraps the buffer for
+  ///        writing.
+  void WriteUsingComputedSize(BufferWriter* writer);
   /// Write the box header to buffer. This function calls ComputeSize internally
   /// to compute and update box size.
   /// @param writer points to a BufferWriter object which wraps the buffer for
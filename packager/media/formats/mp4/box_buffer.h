@@ -7,6 +7,7 @@
 #ifndef MEDIA_FORMATS_MP4_BOX_BUFFER_H_
 #define MEDIA_FORMATS_MP4_BOX_BUFFER_H_
 
+#include <algorithm>
 #include <string>
 
 #include "packager/base/compiler_specific.h"
@@ -111,6 +112,32 @@ class BoxBuffer {
   }
   /// @}
 
+  /// Read/write a batch of fixed-width integer fields, e.g. one sample table
+  /// entry. In read mode the whole batch is validated with a single bounds
+  /// check; see BufferReader::ReadBatch.
+  /// @return true on success, false otherwise.
+  template <typename... T>
+  bool ReadWriteBatch(T*... v) {
+    if (reader_)
+      return reader_->ReadBatch(v...);
+    AppendFields(v...);
+    return true;
+  }
+
+  /// Read/write a whole column of fixed-width integer values, e.g. the
+  /// sample size table of a stsz box. The column is bounds-checked and sized
+  /// (read) or reserved (write) once instead of per element; see
+  /// BufferReader::ReadColumn and BufferWriter::AppendColumn.
+  /// @return true on success, false otherwise.
+  template <typename T>
+  bool ReadWriteColumn(std::vector<T>* v, size_t count) {
+    if (reader_)
+      return reader_->ReadColumn(v, count);
+    DCHECK_EQ(v->size(), count);
+    writer_->AppendColumn(*v);
+    return true;
+  }
+
   /// Read/write the least significant |num_bytes| of |v| from/to the buffer.
   /// @param num_bytes should not be larger than sizeof(v), i.e. 8.
   /// @return true on success, false otherwise.
@@ -189,8 +216,13 @@ class BoxBuffer {
   bool IgnoreBytes(size_t num_bytes) {
     if (reader_)
       return reader_->SkipBytes(num_bytes);
-    std::vector<uint8_t> vector(num_bytes, 0);
-    writer_->AppendVector(vector);
+    // Pad with zeros from a stack buffer instead of allocating a vector.
+    const uint8_t kZeros[16] = {0};
+    while (num_bytes > 0) {
+      const size_t chunk = std::min(num_bytes, sizeof(kZeros));
+      writer_->AppendArray(kZeros, chunk);
+      num_bytes -= chunk;
+    }
     return true;
   }
 
@@ -200,6 +232,14 @@ class BoxBuffer {
   BufferWriter* writer() { return writer_; }
 
  private:
+  // Write-mode helpers for ReadWriteBatch().
+  void AppendFields() {}
+  template <typename First, typename... Rest>
+  void AppendFields(First* first, Rest*... rest) {
+    writer_->AppendInt(*first);
+    AppendFields(rest...);
+  }
+
   BoxReader* reader_;
   BufferWriter* writer_;
 
@@ -683,8 +683,8 @@ bool DecodingTimeToSample::ReadWriteInternal(BoxBuffer* buffer) {
 
   decoding_time.resize(count);
   for (uint32_t i = 0; i < count; ++i) {
-    RCHECK(buffer->ReadWriteUInt32(&decoding_time[i].sample_count) &&
-           buffer->ReadWriteUInt32(&decoding_time[i].sample_delta));
+    RCHECK(buffer->ReadWriteBatch(&decoding_time[i].sample_count,
+                                  &decoding_time[i].sample_delta));
   }
   return true;
 }
@@ -718,15 +718,15 @@ bool CompositionTimeToSample::ReadWriteInternal(BoxBuffer* buffer) {
 
   composition_offset.resize(count);
   for (uint32_t i = 0; i < count; ++i) {
-    RCHECK(buffer->ReadWriteUInt32(&composition_offset[i].sample_count));
-
     if (version == 0) {
       uint32_t sample_offset = composition_offset[i].sample_offset;
-      RCHECK(buffer->ReadWriteUInt32(&sample_offset));
+      RCHECK(buffer->ReadWriteBatch(&composition_offset[i].sample_count,
+                                    &sample_offset));
       composition_offset[i].sample_offset = sample_offset;
     } else {
       int32_t sample_offset = composition_offset[i].sample_offset;
-      RCHECK(buffer->ReadWriteInt32(&sample_offset));
+      RCHECK(buffer->ReadWriteBatch(&composition_offset[i].sample_count,
+                                    &sample_offset));
       composition_offset[i].sample_offset = sample_offset;
     }
   }
@@ -756,9 +756,9 @@ bool SampleToChunk::ReadWriteInternal(BoxBuffer* buffer) {
 
   chunk_info.resize(count);
   for (uint32_t i = 0; i < count; ++i) {
-    RCHECK(buffer->ReadWriteUInt32(&chunk_info[i].first_chunk) &&
-           buffer->ReadWriteUInt32(&chunk_info[i].samples_per_chunk) &&
-           buffer->ReadWriteUInt32(&chunk_info[i].sample_description_index));
+    RCHECK(buffer->ReadWriteBatch(&chunk_info[i].first_chunk,
+                                  &chunk_info[i].samples_per_chunk,
+                                  &chunk_info[i].sample_description_index));
     // first_chunk values are always increasing.
     RCHECK(i == 0 ? chunk_info[i].first_chunk == 1
                   : chunk_info[i].first_chunk > chunk_info[i - 1].first_chunk);
@@ -781,12 +781,11 @@ bool SampleSize::ReadWriteInternal(BoxBuffer* buffer) {
          buffer->ReadWriteUInt32(&sample_count));
 
   if (sample_size == 0) {
-    if (buffer->Reading())
-      sizes.resize(sample_count);
-    else
+    if (!buffer->Reading())
       DCHECK(sample_count == sizes.size());
-    for (uint32_t i = 0; i < sample_count; ++i)
-      RCHECK(buffer->ReadWriteUInt32(&sizes[i]));
+    // The sample size table is the largest per-sample column; process it as
+    // a whole column instead of value by value.
+    RCHECK(buffer->ReadWriteColumn(&sizes, sample_count));
   }
   return true;
 }
@@ -860,9 +859,19 @@ bool ChunkOffset::ReadWriteInternal(BoxBuffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteUInt32(&count));
 
-  offsets.resize(count);
-  for (uint32_t i = 0; i < count; ++i)
-    RCHECK(buffer->ReadWriteUInt64NBytes(&offsets[i], sizeof(uint32_t)));
+  // |offsets| is kept in 64 bits so it can be swapped with co64, but the box
+  // stores 32 bits per entry, so the column goes through a 32-bit staging
+  // vector.
+  std::vector<uint32_t> offsets_32(count);
+  if (!buffer->Reading()) {
+    for (uint32_t i = 0; i < count; ++i) {
+      DCHECK(IsFitIn32Bits(offsets[i]));
+      offsets_32[i] = static_cast<uint32_t>(offsets[i]);
+    }
+  }
+  RCHECK(buffer->ReadWriteColumn(&offsets_32, count));
+  if (buffer->Reading())
+    offsets.assign(offsets_32.begin(), offsets_32.end());
   return true;
 }
 
@@ -892,9 +901,7 @@ bool ChunkLargeOffset::ReadWriteInternal(BoxBuffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteUInt32(&count));
 
-  offsets.resize(count);
-  for (uint32_t i = 0; i < count; ++i)
-    RCHECK(buffer->ReadWriteUInt64(&offsets[i]));
+  RCHECK(buffer->ReadWriteColumn(&offsets, count));
   return true;
 }
 
@@ -915,9 +922,7 @@ bool SyncSample::ReadWriteInternal(BoxBuffer* buffer) {
   RCHECK(ReadWriteHeaderInternal(buffer) &&
          buffer->ReadWriteUInt32(&count));
 
-  sample_number.resize(count);
-  for (uint32_t i = 0; i < count; ++i)
-    RCHECK(buffer->ReadWriteUInt32(&sample_number[i]));
+  RCHECK(buffer->ReadWriteColumn(&sample_number, count));
   return true;
 }
 
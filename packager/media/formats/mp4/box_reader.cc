@@ -6,6 +6,7 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
 #include <limits>
 
 #include "packager/base/logging.h"
@@ -17,6 +18,15 @@ namespace shaka {
 namespace media {
 namespace mp4 {
 
+namespace {
+
+bool ChildTypeLess(const std::pair<FourCC, size_t>& a,
+                   const std::pair<FourCC, size_t>& b) {
+  return a.first < b.first;
+}
+
+}  // namespace
+
 BoxReader::BoxReader(const uint8_t* buf, size_t size)
     : BufferReader(buf, size), type_(FOURCC_NULL), scanned_(false) {
   DCHECK(buf);
@@ -25,10 +35,9 @@ BoxReader::BoxReader(const uint8_t* buf, size_t size)
 
 BoxReader::~BoxReader() {
   if (scanned_ && !children_.empty()) {
-    for (ChildMap::iterator itr = children_.begin(); itr != children_.end();
+    for (ChildVector::iterator itr = children_.begin(); itr != children_.end();
          ++itr) {
       DVLOG(1) << "Skipping unknown box: " << FourCCToString(itr->first);
-      delete itr->second;
     }
   }
 }
@@ -70,40 +79,56 @@ bool BoxReader::ScanChildren() {
   scanned_ = true;
 
   while (pos() < size()) {
-    scoped_ptr<BoxReader> child(
-        new BoxReader(&data()[pos()], size() - pos()));
+    const size_t child_offset = pos();
+    BoxReader child(&data()[child_offset], size() - child_offset);
     bool err;
-    if (!child->ReadHeader(&err))
+    if (!child.ReadHeader(&err))
       return false;
 
-    FourCC box_type = child->type();
-    size_t box_size = child->size();
-    children_.insert(std::pair<FourCC, BoxReader*>(box_type, child.release()));
-    RCHECK(SkipBytes(box_size));
+    children_.push_back(std::pair<FourCC, size_t>(child.type(), child_offset));
+    RCHECK(SkipBytes(child.size()));
   }
 
+  // A stable sort keeps children with the same FourCC in file order, which
+  // the *Children readers rely on.
+  std::stable_sort(children_.begin(), children_.end(), ChildTypeLess);
   return true;
 }
 
+std::pair<BoxReader::ChildVector::iterator, BoxReader::ChildVector::iterator>
+BoxReader::FindChildren(FourCC child_type) {
+  return std::equal_range(children_.begin(), children_.end(),
+                          std::pair<FourCC, size_t>(child_type, 0),
+                          ChildTypeLess);
+}
+
 bool BoxReader::ReadChild(Box* child) {
   DCHECK(scanned_);
   FourCC child_type = child->BoxType();
 
-  ChildMap::iterator itr = children_.find(child_type);
-  RCHECK(itr != children_.end());
+  std::pair<ChildVector::iterator, ChildVector::iterator> range =
+      FindChildren(child_type);
+  RCHECK(range.first != range.second);
   DVLOG(2) << "Found a " << FourCCToString(child_type) << " box.";
-  RCHECK(child->Parse(itr->second));
-  delete itr->second;
-  children_.erase(itr);
+  const size_t child_offset = range.first->second;
+  BoxReader child_reader(&data()[child_offset], size() - child_offset);
+  bool err;
+  RCHECK(child_reader.ReadHeader(&err));
+  RCHECK(child->Parse(&child_reader));
+  children_.erase(range.first);
   return true;
 }
 
 bool BoxReader::ChildExist(Box* child) {
-  return children_.count(child->BoxType()) > 0;
+  std::pair<ChildVector::iterator, ChildVector::iterator> range =
+      FindChildren(child->BoxType());
+  return range.first != range.second;
 }
 
 bool BoxReader::TryReadChild(Box* child) {
-  if (!children_.count(child->BoxType()))
+  std::pair<ChildVector::iterator, ChildVector::iterator> range =
+      FindChildren(child->BoxType());
+  if (range.first == range.second)
     return true;
   return ReadChild(child);
 }
@@ -5,7 +5,7 @@
 #ifndef MEDIA_FORMATS_MP4_BOX_READER_H_
 #define MEDIA_FORMATS_MP4_BOX_READER_H_
 
-#include <map>
+#include <utility>
 #include <vector>
 
 #include "packager/base/compiler_specific.h"
@@ -112,11 +112,23 @@ class BoxReader : public BufferReader {
 
   FourCC type_;
 
-  typedef std::multimap<FourCC, BoxReader*> ChildMap;
-
-  // The set of child box FourCCs and their corresponding buffer readers. Only
-  // valid if scanned_ is true.
-  ChildMap children_;
+  // Child box FourCC and the byte offset of the box (including its header)
+  // within this box's buffer. Children are indexed by ScanChildren() and
+  // parsed on demand, over the original buffer, by the *Child functions; no
+  // per-child reader is allocated up front. A flat vector, sorted by FourCC
+  // after the scan, is used instead of a multimap: the handful of entries per
+  // box fit in one or two cache lines and lookups are a binary search over
+  // contiguous memory. Children with the same FourCC stay in file order.
+  typedef std::vector<std::pair<FourCC, size_t>> ChildVector;
+
+  // Returns the range of indexed children with type @a child_type. The range
+  // is empty if there is no such child.
+  std::pair<ChildVector::iterator, ChildVector::iterator> FindChildren(
+      FourCC child_type);
+
+  // The set of child box FourCCs and their buffer offsets. Only valid if
+  // scanned_ is true. Entries are removed as children are read.
+  ChildVector children_;
   bool scanned_;
 
   DISALLOW_COPY_AND_ASSIGN(BoxReader);
@@ -137,16 +149,18 @@ bool BoxReader::TryReadChildren(std::vector<T>* children) {
   children->resize(1);
   FourCC child_type = (*children)[0].BoxType();
 
-  ChildMap::iterator start_itr = children_.lower_bound(child_type);
-  ChildMap::iterator end_itr = children_.upper_bound(child_type);
-  children->resize(std::distance(start_itr, end_itr));
+  std::pair<ChildVector::iterator, ChildVector::iterator> range =
+      FindChildren(child_type);
+  children->resize(std::distance(range.first, range.second));
   typename std::vector<T>::iterator child_itr = children->begin();
-  for (ChildMap::iterator itr = start_itr; itr != end_itr; ++itr) {
-    RCHECK(child_itr->Parse(itr->second));
-    delete itr->second;
+  for (ChildVector::iterator itr = range.first; itr != range.second; ++itr) {
+    BoxReader child_reader(&data()[itr->second], size() - itr->second);
+    bool err;
+    RCHECK(child_reader.ReadHeader(&err));
+    RCHECK(child_itr->Parse(&child_reader));
     ++child_itr;
   }
-  children_.erase(start_itr, end_itr);
+  children_.erase(range.first, range.second);
 
   DVLOG(2) << "Found " << children->size() << " " << FourCCToString(child_type)
            << " boxes.";
@@ -14,6 +14,13 @@
 namespace shaka {
 namespace media {
 namespace mp4 {
+namespace {
+
+bool ChunkLessThanFirstChunk(uint32_t chunk, const ChunkInfo& chunk_info) {
+  return chunk < chunk_info.first_chunk;
+}
+
+}  // namespace
 
 ChunkInfoIterator::ChunkInfoIterator(const SampleToChunk& sample_to_chunk)
     : chunk_sample_index_(0),
@@ -22,6 +29,17 @@ ChunkInfoIterator::ChunkInfoIterator(const SampleToChunk& sample_to_chunk)
       iterator_(chunk_info_table_.begin()) {
   if (iterator_ != chunk_info_table_.end())
     current_chunk_ = iterator_->first_chunk;
+  if (chunk_info_table_.size() > 1) {
+    cumulative_sample_counts_.reserve(chunk_info_table_.size() - 1);
+    uint64_t sample_count = 0;
+    for (size_t i = 0; i + 1 < chunk_info_table_.size(); ++i) {
+      sample_count += static_cast<uint64_t>(
+                          chunk_info_table_[i + 1].first_chunk -
+                          chunk_info_table_[i].first_chunk) *
+                      chunk_info_table_[i].samples_per_chunk;
+      cumulative_sample_counts_.push_back(sample_count);
+    }
+  }
 }
 ChunkInfoIterator::~ChunkInfoIterator() {}
 
@@ -42,6 +60,44 @@ bool ChunkInfoIterator::AdvanceSample() {
   return true;
 }
 
+bool ChunkInfoIterator::SeekToChunk(uint32_t chunk) {
+  DCHECK_GT(chunk, 0u);
+  if (chunk_info_table_.empty() || chunk < chunk_info_table_[0].first_chunk)
+    return false;
+  // Find the last entry whose first_chunk is not greater than |chunk|.
+  iterator_ = std::upper_bound(chunk_info_table_.begin(),
+                               chunk_info_table_.end(), chunk,
+                               &ChunkLessThanFirstChunk) -
+              1;
+  current_chunk_ = chunk;
+  chunk_sample_index_ = 0;
+  return true;
+}
+
+bool ChunkInfoIterator::SeekToSample(uint32_t sample) {
+  DCHECK_GT(sample, 0u);
+  if (chunk_info_table_.empty())
+    return false;
+  const uint64_t sample_index = sample - 1;
+  std::vector<uint64_t>::const_iterator entry =
+      std::upper_bound(cumulative_sample_counts_.begin(),
+                       cumulative_sample_counts_.end(), sample_index);
+  const size_t index = entry - cumulative_sample_counts_.begin();
+  const uint64_t samples_before =
+      index == 0 ? 0 : cumulative_sample_counts_[index - 1];
+  const ChunkInfo& chunk_info = chunk_info_table_[index];
+  // Only the last entry spans an unbounded number of chunks; it cannot
+  // contain any sample if its samples_per_chunk is zero.
+  if (chunk_info.samples_per_chunk == 0)
+    return false;
+  const uint64_t offset = sample_index - samples_before;
+  iterator_ = chunk_info_table_.begin() + index;
+  current_chunk_ =
+      chunk_info.first_chunk + offset / chunk_info.samples_per_chunk;
+  chunk_sample_index_ = offset % chunk_info.samples_per_chunk;
+  return true;
+}
+
 bool ChunkInfoIterator::IsValid() const {
   return iterator_ != chunk_info_table_.end() &&
          chunk_sample_index_ < iterator_->samples_per_chunk;
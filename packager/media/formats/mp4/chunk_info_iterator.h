@@ -35,6 +35,17 @@ class ChunkInfoIterator {
   /// @return true if not past the last sample, false otherwise.
   bool AdvanceSample();
 
+  /// Seek to the given chunk. O(log n) in the number of table entries.
+  /// @param chunk is 1-based.
+  /// @return true on success, false if @a chunk is before the first chunk.
+  bool SeekToChunk(uint32_t chunk);
+
+  /// Seek to the chunk containing the given sample, positioned at that
+  /// sample. O(log n) in the number of table entries.
+  /// @param sample is 1-based.
+  /// @return true on success, false if @a sample cannot be located.
+  bool SeekToSample(uint32_t sample);
+
   /// @return true if not past the last chunk/sample, false otherwise.
   bool IsValid() const;
 
@@ -64,6 +75,10 @@ class ChunkInfoIterator {
   uint32_t current_chunk_;
   const std::vector<ChunkInfo>& chunk_info_table_;
   std::vector<ChunkInfo>::const_iterator iterator_;
+  // Prefix sums of sample counts through each table entry but the last
+  // (which spans an unbounded number of chunks), built once at construction;
+  // backs the binary search in SeekToSample.
+  std::vector<uint64_t> cumulative_sample_counts_;
 
   DISALLOW_COPY_AND_ASSIGN(ChunkInfoIterator);
 };
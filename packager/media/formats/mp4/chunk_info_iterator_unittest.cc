@@ -6,6 +6,8 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 #include "packager/base/logging.h"
 #include "packager/base/memory/scoped_ptr.h"
 #include "packager/media/formats/mp4/chunk_info_iterator.h"
@@ -109,6 +111,37 @@ TEST_F(ChunkInfoIteratorTest, AdvanceSample) {
   }
 }
 
+TEST_F(ChunkInfoIteratorTest, SeekToChunk) {
+  // Seek backwards, to exercise seeks that cross entry boundaries in both
+  // directions. Also seek beyond kNumChunks: the Sample to Chunk Box does
+  // not define the last chunk, so the last entry applies.
+  for (uint32_t chunk = kNumChunks + 5; chunk > 0; --chunk) {
+    ASSERT_TRUE(chunk_info_iterator_->SeekToChunk(chunk));
+    ASSERT_TRUE(chunk_info_iterator_->IsValid());
+    EXPECT_EQ(chunk, chunk_info_iterator_->current_chunk());
+    const ChunkProperty& expected =
+        chunk_info_table_[std::min(chunk, kNumChunks) - 1];
+    EXPECT_EQ(expected.samples_per_chunk,
+              chunk_info_iterator_->samples_per_chunk());
+    EXPECT_EQ(expected.sample_description_index,
+              chunk_info_iterator_->sample_description_index());
+  }
+}
+
+TEST_F(ChunkInfoIteratorTest, SeekToSample) {
+  uint32_t sample = 0;
+  for (uint32_t chunk = 0; chunk < kNumChunks; ++chunk) {
+    for (uint32_t i = 0; i < chunk_info_table_[chunk].samples_per_chunk; ++i) {
+      ++sample;
+      ASSERT_TRUE(chunk_info_iterator_->SeekToSample(sample));
+      ASSERT_TRUE(chunk_info_iterator_->IsValid());
+      EXPECT_EQ(chunk + 1, chunk_info_iterator_->current_chunk());
+      EXPECT_EQ(chunk_info_table_[chunk].samples_per_chunk,
+                chunk_info_iterator_->samples_per_chunk());
+    }
+  }
+}
+
 }  // namespace mp4
 }  // namespace media
 }  // namespace shaka
@@ -6,6 +6,8 @@
 
 #include "packager/media/formats/mp4/composition_offset_iterator.h"
 
+#include <algorithm>
+
 #include "packager/base/logging.h"
 
 namespace shaka {
@@ -16,7 +18,16 @@ CompositionOffsetIterator::CompositionOffsetIterator(
     const CompositionTimeToSample& composition_time_to_sample)
     : sample_index_(0),
       composition_offset_table_(composition_time_to_sample.composition_offset),
-      iterator_(composition_offset_table_.begin()) {}
+      iterator_(composition_offset_table_.begin()) {
+  cumulative_sample_counts_.reserve(composition_offset_table_.size());
+  uint32_t sample_count = 0;
+  for (std::vector<CompositionOffset>::const_iterator it =
+           composition_offset_table_.begin();
+       it != composition_offset_table_.end(); ++it) {
+    sample_count += it->sample_count;
+    cumulative_sample_counts_.push_back(sample_count);
+  }
+}
 CompositionOffsetIterator::~CompositionOffsetIterator() {}
 
 bool CompositionOffsetIterator::AdvanceSample() {
@@ -30,32 +41,40 @@ bool CompositionOffsetIterator::AdvanceSample() {
   return true;
 }
 
+bool CompositionOffsetIterator::SeekToSample(uint32_t sample) {
+  DCHECK_GT(sample, 0u);
+  std::vector<uint32_t>::const_iterator entry =
+      std::lower_bound(cumulative_sample_counts_.begin(),
+                       cumulative_sample_counts_.end(), sample);
+  if (entry == cumulative_sample_counts_.end())
+    return false;
+  const size_t index = entry - cumulative_sample_counts_.begin();
+  iterator_ = composition_offset_table_.begin() + index;
+  sample_index_ =
+      sample - 1 - (index == 0 ? 0 : cumulative_sample_counts_[index - 1]);
+  return true;
+}
+
 bool CompositionOffsetIterator::IsValid() const {
   return iterator_ != composition_offset_table_.end() &&
          sample_index_ < iterator_->sample_count;
 }
 
 int64_t CompositionOffsetIterator::SampleOffset(uint32_t sample) const {
-  uint32_t current_sample = 0;
-  std::vector<CompositionOffset>::const_iterator it =
-      composition_offset_table_.begin();
-  for (; it != composition_offset_table_.end(); ++it) {
-    current_sample += it->sample_count;
-    if (current_sample >= sample)
-      return it->sample_offset;
+  std::vector<uint32_t>::const_iterator entry =
+      std::lower_bound(cumulative_sample_counts_.begin(),
+                       cumulative_sample_counts_.end(), sample);
+  if (entry != cumulative_sample_counts_.end()) {
+    return composition_offset_table_[entry - cumulative_sample_counts_.begin()]
+        .sample_offset;
   }
-  DCHECK_LE(sample, current_sample) << " Sample is invalid";
+  DCHECK_LE(sample, NumSamples()) << " Sample is invalid";
   return 0;
 }
 
 uint32_t CompositionOffsetIterator::NumSamples() const {
-  uint32_t num_samples = 0;
-  std::vector<CompositionOffset>::const_iterator it =
-      composition_offset_table_.begin();
-  for (; it != composition_offset_table_.end(); ++it) {
-    num_samples += it->sample_count;
-  }
-  return num_samples;
+  return cumulative_sample_counts_.empty() ? 0
+                                           : cumulative_sample_counts_.back();
 }
 
 }  // namespace mp4
@@ -32,6 +32,11 @@ class CompositionOffsetIterator {
   /// @return true if not past the last sample, false otherwise.
   bool AdvanceSample();
 
+  /// Seek to the given sample. O(log n) in the number of table entries.
+  /// @param sample is 1-based.
+  /// @return true on success, false if @a sample is past the last sample.
+  bool SeekToSample(uint32_t sample);
+
   /// @return true if the iterator is still valid, false if past the last
   ///         sample.
   bool IsValid() const;
@@ -49,6 +54,10 @@ class CompositionOffsetIterator {
   uint32_t sample_index_;
   const std::vector<CompositionOffset>& composition_offset_table_;
   std::vector<CompositionOffset>::const_iterator iterator_;
+  // Prefix sums of sample counts through each table entry, built once at
+  // construction; backs the binary searches in SeekToSample and
+  // SampleOffset.
+  std::vector<uint32_t> cumulative_sample_counts_;
 
   DISALLOW_COPY_AND_ASSIGN(CompositionOffsetIterator);
 };
@@ -77,6 +77,20 @@ TEST_F(CompositionOffsetIteratorTest, SampleOffset) {
   }
 }
 
+TEST_F(CompositionOffsetIteratorTest, SeekToSample) {
+  // Seek backwards, to exercise seeks that cross entry boundaries in both
+  // directions.
+  for (uint32_t sample = composition_offset_table_.size(); sample > 0;
+       --sample) {
+    ASSERT_TRUE(composition_offset_iterator_->SeekToSample(sample));
+    ASSERT_TRUE(composition_offset_iterator_->IsValid());
+    ASSERT_EQ(composition_offset_table_[sample - 1],
+              composition_offset_iterator_->sample_offset());
+  }
+  ASSERT_FALSE(composition_offset_iterator_->SeekToSample(
+      static_cast<uint32_t>(composition_offset_table_.size()) + 1));
+}
+
 }  // namespace mp4
 }  // namespace media
 }  // namespace shaka
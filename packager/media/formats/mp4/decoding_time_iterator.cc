@@ -18,7 +18,20 @@ DecodingTimeIterator::DecodingTimeIterator(
     const DecodingTimeToSample& decoding_time_to_sample)
     : sample_index_(0),
       decoding_time_table_(decoding_time_to_sample.decoding_time),
-      iterator_(decoding_time_table_.begin()) {}
+      iterator_(decoding_time_table_.begin()) {
+  cumulative_sample_counts_.reserve(decoding_time_table_.size());
+  cumulative_durations_.reserve(decoding_time_table_.size());
+  uint32_t sample_count = 0;
+  uint64_t duration = 0;
+  for (std::vector<DecodingTime>::const_iterator it =
+           decoding_time_table_.begin();
+       it != decoding_time_table_.end(); ++it) {
+    sample_count += it->sample_count;
+    duration += static_cast<uint64_t>(it->sample_count) * it->sample_delta;
+    cumulative_sample_counts_.push_back(sample_count);
+    cumulative_durations_.push_back(duration);
+  }
+}
 DecodingTimeIterator::~DecodingTimeIterator() {}
 
 bool DecodingTimeIterator::AdvanceSample() {
@@ -32,6 +45,36 @@ bool DecodingTimeIterator::AdvanceSample() {
   return true;
 }
 
+bool DecodingTimeIterator::SeekToSample(uint32_t sample) {
+  DCHECK_GT(sample, 0u);
+  std::vector<uint32_t>::const_iterator entry =
+      std::lower_bound(cumulative_sample_counts_.begin(),
+                       cumulative_sample_counts_.end(), sample);
+  if (entry == cumulative_sample_counts_.end())
+    return false;
+  const size_t index = entry - cumulative_sample_counts_.begin();
+  iterator_ = decoding_time_table_.begin() + index;
+  sample_index_ =
+      sample - 1 - (index == 0 ? 0 : cumulative_sample_counts_[index - 1]);
+  return true;
+}
+
+bool DecodingTimeIterator::SeekToTime(uint64_t time) {
+  std::vector<uint64_t>::const_iterator entry = std::upper_bound(
+      cumulative_durations_.begin(), cumulative_durations_.end(), time);
+  if (entry == cumulative_durations_.end())
+    return false;
+  const size_t index = entry - cumulative_durations_.begin();
+  const uint64_t duration_before =
+      index == 0 ? 0 : cumulative_durations_[index - 1];
+  // The matched entry has a nonzero delta: a zero delta entry has the same
+  // cumulative duration as its predecessor and cannot be the first entry
+  // with cumulative duration greater than |time|.
+  iterator_ = decoding_time_table_.begin() + index;
+  sample_index_ = (time - duration_before) / iterator_->sample_delta;
+  return true;
+}
+
 bool DecodingTimeIterator::IsValid() const {
   return iterator_ != decoding_time_table_.end() &&
          sample_index_ < iterator_->sample_count;
@@ -40,31 +83,53 @@ bool DecodingTimeIterator::IsValid() const {
 uint64_t DecodingTimeIterator::Duration(uint32_t start_sample,
                                         uint32_t end_sample) const {
   DCHECK_LE(start_sample, end_sample);
-  uint32_t current_sample = 0;
-  uint32_t prev_sample = 0;
-  uint64_t duration = 0;
-  std::vector<DecodingTime>::const_iterator it = decoding_time_table_.begin();
-  for (; it != decoding_time_table_.end(); ++it) {
-    current_sample += it->sample_count;
-    if (current_sample >= start_sample) {
-      duration += (std::min(end_sample, current_sample) -
-                   std::max(start_sample, prev_sample + 1) + 1) *
-                  it->sample_delta;
-      if (current_sample >= end_sample)
-        break;
-    }
-    prev_sample = current_sample;
-  }
-  return duration;
+  return DurationThroughSample(end_sample) -
+         DurationThroughSample(start_sample - 1);
+}
+
+uint64_t DecodingTimeIterator::DurationThroughSample(uint32_t sample) const {
+  if (sample == 0 || cumulative_sample_counts_.empty())
+    return 0;
+  sample = std::min(sample, cumulative_sample_counts_.back());
+  const size_t index =
+      std::lower_bound(cumulative_sample_counts_.begin(),
+                       cumulative_sample_counts_.end(), sample) -
+      cumulative_sample_counts_.begin();
+  const uint32_t samples_before =
+      index == 0 ? 0 : cumulative_sample_counts_[index - 1];
+  const uint64_t duration_before =
+      index == 0 ? 0 : cumulative_durations_[index - 1];
+  return duration_before + static_cast<uint64_t>(sample - samples_before) *
+                               decoding_time_table_[index].sample_delta;
 }
 
 uint32_t DecodingTimeIterator::NumSamples() const {
-  uint32_t num_samples = 0;
-  std::vector<DecodingTime>::const_iterator it = decoding_time_table_.begin();
-  for (; it != decoding_time_table_.end(); ++it) {
-    num_samples += it->sample_count;
-  }
-  return num_samples;
+  return cumulative_sample_counts_.empty() ? 0
+                                           : cumulative_sample_counts_.back();
+}
+
+uint64_t DecodingTimeIterator::TotalDuration() const {
+  return cumulative_durations_.empty() ? 0 : cumulative_durations_.back();
+}
+
+uint32_t DecodingTimeIterator::SampleCountThroughTime(uint64_t time) const {
+  // The inverse of DurationThroughSample(), computed from the run-length
+  // table directly.
+  std::vector<uint64_t>::const_iterator entry = std::upper_bound(
+      cumulative_durations_.begin(), cumulative_durations_.end(), time);
+  if (entry == cumulative_durations_.end())
+    return NumSamples();
+  const size_t index = entry - cumulative_durations_.begin();
+  const uint32_t samples_before =
+      index == 0 ? 0 : cumulative_sample_counts_[index - 1];
+  const uint64_t duration_before =
+      index == 0 ? 0 : cumulative_durations_[index - 1];
+  // The matched entry has a nonzero delta: a zero delta entry has the same
+  // cumulative duration as its predecessor and cannot be the first entry
+  // with cumulative duration greater than |time|.
+  return samples_before +
+         static_cast<uint32_t>((time - duration_before) /
+                               decoding_time_table_[index].sample_delta);
 }
 
 }  // namespace mp4
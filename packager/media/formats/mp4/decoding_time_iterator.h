@@ -32,6 +32,17 @@ class DecodingTimeIterator {
   /// @return true if not past the last sample, false otherwise.
   bool AdvanceSample();
 
+  /// Seek to the given sample. O(log n) in the number of table entries.
+  /// @param sample is 1-based.
+  /// @return true on success, false if @a sample is past the last sample.
+  bool SeekToSample(uint32_t sample);
+
+  /// Seek to the sample containing the given decoding time. O(log n) in the
+  /// number of table entries.
+  /// @param time is relative to the first sample's decoding time.
+  /// @return true on success, false if @a time is past the last sample.
+  bool SeekToTime(uint64_t time);
+
   /// @return true if the iterator is still valid, false if past the last
   ///         sample.
   bool IsValid() const;
@@ -45,10 +56,29 @@ class DecodingTimeIterator {
   /// @return Total number of samples in the table.
   uint32_t NumSamples() const;
 
+  /// @return Total duration of all samples in the table. O(1).
+  uint64_t TotalDuration() const;
+
+  /// @return Number of samples whose decoding interval ends at or before
+  ///         @a time, i.e. the largest sample (1-based) s such that
+  ///         Duration(1, s) <= @a time, or 0 if there is none. O(log n) in
+  ///         the number of table entries.
+  /// @param time is relative to the first sample's decoding time.
+  uint32_t SampleCountThroughTime(uint64_t time) const;
+
  private:
+  // Duration of samples 1 to |sample|, inclusive. |sample| is capped at the
+  // last sample in the table.
+  uint64_t DurationThroughSample(uint32_t sample) const;
+
   uint32_t sample_index_;
   const std::vector<DecodingTime>& decoding_time_table_;
   std::vector<DecodingTime>::const_iterator iterator_;
+  // Prefix sums over |decoding_time_table_|, built once at construction:
+  // total sample count and total duration through each table entry. They
+  // back the binary searches in the seek and range query functions.
+  std::vector<uint32_t> cumulative_sample_counts_;
+  std::vector<uint64_t> cumulative_durations_;
 
   DISALLOW_COPY_AND_ASSIGN(DecodingTimeIterator);
 };
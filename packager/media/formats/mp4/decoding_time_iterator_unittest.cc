@@ -49,6 +49,28 @@ TEST_F(DecodingTimeIteratorTest, EmptyDecodingTime) {
   DecodingTimeIterator iterator(decoding_time_to_sample);
   EXPECT_FALSE(iterator.IsValid());
   EXPECT_EQ(0u, iterator.NumSamples());
+  EXPECT_EQ(0u, iterator.TotalDuration());
+  EXPECT_EQ(0u, iterator.SampleCountThroughTime(0));
+}
+
+TEST_F(DecodingTimeIteratorTest, TotalDuration) {
+  ASSERT_EQ(decoding_time_table_.back(),
+            decoding_time_iterator_->TotalDuration());
+}
+
+TEST_F(DecodingTimeIteratorTest, SampleCountThroughTime) {
+  EXPECT_EQ(0u, decoding_time_iterator_->SampleCountThroughTime(0));
+  for (uint32_t sample = 1; sample <= decoding_time_table_.size(); ++sample) {
+    // Sample |sample| is fully decoded exactly at its cumulative decoding
+    // time, not one tick earlier.
+    EXPECT_EQ(sample - 1, decoding_time_iterator_->SampleCountThroughTime(
+                              decoding_time_table_[sample - 1] - 1));
+    EXPECT_EQ(sample, decoding_time_iterator_->SampleCountThroughTime(
+                          decoding_time_table_[sample - 1]));
+  }
+  EXPECT_EQ(decoding_time_table_.size(),
+            decoding_time_iterator_->SampleCountThroughTime(
+                decoding_time_table_.back() + 1));
 }
 
 TEST_F(DecodingTimeIteratorTest, NumSamples) {
@@ -77,6 +99,35 @@ TEST_F(DecodingTimeIteratorTest, Duration) {
   }
 }
 
+TEST_F(DecodingTimeIteratorTest, SeekToSample) {
+  // Seek backwards, to exercise seeks that cross entry boundaries in both
+  // directions.
+  for (uint32_t sample = decoding_time_table_.size(); sample > 0; --sample) {
+    ASSERT_TRUE(decoding_time_iterator_->SeekToSample(sample));
+    ASSERT_TRUE(decoding_time_iterator_->IsValid());
+    ASSERT_EQ(decoding_time_table_[sample - 1] -
+                  (sample == 1 ? 0 : decoding_time_table_[sample - 2]),
+              decoding_time_iterator_->sample_delta());
+  }
+  ASSERT_FALSE(decoding_time_iterator_->SeekToSample(
+      static_cast<uint32_t>(decoding_time_table_.size()) + 1));
+}
+
+TEST_F(DecodingTimeIteratorTest, SeekToTime) {
+  for (uint32_t sample = 1; sample <= decoding_time_table_.size(); ++sample) {
+    // Sample |sample| covers decoding times up to, but not including, its
+    // cumulative decoding time.
+    ASSERT_TRUE(decoding_time_iterator_->SeekToTime(
+        decoding_time_table_[sample - 1] - 1));
+    ASSERT_TRUE(decoding_time_iterator_->IsValid());
+    ASSERT_EQ(decoding_time_table_[sample - 1] -
+                  (sample == 1 ? 0 : decoding_time_table_[sample - 2]),
+              decoding_time_iterator_->sample_delta());
+  }
+  ASSERT_FALSE(
+      decoding_time_iterator_->SeekToTime(decoding_time_table_.back()));
+}
+
 }  // namespace mp4
 }  // namespace media
 }  // namespace shaka
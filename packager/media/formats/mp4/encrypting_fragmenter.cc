@@ -6,13 +6,18 @@
 
 #include "packager/media/formats/mp4/encrypting_fragmenter.h"
 
+#include <algorithm>
 #include <limits>
 
+#include "packager/base/bind.h"
 #include "packager/media/base/aes_encryptor.h"
 #include "packager/media/base/aes_pattern_cryptor.h"
 #include "packager/media/base/buffer_reader.h"
+#include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/media_sample.h"
+#include "packager/media/base/pipeline_stats.h"
+#include "packager/media/base/task_pool.h"
 #include "packager/media/codecs/nalu_reader.h"
 #include "packager/media/codecs/vp8_parser.h"
 #include "packager/media/codecs/vp9_parser.h"
@@ -77,7 +82,10 @@ EncryptingFragmenter::EncryptingFragmenter(
       protection_scheme_(protection_scheme),
       crypt_byte_block_(crypt_byte_block),
       skip_byte_block_(skip_byte_block),
-      listener_(listener) {
+      listener_(listener),
+      num_encryption_threads_(1),
+      sample_info_sizes_uniform_(true),
+      first_sample_info_size_(0) {
   DCHECK(encryption_key_);
   switch (video_codec_) {
     case kCodecVP8:
@@ -112,6 +120,9 @@ Status EncryptingFragmenter::AddSample(scoped_refptr<MediaSample> sample) {
       return status;
   }
   if (encryptor_) {
+    // With a worker pool, EncryptSample only collects the subsample layout;
+    // the sample's still-clear data is encrypted in place when the fragment
+    // is finalized.
     Status status = EncryptSample(sample);
     if (!status.ok())
       return status;
@@ -129,6 +140,8 @@ Status EncryptingFragmenter::InitializeFragment(int64_t first_sample_dts) {
 
   traf()->auxiliary_size.sample_info_sizes.clear();
   traf()->auxiliary_offset.offsets.clear();
+  sample_info_sizes_uniform_ = true;
+  first_sample_info_size_ = 0;
   if (IsSubsampleEncryptionRequired()) {
     traf()->sample_encryption.flags |=
         SampleEncryption::kUseSubsampleEncryption;
@@ -152,15 +165,20 @@ Status EncryptingFragmenter::InitializeFragment(int64_t first_sample_dts) {
   return PrepareFragmentForEncryption(enable_encryption);
 }
 
-void EncryptingFragmenter::FinalizeFragment() {
+Status EncryptingFragmenter::FinalizeFragment() {
   if (encryptor_) {
     DCHECK_LE(clear_time_, 0);
+    if (num_encryption_threads_ > 1 && !samples().empty()) {
+      Status status = EncryptPendingSamples();
+      if (!status.ok())
+        return status;
+    }
     FinalizeFragmentForEncryption();
   } else {
     DCHECK_GT(clear_time_, 0);
     clear_time_ -= fragment_duration();
   }
-  Fragmenter::FinalizeFragment();
+  return Fragmenter::FinalizeFragment();
 }
 
 Status EncryptingFragmenter::PrepareFragmentForEncryption(
@@ -177,12 +195,15 @@ void EncryptingFragmenter::FinalizeFragmentForEncryption() {
       (protection_scheme_ == FOURCC_cbcs) ? 0 : encryptor_->iv().size();
   traf()->sample_encryption.iv_size = per_sample_iv_size;
 
-  // Optimize saiz box.
+  // Optimize saiz box. Whether the sizes are uniform was tracked while they
+  // were accumulated, so no second pass over the table is needed.
   SampleAuxiliaryInformationSize& saiz = traf()->auxiliary_size;
-  saiz.sample_count = traf()->runs[0].sample_sizes.size();
+  saiz.sample_count = samples().size();
   if (!saiz.sample_info_sizes.empty()) {
-    if (!OptimizeSampleEntries(&saiz.sample_info_sizes,
-                               &saiz.default_sample_info_size)) {
+    if (sample_info_sizes_uniform_) {
+      saiz.default_sample_info_size = first_sample_info_size_;
+      saiz.sample_info_sizes.clear();
+    } else {
       saiz.default_sample_info_size = 0;
     }
   } else {
@@ -206,6 +227,10 @@ void EncryptingFragmenter::FinalizeFragmentForEncryption() {
 }
 
 Status EncryptingFragmenter::CreateEncryptor() {
+  return CreateCryptor(&encryptor_);
+}
+
+Status EncryptingFragmenter::CreateCryptor(scoped_ptr<AesCryptor>* cryptor) {
   DCHECK(encryption_key_);
   scoped_ptr<AesCryptor> encryptor;
   switch (protection_scheme_) {
@@ -238,7 +263,7 @@ Status EncryptingFragmenter::CreateEncryptor() {
       encryptor->InitializeWithIv(encryption_key_->key, encryption_key_->iv);
   if (!initialized)
     return Status(error::MUXER_FAILURE, "Failed to create the encryptor.");
-  encryptor_ = encryptor.Pass();
+  *cryptor = encryptor.Pass();
   return Status::OK;
 }
 
@@ -249,22 +274,32 @@ void EncryptingFragmenter::EncryptBytes(uint8_t* data, uint32_t size) {
 
 Status EncryptingFragmenter::EncryptSample(scoped_refptr<MediaSample> sample) {
   DCHECK(encryptor_);
+  pipeline_stats::ScopedStageTimer stage_timer(pipeline_stats::kStageEncrypt);
+  pipeline_stats::RecordBytes(pipeline_stats::kStageEncrypt,
+                              sample->data_size());
+
+  // With a worker pool, this function only parses the subsample layout; the
+  // actual encryption is deferred to EncryptPendingSamples().
+  const bool defer_encryption = num_encryption_threads_ > 1;
 
   SampleEncryptionEntry sample_encryption_entry;
   // For 'cbcs' scheme, Constant IVs SHALL be used.
   if (protection_scheme_ != FOURCC_cbcs)
     sample_encryption_entry.initialization_vector = encryptor_->iv();
+  // Total number of encrypted bytes in this sample, accumulated while the
+  // subsample layout is built so the iv can be advanced without walking the
+  // subsamples again.
+  uint64_t total_cipher_bytes = 0;
   uint8_t* data = sample->writable_data();
   if (IsSubsampleEncryptionRequired()) {
     if (vpx_parser_) {
-      std::vector<VPxFrameInfo> vpx_frames;
       if (!vpx_parser_->Parse(sample->data(), sample->data_size(),
-                              &vpx_frames)) {
+                              &vpx_frames_)) {
         return Status(error::MUXER_FAILURE, "Failed to parse vpx frame.");
       }
 
-      const bool is_superframe = vpx_frames.size() > 1;
-      for (const VPxFrameInfo& frame : vpx_frames) {
+      const bool is_superframe = vpx_frames_.size() > 1;
+      for (const VPxFrameInfo& frame : vpx_frames_) {
         SubsampleEntry subsample;
         subsample.clear_bytes = frame.uncompressed_header_size;
         subsample.cipher_bytes =
@@ -286,15 +321,16 @@ Status EncryptingFragmenter::EncryptSample(scoped_refptr<MediaSample> sample) {
         }
 
         sample_encryption_entry.subsamples.push_back(subsample);
-        if (subsample.cipher_bytes > 0)
+        total_cipher_bytes += subsample.cipher_bytes;
+        if (!defer_encryption && subsample.cipher_bytes > 0)
           EncryptBytes(data + subsample.clear_bytes, subsample.cipher_bytes);
         data += frame.frame_size;
       }
       // Add subsample for the superframe index if exists.
       if (is_superframe) {
         size_t index_size = sample->data() + sample->data_size() - data;
-        DCHECK_LE(index_size, 2 + vpx_frames.size() * 4);
-        DCHECK_GE(index_size, 2 + vpx_frames.size() * 1);
+        DCHECK_LE(index_size, 2 + vpx_frames_.size() * 4);
+        DCHECK_GE(index_size, 2 + vpx_frames_.size() * 1);
         SubsampleEntry subsample;
         subsample.clear_bytes = index_size;
         subsample.cipher_bytes = 0;
@@ -338,12 +374,15 @@ Status EncryptingFragmenter::EncryptSample(scoped_refptr<MediaSample> sample) {
             cipher_bytes -= misalign_bytes;
           }
 
-          const uint8_t* nalu_data = nalu.data() + current_clear_bytes;
-          EncryptBytes(const_cast<uint8_t*>(nalu_data), cipher_bytes);
+          if (!defer_encryption) {
+            const uint8_t* nalu_data = nalu.data() + current_clear_bytes;
+            EncryptBytes(const_cast<uint8_t*>(nalu_data), cipher_bytes);
+          }
 
           AddSubsamples(
               accumulated_clear_bytes + nalu_length_size_ + current_clear_bytes,
               cipher_bytes, &sample_encryption_entry.subsamples);
+          total_cipher_bytes += cipher_bytes;
           accumulated_clear_bytes = 0;
         } else {
           // For non-video-slice NAL units, don't encrypt.
@@ -360,20 +399,100 @@ Status EncryptingFragmenter::EncryptSample(scoped_refptr<MediaSample> sample) {
               sample->data_size());
 
     // The length of per-sample auxiliary datum, defined in CENC ch. 7.
-    traf()->auxiliary_size.sample_info_sizes.push_back(
-        sample_encryption_entry.ComputeSize());
+    const uint8_t sample_info_size =
+        static_cast<uint8_t>(sample_encryption_entry.ComputeSize());
+    SampleAuxiliaryInformationSize& saiz = traf()->auxiliary_size;
+    if (saiz.sample_info_sizes.empty())
+      first_sample_info_size_ = sample_info_size;
+    else if (sample_info_size != first_sample_info_size_)
+      sample_info_sizes_uniform_ = false;
+    saiz.sample_info_sizes.push_back(sample_info_size);
   } else {
     DCHECK_LE(crypt_byte_block(), 1u);
     DCHECK_EQ(skip_byte_block(), 0u);
-    EncryptBytes(data, sample->data_size());
+    total_cipher_bytes = sample->data_size();
+    if (!defer_encryption)
+      EncryptBytes(data, sample->data_size());
   }
 
   traf()->sample_encryption.sample_encryption_entries.push_back(
       sample_encryption_entry);
-  encryptor_->UpdateIv();
+  if (defer_encryption) {
+    // Advance the iv as if the sample was encrypted here, so every sample is
+    // assigned the same iv as with inline encryption.
+    encryptor_->AdvanceIv(total_cipher_bytes);
+  } else {
+    encryptor_->UpdateIv();
+  }
   return Status::OK;
 }
 
+Status EncryptingFragmenter::EncryptPendingSamples() {
+  DCHECK(encryptor_);
+  pipeline_stats::ScopedStageTimer stage_timer(pipeline_stats::kStageEncrypt);
+
+  const size_t num_workers =
+      std::min(static_cast<size_t>(num_encryption_threads_), samples().size());
+  std::vector<Status> worker_statuses(num_workers);
+  std::vector<base::Closure> tasks;
+  for (size_t i = 0; i < num_workers; ++i) {
+    tasks.push_back(
+        base::Bind(&EncryptingFragmenter::EncryptPendingSamplesTask,
+                   base::Unretained(this), i, num_workers,
+                   &worker_statuses[i]));
+  }
+  TaskPool::GetInstance()->RunTasksAndWait(TaskPool::kHighPriority, tasks);
+  Status status;
+  for (size_t i = 0; i < num_workers; ++i)
+    status.Update(worker_statuses[i]);
+  return status;
+}
+
+void EncryptingFragmenter::EncryptPendingSamplesTask(size_t worker_index,
+                                                     size_t num_workers,
+                                                     Status* status) {
+  // Each worker owns its own cryptor; cryptors are stateful within a sample
+  // (counter or cipher block chain), but samples are independent given their
+  // per-sample ivs.
+  scoped_ptr<AesCryptor> cryptor;
+  *status = CreateCryptor(&cryptor);
+  if (!status->ok())
+    return;
+
+  const std::vector<SampleEncryptionEntry>& sample_encryption_entries =
+      traf()->sample_encryption.sample_encryption_entries;
+  const std::vector<scoped_refptr<MediaSample> >& pending_samples = samples();
+  DCHECK_EQ(sample_encryption_entries.size(), pending_samples.size());
+  for (size_t i = worker_index; i < pending_samples.size(); i += num_workers) {
+    const SampleEncryptionEntry& entry = sample_encryption_entries[i];
+    // For 'cbcs' scheme, the constant iv is already set during cryptor
+    // initialization and |initialization_vector| is empty.
+    if (!entry.initialization_vector.empty() &&
+        !cryptor->SetIv(entry.initialization_vector)) {
+      *status = Status(error::MUXER_FAILURE, "Invalid per-sample iv.");
+      return;
+    }
+    // Safe across workers: each sample is touched by exactly one worker, and
+    // any copy-on-write detach already happened in EncryptSample() on the
+    // muxer thread.
+    uint8_t* sample_data = pending_samples[i]->writable_data();
+    if (entry.subsamples.empty()) {
+      CHECK(cryptor->Crypt(sample_data, pending_samples[i]->data_size(),
+                           sample_data));
+    } else {
+      uint8_t* current = sample_data;
+      for (const SubsampleEntry& subsample : entry.subsamples) {
+        current += subsample.clear_bytes;
+        if (subsample.cipher_bytes > 0)
+          CHECK(cryptor->Crypt(current, subsample.cipher_bytes, current));
+        current += subsample.cipher_bytes;
+      }
+      DCHECK_EQ(static_cast<size_t>(current - sample_data),
+                pending_samples[i]->data_size());
+    }
+  }
+}
+
 bool EncryptingFragmenter::IsSubsampleEncryptionRequired() {
   return vpx_parser_ || nalu_length_size_ != 0;
 }
@@ -53,9 +53,17 @@ class EncryptingFragmenter : public Fragmenter {
   /// @{
   Status AddSample(scoped_refptr<MediaSample> sample) override;
   Status InitializeFragment(int64_t first_sample_dts) override;
-  void FinalizeFragment() override;
+  Status FinalizeFragment() override;
   /// @}
 
+  /// Set the number of worker threads used to encrypt samples. Samples are
+  /// cryptographically independent (each sample gets its own iv), so with
+  /// more than one thread, sample encryption is deferred and a fragment's
+  /// samples are encrypted concurrently when the fragment is finalized.
+  void set_num_encryption_threads(uint32_t num_encryption_threads) {
+    num_encryption_threads_ = num_encryption_threads;
+  }
+
  protected:
   /// Prepare current fragment for encryption.
   /// @return OK on success, an error status otherwise.
@@ -79,9 +87,25 @@ class EncryptingFragmenter : public Fragmenter {
   }
 
  private:
+  // Create a cryptor for the internal encryption key, initialized with the
+  // key's initial iv.
+  Status CreateCryptor(scoped_ptr<AesCryptor>* cryptor);
+
   void EncryptBytes(uint8_t* data, uint32_t size);
   Status EncryptSample(scoped_refptr<MediaSample> sample);
 
+  // Encrypt the fragment's samples in place in their own buffers,
+  // distributing the samples across |num_encryption_threads_| worker
+  // threads. The subsample layout and per-sample iv of each sample are read
+  // from the corresponding SampleEncryptionEntry in the track fragment.
+  Status EncryptPendingSamples();
+  // Worker task: encrypt every |num_workers|th sample starting from
+  // |worker_index| using a dedicated cryptor. |status| receives the first
+  // error encountered, if any.
+  void EncryptPendingSamplesTask(size_t worker_index,
+                                 size_t num_workers,
+                                 Status* status);
+
   // Should we enable subsample encryption?
   bool IsSubsampleEncryptionRequired();
 
@@ -98,9 +122,23 @@ class EncryptingFragmenter : public Fragmenter {
   const uint8_t crypt_byte_block_;
   const uint8_t skip_byte_block_;
   MuxerListener* listener_;
+  // Number of worker threads used to encrypt samples. Values less than two
+  // keep sample encryption inline on the muxer thread.
+  uint32_t num_encryption_threads_;
+
+  // Running view of the sample auxiliary info sizes accumulated during
+  // encryption: |sample_info_sizes_uniform_| stays true while every size seen
+  // so far equals |first_sample_info_size_|. Lets
+  // FinalizeFragmentForEncryption() emit a defaulted saiz box without
+  // re-walking the size table.
+  bool sample_info_sizes_uniform_;
+  uint8_t first_sample_info_size_;
 
   scoped_ptr<VPxParser> vpx_parser_;
   scoped_ptr<VideoSliceHeaderParser> header_parser_;
+  // Frame layout of the sample currently being encrypted. A member so its
+  // storage is reused across samples instead of reallocated per sample.
+  std::vector<VPxFrameInfo> vpx_frames_;
 
   DISALLOW_COPY_AND_ASSIGN(EncryptingFragmenter);
 };
@@ -0,0 +1,853 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp4/fragment_passthrough.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "packager/base/logging.h"
+#include "packager/base/memory/scoped_ptr.h"
+#include "packager/base/stl_util.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/media/base/aes_encryptor.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/key_source.h"
+#include "packager/media/base/muxer_util.h"
+#include "packager/media/codecs/avc_decoder_configuration_record.h"
+#include "packager/media/codecs/hevc_decoder_configuration_record.h"
+#include "packager/media/codecs/nalu_reader.h"
+#include "packager/media/codecs/video_slice_header_parser.h"
+#include "packager/media/file/file.h"
+#include "packager/media/file/file_closer.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/media/formats/mp4/box_reader.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+namespace {
+
+const uint32_t kBoxHeaderReadSize = 16;
+const uint64_t kCopyBufferSize = 0x100000;  // 1MB
+
+// The version of cenc implemented here. CENC 4.
+const int kCencSchemeVersion = 0x00010000;
+
+// Adds one or more subsamples to |*subsamples|.  This may add more than one
+// if one of the values overflows the integer in the subsample.
+void AddSubsamples(uint64_t clear_bytes,
+                   uint64_t cipher_bytes,
+                   std::vector<SubsampleEntry>* subsamples) {
+  CHECK_LT(cipher_bytes, std::numeric_limits<uint32_t>::max());
+  const uint64_t kUInt16Max = std::numeric_limits<uint16_t>::max();
+  while (clear_bytes > kUInt16Max) {
+    subsamples->push_back(SubsampleEntry(kUInt16Max, 0));
+    clear_bytes -= kUInt16Max;
+  }
+
+  if (clear_bytes > 0 || cipher_bytes > 0)
+    subsamples->push_back(SubsampleEntry(clear_bytes, cipher_bytes));
+}
+
+uint32_t ReadUInt32(const uint8_t* data) {
+  return (static_cast<uint32_t>(data[0]) << 24) |
+         (static_cast<uint32_t>(data[1]) << 16) |
+         (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+void WriteUInt32(uint32_t value, uint8_t* data) {
+  data[0] = (value >> 24) & 0xff;
+  data[1] = (value >> 16) & 0xff;
+  data[2] = (value >> 8) & 0xff;
+  data[3] = value & 0xff;
+}
+
+// Overwrites the sequence number of the 'mfhd' child in the full 'moof' box
+// held in |moof_buffer|. The 'mfhd' layout is fixed: box header, FullBox
+// version and flags, then the 32 bit sequence number.
+bool PatchSequenceNumber(uint32_t sequence_number,
+                         std::vector<uint8_t>* moof_buffer) {
+  // The 'moof' box uses the compact header unless its 32 bit size field is 1.
+  size_t offset = ReadUInt32(&(*moof_buffer)[0]) == 1 ? 16 : 8;
+  while (offset + 8 <= moof_buffer->size()) {
+    const uint32_t child_size = ReadUInt32(&(*moof_buffer)[offset]);
+    const FourCC child_type =
+        static_cast<FourCC>(ReadUInt32(&(*moof_buffer)[offset + 4]));
+    if (child_type == FOURCC_mfhd) {
+      if (offset + 16 > moof_buffer->size())
+        return false;
+      WriteUInt32(sequence_number, &(*moof_buffer)[offset + 12]);
+      return true;
+    }
+    if (child_size < 8)
+      return false;
+    offset += child_size;
+  }
+  return false;
+}
+
+// Reads exactly |size| bytes starting at |position| in |file|.
+Status ReadAt(File* file, uint64_t position, uint8_t* buffer, uint64_t size) {
+  if (!file->Seek(position)) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot seek in file " + file->file_name());
+  }
+  uint64_t total_bytes_read = 0;
+  while (total_bytes_read < size) {
+    const int64_t bytes_read =
+        file->Read(buffer + total_bytes_read, size - total_bytes_read);
+    if (bytes_read <= 0) {
+      return Status(error::FILE_FAILURE,
+                    "Cannot read file " + file->file_name());
+    }
+    total_bytes_read += bytes_read;
+  }
+  return Status::OK;
+}
+
+}  // namespace
+
+struct FragmentPassthrough::TrackCryptor {
+  TrackCryptor()
+      : is_video(false),
+        nalu_codec(Nalu::kH264),
+        nalu_length_size(0),
+        default_sample_size(0) {}
+
+  bool is_video;
+  Nalu::CodecType nalu_codec;
+  uint8_t nalu_length_size;
+  // The 'trex' default, used when neither 'trun' nor 'tfhd' carries sample
+  // sizes.
+  uint32_t default_sample_size;
+  scoped_ptr<VideoSliceHeaderParser> header_parser;
+  scoped_ptr<AesCtrEncryptor> encryptor;
+};
+
+FragmentPassthrough::FragmentPassthrough(const MuxerOptions& options)
+    : options_(options),
+      output_(NULL),
+      num_segments_(0),
+      sequence_number_(0),
+      encryption_key_source_(NULL),
+      protection_scheme_(FOURCC_NULL),
+      max_sd_pixels_(0),
+      moof_position_(0),
+      moof_size_(0),
+      has_pending_moof_(false),
+      moof_start_time_(0) {}
+
+FragmentPassthrough::~FragmentPassthrough() {
+  STLDeleteValues(&track_cryptors_);
+}
+
+Status FragmentPassthrough::Run(const std::string& input) {
+  const bool use_template = !options_.segment_template.empty();
+  if (!use_template && options_.output_file_name.empty()) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Fragment passthrough requires an output file or a segment "
+                  "template.");
+  }
+  if (encryption_key_source_ && protection_scheme_ != FOURCC_cenc) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Fragment passthrough only supports the 'cenc' protection "
+                  "scheme; remux without fragment passthrough for '" +
+                      FourCCToString(protection_scheme_) + "'.");
+  }
+
+  scoped_ptr<File, FileCloser> file(File::Open(input.c_str(), "r"));
+  if (!file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file for reading " + input);
+  }
+
+  scoped_ptr<File, FileCloser> output;
+  if (!use_template) {
+    output.reset(File::Open(options_.output_file_name.c_str(), "w"));
+    if (!output) {
+      return Status(error::FILE_FAILURE, "Cannot open file for write " +
+                                             options_.output_file_name);
+    }
+    output_ = output.get();
+  }
+
+  scoped_ptr<Movie> moov;
+  std::vector<uint8_t> init_buffer;
+  uint64_t position = 0;
+  while (true) {
+    uint8_t header[kBoxHeaderReadSize];
+    if (!file->Seek(position)) {
+      return Status(error::FILE_FAILURE, "Cannot seek in file " + input);
+    }
+    const int64_t header_bytes = file->Read(header, kBoxHeaderReadSize);
+    if (header_bytes == 0)
+      break;  // Clean end of file.
+    if (header_bytes < 0)
+      return Status(error::FILE_FAILURE, "Cannot read file " + input);
+
+    FourCC type;
+    uint64_t box_size;
+    bool err = false;
+    if (!BoxReader::StartBox(header, header_bytes, &type, &box_size, &err) ||
+        err || box_size == 0) {
+      return Status(error::PARSER_FAILURE,
+                    "Cannot read box header at position " +
+                        base::Uint64ToString(position) + " in " + input);
+    }
+
+    Status status;
+    if (type == FOURCC_mdat) {
+      if (!has_pending_moof_) {
+        return Status(error::PARSER_FAILURE,
+                      "'mdat' box at position " +
+                          base::Uint64ToString(position) +
+                          " without a preceding 'moof'.");
+      }
+      status = WriteFragment(file.get(), position, box_size);
+    } else {
+      // Everything but 'mdat' is small enough to buffer whole.
+      std::vector<uint8_t> buffer(box_size);
+      status = ReadAt(file.get(), position, &buffer[0], box_size);
+      if (!status.ok())
+        return status;
+
+      switch (type) {
+        case FOURCC_ftyp:
+          if (use_template) {
+            init_buffer.insert(init_buffer.end(), buffer.begin(),
+                               buffer.end());
+          } else {
+            status = WriteBuffer(output_, &buffer[0], buffer.size());
+          }
+          break;
+        case FOURCC_moov: {
+          if (moov) {
+            return Status(error::PARSER_FAILURE,
+                          "More than one 'moov' box in " + input);
+          }
+          bool parse_err = false;
+          scoped_ptr<BoxReader> reader(
+              BoxReader::ReadBox(&buffer[0], buffer.size(), &parse_err));
+          moov.reset(new Movie);
+          if (parse_err || !reader || !moov->Parse(reader.get())) {
+            return Status(error::PARSER_FAILURE,
+                          "Cannot parse 'moov' box in " + input);
+          }
+          if (moov->extends.tracks.empty()) {
+            return Status(error::INVALID_ARGUMENT,
+                          "Cannot pass through " + input +
+                              ": no 'mvex' box, the input is not a "
+                              "fragmented mp4.");
+          }
+          if (encryption_key_source_) {
+            status = PrepareMoovForEncryption(moov.get());
+            if (!status.ok())
+              return status;
+            // Re-serialize the 'moov' with the protection boxes added. Boxes
+            // the parser does not model are dropped, same as a full remux.
+            BufferWriter writer;
+            moov->Write(&writer);
+            buffer.clear();
+            writer.SwapBuffer(&buffer);
+          }
+          if (use_template) {
+            init_buffer.insert(init_buffer.end(), buffer.begin(),
+                               buffer.end());
+            if (!options_.output_file_name.empty()) {
+              scoped_ptr<File, FileCloser> init_file(
+                  File::Open(options_.output_file_name.c_str(), "w"));
+              if (!init_file) {
+                return Status(error::FILE_FAILURE,
+                              "Cannot open file for write " +
+                                  options_.output_file_name);
+              }
+              status = WriteBuffer(init_file.get(), &init_buffer[0],
+                                   init_buffer.size());
+            }
+          } else {
+            status = WriteBuffer(output_, &buffer[0], buffer.size());
+          }
+          break;
+        }
+        case FOURCC_moof: {
+          if (!moov) {
+            return Status(error::PARSER_FAILURE,
+                          "'moof' before 'moov' in " + input);
+          }
+          if (has_pending_moof_) {
+            return Status(error::PARSER_FAILURE,
+                          "'moof' box at position " +
+                              base::Uint64ToString(position) +
+                              " while the previous 'moof' still awaits its "
+                              "'mdat'.");
+          }
+          bool parse_err = false;
+          scoped_ptr<BoxReader> reader(
+              BoxReader::ReadBox(&buffer[0], buffer.size(), &parse_err));
+          MovieFragment moof;
+          if (parse_err || !reader || !moof.Parse(reader.get())) {
+            return Status(error::PARSER_FAILURE,
+                          "Cannot parse 'moof' box at position " +
+                              base::Uint64ToString(position) + " in " +
+                              input);
+          }
+          status = ValidateFragment(*moov, moof);
+          if (!status.ok())
+            return status;
+          if (encryption_key_source_) {
+            // The 'moof' is rewritten from the parsed form once its 'mdat'
+            // arrives and the sample ranges have been encrypted; see
+            // EncryptFragment().
+            pending_moof_.reset(new MovieFragment(moof));
+            pending_moof_->header.sequence_number = ++sequence_number_;
+            moof_position_ = position;
+            moof_size_ = box_size;
+          } else if (!PatchSequenceNumber(++sequence_number_, &buffer)) {
+            return Status(error::PARSER_FAILURE,
+                          "Cannot locate 'mfhd' in the 'moof' box at "
+                          "position " +
+                              base::Uint64ToString(position) + " in " +
+                              input);
+          } else {
+            moof_buffer_.swap(buffer);
+          }
+          has_pending_moof_ = true;
+          moof_start_time_ = moof.tracks[0].decode_time_absent
+                                 ? 0
+                                 : moof.tracks[0].decode_time.decode_time;
+          break;
+        }
+        case FOURCC_styp:
+          if (use_template) {
+            pending_styp_.swap(buffer);
+          } else {
+            status = WriteBuffer(output_, &buffer[0], buffer.size());
+          }
+          break;
+        default:
+          // 'sidx', 'free' and friends: no box sizes change, so they stay
+          // valid and are copied through in single file mode. Per segment
+          // placement is ambiguous in template mode, and encryption grows
+          // the 'moov' and 'moof' boxes which invalidates any file offsets
+          // they carry, so drop them in those modes.
+          if (use_template || encryption_key_source_) {
+            VLOG(1) << "Dropping top-level box '" << FourCCToString(type)
+                    << "'.";
+          } else {
+            status = WriteBuffer(output_, &buffer[0], buffer.size());
+          }
+          break;
+      }
+    }
+    if (!status.ok())
+      return status;
+    position += box_size;
+  }
+
+  if (has_pending_moof_) {
+    return Status(error::PARSER_FAILURE,
+                  "The last 'moof' in " + input + " has no 'mdat'.");
+  }
+  if (!moov) {
+    return Status(error::PARSER_FAILURE, "No 'moov' box in " + input);
+  }
+  if (sequence_number_ == 0)
+    LOG(WARNING) << "No fragments found in " << input << ".";
+  return Status::OK;
+}
+
+Status FragmentPassthrough::ValidateFragment(const Movie& moov,
+                                             const MovieFragment& moof) {
+  if (moof.tracks.empty()) {
+    return Status(error::PARSER_FAILURE,
+                  "'moof' box with no track fragments.");
+  }
+  for (const TrackFragment& traf : moof.tracks) {
+    const uint32_t track_id = traf.header.track_id;
+    const Track* trak = NULL;
+    const TrackExtends* trex = NULL;
+    for (const Track& track : moov.tracks) {
+      if (track.header.track_id == track_id)
+        trak = &track;
+    }
+    for (const TrackExtends& extends : moov.extends.tracks) {
+      if (extends.track_id == track_id)
+        trex = &extends;
+    }
+    if (!trak || !trex) {
+      return Status(error::PARSER_FAILURE,
+                    "Unknown track " + base::UintToString(track_id) +
+                        " in 'moof' box.");
+    }
+
+    // Decode times must not go backwards, or the copied fragments would
+    // overlap in the output timeline.
+    if (!traf.decode_time_absent) {
+      const uint64_t decode_time = traf.decode_time.decode_time;
+      std::map<uint32_t, uint64_t>::const_iterator it =
+          last_decode_time_.find(track_id);
+      if (it != last_decode_time_.end() && decode_time < it->second) {
+        return Status(error::PARSER_FAILURE,
+                      "Decode time goes backwards for track " +
+                          base::UintToString(track_id) + ".");
+      }
+      last_decode_time_[track_id] = decode_time;
+    }
+
+    // Warn if a video fragment does not start with a key frame. Such
+    // fragments pass through unchanged but are not independently decodable,
+    // which usually indicates misaligned input.
+    if (trak->media.information.sample_table.description.type != kVideo ||
+        traf.runs.empty()) {
+      continue;
+    }
+    const TrackFragmentRun& trun = traf.runs[0];
+    uint32_t flags;
+    if (!trun.sample_flags.empty()) {
+      flags = trun.sample_flags[0];
+    } else if (traf.header.flags &
+               TrackFragmentHeader::kDefaultSampleFlagsPresentMask) {
+      flags = traf.header.default_sample_flags;
+    } else {
+      flags = trex->default_sample_flags;
+    }
+    if (flags & TrackFragmentHeader::kNonKeySampleMask) {
+      LOG(WARNING) << "Video fragment " << sequence_number_ + 1
+                   << " does not start with a key frame.";
+    }
+  }
+  return Status::OK;
+}
+
+Status FragmentPassthrough::WriteFragment(File* input,
+                                          uint64_t mdat_position,
+                                          uint64_t mdat_size) {
+  DCHECK(has_pending_moof_);
+  has_pending_moof_ = false;
+
+  // In encryption mode the 'mdat' is buffered and encrypted in place, and
+  // |moof_buffer_| is rebuilt with the protection boxes; otherwise the
+  // 'mdat' payload is block-copied from the input untouched.
+  std::vector<uint8_t> mdat_buffer;
+  if (encryption_key_source_) {
+    Status status =
+        EncryptFragment(input, mdat_position, mdat_size, &mdat_buffer);
+    if (!status.ok())
+      return status;
+  }
+
+  if (options_.segment_template.empty()) {
+    Status status = WriteBuffer(output_, &moof_buffer_[0],
+                                moof_buffer_.size());
+    if (!status.ok())
+      return status;
+    if (!mdat_buffer.empty())
+      return WriteBuffer(output_, &mdat_buffer[0], mdat_buffer.size());
+    return CopyRange(input, mdat_position, mdat_size, output_);
+  }
+
+  const std::string segment_name =
+      GetSegmentName(options_.segment_template, moof_start_time_,
+                     num_segments_++, options_.bandwidth);
+  File* segment_file = File::Open(segment_name.c_str(), "w");
+  if (!segment_file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file for write " + segment_name);
+  }
+  Status status;
+  if (!pending_styp_.empty()) {
+    status.Update(WriteBuffer(segment_file, &pending_styp_[0],
+                              pending_styp_.size()));
+    pending_styp_.clear();
+  }
+  if (status.ok()) {
+    status.Update(
+        WriteBuffer(segment_file, &moof_buffer_[0], moof_buffer_.size()));
+  }
+  if (status.ok()) {
+    status.Update(
+        mdat_buffer.empty()
+            ? CopyRange(input, mdat_position, mdat_size, segment_file)
+            : WriteBuffer(segment_file, &mdat_buffer[0], mdat_buffer.size()));
+  }
+  if (!segment_file->Close()) {
+    status.Update(
+        Status(error::FILE_FAILURE, "Cannot close file " + segment_name));
+  }
+  return status;
+}
+
+Status FragmentPassthrough::PrepareMoovForEncryption(Movie* moov) {
+  DCHECK(encryption_key_source_);
+  for (Track& track : moov->tracks) {
+    const uint32_t track_id = track.header.track_id;
+    SampleDescription& description =
+        track.media.information.sample_table.description;
+    if (description.type != kVideo && description.type != kAudio) {
+      LOG(WARNING) << "Track " << track_id
+                   << " is neither audio nor video and is left in the clear.";
+      continue;
+    }
+
+    scoped_ptr<TrackCryptor> cryptor(new TrackCryptor);
+    KeySource::TrackType track_type = KeySource::TRACK_TYPE_AUDIO;
+    FourCC* format = NULL;
+    ProtectionSchemeInfo* sinf = NULL;
+    if (description.type == kVideo) {
+      if (description.video_entries.size() != 1) {
+        return Status(error::INVALID_ARGUMENT,
+                      "Encryption requires a single sample description entry "
+                      "per track.");
+      }
+      VideoSampleEntry& entry = description.video_entries[0];
+      cryptor->is_video = true;
+      switch (entry.format) {
+        case FOURCC_avc1: {
+          AVCDecoderConfigurationRecord avc_config;
+          if (!avc_config.Parse(entry.codec_configuration.data))
+            return Status(error::PARSER_FAILURE, "Failed to parse avcc.");
+          cryptor->nalu_codec = Nalu::kH264;
+          cryptor->nalu_length_size = avc_config.nalu_length_size();
+          cryptor->header_parser.reset(new H264VideoSliceHeaderParser);
+          break;
+        }
+        case FOURCC_hev1:
+        case FOURCC_hvc1: {
+          HEVCDecoderConfigurationRecord hevc_config;
+          if (!hevc_config.Parse(entry.codec_configuration.data))
+            return Status(error::PARSER_FAILURE, "Failed to parse hvcc.");
+          cryptor->nalu_codec = Nalu::kH265;
+          cryptor->nalu_length_size = hevc_config.nalu_length_size();
+          cryptor->header_parser.reset(new H265VideoSliceHeaderParser);
+          break;
+        }
+        default:
+          return Status(error::INVALID_ARGUMENT,
+                        "Fragment passthrough can only encrypt AVC and HEVC "
+                        "video; cannot encrypt '" +
+                            FourCCToString(entry.format) + "'.");
+      }
+      if (!cryptor->header_parser->Initialize(entry.codec_configuration.data))
+        return Status(error::PARSER_FAILURE, "Fail to read SPS and PPS data.");
+      const uint32_t pixels = entry.width * entry.height;
+      track_type = pixels > max_sd_pixels_ ? KeySource::TRACK_TYPE_HD
+                                           : KeySource::TRACK_TYPE_SD;
+      format = &entry.format;
+      sinf = &entry.sinf;
+    } else {
+      if (description.audio_entries.size() != 1) {
+        return Status(error::INVALID_ARGUMENT,
+                      "Encryption requires a single sample description entry "
+                      "per track.");
+      }
+      AudioSampleEntry& entry = description.audio_entries[0];
+      if (entry.format == FOURCC_enca) {
+        return Status(error::INVALID_ARGUMENT,
+                      "Track " + base::UintToString(track_id) +
+                          " is already encrypted.");
+      }
+      format = &entry.format;
+      sinf = &entry.sinf;
+    }
+
+    scoped_ptr<EncryptionKey> encryption_key(new EncryptionKey());
+    Status status =
+        encryption_key_source_->GetKey(track_type, encryption_key.get());
+    if (!status.ok())
+      return status;
+    if (encryption_key->iv.empty()) {
+      if (!AesCryptor::GenerateRandomIv(protection_scheme_,
+                                        &encryption_key->iv)) {
+        return Status(error::INTERNAL_ERROR, "Failed to generate random iv.");
+      }
+    }
+    cryptor->encryptor.reset(new AesCtrEncryptor);
+    if (!cryptor->encryptor->InitializeWithIv(encryption_key->key,
+                                              encryption_key->iv)) {
+      return Status(error::INTERNAL_ERROR, "Failed to create the encryptor.");
+    }
+
+    // Convert the sample entry to an encrypted entry. No clear lead: the
+    // input fragmentation is kept as is and every fragment is encrypted.
+    sinf->format.format = *format;
+    sinf->type.type = protection_scheme_;
+    sinf->type.version = kCencSchemeVersion;
+    TrackEncryption& track_encryption = sinf->info.track_encryption;
+    track_encryption.default_is_protected = 1;
+    track_encryption.default_per_sample_iv_size = encryption_key->iv.size();
+    track_encryption.default_kid = encryption_key->key_id;
+    *format = cryptor->is_video ? FOURCC_encv : FOURCC_enca;
+
+    if (moov->pssh.empty()) {
+      moov->pssh.resize(encryption_key->key_system_info.size());
+      for (size_t i = 0; i < encryption_key->key_system_info.size(); i++) {
+        moov->pssh[i].raw_box =
+            encryption_key->key_system_info[i].CreateBoxShared()->bytes();
+      }
+    }
+
+    for (const TrackExtends& trex : moov->extends.tracks) {
+      if (trex.track_id == track_id)
+        cryptor->default_sample_size = trex.default_sample_size;
+    }
+    track_cryptors_[track_id] = cryptor.release();
+  }
+
+  if (track_cryptors_.empty()) {
+    return Status(error::INVALID_ARGUMENT,
+                  "No audio or video track to encrypt.");
+  }
+  return Status::OK;
+}
+
+Status FragmentPassthrough::EncryptFragment(File* input,
+                                            uint64_t mdat_position,
+                                            uint64_t mdat_size,
+                                            std::vector<uint8_t>* mdat_buffer) {
+  DCHECK(pending_moof_);
+  scoped_ptr<MovieFragment> moof(pending_moof_.Pass());
+
+  if (mdat_position != moof_position_ + moof_size_) {
+    return Status(error::PARSER_FAILURE,
+                  "Cannot encrypt a fragment whose 'mdat' does not "
+                  "immediately follow its 'moof'.");
+  }
+
+  mdat_buffer->resize(mdat_size);
+  Status status = ReadAt(input, mdat_position, &(*mdat_buffer)[0], mdat_size);
+  if (!status.ok())
+    return status;
+  // The 'mdat' box uses the compact header unless its 32 bit size field is 1.
+  const uint64_t mdat_header_size =
+      ReadUInt32(&(*mdat_buffer)[0]) == 1 ? 16 : 8;
+
+  for (TrackFragment& traf : moof->tracks) {
+    std::map<uint32_t, TrackCryptor*>::iterator it =
+        track_cryptors_.find(traf.header.track_id);
+    if (it == track_cryptors_.end())
+      continue;  // The track is left in the clear.
+    if ((traf.header.flags & TrackFragmentHeader::kBaseDataOffsetPresentMask) ||
+        !(traf.header.flags & TrackFragmentHeader::kDefaultBaseIsMoofMask)) {
+      return Status(error::PARSER_FAILURE,
+                    "Encryption requires 'default-base-is-moof' track "
+                    "fragments.");
+    }
+    status = EncryptTrackFragment(it->second, &traf, &(*mdat_buffer)[0],
+                                  mdat_size, mdat_header_size);
+    if (!status.ok())
+      return status;
+  }
+
+  // Compute the new box sizes, then point 'saio' at the 'senc' data and shift
+  // the data offsets by the 'moof' growth. The fixups are size neutral, so
+  // the computed sizes stay valid.
+  const uint64_t new_moof_size = moof->ComputeSize();
+  // 'traf' should follow 'mfhd' moof header box.
+  uint64_t next_traf_position = moof->HeaderSize() + moof->header.box_size();
+  for (TrackFragment& traf : moof->tracks) {
+    next_traf_position += traf.box_size();
+    if (!traf.auxiliary_offset.offsets.empty()) {
+      DCHECK_EQ(traf.auxiliary_offset.offsets.size(), 1u);
+      // SampleEncryption 'senc' box should be the last box in 'traf'.
+      // |auxiliary_offset| should point to the data of SampleEncryption.
+      traf.auxiliary_offset.offsets[0] =
+          next_traf_position - traf.sample_encryption.box_size() +
+          traf.sample_encryption.HeaderSize() +
+          sizeof(uint32_t);  // for sample count field in 'senc'
+    }
+    for (TrackFragmentRun& run : traf.runs) {
+      if (run.flags & TrackFragmentRun::kDataOffsetPresentMask)
+        run.data_offset += new_moof_size - moof_size_;
+    }
+  }
+
+  BufferWriter writer;
+  moof->WriteUsingComputedSize(&writer);
+  moof_buffer_.clear();
+  writer.SwapBuffer(&moof_buffer_);
+  return Status::OK;
+}
+
+Status FragmentPassthrough::EncryptTrackFragment(TrackCryptor* cryptor,
+                                                 TrackFragment* traf,
+                                                 uint8_t* mdat_buffer,
+                                                 uint64_t mdat_buffer_size,
+                                                 uint64_t mdat_header_size) {
+  AesCtrEncryptor* encryptor = cryptor->encryptor.get();
+  SampleEncryption& senc = traf->sample_encryption;
+  traf->auxiliary_size.sample_info_sizes.clear();
+  traf->auxiliary_offset.offsets.clear();
+  senc.sample_encryption_entries.clear();
+  senc.iv_size = encryptor->iv().size();
+  if (cryptor->is_video)
+    senc.flags |= SampleEncryption::kUseSubsampleEncryption;
+
+  uint32_t sample_count = 0;
+  // Sample position relative to the 'moof' start; see
+  // 'default-base-is-moof'. Runs without an explicit data offset continue
+  // where the previous run ended.
+  uint64_t current_offset = 0;
+  bool has_offset = false;
+  for (const TrackFragmentRun& run : traf->runs) {
+    if (run.flags & TrackFragmentRun::kDataOffsetPresentMask) {
+      current_offset = run.data_offset;
+      has_offset = true;
+    } else if (!has_offset) {
+      return Status(error::PARSER_FAILURE,
+                    "Encryption requires an explicit data offset in the first "
+                    "'trun' of a track fragment.");
+    }
+    for (uint32_t i = 0; i < run.sample_count; ++i, ++sample_count) {
+      uint64_t sample_size = 0;
+      if (run.flags & TrackFragmentRun::kSampleSizePresentMask) {
+        sample_size = run.sample_sizes[i];
+      } else if (traf->header.flags &
+                 TrackFragmentHeader::kDefaultSampleSizePresentMask) {
+        sample_size = traf->header.default_sample_size;
+      } else {
+        sample_size = cryptor->default_sample_size;
+      }
+      if (sample_size == 0) {
+        return Status(error::PARSER_FAILURE,
+                      "Cannot determine the sample size for track " +
+                          base::UintToString(traf->header.track_id) + ".");
+      }
+      if (current_offset < moof_size_ + mdat_header_size ||
+          current_offset + sample_size > moof_size_ + mdat_buffer_size) {
+        return Status(error::PARSER_FAILURE,
+                      "Sample range is outside the 'mdat' box.");
+      }
+      uint8_t* data = mdat_buffer + (current_offset - moof_size_);
+      current_offset += sample_size;
+
+      SampleEncryptionEntry sample_encryption_entry;
+      sample_encryption_entry.initialization_vector = encryptor->iv();
+      if (cryptor->is_video) {
+        NaluReader reader(cryptor->nalu_codec, cryptor->nalu_length_size, data,
+                          sample_size);
+
+        // Store the current length of clear data.  This is used to squash
+        // multiple unencrypted NAL units into fewer subsample entries.
+        uint64_t accumulated_clear_bytes = 0;
+
+        Nalu nalu;
+        NaluReader::Result result;
+        while ((result = reader.Advance(&nalu)) == NaluReader::kOk) {
+          if (nalu.is_video_slice()) {
+            // For video-slice NAL units, encrypt the video slice.  This
+            // skips the frame header.
+            const int64_t video_slice_header_size =
+                cryptor->header_parser->GetHeaderSize(nalu);
+            if (video_slice_header_size < 0) {
+              return Status(error::PARSER_FAILURE,
+                            "Failed to read slice header.");
+            }
+            const uint64_t current_clear_bytes =
+                nalu.header_size() + video_slice_header_size;
+            const uint64_t cipher_bytes =
+                nalu.payload_size() - video_slice_header_size;
+            uint8_t* cipher_start =
+                const_cast<uint8_t*>(nalu.data()) + current_clear_bytes;
+            CHECK(encryptor->Crypt(cipher_start, cipher_bytes, cipher_start));
+            AddSubsamples(accumulated_clear_bytes + cryptor->nalu_length_size +
+                              current_clear_bytes,
+                          cipher_bytes, &sample_encryption_entry.subsamples);
+            accumulated_clear_bytes = 0;
+          } else {
+            // For non-video-slice NAL units, don't encrypt.
+            accumulated_clear_bytes += cryptor->nalu_length_size +
+                                       nalu.header_size() +
+                                       nalu.payload_size();
+          }
+        }
+        if (result != NaluReader::kEOStream)
+          return Status(error::PARSER_FAILURE, "Failed to parse NAL units.");
+        AddSubsamples(accumulated_clear_bytes, 0,
+                      &sample_encryption_entry.subsamples);
+        DCHECK_EQ(sample_encryption_entry.GetTotalSizeOfSubsamples(),
+                  static_cast<uint32_t>(sample_size));
+
+        // The length of per-sample auxiliary datum, defined in CENC ch. 7.
+        traf->auxiliary_size.sample_info_sizes.push_back(
+            sample_encryption_entry.ComputeSize());
+      } else {
+        CHECK(encryptor->Crypt(data, sample_size, data));
+      }
+      senc.sample_encryption_entries.push_back(sample_encryption_entry);
+      encryptor->UpdateIv();
+    }
+  }
+
+  // The offset is adjusted in EncryptFragment() once the new 'moof' size is
+  // known.
+  traf->auxiliary_offset.offsets.push_back(0);
+
+  SampleAuxiliaryInformationSize& saiz = traf->auxiliary_size;
+  saiz.sample_count = sample_count;
+  if (saiz.sample_info_sizes.empty()) {
+    // |sample_info_sizes| table is filled in only for subsample encryption,
+    // otherwise |sample_info_size| is just the IV size.
+    saiz.default_sample_info_size = senc.iv_size;
+  } else {
+    // Use the default size instead of the table when all entries agree.
+    saiz.default_sample_info_size = saiz.sample_info_sizes[0];
+    for (uint8_t info_size : saiz.sample_info_sizes) {
+      if (info_size != saiz.default_sample_info_size) {
+        saiz.default_sample_info_size = 0;
+        break;
+      }
+    }
+    if (saiz.default_sample_info_size != 0)
+      saiz.sample_info_sizes.clear();
+  }
+  return Status::OK;
+}
+
+Status FragmentPassthrough::WriteBuffer(File* file,
+                                        const uint8_t* data,
+                                        uint64_t size) {
+  uint64_t bytes_written = 0;
+  while (bytes_written < size) {
+    const int64_t result =
+        file->Write(data + bytes_written, size - bytes_written);
+    if (result <= 0) {
+      return Status(error::FILE_FAILURE,
+                    "Cannot write to file " + file->file_name());
+    }
+    bytes_written += result;
+  }
+  return Status::OK;
+}
+
+Status FragmentPassthrough::CopyRange(File* input,
+                                      uint64_t position,
+                                      uint64_t size,
+                                      File* output) {
+  if (!input->Seek(position)) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot seek in file " + input->file_name());
+  }
+  std::vector<uint8_t> buffer(std::min(size, kCopyBufferSize));
+  uint64_t bytes_left = size;
+  while (bytes_left > 0) {
+    const int64_t bytes_read = input->Read(
+        &buffer[0], std::min<uint64_t>(bytes_left, buffer.size()));
+    if (bytes_read <= 0) {
+      return Status(error::FILE_FAILURE,
+                    "Cannot read file " + input->file_name());
+    }
+    Status status = WriteBuffer(output, &buffer[0], bytes_read);
+    if (!status.ok())
+      return status;
+    bytes_left -= bytes_read;
+  }
+  return Status::OK;
+}
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
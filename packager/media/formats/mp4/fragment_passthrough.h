@@ -0,0 +1,152 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MEDIA_FORMATS_MP4_FRAGMENT_PASSTHROUGH_H_
+#define MEDIA_FORMATS_MP4_FRAGMENT_PASSTHROUGH_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "packager/base/macros.h"
+#include "packager/base/memory/scoped_ptr.h"
+#include "packager/media/base/fourccs.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/base/status.h"
+
+namespace shaka {
+namespace media {
+
+class File;
+class KeySource;
+
+namespace mp4 {
+
+struct Movie;
+struct MovieFragment;
+struct TrackFragment;
+
+/// Copies an already-fragmented ISO BMFF file to the output without demuxing
+/// and re-muxing it. The top-level box structure is validated with BoxReader:
+/// 'moov' with 'mvex' must precede the first 'moof', every 'moof' must be
+/// followed by its 'mdat', and track decode times must not go backwards
+/// between fragments. Only the 'mfhd' sequence numbers are rewritten, so they
+/// stay contiguous in the output; everything else, including the 'mdat'
+/// payloads, is block-copied untouched. Supports single file output as well
+/// as segment template output, where 'ftyp'+'moov' become the initialization
+/// segment and each 'moof'+'mdat' pair becomes one segment file. Manifest
+/// output is not generated.
+///
+/// With SetEncryptionKeySource() the copy additionally applies CENC: samples
+/// are encrypted in place as each 'mdat' streams through, and the 'moov' and
+/// 'moof' boxes are rewritten with the protection boxes ('sinf', 'pssh',
+/// 'senc', 'saiz', 'saio') and adjusted data offsets. This turns an
+/// encrypt-only job on a pre-fragmented input into little more than a byte
+/// pump; no MediaSample objects are constructed and no fragmenter runs.
+class FragmentPassthrough {
+ public:
+  explicit FragmentPassthrough(const MuxerOptions& options);
+  ~FragmentPassthrough();
+
+  /// Enable encryption of the copied fragments. Only the 'cenc' protection
+  /// scheme is supported, and video tracks must be AVC or HEVC, for which
+  /// subsample encryption keeps NAL unit headers and slice headers in the
+  /// clear; other inputs require a full remux. The track fragments must use
+  /// the 'default-base-is-moof' addressing that CMAF mandates. Must be
+  /// called before @a Run.
+  /// @param key_source points to the encryption key source. Ownership is not
+  ///        transferred; it must outlive this object.
+  /// @param protection_scheme specifies the protection scheme.
+  /// @param max_sd_pixels specifies the threshold to determine whether a video
+  ///        track should use the SD key or the HD key.
+  void SetEncryptionKeySource(KeySource* key_source,
+                              FourCC protection_scheme,
+                              uint32_t max_sd_pixels) {
+    encryption_key_source_ = key_source;
+    protection_scheme_ = protection_scheme;
+    max_sd_pixels_ = max_sd_pixels;
+  }
+
+  /// Validates @a input and copies it to the output configured by the muxer
+  /// options.
+  /// @return OK on success.
+  Status Run(const std::string& input);
+
+ private:
+  // Per-track encryptor, NAL unit layout and defaults in encryption mode.
+  struct TrackCryptor;
+  // Validates the parsed 'moof' against |moov|: fragments of a video track
+  // should start with a key frame, and decode times must not go backwards.
+  Status ValidateFragment(const Movie& moov, const MovieFragment& moof);
+
+  // Writes the pending 'moof' and copies the 'mdat' box of |mdat_size| bytes
+  // at |mdat_position| in |input| to the output. In segment template mode
+  // this creates one segment file per fragment.
+  Status WriteFragment(File* input, uint64_t mdat_position,
+                       uint64_t mdat_size);
+
+  // Converts the sample descriptions in |moov| to encrypted entries, fetches
+  // the encryption keys and creates the per-track cryptors, and fills the
+  // 'pssh' boxes.
+  Status PrepareMoovForEncryption(Movie* moov);
+
+  // Reads the 'mdat' box at |mdat_position| into |mdat_buffer|, encrypts its
+  // sample ranges in place and finalizes the pending 'moof': 'senc', 'saiz'
+  // and 'saio' are filled in and the data offsets are shifted by the 'moof'
+  // growth. The rewritten 'moof' is left in |moof_buffer_|.
+  Status EncryptFragment(File* input, uint64_t mdat_position,
+                         uint64_t mdat_size, std::vector<uint8_t>* mdat_buffer);
+
+  // Encrypts the samples of |traf| inside the 'mdat' box held in
+  // |mdat_buffer| of |mdat_buffer_size| bytes, collecting the per-sample
+  // initialization vectors and subsamples into the 'senc' and 'saiz' entries
+  // of |traf|.
+  Status EncryptTrackFragment(TrackCryptor* cryptor, TrackFragment* traf,
+                              uint8_t* mdat_buffer, uint64_t mdat_buffer_size,
+                              uint64_t mdat_header_size);
+
+  // Writes |size| bytes to |file|, failing on short writes.
+  Status WriteBuffer(File* file, const uint8_t* data, uint64_t size);
+
+  // Block-copies |size| bytes starting at |position| in |input| to |output|.
+  Status CopyRange(File* input, uint64_t position, uint64_t size,
+                   File* output);
+
+  const MuxerOptions options_;
+  // Single file output; not used in segment template mode.
+  File* output_;
+  uint32_t num_segments_;
+  uint32_t sequence_number_;
+  // Encryption mode; see SetEncryptionKeySource(). |pending_moof_| holds the
+  // parsed 'moof' awaiting its 'mdat', along with the position and size the
+  // box had in the input, which anchor the 'default-base-is-moof' data
+  // offsets.
+  KeySource* encryption_key_source_;
+  FourCC protection_scheme_;
+  uint32_t max_sd_pixels_;
+  std::map<uint32_t, TrackCryptor*> track_cryptors_;
+  scoped_ptr<MovieFragment> pending_moof_;
+  uint64_t moof_position_;
+  uint64_t moof_size_;
+  // The patched 'moof' waiting for its 'mdat', the 'styp' preceding it (if
+  // any) and the decode time of its first track fragment.
+  std::vector<uint8_t> moof_buffer_;
+  std::vector<uint8_t> pending_styp_;
+  bool has_pending_moof_;
+  uint64_t moof_start_time_;
+  // Last seen decode time per track, for the monotonicity check.
+  std::map<uint32_t, uint64_t> last_decode_time_;
+
+  DISALLOW_COPY_AND_ASSIGN(FragmentPassthrough);
+};
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
+
+#endif  // MEDIA_FORMATS_MP4_FRAGMENT_PASSTHROUGH_H_
@@ -8,9 +8,9 @@
 
 #include <limits>
 
-#include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/media_sample.h"
+#include "packager/media/base/trace_span.h"
 #include "packager/media/formats/mp4/box_definitions.h"
 
 namespace shaka {
@@ -38,7 +38,16 @@ Fragmenter::Fragmenter(scoped_refptr<StreamInfo> info, TrackFragment* traf)
       fragment_duration_(0),
       presentation_start_time_(kInvalidTime),
       earliest_presentation_time_(kInvalidTime),
-      first_sap_time_(kInvalidTime) {
+      first_sap_time_(kInvalidTime),
+      samples_size_(0),
+      sample_sizes_uniform_(true),
+      first_sample_size_(0),
+      sample_durations_uniform_(true),
+      first_sample_duration_(0),
+      sample_flags_uniform_(true),
+      first_sample_flags_(0),
+      sample_cts_offsets_uniform_(true),
+      first_sample_cts_offset_(0) {
   DCHECK(traf);
 }
 
@@ -60,28 +69,41 @@ Status Fragmenter::AddSample(scoped_refptr<MediaSample> sample) {
   if (sample->side_data_size() > 0)
     LOG(WARNING) << "MP4 samples do not support side data. Side data ignored.";
 
-  // Fill in sample parameters. It will be optimized later.
-  traf_->runs[0].sample_sizes.push_back(sample->data_size());
-  traf_->runs[0].sample_durations.push_back(sample->duration());
-  traf_->runs[0].sample_flags.push_back(
-      sample->is_key_frame() ? 0 : TrackFragmentHeader::kNonKeySampleMask);
-
-  data_->AppendArray(sample->data(), sample->data_size());
-  fragment_duration_ += sample->duration();
-
+  // Fill in sample parameters. The per-sample tables are only materialized
+  // when the values diverge; uniform runs - the common case for fixed frame
+  // duration audio - are emitted as trun/tfhd defaults in FinalizeFragment()
+  // without building the tables at all.
   const int64_t pts = sample->pts();
   const int64_t dts = sample->dts();
 
+  TrackFragmentRun& run = traf_->runs[0];
+  const uint32_t sample_size = sample->data_size();
+  const uint32_t sample_duration = sample->duration();
+  const uint32_t sample_flags =
+      sample->is_key_frame() ? 0 : TrackFragmentHeader::kNonKeySampleMask;
+  AccumulateSampleEntry(sample_size, &run.sample_sizes, &first_sample_size_,
+                        &sample_sizes_uniform_);
+  AccumulateSampleEntry(sample_duration, &run.sample_durations,
+                        &first_sample_duration_, &sample_durations_uniform_);
+  AccumulateSampleEntry(sample_flags, &run.sample_flags, &first_sample_flags_,
+                        &sample_flags_uniform_);
+  AccumulateSampleEntry(pts - dts, &run.sample_composition_time_offsets,
+                        &first_sample_cts_offset_,
+                        &sample_cts_offsets_uniform_);
+
+  // Keep a reference to the sample instead of copying its payload; the
+  // payloads are gathered straight into the output when the fragment is
+  // written.
+  samples_.push_back(sample);
+  samples_size_ += sample->data_size();
+  fragment_duration_ += sample->duration();
+
   const int64_t timestamp = use_decoding_timestamp_in_timeline_ ? dts : pts;
   // Set |earliest_presentation_time_| to |timestamp| if |timestamp| is smaller
   // or if it is not yet initialized (kInvalidTime > timestamp is always true).
   if (earliest_presentation_time_ > timestamp)
     earliest_presentation_time_ = timestamp;
 
-  traf_->runs[0].sample_composition_time_offsets.push_back(pts - dts);
-  if (pts != dts)
-    traf_->runs[0].flags |= TrackFragmentRun::kSampleCompTimeOffsetsPresentMask;
-
   if (sample->is_key_frame()) {
     if (first_sap_time_ == kInvalidTime)
       first_sap_time_ = pts;
@@ -104,31 +126,61 @@ Status Fragmenter::InitializeFragment(int64_t first_sample_dts) {
   fragment_duration_ = 0;
   earliest_presentation_time_ = kInvalidTime;
   first_sap_time_ = kInvalidTime;
-  data_.reset(new BufferWriter());
+  sample_sizes_uniform_ = true;
+  first_sample_size_ = 0;
+  sample_durations_uniform_ = true;
+  first_sample_duration_ = 0;
+  sample_flags_uniform_ = true;
+  first_sample_flags_ = 0;
+  sample_cts_offsets_uniform_ = true;
+  first_sample_cts_offset_ = 0;
+  // The previous fragment's samples were handed off to the segmenter's
+  // gather buffer when the fragment was written; release our references.
+  samples_.clear();
+  samples_size_ = 0;
   return Status::OK;
 }
 
-void Fragmenter::FinalizeFragment() {
-  // Optimize trun box.
-  traf_->runs[0].sample_count = traf_->runs[0].sample_sizes.size();
-  if (OptimizeSampleEntries(&traf_->runs[0].sample_durations,
-                            &traf_->header.default_sample_duration)) {
+Status Fragmenter::FinalizeFragment() {
+  TRACE_SPAN("mux", "Fragmenter::FinalizeFragment");
+  // Emit uniform runs as tfhd default fields; the per-sample tables were
+  // never built for them. Diverging runs had their tables materialized
+  // during accumulation.
+  TrackFragmentRun& run = traf_->runs[0];
+  run.sample_count = samples_.size();
+  if (sample_durations_uniform_) {
+    DCHECK(run.sample_durations.empty());
+    traf_->header.default_sample_duration = first_sample_duration_;
     traf_->header.flags |=
         TrackFragmentHeader::kDefaultSampleDurationPresentMask;
   } else {
-    traf_->runs[0].flags |= TrackFragmentRun::kSampleDurationPresentMask;
+    run.flags |= TrackFragmentRun::kSampleDurationPresentMask;
   }
-  if (OptimizeSampleEntries(&traf_->runs[0].sample_sizes,
-                            &traf_->header.default_sample_size)) {
+  if (sample_sizes_uniform_) {
+    DCHECK(run.sample_sizes.empty());
+    traf_->header.default_sample_size = first_sample_size_;
     traf_->header.flags |= TrackFragmentHeader::kDefaultSampleSizePresentMask;
   } else {
-    traf_->runs[0].flags |= TrackFragmentRun::kSampleSizePresentMask;
+    run.flags |= TrackFragmentRun::kSampleSizePresentMask;
   }
-  if (OptimizeSampleEntries(&traf_->runs[0].sample_flags,
-                            &traf_->header.default_sample_flags)) {
+  if (sample_flags_uniform_) {
+    DCHECK(run.sample_flags.empty());
+    traf_->header.default_sample_flags = first_sample_flags_;
     traf_->header.flags |= TrackFragmentHeader::kDefaultSampleFlagsPresentMask;
   } else {
-    traf_->runs[0].flags |= TrackFragmentRun::kSampleFlagsPresentMask;
+    run.flags |= TrackFragmentRun::kSampleFlagsPresentMask;
+  }
+  // There is no tfhd default for composition offsets; a uniform non-zero run
+  // still has to be written per sample. All-zero offsets are simply omitted.
+  if (sample_cts_offsets_uniform_) {
+    DCHECK(run.sample_composition_time_offsets.empty());
+    if (first_sample_cts_offset_ != 0) {
+      run.sample_composition_time_offsets.assign(run.sample_count,
+                                                 first_sample_cts_offset_);
+      run.flags |= TrackFragmentRun::kSampleCompTimeOffsetsPresentMask;
+    }
+  } else {
+    run.flags |= TrackFragmentRun::kSampleCompTimeOffsetsPresentMask;
   }
 
   // Add SampleToGroup boxes. A SampleToGroup box with grouping type of 'roll'
@@ -163,6 +215,7 @@ void Fragmenter::FinalizeFragment() {
 
   fragment_finalized_ = true;
   fragment_initialized_ = false;
+  return Status::OK;
 }
 
 void Fragmenter::GenerateSegmentReference(SegmentReference* reference) {
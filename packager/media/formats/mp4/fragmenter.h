@@ -17,7 +17,6 @@
 namespace shaka {
 namespace media {
 
-class BufferWriter;
 class MediaSample;
 class StreamInfo;
 
@@ -48,7 +47,8 @@ class Fragmenter {
   virtual Status InitializeFragment(int64_t first_sample_dts);
 
   /// Finalize and optimize the fragment.
-  virtual void FinalizeFragment();
+  /// @return OK on success, an error status otherwise.
+  virtual Status FinalizeFragment();
 
   /// Fill @a reference with current fragment information.
   void GenerateSegmentReference(SegmentReference* reference);
@@ -60,7 +60,16 @@ class Fragmenter {
   }
   bool fragment_initialized() const { return fragment_initialized_; }
   bool fragment_finalized() const { return fragment_finalized_; }
-  BufferWriter* data() { return data_.get(); }
+
+  /// @return The samples added to this fragment, in mdat order. The sample
+  ///         payloads are referenced, not copied; the caller gathers them
+  ///         into the output directly.
+  const std::vector<scoped_refptr<MediaSample> >& samples() const {
+    return samples_;
+  }
+  /// @return The total size of the sample payloads in bytes, i.e. the mdat
+  ///         payload contribution of this fragment.
+  uint64_t samples_size() const { return samples_size_; }
 
   /// Set the flag use_decoding_timestamp_in_timeline, which if set to true, use
   /// decoding timestamp instead of presentation timestamp in media timeline,
@@ -74,13 +83,18 @@ class Fragmenter {
  protected:
   TrackFragment* traf() { return traf_; }
 
-  /// Optimize sample entries table. If all values in @a entries are identical,
-  /// then @a entries is cleared and the value is assigned to @a default_value;
-  /// otherwise it is a NOP. Return true if the table is optimized.
+ private:
+  // Accumulate one per-sample metadata value with run-length detection:
+  // while every value matches the first one seen, |*entries| stays empty and
+  // only |*first_value| is tracked; the table is backfilled for the samples
+  // seen so far when the first divergent value arrives. Must be called
+  // before the sample is appended to |samples_|.
   template <typename T>
-  bool OptimizeSampleEntries(std::vector<T>* entries, T* default_value);
+  void AccumulateSampleEntry(T value,
+                             std::vector<T>* entries,
+                             T* first_value,
+                             bool* uniform);
 
- private:
   // Check if the current fragment starts with SAP.
   bool StartsWithSAP();
 
@@ -93,28 +107,42 @@ class Fragmenter {
   int64_t presentation_start_time_;
   int64_t earliest_presentation_time_;
   int64_t first_sap_time_;
-  scoped_ptr<BufferWriter> data_;
+  std::vector<scoped_refptr<MediaSample> > samples_;
+  uint64_t samples_size_;
+  // Run-length state for the per-sample metadata tables; see
+  // AccumulateSampleEntry().
+  bool sample_sizes_uniform_;
+  uint32_t first_sample_size_;
+  bool sample_durations_uniform_;
+  uint32_t first_sample_duration_;
+  bool sample_flags_uniform_;
+  uint32_t first_sample_flags_;
+  bool sample_cts_offsets_uniform_;
+  int64_t first_sample_cts_offset_;
 
   DISALLOW_COPY_AND_ASSIGN(Fragmenter);
 };
 
 template <typename T>
-bool Fragmenter::OptimizeSampleEntries(std::vector<T>* entries,
-                                       T* default_value) {
-  DCHECK(entries);
-  DCHECK(default_value);
-  DCHECK(!entries->empty());
-
-  typename std::vector<T>::const_iterator it = entries->begin();
-  T value = *it;
-  for (; it < entries->end(); ++it)
-    if (value != *it)
-      return false;
-
-  // Clear |entries| if it contains only one value.
-  entries->clear();
-  *default_value = value;
-  return true;
+void Fragmenter::AccumulateSampleEntry(T value,
+                                       std::vector<T>* entries,
+                                       T* first_value,
+                                       bool* uniform) {
+  const size_t num_prior_samples = samples_.size();
+  if (num_prior_samples == 0) {
+    *first_value = value;
+    *uniform = true;
+    DCHECK(entries->empty());
+    return;
+  }
+  if (*uniform) {
+    if (value == *first_value)
+      return;
+    // First divergent value; backfill the table for the samples seen so far.
+    entries->assign(num_prior_samples, *first_value);
+    *uniform = false;
+  }
+  entries->push_back(value);
 }
 
 }  // namespace mp4
@@ -7,6 +7,7 @@
 #include "packager/media/formats/mp4/key_rotation_fragmenter.h"
 
 #include "packager/media/base/aes_encryptor.h"
+#include "packager/media/base/runtime_config.h"
 #include "packager/media/formats/mp4/box_definitions.h"
 
 namespace shaka {
@@ -41,6 +42,10 @@ KeyRotationFragmenter::KeyRotationFragmenter(MovieFragment* moof,
       track_type_(track_type),
       crypto_period_duration_(crypto_period_duration),
       prev_crypto_period_index_(-1),
+      crypto_period_base_time_(0),
+      crypto_period_base_index_(0),
+      timescale_(info->time_scale()),
+      runtime_config_(NULL),
       muxer_listener_(muxer_listener) {
   DCHECK(moof);
   DCHECK(encryption_key_source);
@@ -52,9 +57,35 @@ Status KeyRotationFragmenter::PrepareFragmentForEncryption(
     bool enable_encryption) {
   bool need_to_refresh_encryptor = !encryptor();
 
+  // The index is computed relative to the last rebase point, so a changed
+  // crypto period duration never repeats or skips a period index.
+  const int64_t decode_time = traf()->decode_time.decode_time;
   size_t current_crypto_period_index =
-      traf()->decode_time.decode_time / crypto_period_duration_;
+      crypto_period_base_index_ +
+      (decode_time - crypto_period_base_time_) / crypto_period_duration_;
   if (current_crypto_period_index != prev_crypto_period_index_) {
+    // At a crypto period boundary the whole fragment uses the new key, so
+    // this is the one safe point to adopt a new rotation interval from the
+    // runtime config.
+    if (runtime_config_) {
+      runtime_config_->MaybeReload();
+      double duration_in_seconds = 0;
+      if (runtime_config_->GetDouble("crypto_period_duration",
+                                     &duration_in_seconds) &&
+          duration_in_seconds > 0) {
+        const int64_t new_duration =
+            static_cast<int64_t>(duration_in_seconds * timescale_);
+        if (new_duration != crypto_period_duration_) {
+          LOG(INFO) << "Crypto period duration changed from "
+                    << crypto_period_duration_ << " to " << new_duration
+                    << " (timescale " << timescale_ << ") at period "
+                    << current_crypto_period_index << ".";
+          crypto_period_base_time_ = decode_time;
+          crypto_period_base_index_ = current_crypto_period_index;
+          crypto_period_duration_ = new_duration;
+        }
+      }
+    }
     scoped_ptr<EncryptionKey> encryption_key(new EncryptionKey());
     Status status = encryption_key_source_->GetCryptoPeriodKey(
         current_crypto_period_index, track_type_, encryption_key.get());
@@ -76,7 +107,9 @@ Status KeyRotationFragmenter::PrepareFragmentForEncryption(
       encryption_key()->key_system_info;
   moof_->pssh.resize(system_info.size());
   for (size_t i = 0; i < system_info.size(); i++) {
-    moof_->pssh[i].raw_box = system_info[i].CreateBox();
+    // The shared blob is serialized once per crypto period, not once per
+    // fragment.
+    moof_->pssh[i].raw_box = system_info[i].CreateBoxShared()->bytes();
   }
 
   if (muxer_listener_) {
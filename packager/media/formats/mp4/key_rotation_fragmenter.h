@@ -14,6 +14,9 @@
 
 namespace shaka {
 namespace media {
+
+class RuntimeConfig;
+
 namespace mp4 {
 
 struct MovieFragment;
@@ -54,6 +57,14 @@ class KeyRotationFragmenter : public EncryptingFragmenter {
                         MuxerListener* muxer_listener);
   ~KeyRotationFragmenter() override;
 
+  /// Set the runtime config polled for changes to the crypto period duration.
+  /// A changed duration takes effect at the next crypto period boundary, so
+  /// period indexes passed to the key source stay monotonic and no fragment
+  /// mixes keys. @a runtime_config may be NULL; the caller retains ownership.
+  void set_runtime_config(RuntimeConfig* runtime_config) {
+    runtime_config_ = runtime_config;
+  }
+
  protected:
   /// @name Fragmenter implementation overrides.
   /// @{
@@ -65,8 +76,17 @@ class KeyRotationFragmenter : public EncryptingFragmenter {
 
   KeySource* encryption_key_source_;
   KeySource::TrackType track_type_;
-  const int64_t crypto_period_duration_;
+  // Current crypto period duration in units of the track's timescale. May be
+  // updated between crypto periods; see set_runtime_config().
+  int64_t crypto_period_duration_;
   size_t prev_crypto_period_index_;
+  // Rebase point for the period index computation, advanced whenever the
+  // crypto period duration changes so indexes never repeat or go backwards.
+  int64_t crypto_period_base_time_;
+  size_t crypto_period_base_index_;
+  const uint32_t timescale_;
+  // Not owned, can be NULL. See set_runtime_config().
+  RuntimeConfig* runtime_config_;
 
   // For notifying new pssh boxes to the event handler.
   MuxerListener* const muxer_listener_;
@@ -28,6 +28,8 @@
         'decoding_time_iterator.h',
         'encrypting_fragmenter.cc',
         'encrypting_fragmenter.h',
+        'fragment_passthrough.cc',
+        'fragment_passthrough.h',
         'fragmenter.cc',
         'fragmenter.h',
         'key_rotation_fragmenter.cc',
@@ -8,11 +8,15 @@
 
 #include "packager/base/callback.h"
 #include "packager/base/callback_helpers.h"
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
 #include "packager/base/logging.h"
+#include "packager/base/macros.h"
 #include "packager/base/memory/ref_counted.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/buffer_reader.h"
+#include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/decrypt_config.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/macros.h"
@@ -27,6 +31,7 @@
 #include "packager/media/file/file_closer.h"
 #include "packager/media/formats/mp4/box_definitions.h"
 #include "packager/media/formats/mp4/box_reader.h"
+#include "packager/media/formats/mp4/decoding_time_iterator.h"
 #include "packager/media/formats/mp4/track_run_iterator.h"
 
 namespace shaka {
@@ -40,6 +45,11 @@ uint64_t Rescale(uint64_t time_in_old_scale,
   return (static_cast<double>(time_in_old_scale) / old_scale) * new_scale;
 }
 
+// Parse index sidecar framing; see MP4MediaParser::SetParseIndexPath(). The
+// header is followed by the TrackRunIterator index payload.
+const uint32_t kParseIndexMagic = 0x53504D49;  // "SPMI"
+const uint8_t kParseIndexVersion = 1;
+
 VideoCodec FourCCToVideoCodec(FourCC fourcc) {
   switch (fourcc) {
     case FOURCC_avc1:
@@ -94,9 +104,19 @@ MP4MediaParser::MP4MediaParser()
     : state_(kWaitingForInit),
       decryption_key_source_(NULL),
       moof_head_(0),
-      mdat_tail_(0) {}
-
-MP4MediaParser::~MP4MediaParser() {}
+      mdat_tail_(0),
+      pending_decrypt_track_id_(0),
+      batch_track_id_(0),
+      has_clip_range_(false),
+      clip_start_seconds_(0),
+      clip_end_seconds_(0),
+      clip_range_applied_(false),
+      select_audio_(true),
+      select_video_(true) {}
+
+MP4MediaParser::~MP4MediaParser() {
+  DiscardPendingDecryptSample();
+}
 
 void MP4MediaParser::Init(const InitCB& init_cb,
                           const NewSampleCB& new_sample_cb,
@@ -115,14 +135,18 @@ void MP4MediaParser::Init(const InitCB& init_cb,
 }
 
 void MP4MediaParser::Reset() {
+  DiscardPendingDecryptSample();
   queue_.Reset();
   runs_.reset();
   moof_head_ = 0;
   mdat_tail_ = 0;
+  batch_samples_.clear();
 }
 
 bool MP4MediaParser::Flush() {
   DCHECK_NE(state_, kWaitingForInit);
+  if (!EmitPendingSample() || !FlushSampleBatch())
+    return false;
   Reset();
   ChangeState(kParsingBoxes);
   return true;
@@ -144,9 +168,17 @@ bool MP4MediaParser::Parse(const uint8_t* buf, int size) {
     } else {
       DCHECK_EQ(kEmittingSamples, state_);
       result = EnqueueSample(&err);
-      if (result) {
+      if (!err) {
+        // Trim the queue even if more data is needed for the next sample, so
+        // memory stays bounded by the current sample while its bytes arrive.
         int64_t max_clear = runs_->GetMaxClearOffset() + moof_head_;
-        err = !ReadAndDiscardMDATsUntil(max_clear);
+        if (clip_range_applied_) {
+          // Clip skips may jump over 'mdat' headers, so box framing is not
+          // tracked; the offsets from the 'moov' box are authoritative.
+          queue_.Trim(max_clear);
+        } else {
+          err = !ReadAndDiscardMDATsUntil(max_clear);
+        }
       }
     }
   } while (result && !err);
@@ -237,6 +269,30 @@ bool MP4MediaParser::LoadMoov(const std::string& file_path) {
   return true;
 }
 
+void MP4MediaParser::SetClipRange(double start_seconds, double end_seconds) {
+  DCHECK(!moov_);
+  DCHECK_LE(0, start_seconds);
+  DCHECK_LT(start_seconds, end_seconds);
+  has_clip_range_ = true;
+  clip_start_seconds_ = start_seconds;
+  clip_end_seconds_ = end_seconds;
+}
+
+int64_t MP4MediaParser::NextRequiredPosition(int64_t position) {
+  if (!clip_range_applied_ || state_ != kEmittingSamples || !runs_)
+    return position;
+  if (!runs_->IsRunValid())
+    return -1;  // Every sample in the clip range has been emitted.
+  const int64_t needed = runs_->GetMaxClearOffset() + moof_head_;
+  return needed > position ? needed : position;
+}
+
+void MP4MediaParser::SkipTo(int64_t position) {
+  DCHECK(clip_range_applied_);
+  queue_.Trim(position);
+  queue_.AdvanceHeadTo(position);
+}
+
 bool MP4MediaParser::ParseBox(bool* err) {
   const uint8_t* buf;
   int size;
@@ -287,6 +343,25 @@ bool MP4MediaParser::ParseMoov(BoxReader* reader) {
   RCHECK(moov_->Parse(reader));
   runs_.reset();
 
+  // Drop unselected 'trak' boxes before anything looks at them: their sample
+  // tables are never materialized and their chunks are treated like any
+  // other bytes no retained sample covers.
+  if (!select_audio_ || !select_video_) {
+    std::vector<Track>::iterator track = moov_->tracks.begin();
+    while (track != moov_->tracks.end()) {
+      const FourCC handler_type = track->media.handler.handler_type;
+      const bool drop = (handler_type == FOURCC_soun && !select_audio_) ||
+                        (handler_type == FOURCC_vide && !select_video_);
+      if (drop) {
+        DVLOG(1) << "Skipping unselected track " << track->header.track_id;
+        track = moov_->tracks.erase(track);
+      } else {
+        ++track;
+      }
+    }
+    RCHECK(!moov_->tracks.empty());
+  }
+
   std::vector<scoped_refptr<StreamInfo> > streams;
 
   for (std::vector<Track>::const_iterator track = moov_->tracks.begin();
@@ -578,13 +653,41 @@ bool MP4MediaParser::ParseMoov(BoxReader* reader) {
       const bool is_encrypted =
           entry.sinf.info.track_encryption.default_is_protected == 1;
       DVLOG(1) << "is_video_track_encrypted_: " << is_encrypted;
-      streams.push_back(new VideoStreamInfo(
+      scoped_refptr<VideoStreamInfo> video_stream_info(new VideoStreamInfo(
           track->header.track_id, timescale, duration, video_codec,
           codec_string, track->media.header.language.code, coded_width,
           coded_height, pixel_width, pixel_height,
           0,  // trick_play_rate
           nalu_length_size, entry.codec_configuration.data.data(),
           entry.codec_configuration.data.size(), is_encrypted));
+
+      // Build the key frame index from the 'stss' and 'stts' tables, so
+      // downstream consumers (segment boundary planning, clip and trick-play
+      // logic) can query key frame positions in O(log n) instead of
+      // rediscovering them from the samples. Without a 'stss' box every
+      // sample is a sync sample and no index is needed; fragmented input has
+      // empty 'moov' tables and learns key frames progressively from the
+      // 'trun' flags.
+      const SampleTable& sample_table =
+          track->media.information.sample_table;
+      const std::vector<uint32_t>& sync_samples =
+          sample_table.sync_sample.sample_number;
+      if (!sync_samples.empty()) {
+        DecodingTimeIterator decoding_time(
+            sample_table.decoding_time_to_sample);
+        std::vector<int64_t> key_frame_timestamps;
+        key_frame_timestamps.reserve(sync_samples.size());
+        for (size_t i = 0; i < sync_samples.size(); ++i) {
+          // Decode timestamp of sample n (1-based) is the total duration of
+          // the samples before it.
+          const uint32_t sample_number = sync_samples[i];
+          key_frame_timestamps.push_back(
+              sample_number > 1 ? decoding_time.Duration(1, sample_number - 1)
+                                : 0);
+        }
+        video_stream_info->set_key_frame_timestamps(key_frame_timestamps);
+      }
+      streams.push_back(video_stream_info);
     }
   }
 
@@ -592,7 +695,25 @@ bool MP4MediaParser::ParseMoov(BoxReader* reader) {
   if (!FetchKeysIfNecessary(moov_->pssh))
     return false;
   runs_.reset(new TrackRunIterator(moov_.get()));
-  RCHECK(runs_->Init());
+  if (has_clip_range_) {
+    if (moov_->extends.tracks.empty()) {
+      runs_->SetClipRange(clip_start_seconds_, clip_end_seconds_);
+      clip_range_applied_ = true;
+    } else {
+      LOG(WARNING) << "Clip range ignored: input is a fragmented mp4.";
+    }
+  }
+  // The parse index sidecar persists the run state of a full non-fragmented
+  // parse across runs of the same immutable input. A clip range or stream
+  // type selection changes the parsed state, so the sidecar is bypassed.
+  const bool use_parse_index =
+      !parse_index_path_.empty() && moov_->extends.tracks.empty() &&
+      !has_clip_range_ && select_audio_ && select_video_;
+  if (!use_parse_index || !LoadParseIndex()) {
+    RCHECK(runs_->Init());
+    if (use_parse_index)
+      WriteParseIndex();
+  }
   ChangeState(kEmittingSamples);
   return true;
 }
@@ -602,6 +723,24 @@ bool MP4MediaParser::ParseMoof(BoxReader* reader) {
   RCHECK(moov_.get());
   MovieFragment moof;
   RCHECK(moof.Parse(reader));
+  // Drop 'traf' boxes of tracks that were filtered out of the 'moov' box;
+  // see SelectStreamTypes().
+  if (!select_audio_ || !select_video_) {
+    std::vector<TrackFragment>::iterator traf = moof.tracks.begin();
+    while (traf != moof.tracks.end()) {
+      bool found = false;
+      for (size_t t = 0; t < moov_->tracks.size(); ++t) {
+        if (moov_->tracks[t].header.track_id == traf->header.track_id) {
+          found = true;
+          break;
+        }
+      }
+      if (found)
+        ++traf;
+      else
+        traf = moof.tracks.erase(traf);
+    }
+  }
   if (!runs_)
     runs_.reset(new TrackRunIterator(moov_.get()));
   RCHECK(runs_->Init(moof));
@@ -643,8 +782,111 @@ bool MP4MediaParser::FetchKeysIfNecessary(
   return false;
 }
 
+bool MP4MediaParser::GetParseIndexSourceInfo(int64_t* source_size,
+                                             int64_t* source_mtime) {
+  if (parse_index_source_path_.empty())
+    return false;
+  base::File::Info info;
+  if (!base::GetFileInfo(
+          base::FilePath::FromUTF8Unsafe(parse_index_source_path_), &info)) {
+    return false;
+  }
+  *source_size = info.size;
+  *source_mtime = info.last_modified.ToInternalValue();
+  return true;
+}
+
+bool MP4MediaParser::LoadParseIndex() {
+  int64_t source_size;
+  int64_t source_mtime;
+  if (!GetParseIndexSourceInfo(&source_size, &source_mtime))
+    return false;
+
+  scoped_ptr<File, FileCloser> file(
+      File::Open(parse_index_path_.c_str(), "r"));
+  if (!file)
+    return false;
+
+  // Map the sidecar when the file type supports it; the loads below then
+  // read straight from the page cache without an intermediate copy.
+  const uint8_t* data = NULL;
+  uint64_t size = 0;
+  std::string contents;
+  if (!file->MapReadOnly(&data, &size)) {
+    if (!File::ReadFileToString(parse_index_path_.c_str(), &contents))
+      return false;
+    data = reinterpret_cast<const uint8_t*>(contents.data());
+    size = contents.size();
+  }
+
+  BufferReader reader(data, size);
+  uint32_t magic;
+  uint8_t version;
+  int64_t indexed_size;
+  int64_t indexed_mtime;
+  if (!reader.Read4(&magic) || magic != kParseIndexMagic ||
+      !reader.Read1(&version) || version != kParseIndexVersion ||
+      !reader.Read8s(&indexed_size) || !reader.Read8s(&indexed_mtime)) {
+    VLOG(1) << "Ignoring unrecognized parse index " << parse_index_path_;
+    return false;
+  }
+  if (indexed_size != source_size || indexed_mtime != source_mtime) {
+    VLOG(1) << "Ignoring stale parse index " << parse_index_path_;
+    return false;
+  }
+
+  if (!runs_->InitFromIndex(&reader)) {
+    LOG(WARNING) << "Ignoring corrupt parse index " << parse_index_path_;
+    // InitFromIndex may have partially populated the iterator.
+    runs_.reset(new TrackRunIterator(moov_.get()));
+    return false;
+  }
+  VLOG(1) << "Loaded parse index " << parse_index_path_;
+  return true;
+}
+
+void MP4MediaParser::WriteParseIndex() {
+  int64_t source_size;
+  int64_t source_mtime;
+  if (!GetParseIndexSourceInfo(&source_size, &source_mtime))
+    return;
+
+  BufferWriter buffer;
+  buffer.AppendInt(kParseIndexMagic);
+  buffer.AppendInt(kParseIndexVersion);
+  buffer.AppendInt(source_size);
+  buffer.AppendInt(source_mtime);
+  if (!runs_->WriteIndex(&buffer)) {
+    VLOG(1) << "Input is not indexable; not writing a parse index.";
+    return;
+  }
+
+  File* file = File::Open(parse_index_path_.c_str(), "w");
+  if (!file) {
+    LOG(WARNING) << "Cannot open parse index for write: " << parse_index_path_;
+    return;
+  }
+  Status status = buffer.WriteToFile(file);
+  if (!file->Close() || !status.ok()) {
+    // A truncated sidecar fails validation on the next run and is rewritten,
+    // so this only costs the next run its fast path.
+    LOG(WARNING) << "Failed to write parse index " << parse_index_path_;
+  }
+}
+
 bool MP4MediaParser::EnqueueSample(bool* err) {
   if (!runs_->IsRunValid()) {
+    // The movie fragment's run set is exhausted; deliver its last batch.
+    if (!FlushSampleBatch()) {
+      *err = true;
+      return false;
+    }
+
+    // In clip range mode the run set is final: all samples have been
+    // emitted, and box framing was not tracked across clip skips.
+    if (clip_range_applied_)
+      return false;
+
     // Remain in kEnqueueingSamples state, discarding data, until the end of
     // the current 'mdat' box has been appended to the queue.
     if (!queue_.Trim(mdat_tail_))
@@ -699,6 +941,15 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
 
   scoped_refptr<MediaSample> stream_sample(MediaSample::CopyFrom(
       buf, runs_->sample_size(), runs_->is_keyframe()));
+
+  // Emit the sample held back for decryption, if any, before this one, so
+  // samples are pushed downstream in order.
+  if (!EmitPendingSample()) {
+    *err = true;
+    return false;
+  }
+
+  bool decrypt_pending = false;
   if (runs_->is_encrypted()) {
     if (!decryptor_source_) {
       *err = true;
@@ -707,15 +958,18 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
       return false;
     }
 
+    // Decrypt on the decryption thread while parsing continues with the next
+    // sample; the sample is held back until then.
     scoped_ptr<DecryptConfig> decrypt_config = runs_->GetDecryptConfig();
     if (!decrypt_config ||
-        !decryptor_source_->DecryptSampleBuffer(decrypt_config.get(),
-                                                stream_sample->writable_data(),
-                                                stream_sample->data_size())) {
+        !decryptor_source_->DecryptSampleBufferAsync(
+            decrypt_config.Pass(), stream_sample->writable_data(),
+            stream_sample->data_size())) {
       *err = true;
       LOG(ERROR) << "Cannot decrypt samples.";
       return false;
     }
+    decrypt_pending = true;
   }
 
   stream_sample->set_dts(runs_->dts());
@@ -729,7 +983,10 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
            << ", cts=" << runs_->cts()
            << ", size=" << runs_->sample_size();
 
-  if (!new_sample_cb_.Run(runs_->track_id(), stream_sample)) {
+  if (decrypt_pending) {
+    pending_decrypt_sample_ = stream_sample;
+    pending_decrypt_track_id_ = runs_->track_id();
+  } else if (!AppendSampleToBatch(runs_->track_id(), stream_sample)) {
     *err = true;
     LOG(ERROR) << "Failed to process the sample.";
     return false;
@@ -739,6 +996,52 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
   return true;
 }
 
+void MP4MediaParser::DiscardPendingDecryptSample() {
+  if (!pending_decrypt_sample_)
+    return;
+  // The asynchronous decryption writes into the sample buffer, so the job
+  // must be joined before the sample is released. The decryption status does
+  // not matter as the sample is dropped.
+  ignore_result(decryptor_source_->WaitForPendingDecrypt());
+  pending_decrypt_sample_ = NULL;
+}
+
+bool MP4MediaParser::EmitPendingSample() {
+  if (!pending_decrypt_sample_)
+    return true;
+
+  scoped_refptr<MediaSample> sample = pending_decrypt_sample_;
+  pending_decrypt_sample_ = NULL;
+  if (!decryptor_source_->WaitForPendingDecrypt()) {
+    LOG(ERROR) << "Cannot decrypt samples.";
+    return false;
+  }
+  if (!AppendSampleToBatch(pending_decrypt_track_id_, sample)) {
+    LOG(ERROR) << "Failed to process the sample.";
+    return false;
+  }
+  return true;
+}
+
+bool MP4MediaParser::AppendSampleToBatch(
+    uint32_t track_id,
+    const scoped_refptr<MediaSample>& sample) {
+  if (track_id != batch_track_id_ && !FlushSampleBatch())
+    return false;
+  batch_track_id_ = track_id;
+  batch_samples_.push_back(sample);
+  return true;
+}
+
+bool MP4MediaParser::FlushSampleBatch() {
+  if (batch_samples_.empty())
+    return true;
+  const bool result =
+      DeliverSampleBatch(batch_track_id_, batch_samples_, new_sample_cb_);
+  batch_samples_.clear();
+  return result;
+}
+
 bool MP4MediaParser::ReadAndDiscardMDATsUntil(const int64_t offset) {
   bool err = false;
   while (mdat_tail_ < offset) {
@@ -10,6 +10,7 @@
 #include <stdint.h>
 
 #include <map>
+#include <string>
 #include <vector>
 
 #include "packager/base/callback_forward.h"
@@ -52,6 +53,56 @@ class MP4MediaParser : public MediaParser {
   /// @return true if successful, false otherwise.
   bool LoadMoov(const std::string& file_path);
 
+  /// Restricts parsing to streams of the selected types. Unselected 'trak'
+  /// boxes are dropped when the 'moov' box is parsed, so their sample tables
+  /// are never materialized and their samples are never read, decrypted or
+  /// emitted; with seekable input the bytes they cover are skipped entirely.
+  /// Must be called before the 'moov' box is parsed.
+  /// @param audio selects audio streams.
+  /// @param video selects video streams.
+  void SelectStreamTypes(bool audio, bool video) {
+    select_audio_ = audio;
+    select_video_ = video;
+  }
+
+  /// Restricts parsing to the given time range. Supported for non-fragmented
+  /// input only and must be called before the 'moov' box is parsed. Sample
+  /// runs outside the range are dropped, and NextRequiredPosition() lets the
+  /// caller seek over the input bytes no retained sample covers.
+  /// @param start_seconds is the start of the range, in seconds.
+  /// @param end_seconds is the end of the range, in seconds. Must be greater
+  ///        than @a start_seconds.
+  void SetClipRange(double start_seconds, double end_seconds);
+
+  /// Only meaningful after SetClipRange(). Given that all input bytes before
+  /// @a position have been fed to Parse(), returns @a position when parsing
+  /// must continue sequentially, a larger offset when the bytes in between
+  /// are not covered by any retained sample, or -1 when every sample in the
+  /// clip range has been emitted and no further input is needed. To act on a
+  /// returned offset, seek the input source there and confirm with SkipTo();
+  /// callers that cannot seek may keep feeding sequentially instead.
+  int64_t NextRequiredPosition(int64_t position);
+
+  /// Declares that the input bytes before @a position will never be fed to
+  /// Parse(): the next Parse() buffer starts at @a position. Only valid for
+  /// offsets previously returned by NextRequiredPosition().
+  void SkipTo(int64_t position);
+
+  /// Persists the parsed sample table state of non-fragmented input to the
+  /// sidecar file at @a index_path, and loads it back on later runs instead
+  /// of walking the sample tables again. The sidecar is validated against
+  /// the size and mtime of the source file at @a source_path and is ignored
+  /// - then rewritten - when they do not match, so a changed source can
+  /// never serve stale tables. Best effort: any read or write failure falls
+  /// back to a normal parse. The sidecar describes the full parse, so it is
+  /// not used when a clip range or stream type selection is active. Must be
+  /// called before the 'moov' box is parsed.
+  void SetParseIndexPath(const std::string& index_path,
+                         const std::string& source_path) {
+    parse_index_path_ = index_path;
+    parse_index_source_path_ = source_path;
+  }
+
  private:
   enum State {
     kWaitingForInit,
@@ -67,6 +118,15 @@ class MP4MediaParser : public MediaParser {
   bool FetchKeysIfNecessary(
       const std::vector<ProtectionSystemSpecificHeader>& headers);
 
+  // Parse index sidecar support; see SetParseIndexPath(). Stats the source
+  // file for the validation fields; returns 'false' if it cannot be statted.
+  bool GetParseIndexSourceInfo(int64_t* source_size, int64_t* source_mtime);
+  // Sets up |runs_| from the sidecar. Returns 'false' - leaving |runs_| in a
+  // freshly constructed state - if the sidecar is missing, stale or corrupt.
+  bool LoadParseIndex();
+  // Writes the sidecar from the state built by a full parse. Best effort.
+  void WriteParseIndex();
+
   // To retain proper framing, each 'mdat' box must be read; to limit memory
   // usage, the box's data needs to be discarded incrementally as frames are
   // extracted from the stream. This function discards data from the stream up
@@ -81,6 +141,27 @@ class MP4MediaParser : public MediaParser {
 
   bool EnqueueSample(bool* err);
 
+  // Waits for the asynchronous decryption of |pending_decrypt_sample_|, if
+  // any, and pushes the sample downstream. Returns 'false' if the decryption
+  // failed or the sample was not accepted.
+  bool EmitPendingSample();
+
+  // Joins the in-flight decryption of |pending_decrypt_sample_|, if any, and
+  // drops the sample without emitting it. The decryption writes into the
+  // sample buffer, so the sample must not be released - on reset or
+  // destruction - while the job may still be running.
+  void DiscardPendingDecryptSample();
+
+  // Appends |sample| to the current per-track batch, delivering the previous
+  // batch first when |track_id| differs. Returns 'false' if the delivered
+  // batch was not accepted.
+  bool AppendSampleToBatch(uint32_t track_id,
+                           const scoped_refptr<MediaSample>& sample);
+
+  // Delivers the pending sample batch, if any. Returns 'false' if the batch
+  // was not accepted.
+  bool FlushSampleBatch();
+
   void Reset();
 
   State state_;
@@ -104,6 +185,35 @@ class MP4MediaParser : public MediaParser {
   scoped_ptr<Movie> moov_;
   scoped_ptr<TrackRunIterator> runs_;
 
+  // The sample being decrypted on the DecryptorSource decryption thread. It
+  // is held back until the next sample is ready (or the parser is flushed),
+  // overlapping decryption with parsing.
+  scoped_refptr<MediaSample> pending_decrypt_sample_;
+  uint32_t pending_decrypt_track_id_;
+
+  // The current contiguous per-track sample batch, delivered as a whole when
+  // the track changes, the run set of the current movie fragment is
+  // exhausted, or the parser is flushed. See AppendSampleToBatch().
+  uint32_t batch_track_id_;
+  std::vector<scoped_refptr<MediaSample> > batch_samples_;
+
+  // Clip range; see SetClipRange(). |clip_range_applied_| is set once the
+  // range has been applied to |runs_|, which happens only for non-fragmented
+  // input. Box framing is not tracked across clip skips, so sample emission
+  // then relies solely on the absolute offsets from the 'moov' box.
+  bool has_clip_range_;
+  double clip_start_seconds_;
+  double clip_end_seconds_;
+  bool clip_range_applied_;
+
+  // Stream type selection; see SelectStreamTypes().
+  bool select_audio_;
+  bool select_video_;
+
+  // Parse index sidecar; see SetParseIndexPath().
+  std::string parse_index_path_;
+  std::string parse_index_source_path_;
+
   DISALLOW_COPY_AND_ASSIGN(MP4MediaParser);
 };
 
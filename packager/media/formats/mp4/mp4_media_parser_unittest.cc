@@ -8,6 +8,7 @@
 #include <gtest/gtest.h>
 
 #include "packager/base/bind.h"
+#include "packager/base/files/file_util.h"
 #include "packager/base/logging.h"
 #include "packager/media/base/fixed_key_source.h"
 #include "packager/media/base/media_sample.h"
@@ -182,12 +183,47 @@ TEST_F(MP4MediaParserTest, MultiFragmentAppend) {
   EXPECT_EQ(201u, num_samples_);
 }
 
+TEST_F(MP4MediaParserTest, AudioOnlyStreamTypeSelection) {
+  parser_->SelectStreamTypes(true, false);
+  EXPECT_TRUE(ParseMP4File("bear-640x360-av_frag.mp4", 512));
+  ASSERT_EQ(1u, num_streams_);
+  EXPECT_EQ(kStreamAudio, stream_map_.begin()->second->stream_type());
+  // Only the audio samples of the 201 total are emitted.
+  EXPECT_GT(num_samples_, 0u);
+  EXPECT_LT(num_samples_, 201u);
+}
+
 TEST_F(MP4MediaParserTest, TrailingMoov) {
   EXPECT_TRUE(ParseMP4File("bear-640x360-trailing-moov.mp4", 1024));
   EXPECT_EQ(2u, num_streams_);
   EXPECT_EQ(201u, num_samples_);
 }
 
+TEST_F(MP4MediaParserTest, ParseIndexSidecarRoundTrip) {
+  base::FilePath index_path;
+  ASSERT_TRUE(base::CreateTemporaryFile(&index_path));
+  const std::string source = GetTestDataFilePath("bear-640x360.mp4").value();
+
+  // First run: the pre-existing empty file is rejected as an index, a full
+  // parse runs and the sidecar is written.
+  parser_->SetParseIndexPath(index_path.value(), source);
+  EXPECT_TRUE(ParseMP4File("bear-640x360.mp4", 512));
+  const size_t num_samples = num_samples_;
+  EXPECT_NE(0u, num_samples);
+  int64_t index_size = 0;
+  ASSERT_TRUE(base::GetFileSize(index_path, &index_size));
+  EXPECT_LT(0, index_size);
+
+  // Second run: the sample tables load from the sidecar and the same samples
+  // are emitted.
+  parser_.reset(new MP4MediaParser());
+  parser_->SetParseIndexPath(index_path.value(), source);
+  EXPECT_TRUE(ParseMP4File("bear-640x360.mp4", 512));
+  EXPECT_EQ(num_samples, num_samples_);
+
+  base::DeleteFile(index_path, false);
+}
+
 TEST_F(MP4MediaParserTest, Flush) {
   // Flush while reading sample data, then start a new stream.
   InitializeParser(NULL);
@@ -227,6 +263,47 @@ TEST_F(MP4MediaParserTest, NON_FRAGMENTED_MP4) {
   EXPECT_EQ(201u, num_samples_);
 }
 
+TEST_F(MP4MediaParserTest, KeyFrameIndexFromSyncSampleTable) {
+  EXPECT_TRUE(ParseMP4File("bear-640x360.mp4", 512));
+  const VideoStreamInfo* video = NULL;
+  for (StreamMap::const_iterator iter = stream_map_.begin();
+       iter != stream_map_.end(); ++iter) {
+    if (iter->second->stream_type() == kStreamVideo)
+      video = static_cast<const VideoStreamInfo*>(iter->second.get());
+  }
+  ASSERT_TRUE(video);
+  ASSERT_TRUE(video->has_key_frame_index());
+
+  // The stream starts with a key frame.
+  int64_t timestamp = 0;
+  EXPECT_TRUE(video->FindNextKeyFrameTimestamp(-1, &timestamp));
+  EXPECT_EQ(0, timestamp);
+
+  // The index is strictly increasing and the lookups are consistent.
+  int64_t previous = timestamp;
+  while (video->FindNextKeyFrameTimestamp(previous, &timestamp)) {
+    EXPECT_GT(timestamp, previous);
+    int64_t at_or_before = 0;
+    EXPECT_TRUE(video->FindKeyFrameTimestampAtOrBefore(timestamp,
+                                                       &at_or_before));
+    EXPECT_EQ(timestamp, at_or_before);
+    previous = timestamp;
+  }
+  EXPECT_FALSE(video->FindKeyFrameTimestampAtOrBefore(-1, &timestamp));
+
+  // Fragmented input has no upfront sample tables, so no index is built.
+  parser_.reset(new MP4MediaParser());
+  stream_map_.clear();
+  EXPECT_TRUE(ParseMP4File("bear-640x360-av_frag.mp4", 512));
+  for (StreamMap::const_iterator iter = stream_map_.begin();
+       iter != stream_map_.end(); ++iter) {
+    if (iter->second->stream_type() != kStreamVideo)
+      continue;
+    EXPECT_FALSE(static_cast<const VideoStreamInfo*>(iter->second.get())
+                     ->has_key_frame_index());
+  }
+}
+
 TEST_F(MP4MediaParserTest, CencWithoutDecryptionSource) {
   // Parsing should fail but it will get the streams successfully.
   EXPECT_FALSE(ParseMP4File("bear-640x360-v_frag-cenc-aux.mp4", 512));
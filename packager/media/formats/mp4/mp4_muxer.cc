@@ -152,7 +152,8 @@ Status MP4Muxer::Initialize() {
   const Status segmenter_initialized = segmenter_->Initialize(
       streams(), muxer_listener(), progress_listener(), encryption_key_source(),
       max_sd_pixels(), clear_lead_in_seconds(),
-      crypto_period_duration_in_seconds(), protection_scheme());
+      crypto_period_duration_in_seconds(), protection_scheme(),
+      runtime_config());
 
   if (!segmenter_initialized.ok())
     return segmenter_initialized;
@@ -225,7 +226,13 @@ void MP4Muxer::GenerateVideoTrak(const VideoStreamInfo* video_info,
   trak->header.width = video_info->width() * sample_aspect_ratio * 0x10000;
   trak->header.height = video_info->height() * 0x10000;
 
-  VideoSampleEntry video;
+  SampleDescription& sample_description =
+      trak->media.information.sample_table.description;
+  sample_description.type = kVideo;
+  // Construct the entry in place to avoid deep-copying the codec
+  // configuration again on insertion.
+  sample_description.video_entries.resize(1);
+  VideoSampleEntry& video = sample_description.video_entries.back();
   video.format = VideoCodecToFourCC(video_info->codec());
   video.width = video_info->width();
   video.height = video_info->height();
@@ -234,11 +241,6 @@ void MP4Muxer::GenerateVideoTrak(const VideoStreamInfo* video_info,
     video.pixel_aspect.h_spacing = pixel_width;
     video.pixel_aspect.v_spacing = pixel_height;
   }
-
-  SampleDescription& sample_description =
-      trak->media.information.sample_table.description;
-  sample_description.type = kVideo;
-  sample_description.video_entries.push_back(video);
 }
 
 void MP4Muxer::GenerateAudioTrak(const AudioStreamInfo* audio_info,
@@ -248,7 +250,13 @@ void MP4Muxer::GenerateAudioTrak(const AudioStreamInfo* audio_info,
 
   trak->header.volume = 0x100;
 
-  AudioSampleEntry audio;
+  SampleTable& sample_table = trak->media.information.sample_table;
+  SampleDescription& sample_description = sample_table.description;
+  sample_description.type = kAudio;
+  // Construct the entry in place to avoid deep-copying the codec
+  // configuration again on insertion.
+  sample_description.audio_entries.resize(1);
+  AudioSampleEntry& audio = sample_description.audio_entries.back();
   audio.format = AudioCodecToFourCC(audio_info->codec());
   switch(audio_info->codec()){
     case kCodecAAC:
@@ -287,10 +295,6 @@ void MP4Muxer::GenerateAudioTrak(const AudioStreamInfo* audio_info,
   audio.channelcount = audio_info->num_channels();
   audio.samplesize = audio_info->sample_bits();
   audio.samplerate = audio_info->sampling_frequency();
-  SampleTable& sample_table = trak->media.information.sample_table;
-  SampleDescription& sample_description = sample_table.description;
-  sample_description.type = kAudio;
-  sample_description.audio_entries.push_back(audio);
 
   // Opus requires at least one sample group description box and at least one
   // sample to group box with grouping type 'roll' within sample table box.
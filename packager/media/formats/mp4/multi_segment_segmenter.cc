@@ -6,12 +6,17 @@
 
 #include "packager/media/formats/mp4/multi_segment_segmenter.h"
 
+#include "packager/base/bind.h"
+#include "packager/base/location.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_util.h"
+#include "packager/base/threading/worker_pool.h"
 #include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/gather_buffer.h"
 #include "packager/media/base/media_stream.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/media/base/trace_span.h"
 #include "packager/media/event/muxer_listener.h"
 #include "packager/media/file/file.h"
 #include "packager/media/formats/mp4/box_definitions.h"
@@ -25,13 +30,39 @@ MultiSegmentSegmenter::MultiSegmentSegmenter(const MuxerOptions& options,
                                              scoped_ptr<Movie> moov)
     : Segmenter(options, ftyp.Pass(), moov.Pass()),
       styp_(new SegmentType),
-      num_segments_(0) {
+      // $Number$ rendering adds one to the index, so continuing at segment
+      // number N means starting the index at N - 1.
+      num_segments_(options.segment_start_number - 1),
+      chunked_segment_file_(NULL),
+      chunked_segment_size_(0),
+      chunked_segment_sidx_offset_(0),
+      chunked_segment_sidx_reserved_(0),
+      previous_segment_size_(0),
+      pending_segment_file_(NULL),
+      pending_segment_sidx_offset_(0),
+      pending_segment_start_time_(0),
+      pending_segment_duration_(0),
+      pending_segment_size_(0),
+      pending_segment_complete_(true),
+      has_pending_segment_write_(false),
+      pending_write_event_(false, false) {
   // Use the same brands for styp as ftyp.
   styp_->major_brand = Segmenter::ftyp()->major_brand;
   styp_->compatible_brands = Segmenter::ftyp()->compatible_brands;
 }
 
-MultiSegmentSegmenter::~MultiSegmentSegmenter() {}
+MultiSegmentSegmenter::~MultiSegmentSegmenter() {
+  // Don't leave a worker task running against freed state.
+  if (has_pending_segment_write_)
+    pending_write_event_.Wait();
+  // On error paths a chunked segment file may still be open.
+  if (chunked_segment_file_) {
+    if (!chunked_segment_file_->Close()) {
+      LOG(WARNING) << "Failed to close the file properly: "
+                   << chunked_segment_file_name_;
+    }
+  }
+}
 
 bool MultiSegmentSegmenter::GetInitRange(size_t* offset, size_t* size) {
   DLOG(INFO) << "MultiSegmentSegmenter outputs init segment: "
@@ -47,6 +78,12 @@ bool MultiSegmentSegmenter::GetIndexRange(size_t* offset, size_t* size) {
 Status MultiSegmentSegmenter::DoInitialize() {
   DCHECK(ftyp());
   DCHECK(moov());
+  if (options().mp4_stream_fragments && options().segment_template.empty()) {
+    LOG(WARNING) << "--mp4_stream_fragments requires segment_template; "
+                    "fragments will not be streamed out early.";
+  }
+  if (!options().segment_template.empty())
+    segment_name_template_.Compile(options().segment_template);
   // Generate the output file with init segment.
   File* file = File::Open(options().output_file_name.c_str(), "w");
   if (file == NULL) {
@@ -65,6 +102,9 @@ Status MultiSegmentSegmenter::DoInitialize() {
 }
 
 Status MultiSegmentSegmenter::DoFinalize() {
+  Status status = WaitForPendingSegmentWrite();
+  if (!status.ok())
+    return status;
   SetComplete();
   return Status::OK;
 }
@@ -77,6 +117,12 @@ Status MultiSegmentSegmenter::DoFinalizeSegment() {
   sidx()->earliest_presentation_time =
       sidx()->references[0].earliest_presentation_time;
 
+  if (options().mp4_stream_fragments && !options().segment_template.empty()) {
+    // Chunked output: earlier fragments of this segment were already flushed
+    // by DoFlushFragment(); write the last chunk and close the segment.
+    return WriteChunk(true);
+  }
+
   if (options().num_subsegments_per_sidx <= 0)
     return WriteSegment();
 
@@ -130,69 +176,292 @@ Status MultiSegmentSegmenter::DoFinalizeSegment() {
   return WriteSegment();
 }
 
+Status MultiSegmentSegmenter::DoFlushFragment() {
+  if (!options().mp4_stream_fragments || options().segment_template.empty())
+    return Status::OK;
+  return WriteChunk(false);
+}
+
 Status MultiSegmentSegmenter::WriteSegment() {
   DCHECK(sidx());
   DCHECK(fragment_buffer());
   DCHECK(styp_);
 
-  scoped_ptr<BufferWriter> buffer(new BufferWriter());
-  File* file;
+  // Collect the previous segment's write before starting a new one.
+  Status status = WaitForPendingSegmentWrite();
+  if (!status.ok())
+    return status;
+
+  scoped_ptr<BufferWriter> header_buffer(new BufferWriter());
   std::string file_name;
   if (options().segment_template.empty()) {
     // Append the segment to output file if segment template is not specified.
-    file_name = options().output_file_name.c_str();
-    file = File::Open(file_name.c_str(), "a");
-    if (file == NULL) {
-      return Status(
-          error::FILE_FAILURE,
-          "Cannot open file for append " + options().output_file_name);
-    }
+    file_name = options().output_file_name;
   } else {
-    file_name = GetSegmentName(options().segment_template,
-                               sidx()->earliest_presentation_time,
-                               num_segments_++, options().bandwidth);
-    file = File::Open(file_name.c_str(), "w");
-    if (file == NULL) {
-      return Status(error::FILE_FAILURE,
-                    "Cannot open file for write " + file_name);
-    }
-    styp_->Write(buffer.get());
+    file_name = segment_name_template_.GetSegmentName(
+        sidx()->earliest_presentation_time, num_segments_++,
+        options().bandwidth);
+    styp_->Write(header_buffer.get());
   }
 
   // If num_subsegments_per_sidx is negative, no SIDX box is generated.
   if (options().num_subsegments_per_sidx >= 0)
-    sidx()->Write(buffer.get());
+    sidx()->Write(header_buffer.get());
 
-  const size_t segment_size = buffer->Size() + fragment_buffer()->Size();
+  const size_t segment_size = header_buffer->Size() + fragment_buffer()->Size();
   DCHECK_NE(segment_size, 0u);
 
-  Status status = buffer->WriteToFile(file);
-  if (status.ok())
-    status = fragment_buffer()->WriteToFile(file);
-
-  if (!file->Close())
-    LOG(WARNING) << "Failed to close the file properly: " << file_name;
-
-  if (!status.ok())
-    return status;
-
   uint64_t segment_duration = 0;
   // ISO/IEC 23009-1:2012: the value shall be identical to sum of the the
   // values of all Subsegment_duration fields in the first ‘sidx’ box.
   for (size_t i = 0; i < sidx()->references.size(); ++i)
     segment_duration += sidx()->references[i].subsegment_duration;
 
-  UpdateProgress(segment_duration);
-  if (muxer_listener()) {
-    muxer_listener()->OnSampleDurationReady(sample_duration());
-    muxer_listener()->OnNewSegment(file_name,
-                                   sidx()->earliest_presentation_time,
-                                   segment_duration, segment_size);
+  // Hand the complete segment - including the file open, header and payload
+  // writes and the close - to a background task, so the muxer thread starts
+  // on the next fragment immediately. The progress update and listener
+  // events are deferred until the write has been collected.
+  pending_segment_header_buffer_ = header_buffer.Pass();
+  pending_segment_buffer_.reset(new GatherBuffer());
+  pending_segment_buffer_->Swap(fragment_buffer());
+  pending_segment_file_name_ = file_name;
+  pending_segment_start_time_ = sidx()->earliest_presentation_time;
+  pending_segment_duration_ = segment_duration;
+  pending_segment_size_ = segment_size;
+  pending_segment_complete_ = true;
+  has_pending_segment_write_ = true;
+  base::WorkerPool::PostTask(
+      FROM_HERE, base::Bind(&MultiSegmentSegmenter::WriteSegmentTask,
+                            base::Unretained(this)),
+      true /* task_is_slow */);
+  return Status::OK;
+}
+
+void MultiSegmentSegmenter::WriteSegmentTask() {
+  TRACE_SPAN("mux", "MultiSegmentSegmenter::WriteSegment");
+  const bool append = options().segment_template.empty();
+  Status status;
+  File* file =
+      File::Open(pending_segment_file_name_.c_str(), append ? "a" : "w");
+  if (file == NULL) {
+    status = Status(
+        error::FILE_FAILURE,
+        std::string(append ? "Cannot open file for append "
+                           : "Cannot open file for write ") +
+            pending_segment_file_name_);
+  } else {
+    if (!append) {
+      // The segment is fully buffered, so its final size is known exactly;
+      // let the file pre-allocate it as one extent.
+      file->SetFileSizeHint(pending_segment_header_buffer_->Size() +
+                            pending_segment_buffer_->Size());
+    }
+    status = pending_segment_header_buffer_->WriteToFile(file);
+    if (status.ok())
+      status = pending_segment_buffer_->WriteToFile(file);
+    if (!file->Close()) {
+      LOG(WARNING) << "Failed to close the file properly: "
+                   << pending_segment_file_name_;
+    }
   }
+  pending_segment_status_ = status;
+  pending_write_event_.Signal();
+}
+
+Status MultiSegmentSegmenter::WriteChunk(bool is_last_chunk_in_segment) {
+  DCHECK(fragment_buffer());
+  DCHECK(styp_);
+
+  // Chunk writes to the segment file must stay ordered, so collect the
+  // previous write before issuing the next one.
+  Status status = WaitForPendingSegmentWrite();
+  if (!status.ok())
+    return status;
 
+  if (chunked_segment_file_ == NULL) {
+    DCHECK(!sidx()->references.empty());
+    chunked_segment_file_name_ = segment_name_template_.GetSegmentName(
+        sidx()->references[0].earliest_presentation_time, num_segments_++,
+        options().bandwidth);
+    chunked_segment_file_ = File::Open(chunked_segment_file_name_.c_str(), "w");
+    if (chunked_segment_file_ == NULL) {
+      return Status(error::FILE_FAILURE,
+                    "Cannot open file for write " + chunked_segment_file_name_);
+    }
+    // The segment's size is unknown until its last chunk, but segments at a
+    // given bitrate are close in size; pre-allocate using the previous
+    // segment as the estimate. The first segment grows incrementally.
+    if (previous_segment_size_ > 0)
+      chunked_segment_file_->SetFileSizeHint(previous_segment_size_);
+    // 'styp' is emitted once, at the head of the segment. It is small, so
+    // write it synchronously.
+    BufferWriter styp_buffer;
+    styp_->Write(&styp_buffer);
+    chunked_segment_sidx_offset_ = styp_buffer.Size();
+    chunked_segment_sidx_reserved_ = 0;
+    if (options().num_subsegments_per_sidx >= 0) {
+      // Reserve room for the segment's sidx as a zeroed free box; it is
+      // patched in place when the last chunk's write completes.
+      const uint64_t reserved = EstimateSegmentSidxSize();
+      styp_buffer.AppendInt(static_cast<uint32_t>(reserved));
+      styp_buffer.AppendInt(static_cast<uint32_t>(FOURCC_free));
+      styp_buffer.AppendVector(std::vector<uint8_t>(reserved - 8, 0));
+      chunked_segment_sidx_reserved_ = reserved;
+    }
+    chunked_segment_size_ = styp_buffer.Size();
+    status = styp_buffer.WriteToFile(chunked_segment_file_);
+    if (!status.ok()) {
+      if (!chunked_segment_file_->Close()) {
+        LOG(WARNING) << "Failed to close the file properly: "
+                     << chunked_segment_file_name_;
+      }
+      chunked_segment_file_ = NULL;
+      return status;
+    }
+  }
+  chunked_segment_size_ += fragment_buffer()->Size();
+
+  pending_segment_buffer_.reset(new GatherBuffer());
+  pending_segment_buffer_->Swap(fragment_buffer());
+  pending_segment_file_ = chunked_segment_file_;
+  pending_segment_file_name_ = chunked_segment_file_name_;
+  pending_segment_complete_ = is_last_chunk_in_segment;
+  if (is_last_chunk_in_segment) {
+    if (chunked_segment_sidx_reserved_ > 0) {
+      pending_segment_sidx_buffer_ = BuildChunkedSegmentSidx();
+      pending_segment_sidx_offset_ = chunked_segment_sidx_offset_;
+    }
+    uint64_t segment_duration = 0;
+    // ISO/IEC 23009-1:2012: the value shall be identical to sum of the the
+    // values of all Subsegment_duration fields in the first ‘sidx’ box.
+    for (size_t i = 0; i < sidx()->references.size(); ++i)
+      segment_duration += sidx()->references[i].subsegment_duration;
+    pending_segment_start_time_ = sidx()->earliest_presentation_time;
+    pending_segment_duration_ = segment_duration;
+    pending_segment_size_ = chunked_segment_size_;
+    previous_segment_size_ = chunked_segment_size_;
+    // The pending write owns the file now; OnSegmentWritten() closes it.
+    chunked_segment_file_ = NULL;
+    chunked_segment_size_ = 0;
+  } else {
+    // Progress and listener events are reported once per segment, when the
+    // last chunk is collected.
+    pending_segment_duration_ = 0;
+  }
+  has_pending_segment_write_ = true;
+  if (pending_segment_buffer_->Size() == 0) {
+    // Nothing to write; complete inline.
+    OnSegmentWritten(0);
+  } else {
+    pending_segment_buffer_->WriteToFileAsync(
+        pending_segment_file_,
+        base::Bind(&MultiSegmentSegmenter::OnSegmentWritten,
+                   base::Unretained(this)));
+  }
+  return Status::OK;
+}
+
+uint64_t MultiSegmentSegmenter::EstimateSegmentSidxSize() {
+  // One reference per expected fragment plus headroom: fragments can end up
+  // shorter than requested, and the reservation is per segment, so slack is
+  // cheap. The headroom also covers a version 1 sidx, which ComputeSize()
+  // below does not account for.
+  size_t max_references = 16;
+  if (options().fragment_duration > 0) {
+    max_references += 2 * static_cast<size_t>(options().segment_duration /
+                                                  options().fragment_duration +
+                                              1);
+  }
+  SegmentIndex sidx;
+  sidx.references.resize(max_references);
+  // Room for a trailing free box header when the actual sidx is smaller.
+  return sidx.ComputeSize() + 8;
+}
+
+scoped_ptr<BufferWriter> MultiSegmentSegmenter::BuildChunkedSegmentSidx() {
+  DCHECK(sidx());
+  DCHECK_GT(chunked_segment_sidx_reserved_, 0u);
+  sidx()->first_offset = 0;
+  scoped_ptr<BufferWriter> buffer(new BufferWriter());
+  sidx()->Write(buffer.get());
+  const uint64_t sidx_size = buffer->Size();
+  const uint64_t reserved = chunked_segment_sidx_reserved_;
+  // A gap, if any, must be large enough to hold a free box header.
+  if (sidx_size > reserved ||
+      (sidx_size != reserved && sidx_size + 8 > reserved)) {
+    LOG(WARNING) << "The sidx (" << sidx_size << " bytes) does not fit in the "
+                 << "reserved area (" << reserved << " bytes) of segment "
+                 << chunked_segment_file_name_ << "; leaving it unindexed.";
+    return scoped_ptr<BufferWriter>();
+  }
+  if (sidx_size < reserved) {
+    // Re-serialize with first_offset spanning the free box gap, so the
+    // references resolve to the media data without parsing past it. The
+    // offset is small, so the box size does not change.
+    sidx()->first_offset = reserved - sidx_size;
+    buffer.reset(new BufferWriter());
+    sidx()->Write(buffer.get());
+    DCHECK_EQ(sidx_size, static_cast<uint64_t>(buffer->Size()));
+    buffer->AppendInt(static_cast<uint32_t>(reserved - sidx_size));
+    buffer->AppendInt(static_cast<uint32_t>(FOURCC_free));
+    // The rest of the gap on disk is already zeroed free box payload.
+  }
+  return buffer.Pass();
+}
+
+Status MultiSegmentSegmenter::WaitForPendingSegmentWrite() {
+  if (!has_pending_segment_write_)
+    return Status::OK;
+  pending_write_event_.Wait();
+  has_pending_segment_write_ = false;
+  pending_segment_header_buffer_.reset();
+  pending_segment_buffer_.reset();
+  pending_segment_sidx_buffer_.reset();
+
+  Status status = pending_segment_status_;
+  if (!status.ok())
+    return status;
+
+  UpdateProgress(pending_segment_duration_);
+  if (muxer_listener() && pending_segment_complete_) {
+    muxer_listener()->OnSampleDurationReady(sample_duration());
+    muxer_listener()->OnNewSegment(pending_segment_file_name_,
+                                   pending_segment_start_time_,
+                                   pending_segment_duration_,
+                                   pending_segment_size_);
+  }
   return Status::OK;
 }
 
+void MultiSegmentSegmenter::OnSegmentWritten(int64_t result) {
+  Status status;
+  if (result < 0) {
+    status = Status(error::FILE_FAILURE,
+                    "Cannot write segment " + pending_segment_file_name_);
+  }
+  // Patch the sidx into its reservation before the segment file is closed.
+  if (status.ok() && pending_segment_complete_ && pending_segment_sidx_buffer_) {
+    if (!pending_segment_file_->Seek(pending_segment_sidx_offset_)) {
+      status = Status(error::FILE_FAILURE,
+                      "Cannot seek to patch sidx in " +
+                          pending_segment_file_name_);
+    } else {
+      status =
+          pending_segment_sidx_buffer_->WriteToFile(pending_segment_file_);
+    }
+  }
+  // Intermediate chunk writes leave the segment file open for the next chunk.
+  if (pending_segment_complete_) {
+    if (!pending_segment_file_->Close()) {
+      LOG(WARNING) << "Failed to close the file properly: "
+                   << pending_segment_file_name_;
+    }
+    pending_segment_file_ = NULL;
+  }
+  pending_segment_status_ = status;
+  pending_write_event_.Signal();
+}
+
 }  // namespace mp4
 }  // namespace media
 }  // namespace shaka
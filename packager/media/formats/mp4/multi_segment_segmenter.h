@@ -7,6 +7,10 @@
 #ifndef MEDIA_FORMATS_MP4_MULTI_SEGMENT_SEGMENTER_H_
 #define MEDIA_FORMATS_MP4_MULTI_SEGMENT_SEGMENTER_H_
 
+#include <string>
+
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/media/base/muxer_util.h"
 #include "packager/media/formats/mp4/segmenter.h"
 
 namespace shaka {
@@ -46,12 +50,89 @@ class MultiSegmentSegmenter : public Segmenter {
   Status DoInitialize() override;
   Status DoFinalize() override;
   Status DoFinalizeSegment() override;
+  Status DoFlushFragment() override;
 
-  // Write segment to file.
+  // Write segment to file. The whole segment completion - file open, header
+  // and payload writes and close - is handed to a background task, so the
+  // next fragment's processing overlaps with the disk drain; the result is
+  // collected by WaitForPendingSegmentWrite() at the next segment boundary
+  // or at finalization.
   Status WriteSegment();
 
+  // Body of the background segment write issued by WriteSegment(). Runs on a
+  // worker thread and signals |pending_write_event_| when done.
+  void WriteSegmentTask();
+
+  // Write the buffered fragment as a chunk of the currently open segment
+  // file in chunked (low-latency) output mode, opening the file and emitting
+  // 'styp' if this is the first chunk of the segment. If
+  // @a is_last_chunk_in_segment is true, the file is closed and the muxer
+  // listener is notified once the write completes. The 'sidx' cannot be
+  // written up front in this mode - the index must precede data, but
+  // reference sizes are only known when the segment completes - so space is
+  // reserved for it as a zeroed 'free' box after 'styp' and patched in place
+  // when the last chunk's write completes, without re-reading the segment.
+  Status WriteChunk(bool is_last_chunk_in_segment);
+
+  // Size in bytes to reserve for a segment's 'sidx' in chunked output mode:
+  // one reference per expected fragment plus headroom.
+  uint64_t EstimateSegmentSidxSize();
+
+  // Serialize the current 'sidx', padded with a 'free' box header to exactly
+  // fill the reserved area. Returns NULL - leaving the reservation as a
+  // plain 'free' box - if the sidx outgrew the reservation.
+  scoped_ptr<BufferWriter> BuildChunkedSegmentSidx();
+
+  // Collect the result of the in-flight segment write, if any, and emit the
+  // deferred progress update and muxer listener events for it.
+  Status WaitForPendingSegmentWrite();
+
+  // Completion callback for the asynchronous segment write. Runs on a
+  // worker thread.
+  void OnSegmentWritten(int64_t result);
+
   scoped_ptr<SegmentType> styp_;
   uint32_t num_segments_;
+  // Segment name template compiled once at initialization; segment names
+  // are rendered from it for every segment.
+  SegmentNameTemplate segment_name_template_;
+
+  // State of the segment currently open in chunked output mode. The file
+  // stays open across chunk writes and is handed to the pending write when
+  // the last chunk of the segment is issued.
+  File* chunked_segment_file_;
+  std::string chunked_segment_file_name_;
+  size_t chunked_segment_size_;
+  // Byte offset and size of the 'sidx' reservation in the open chunked
+  // segment file; a size of 0 means no sidx is emitted.
+  uint64_t chunked_segment_sidx_offset_;
+  uint64_t chunked_segment_sidx_reserved_;
+  // Total size of the last completed chunked segment; used as the
+  // pre-allocation hint for the next segment's file. 0 until a segment
+  // completes.
+  uint64_t previous_segment_size_;
+
+  // State of the in-flight asynchronous segment write. Written by
+  // WriteSegment() before the write is issued and by OnSegmentWritten()
+  // before |pending_write_event_| is signalled; read after the wait.
+  File* pending_segment_file_;
+  scoped_ptr<BufferWriter> pending_segment_header_buffer_;
+  scoped_ptr<GatherBuffer> pending_segment_buffer_;
+  std::string pending_segment_file_name_;
+  // Patched into the segment file at |pending_segment_sidx_offset_| before
+  // the file is closed. NULL if there is nothing to patch.
+  scoped_ptr<BufferWriter> pending_segment_sidx_buffer_;
+  uint64_t pending_segment_sidx_offset_;
+  uint64_t pending_segment_start_time_;
+  uint64_t pending_segment_duration_;
+  size_t pending_segment_size_;
+  // Whether the in-flight write completes a segment. False only for
+  // intermediate chunk writes in chunked output mode, which neither close
+  // the file nor trigger listener events.
+  bool pending_segment_complete_;
+  Status pending_segment_status_;
+  bool has_pending_segment_write_;
+  base::WaitableEvent pending_write_event_;
 
   DISALLOW_COPY_AND_ASSIGN(MultiSegmentSegmenter);
 };
@@ -12,6 +12,7 @@
 #include "packager/base/stl_util.h"
 #include "packager/media/base/aes_cryptor.h"
 #include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/gather_buffer.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/media_stream.h"
@@ -152,7 +153,7 @@ Segmenter::Segmenter(const MuxerOptions& options,
       ftyp_(ftyp.Pass()),
       moov_(moov.Pass()),
       moof_(new MovieFragment()),
-      fragment_buffer_(new BufferWriter()),
+      fragment_buffer_(new GatherBuffer()),
       sidx_(new SegmentIndex()),
       muxer_listener_(NULL),
       progress_listener_(NULL),
@@ -169,7 +170,8 @@ Status Segmenter::Initialize(const std::vector<MediaStream*>& streams,
                              uint32_t max_sd_pixels,
                              double clear_lead_in_seconds,
                              double crypto_period_duration_in_seconds,
-                             FourCC protection_scheme) {
+                             FourCC protection_scheme,
+                             RuntimeConfig* runtime_config) {
   DCHECK_LT(0u, streams.size());
   muxer_listener_ = muxer_listener;
   progress_listener_ = progress_listener;
@@ -219,13 +221,16 @@ Status Segmenter::Initialize(const std::vector<MediaStream*>& streams,
             encryption_key.iv, encryption_key.key_system_info);
       }
 
-      fragmenters_[i] = new KeyRotationFragmenter(
+      KeyRotationFragmenter* fragmenter = new KeyRotationFragmenter(
           moof_.get(), streams[i]->info(), &moof_->tracks[i],
           encryption_key_source, track_type,
           crypto_period_duration_in_seconds * streams[i]->info()->time_scale(),
           clear_lead_in_seconds * streams[i]->info()->time_scale(),
           protection_scheme, pattern.crypt_byte_block, pattern.skip_byte_block,
           muxer_listener_);
+      fragmenter->set_num_encryption_threads(options_.num_encryption_threads);
+      fragmenter->set_runtime_config(runtime_config);
+      fragmenters_[i] = fragmenter;
       continue;
     }
 
@@ -247,7 +252,8 @@ Status Segmenter::Initialize(const std::vector<MediaStream*>& streams,
     if (moov_->pssh.empty()) {
       moov_->pssh.resize(encryption_key->key_system_info.size());
       for (size_t i = 0; i < encryption_key->key_system_info.size(); i++) {
-        moov_->pssh[i].raw_box = encryption_key->key_system_info[i].CreateBox();
+        moov_->pssh[i].raw_box =
+            encryption_key->key_system_info[i].CreateBoxShared()->bytes();
       }
 
       if (muxer_listener_) {
@@ -257,11 +263,13 @@ Status Segmenter::Initialize(const std::vector<MediaStream*>& streams,
       }
     }
 
-    fragmenters_[i] = new EncryptingFragmenter(
+    EncryptingFragmenter* fragmenter = new EncryptingFragmenter(
         streams[i]->info(), &moof_->tracks[i], encryption_key.Pass(),
         clear_lead_in_seconds * streams[i]->info()->time_scale(),
         protection_scheme, pattern.crypt_byte_block, pattern.skip_byte_block,
         muxer_listener_);
+    fragmenter->set_num_encryption_threads(options_.num_encryption_threads);
+    fragmenters_[i] = fragmenter;
   }
 
   if (options_.mp4_use_decoding_timestamp_in_timeline) {
@@ -345,12 +353,49 @@ Status Segmenter::AddSample(const MediaStream* stream,
     }
   }
   bool finalize_segment = false;
+  const int64_t target_segment_duration =
+      options_.segment_duration * stream->info()->time_scale();
   if (segment_durations_[stream_id] >=
-      options_.segment_duration * stream->info()->time_scale()) {
+      static_cast<uint64_t>(target_segment_duration)) {
     if (sample->is_key_frame() || !options_.segment_sap_aligned) {
       finalize_segment = true;
       finalize_fragment = true;
     }
+  } else if (sample->is_key_frame() && options_.segment_sap_aligned &&
+             segment_durations_[stream_id] > 0) {
+    // The segment has not reached the target duration, but with variable GOPs
+    // the GOP starting at this key frame may blow far past it; the whole
+    // segment is buffered in memory, so oversized segments cost peak RSS and
+    // flush latency too. When the parser built a key frame index for the
+    // stream, look the next key frame up there; otherwise peek at the staged
+    // samples (threaded push mode). Cut here if that leaves the segment
+    // closer to the target than cutting there would.
+    int64_t next_key_frame_timestamp = 0;
+    bool have_next_key_frame = false;
+    if (stream->info()->stream_type() == kStreamVideo) {
+      const VideoStreamInfo* video_info =
+          static_cast<const VideoStreamInfo*>(stream->info().get());
+      if (video_info->has_key_frame_index()) {
+        have_next_key_frame = video_info->FindNextKeyFrameTimestamp(
+            sample->dts(), &next_key_frame_timestamp);
+      }
+    }
+    if (!have_next_key_frame) {
+      have_next_key_frame =
+          stream->PeekNextKeyFrameTimestamp(&next_key_frame_timestamp);
+    }
+    if (have_next_key_frame) {
+      const int64_t gop_duration = next_key_frame_timestamp - sample->dts();
+      const int64_t current_duration =
+          static_cast<int64_t>(segment_durations_[stream_id]);
+      const int64_t undershoot = target_segment_duration - current_duration;
+      const int64_t overshoot =
+          current_duration + gop_duration - target_segment_duration;
+      if (gop_duration > 0 && overshoot > undershoot) {
+        finalize_segment = true;
+        finalize_fragment = true;
+      }
+    }
   }
 
   Status status;
@@ -406,6 +451,10 @@ void Segmenter::SetComplete() {
   progress_listener_->OnProgress(1.0);
 }
 
+Status Segmenter::DoFlushFragment() {
+  return Status::OK;
+}
+
 Status Segmenter::FinalizeSegment() {
   Status status = DoFinalizeSegment();
 
@@ -425,7 +474,9 @@ uint32_t Segmenter::GetReferenceStreamId() {
 
 Status Segmenter::FinalizeFragment(bool finalize_segment,
                                    Fragmenter* fragmenter) {
-  fragmenter->FinalizeFragment();
+  Status status = fragmenter->FinalizeFragment();
+  if (!status.ok())
+    return status;
 
   // Check if all tracks are ready for fragmentation.
   for (std::vector<Fragmenter*>::iterator it = fragmenters_.begin();
@@ -456,7 +507,7 @@ Status Segmenter::FinalizeFragment(bool finalize_segment,
           sizeof(uint32_t);  // for sample count field in 'senc'
     }
     traf.runs[0].data_offset = data_offset + mdat.data_size;
-    mdat.data_size += fragmenters_[i]->data()->Size();
+    mdat.data_size += fragmenters_[i]->samples_size();
   }
 
   // Generate segment reference.
@@ -466,11 +517,18 @@ Status Segmenter::FinalizeFragment(bool finalize_segment,
   sidx_->references[sidx_->references.size() - 1].referenced_size =
       data_offset + mdat.data_size;
 
-  // Write the fragment to buffer.
-  moof_->Write(fragment_buffer_.get());
-  mdat.WriteHeader(fragment_buffer_.get());
-  for (Fragmenter* fragmenter : fragmenters_)
-    fragment_buffer_->AppendBuffer(*fragmenter->data());
+  // Write the fragment to buffer. Box sizes were already computed above when
+  // deriving |data_offset|; the offset fixups since then are size neutral, so
+  // skip the second box tree walk.
+  moof_->WriteUsingComputedSize(fragment_buffer_->writer());
+  mdat.WriteHeader(fragment_buffer_->writer());
+  // Gather the sample payloads by reference; the bytes are not copied into
+  // the fragment buffer, they are written straight from the samples when the
+  // segment is written out.
+  for (Fragmenter* fragmenter : fragmenters_) {
+    for (const scoped_refptr<MediaSample>& sample : fragmenter->samples())
+      fragment_buffer_->AppendSample(sample);
+  }
 
   // Increase sequence_number for next fragment.
   ++moof_->header.sequence_number;
@@ -478,7 +536,7 @@ Status Segmenter::FinalizeFragment(bool finalize_segment,
   if (finalize_segment)
     return FinalizeSegment();
 
-  return Status::OK;
+  return DoFlushFragment();
 }
 
 }  // namespace mp4
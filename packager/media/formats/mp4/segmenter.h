@@ -22,11 +22,13 @@ namespace media {
 struct MuxerOptions;
 
 class BufferWriter;
+class GatherBuffer;
 class KeySource;
 class MediaSample;
 class MediaStream;
 class MuxerListener;
 class ProgressListener;
+class RuntimeConfig;
 
 namespace mp4 {
 
@@ -61,6 +63,9 @@ class Segmenter {
   /// @param crypto_period_duration specifies crypto period duration in seconds.
   /// @param protection_scheme specifies the protection scheme: 'cenc', 'cens',
   ///        'cbc1', 'cbcs'.
+  /// @param runtime_config is polled for runtime changes to the crypto period
+  ///        duration; see RuntimeConfig. Can be NULL. The caller retains
+  ///        ownership.
   /// @return OK on success, an error status otherwise.
   Status Initialize(const std::vector<MediaStream*>& streams,
                     MuxerListener* muxer_listener,
@@ -69,7 +74,8 @@ class Segmenter {
                     uint32_t max_sd_pixels,
                     double clear_lead_in_seconds,
                     double crypto_period_duration_in_seconds,
-                    FourCC protection_scheme);
+                    FourCC protection_scheme,
+                    RuntimeConfig* runtime_config);
 
   /// Finalize the segmenter.
   /// @return OK on success, an error status otherwise.
@@ -109,7 +115,7 @@ class Segmenter {
   const MuxerOptions& options() const { return options_; }
   FileType* ftyp() { return ftyp_.get(); }
   Movie* moov() { return moov_.get(); }
-  BufferWriter* fragment_buffer() { return fragment_buffer_.get(); }
+  GatherBuffer* fragment_buffer() { return fragment_buffer_.get(); }
   SegmentIndex* sidx() { return sidx_.get(); }
   MuxerListener* muxer_listener() { return muxer_listener_; }
   uint64_t progress_target() { return progress_target_; }
@@ -122,6 +128,10 @@ class Segmenter {
   virtual Status DoInitialize() = 0;
   virtual Status DoFinalize() = 0;
   virtual Status DoFinalizeSegment() = 0;
+  // Called after a finalized fragment has been appended to fragment_buffer()
+  // while the segment is not complete yet. Subclasses may stream the buffered
+  // fragment out early; the default implementation is a no-op.
+  virtual Status DoFlushFragment();
 
   Status FinalizeSegment();
   uint32_t GetReferenceStreamId();
@@ -132,7 +142,7 @@ class Segmenter {
   scoped_ptr<FileType> ftyp_;
   scoped_ptr<Movie> moov_;
   scoped_ptr<MovieFragment> moof_;
-  scoped_ptr<BufferWriter> fragment_buffer_;
+  scoped_ptr<GatherBuffer> fragment_buffer_;
   scoped_ptr<SegmentIndex> sidx_;
   std::vector<Fragmenter*> fragmenters_;
   std::vector<uint64_t> segment_durations_;
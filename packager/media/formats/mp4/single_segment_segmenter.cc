@@ -15,6 +15,7 @@
 #include "packager/base/threading/platform_thread.h"
 #include "packager/base/time/time.h"
 #include "packager/media/base/buffer_writer.h"
+#include "packager/media/base/gather_buffer.h"
 #include "packager/media/base/media_stream.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/event/muxer_listener.h"
@@ -42,7 +43,10 @@ std::string TempFileName() {
 SingleSegmentSegmenter::SingleSegmentSegmenter(const MuxerOptions& options,
                                                scoped_ptr<FileType> ftyp,
                                                scoped_ptr<Movie> moov)
-    : Segmenter(options, ftyp.Pass(), moov.Pass()) {}
+    : Segmenter(options, ftyp.Pass(), moov.Pass()),
+      temp_file_in_memory_(false),
+      write_in_place_(false),
+      reserved_header_size_(0) {}
 
 SingleSegmentSegmenter::~SingleSegmentSegmenter() {
   if (temp_file_)
@@ -69,6 +73,32 @@ bool SingleSegmentSegmenter::GetIndexRange(size_t* offset, size_t* size) {
 }
 
 Status SingleSegmentSegmenter::DoInitialize() {
+  if (options().mp4_reserve_index_space) {
+    reserved_header_size_ = EstimateReservedHeaderSize();
+    if (reserved_header_size_ == 0) {
+      LOG(WARNING) << "Cannot estimate the index size (unknown input "
+                      "duration); falling back to an intermediate file.";
+    }
+  }
+  if (reserved_header_size_ > 0) {
+    // Write media data directly to the output file, behind a reserved area
+    // that DoFinalize() fills with ftyp, moov and sidx. No intermediate
+    // file and no second pass, so the progress target stays as is.
+    write_in_place_ = true;
+    temp_file_.reset(File::Open(options().output_file_name.c_str(), "w"));
+    if (!temp_file_) {
+      return Status(error::FILE_FAILURE,
+                    "Cannot open file to write " + options().output_file_name);
+    }
+    // Occupy the reserved area with a free box until finalization.
+    BufferWriter reservation;
+    reservation.AppendInt(static_cast<uint32_t>(reserved_header_size_));
+    reservation.AppendInt(static_cast<uint32_t>(FOURCC_free));
+    reservation.AppendVector(
+        std::vector<uint8_t>(reserved_header_size_ - 8, 0));
+    return reservation.WriteToFile(temp_file_.get());
+  }
+
   // Single segment segmentation involves two stages:
   //   Stage 1: Create media subsegments from media samples
   //   Stage 2: Update media header (moov) which involves copying of media
@@ -77,16 +107,15 @@ Status SingleSegmentSegmenter::DoInitialize() {
   // progress_target was set for stage 1. Times two to account for stage 2.
   set_progress_target(progress_target() * 2);
 
-  if (options().temp_dir.empty()) {
-    base::FilePath temp_file_path;
-    if (!base::CreateTemporaryFile(&temp_file_path)) {
-      LOG(ERROR) << "Failed to create temporary file.";
-      return Status(error::FILE_FAILURE, "Unable to create temporary file.");
-    }
-    temp_file_name_ = temp_file_path.value();
+  if (options().temp_file_memory_limit > 0) {
+    // Keep the temp stream in memory; DoFinalizeSegment() spills it to disk
+    // if it outgrows the limit.
+    temp_file_name_ = std::string(kMemoryFilePrefix) + TempFileName();
+    temp_file_in_memory_ = true;
   } else {
-    temp_file_name_ =
-        base::FilePath(options().temp_dir).Append(TempFileName()).value();
+    Status status = GenerateDiskTempFileName(&temp_file_name_);
+    if (!status.ok())
+      return status;
   }
   temp_file_.reset(File::Open(temp_file_name_.c_str(), "w"));
   return temp_file_
@@ -101,8 +130,57 @@ Status SingleSegmentSegmenter::DoFinalize() {
   DCHECK(moov());
   DCHECK(vod_sidx_);
 
-  // Close the temp file to prepare for reading later.
-  if (!temp_file_.release()->Close()) {
+  if (write_in_place_) {
+    // Media data is already in place in the output file. Fill the reserved
+    // area at the head of the file with ftyp, moov and sidx, padded to the
+    // reserved size with a free box.
+    scoped_ptr<BufferWriter> buffer(new BufferWriter());
+    ftyp()->Write(buffer.get());
+    moov()->Write(buffer.get());
+    vod_sidx_->Write(buffer.get());
+    const uint64_t header_size = buffer->Size();
+    // A gap, if any, must be large enough to hold a free box header.
+    if (header_size > reserved_header_size_ ||
+        (header_size != reserved_header_size_ &&
+         header_size + 8 > reserved_header_size_)) {
+      // The estimate was too small. The media data is salvageable: move it
+      // out to a temp file and fall through to the rewrite pass below, so
+      // the only cost of a bad estimate is losing the single-pass speedup.
+      LOG(WARNING) << "The index (" << header_size
+                   << " bytes) does not fit in the reserved area ("
+                   << reserved_header_size_
+                   << " bytes); falling back to a rewrite pass.";
+      Status status = MoveInPlaceMediaToTempFile();
+      if (!status.ok())
+        return status;
+    } else {
+      if (header_size < reserved_header_size_) {
+        // The free box payload on disk is already zeroed; just write the
+        // header.
+        buffer->AppendInt(
+            static_cast<uint32_t>(reserved_header_size_ - header_size));
+        buffer->AppendInt(static_cast<uint32_t>(FOURCC_free));
+      }
+      if (!temp_file_->Seek(0)) {
+        return Status(error::FILE_FAILURE,
+                      "Cannot seek to the beginning of " +
+                          options().output_file_name);
+      }
+      Status status = buffer->WriteToFile(temp_file_.get());
+      if (!status.ok())
+        return status;
+      if (!temp_file_.release()->Close()) {
+        return Status(error::FILE_FAILURE,
+                      "Cannot close file " + options().output_file_name);
+      }
+      SetComplete();
+      return Status::OK;
+    }
+  }
+
+  // Close the temp file to prepare for reading later. Already closed when
+  // coming through the reservation-overflow fallback.
+  if (temp_file_ && !temp_file_.release()->Close()) {
     return Status(error::FILE_FAILURE,
                   "Cannot close the temp file " + temp_file_name_);
   }
@@ -159,6 +237,136 @@ Status SingleSegmentSegmenter::DoFinalize() {
   return Status::OK;
 }
 
+uint64_t SingleSegmentSegmenter::EstimateReservedHeaderSize() {
+  const uint32_t time_scale = GetReferenceTimeScale();
+  if (time_scale == 0 || progress_target() == 0 ||
+      options().segment_duration <= 0) {
+    return 0;
+  }
+  // Extra headroom for fit: sidx reference count can exceed the estimate when
+  // segments end up shorter than requested, and moov can grow slightly at
+  // finalization, e.g. from 64-bit duration fields.
+  const size_t kReservationSlack = 4096;
+  const double duration_in_seconds =
+      static_cast<double>(progress_target()) / time_scale;
+  const size_t max_references =
+      2 * static_cast<size_t>(duration_in_seconds /
+                                  options().segment_duration +
+                              1) +
+      16;
+  SegmentIndex sidx;
+  sidx.references.resize(max_references);
+  return ftyp()->ComputeSize() + moov()->ComputeSize() + sidx.ComputeSize() +
+         kReservationSlack;
+}
+
+Status SingleSegmentSegmenter::MoveInPlaceMediaToTempFile() {
+  DCHECK(write_in_place_);
+
+  if (!temp_file_.release()->Close()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot close file " + options().output_file_name);
+  }
+
+  Status status = GenerateDiskTempFileName(&temp_file_name_);
+  if (!status.ok())
+    return status;
+
+  scoped_ptr<File, FileCloser> source(
+      File::Open(options().output_file_name.c_str(), "r"));
+  if (source == NULL) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file to read " + options().output_file_name);
+  }
+  if (!source->Seek(reserved_header_size_)) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot seek past the reserved area of " +
+                      options().output_file_name);
+  }
+  scoped_ptr<File, FileCloser> destination(
+      File::Open(temp_file_name_.c_str(), "w"));
+  if (destination == NULL) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file to write " + temp_file_name_);
+  }
+
+  const int kBufSize = 0x200000;  // 2MB.
+  scoped_ptr<uint8_t[]> buf(new uint8_t[kBufSize]);
+  while (true) {
+    int64_t size = source->Read(buf.get(), kBufSize);
+    if (size == 0) {
+      break;
+    } else if (size < 0) {
+      return Status(error::FILE_FAILURE,
+                    "Failed to read file " + options().output_file_name);
+    }
+    int64_t size_written = destination->Write(buf.get(), size);
+    if (size_written != size) {
+      return Status(error::FILE_FAILURE,
+                    "Failed to write file " + temp_file_name_);
+    }
+  }
+
+  if (!source.release()->Close()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot close file " + options().output_file_name);
+  }
+  if (!destination.release()->Close()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot close the temp file " + temp_file_name_);
+  }
+  write_in_place_ = false;
+  return Status::OK;
+}
+
+Status SingleSegmentSegmenter::GenerateDiskTempFileName(
+    std::string* file_name) {
+  if (options().temp_dir.empty()) {
+    base::FilePath temp_file_path;
+    if (!base::CreateTemporaryFile(&temp_file_path)) {
+      LOG(ERROR) << "Failed to create temporary file.";
+      return Status(error::FILE_FAILURE, "Unable to create temporary file.");
+    }
+    *file_name = temp_file_path.value();
+  } else {
+    *file_name =
+        base::FilePath(options().temp_dir).Append(TempFileName()).value();
+  }
+  return Status::OK;
+}
+
+Status SingleSegmentSegmenter::SpillTempFileToDisk() {
+  DCHECK(temp_file_in_memory_);
+  const std::string memory_file_name = temp_file_name_;
+  LOG(INFO) << "In-memory temp stream exceeded "
+            << options().temp_file_memory_limit
+            << " bytes; spilling to disk.";
+
+  if (!temp_file_.release()->Close()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot close the temp file " + memory_file_name);
+  }
+
+  std::string disk_file_name;
+  Status status = GenerateDiskTempFileName(&disk_file_name);
+  if (!status.ok())
+    return status;
+  if (!File::Copy(memory_file_name.c_str(), disk_file_name.c_str())) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot spill temp file to " + disk_file_name);
+  }
+  if (!File::Delete(memory_file_name.c_str()))
+    LOG(WARNING) << "Unable to delete temporary file " << memory_file_name;
+
+  temp_file_name_ = disk_file_name;
+  temp_file_in_memory_ = false;
+  temp_file_.reset(File::Open(temp_file_name_.c_str(), "a"));
+  return temp_file_
+             ? Status::OK
+             : Status(error::FILE_FAILURE,
+                      "Cannot open file to append " + temp_file_name_);
+}
+
 Status SingleSegmentSegmenter::DoFinalizeSegment() {
   DCHECK(sidx());
   DCHECK(fragment_buffer());
@@ -223,6 +431,13 @@ Status SingleSegmentSegmenter::DoFinalizeSegment() {
   Status status = fragment_buffer()->WriteToFile(temp_file_.get());
   if (!status.ok()) return status;
 
+  if (temp_file_in_memory_ &&
+      temp_file_->Size() >
+          static_cast<int64_t>(options().temp_file_memory_limit)) {
+    status = SpillTempFileToDisk();
+    if (!status.ok()) return status;
+  }
+
   UpdateProgress(vod_ref.subsegment_duration);
   if (muxer_listener()) {
     muxer_listener()->OnSampleDurationReady(sample_duration());
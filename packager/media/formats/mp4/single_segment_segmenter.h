@@ -44,9 +44,38 @@ class SingleSegmentSegmenter : public Segmenter {
   Status DoFinalize() override;
   Status DoFinalizeSegment() override;
 
+  // Estimates the number of bytes to reserve at the head of the output file
+  // for ftyp, moov, sidx and free box padding, for in-place (single-pass)
+  // writing. Returns 0 if no reliable estimate can be made, e.g. when the
+  // input duration is unknown.
+  uint64_t EstimateReservedHeaderSize();
+
+  // Salvages an in-place (single-pass) output whose finalized header
+  // outgrew the reserved area: closes the output file, copies the media
+  // data behind the reservation out to a disk temp file and clears
+  // |write_in_place_|, so finalization can continue with the regular
+  // rewrite pass instead of failing the job.
+  Status MoveInPlaceMediaToTempFile();
+
+  // Generates a temporary file name in MuxerOptions.temp_dir, or in the
+  // system temporary directory if it is empty.
+  Status GenerateDiskTempFileName(std::string* file_name);
+
+  // Moves an in-memory temp stream that has outgrown
+  // MuxerOptions.temp_file_memory_limit to a temp file on disk and continues
+  // writing there.
+  Status SpillTempFileToDisk();
+
   scoped_ptr<SegmentIndex> vod_sidx_;
   std::string temp_file_name_;
   scoped_ptr<File, FileCloser> temp_file_;
+  // True while the temp stream lives in a memory file.
+  bool temp_file_in_memory_;
+  // True when writing media data directly to the output file behind a
+  // reserved index area; |temp_file_| then refers to the output file.
+  bool write_in_place_;
+  // Size of the reserved index area when writing in place.
+  uint64_t reserved_header_size_;
 
   DISALLOW_COPY_AND_ASSIGN(SingleSegmentSegmenter);
 };
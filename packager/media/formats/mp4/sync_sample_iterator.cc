@@ -8,6 +8,8 @@
 
 #include <algorithm>
 
+#include "packager/base/logging.h"
+
 namespace shaka {
 namespace media {
 namespace mp4 {
@@ -26,6 +28,15 @@ bool SyncSampleIterator::AdvanceSample() {
   return true;
 }
 
+void SyncSampleIterator::SeekToSample(uint32_t sample) {
+  DCHECK_GT(sample, 0u);
+  sample_number_ = sample;
+  // Restore the invariant that |iterator_| points to the first sync sample
+  // entry not less than |sample_number_|.
+  iterator_ = std::lower_bound(sync_sample_vector_.begin(),
+                               sync_sample_vector_.end(), sample);
+}
+
 bool SyncSampleIterator::IsSyncSample() const {
   // If the sync sample box is not present, every sample is a sync sample.
   if (is_empty_)
@@ -41,6 +52,20 @@ bool SyncSampleIterator::IsSyncSample(uint32_t sample) const {
       sync_sample_vector_.begin(), sync_sample_vector_.end(), sample);
 }
 
+uint32_t SyncSampleIterator::NearestSyncSampleAtOrBefore(
+    uint32_t sample) const {
+  DCHECK_GT(sample, 0u);
+  if (is_empty_)
+    return sample;
+  // Find the last entry not greater than |sample|. A valid sync sample box
+  // starts with sample 1, but fall back to 1 if it does not.
+  std::vector<uint32_t>::const_iterator it = std::upper_bound(
+      sync_sample_vector_.begin(), sync_sample_vector_.end(), sample);
+  if (it == sync_sample_vector_.begin())
+    return 1;
+  return *(it - 1);
+}
+
 }  // namespace mp4
 }  // namespace media
 }  // namespace shaka
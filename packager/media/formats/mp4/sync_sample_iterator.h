@@ -30,12 +30,23 @@ class SyncSampleIterator {
   /// @return true if not past the last sample, false otherwise.
   bool AdvanceSample();
 
+  /// Seek to the given sample. O(log n) in the number of sync sample
+  /// entries.
+  /// @param sample is 1-based.
+  void SeekToSample(uint32_t sample);
+
   /// @return true if the current sample is a sync sample, false otherwise.
   bool IsSyncSample() const;
 
   /// @return true if @a sample (1-based) is a sync sample, false otherwise.
   bool IsSyncSample(uint32_t sample) const;
 
+  /// @return The last sync sample at or before @a sample (1-based). Returns
+  ///         @a sample itself if the sync sample box is not present (every
+  ///         sample is then a sync sample), or 1 if no sync sample precedes
+  ///         @a sample. Does not change the iterator position.
+  uint32_t NearestSyncSampleAtOrBefore(uint32_t sample) const;
+
  private:
   uint32_t sample_number_;
   const std::vector<uint32_t>& sync_sample_vector_;
@@ -56,6 +56,25 @@ TEST(SyncSampleIteratorTest, SyncSample) {
   }
 }
 
+TEST(SyncSampleIteratorTest, SeekToSample) {
+  SyncSample sync_sample;
+  sync_sample.sample_number.assign(
+      kSyncSamples, kSyncSamples + sizeof(kSyncSamples) / sizeof(uint32_t));
+  SyncSampleIterator iterator(sync_sample);
+
+  // Seek backwards, so every seek has to reposition the internal entry.
+  for (uint32_t sample = kNumSamples; sample > 0; --sample) {
+    iterator.SeekToSample(sample);
+    ASSERT_EQ(InSyncSamples(sample), iterator.IsSyncSample());
+  }
+
+  // AdvanceSample() keeps working from a seeked position.
+  iterator.SeekToSample(29);
+  ASSERT_FALSE(iterator.IsSyncSample());
+  ASSERT_TRUE(iterator.AdvanceSample());
+  ASSERT_TRUE(iterator.IsSyncSample());
+}
+
 }  // namespace mp4
 }  // namespace media
 }  // namespace shaka
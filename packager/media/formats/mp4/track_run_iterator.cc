@@ -8,6 +8,7 @@
 #include <limits>
 
 #include "packager/media/base/buffer_reader.h"
+#include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/rcheck.h"
 #include "packager/media/formats/mp4/chunk_info_iterator.h"
@@ -17,6 +18,12 @@
 
 namespace {
 const int64_t kInvalidOffset = std::numeric_limits<int64_t>::max();
+
+// Serialized sizes of one run header and one sample in WriteIndex() output;
+// used to sanity check the counts read back in InitFromIndex() before
+// allocating.
+const size_t kIndexBytesPerRun = 37;
+const size_t kIndexBytesPerSample = 13;
 }  // namespace
 
 namespace shaka {
@@ -70,12 +77,27 @@ TrackRunInfo::TrackRunInfo()
 TrackRunInfo::~TrackRunInfo() {}
 
 TrackRunIterator::TrackRunIterator(const Movie* moov)
-    : moov_(moov), sample_dts_(0), sample_offset_(0) {
+    : moov_(moov),
+      has_clip_range_(false),
+      clip_start_seconds_(0),
+      clip_end_seconds_(0),
+      sample_dts_(0),
+      sample_offset_(0) {
   CHECK(moov);
 }
 
 TrackRunIterator::~TrackRunIterator() {}
 
+void TrackRunIterator::SetClipRange(double start_seconds,
+                                    double end_seconds) {
+  DCHECK(runs_.empty());
+  DCHECK_LE(0, start_seconds);
+  DCHECK_LT(start_seconds, end_seconds);
+  has_clip_range_ = true;
+  clip_start_seconds_ = start_seconds;
+  clip_end_seconds_ = end_seconds;
+}
+
 static void PopulateSampleInfo(const TrackExtends& trex,
                                const TrackFragmentHeader& tfhd,
                                const TrackFragmentRun& trun,
@@ -204,7 +226,62 @@ bool TrackRunIterator::Init() {
     }
 
     uint32_t sample_index = 0;
-    for (uint32_t chunk_index = 0; chunk_index < num_chunks; ++chunk_index) {
+    uint32_t clip_first_sample = 1;
+    uint32_t clip_last_sample = num_samples;
+    uint32_t first_chunk = 1;
+    uint32_t last_chunk = num_chunks;
+    if (has_clip_range_ && num_samples > 0) {
+      const uint64_t timescale = trak->media.header.timescale;
+      const uint64_t clip_start =
+          static_cast<uint64_t>(clip_start_seconds_ * timescale);
+      // A sub-tick clip end rounds up to one tick, so the range stays
+      // non-empty.
+      const uint64_t clip_end = std::max<uint64_t>(
+          static_cast<uint64_t>(clip_end_seconds_ * timescale), 1);
+      if (decoding_time.TotalDuration() <= clip_start) {
+        // The clip range starts after the last sample of this track.
+        continue;
+      }
+      // The first sample whose decoding interval extends past |clip_start| is
+      // one past the count of samples fully decoded by then.
+      clip_first_sample =
+          decoding_time.SampleCountThroughTime(clip_start) + 1;
+      // The last sample whose decoding time starts before |clip_end|: sample
+      // s starts when sample s - 1 ends, so it is one past the count of
+      // samples that ended before then.
+      clip_last_sample = std::min(
+          num_samples,
+          decoding_time.SampleCountThroughTime(clip_end - 1) + 1);
+      clip_last_sample = std::max(clip_last_sample, clip_first_sample);
+      // Snap the start back to a sync sample so the clip begins with a
+      // decodable frame. For tracks without a sync sample box every sample
+      // is a sync sample, so this is a no-op there.
+      clip_first_sample =
+          sync_sample.NearestSyncSampleAtOrBefore(clip_first_sample);
+
+      RCHECK(chunk_info.SeekToSample(clip_first_sample));
+      first_chunk = chunk_info.current_chunk();
+      RCHECK(chunk_info.SeekToSample(clip_last_sample));
+      last_chunk = chunk_info.current_chunk();
+
+      // Position all iterators at the first sample of |first_chunk|; the
+      // chunks before it are never visited.
+      const uint32_t first_chunk_sample =
+          (first_chunk == 1) ? 1
+                             : chunk_info.NumSamples(1, first_chunk - 1) + 1;
+      RCHECK(chunk_info.SeekToChunk(first_chunk));
+      RCHECK(decoding_time.SeekToSample(first_chunk_sample));
+      if (has_composition_offset)
+        RCHECK(composition_offset.SeekToSample(first_chunk_sample));
+      sync_sample.SeekToSample(first_chunk_sample);
+      sample_index = first_chunk_sample - 1;
+      run_start_dts = (first_chunk_sample == 1)
+                          ? 0
+                          : decoding_time.Duration(1, first_chunk_sample - 1);
+    }
+
+    for (uint32_t chunk_index = first_chunk - 1; chunk_index < last_chunk;
+         ++chunk_index) {
       RCHECK(chunk_info.current_chunk() == chunk_index + 1);
 
       TrackRunInfo tri;
@@ -237,6 +314,7 @@ bool TrackRunIterator::Init() {
       }
 
       uint32_t samples_per_chunk = chunk_info.samples_per_chunk();
+      const uint32_t chunk_first_sample = sample_index + 1;
       tri.samples.resize(samples_per_chunk);
       for (uint32_t k = 0; k < samples_per_chunk; ++k) {
         SampleInfo& sample = tri.samples[k];
@@ -266,6 +344,26 @@ bool TrackRunIterator::Init() {
         }
       }
 
+      if (has_clip_range_) {
+        // Drop the samples of the boundary chunks that fall outside the clip
+        // range. Skipped leading samples fold their sizes and durations into
+        // the run's start offset and dts, so the remaining samples keep
+        // their file positions and timestamps.
+        if (chunk_index + 1 == last_chunk &&
+            clip_last_sample < chunk_first_sample + samples_per_chunk - 1) {
+          tri.samples.resize(clip_last_sample - chunk_first_sample + 1);
+        }
+        if (chunk_index + 1 == first_chunk &&
+            clip_first_sample > chunk_first_sample) {
+          const size_t skip = clip_first_sample - chunk_first_sample;
+          for (size_t k = 0; k < skip; ++k) {
+            tri.sample_start_offset += tri.samples[k].size;
+            tri.start_dts += tri.samples[k].duration;
+          }
+          tri.samples.erase(tri.samples.begin(), tri.samples.begin() + skip);
+        }
+      }
+
       runs_.push_back(tri);
     }
   }
@@ -276,6 +374,127 @@ bool TrackRunIterator::Init() {
   return true;
 }
 
+bool TrackRunIterator::WriteIndex(BufferWriter* writer) const {
+  DCHECK(!has_clip_range_);
+  writer->AppendInt(static_cast<uint32_t>(runs_.size()));
+  for (std::vector<TrackRunInfo>::const_iterator run = runs_.begin();
+       run != runs_.end(); ++run) {
+    // Non-fragmented input is never encrypted (enforced by Init()), so the
+    // aux info and sample encryption fields are always empty and are not
+    // serialized.
+    writer->AppendInt(run->track_id);
+    writer->AppendInt(run->timescale);
+    writer->AppendInt(run->start_dts);
+    writer->AppendInt(run->sample_start_offset);
+    writer->AppendInt(static_cast<uint8_t>(run->track_type));
+
+    // Persist the sample description index so the entry pointer can be
+    // re-resolved against the movie box on load.
+    const Track* trak = NULL;
+    for (size_t t = 0; t < moov_->tracks.size(); ++t) {
+      if (moov_->tracks[t].header.track_id == run->track_id)
+        trak = &moov_->tracks[t];
+    }
+    RCHECK(trak);
+    const SampleDescription& stsd =
+        trak->media.information.sample_table.description;
+    uint32_t desc_idx = 0;
+    if (run->track_type == kAudio) {
+      desc_idx = static_cast<uint32_t>(run->audio_description -
+                                       &stsd.audio_entries[0]);
+    } else if (run->track_type == kVideo) {
+      desc_idx = static_cast<uint32_t>(run->video_description -
+                                       &stsd.video_entries[0]);
+    }
+    writer->AppendInt(desc_idx);
+
+    writer->AppendInt(static_cast<uint32_t>(run->samples.size()));
+    for (std::vector<SampleInfo>::const_iterator sample = run->samples.begin();
+         sample != run->samples.end(); ++sample) {
+      // Compact fields keep the index at 13 bytes per sample; the rare input
+      // that overflows them is simply not indexable.
+      const int64_t kMaxUInt32 = std::numeric_limits<uint32_t>::max();
+      RCHECK(sample->size >= 0 && sample->size <= kMaxUInt32);
+      RCHECK(sample->duration >= 0 && sample->duration <= kMaxUInt32);
+      RCHECK(sample->cts_offset >= std::numeric_limits<int32_t>::min() &&
+             sample->cts_offset <= std::numeric_limits<int32_t>::max());
+      writer->AppendInt(static_cast<uint32_t>(sample->size));
+      writer->AppendInt(static_cast<uint32_t>(sample->duration));
+      writer->AppendInt(static_cast<int32_t>(sample->cts_offset));
+      writer->AppendInt(static_cast<uint8_t>(sample->is_keyframe ? 1 : 0));
+    }
+  }
+  return true;
+}
+
+bool TrackRunIterator::InitFromIndex(BufferReader* reader) {
+  DCHECK(!has_clip_range_);
+  runs_.clear();
+
+  uint32_t run_count;
+  RCHECK(reader->Read4(&run_count));
+  RCHECK(run_count <= (reader->size() - reader->pos()) / kIndexBytesPerRun);
+  runs_.resize(run_count);
+  for (uint32_t i = 0; i < run_count; ++i) {
+    TrackRunInfo& tri = runs_[i];
+    uint8_t track_type;
+    uint32_t desc_idx;
+    uint32_t sample_count;
+    RCHECK(reader->Read4(&tri.track_id) && reader->Read8s(&tri.timescale) &&
+           reader->Read8s(&tri.start_dts) &&
+           reader->Read8s(&tri.sample_start_offset) &&
+           reader->Read1(&track_type) && reader->Read4(&desc_idx) &&
+           reader->Read4(&sample_count));
+    tri.track_type = static_cast<TrackType>(track_type);
+    RCHECK(tri.track_type == kAudio || tri.track_type == kVideo);
+
+    const Track* trak = NULL;
+    for (size_t t = 0; t < moov_->tracks.size(); ++t) {
+      if (moov_->tracks[t].header.track_id == tri.track_id)
+        trak = &moov_->tracks[t];
+    }
+    RCHECK(trak);
+    const SampleDescription& stsd =
+        trak->media.information.sample_table.description;
+    RCHECK(stsd.type == tri.track_type);
+    if (tri.track_type == kAudio) {
+      RCHECK(desc_idx < stsd.audio_entries.size());
+      tri.audio_description = &stsd.audio_entries[desc_idx];
+      // We don't support encrypted non-fragmented mp4.
+      RCHECK(tri.audio_description->sinf.info.track_encryption
+                 .default_is_protected == 0);
+    } else {
+      RCHECK(desc_idx < stsd.video_entries.size());
+      tri.video_description = &stsd.video_entries[desc_idx];
+      RCHECK(tri.video_description->sinf.info.track_encryption
+                 .default_is_protected == 0);
+    }
+
+    RCHECK(sample_count <=
+           (reader->size() - reader->pos()) / kIndexBytesPerSample);
+    tri.samples.resize(sample_count);
+    for (uint32_t k = 0; k < sample_count; ++k) {
+      SampleInfo& sample = tri.samples[k];
+      uint32_t size;
+      uint32_t duration;
+      int32_t cts_offset;
+      uint8_t is_keyframe;
+      RCHECK(reader->Read4(&size) && reader->Read4(&duration) &&
+             reader->Read4s(&cts_offset) && reader->Read1(&is_keyframe));
+      sample.size = size;
+      sample.duration = duration;
+      sample.cts_offset = cts_offset;
+      sample.is_keyframe = is_keyframe != 0;
+    }
+  }
+
+  // The runs were sorted by data offset before being written, so the stored
+  // order is already the iteration order.
+  run_itr_ = runs_.begin();
+  ResetRun();
+  return true;
+}
+
 bool TrackRunIterator::Init(const MovieFragment& moof) {
   runs_.clear();
 
@@ -618,10 +837,10 @@ scoped_ptr<DecryptConfig> TrackRunIterator::GetDecryptConfig() {
       return scoped_ptr<DecryptConfig>();
     }
   }
-  return scoped_ptr<DecryptConfig>(new DecryptConfig(
+  return DecryptConfig::Create(
       track_encryption().default_kid, iv, sample_encryption_entry.subsamples,
       protection_scheme, track_encryption().default_crypt_byte_block,
-      track_encryption().default_skip_byte_block));
+      track_encryption().default_skip_byte_block);
 }
 
 }  // namespace mp4
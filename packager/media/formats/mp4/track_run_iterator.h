@@ -13,6 +13,8 @@
 namespace shaka {
 namespace media {
 
+class BufferReader;
+class BufferWriter;
 class DecryptConfig;
 
 namespace mp4 {
@@ -27,6 +29,13 @@ class TrackRunIterator {
   explicit TrackRunIterator(const Movie* moov);
   ~TrackRunIterator();
 
+  /// Restricts the runs set up by the non-fragmented Init() to the chunks
+  /// that cover the given time range. The range start is snapped back to the
+  /// nearest preceding sync sample so the clip begins with a decodable
+  /// frame; out-of-range samples of the boundary chunks are dropped. Must be
+  /// called before Init(). Has no effect on fragmented input (Init(moof)).
+  void SetClipRange(double start_seconds, double end_seconds);
+
   /// For non-fragmented mp4, moov contains all the chunk information; This
   /// function sets up the iterator to access all the chunks.
   /// For fragmented mp4, chunk and sample information are generally contained
@@ -39,6 +48,23 @@ class TrackRunIterator {
   /// @return true on success, false otherwise.
   bool Init(const MovieFragment& moof);
 
+  /// Serializes the run state built by the non-fragmented Init() - per-chunk
+  /// runs with their prefix-summed start times and offsets - so a later run
+  /// on the same input can skip the sample table walk. Only call after a
+  /// successful Init() without a clip range. Uses the BufferWriter (network
+  /// byte order) convention.
+  /// @return true on success, false if the tables are not representable.
+  bool WriteIndex(BufferWriter* writer) const;
+
+  /// Sets up the iterator from run state written by WriteIndex() instead of
+  /// walking the sample tables. The sample description references are
+  /// re-resolved against the movie box, which must describe the same input
+  /// the index was written for; the caller is responsible for validating
+  /// that (e.g. source size and mtime).
+  /// @return true on success, false if the index is corrupt or does not
+  ///         match the movie box.
+  bool InitFromIndex(BufferReader* reader);
+
   /// @return true if the iterator points to a valid run, false if past the
   ///         last run.
   bool IsRunValid() const;
@@ -106,6 +132,11 @@ class TrackRunIterator {
 
   const Movie* moov_;
 
+  // Clip range for the non-fragmented Init(); see SetClipRange().
+  bool has_clip_range_;
+  double clip_start_seconds_;
+  double clip_end_seconds_;
+
   std::vector<TrackRunInfo> runs_;
   std::vector<TrackRunInfo>::const_iterator run_itr_;
   std::vector<SampleInfo>::const_iterator sample_itr_;
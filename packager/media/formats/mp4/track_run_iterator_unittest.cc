@@ -697,6 +697,63 @@ TEST_F(TrackRunIteratorTest, UnexpectedOrderingTest) {
   EXPECT_EQ(iter_->GetMaxClearOffset(), 10000);
 }
 
+TEST_F(TrackRunIteratorTest, ClipRangeTest) {
+  // Non-fragmented movie with one video track: 10 samples of 100/1000s each,
+  // sizes 1..10, in two chunks of 5 samples, sync samples 1, 4 and 7.
+  Movie moov;
+  moov.tracks.resize(1);
+  Track& trak = moov.tracks[0];
+  trak.header.track_id = 1;
+  trak.media.header.timescale = 1000;
+  SampleTable& stbl = trak.media.information.sample_table;
+  stbl.description.type = kVideo;
+  stbl.description.video_entries.resize(1);
+  const DecodingTime kDecodingTime = {10, 100};
+  stbl.decoding_time_to_sample.decoding_time.push_back(kDecodingTime);
+  const ChunkInfo kChunkInfo = {1, 5, 1};
+  stbl.sample_to_chunk.chunk_info.push_back(kChunkInfo);
+  stbl.sample_size.sample_count = 10;
+  for (uint32_t i = 1; i <= 10; ++i)
+    stbl.sample_size.sizes.push_back(i);
+  stbl.chunk_large_offset.offsets.push_back(1000);
+  stbl.chunk_large_offset.offsets.push_back(2000);
+  const uint32_t kSyncSamples[] = {1, 4, 7};
+  stbl.sync_sample.sample_number.assign(kSyncSamples, kSyncSamples + 3);
+
+  iter_.reset(new TrackRunIterator(&moov));
+  iter_->SetClipRange(0.45, 0.65);
+  ASSERT_TRUE(iter_->Init());
+
+  // The clip starts inside sample 5 and is snapped back to sync sample 4;
+  // the last sample starting before the clip end is sample 7. The first
+  // chunk keeps samples 4-5, with the sizes and durations of the dropped
+  // leading samples folded into the run's start offset and dts.
+  ASSERT_TRUE(iter_->IsSampleValid());
+  EXPECT_EQ(iter_->sample_offset(), 1006);  // 1000 + sizes of samples 1-3.
+  EXPECT_EQ(iter_->dts(), 300);
+  EXPECT_EQ(iter_->sample_size(), 4);
+  EXPECT_TRUE(iter_->is_keyframe());
+  iter_->AdvanceSample();
+  EXPECT_EQ(iter_->sample_size(), 5);
+  iter_->AdvanceSample();
+  EXPECT_FALSE(iter_->IsSampleValid());
+
+  // The second chunk keeps samples 6-7 and drops the trailing samples.
+  iter_->AdvanceRun();
+  ASSERT_TRUE(iter_->IsSampleValid());
+  EXPECT_EQ(iter_->sample_offset(), 2000);
+  EXPECT_EQ(iter_->dts(), 500);
+  EXPECT_EQ(iter_->sample_size(), 6);
+  EXPECT_FALSE(iter_->is_keyframe());
+  iter_->AdvanceSample();
+  EXPECT_EQ(iter_->sample_size(), 7);
+  EXPECT_TRUE(iter_->is_keyframe());
+  iter_->AdvanceSample();
+  EXPECT_FALSE(iter_->IsSampleValid());
+  iter_->AdvanceRun();
+  EXPECT_FALSE(iter_->IsRunValid());
+}
+
 }  // namespace mp4
 }  // namespace media
 }  // namespace shaka
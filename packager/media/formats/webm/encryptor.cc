@@ -6,9 +6,13 @@
 
 #include "packager/media/formats/webm/encryptor.h"
 
+#include <algorithm>
+
+#include "packager/base/bind.h"
 #include "packager/media/base/aes_encryptor.h"
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/media_sample.h"
+#include "packager/media/base/task_pool.h"
 
 namespace shaka {
 namespace media {
@@ -98,6 +102,93 @@ Status Encryptor::EncryptFrame(scoped_refptr<MediaSample> sample,
   return Status::OK;
 }
 
+Status Encryptor::EncryptFrames(
+    const std::vector<scoped_refptr<MediaSample>>& samples,
+    const std::vector<bool>& encrypt_frame,
+    uint32_t num_threads) {
+  DCHECK(encryptor_);
+  DCHECK_EQ(samples.size(), encrypt_frame.size());
+
+  // Write the signal byte and iv prefixes and assign each encrypted frame its
+  // iv in order, so the output matches per-frame EncryptFrame calls.  The
+  // actual encryption is done below, in parallel.
+  std::vector<PendingCrypt> pending;
+  const size_t iv_size = encryptor_->iv().size();
+  for (size_t i = 0; i < samples.size(); ++i) {
+    const scoped_refptr<MediaSample>& sample = samples[i];
+    const size_t sample_size = sample->data_size();
+    if (encrypt_frame[i]) {
+      // | 1 | iv | enc_data |
+      sample->resize_data(sample_size + iv_size + 1);
+      uint8_t* sample_data = sample->writable_data();
+      memmove(sample_data + iv_size + 1, sample_data, sample_size);
+      sample_data[0] = 0x01;
+      memcpy(sample_data + 1, encryptor_->iv().data(), iv_size);
+
+      PendingCrypt entry;
+      entry.data = sample_data + iv_size + 1;
+      entry.size = sample_size;
+      entry.iv = encryptor_->iv();
+      pending.push_back(entry);
+
+      encryptor_->AdvanceIv(sample_size);
+    } else {
+      // | 0 | data |
+      sample->resize_data(sample_size + 1);
+      uint8_t* sample_data = sample->writable_data();
+      memmove(sample_data + 1, sample_data, sample_size);
+      sample_data[0] = 0x00;
+    }
+  }
+  if (pending.empty())
+    return Status::OK;
+
+  const size_t num_workers =
+      std::min(static_cast<size_t>(num_threads), pending.size());
+  if (num_workers <= 1) {
+    Status status;
+    EncryptFramesTask(&pending, 0, 1, &status);
+    return status;
+  }
+
+  std::vector<Status> worker_statuses(num_workers);
+  std::vector<base::Closure> tasks;
+  for (size_t i = 0; i < num_workers; ++i) {
+    tasks.push_back(base::Bind(&Encryptor::EncryptFramesTask,
+                               base::Unretained(this), &pending, i,
+                               num_workers, &worker_statuses[i]));
+  }
+  TaskPool::GetInstance()->RunTasksAndWait(TaskPool::kHighPriority, tasks);
+  Status status;
+  for (size_t i = 0; i < num_workers; ++i)
+    status.Update(worker_statuses[i]);
+  return status;
+}
+
+void Encryptor::EncryptFramesTask(std::vector<PendingCrypt>* pending,
+                                  size_t worker_index,
+                                  size_t num_workers,
+                                  Status* status) {
+  // Each worker owns its own cryptor; the counter is stateful within a frame,
+  // but frames are independent given their per-frame ivs.
+  scoped_ptr<AesCtrEncryptor> cryptor(new AesCtrEncryptor());
+  if (!cryptor->InitializeWithIv(key_->key, key_->iv)) {
+    *status = Status(error::INTERNAL_ERROR, "Failed to create the encryptor.");
+    return;
+  }
+  for (size_t i = worker_index; i < pending->size(); i += num_workers) {
+    PendingCrypt& entry = (*pending)[i];
+    if (!cryptor->SetIv(entry.iv)) {
+      *status = Status(error::MUXER_FAILURE, "Failed to set the frame iv.");
+      return;
+    }
+    if (!cryptor->Crypt(entry.data, entry.size, entry.data)) {
+      *status = Status(error::MUXER_FAILURE, "Failed to encrypt the frame.");
+      return;
+    }
+  }
+}
+
 Status Encryptor::CreateEncryptor(MuxerListener* muxer_listener,
                                   KeySource::TrackType track_type,
                                   KeySource* key_source) {
@@ -7,6 +7,8 @@
 #ifndef MEDIA_FORMATS_WEBM_ENCRYPTOR_H_
 #define MEDIA_FORMATS_WEBM_ENCRYPTOR_H_
 
+#include <vector>
+
 #include "packager/base/memory/ref_counted.h"
 #include "packager/base/memory/scoped_ptr.h"
 #include "packager/media/base/key_source.h"
@@ -46,12 +48,38 @@ class Encryptor {
   Status EncryptFrame(scoped_refptr<MediaSample> sample,
                       bool encrypt_frame);
 
+  /// Encrypt a batch of frames across up to @a num_threads worker threads.
+  /// Frames are independent given their per-frame ivs, which are assigned in
+  /// order, so the output is identical to per-frame EncryptFrame calls.
+  /// @param samples contains the frames to process.
+  /// @param encrypt_frame tells, per frame, whether it is encrypted or only
+  ///        gets the clear signal byte (e.g. for a clear lead).
+  /// @return OK on success, an error status otherwise.
+  Status EncryptFrames(const std::vector<scoped_refptr<MediaSample>>& samples,
+                       const std::vector<bool>& encrypt_frame,
+                       uint32_t num_threads);
+
  private:
+  // A frame pending encryption: the payload region to encrypt in place and
+  // the iv assigned to the frame.
+  struct PendingCrypt {
+    uint8_t* data;
+    size_t size;
+    std::vector<uint8_t> iv;
+  };
+
   // Create the encryptor for the internal encryption key.
   Status CreateEncryptor(MuxerListener* muxer_listener,
                          KeySource::TrackType track_type,
                          KeySource* key_source);
 
+  // Worker task for EncryptFrames; encrypts every |num_workers|th entry of
+  // |pending| starting at |worker_index| with its own cryptor.
+  void EncryptFramesTask(std::vector<PendingCrypt>* pending,
+                         size_t worker_index,
+                         size_t num_workers,
+                         Status* status);
+
  private:
   scoped_ptr<EncryptionKey> key_;
   scoped_ptr<AesCtrEncryptor> encryptor_;
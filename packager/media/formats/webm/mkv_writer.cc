@@ -6,10 +6,21 @@
 
 #include "packager/media/formats/webm/mkv_writer.h"
 
+#include <algorithm>
+
+#include "packager/third_party/libwebm/src/webmids.hpp"
+
 namespace shaka {
 namespace media {
 
-MkvWriter::MkvWriter() : position_(0) {}
+namespace {
+// Flush the buffer once it exceeds this size even in the middle of a cluster
+// to bound the memory usage; later seek-backs then go to the File directly.
+const size_t kMaxBufferSize = 1024 * 1024;
+}  // namespace
+
+MkvWriter::MkvWriter()
+    : buffer_start_pos_(0), flush_failed_(false), position_(0) {}
 
 MkvWriter::~MkvWriter() {}
 
@@ -23,11 +34,18 @@ Status MkvWriter::Open(const std::string& name) {
   // on File.
   seekable_ = file_->Seek(0);
   position_ = 0;
+  buffer_start_pos_ = 0;
+  buffer_.clear();
+  flush_failed_ = false;
   return Status::OK;
 }
 
 Status MkvWriter::Close() {
   const std::string file_name = file_->file_name();
+  if (Flush() != 0) {
+    file_.release()->Close();
+    return Status(error::FILE_FAILURE, "Cannot write to file " + file_name);
+  }
   if (!file_.release()->Close()) {
     return Status(error::FILE_FAILURE, "Cannot close file " + file_name);
   }
@@ -36,20 +54,25 @@ Status MkvWriter::Close() {
 
 mkvmuxer::int32 MkvWriter::Write(const void* buf, mkvmuxer::uint32 len) {
   DCHECK(file_);
+  DCHECK_GE(position_, buffer_start_pos_);
+  if (flush_failed_)
+    return -1;
 
-  const char* data = reinterpret_cast<const char*>(buf);
-  int64_t total_bytes_written = 0;
-  while (total_bytes_written < len) {
-    const int64_t written =
-        file_->Write(data + total_bytes_written, len - total_bytes_written);
-    if (written < 0)
-      return written;
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(buf);
+  const size_t cursor = position_ - buffer_start_pos_;
+  DCHECK_LE(cursor, buffer_.size());
+  // Overwrite any buffered bytes under the cursor, then append the rest.
+  // This serves seek-backs into the current cluster, e.g. to patch its size,
+  // entirely from the buffer.
+  const size_t overwrite = std::min<size_t>(len, buffer_.size() - cursor);
+  std::copy(data, data + overwrite, buffer_.begin() + cursor);
+  buffer_.insert(buffer_.end(), data + overwrite, data + len);
+  position_ += len;
 
-    total_bytes_written += written;
+  if (buffer_.size() >= kMaxBufferSize &&
+      position_ == buffer_start_pos_ + static_cast<int64_t>(buffer_.size())) {
+    return Flush();
   }
-
-  DCHECK_EQ(total_bytes_written, len);
-  position_ += len;
   return 0;
 }
 
@@ -59,12 +82,15 @@ int64_t MkvWriter::WriteFromFile(File* source) {
 
 int64_t MkvWriter::WriteFromFile(File* source, uint64_t max_copy) {
   DCHECK(file_);
+  if (Flush() != 0)
+    return -1;
 
   const int64_t size = File::CopyFile(source, file_.get(), max_copy);
   if (size < 0)
     return size;
 
   position_ += size;
+  buffer_start_pos_ = position_;
   return size;
 }
 
@@ -75,8 +101,19 @@ mkvmuxer::int64 MkvWriter::Position() const {
 mkvmuxer::int32 MkvWriter::Position(mkvmuxer::int64 position) {
   DCHECK(file_);
 
+  // Seeks within the buffered range only move the cursor; Write() overwrites
+  // the buffer in place.
+  if (position >= buffer_start_pos_ &&
+      position <= buffer_start_pos_ + static_cast<int64_t>(buffer_.size())) {
+    position_ = position;
+    return 0;
+  }
+
+  if (Flush() != 0)
+    return -1;
   if (file_->Seek(position)) {
     position_ = position;
+    buffer_start_pos_ = position;
     return 0;
   } else {
     return -1;
@@ -88,7 +125,46 @@ bool MkvWriter::Seekable() const {
 }
 
 void MkvWriter::ElementStartNotify(mkvmuxer::uint64 element_id,
-                                   mkvmuxer::int64 position) {}
+                                   mkvmuxer::int64 position) {
+  // Clusters hold the media data and are the only elements large enough to be
+  // worth cutting the buffer at.  Flushing here keeps each cluster in the
+  // buffer until the next one starts, so its size patch never hits the File.
+  if (element_id == mkvmuxer::kMkvCluster)
+    Flush();
+}
+
+mkvmuxer::int32 MkvWriter::Flush() {
+  DCHECK(file_);
+  if (flush_failed_)
+    return -1;
+  if (buffer_.empty())
+    return 0;
+
+  const char* data = reinterpret_cast<const char*>(buffer_.data());
+  size_t total_bytes_written = 0;
+  while (total_bytes_written < buffer_.size()) {
+    const int64_t written = file_->Write(data + total_bytes_written,
+                                         buffer_.size() - total_bytes_written);
+    if (written < 0) {
+      flush_failed_ = true;
+      return static_cast<mkvmuxer::int32>(written);
+    }
+    total_bytes_written += written;
+  }
+
+  buffer_start_pos_ += buffer_.size();
+  buffer_.clear();
+  // The cursor may sit behind the buffer end after an in-buffer seek-back;
+  // move the File to match the logical position.
+  if (position_ != buffer_start_pos_) {
+    if (!file_->Seek(position_)) {
+      flush_failed_ = true;
+      return -1;
+    }
+    buffer_start_pos_ = position_;
+  }
+  return 0;
+}
 
 }  // namespace media
 }  // namespace shaka
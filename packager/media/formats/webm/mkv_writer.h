@@ -8,6 +8,7 @@
 #define MEDIA_FORMATS_WEBM_MKV_WRITER_H_
 
 #include <string>
+#include <vector>
 
 #include "packager/base/memory/scoped_ptr.h"
 #include "packager/media/base/status.h"
@@ -17,7 +18,11 @@
 namespace shaka {
 namespace media {
 
-/// An implementation of IMkvWriter using our File type.
+/// An implementation of IMkvWriter using our File type.  Writes are coalesced
+/// in an internal buffer that is flushed to the File at cluster boundaries,
+/// so the many small EBML element writes making up a cluster cost one or two
+/// File calls instead of one each.  Seeks within the buffered range (e.g. to
+/// patch a cluster size) are served from the buffer without touching the File.
 class MkvWriter : public mkvmuxer::IMkvWriter {
  public:
   MkvWriter();
@@ -61,7 +66,17 @@ class MkvWriter : public mkvmuxer::IMkvWriter {
   File* file() { return file_.get(); }
 
  private:
+  // Writes the buffered bytes to the File and re-syncs the File position with
+  // the logical position.  Returns 0 on success.
+  mkvmuxer::int32 Flush();
+
   scoped_ptr<File, FileCloser> file_;
+  // Bytes accepted by Write() but not yet written to |file_|; starts at file
+  // offset |buffer_start_pos_|.
+  std::vector<uint8_t> buffer_;
+  mkvmuxer::int64 buffer_start_pos_;
+  // Set when a deferred flush fails; makes subsequent operations fail.
+  bool flush_failed_;
   // Keep track of the position and whether we can seek.
   mkvmuxer::int64 position_;
   bool seekable_;
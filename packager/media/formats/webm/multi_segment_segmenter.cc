@@ -19,7 +19,10 @@ namespace webm {
 MultiSegmentSegmenter::MultiSegmentSegmenter(const MuxerOptions& options)
     : Segmenter(options), num_segment_(0) {}
 
-MultiSegmentSegmenter::~MultiSegmentSegmenter() {}
+MultiSegmentSegmenter::~MultiSegmentSegmenter() {
+  // An in-flight cluster write may still be using |writer_|.
+  WaitForPendingClusterWrite();
+}
 
 bool MultiSegmentSegmenter::GetInitRangeStartAndEnd(uint64_t* start,
                                                     uint64_t* end) {
@@ -33,6 +36,8 @@ bool MultiSegmentSegmenter::GetIndexRangeStartAndEnd(uint64_t* start,
 
 Status MultiSegmentSegmenter::DoInitialize(scoped_ptr<MkvWriter> writer) {
   writer_ = writer.Pass();
+  if (!options().segment_template.empty())
+    segment_name_template_.Compile(options().segment_template);
   return WriteSegmentHeader(0, writer_.get());
 }
 
@@ -76,9 +81,8 @@ Status MultiSegmentSegmenter::NewSegment(uint64_t start_timescale) {
   }
 
   // Create a new file for the new segment.
-  std::string segment_name =
-      GetSegmentName(options().segment_template, start_timescale, num_segment_,
-                     options().bandwidth);
+  const std::string& segment_name = segment_name_template_.GetSegmentName(
+      start_timescale, num_segment_, options().bandwidth);
   writer_.reset(new MkvWriter);
   Status status = writer_->Open(segment_name);
   if (!status.ok())
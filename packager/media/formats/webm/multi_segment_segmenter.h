@@ -10,6 +10,7 @@
 #include "packager/media/formats/webm/segmenter.h"
 
 #include "packager/base/memory/scoped_ptr.h"
+#include "packager/media/base/muxer_util.h"
 #include "packager/media/base/status.h"
 #include "packager/media/formats/webm/mkv_writer.h"
 
@@ -47,6 +48,9 @@ class MultiSegmentSegmenter : public Segmenter {
 
   scoped_ptr<MkvWriter> writer_;
   uint32_t num_segment_;
+  // Segment name template compiled once at initialization; segment names
+  // are rendered from it for every segment.
+  SegmentNameTemplate segment_name_template_;
 
   DISALLOW_COPY_AND_ASSIGN(MultiSegmentSegmenter);
 };
@@ -6,6 +6,9 @@
 
 #include "packager/media/formats/webm/segmenter.h"
 
+#include "packager/base/bind.h"
+#include "packager/base/location.h"
+#include "packager/base/threading/worker_pool.h"
 #include "packager/base/time/time.h"
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/media_sample.h"
@@ -30,13 +33,20 @@ int64_t kSecondsToNs = 1000000000L;
 }  // namespace
 
 Segmenter::Segmenter(const MuxerOptions& options)
-    : reference_frame_timestamp_(0),
+    : has_deferred_boundary_(false),
+      deferred_boundary_is_new_segment_(true),
+      deferred_boundary_timescale_(0),
+      deferred_cluster_length_sec_(0),
+      has_pending_cluster_write_(false),
+      pending_write_event_(false, false),
+      reference_frame_timestamp_(0),
       options_(options),
       info_(NULL),
       muxer_listener_(NULL),
       progress_listener_(NULL),
       progress_target_(0),
       accumulated_progress_(0),
+      pending_progress_(0),
       first_timestamp_(0),
       sample_duration_(0),
       segment_payload_pos_(0),
@@ -44,7 +54,11 @@ Segmenter::Segmenter(const MuxerOptions& options)
       segment_length_sec_(0),
       track_id_(0) {}
 
-Segmenter::~Segmenter() {}
+Segmenter::~Segmenter() {
+  // The task accesses members; collect it before they are destroyed.
+  if (has_pending_cluster_write_)
+    pending_write_event_.Wait();
+}
 
 Status Segmenter::Initialize(scoped_ptr<MkvWriter> writer,
                              StreamInfo* info,
@@ -104,10 +118,24 @@ Status Segmenter::Initialize(scoped_ptr<MkvWriter> writer,
 }
 
 Status Segmenter::Finalize() {
-  Status status = WriteFrame(true /* write_duration */);
+  // Commit the final cluster in line: collect the in-flight write, apply the
+  // boundary it deferred, then write the remaining frames on this thread.
+  Status status = WaitForPendingClusterWrite();
+  if (status.ok())
+    status = ApplyDeferredBoundary();
+  if (status.ok()) {
+    writing_frames_.swap(pending_frames_);
+    writing_encrypt_flags_.swap(pending_encrypt_flags_);
+    status = WriteClusterFrames();
+    writing_frames_.clear();
+    writing_encrypt_flags_.clear();
+  }
   if (!status.ok())
     return status;
 
+  UpdateProgress(pending_progress_);
+  pending_progress_ = 0;
+
   uint64_t duration =
       prev_sample_->pts() - first_timestamp_ + prev_sample_->duration();
   segment_info_.set_duration(FromBMFFTimescale(duration));
@@ -122,57 +150,57 @@ Status Segmenter::AddSample(scoped_refptr<MediaSample> sample) {
       muxer_listener_->OnSampleDurationReady(sample_duration_);
   }
 
-  UpdateProgress(sample->duration());
-
-  // This writes frames in a delay.  Meaning that the previous frame is written
-  // on this call to AddSample.  The current frame is stored until the next
-  // call.  This is done to determine which frame is the last in a Cluster.
-  // This first block determines if this is a new Cluster and writes the
-  // previous frame first before creating the new Cluster.
+  // Progress is accumulated here and folded into UpdateProgress() at cluster
+  // boundaries; reporting it per sample is pure overhead.
+  pending_progress_ += sample->duration();
 
+  // Frames are buffered a whole cluster at a time and handed to a background
+  // task at cluster boundaries, so encryption and libwebm serialization of
+  // one cluster overlap with accumulating the next. This first block
+  // determines if this sample starts a new Cluster and commits the buffered
+  // frames first.
   Status status;
-  bool wrote_frame = false;
-  if (!cluster_) {
-    status = NewSegment(sample->pts());
-    // First frame, so no previous frame to write.
-    wrote_frame = true;
+  bool new_cluster = false;
+  if (!cluster_ && !has_deferred_boundary_) {
+    // First frame; record the boundary so the first cluster is created when
+    // its frames are committed.
+    has_deferred_boundary_ = true;
+    deferred_boundary_is_new_segment_ = true;
+    deferred_boundary_timescale_ = sample->pts();
+    deferred_cluster_length_sec_ = 0;
+    new_cluster = true;
   } else if (segment_length_sec_ >= options_.segment_duration) {
     if (sample->is_key_frame() || !options_.segment_sap_aligned) {
-      status = WriteFrame(true /* write_duration */);
-      status.Update(NewSegment(sample->pts()));
+      status = CommitPendingCluster(true /* is_new_segment */, sample->pts());
       segment_length_sec_ = 0;
       cluster_length_sec_ = 0;
-      wrote_frame = true;
+      new_cluster = true;
     }
   } else if (cluster_length_sec_ >= options_.fragment_duration) {
     if (sample->is_key_frame() || !options_.fragment_sap_aligned) {
-      status = WriteFrame(true /* write_duration */);
-      status.Update(NewSubsegment(sample->pts()));
+      status = CommitPendingCluster(false /* is_new_segment */, sample->pts());
       cluster_length_sec_ = 0;
-      wrote_frame = true;
+      new_cluster = true;
     }
   }
-  if (!wrote_frame) {
-    status = WriteFrame(false /* write_duration */);
-  }
   if (!status.ok())
     return status;
 
-  // Encrypt the frame.
+  if (new_cluster) {
+    UpdateProgress(pending_progress_);
+    pending_progress_ = 0;
+  }
+
+  bool encrypt_frame = false;
   if (encryptor_) {
-    const bool encrypt_frame =
-        static_cast<double>(sample->pts() - first_timestamp_) /
-            info_->time_scale() >=
-        clear_lead_;
-    status = encryptor_->EncryptFrame(sample, encrypt_frame);
-    if (!status.ok()) {
-      LOG(ERROR) << "Error encrypting frame.";
-      return status;
-    }
+    encrypt_frame = static_cast<double>(sample->pts() - first_timestamp_) /
+                        info_->time_scale() >=
+                    clear_lead_;
     if (encrypt_frame && muxer_listener_)
       muxer_listener_->OnEncryptionStart();
   }
-
+  pending_frames_.push_back(sample);
+  pending_encrypt_flags_.push_back(encrypt_frame);
 
   // Add the sample to the durations even though we have not written the frame
   // yet.  This is needed to make sure we split Clusters at the correct point.
@@ -365,35 +393,36 @@ Status Segmenter::InitializeEncryptor(KeySource* key_source,
   return encryptor_->Initialize(muxer_listener_, track_type, key_source);
 }
 
-Status Segmenter::WriteFrame(bool write_duration) {
+Status Segmenter::WriteFrame(const scoped_refptr<MediaSample>& sample,
+                             bool write_duration) {
   // Create a frame manually so we can create non-SimpleBlock frames.  This
   // is required to allow the frame duration to be added.  If the duration
   // is not set, then a SimpleBlock will still be written.
   mkvmuxer::Frame frame;
 
-  if (!frame.Init(prev_sample_->data(), prev_sample_->data_size())) {
+  if (!frame.Init(sample->data(), sample->data_size())) {
     return Status(error::MUXER_FAILURE,
                   "Error adding sample to segment: Frame::Init failed");
   }
 
   if (write_duration) {
     const uint64_t duration_ns =
-        prev_sample_->duration() * kSecondsToNs / info_->time_scale();
+        sample->duration() * kSecondsToNs / info_->time_scale();
     frame.set_duration(duration_ns);
   }
-  frame.set_is_key(prev_sample_->is_key_frame());
-  frame.set_timestamp(prev_sample_->pts() * kSecondsToNs / info_->time_scale());
+  frame.set_is_key(sample->is_key_frame());
+  frame.set_timestamp(sample->pts() * kSecondsToNs / info_->time_scale());
   frame.set_track_number(track_id_);
 
-  if (prev_sample_->side_data_size() > 0) {
+  if (sample->side_data_size() > 0) {
     uint64_t block_add_id;
     // First 8 bytes of side_data is the BlockAddID element's value, which is
     // done to mimic ffmpeg behavior. See webm_cluster_parser.cc for details.
-    CHECK_GT(prev_sample_->side_data_size(), sizeof(block_add_id));
-    memcpy(&block_add_id, prev_sample_->side_data(), sizeof(block_add_id));
+    CHECK_GT(sample->side_data_size(), sizeof(block_add_id));
+    memcpy(&block_add_id, sample->side_data(), sizeof(block_add_id));
     if (!frame.AddAdditionalData(
-            prev_sample_->side_data() + sizeof(block_add_id),
-            prev_sample_->side_data_size() - sizeof(block_add_id),
+            sample->side_data() + sizeof(block_add_id),
+            sample->side_data_size() - sizeof(block_add_id),
             block_add_id)) {
       return Status(
           error::MUXER_FAILURE,
@@ -401,7 +430,7 @@ Status Segmenter::WriteFrame(bool write_duration) {
     }
   }
 
-  if (!prev_sample_->is_key_frame() && !frame.CanBeSimpleBlock()) {
+  if (!sample->is_key_frame() && !frame.CanBeSimpleBlock()) {
     const int64_t timestamp_ns =
         reference_frame_timestamp_ * kSecondsToNs / info_->time_scale();
     frame.set_reference_block_timestamp(timestamp_ns);
@@ -427,10 +456,95 @@ Status Segmenter::WriteFrame(bool write_duration) {
   // A reference frame is needed for non-keyframes.  Having a reference to the
   // previous block is good enough.
   // See libwebm Segment::AddGenericFrame
-  reference_frame_timestamp_ = prev_sample_->pts();
+  reference_frame_timestamp_ = sample->pts();
   return Status::OK;
 }
 
+Status Segmenter::CommitPendingCluster(bool is_new_segment,
+                                       uint64_t next_start_timescale) {
+  // Clusters commit in order: collect the previous cluster's write before
+  // issuing the next one.
+  Status status = WaitForPendingClusterWrite();
+  if (!status.ok())
+    return status;
+  status = ApplyDeferredBoundary();
+  if (!status.ok())
+    return status;
+
+  // Record the boundary that starts the next cluster; it is applied at the
+  // next commit, when the position the buffered frames end at is known.
+  has_deferred_boundary_ = true;
+  deferred_boundary_is_new_segment_ = is_new_segment;
+  deferred_boundary_timescale_ = next_start_timescale;
+  deferred_cluster_length_sec_ = cluster_length_sec_;
+
+  writing_frames_.swap(pending_frames_);
+  writing_encrypt_flags_.swap(pending_encrypt_flags_);
+  has_pending_cluster_write_ = true;
+  base::WorkerPool::PostTask(
+      FROM_HERE,
+      base::Bind(&Segmenter::WriteClusterTask, base::Unretained(this)),
+      true /* task_is_slow */);
+  return Status::OK;
+}
+
+Status Segmenter::WaitForPendingClusterWrite() {
+  if (!has_pending_cluster_write_)
+    return Status::OK;
+  pending_write_event_.Wait();
+  has_pending_cluster_write_ = false;
+  writing_frames_.clear();
+  writing_encrypt_flags_.clear();
+  return pending_cluster_status_;
+}
+
+Status Segmenter::ApplyDeferredBoundary() {
+  if (!has_deferred_boundary_)
+    return Status::OK;
+  has_deferred_boundary_ = false;
+
+  // The subclass hooks read cluster_length_sec() for the cluster they
+  // finalize; restore the value recorded when the boundary was deferred.
+  const double current_cluster_length_sec = cluster_length_sec_;
+  cluster_length_sec_ = deferred_cluster_length_sec_;
+  Status status = deferred_boundary_is_new_segment_
+                      ? NewSegment(deferred_boundary_timescale_)
+                      : NewSubsegment(deferred_boundary_timescale_);
+  cluster_length_sec_ = current_cluster_length_sec;
+  return status;
+}
+
+Status Segmenter::WriteClusterFrames() {
+  if (writing_frames_.empty())
+    return Status::OK;
+
+  if (encryptor_) {
+    const uint32_t num_threads =
+        options_.num_encryption_threads > 1 ? options_.num_encryption_threads
+                                            : 1;
+    Status status = encryptor_->EncryptFrames(writing_frames_,
+                                              writing_encrypt_flags_,
+                                              num_threads);
+    if (!status.ok()) {
+      LOG(ERROR) << "Error encrypting frames.";
+      return status;
+    }
+  }
+
+  for (size_t i = 0; i < writing_frames_.size(); ++i) {
+    const bool last_frame = i + 1 == writing_frames_.size();
+    Status status = WriteFrame(writing_frames_[i], last_frame);
+    if (!status.ok())
+      return status;
+  }
+  return Status::OK;
+}
+
+void Segmenter::WriteClusterTask() {
+  pending_cluster_status_ = WriteClusterFrames();
+  pending_write_event_.Signal();
+}
+
 }  // namespace webm
 }  // namespace media
 }  // namespace shaka
@@ -7,8 +7,11 @@
 #ifndef MEDIA_FORMATS_WEBM_SEGMENTER_H_
 #define MEDIA_FORMATS_WEBM_SEGMENTER_H_
 
+#include <vector>
+
 #include "packager/base/memory/ref_counted.h"
 #include "packager/base/memory/scoped_ptr.h"
+#include "packager/base/synchronization/waitable_event.h"
 #include "packager/media/base/status.h"
 #include "packager/media/formats/webm/encryptor.h"
 #include "packager/media/formats/webm/mkv_writer.h"
@@ -109,13 +112,41 @@ class Segmenter {
   virtual Status DoInitialize(scoped_ptr<MkvWriter> writer) = 0;
   virtual Status DoFinalize() = 0;
 
+  /// Collects the in-flight cluster write, if any, and returns its status.
+  /// Subclass destructors must call this before destroying their writer,
+  /// which the write task may still be using.
+  Status WaitForPendingClusterWrite();
+
  private:
   Status CreateVideoTrack(VideoStreamInfo* info);
   Status CreateAudioTrack(AudioStreamInfo* info);
   Status InitializeEncryptor(KeySource* key_source, uint32_t max_sd_pixels);
 
-  // Writes the previous frame to the file.
-  Status WriteFrame(bool write_duration);
+  // Writes the given frame to the current cluster.
+  Status WriteFrame(const scoped_refptr<MediaSample>& sample,
+                    bool write_duration);
+
+  // Hands the frames buffered for the cluster that just ended to a
+  // background task and records the boundary that starts the next cluster.
+  // Clusters commit in order: the previous task is collected, and the
+  // boundary recorded at the previous hand-off is applied, before the new
+  // task is posted.
+  Status CommitPendingCluster(bool is_new_segment,
+                              uint64_t next_start_timescale);
+
+  // Applies the boundary recorded by the previous CommitPendingCluster()
+  // call: calls NewSegment()/NewSubsegment(), which finalizes the cluster the
+  // collected task wrote and creates the cluster the buffered frames belong
+  // to, now that the writer position is final.
+  Status ApplyDeferredBoundary();
+
+  // Encrypts |writing_frames_| across the configured encryption threads (if
+  // an encryptor is set), then writes them to the current cluster; the last
+  // frame is written with its duration.
+  Status WriteClusterFrames();
+  // Background entry point for WriteClusterFrames(); see
+  // CommitPendingCluster().
+  void WriteClusterTask();
 
   // This is called when there needs to be a new subsegment.  This does nothing
   // in single-segment mode.  In multi-segment mode this creates a new Cluster
@@ -126,8 +157,31 @@ class Segmenter {
   // creates a new output file.
   virtual Status NewSegment(uint64_t start_timescale) = 0;
 
-  // Store the previous sample so we know which one is the last frame.
+  // The last sample seen; used to compute the stream duration in Finalize().
   scoped_refptr<MediaSample> prev_sample_;
+  // Frames of the cluster being accumulated, with their per-frame encrypt
+  // flags (clear lead frames only get the clear signal byte). Clusters are
+  // assembled a whole cluster at a time so encryption and libwebm
+  // serialization run on a background task; see CommitPendingCluster().
+  std::vector<scoped_refptr<MediaSample>> pending_frames_;
+  std::vector<bool> pending_encrypt_flags_;
+  // Frames owned by the in-flight cluster write task; only touched by the
+  // muxer thread after WaitForPendingClusterWrite().
+  std::vector<scoped_refptr<MediaSample>> writing_frames_;
+  std::vector<bool> writing_encrypt_flags_;
+  // Boundary recorded at the last cluster hand-off; see
+  // ApplyDeferredBoundary().
+  bool has_deferred_boundary_;
+  bool deferred_boundary_is_new_segment_;
+  uint64_t deferred_boundary_timescale_;
+  // cluster_length_sec_ of the cluster the deferred boundary finalizes,
+  // restored around the NewSegment()/NewSubsegment() call.
+  double deferred_cluster_length_sec_;
+  // In-flight cluster write state; mirrors the MP4 segmenter's pending
+  // segment write.
+  bool has_pending_cluster_write_;
+  Status pending_cluster_status_;
+  base::WaitableEvent pending_write_event_;
   // The reference frame timestamp; used to populate the ReferenceBlock element
   // when writing non-keyframe BlockGroups.
   uint64_t reference_frame_timestamp_;
@@ -147,6 +201,9 @@ class Segmenter {
   ProgressListener* progress_listener_;
   uint64_t progress_target_;
   uint64_t accumulated_progress_;
+  // Progress accumulated since the last UpdateProgress() call; folded in at
+  // cluster boundaries instead of per sample.
+  uint64_t pending_progress_;
   uint64_t first_timestamp_;
   int64_t sample_duration_;
   // The position (in bytes) of the start of the Segment payload in the init
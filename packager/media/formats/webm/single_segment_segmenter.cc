@@ -6,41 +6,104 @@
 
 #include "packager/media/formats/webm/single_segment_segmenter.h"
 
+#include "packager/base/logging.h"
 #include "packager/media/base/muxer_options.h"
+#include "packager/media/base/stream_info.h"
 #include "packager/third_party/libwebm/src/mkvmuxer.hpp"
+#include "packager/third_party/libwebm/src/mkvmuxerutil.hpp"
 
 namespace shaka {
 namespace media {
 namespace webm {
 
 SingleSegmentSegmenter::SingleSegmentSegmenter(const MuxerOptions& options)
-    : Segmenter(options), init_end_(0), index_start_(0) {}
-
-SingleSegmentSegmenter::~SingleSegmentSegmenter() {}
+    : Segmenter(options),
+      init_end_(0),
+      index_start_(0),
+      reserve_cues_space_(options.webm_reserve_cues_space),
+      reserved_cues_pos_(0),
+      reserved_cues_size_(0) {}
+
+SingleSegmentSegmenter::~SingleSegmentSegmenter() {
+  // An in-flight cluster write may still be using |writer_|.
+  WaitForPendingClusterWrite();
+}
 
 Status SingleSegmentSegmenter::DoInitialize(scoped_ptr<MkvWriter> writer) {
   writer_ = writer.Pass();
   Status ret = WriteSegmentHeader(0, writer_.get());
+  if (!ret.ok())
+    return ret;
   init_end_ = writer_->Position() - 1;
-  seek_head()->set_cluster_pos(init_end_ + 1 - segment_payload_pos());
-  return ret;
+
+  if (reserve_cues_space_) {
+    reserved_cues_size_ = EstimateCuesSize();
+    if (reserved_cues_size_ == 0) {
+      LOG(WARNING) << "Cannot estimate the Cues size (unknown input duration "
+                      "or no segment duration); the Cues will be written at "
+                      "the end of the file.";
+    }
+  }
+  if (reserved_cues_size_ > 0) {
+    // Occupy the reserved space with a Void element; DoFinalize() replaces it
+    // with the Cues, so the index ends up in front of the media data without
+    // another pass over the file.
+    reserved_cues_pos_ = writer_->Position();
+    if (mkvmuxer::WriteVoidElement(writer_.get(), reserved_cues_size_) == 0)
+      return Status(error::FILE_FAILURE, "Error reserving Cues space.");
+  }
+
+  seek_head()->set_cluster_pos(writer_->Position() - segment_payload_pos());
+  return Status::OK;
 }
 
 Status SingleSegmentSegmenter::DoFinalize() {
   if (!cluster()->Finalize())
     return Status(error::FILE_FAILURE, "Error finalizing cluster.");
 
-  // Write the Cues to the end of the file.
-  index_start_ = writer_->Position();
-  seek_head()->set_cues_pos(index_start_ - segment_payload_pos());
-  if (!cues()->Write(writer_.get()))
-    return Status(error::FILE_FAILURE, "Error writing Cues data.");
+  const uint64_t cluster_end = writer_->Position();
+  const uint64_t cues_size = cues()->Size();
+  // A Void element takes at least 2 bytes, so a 1 byte remainder cannot be
+  // padded and the reservation does not fit.
+  const bool cues_fit = reserved_cues_size_ > 0 &&
+                        cues_size <= reserved_cues_size_ &&
+                        reserved_cues_size_ - cues_size != 1;
+  if (reserved_cues_size_ > 0 && !cues_fit) {
+    LOG(WARNING) << "The Cues do not fit in the reserved space (" << cues_size
+                 << " vs " << reserved_cues_size_
+                 << " bytes); writing the Cues at the end of the file instead.";
+  }
+
+  uint64_t file_size;
+  if (cues_fit) {
+    // Write the Cues into the space reserved by DoInitialize(), padding any
+    // remainder with a Void element.
+    index_start_ = reserved_cues_pos_;
+    seek_head()->set_cues_pos(index_start_ - segment_payload_pos());
+    if (writer_->Position(index_start_) != 0)
+      return Status(error::FILE_FAILURE, "Error seeking to the Cues space.");
+    if (!cues()->Write(writer_.get()))
+      return Status(error::FILE_FAILURE, "Error writing Cues data.");
+    index_end_ = writer_->Position() - 1;
+    if (cues_size < reserved_cues_size_ &&
+        mkvmuxer::WriteVoidElement(writer_.get(),
+                                   reserved_cues_size_ - cues_size) == 0) {
+      return Status(error::FILE_FAILURE, "Error padding Cues space.");
+    }
+    file_size = cluster_end;
+  } else {
+    // Write the Cues to the end of the file.
+    index_start_ = cluster_end;
+    seek_head()->set_cues_pos(index_start_ - segment_payload_pos());
+    if (!cues()->Write(writer_.get()))
+      return Status(error::FILE_FAILURE, "Error writing Cues data.");
+    index_end_ = writer_->Position() - 1;
+    file_size = index_end_ + 1;
+  }
 
-  // The WebM index is at the end of the file.
-  index_end_ = writer_->Position() - 1;
   writer_->Position(0);
 
-  Status status = WriteSegmentHeader(index_end_ + 1, writer_.get());
+  Status status = WriteSegmentHeader(file_size, writer_.get());
   status.Update(writer_->Close());
   return status;
 }
@@ -78,13 +141,36 @@ bool SingleSegmentSegmenter::GetInitRangeStartAndEnd(uint64_t* start,
 
 bool SingleSegmentSegmenter::GetIndexRangeStartAndEnd(uint64_t* start,
                                                       uint64_t* end) {
-  // The index is the Cues element, which is always placed at the end of the
-  // file.
+  // The index is the Cues element, placed at the end of the file or, with
+  // webm_reserve_cues_space, in the reserved space in front of the clusters.
   *start = index_start_;
   *end = index_end_;
   return true;
 }
 
+uint64_t SingleSegmentSegmenter::EstimateCuesSize() {
+  if (info()->duration() == 0 || info()->time_scale() == 0 ||
+      options().segment_duration <= 0) {
+    return 0;
+  }
+  // Generous upper bound for a CuePoint: CueTime plus CueTrackPositions with
+  // CueTrack, CueClusterPosition and CueBlockNumber, all with worst-case
+  // 8-byte integer payloads.
+  const uint64_t kMaxBytesPerCuePoint = 48;
+  // Cues element ID (4 bytes) plus up to 8 size bytes.
+  const uint64_t kCuesElementHeaderSize = 12;
+  const double duration_in_seconds =
+      static_cast<double>(info()->duration()) / info()->time_scale();
+  // One CuePoint is added per cluster. Over-estimate the count since clusters
+  // can end up shorter than requested, e.g. with SAP alignment.
+  const uint64_t max_cue_points =
+      2 * static_cast<uint64_t>(duration_in_seconds /
+                                    options().segment_duration +
+                                1) +
+      16;
+  return kCuesElementHeaderSize + max_cue_points * kMaxBytesPerCuePoint;
+}
+
 }  // namespace webm
 }  // namespace media
 }  // namespace shaka
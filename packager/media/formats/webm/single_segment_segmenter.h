@@ -40,6 +40,9 @@ class SingleSegmentSegmenter : public Segmenter {
   void set_index_start(uint64_t start) { index_start_ = start; }
   void set_index_end(uint64_t end) { index_end_ = end; }
   void set_writer(scoped_ptr<MkvWriter> writer) { writer_ = writer.Pass(); }
+  // Allows subclasses that do not write the output in place to disable the
+  // Cues space reservation, which requires seeking back at finalization.
+  void set_reserve_cues_space(bool value) { reserve_cues_space_ = value; }
 
   // Segmenter implementation overrides.
   Status DoInitialize(scoped_ptr<MkvWriter> writer) override;
@@ -50,10 +53,20 @@ class SingleSegmentSegmenter : public Segmenter {
   Status NewSubsegment(uint64_t start_timescale) override;
   Status NewSegment(uint64_t start_timescale) override;
 
+  // Estimates an upper bound for the size of the Cues element from the input
+  // duration and the segment duration. Returns 0 if no estimate is possible.
+  uint64_t EstimateCuesSize();
+
   scoped_ptr<MkvWriter> writer_;
   uint64_t init_end_;
   uint64_t index_start_;
   uint64_t index_end_;
+  // Whether to reserve space for the Cues in front of the media data, sized
+  // by EstimateCuesSize(), and fill it in at finalization. When unset, or
+  // when the written Cues would not fit, the Cues go to the end of the file.
+  bool reserve_cues_space_;
+  uint64_t reserved_cues_pos_;
+  uint64_t reserved_cues_size_;
 
   DISALLOW_COPY_AND_ASSIGN(SingleSegmentSegmenter);
 };
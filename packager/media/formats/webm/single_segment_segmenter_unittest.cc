@@ -258,6 +258,38 @@ TEST_P(SingleSegmentSegmenterTest, RespectsSAPAlign) {
   EXPECT_EQ(4, parser.GetFrameCountForCluster(1));
 }
 
+TEST_P(SingleSegmentSegmenterTest, ReservesCuesSpaceInFront) {
+  MuxerOptions options = CreateMuxerOptions();
+  options.webm_reserve_cues_space = true;
+  options.segment_duration = 4.5;  // seconds
+  ASSERT_NO_FATAL_FAILURE(InitializeSegmenter(options));
+
+  // Write the samples to the Segmenter.
+  for (int i = 0; i < 8; i++) {
+    scoped_refptr<MediaSample> sample =
+        CreateSample(kKeyFrame, kDuration, kNoSideData);
+    ASSERT_OK(segmenter_->AddSample(sample));
+  }
+  ASSERT_OK(segmenter_->Finalize());
+
+  // The media data must be intact with the Cues space reserved.
+  ClusterParser parser;
+  ASSERT_NO_FATAL_FAILURE(parser.PopulateFromSegment(OutputFileName()));
+  ASSERT_EQ(2, parser.cluster_count());
+  EXPECT_EQ(5, parser.GetFrameCountForCluster(0));
+  EXPECT_EQ(3, parser.GetFrameCountForCluster(1));
+
+  if (!GetParam()) {
+    // With a seekable output, the Cues are placed right after the header.
+    // The two-pass segmenter ignores the option and keeps them at the end.
+    uint64_t init_start, init_end, index_start, index_end;
+    ASSERT_TRUE(segmenter_->GetInitRangeStartAndEnd(&init_start, &init_end));
+    ASSERT_TRUE(segmenter_->GetIndexRangeStartAndEnd(&index_start, &index_end));
+    EXPECT_EQ(init_end + 1, index_start);
+    EXPECT_GT(index_end, index_start);
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(TrueIsTwoPass,
                         SingleSegmentSegmenterTest,
                         ::testing::Bool());
@@ -67,7 +67,15 @@ bool ReadSkip(File* file, int64_t byte_count) {
 
 TwoPassSingleSegmentSegmenter::TwoPassSingleSegmentSegmenter(
     const MuxerOptions& options)
-    : SingleSegmentSegmenter(options) {}
+    : SingleSegmentSegmenter(options) {
+  if (options.webm_reserve_cues_space) {
+    LOG(WARNING)
+        << "--webm_reserve_cues_space is ignored for non-seekable output.";
+  }
+  // Filling the reserved space in requires seeking back into the output,
+  // which this segmenter exists to avoid.
+  set_reserve_cues_space(false);
+}
 
 TwoPassSingleSegmentSegmenter::~TwoPassSingleSegmentSegmenter() {}
 
@@ -9,6 +9,7 @@
 #include "packager/base/logging.h"
 #include "packager/base/sys_byteorder.h"
 #include "packager/media/base/decrypt_config.h"
+#include "packager/media/base/shared_buffer.h"
 #include "packager/media/base/timestamp.h"
 #include "packager/media/codecs/vp8_parser.h"
 #include "packager/media/codecs/vp9_parser.h"
@@ -149,15 +150,14 @@ WebMParserClient* WebMClusterParser::OnListStart(int id) {
     cluster_timecode_ = -1;
     cluster_start_time_ = kNoTimestamp;
   } else if (id == kWebMIdBlockGroup) {
-    block_data_.reset();
+    block_data_.clear();
     block_data_size_ = -1;
     block_duration_ = -1;
     discard_padding_ = -1;
     discard_padding_set_ = false;
   } else if (id == kWebMIdBlockAdditions) {
     block_add_id_ = -1;
-    block_additional_data_.reset();
-    block_additional_data_size_ = 0;
+    block_additional_data_.clear();
   }
 
   return this;
@@ -173,16 +173,16 @@ bool WebMClusterParser::OnListEnd(int id) {
     return false;
   }
 
-  bool result = ParseBlock(false, block_data_.get(), block_data_size_,
-                           block_additional_data_.get(),
-                           block_additional_data_size_, block_duration_,
-                           discard_padding_set_ ? discard_padding_ : 0);
-  block_data_.reset();
+  bool result = ParseBlock(
+      false, block_data_.data(), block_data_size_, &block_data_,
+      block_additional_data_.empty() ? NULL : block_additional_data_.data(),
+      block_additional_data_.size(), block_duration_,
+      discard_padding_set_ ? discard_padding_ : 0);
+  block_data_.clear();
   block_data_size_ = -1;
   block_duration_ = -1;
   block_add_id_ = -1;
-  block_additional_data_.reset();
-  block_additional_data_size_ = 0;
+  block_additional_data_.clear();
   discard_padding_ = -1;
   discard_padding_set_ = false;
   return result;
@@ -212,6 +212,7 @@ bool WebMClusterParser::OnUInt(int id, int64_t val) {
 bool WebMClusterParser::ParseBlock(bool is_simple_block,
                                    const uint8_t* buf,
                                    int size,
+                                   std::vector<uint8_t>* buf_owner,
                                    const uint8_t* additional,
                                    int additional_size,
                                    int duration,
@@ -243,29 +244,28 @@ bool WebMClusterParser::ParseBlock(bool is_simple_block,
   const uint8_t* frame_data = buf + 4;
   int frame_size = size - (frame_data - buf);
   return OnBlock(is_simple_block, track_num, timecode, duration, flags,
-                 frame_data, frame_size, additional, additional_size,
+                 frame_data, frame_size, buf_owner, additional, additional_size,
                  discard_padding);
 }
 
 bool WebMClusterParser::OnBinary(int id, const uint8_t* data, int size) {
   switch (id) {
     case kWebMIdSimpleBlock:
-      return ParseBlock(true, data, size, NULL, 0, -1, 0);
+      return ParseBlock(true, data, size, NULL, NULL, 0, -1, 0);
 
     case kWebMIdBlock:
-      if (block_data_) {
+      if (block_data_size_ != -1) {
         LOG(ERROR) << "More than 1 Block in a BlockGroup is not "
                       "supported.";
         return false;
       }
-      block_data_.reset(new uint8_t[size]);
-      memcpy(block_data_.get(), data, size);
+      block_data_.assign(data, data + size);
       block_data_size_ = size;
       return true;
 
     case kWebMIdBlockAdditional: {
       uint64_t block_add_id = base::HostToNet64(block_add_id_);
-      if (block_additional_data_) {
+      if (!block_additional_data_.empty()) {
         // TODO: Technically, more than 1 BlockAdditional is allowed as per
         // matroska spec. But for now we don't have a use case to support
         // parsing of such files. Take a look at this again when such a case
@@ -277,11 +277,13 @@ bool WebMClusterParser::OnBinary(int id, const uint8_t* data, int size) {
       // First 8 bytes of side_data in DecoderBuffer is the BlockAddID
       // element's value in Big Endian format. This is done to mimic ffmpeg
       // demuxer's behavior.
-      block_additional_data_size_ = size + sizeof(block_add_id);
-      block_additional_data_.reset(new uint8_t[block_additional_data_size_]);
-      memcpy(block_additional_data_.get(), &block_add_id,
-             sizeof(block_add_id));
-      memcpy(block_additional_data_.get() + 8, data, size);
+      const uint8_t* block_add_id_bytes =
+          reinterpret_cast<const uint8_t*>(&block_add_id);
+      block_additional_data_.reserve(sizeof(block_add_id) + size);
+      block_additional_data_.assign(block_add_id_bytes,
+                                    block_add_id_bytes + sizeof(block_add_id));
+      block_additional_data_.insert(block_additional_data_.end(), data,
+                                    data + size);
       return true;
     }
     case kWebMIdDiscardPadding: {
@@ -308,6 +310,7 @@ bool WebMClusterParser::OnBlock(bool is_simple_block,
                                 int flags,
                                 const uint8_t* data,
                                 int size,
+                                std::vector<uint8_t>* buf_owner,
                                 const uint8_t* additional,
                                 int additional_size,
                                 int64_t discard_padding) {
@@ -387,8 +390,21 @@ bool WebMClusterParser::OnBlock(bool is_simple_block,
       return false;
     }
 
-    buffer = MediaSample::CopyFrom(data + data_offset, size - data_offset,
-                                   additional, additional_size, is_keyframe);
+    const int frame_size = size - data_offset;
+    if (buf_owner && additional_size == 0 && frame_size > 0) {
+      // The block bytes were already copied out of the input window when the
+      // BlockGroup was buffered; hand them to the sample as a refcounted view
+      // instead of copying them a second time. The offset must be computed
+      // before the move empties |*buf_owner|.
+      const size_t payload_offset = (data - buf_owner->data()) + data_offset;
+      scoped_refptr<SharedBuffer> shared_buffer(
+          SharedBuffer::MoveFrom(buf_owner));
+      buffer = MediaSample::CreateView(shared_buffer, payload_offset,
+                                       frame_size, is_keyframe);
+    } else {
+      buffer = MediaSample::CopyFrom(data + data_offset, frame_size, additional,
+                                     additional_size, is_keyframe);
+    }
 
     // An empty iv indicates that this sample is not encrypted.
     if (decrypt_config && !decrypt_config->iv().empty()) {
@@ -404,6 +420,8 @@ bool WebMClusterParser::OnBlock(bool is_simple_block,
         return false;
       }
     }
+    if (decrypt_config)
+      DecryptConfig::Recycle(decrypt_config.Pass());
   } else {
     std::string id, settings, content;
     WebMWebVTTParser::Parse(data, size, &id, &settings, &content);
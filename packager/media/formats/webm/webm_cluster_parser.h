@@ -9,6 +9,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "packager/base/compiler_specific.h"
 #include "packager/base/memory/scoped_ptr.h"
@@ -157,9 +158,13 @@ class WebMClusterParser : public WebMParserClient {
   bool OnUInt(int id, int64_t val) override;
   bool OnBinary(int id, const uint8_t* data, int size) override;
 
+  // |buf_owner|, if not NULL, points to the parser-owned vector holding
+  // |buf|; the block payload may then be handed to the emitted sample without
+  // copying, which empties the vector.
   bool ParseBlock(bool is_simple_block,
                   const uint8_t* buf,
                   int size,
+                  std::vector<uint8_t>* buf_owner,
                   const uint8_t* additional,
                   int additional_size,
                   int duration,
@@ -171,6 +176,7 @@ class WebMClusterParser : public WebMParserClient {
                int flags,
                const uint8_t* data,
                int size,
+               std::vector<uint8_t>* buf_owner,
                const uint8_t* additional,
                int additional_size,
                int64_t discard_padding);
@@ -202,15 +208,20 @@ class WebMClusterParser : public WebMParserClient {
   MediaParser::InitCB init_cb_;
 
   int64_t last_block_timecode_ = -1;
-  scoped_ptr<uint8_t[]> block_data_;
+  // Holds the Block bytes of the BlockGroup currently being parsed, since the
+  // input window may not cover the whole BlockGroup. The vector is reused
+  // across BlockGroups so steady-state parsing does not allocate per block;
+  // it is emptied when its bytes are handed off to the emitted sample.
+  // |block_data_size_| is -1 until a Block is seen in the current BlockGroup.
+  std::vector<uint8_t> block_data_;
   int block_data_size_ = -1;
   int64_t block_duration_ = -1;
   int64_t block_add_id_ = -1;
 
-  scoped_ptr<uint8_t[]> block_additional_data_;
-  // Must be 0 if |block_additional_data_| is null. Must be > 0 if
-  // |block_additional_data_| is NOT null.
-  int block_additional_data_size_ = 0;
+  // BlockAddID (in big endian) followed by the BlockAdditional bytes of the
+  // current BlockGroup. Empty if there is no BlockAdditional. Reused across
+  // BlockGroups like |block_data_|.
+  std::vector<uint8_t> block_additional_data_;
 
   int64_t discard_padding_ = -1;
   bool discard_padding_set_ = false;
@@ -52,10 +52,10 @@ bool WebMCreateDecryptConfig(const uint8_t* data,
     frame_offset += kWebMIvSize;
   }
 
-  decrypt_config->reset(new DecryptConfig(
+  *decrypt_config = DecryptConfig::Create(
       std::vector<uint8_t>(key_id, key_id + key_id_size),
       std::vector<uint8_t>(counter_block.begin(), counter_block.end()),
-      std::vector<SubsampleEntry>()));
+      std::vector<SubsampleEntry>());
   *data_offset = frame_offset;
 
   return true;
@@ -11,6 +11,7 @@
 // encrypted request for comments specification is here
 // http://wiki.webmproject.org/encryption/webm-encryption-rfc
 
+#include <algorithm>
 #include <iomanip>
 
 #include "packager/base/logging.h"
@@ -47,25 +48,27 @@ struct ListElementInfo {
 // appear in the list, a parsing error is signalled. Some elements are
 // marked as SKIP because they are valid, but we don't care about them
 // right now.
+// The entries of each table are sorted by the numeric value of the ID so
+// lookups can binary search.
 static const ElementIdInfo kEBMLHeaderIds[] = {
+  {STRING, kWebMIdDocType},
+  {UINT, kWebMIdDocTypeReadVersion},
   {UINT, kWebMIdEBMLVersion},
-  {UINT, kWebMIdEBMLReadVersion},
+  {UINT, kWebMIdDocTypeVersion},
   {UINT, kWebMIdEBMLMaxIDLength},
   {UINT, kWebMIdEBMLMaxSizeLength},
-  {STRING, kWebMIdDocType},
-  {UINT, kWebMIdDocTypeVersion},
-  {UINT, kWebMIdDocTypeReadVersion},
+  {UINT, kWebMIdEBMLReadVersion},
 };
 
 static const ElementIdInfo kSegmentIds[] = {
+  {LIST, kWebMIdChapters},
   {LIST, kWebMIdSeekHead},
+  {LIST, kWebMIdTags},
   {LIST, kWebMIdInfo},
-  {LIST, kWebMIdCluster},
   {LIST, kWebMIdTracks},
-  {LIST, kWebMIdCues},
   {LIST, kWebMIdAttachments},
-  {LIST, kWebMIdChapters},
-  {LIST, kWebMIdTags},
+  {LIST, kWebMIdCues},
+  {LIST, kWebMIdCluster},
 };
 
 static const ElementIdInfo kSeekHeadIds[] = {
@@ -78,35 +81,35 @@ static const ElementIdInfo kSeekIds[] = {
 };
 
 static const ElementIdInfo kInfoIds[] = {
-  {BINARY, kWebMIdSegmentUID},
-  {STRING, kWebMIdSegmentFilename},
-  {BINARY, kWebMIdPrevUID},
-  {STRING, kWebMIdPrevFilename},
-  {BINARY, kWebMIdNextUID},
-  {STRING, kWebMIdNextFilename},
   {BINARY, kWebMIdSegmentFamily},
-  {LIST, kWebMIdChapterTranslate},
-  {UINT, kWebMIdTimecodeScale},
-  {FLOAT, kWebMIdDuration},
   {BINARY, kWebMIdDateUTC},
-  {STRING, kWebMIdTitle},
+  {FLOAT, kWebMIdDuration},
   {STRING, kWebMIdMuxingApp},
   {STRING, kWebMIdWritingApp},
+  {LIST, kWebMIdChapterTranslate},
+  {STRING, kWebMIdSegmentFilename},
+  {BINARY, kWebMIdSegmentUID},
+  {STRING, kWebMIdTitle},
+  {UINT, kWebMIdTimecodeScale},
+  {STRING, kWebMIdPrevFilename},
+  {BINARY, kWebMIdPrevUID},
+  {STRING, kWebMIdNextFilename},
+  {BINARY, kWebMIdNextUID},
 };
 
 static const ElementIdInfo kChapterTranslateIds[] = {
-  {UINT, kWebMIdChapterTranslateEditionUID},
-  {UINT, kWebMIdChapterTranslateCodec},
   {BINARY, kWebMIdChapterTranslateID},
+  {UINT, kWebMIdChapterTranslateCodec},
+  {UINT, kWebMIdChapterTranslateEditionUID},
 };
 
 static const ElementIdInfo kClusterIds[] = {
+  {LIST, kWebMIdBlockGroup},
   {BINARY, kWebMIdSimpleBlock},
-  {UINT, kWebMIdTimecode},
-  {LIST, kWebMIdSilentTracks},
   {UINT, kWebMIdPosition},
   {UINT, kWebMIdPrevSize},
-  {LIST, kWebMIdBlockGroup},
+  {UINT, kWebMIdTimecode},
+  {LIST, kWebMIdSilentTracks},
 };
 
 static const ElementIdInfo kSilentTracksIds[] = {
@@ -114,14 +117,14 @@ static const ElementIdInfo kSilentTracksIds[] = {
 };
 
 static const ElementIdInfo kBlockGroupIds[] = {
-  {BINARY, kWebMIdBlock},
-  {LIST, kWebMIdBlockAdditions},
+  {LIST, kWebMIdSlices},
   {UINT, kWebMIdBlockDuration},
+  {BINARY, kWebMIdBlock},
+  {BINARY, kWebMIdCodecState},
   {UINT, kWebMIdReferencePriority},
   {BINARY, kWebMIdReferenceBlock},
-  {BINARY, kWebMIdCodecState},
+  {LIST, kWebMIdBlockAdditions},
   {BINARY, kWebMIdDiscardPadding},
-  {LIST, kWebMIdSlices},
 };
 
 static const ElementIdInfo kBlockAdditionsIds[] = {
@@ -129,8 +132,8 @@ static const ElementIdInfo kBlockAdditionsIds[] = {
 };
 
 static const ElementIdInfo kBlockMoreIds[] = {
-  {UINT, kWebMIdBlockAddID},
   {BINARY, kWebMIdBlockAdditional},
+  {UINT, kWebMIdBlockAddID},
 };
 
 static const ElementIdInfo kSlicesIds[] = {
@@ -146,64 +149,64 @@ static const ElementIdInfo kTracksIds[] = {
 };
 
 static const ElementIdInfo kTrackEntryIds[] = {
-  {UINT, kWebMIdTrackNumber},
-  {BINARY, kWebMIdTrackUID},
   {UINT, kWebMIdTrackType},
-  {UINT, kWebMIdFlagEnabled},
+  {STRING, kWebMIdCodecID},
   {UINT, kWebMIdFlagDefault},
-  {UINT, kWebMIdFlagForced},
   {UINT, kWebMIdFlagLacing},
-  {UINT, kWebMIdMinCache},
-  {UINT, kWebMIdMaxCache},
-  {UINT, kWebMIdDefaultDuration},
-  {FLOAT, kWebMIdTrackTimecodeScale},
-  {UINT, kWebMIdMaxBlockAdditionId},
-  {STRING, kWebMIdName},
-  {STRING, kWebMIdLanguage},
-  {STRING, kWebMIdCodecID},
-  {BINARY, kWebMIdCodecPrivate},
-  {STRING, kWebMIdCodecName},
-  {UINT, kWebMIdAttachmentLink},
   {UINT, kWebMIdCodecDecodeAll},
-  {UINT, kWebMIdTrackOverlay},
-  {UINT, kWebMIdCodecDelay},
-  {UINT, kWebMIdSeekPreRoll},
-  {LIST, kWebMIdTrackTranslate},
+  {UINT, kWebMIdFlagEnabled},
+  {UINT, kWebMIdTrackNumber},
   {LIST, kWebMIdVideo},
   {LIST, kWebMIdAudio},
   {LIST, kWebMIdTrackOperation},
+  {STRING, kWebMIdName},
+  {UINT, kWebMIdFlagForced},
+  {UINT, kWebMIdMaxBlockAdditionId},
+  {UINT, kWebMIdCodecDelay},
+  {UINT, kWebMIdSeekPreRoll},
+  {BINARY, kWebMIdCodecPrivate},
+  {LIST, kWebMIdTrackTranslate},
   {LIST, kWebMIdContentEncodings},
+  {UINT, kWebMIdMinCache},
+  {UINT, kWebMIdMaxCache},
+  {UINT, kWebMIdTrackOverlay},
+  {BINARY, kWebMIdTrackUID},
+  {UINT, kWebMIdAttachmentLink},
+  {STRING, kWebMIdLanguage},
+  {FLOAT, kWebMIdTrackTimecodeScale},
+  {UINT, kWebMIdDefaultDuration},
+  {STRING, kWebMIdCodecName},
 };
 
 static const ElementIdInfo kTrackTranslateIds[] = {
-  {UINT, kWebMIdTrackTranslateEditionUID},
-  {UINT, kWebMIdTrackTranslateCodec},
   {BINARY, kWebMIdTrackTranslateTrackID},
+  {UINT, kWebMIdTrackTranslateCodec},
+  {UINT, kWebMIdTrackTranslateEditionUID},
 };
 
 static const ElementIdInfo kVideoIds[] = {
   {UINT, kWebMIdFlagInterlaced},
-  {UINT, kWebMIdStereoMode},
-  {UINT, kWebMIdAlphaMode},
   {UINT, kWebMIdPixelWidth},
   {UINT, kWebMIdPixelHeight},
+  {UINT, kWebMIdStereoMode},
+  {UINT, kWebMIdAlphaMode},
   {UINT, kWebMIdPixelCropBottom},
-  {UINT, kWebMIdPixelCropTop},
-  {UINT, kWebMIdPixelCropLeft},
-  {UINT, kWebMIdPixelCropRight},
   {UINT, kWebMIdDisplayWidth},
-  {UINT, kWebMIdDisplayHeight},
   {UINT, kWebMIdDisplayUnit},
   {UINT, kWebMIdAspectRatioType},
-  {BINARY, kWebMIdColorSpace},
+  {UINT, kWebMIdDisplayHeight},
+  {UINT, kWebMIdPixelCropTop},
+  {UINT, kWebMIdPixelCropLeft},
+  {UINT, kWebMIdPixelCropRight},
   {FLOAT, kWebMIdFrameRate},
+  {BINARY, kWebMIdColorSpace},
 };
 
 static const ElementIdInfo kAudioIds[] = {
-  {FLOAT, kWebMIdSamplingFrequency},
-  {FLOAT, kWebMIdOutputSamplingFrequency},
   {UINT, kWebMIdChannels},
+  {FLOAT, kWebMIdSamplingFrequency},
   {UINT, kWebMIdBitDepth},
+  {FLOAT, kWebMIdOutputSamplingFrequency},
 };
 
 static const ElementIdInfo kTrackOperationIds[] = {
@@ -242,13 +245,13 @@ static const ElementIdInfo kContentCompressionIds[] = {
 };
 
 static const ElementIdInfo kContentEncryptionIds[] = {
-  {LIST, kWebMIdContentEncAESSettings},
   {UINT, kWebMIdContentEncAlgo},
   {BINARY, kWebMIdContentEncKeyID},
   {BINARY, kWebMIdContentSignature},
   {BINARY, kWebMIdContentSigKeyID},
   {UINT, kWebMIdContentSigAlgo},
   {UINT, kWebMIdContentSigHashAlgo},
+  {LIST, kWebMIdContentEncAESSettings},
 };
 
 static const ElementIdInfo kContentEncAESSettingsIds[] = {
@@ -265,11 +268,11 @@ static const ElementIdInfo kCuePointIds[] = {
 };
 
 static const ElementIdInfo kCueTrackPositionsIds[] = {
-  {UINT, kWebMIdCueTrack},
+  {LIST, kWebMIdCueReference},
+  {UINT, kWebMIdCueCodecState},
   {UINT, kWebMIdCueClusterPosition},
+  {UINT, kWebMIdCueTrack},
   {UINT, kWebMIdCueBlockNumber},
-  {UINT, kWebMIdCueCodecState},
-  {LIST, kWebMIdCueReference},
 };
 
 static const ElementIdInfo kCueReferenceIds[] = {
@@ -281,10 +284,10 @@ static const ElementIdInfo kAttachmentsIds[] = {
 };
 
 static const ElementIdInfo kAttachedFileIds[] = {
-  {STRING, kWebMIdFileDescription},
-  {STRING, kWebMIdFileName},
-  {STRING, kWebMIdFileMimeType},
   {BINARY, kWebMIdFileData},
+  {STRING, kWebMIdFileMimeType},
+  {STRING, kWebMIdFileName},
+  {STRING, kWebMIdFileDescription},
   {UINT, kWebMIdFileUID},
 };
 
@@ -293,25 +296,25 @@ static const ElementIdInfo kChaptersIds[] = {
 };
 
 static const ElementIdInfo kEditionEntryIds[] = {
+  {LIST, kWebMIdChapterAtom},
   {UINT, kWebMIdEditionUID},
   {UINT, kWebMIdEditionFlagHidden},
   {UINT, kWebMIdEditionFlagDefault},
   {UINT, kWebMIdEditionFlagOrdered},
-  {LIST, kWebMIdChapterAtom},
 };
 
 static const ElementIdInfo kChapterAtomIds[] = {
-  {UINT, kWebMIdChapterUID},
+  {LIST, kWebMIdChapterDisplay},
+  {LIST, kWebMIdChapterTrack},
   {UINT, kWebMIdChapterTimeStart},
   {UINT, kWebMIdChapterTimeEnd},
   {UINT, kWebMIdChapterFlagHidden},
   {UINT, kWebMIdChapterFlagEnabled},
-  {BINARY, kWebMIdChapterSegmentUID},
-  {UINT, kWebMIdChapterSegmentEditionUID},
   {UINT, kWebMIdChapterPhysicalEquiv},
-  {LIST, kWebMIdChapterTrack},
-  {LIST, kWebMIdChapterDisplay},
   {LIST, kWebMIdChapProcess},
+  {BINARY, kWebMIdChapterSegmentUID},
+  {UINT, kWebMIdChapterSegmentEditionUID},
+  {UINT, kWebMIdChapterUID},
 };
 
 static const ElementIdInfo kChapterTrackIds[] = {
@@ -325,9 +328,9 @@ static const ElementIdInfo kChapterDisplayIds[] = {
 };
 
 static const ElementIdInfo kChapProcessIds[] = {
-  {UINT, kWebMIdChapProcessCodecID},
   {BINARY, kWebMIdChapProcessPrivate},
   {LIST, kWebMIdChapProcessCommand},
+  {UINT, kWebMIdChapProcessCodecID},
 };
 
 static const ElementIdInfo kChapProcessCommandIds[] = {
@@ -345,70 +348,70 @@ static const ElementIdInfo kTagIds[] = {
 };
 
 static const ElementIdInfo kTargetsIds[] = {
-  {UINT, kWebMIdTargetTypeValue},
-  {STRING, kWebMIdTargetType},
-  {UINT, kWebMIdTagTrackUID},
-  {UINT, kWebMIdTagEditionUID},
   {UINT, kWebMIdTagChapterUID},
+  {UINT, kWebMIdTagTrackUID},
   {UINT, kWebMIdTagAttachmentUID},
+  {UINT, kWebMIdTagEditionUID},
+  {STRING, kWebMIdTargetType},
+  {UINT, kWebMIdTargetTypeValue},
 };
 
 static const ElementIdInfo kSimpleTagIds[] = {
-  {STRING, kWebMIdTagName},
   {STRING, kWebMIdTagLanguage},
   {UINT, kWebMIdTagDefault},
-  {STRING, kWebMIdTagString},
   {BINARY, kWebMIdTagBinary},
+  {STRING, kWebMIdTagString},
+  {STRING, kWebMIdTagName},
 };
 
 #define LIST_ELEMENT_INFO(id, level, id_info) \
     { (id), (level), (id_info), arraysize(id_info) }
 
 static const ListElementInfo kListElementInfo[] = {
-  LIST_ELEMENT_INFO(kWebMIdCluster, 1, kClusterIds),
-  LIST_ELEMENT_INFO(kWebMIdEBMLHeader, 0, kEBMLHeaderIds),
-  LIST_ELEMENT_INFO(kWebMIdSegment, 0, kSegmentIds),
-  LIST_ELEMENT_INFO(kWebMIdSeekHead, 1, kSeekHeadIds),
-  LIST_ELEMENT_INFO(kWebMIdSeek, 2, kSeekIds),
-  LIST_ELEMENT_INFO(kWebMIdInfo, 1, kInfoIds),
-  LIST_ELEMENT_INFO(kWebMIdChapterTranslate, 2, kChapterTranslateIds),
-  LIST_ELEMENT_INFO(kWebMIdSilentTracks, 2, kSilentTracksIds),
+  LIST_ELEMENT_INFO(kWebMIdChapterDisplay, 4, kChapterDisplayIds),
+  LIST_ELEMENT_INFO(kWebMIdSlices, 3, kSlicesIds),
+  LIST_ELEMENT_INFO(kWebMIdChapterTrack, 4, kChapterTrackIds),
   LIST_ELEMENT_INFO(kWebMIdBlockGroup, 2, kBlockGroupIds),
-  LIST_ELEMENT_INFO(kWebMIdBlockAdditions, 3, kBlockAdditionsIds),
   LIST_ELEMENT_INFO(kWebMIdBlockMore, 4, kBlockMoreIds),
-  LIST_ELEMENT_INFO(kWebMIdSlices, 3, kSlicesIds),
-  LIST_ELEMENT_INFO(kWebMIdTimeSlice, 4, kTimeSliceIds),
-  LIST_ELEMENT_INFO(kWebMIdTracks, 1, kTracksIds),
   LIST_ELEMENT_INFO(kWebMIdTrackEntry, 2, kTrackEntryIds),
-  LIST_ELEMENT_INFO(kWebMIdTrackTranslate, 3, kTrackTranslateIds),
+  LIST_ELEMENT_INFO(kWebMIdChapterAtom, 3, kChapterAtomIds),
+  LIST_ELEMENT_INFO(kWebMIdCueTrackPositions, 3, kCueTrackPositionsIds),
+  LIST_ELEMENT_INFO(kWebMIdCuePoint, 2, kCuePointIds),
+  LIST_ELEMENT_INFO(kWebMIdCueReference, 4, kCueReferenceIds),
   LIST_ELEMENT_INFO(kWebMIdVideo, 3, kVideoIds),
   LIST_ELEMENT_INFO(kWebMIdAudio, 3, kAudioIds),
   LIST_ELEMENT_INFO(kWebMIdTrackOperation, 3, kTrackOperationIds),
   LIST_ELEMENT_INFO(kWebMIdTrackCombinePlanes, 4, kTrackCombinePlanesIds),
   LIST_ELEMENT_INFO(kWebMIdTrackPlane, 5, kTrackPlaneIds),
+  LIST_ELEMENT_INFO(kWebMIdTimeSlice, 4, kTimeSliceIds),
   LIST_ELEMENT_INFO(kWebMIdJoinBlocks, 4, kJoinBlocksIds),
-  LIST_ELEMENT_INFO(kWebMIdContentEncodings, 3, kContentEncodingsIds),
-  LIST_ELEMENT_INFO(kWebMIdContentEncoding, 4, kContentEncodingIds),
+  LIST_ELEMENT_INFO(kWebMIdEditionEntry, 2, kEditionEntryIds),
+  LIST_ELEMENT_INFO(kWebMIdContentEncAESSettings, 6, kContentEncAESSettingsIds),
+  LIST_ELEMENT_INFO(kWebMIdSeek, 2, kSeekIds),
   LIST_ELEMENT_INFO(kWebMIdContentCompression, 5, kContentCompressionIds),
   LIST_ELEMENT_INFO(kWebMIdContentEncryption, 5, kContentEncryptionIds),
-  LIST_ELEMENT_INFO(kWebMIdContentEncAESSettings, 6, kContentEncAESSettingsIds),
-  LIST_ELEMENT_INFO(kWebMIdCues, 1, kCuesIds),
-  LIST_ELEMENT_INFO(kWebMIdCuePoint, 2, kCuePointIds),
-  LIST_ELEMENT_INFO(kWebMIdCueTrackPositions, 3, kCueTrackPositionsIds),
-  LIST_ELEMENT_INFO(kWebMIdCueReference, 4, kCueReferenceIds),
-  LIST_ELEMENT_INFO(kWebMIdAttachments, 1, kAttachmentsIds),
+  LIST_ELEMENT_INFO(kWebMIdSilentTracks, 2, kSilentTracksIds),
   LIST_ELEMENT_INFO(kWebMIdAttachedFile, 2, kAttachedFileIds),
-  LIST_ELEMENT_INFO(kWebMIdChapters, 1, kChaptersIds),
-  LIST_ELEMENT_INFO(kWebMIdEditionEntry, 2, kEditionEntryIds),
-  LIST_ELEMENT_INFO(kWebMIdChapterAtom, 3, kChapterAtomIds),
-  LIST_ELEMENT_INFO(kWebMIdChapterTrack, 4, kChapterTrackIds),
-  LIST_ELEMENT_INFO(kWebMIdChapterDisplay, 4, kChapterDisplayIds),
-  LIST_ELEMENT_INFO(kWebMIdChapProcess, 4, kChapProcessIds),
-  LIST_ELEMENT_INFO(kWebMIdChapProcessCommand, 5, kChapProcessCommandIds),
-  LIST_ELEMENT_INFO(kWebMIdTags, 1, kTagsIds),
-  LIST_ELEMENT_INFO(kWebMIdTag, 2, kTagIds),
+  LIST_ELEMENT_INFO(kWebMIdContentEncoding, 4, kContentEncodingIds),
   LIST_ELEMENT_INFO(kWebMIdTargets, 3, kTargetsIds),
+  LIST_ELEMENT_INFO(kWebMIdTrackTranslate, 3, kTrackTranslateIds),
   LIST_ELEMENT_INFO(kWebMIdSimpleTag, 3, kSimpleTagIds),
+  LIST_ELEMENT_INFO(kWebMIdChapProcessCommand, 5, kChapProcessCommandIds),
+  LIST_ELEMENT_INFO(kWebMIdChapterTranslate, 2, kChapterTranslateIds),
+  LIST_ELEMENT_INFO(kWebMIdChapProcess, 4, kChapProcessIds),
+  LIST_ELEMENT_INFO(kWebMIdContentEncodings, 3, kContentEncodingsIds),
+  LIST_ELEMENT_INFO(kWebMIdTag, 2, kTagIds),
+  LIST_ELEMENT_INFO(kWebMIdBlockAdditions, 3, kBlockAdditionsIds),
+  LIST_ELEMENT_INFO(kWebMIdChapters, 1, kChaptersIds),
+  LIST_ELEMENT_INFO(kWebMIdSeekHead, 1, kSeekHeadIds),
+  LIST_ELEMENT_INFO(kWebMIdTags, 1, kTagsIds),
+  LIST_ELEMENT_INFO(kWebMIdInfo, 1, kInfoIds),
+  LIST_ELEMENT_INFO(kWebMIdTracks, 1, kTracksIds),
+  LIST_ELEMENT_INFO(kWebMIdSegment, 0, kSegmentIds),
+  LIST_ELEMENT_INFO(kWebMIdAttachments, 1, kAttachmentsIds),
+  LIST_ELEMENT_INFO(kWebMIdEBMLHeader, 0, kEBMLHeaderIds),
+  LIST_ELEMENT_INFO(kWebMIdCues, 1, kCuesIds),
+  LIST_ELEMENT_INFO(kWebMIdCluster, 1, kClusterIds),
 };
 
 // Parses an element header id or size field. These fields are variable length
@@ -513,6 +516,14 @@ int WebMParseElementHeader(const uint8_t* buf,
   return num_id_bytes + num_size_bytes;
 }
 
+static bool IdInfoLessThan(const ElementIdInfo& info, int id) {
+  return info.id_ < id;
+}
+
+static bool ListInfoLessThan(const ListElementInfo& info, int id) {
+  return info.id_ < id;
+}
+
 // Finds ElementType for a specific ID.
 static ElementType FindIdType(int id,
                               const ElementIdInfo* id_info,
@@ -522,20 +533,21 @@ static ElementType FindIdType(int id,
   if (id == kWebMIdVoid || id == kWebMIdCRC32)
     return SKIP;
 
-  for (int i = 0; i < id_info_count; ++i) {
-    if (id == id_info[i].id_)
-      return id_info[i].type_;
-  }
+  const ElementIdInfo* end = id_info + id_info_count;
+  const ElementIdInfo* it = std::lower_bound(id_info, end, id, IdInfoLessThan);
+  if (it != end && it->id_ == id)
+    return it->type_;
 
   return UNKNOWN;
 }
 
 // Finds ListElementInfo for a specific ID.
 static const ListElementInfo* FindListInfo(int id) {
-  for (size_t i = 0; i < arraysize(kListElementInfo); ++i) {
-    if (id == kListElementInfo[i].id_)
-      return &kListElementInfo[i];
-  }
+  const ListElementInfo* end = kListElementInfo + arraysize(kListElementInfo);
+  const ListElementInfo* it =
+      std::lower_bound(kListElementInfo, end, id, ListInfoLessThan);
+  if (it != end && it->id_ == id)
+    return it;
 
   return NULL;
 }
@@ -704,7 +716,10 @@ WebMListParser::WebMListParser(int id, WebMParserClient* client)
     : state_(NEED_LIST_HEADER),
       root_id_(id),
       root_level_(FindListLevel(id)),
-      root_client_(client) {
+      root_client_(client),
+      pending_header_size_(0),
+      pending_element_id_(0),
+      pending_element_size_(0) {
   DCHECK_GE(root_level_, 0);
   DCHECK(client);
 }
@@ -714,6 +729,7 @@ WebMListParser::~WebMListParser() {}
 void WebMListParser::Reset() {
   ChangeState(NEED_LIST_HEADER);
   list_state_stack_.clear();
+  pending_header_size_ = 0;
 }
 
 int WebMListParser::Parse(const uint8_t* buf, int size) {
@@ -732,8 +748,19 @@ int WebMListParser::Parse(const uint8_t* buf, int size) {
   while (cur_size > 0 && state_ != PARSE_ERROR && state_ != DONE_PARSING_LIST) {
     int element_id = 0;
     int64_t element_size = 0;
-    int result = WebMParseElementHeader(cur, cur_size, &element_id,
-                                        &element_size);
+    int result;
+    if (bytes_parsed == 0 && pending_header_size_ > 0 &&
+        pending_header_size_ <= cur_size) {
+      // The element header was already decoded when the previous Parse() call
+      // ran out of data; the caller re-presents the element from its first
+      // byte, so reuse the decoded header instead of walking it again.
+      element_id = pending_element_id_;
+      element_size = pending_element_size_;
+      result = pending_header_size_;
+    } else {
+      result = WebMParseElementHeader(cur, cur_size, &element_id,
+                                      &element_size);
+    }
 
     if (result < 0)
       return result;
@@ -741,6 +768,8 @@ int WebMListParser::Parse(const uint8_t* buf, int size) {
     if (result == 0)
       return bytes_parsed;
 
+    pending_header_size_ = 0;
+
     switch(state_) {
       case NEED_LIST_HEADER: {
         if (element_id != root_id_) {
@@ -780,8 +809,14 @@ int WebMListParser::Parse(const uint8_t* buf, int size) {
           return -1;
         }
 
-        if (result == 0)
+        if (result == 0) {
+          // Checkpoint the decoded header so the retry with more data does
+          // not have to walk it again.
+          pending_header_size_ = header_size;
+          pending_element_id_ = element_id;
+          pending_element_size_ = element_size;
           return bytes_parsed;
+        }
 
         break;
       }
@@ -142,6 +142,15 @@ class WebMListParser {
   // added and removed from this stack as they are parsed.
   std::vector<ListState> list_state_stack_;
 
+  // Checkpoint of the decoded header of the element that could not be
+  // consumed when Parse() ran out of data. The caller re-presents the element
+  // from its first byte with more data appended, so the header does not need
+  // to be decoded again. |pending_header_size_| is 0 when there is no
+  // checkpoint.
+  int pending_header_size_;
+  int pending_element_id_;
+  int64_t pending_element_size_;
+
   DISALLOW_COPY_AND_ASSIGN(WebMListParser);
 };
 
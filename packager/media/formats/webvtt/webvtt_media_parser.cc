@@ -11,6 +11,7 @@
 
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_piece.h"
 #include "packager/base/strings/string_split.h"
 #include "packager/base/strings/string_util.h"
 #include "packager/media/base/macros.h"
@@ -28,29 +29,32 @@ const int kTrackId = 0;
 const char kCR = 0x0D;
 const char kLF = 0x0A;
 
-// Reads the first line from |data| and removes the line. Returns false if there
-// isn't a line break. Sets |line| with the content of the first line without
-// the line break.
-bool ReadLine(std::string* data, std::string* line) {
-  if (data->size() == 0) {
+// Reads the next line from |data| starting at |*position| and advances
+// |*position| past the line and its line break. Returns false if there isn't
+// a line break. |line| points into |data| without the line break and is only
+// valid until |data| is modified.
+bool ReadLine(const std::string& data,
+              size_t* position,
+              base::StringPiece* line) {
+  if (*position >= data.size()) {
     return false;
   }
-  size_t string_position = 0;
+  size_t string_position = *position;
   // Length of the line break mark. 1 for LF and CR, 2 for CRLF.
   int line_break_length = 1;
   bool found_line_break = false;
-  while (string_position < data->size()) {
-    if (data->at(string_position) == kLF) {
+  while (string_position < data.size()) {
+    if (data[string_position] == kLF) {
       found_line_break = true;
       break;
     }
 
-    if (data->at(string_position) == kCR) {
+    if (data[string_position] == kCR) {
       found_line_break = true;
-      if (string_position + 1 >= data->size())
+      if (string_position + 1 >= data.size())
         break;
 
-      if (data->at(string_position + 1) == kLF)
+      if (data[string_position + 1] == kLF)
         line_break_length = 2;
       break;
     }
@@ -61,13 +65,13 @@ bool ReadLine(std::string* data, std::string* line) {
   if (!found_line_break)
     return false;
 
-  *line = data->substr(0, string_position);
-  data->erase(0, string_position + line_break_length);
+  *line =
+      base::StringPiece(data.data() + *position, string_position - *position);
+  *position = string_position + line_break_length;
   return true;
 }
 
-bool TimestampToMilliseconds(const std::string& original_str,
-                             uint64_t* time_ms) {
+bool TimestampToMilliseconds(base::StringPiece str, uint64_t* time_ms) {
   const size_t kMinimalHoursLength = 2;
   const size_t kMinutesLength = 2;
   const size_t kSecondsLength = 2;
@@ -78,7 +82,6 @@ bool TimestampToMilliseconds(const std::string& original_str,
   const size_t kMinimalLength =
       kMinutesLength + kSecondsLength + kMillisecondsLength + 2;
 
-  base::StringPiece str(original_str);
   if (str.size() < kMinimalLength)
     return false;
 
@@ -142,16 +145,59 @@ bool TimestampToMilliseconds(const std::string& original_str,
   return true;
 }
 
+// Mapping:
+// comment --> side data (and side data only sample)
+// settings --> side data
+// start_time --> pts
+scoped_refptr<MediaSample> CueToMediaSample(const Cue& cue) {
+  const bool kKeyFrame = true;
+  if (!cue.comment.empty()) {
+    const std::string comment = base::JoinString(cue.comment, "\n");
+    return MediaSample::FromMetadata(
+        reinterpret_cast<const uint8_t*>(comment.data()), comment.size());
+  }
+
+  const std::string payload = base::JoinString(cue.payload, "\n");
+  scoped_refptr<MediaSample> media_sample = MediaSample::CopyFrom(
+      reinterpret_cast<const uint8_t*>(payload.data()),
+      payload.size(),
+      reinterpret_cast<const uint8_t*>(cue.settings.data()),
+      cue.settings.size(),
+      !kKeyFrame);
+
+  media_sample->set_config_id(cue.identifier);
+  media_sample->set_pts(cue.start_time);
+  media_sample->set_duration(cue.duration);
+  return media_sample;
+}
+
+}  // namespace
+
+Cue::Cue() : start_time(0), duration(0) {}
+Cue::~Cue() {}
+
+void Cue::Clear() {
+  identifier.clear();
+  start_time = 0;
+  duration = 0;
+  settings.clear();
+  payload.clear();
+  comment.clear();
+}
+
+WebVttMediaParser::WebVttMediaParser() : state_(kHeader) {}
+WebVttMediaParser::~WebVttMediaParser() {}
+
 // Clears |settings| and 0s |start_time| and |duration| regardless of the
 // parsing result.
-bool ParseTimingAndSettingsLine(const std::string& line,
-                                uint64_t* start_time,
-                                uint64_t* duration,
-                                std::string* settings) {
+bool WebVttMediaParser::ParseTimingAndSettingsLine(base::StringPiece line,
+                                                   uint64_t* start_time,
+                                                   uint64_t* duration,
+                                                   std::string* settings) {
   *start_time = 0;
   *duration = 0;
   settings->clear();
-  std::vector<std::string> entries = base::SplitString(
+  std::vector<base::StringPiece> entries = base::SplitStringPiece(
       line, " ", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
   if (entries.size() < 3) {
     // The timing is time1 --> time3 so if there aren't 3 entries, this is parse
@@ -165,13 +211,13 @@ bool ParseTimingAndSettingsLine(const std::string& line,
     return false;
   }
 
-  const std::string& start_time_str = entries[0];
+  const base::StringPiece start_time_str = entries[0];
   if (!TimestampToMilliseconds(start_time_str, start_time)) {
     LOG(ERROR) << "Failed to parse " << start_time_str << " in " << line;
     return false;
   }
 
-  const std::string& end_time_str = entries[2];
+  const base::StringPiece end_time_str = entries[2];
   uint64_t end_time = 0;
   if (!TimestampToMilliseconds(end_time_str, &end_time)) {
     LOG(ERROR) << "Failed to parse " << end_time_str << " in " << line;
@@ -179,44 +225,44 @@ bool ParseTimingAndSettingsLine(const std::string& line,
   }
   *duration = end_time - *start_time;
 
-  entries.erase(entries.begin(), entries.begin() + 3);
-  *settings = base::JoinString(entries, " ");
-  return true;
-}
+  if (entries.size() == 3)
+    return true;
 
-// Mapping:
-// comment --> side data (and side data only sample)
-// settings --> side data
-// start_time --> pts
-scoped_refptr<MediaSample> CueToMediaSample(const Cue& cue) {
-  const bool kKeyFrame = true;
-  if (!cue.comment.empty()) {
-    const std::string comment = base::JoinString(cue.comment, "\n");
-    return MediaSample::FromMetadata(
-        reinterpret_cast<const uint8_t*>(comment.data()), comment.size());
+  // The entries point into |line|, so the raw settings text is the tail of
+  // the line starting at the first settings token. The same settings repeat
+  // for most (often all) cues of a program, so reuse the string built for
+  // the previous cue when the raw text matches instead of rebuilding it.
+  const base::StringPiece raw_settings =
+      line.substr(entries[3].data() - line.data());
+  if (raw_settings == last_raw_settings_) {
+    *settings = last_settings_;
+    return true;
   }
 
-  const std::string payload = base::JoinString(cue.payload, "\n");
-  scoped_refptr<MediaSample> media_sample = MediaSample::CopyFrom(
-      reinterpret_cast<const uint8_t*>(payload.data()),
-      payload.size(),
-      reinterpret_cast<const uint8_t*>(cue.settings.data()),
-      cue.settings.size(),
-      !kKeyFrame);
-
-  media_sample->set_config_id(cue.identifier);
-  media_sample->set_pts(cue.start_time);
-  media_sample->set_duration(cue.duration);
-  return media_sample;
+  raw_settings.CopyToString(&last_raw_settings_);
+  last_settings_.clear();
+  for (size_t i = 3; i < entries.size(); ++i) {
+    if (!last_settings_.empty())
+      last_settings_ += ' ';
+    entries[i].AppendToString(&last_settings_);
+  }
+  *settings = last_settings_;
+  return true;
 }
 
-}  // namespace
-
-Cue::Cue() : start_time(0), duration(0) {}
-Cue::~Cue() {}
+void WebVttMediaParser::EmitCurrentCue() {
+  pending_samples_.push_back(CueToMediaSample(current_cue_));
+  current_cue_.Clear();
+}
 
-WebVttMediaParser::WebVttMediaParser() : state_(kHeader) {}
-WebVttMediaParser::~WebVttMediaParser() {}
+bool WebVttMediaParser::DeliverPendingSamples() {
+  if (pending_samples_.empty())
+    return true;
+  const bool result =
+      DeliverSampleBatch(kTrackId, pending_samples_, new_sample_cb_);
+  pending_samples_.clear();
+  return result;
+}
 
 void WebVttMediaParser::Init(const InitCB& init_cb,
                              const NewSampleCB& new_sample_cb,
@@ -241,10 +287,9 @@ bool WebVttMediaParser::Flush() {
     data_.clear();
   }
 
-  bool result = new_sample_cb_.Run(kTrackId, CueToMediaSample(current_cue_));
-  current_cue_ = Cue();
+  EmitCurrentCue();
   state_ = kCueIdentifierOrTimingOrComment;
-  return result;
+  return DeliverPendingSamples();
 }
 
 bool WebVttMediaParser::Parse(const uint8_t* buf, int size) {
@@ -253,10 +298,13 @@ bool WebVttMediaParser::Parse(const uint8_t* buf, int size) {
     return false;
   }
 
-  data_.insert(data_.end(), buf, buf + size);
+  data_.append(reinterpret_cast<const char*>(buf), size);
 
-  std::string line;
-  while (ReadLine(&data_, &line)) {
+  // Consume the lines through a read position and trim the buffer once at the
+  // end, so a line removal does not shift the rest of the buffer every time.
+  size_t position = 0;
+  base::StringPiece line;
+  while (ReadLine(data_, &position, &line)) {
     // Only kCueIdentifierOrTimingOrComment and kCueTiming states accept -->.
     // Error otherwise.
     const bool has_arrow = line.find("-->") != std::string::npos;
@@ -277,7 +325,7 @@ bool WebVttMediaParser::Parse(const uint8_t* buf, int size) {
     switch (state_) {
       case kHeader:
         // No check. This should be WEBVTT when this object was created.
-        header_.push_back(line);
+        header_.push_back(line.as_string());
         state_ = kMetadata;
         break;
       case kMetadata: {
@@ -309,7 +357,7 @@ bool WebVttMediaParser::Parse(const uint8_t* buf, int size) {
           break;
         }
 
-        header_.push_back(line);
+        header_.push_back(line.as_string());
         break;
       }
       case kCueIdentifierOrTimingOrComment: {
@@ -323,11 +371,11 @@ bool WebVttMediaParser::Parse(const uint8_t* buf, int size) {
           if (base::StartsWith(line, "NOTE",
                                       base::CompareCase::INSENSITIVE_ASCII)) {
             state_ = kComment;
-            current_cue_.comment.push_back(line);
+            current_cue_.comment.push_back(line.as_string());
           } else {
             // A cue can start from a cue identifier.
             // https://w3c.github.io/webvtt/#webvtt-cue-identifier
-            current_cue_.identifier = line;
+            line.CopyToString(&current_cue_.identifier);
             // The next line must be a timing.
             state_ = kCueTiming;
           }
@@ -354,29 +402,21 @@ bool WebVttMediaParser::Parse(const uint8_t* buf, int size) {
       case kCuePayload: {
         if (line.empty()) {
           state_ = kCueIdentifierOrTimingOrComment;
-          if (!new_sample_cb_.Run(kTrackId, CueToMediaSample(current_cue_))) {
-            state_ = kParseError;
-            return false;
-          }
-          current_cue_ = Cue();
+          EmitCurrentCue();
           break;
         }
 
-        current_cue_.payload.push_back(line);
+        current_cue_.payload.push_back(line.as_string());
         break;
       }
       case kComment: {
         if (line.empty()) {
           state_ = kCueIdentifierOrTimingOrComment;
-          if (!new_sample_cb_.Run(kTrackId, CueToMediaSample(current_cue_))) {
-            state_ = kParseError;
-            return false;
-          }
-          current_cue_ = Cue();
+          EmitCurrentCue();
           break;
         }
 
-        current_cue_.comment.push_back(line);
+        current_cue_.comment.push_back(line.as_string());
         break;
       }
       case kParseError:
@@ -385,6 +425,15 @@ bool WebVttMediaParser::Parse(const uint8_t* buf, int size) {
     }
   }
 
+  data_.erase(0, position);
+
+  // Deliver every cue completed by this buffer as one batch, so a burst of
+  // cues (e.g. a caption-heavy program segment) costs one downstream handoff
+  // instead of one per cue.
+  if (!DeliverPendingSamples()) {
+    state_ = kParseError;
+    return false;
+  }
   return true;
 }
 
@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "packager/base/compiler_specific.h"
+#include "packager/base/strings/string_piece.h"
 #include "packager/media/base/media_parser.h"
 
 namespace shaka {
@@ -24,6 +25,10 @@ struct Cue {
   Cue();
   ~Cue();
 
+  // Clears the fields so the object can be reused for the next cue instead of
+  // being reallocated.
+  void Clear();
+
   std::string identifier;
   uint64_t start_time;
   uint64_t duration;
@@ -59,6 +64,25 @@ class WebVttMediaParser : public MediaParser {
     kParseError,
   };
 
+  // Parses a WebVTT timing line, e.g. "00:00:01.000 --> 00:00:02.000 line:8%",
+  // into |start_time|, |duration| (both in milliseconds) and the normalized
+  // cue settings. Repeated settings text is interned: when the settings of
+  // this line match the previous cue's, the cached string is reused instead
+  // of being split and rebuilt, since the same position/alignment settings
+  // typically repeat for every cue of a program.
+  bool ParseTimingAndSettingsLine(base::StringPiece line,
+                                  uint64_t* start_time,
+                                  uint64_t* duration,
+                                  std::string* settings);
+
+  // Converts |current_cue_| to a media sample, queues it for delivery and
+  // clears the cue for reuse.
+  void EmitCurrentCue();
+
+  // Delivers the queued samples downstream as one batch. Returns false if a
+  // sample was rejected.
+  bool DeliverPendingSamples();
+
   InitCB init_cb_;
   NewSampleCB new_sample_cb_;
 
@@ -76,6 +100,16 @@ class WebVttMediaParser : public MediaParser {
 
   Cue current_cue_;
 
+  // Samples parsed but not yet delivered. Cues are delivered in one batch at
+  // the end of every Parse() and Flush() call, so a burst of cues costs one
+  // downstream handoff instead of one per cue.
+  std::vector<scoped_refptr<MediaSample> > pending_samples_;
+
+  // Cache for interning cue settings: the raw settings text of the previous
+  // timing line and the normalized string built from it.
+  std::string last_raw_settings_;
+  std::string last_settings_;
+
   DISALLOW_COPY_AND_ASSIGN(WebVttMediaParser);
 };
 
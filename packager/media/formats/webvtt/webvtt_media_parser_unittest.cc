@@ -20,6 +20,10 @@ typedef testing::MockFunction<void(const std::vector<scoped_refptr<StreamInfo>>&
 typedef testing::MockFunction<bool(
     uint32_t track_id,
     const scoped_refptr<MediaSample>& media_sample)> MockNewSampleCallback;
+typedef testing::MockFunction<bool(
+    uint32_t track_id,
+    const std::vector<scoped_refptr<MediaSample>>& samples)>
+    MockNewSampleBatchCallback;
 
 using testing::_;
 using testing::InSequence;
@@ -298,6 +302,75 @@ TEST_F(WebVttMediaParserTest, Header) {
   EXPECT_TRUE(parser_.Flush());
 }
 
+MATCHER_P(BatchSizeIs, size, "") {
+  return arg.size() == static_cast<size_t>(size);
+}
+
+// Verify that when a batch callback is set, all the cues completed by one
+// Parse() call are delivered in a single batch.
+TEST_F(WebVttMediaParserTest, BatchSampleDelivery) {
+  MockNewSampleBatchCallback batch_callback;
+  EXPECT_CALL(init_callback_, Call(_));
+  EXPECT_CALL(new_sample_callback_, Call(_, _)).Times(0);
+  EXPECT_CALL(batch_callback, Call(_, BatchSizeIs(3))).WillOnce(Return(true));
+
+  const char kWebVtt[] =
+      "WEBVTT\n"
+      "\n"
+      "00:01:00.000 --> 01:00:00.000\n"
+      "subtitle\n"
+      "\n"
+      "02:01:00.000 --> 02:02:00.000\n"
+      "more subtitle\n"
+      "\n"
+      "03:01:00.000 --> 03:02:00.000\n"
+      "even more subtitle\n"
+      "\n";
+  InitializeParser();
+  parser_.set_sample_batch_cb(base::Bind(&MockNewSampleBatchCallback::Call,
+                                         base::Unretained(&batch_callback)));
+  EXPECT_TRUE(parser_.Parse(reinterpret_cast<const uint8_t*>(kWebVtt),
+                            arraysize(kWebVtt) - 1));
+
+  EXPECT_TRUE(parser_.Flush());
+}
+
+MATCHER_P(MatchesSettings, settings, "") {
+  return std::string(reinterpret_cast<const char*>(arg->side_data()),
+                     arg->side_data_size()) == settings;
+}
+
+// Verify that cue settings parse correctly, including repeated settings that
+// take the interned fast path and settings with extra separating spaces.
+TEST_F(WebVttMediaParserTest, VerifyCueSettings) {
+  EXPECT_CALL(init_callback_, Call(_));
+  // The second cue repeats the first cue's settings verbatim and is served
+  // from the intern cache; the third only differs in a doubled separator and
+  // normalizes to the same settings string.
+  EXPECT_CALL(new_sample_callback_,
+              Call(_, MatchesSettings("position:10% align:left")))
+      .Times(3)
+      .WillRepeatedly(Return(true));
+
+  const char kWebVtt[] =
+      "WEBVTT\n"
+      "\n"
+      "00:01:00.000 --> 01:00:00.000 position:10% align:left\n"
+      "subtitle\n"
+      "\n"
+      "02:01:00.000 --> 02:02:00.000 position:10% align:left\n"
+      "more subtitle\n"
+      "\n"
+      "03:01:00.000 --> 03:02:00.000 position:10%  align:left\n"
+      "even more subtitle\n"
+      "\n";
+  InitializeParser();
+  EXPECT_TRUE(parser_.Parse(reinterpret_cast<const uint8_t*>(kWebVtt),
+                            arraysize(kWebVtt) - 1));
+
+  EXPECT_TRUE(parser_.Flush());
+}
+
 // Verify that if timing is not present after an identifier, the parser errors.
 TEST_F(WebVttMediaParserTest, NoTimingAfterIdentifier) {
   EXPECT_CALL(init_callback_, Call(_));
@@ -4,6 +4,8 @@
 
 #include "packager/media/formats/wvm/wvm_media_parser.h"
 
+#include <string.h>
+
 #include <map>
 #include <sstream>
 #include <vector>
@@ -13,6 +15,7 @@
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/media_sample.h"
+#include "packager/media/base/shared_buffer.h"
 #include "packager/media/base/status.h"
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/codecs/aac_audio_specific_config.h"
@@ -131,13 +134,25 @@ bool WvmMediaParser::Parse(const uint8_t* buf, int size) {
   const uint8_t* read_ptr = buf;
   const uint8_t* end = read_ptr + size;
 
+  // The switch dispatches once per header byte only when a header straddles
+  // the input boundary. Whenever enough bytes are available, whole headers
+  // and payload bodies are consumed in one step by the block fast paths
+  // below.
   while (read_ptr < end) {
     switch (parse_state_) {
-      case StartCode1:
-        if (*read_ptr == kStartCode1) {
-          parse_state_ = StartCode2;
+      case StartCode1: {
+        // Scan to the next possible start code in one pass instead of
+        // dispatching on every byte.
+        const uint8_t* next_zero = static_cast<const uint8_t*>(
+            memchr(read_ptr, kStartCode1, end - read_ptr));
+        if (next_zero == NULL) {
+          read_ptr = end;
+          continue;
         }
+        read_ptr = next_zero;
+        parse_state_ = StartCode2;
         break;
+      }
       case StartCode2:
         if (*read_ptr == kStartCode2) {
           parse_state_ = StartCode3;
@@ -169,6 +184,15 @@ bool WvmMediaParser::Parse(const uint8_t* buf, int size) {
         }
         break;
       case PackHeader1:
+        // Only the stuffing length in the last byte of the 10-byte pack
+        // header body is needed; consume the whole body at once when it is
+        // available.
+        if (end - read_ptr >= 10) {
+          skip_bytes_ = read_ptr[9] & 0x07;
+          read_ptr += 10;
+          parse_state_ = PackHeaderStuffingSkip;
+          continue;
+        }
         parse_state_ = PackHeader2;
         break;
       case PackHeader2:
@@ -239,6 +263,28 @@ bool WvmMediaParser::Parse(const uint8_t* buf, int size) {
             (pes_stream_id_ != kPaddingStreamId)) {
           metadata_is_complete_ = true;
         }
+        // Decode the packet length and the optional PES extension in one
+        // step when the whole fixed-size header is available.
+        if (HAS_HEADER_EXTENSION(pes_stream_id_)) {
+          if (end - read_ptr >= 6) {
+            pes_packet_bytes_ = (read_ptr[1] << 8) | read_ptr[2];
+            prev_pes_flags_1_ = pes_flags_1_;
+            pes_flags_1_ = read_ptr[3];
+            pes_flags_2_ = read_ptr[4];
+            pes_header_data_bytes_ = read_ptr[5];
+            pes_packet_bytes_ -= 3;
+            read_ptr += 6;
+            parse_state_ = (pes_flags_2_ & kPesOptPts) ? Pts1 : PesHeaderData;
+            continue;
+          }
+        } else if (end - read_ptr >= 3) {
+          pes_packet_bytes_ = (read_ptr[1] << 8) | read_ptr[2];
+          pes_flags_1_ = pes_flags_2_ = 0;
+          pes_header_data_bytes_ = 0;
+          read_ptr += 3;
+          parse_state_ = PesPayload;
+          continue;
+        }
         parse_state_ = PesPacketLength1;
         break;
       case PesPacketLength1:
@@ -277,6 +323,25 @@ bool WvmMediaParser::Parse(const uint8_t* buf, int size) {
         }
         break;
       case Pts1:
+        // Decode all five timestamp bytes at once when they are available.
+        if (end - read_ptr >= 5) {
+          pts_ = (static_cast<uint64_t>(read_ptr[0] & 0x0E) << 29) |
+                 (static_cast<uint64_t>(read_ptr[1]) << 22) |
+                 (static_cast<uint64_t>(read_ptr[2] >> 1) << 15) |
+                 (static_cast<uint64_t>(read_ptr[3]) << 7) |
+                 (read_ptr[4] >> 1);
+          timestamp_ = pts_;
+          pes_header_data_bytes_ -= 5;
+          pes_packet_bytes_ -= 5;
+          read_ptr += 5;
+          if (pes_flags_2_ & kPesOptDts) {
+            parse_state_ = Dts1;
+          } else {
+            dts_ = pts_;
+            parse_state_ = PesHeaderData;
+          }
+          continue;
+        }
         timestamp_ = (*read_ptr & 0x0E);
         --pes_header_data_bytes_;
         --pes_packet_bytes_;
@@ -317,6 +382,19 @@ bool WvmMediaParser::Parse(const uint8_t* buf, int size) {
         }
         break;
       case Dts1:
+        if (end - read_ptr >= 5) {
+          dts_ = (static_cast<uint64_t>(read_ptr[0] & 0x0E) << 29) |
+                 (static_cast<uint64_t>(read_ptr[1]) << 22) |
+                 (static_cast<uint64_t>(read_ptr[2] >> 1) << 15) |
+                 (static_cast<uint64_t>(read_ptr[3]) << 7) |
+                 (read_ptr[4] >> 1);
+          timestamp_ = dts_;
+          pes_header_data_bytes_ -= 5;
+          pes_packet_bytes_ -= 5;
+          read_ptr += 5;
+          parse_state_ = PesHeaderData;
+          continue;
+        }
         timestamp_ = (*read_ptr & 0x0E);
         --pes_header_data_bytes_;
         --pes_packet_bytes_;
@@ -476,6 +554,7 @@ bool WvmMediaParser::Parse(const uint8_t* buf, int size) {
         parse_state_ = StartCode1;
         prev_media_sample_data_.Reset();
         current_program_id_++;
+        pending_crypto_units_.clear();
         ecm_.clear();
         index_data_.clear();
         psm_data_.clear();
@@ -776,19 +855,21 @@ bool WvmMediaParser::ParseIndexEntry() {
 bool WvmMediaParser::DemuxNextPes(bool is_program_end) {
   bool output_encrypted_sample = false;
   if (!sample_data_.empty() && (prev_pes_flags_1_ & kScramblingBitsMask)) {
-    // Decrypt crypto unit.
     if (!content_decryptor_) {
       output_encrypted_sample = true;
     } else {
-      content_decryptor_->Crypt(&sample_data_[crypto_unit_start_pos_],
-                                sample_data_.size() - crypto_unit_start_pos_,
-                                &sample_data_[crypto_unit_start_pos_]);
+      // Queue the crypto unit; all of the sample's units are decrypted in
+      // one batch when the sample is complete.
+      pending_crypto_units_.push_back(CryptoUnit(
+          crypto_unit_start_pos_,
+          sample_data_.size() - crypto_unit_start_pos_));
     }
   }
   // Demux media sample if we are at program end or if we are not at a
   // continuation PES.
   if ((pes_flags_2_ & kPesOptPts) || is_program_end) {
     if (!sample_data_.empty()) {
+      DecryptPendingCryptoUnits();
       if (!Output(output_encrypted_sample)) {
         return false;
       }
@@ -800,6 +881,19 @@ bool WvmMediaParser::DemuxNextPes(bool is_program_end) {
   return true;
 }
 
+void WvmMediaParser::DecryptPendingCryptoUnits() {
+  // Each crypto unit is an independent CBC-CTS run starting from the constant
+  // IV, so the units can be decrypted back to back over the fully accumulated
+  // sample instead of interleaving a decrypt into the parse loop at every PES
+  // boundary.
+  for (size_t i = 0; i < pending_crypto_units_.size(); ++i) {
+    const CryptoUnit& unit = pending_crypto_units_[i];
+    content_decryptor_->Crypt(&sample_data_[unit.offset], unit.size,
+                              &sample_data_[unit.offset]);
+  }
+  pending_crypto_units_.clear();
+}
+
 void WvmMediaParser::StartMediaSampleDemux() {
   bool is_key_frame = ((pes_flags_1_ & kPesOptAlign) != 0);
   media_sample_ = MediaSample::CreateEmptyMediaSample();
@@ -812,18 +906,23 @@ void WvmMediaParser::StartMediaSampleDemux() {
 
 bool WvmMediaParser::Output(bool output_encrypted_sample) {
   if (output_encrypted_sample) {
-    media_sample_->set_data(sample_data_.data(), sample_data_.size());
+    // |sample_data_| is done accumulating; hand it to the sample without
+    // copying.
+    scoped_refptr<SharedBuffer> buffer(SharedBuffer::MoveFrom(&sample_data_));
+    media_sample_->set_data_view(buffer, 0, buffer->size());
     media_sample_->set_is_encrypted(true);
   } else {
     if ((prev_pes_stream_id_ & kPesStreamIdVideoMask) == kPesStreamIdVideo) {
-      // Convert video stream to unit stream and get config.
-      std::vector<uint8_t> nal_unit_stream;
-      if (!byte_to_unit_stream_converter_.ConvertByteStreamToNalUnitStream(
-              sample_data_.data(), sample_data_.size(), &nal_unit_stream)) {
+      // Convert video stream to unit stream and get config. |sample_data_| is
+      // done accumulating, so it can be converted in place and handed to the
+      // sample without copying the payload.
+      if (!byte_to_unit_stream_converter_.ConvertByteStreamToNalUnitStreamInPlace(
+              &sample_data_)) {
         LOG(ERROR) << "Could not convert h.264 byte stream sample";
         return false;
       }
-      media_sample_->set_data(nal_unit_stream.data(), nal_unit_stream.size());
+      scoped_refptr<SharedBuffer> buffer(SharedBuffer::MoveFrom(&sample_data_));
+      media_sample_->set_data_view(buffer, 0, buffer->size());
       if (!is_initialized_) {
         // Set extra data for video stream from AVC Decoder Config Record.
         // Also, set codec string from the AVC Decoder Config Record.
@@ -904,8 +1003,11 @@ bool WvmMediaParser::Output(bool output_encrypted_sample) {
       }
       size_t header_size = adts_header.GetAdtsHeaderSize(frame_ptr,
                                                          frame_size);
-      media_sample_->set_data(frame_ptr + header_size,
-                              frame_size - header_size);
+      // View the frame payload in place; moving the vector does not
+      // invalidate |frame_ptr|.
+      scoped_refptr<SharedBuffer> buffer(SharedBuffer::MoveFrom(&sample_data_));
+      media_sample_->set_data_view(buffer, header_size,
+                                   frame_size - header_size);
       if (!is_initialized_) {
         for (uint32_t i = 0; i < stream_infos_.size(); i++) {
           if (stream_infos_[i]->stream_type() == kStreamAudio &&
@@ -167,6 +167,10 @@ class WvmMediaParser : public MediaParser {
 
   bool DemuxNextPes(bool is_program_end);
 
+  // Decrypts the queued crypto units of the current sample in one batch and
+  // clears the queue.
+  void DecryptPendingCryptoUnits();
+
   void StartMediaSampleDemux();
 
   template <typename T>
@@ -251,6 +255,15 @@ class WvmMediaParser : public MediaParser {
   std::vector<scoped_refptr<StreamInfo> > stream_infos_;
   std::deque<DemuxStreamIdMediaSample> media_sample_queue_;
   std::vector<uint8_t> sample_data_;
+  // Byte range of an encrypted crypto unit within |sample_data_|. The ranges
+  // are queued while the sample accumulates and decrypted together when the
+  // sample is complete.
+  struct CryptoUnit {
+    CryptoUnit(size_t offset, size_t size) : offset(offset), size(size) {}
+    size_t offset;
+    size_t size;
+  };
+  std::vector<CryptoUnit> pending_crypto_units_;
   KeySource* decryption_key_source_;
   scoped_ptr<AesCbcDecryptor> content_decryptor_;
 
@@ -187,6 +187,23 @@ TEST_F(WvmMediaParserTest, ParseWvmInitWithoutKeySource) {
   EXPECT_EQ(kExpectedStreams, stream_map_.size());
 }
 
+TEST_F(WvmMediaParserTest, ParseWvmInSmallChunks) {
+  key_source_.reset();
+  InitializeParser();
+  std::vector<uint8_t> buffer = ReadTestDataFile(kWvmFile);
+  // Use a small odd buffer size so pack and PES headers straddle the input
+  // boundary and the byte-at-a-time fallback states are exercised.
+  const size_t kChunkSize = 7;
+  for (size_t offset = 0; offset < buffer.size(); offset += kChunkSize) {
+    const size_t size = std::min(kChunkSize, buffer.size() - offset);
+    ASSERT_TRUE(parser_->Parse(buffer.data() + offset, size));
+  }
+  EXPECT_EQ(kExpectedStreams, stream_map_.size());
+  EXPECT_EQ(kExpectedVideoFrameCount, video_frame_count_);
+  EXPECT_EQ(kExpectedAudioFrameCount, audio_frame_count_);
+  EXPECT_EQ(kExpectedEncryptedSampleCount, encrypted_sample_count_);
+}
+
 TEST_F(WvmMediaParserTest, ParseWvm) {
   EXPECT_CALL(*key_source_, FetchKeys(_)).WillOnce(Return(Status::OK));
   EXPECT_CALL(*key_source_, GetKey(_, _))
@@ -0,0 +1,407 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+//
+// Release performance gate. Replays the remux scenarios covered by
+// packager_test against in-memory files, running all scenarios concurrently,
+// and records per-scenario wall and CPU time plus peak process RSS in a
+// machine-readable JSON report. When a baseline report from a previous
+// release is supplied, the binary exits nonzero if any scenario regressed
+// beyond the configured thresholds, so a performance regression fails the
+// release the same way a broken test would.
+//
+// Typical usage:
+//   packager_perf_tests --perf_report=current.json \
+//       --perf_baseline=release_1_2.json --max_wall_regression_percent=20
+
+#include <stdio.h>
+
+#if defined(OS_POSIX)
+#include <sys/resource.h>
+#endif
+
+#include <gflags/gflags.h>
+
+#include <string>
+#include <vector>
+
+#include "packager/base/at_exit.h"
+#include "packager/base/bind.h"
+#include "packager/base/command_line.h"
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
+#include "packager/base/json/json_reader.h"
+#include "packager/base/json/json_writer.h"
+#include "packager/base/logging.h"
+#include "packager/base/macros.h"
+#include "packager/base/memory/scoped_ptr.h"
+#include "packager/base/stl_util.h"
+#include "packager/base/time/time.h"
+#include "packager/base/values.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/base/demuxer.h"
+#include "packager/media/base/fixed_key_source.h"
+#include "packager/media/base/fourccs.h"
+#include "packager/media/base/media_stream.h"
+#include "packager/media/base/muxer.h"
+#include "packager/media/base/stream_info.h"
+#include "packager/media/file/memory_file.h"
+#include "packager/media/formats/mp4/mp4_muxer.h"
+#include "packager/media/test/test_data_util.h"
+
+DEFINE_string(perf_report,
+              "packager_perf_report.json",
+              "Path to write the JSON performance report to.");
+DEFINE_string(perf_baseline,
+              "",
+              "Path to a JSON report from a previous run to compare against. "
+              "If empty, the run only records a report and always succeeds.");
+DEFINE_double(max_wall_regression_percent,
+              20.0,
+              "Maximum allowed per-scenario wall time increase over the "
+              "baseline, in percent, before the run fails.");
+DEFINE_double(max_cpu_regression_percent,
+              25.0,
+              "Maximum allowed per-scenario CPU time increase over the "
+              "baseline, in percent, before the run fails.");
+DEFINE_double(max_rss_regression_percent,
+              25.0,
+              "Maximum allowed peak RSS increase over the baseline, in "
+              "percent, before the run fails.");
+
+namespace shaka {
+namespace media {
+namespace {
+
+// Muxer options, matching packager_test so the gate exercises the same
+// configurations the functional tests cover.
+const double kSegmentDurationInSeconds = 1.0;
+const double kFragmentDurationInSeconds = 0.1;
+const int kNumSubsegmentsPerSidx = 2;
+
+// Encryption constants, also from packager_test.
+const char kKeyIdHex[] = "e5007e6e9dcd5ac095202ed3758382cd";
+const char kKeyHex[] = "6fc96fe628a265b13aeddec0bc421f4d";
+const double kClearLeadInSeconds = 1.5;
+const double kCryptoDurationInSeconds = 0;  // Key rotation is disabled.
+
+struct Scenario {
+  const char* name;
+  const char* input_file;
+  bool single_segment;
+  bool enable_encryption;
+};
+
+// The same media and configurations packager_test replays serially; here each
+// scenario remuxes both the video and the audio track against MemoryFile.
+const Scenario kScenarios[] = {
+    {"mp4_vod_clear", "bear-640x360.mp4", true, false},
+    {"mp4_vod_cenc", "bear-640x360.mp4", true, true},
+    {"mp4_live_clear", "bear-640x360.mp4", false, false},
+    {"mp4_frag_vod_clear", "bear-640x360-av_frag.mp4", true, false},
+    {"ts_vod_clear", "bear-640x360.ts", true, false},
+    {"ts_vod_cenc", "bear-640x360.ts", true, true},
+};
+
+struct ScenarioResult {
+  ScenarioResult() : ok(false), wall_ms(0), cpu_ms(0) {}
+  bool ok;
+  double wall_ms;
+  double cpu_ms;
+};
+
+MediaStream* FindFirstStreamOfType(const std::vector<MediaStream*>& streams,
+                                   StreamType stream_type) {
+  typedef std::vector<MediaStream*>::const_iterator StreamIterator;
+  for (StreamIterator it = streams.begin(); it != streams.end(); ++it) {
+    if ((*it)->info()->stream_type() == stream_type)
+      return *it;
+  }
+  return NULL;
+}
+
+// Returns the CPU time consumed so far by the calling thread, in
+// milliseconds, or zero on platforms without per-thread CPU accounting.
+double ThreadCpuTimeMs() {
+#if defined(OS_LINUX)
+  struct rusage usage;
+  if (getrusage(RUSAGE_THREAD, &usage) != 0)
+    return 0;
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+#else
+  return 0;
+#endif
+}
+
+// Returns the peak resident set size of the process, in kilobytes, or zero
+// where it cannot be determined.
+double PeakRssKb() {
+#if defined(OS_POSIX)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+  return static_cast<double>(usage.ru_maxrss);
+#else
+  return 0;
+#endif
+}
+
+std::string ScenarioPath(const Scenario& scenario, const std::string& name) {
+  return std::string("memory://perf/") + scenario.name + "/" + name;
+}
+
+MuxerOptions SetupOptions(const Scenario& scenario,
+                          const std::string& output) {
+  MuxerOptions options;
+  options.single_segment = scenario.single_segment;
+  options.segment_duration = kSegmentDurationInSeconds;
+  options.fragment_duration = kFragmentDurationInSeconds;
+  options.segment_sap_aligned = true;
+  options.fragment_sap_aligned = true;
+  options.num_subsegments_per_sidx = kNumSubsegmentsPerSidx;
+  options.output_file_name = ScenarioPath(scenario, output);
+  options.segment_template =
+      ScenarioPath(scenario, output + "_template$Number$.m4s");
+  return options;
+}
+
+// Copies the scenario input from media/test/data into a memory file, so the
+// measured remux never touches the disk or the page cache.
+bool StageInput(const Scenario& scenario) {
+  std::vector<uint8_t> contents = ReadTestDataFile(scenario.input_file);
+  if (contents.empty()) {
+    LOG(ERROR) << "Failed to read test data file " << scenario.input_file;
+    return false;
+  }
+  File* file = File::Open(ScenarioPath(scenario, scenario.input_file).c_str(),
+                          "w");
+  if (!file)
+    return false;
+  int64_t written = file->Write(&contents[0], contents.size());
+  return file->Close() && written == static_cast<int64_t>(contents.size());
+}
+
+// Remuxes the video and audio tracks of the scenario input, mirroring
+// PackagerTestBasic::Remux. Runs on its own thread; wall and CPU time cover
+// only this scenario's work.
+void RunScenario(const Scenario* scenario, ScenarioResult* result) {
+  const double cpu_start_ms = ThreadCpuTimeMs();
+  const base::TimeTicks wall_start = base::TimeTicks::Now();
+
+  Demuxer demuxer(ScenarioPath(*scenario, scenario->input_file));
+  Status status = demuxer.Initialize();
+  if (!status.ok()) {
+    LOG(ERROR) << "Demuxer failed to initialize for " << scenario->name
+               << ": " << status.ToString();
+    return;
+  }
+
+  scoped_ptr<KeySource> encryption_key_source(
+      FixedKeySource::CreateFromHexStrings(kKeyIdHex, kKeyHex, "", ""));
+  DCHECK(encryption_key_source);
+
+  scoped_ptr<Muxer> muxer_video;
+  MediaStream* video_stream = FindFirstStreamOfType(demuxer.streams(),
+                                                    kStreamVideo);
+  if (video_stream) {
+    muxer_video.reset(
+        new mp4::MP4Muxer(SetupOptions(*scenario, "output_video")));
+    muxer_video->AddStream(video_stream);
+    if (scenario->enable_encryption) {
+      muxer_video->SetKeySource(encryption_key_source.get(),
+                                KeySource::TRACK_TYPE_SD, kClearLeadInSeconds,
+                                kCryptoDurationInSeconds, FOURCC_cenc);
+    }
+  }
+
+  scoped_ptr<Muxer> muxer_audio;
+  MediaStream* audio_stream = FindFirstStreamOfType(demuxer.streams(),
+                                                    kStreamAudio);
+  if (audio_stream) {
+    muxer_audio.reset(
+        new mp4::MP4Muxer(SetupOptions(*scenario, "output_audio")));
+    muxer_audio->AddStream(audio_stream);
+    if (scenario->enable_encryption) {
+      muxer_audio->SetKeySource(encryption_key_source.get(),
+                                KeySource::TRACK_TYPE_SD, kClearLeadInSeconds,
+                                kCryptoDurationInSeconds, FOURCC_cenc);
+    }
+  }
+
+  if (!video_stream && !audio_stream) {
+    LOG(ERROR) << "No usable streams in " << scenario->input_file;
+    return;
+  }
+
+  status = demuxer.Run();
+  if (!status.ok()) {
+    LOG(ERROR) << "Remux failed for " << scenario->name << ": "
+               << status.ToString();
+    return;
+  }
+
+  result->wall_ms =
+      (base::TimeTicks::Now() - wall_start).InMillisecondsF();
+  result->cpu_ms = ThreadCpuTimeMs() - cpu_start_ms;
+  result->ok = true;
+}
+
+// Builds the JSON report from the scenario results and the process peak RSS.
+scoped_ptr<base::DictionaryValue> BuildReport(
+    const std::vector<ScenarioResult>& results) {
+  scoped_ptr<base::DictionaryValue> report(new base::DictionaryValue());
+  base::DictionaryValue* scenarios = new base::DictionaryValue();
+  for (size_t i = 0; i < arraysize(kScenarios); ++i) {
+    base::DictionaryValue* entry = new base::DictionaryValue();
+    entry->SetDouble("wall_ms", results[i].wall_ms);
+    entry->SetDouble("cpu_ms", results[i].cpu_ms);
+    scenarios->Set(kScenarios[i].name, entry);
+  }
+  report->Set("scenarios", scenarios);
+  report->SetDouble("peak_rss_kb", PeakRssKb());
+  return report.Pass();
+}
+
+// Compares |current| against |baseline_value|, failing when it exceeds the
+// baseline by more than |max_regression_percent|. A zero baseline (e.g. CPU
+// time on a platform without thread accounting) is skipped rather than
+// treated as an infinite regression.
+bool CheckMetric(const std::string& label,
+                 double current,
+                 double baseline_value,
+                 double max_regression_percent) {
+  if (baseline_value <= 0)
+    return true;
+  const double change_percent =
+      (current - baseline_value) / baseline_value * 100.0;
+  printf("%-32s %10.1f -> %10.1f (%+6.1f%%, limit +%.1f%%)\n", label.c_str(),
+         baseline_value, current, change_percent, max_regression_percent);
+  if (change_percent <= max_regression_percent)
+    return true;
+  LOG(ERROR) << label << " regressed " << change_percent
+             << "% over the baseline (limit "
+             << max_regression_percent << "%).";
+  return false;
+}
+
+// Compares the current report against the baseline report. Scenarios absent
+// from the baseline (e.g. newly added ones) are recorded but not gated, so
+// adding a scenario does not require regenerating every release baseline.
+bool CheckAgainstBaseline(const base::DictionaryValue& report,
+                          const base::DictionaryValue& baseline) {
+  bool ok = true;
+  for (size_t i = 0; i < arraysize(kScenarios); ++i) {
+    const std::string name = kScenarios[i].name;
+    const base::DictionaryValue* baseline_entry = NULL;
+    if (!baseline.GetDictionary("scenarios." + name, &baseline_entry)) {
+      printf("%-32s (no baseline, recorded only)\n", name.c_str());
+      continue;
+    }
+    const base::DictionaryValue* entry = NULL;
+    CHECK(report.GetDictionary("scenarios." + name, &entry));
+
+    double current = 0;
+    double baseline_value = 0;
+    CHECK(entry->GetDouble("wall_ms", &current));
+    if (baseline_entry->GetDouble("wall_ms", &baseline_value)) {
+      ok &= CheckMetric(name + " wall_ms", current, baseline_value,
+                        FLAGS_max_wall_regression_percent);
+    }
+    CHECK(entry->GetDouble("cpu_ms", &current));
+    if (baseline_entry->GetDouble("cpu_ms", &baseline_value)) {
+      ok &= CheckMetric(name + " cpu_ms", current, baseline_value,
+                        FLAGS_max_cpu_regression_percent);
+    }
+  }
+
+  double current_rss = 0;
+  double baseline_rss = 0;
+  CHECK(report.GetDouble("peak_rss_kb", &current_rss));
+  if (baseline.GetDouble("peak_rss_kb", &baseline_rss)) {
+    ok &= CheckMetric("peak_rss_kb", current_rss, baseline_rss,
+                      FLAGS_max_rss_regression_percent);
+  }
+  return ok;
+}
+
+int RunPerfTests() {
+  for (size_t i = 0; i < arraysize(kScenarios); ++i) {
+    if (!StageInput(kScenarios[i]))
+      return 1;
+  }
+
+  // All scenarios run concurrently: the gate measures performance under the
+  // same contention a multi-stream packaging job sees, and the whole run
+  // takes about as long as the slowest scenario instead of their sum.
+  std::vector<ScenarioResult> results(arraysize(kScenarios));
+  std::vector<ClosureThread*> threads;
+  for (size_t i = 0; i < arraysize(kScenarios); ++i) {
+    threads.push_back(new ClosureThread(
+        kScenarios[i].name,
+        base::Bind(&RunScenario, &kScenarios[i], &results[i])));
+  }
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i]->Start();
+  for (size_t i = 0; i < threads.size(); ++i)
+    threads[i]->Join();
+  STLDeleteElements(&threads);
+  MemoryFile::DeleteAll();
+
+  for (size_t i = 0; i < arraysize(kScenarios); ++i) {
+    if (!results[i].ok) {
+      LOG(ERROR) << "Scenario " << kScenarios[i].name << " failed.";
+      return 1;
+    }
+    printf("%-32s %10.1f ms wall %10.1f ms cpu\n", kScenarios[i].name,
+           results[i].wall_ms, results[i].cpu_ms);
+  }
+
+  scoped_ptr<base::DictionaryValue> report = BuildReport(results);
+  std::string report_json;
+  CHECK(base::JSONWriter::WriteWithOptions(
+      *report, base::JSONWriter::OPTIONS_PRETTY_PRINT, &report_json));
+  if (base::WriteFile(base::FilePath::FromUTF8Unsafe(FLAGS_perf_report),
+                      report_json.data(),
+                      report_json.size()) < 0) {
+    LOG(ERROR) << "Failed to write report to " << FLAGS_perf_report;
+    return 1;
+  }
+
+  if (FLAGS_perf_baseline.empty())
+    return 0;
+
+  std::string baseline_json;
+  if (!base::ReadFileToString(
+          base::FilePath::FromUTF8Unsafe(FLAGS_perf_baseline),
+          &baseline_json)) {
+    LOG(ERROR) << "Failed to read baseline " << FLAGS_perf_baseline;
+    return 1;
+  }
+  scoped_ptr<base::Value> baseline_root(
+      base::JSONReader::Read(baseline_json));
+  const base::DictionaryValue* baseline = NULL;
+  if (!baseline_root || !baseline_root->GetAsDictionary(&baseline)) {
+    LOG(ERROR) << "Baseline " << FLAGS_perf_baseline
+               << " is not a JSON report.";
+    return 1;
+  }
+  return CheckAgainstBaseline(*report, *baseline) ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace media
+}  // namespace shaka
+
+int main(int argc, char** argv) {
+  base::AtExitManager at_exit;
+  google::SetUsageMessage(
+      "Release performance gate over the packager remux scenarios.");
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  base::CommandLine::Init(argc, argv);
+  CHECK(logging::InitLogging(logging::LoggingSettings()));
+
+  return shaka::media::RunPerfTests();
+}
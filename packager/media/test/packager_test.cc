@@ -236,6 +236,23 @@ void PackagerTestBasic::Decrypt(const std::string& input,
   ASSERT_OK(demuxer.Run());
 }
 
+// Verify that probe mode yields the stream metadata without setting up any
+// media streams.
+TEST_P(PackagerTestBasic, ProbeStreamInfo) {
+  Demuxer demuxer(GetFullPath(GetParam()));
+  demuxer.set_probe_mode(true);
+  ASSERT_OK(demuxer.Initialize());
+
+  EXPECT_TRUE(demuxer.streams().empty());
+  ASSERT_FALSE(demuxer.probed_stream_infos().empty());
+  bool has_video = false;
+  for (size_t i = 0; i < demuxer.probed_stream_infos().size(); ++i) {
+    if (demuxer.probed_stream_infos()[i]->stream_type() == kStreamVideo)
+      has_video = true;
+  }
+  EXPECT_TRUE(has_video);
+}
+
 TEST_P(PackagerTestBasic, MP4MuxerSingleSegmentUnencryptedVideo) {
   ASSERT_NO_FATAL_FAILURE(Remux(GetParam(),
                                 kOutputVideo,
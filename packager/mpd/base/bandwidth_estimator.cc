@@ -7,7 +7,6 @@
 #include "packager/mpd/base/bandwidth_estimator.h"
 
 #include <cmath>
-#include <cstdlib>
 
 #include "packager/base/logging.h"
 
@@ -16,7 +15,8 @@ const int BandwidthEstimator::kUseAllBlocks = 0;
 BandwidthEstimator::BandwidthEstimator(int num_blocks)
     : num_blocks_for_estimation_(num_blocks),
       harmonic_mean_denominator_(0.0),
-      num_blocks_added_(0) {}
+      num_blocks_added_(0),
+      max_bits_per_second_(0.0) {}
 BandwidthEstimator::~BandwidthEstimator() {}
 
 void BandwidthEstimator::AddBlock(uint64_t size, double duration) {
@@ -24,40 +24,59 @@ void BandwidthEstimator::AddBlock(uint64_t size, double duration) {
   DCHECK_GT(size, 0u);
 
   if (num_blocks_for_estimation_ < 0 &&
-      static_cast<int>(history_.size()) >= -1 * num_blocks_for_estimation_) {
+      static_cast<int>(num_blocks_added_) >= -1 * num_blocks_for_estimation_) {
     // Short circuiting the case where |num_blocks_for_estimation_| number of
     // blocks have been added already.
     return;
   }
 
   const int kBitsInByte = 8;
-  const double bits_per_second_reciprocal = duration / (kBitsInByte * size);
-  harmonic_mean_denominator_ += bits_per_second_reciprocal;
-  if (num_blocks_for_estimation_ == kUseAllBlocks) {
-    DCHECK_EQ(history_.size(), 0u);
-    ++num_blocks_added_;
+  const double bits_per_second = kBitsInByte * size / duration;
+  harmonic_mean_denominator_ += 1.0 / bits_per_second;
+  const size_t block_index = num_blocks_added_++;
+
+  if (num_blocks_for_estimation_ <= 0) {
+    if (bits_per_second > max_bits_per_second_)
+      max_bits_per_second_ = bits_per_second;
     return;
   }
 
-  history_.push_back(bits_per_second_reciprocal);
-  if (num_blocks_for_estimation_ > 0 &&
-      static_cast<int>(history_.size()) > num_blocks_for_estimation_) {
-    harmonic_mean_denominator_ -= history_.front();
-    history_.pop_front();
+  // Sliding window mode. The ring buffer stops growing at
+  // |num_blocks_for_estimation_| entries; after that the oldest block leaves
+  // the estimate as the new one enters, all in constant time and memory.
+  const size_t window_size = static_cast<size_t>(num_blocks_for_estimation_);
+  if (sliding_window_.size() < window_size) {
+    sliding_window_.push_back(1.0 / bits_per_second);
+  } else {
+    const size_t ring_index = block_index % window_size;
+    harmonic_mean_denominator_ -= sliding_window_[ring_index];
+    sliding_window_[ring_index] = 1.0 / bits_per_second;
   }
 
-  DCHECK_NE(num_blocks_for_estimation_, kUseAllBlocks);
-  DCHECK_LE(static_cast<int>(history_.size()), abs(num_blocks_for_estimation_));
-  DCHECK_EQ(num_blocks_added_, 0u);
-  return;
+  // Blocks slower than this one can never be the window maximum again.
+  while (!window_max_.empty() && window_max_.back().second <= bits_per_second)
+    window_max_.pop_back();
+  window_max_.push_back(std::make_pair(block_index, bits_per_second));
+  if (window_max_.front().first + window_size <= block_index)
+    window_max_.pop_front();
+  DCHECK_LE(window_max_.size(), window_size);
 }
 
 uint64_t BandwidthEstimator::Estimate() const {
   if (harmonic_mean_denominator_ == 0.0)
     return 0;
 
-  const uint64_t num_blocks = num_blocks_for_estimation_ == kUseAllBlocks
-                                  ? num_blocks_added_
-                                  : history_.size();
+  const uint64_t num_blocks = num_blocks_for_estimation_ > 0
+                                  ? sliding_window_.size()
+                                  : num_blocks_added_;
   return static_cast<uint64_t>(ceil(num_blocks / harmonic_mean_denominator_));
 }
+
+uint64_t BandwidthEstimator::Max() const {
+  if (num_blocks_for_estimation_ <= 0)
+    return static_cast<uint64_t>(ceil(max_bits_per_second_));
+
+  if (window_max_.empty())
+    return 0;
+  return static_cast<uint64_t>(ceil(window_max_.front().second));
+}
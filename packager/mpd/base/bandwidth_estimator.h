@@ -10,7 +10,9 @@
 #include <stddef.h>
 #include <stdint.h>
 
-#include <list>
+#include <deque>
+#include <utility>
+#include <vector>
 
 class BandwidthEstimator {
  public:
@@ -28,16 +30,37 @@ class BandwidthEstimator {
   //         rounded up to the nearest integer.
   uint64_t Estimate() const;
 
+  // @return The high watermark, i.e. the highest per-block bandwidth among the
+  //         blocks considered for estimation, in bits per second, rounded up
+  //         to the nearest integer. This matches the DASH-IF reading of
+  //         @bandwidth: the Representation must be playable at the advertised
+  //         rate during any segment, not just on average.
+  uint64_t Max() const;
+
   static const int kUseAllBlocks;
 
  private:
   const int num_blocks_for_estimation_;
   double harmonic_mean_denominator_;
 
-  // This is not used when num_blocks_for_estimation_ != 0. Therefore it should
-  // always be 0 if num_blocks_for_estimation_ != 0.
+  // Number of blocks considered for estimation so far.
   size_t num_blocks_added_;
-  std::list<double> history_;
+
+  // Ring buffer of the last |num_blocks_for_estimation_| blocks'
+  // bits-per-second reciprocals. Only used when num_blocks_for_estimation_ is
+  // positive; the other modes need nothing but the running values above.
+  std::vector<double> sliding_window_;
+
+  // Highest per-block bandwidth seen so far. Only used when
+  // num_blocks_for_estimation_ is not positive; the sliding window mode uses
+  // |window_max_| below, which can forget blocks that left the window.
+  double max_bits_per_second_;
+
+  // Monotonically decreasing bandwidths, each with the index of the block it
+  // came from, so the front is always the maximum of the current window. Holds
+  // at most |num_blocks_for_estimation_| entries and updates in amortized
+  // constant time.
+  std::deque<std::pair<size_t, double> > window_max_;
 };
 
 #endif  // MPD_BASE_BANDWIDTH_ESTIMATOR_H_
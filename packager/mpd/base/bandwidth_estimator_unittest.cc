@@ -93,4 +93,34 @@ TEST(BandwidthEstimatorTest, FirstOneBlock) {
   EXPECT_EQ(kExptectedEstimate, be.Estimate());
 }
 
+// The high watermark follows the sliding window: once the fastest block
+// leaves the window, a slower block becomes the maximum.
+TEST(BandwidthEstimatorTest, SlidingWindowMax) {
+  BandwidthEstimator be(kNumBlocksForEstimate);
+  const double kDuration = 1.0;
+
+  // Bandwidths are 8, 16, ..., 80 bits per second, always increasing, so the
+  // latest block is the maximum.
+  const uint64_t kNumBlocksToAdd = 10;
+  for (uint64_t i = 1; i <= kNumBlocksToAdd; ++i) {
+    be.AddBlock(i, kDuration);
+    EXPECT_EQ(i * kBitsInByte, be.Max());
+  }
+
+  // A window full of 8 bps blocks pushes everything faster out.
+  for (int i = 0; i < kNumBlocksForEstimate; ++i)
+    be.AddBlock(1, kDuration);
+  EXPECT_EQ(kBitsInByte, be.Max());
+}
+
+// All-blocks mode never forgets the highest bandwidth seen.
+TEST(BandwidthEstimatorTest, AllBlocksMax) {
+  BandwidthEstimator be(BandwidthEstimator::kUseAllBlocks);
+  const double kDuration = 1.0;
+  const uint64_t kLargeBlockSize = 100;
+  be.AddBlock(kLargeBlockSize, kDuration);
+  be.AddBlock(1, kDuration);
+  EXPECT_EQ(kLargeBlockSize * kBitsInByte, be.Max());
+}
+
 } // namespace shaka
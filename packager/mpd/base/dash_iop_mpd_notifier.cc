@@ -50,6 +50,7 @@ DashIopMpdNotifier::DashIopMpdNotifier(
                                       ? MpdBuilder::kDynamic
                                       : MpdBuilder::kStatic,
                                   mpd_options)),
+      adaptation_set_locks_deleter_(&adaptation_set_locks_),
       next_group_id_(kStartingGroupId) {
   DCHECK(dash_profile == kLiveProfile || dash_profile == kOnDemandProfile);
   for (size_t i = 0; i < base_urls.size(); ++i)
@@ -74,6 +75,14 @@ bool DashIopMpdNotifier::NotifyNewContainer(const MediaInfo& media_info,
   const std::string key = GetAdaptationSetKey(media_info);
   AdaptationSet* adaptation_set = GetAdaptationSetForMediaInfo(key, media_info);
   DCHECK(adaptation_set);
+
+  // The mutations below touch |adaptation_set| and, through grouping,
+  // possibly its siblings, so quiesce all AdaptationSets like Flush() does.
+  // This only happens once per container, at stream setup.
+  for (AdaptationSetLockMap::iterator it = adaptation_set_locks_.begin();
+       it != adaptation_set_locks_.end(); ++it) {
+    it->second->Acquire();
+  }
   if (media_info.has_text_info()) {
     // IOP requires all AdaptationSets to have (sub)segmentAlignment set to
     // true, so carelessly set it to true.
@@ -85,28 +94,37 @@ bool DashIopMpdNotifier::NotifyNewContainer(const MediaInfo& media_info,
   MpdBuilder::MakePathsRelativeToMpd(output_path_, &adjusted_media_info);
   Representation* representation =
       adaptation_set->AddRepresentation(adjusted_media_info);
+  if (representation)
+    SetGroupId(key, adaptation_set);
+  for (AdaptationSetLockMap::reverse_iterator it =
+           adaptation_set_locks_.rbegin();
+       it != adaptation_set_locks_.rend(); ++it) {
+    it->second->Release();
+  }
   if (!representation)
     return false;
 
-  representation_id_to_adaptation_set_[representation->id()] = adaptation_set;
-
-  SetGroupId(key, adaptation_set);
+  representation_id_to_adaptation_set_.Add(representation->id(),
+                                           adaptation_set);
 
   *container_id = representation->id();
-  DCHECK(!ContainsKey(representation_map_, representation->id()));
-  representation_map_[representation->id()] = representation;
+  representation_index_.Add(representation->id(), representation);
   return true;
 }
 
 bool DashIopMpdNotifier::NotifySampleDuration(uint32_t container_id,
                                               uint32_t sample_duration) {
-  base::AutoLock auto_lock(lock_);
-  RepresentationMap::iterator it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
-    LOG(ERROR) << "Unexpected container_id: " << container_id;
-    return false;
+  Representation* representation = NULL;
+  base::Lock* adaptation_set_lock = NULL;
+  {
+    base::AutoLock auto_lock(lock_);
+    if (!FindRepresentation(container_id, &representation,
+                            &adaptation_set_lock)) {
+      return false;
+    }
   }
-  it->second->SetSampleDuration(sample_duration);
+  base::AutoLock adaptation_set_auto_lock(*adaptation_set_lock);
+  representation->SetSampleDuration(sample_duration);
   return true;
 }
 
@@ -114,13 +132,17 @@ bool DashIopMpdNotifier::NotifyNewSegment(uint32_t container_id,
                                           uint64_t start_time,
                                           uint64_t duration,
                                           uint64_t size) {
-  base::AutoLock auto_lock(lock_);
-  RepresentationMap::iterator it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
-    LOG(ERROR) << "Unexpected container_id: " << container_id;
-    return false;
+  Representation* representation = NULL;
+  base::Lock* adaptation_set_lock = NULL;
+  {
+    base::AutoLock auto_lock(lock_);
+    if (!FindRepresentation(container_id, &representation,
+                            &adaptation_set_lock)) {
+      return false;
+    }
   }
-  it->second->AddNewSegment(start_time, duration, size);
+  base::AutoLock adaptation_set_auto_lock(*adaptation_set_lock);
+  representation->AddNewSegment(start_time, duration, size);
   return true;
 }
 
@@ -129,17 +151,21 @@ bool DashIopMpdNotifier::NotifyEncryptionUpdate(
     const std::string& drm_uuid,
     const std::vector<uint8_t>& new_key_id,
     const std::vector<uint8_t>& new_pssh) {
-  base::AutoLock auto_lock(lock_);
-  RepresentationMap::iterator it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
-    LOG(ERROR) << "Unexpected container_id: " << container_id;
-    return false;
+  AdaptationSet* adaptation_set = NULL;
+  base::Lock* adaptation_set_lock = NULL;
+  {
+    base::AutoLock auto_lock(lock_);
+    Representation* representation = NULL;
+    if (!FindRepresentation(container_id, &representation,
+                            &adaptation_set_lock)) {
+      return false;
+    }
+    adaptation_set = representation_id_to_adaptation_set_.Find(container_id);
   }
-
-  AdaptationSet* adaptation_set_for_representation =
-      representation_id_to_adaptation_set_[it->second->id()];
-  adaptation_set_for_representation->UpdateContentProtectionPssh(
-      drm_uuid, Uint8VectorToBase64(new_pssh));
+  DCHECK(adaptation_set);
+  base::AutoLock adaptation_set_auto_lock(*adaptation_set_lock);
+  adaptation_set->UpdateContentProtectionPssh(drm_uuid,
+                                              Uint8VectorToBase64(new_pssh));
   return true;
 }
 
@@ -154,20 +180,62 @@ bool DashIopMpdNotifier::AddContentProtectionElement(
 }
 
 bool DashIopMpdNotifier::Flush() {
-  base::AutoLock auto_lock(lock_);
-  return WriteMpdToFile(output_path_, mpd_builder_.get());
+  std::string mpd;
+  {
+    base::AutoLock auto_lock(lock_);
+    // Quiesce every AdaptationSet so that in-flight segment notifications do
+    // not mutate the timelines while the document is serialized. The locks
+    // are ordered by AdaptationSet ID, same as in the notification methods,
+    // so there is no ordering cycle.
+    for (AdaptationSetLockMap::iterator it = adaptation_set_locks_.begin();
+         it != adaptation_set_locks_.end(); ++it) {
+      it->second->Acquire();
+    }
+    const bool success = mpd_builder_->ToString(&mpd);
+    for (AdaptationSetLockMap::reverse_iterator it =
+             adaptation_set_locks_.rbegin();
+         it != adaptation_set_locks_.rend(); ++it) {
+      it->second->Release();
+    }
+    if (!success) {
+      LOG(ERROR) << "Failed to write MPD to string.";
+      return false;
+    }
+  }
+  // The (possibly slow) file write happens outside the locks; notifications
+  // never wait on disk I/O.
+  return WriteMpdStringToFile(output_path_, mpd);
+}
+
+bool DashIopMpdNotifier::FindRepresentation(uint32_t container_id,
+                                            Representation** representation,
+                                            base::Lock** adaptation_set_lock) {
+  lock_.AssertAcquired();
+  Representation* found = representation_index_.Find(container_id);
+  if (!found) {
+    LOG(ERROR) << "Unexpected container_id: " << container_id;
+    return false;
+  }
+  *representation = found;
+
+  AdaptationSet* adaptation_set =
+      representation_id_to_adaptation_set_.Find(container_id);
+  DCHECK(adaptation_set);
+  *adaptation_set_lock = adaptation_set_locks_[adaptation_set->id()];
+  DCHECK(*adaptation_set_lock);
+  return true;
 }
 
 AdaptationSet* DashIopMpdNotifier::GetAdaptationSetForMediaInfo(
     const std::string& key,
     const MediaInfo& media_info) {
-  std::list<AdaptationSet*>& adaptation_sets = adaptation_set_list_map_[key];
+  std::vector<AdaptationSet*>& adaptation_sets = adaptation_set_list_map_[key];
   if (adaptation_sets.empty())
     return NewAdaptationSet(media_info, &adaptation_sets);
 
   const bool has_protected_content = media_info.has_protected_content();
 
-  for (std::list<AdaptationSet*>::const_iterator adaptation_set_it =
+  for (std::vector<AdaptationSet*>::const_iterator adaptation_set_it =
            adaptation_sets.begin();
        adaptation_set_it != adaptation_sets.end(); ++adaptation_set_it) {
     ProtectedContentMap::const_iterator protected_content_it =
@@ -216,13 +284,13 @@ void DashIopMpdNotifier::SetGroupId(const std::string& key,
   std::set<std::string> adaptation_set_uuids =
       GetUUIDs(protected_content_it->second);
 
-  std::list<AdaptationSet*>& same_type_adapatation_sets =
+  std::vector<AdaptationSet*>& same_type_adapatation_sets =
       adaptation_set_list_map_[key];
   DCHECK(!same_type_adapatation_sets.empty())
       << "same_type_adapatation_sets should not be null, it should at least "
          "contain adaptation_set";
 
-  for (std::list<AdaptationSet*>::iterator adaptation_set_it =
+  for (std::vector<AdaptationSet*>::iterator adaptation_set_it =
            same_type_adapatation_sets.begin();
        adaptation_set_it != same_type_adapatation_sets.end();
        ++adaptation_set_it) {
@@ -257,9 +325,11 @@ void DashIopMpdNotifier::SetGroupId(const std::string& key,
 
 AdaptationSet* DashIopMpdNotifier::NewAdaptationSet(
     const MediaInfo& media_info,
-    std::list<AdaptationSet*>* adaptation_sets) {
+    std::vector<AdaptationSet*>* adaptation_sets) {
   std::string language = GetLanguage(media_info);
   AdaptationSet* new_adaptation_set = mpd_builder_->AddAdaptationSet(language);
+  DCHECK(!ContainsKey(adaptation_set_locks_, new_adaptation_set->id()));
+  adaptation_set_locks_[new_adaptation_set->id()] = new base::Lock;
   if (media_info.has_protected_content()) {
     DCHECK(!ContainsKey(protected_content_map_, new_adaptation_set->id()));
     protected_content_map_[new_adaptation_set->id()] =
@@ -9,11 +9,11 @@
 
 #include "packager/mpd/base/mpd_notifier.h"
 
-#include <list>
 #include <map>
 #include <string>
 #include <vector>
 
+#include "packager/base/stl_util.h"
 #include "packager/base/synchronization/lock.h"
 #include "packager/mpd/base/mpd_builder.h"
 #include "packager/mpd/base/mpd_notifier_util.h"
@@ -59,12 +59,20 @@ class DashIopMpdNotifier : public MpdNotifier {
  private:
   friend class DashIopMpdNotifierTest;
 
-  // Maps representation ID to Representation.
-  typedef std::map<uint32_t, Representation*> RepresentationMap;
-
   // Maps AdaptationSet ID to ProtectedContent.
   typedef std::map<uint32_t, MediaInfo::ProtectedContent> ProtectedContentMap;
 
+  // Maps AdaptationSet ID to the lock that guards the AdaptationSet and its
+  // Representations.
+  typedef std::map<uint32_t, base::Lock*> AdaptationSetLockMap;
+
+  // Looks up the Representation for |container_id| and the lock of the
+  // AdaptationSet that owns it. Returns false and logs an error if the id is
+  // unknown. Must be called with |lock_| held.
+  bool FindRepresentation(uint32_t container_id,
+                          Representation** representation,
+                          base::Lock** adaptation_set_lock);
+
   // Checks the protected_content field of media_info and returns a non-null
   // AdaptationSet* for a new Representation.
   // This does not necessarily return a new AdaptationSet. If
@@ -81,7 +89,7 @@ class DashIopMpdNotifier : public MpdNotifier {
   // to the fields (maps) of the instance.
   // If the media is encrypted, registers data to protected_content_map_.
   AdaptationSet* NewAdaptationSet(const MediaInfo& media_info,
-                                  std::list<AdaptationSet*>* adaptation_sets);
+                                  std::vector<AdaptationSet*>* adaptation_sets);
 
   // Testing only method. Returns a pointer to MpdBuilder.
   MpdBuilder* MpdBuilderForTesting() const {
@@ -93,8 +101,11 @@ class DashIopMpdNotifier : public MpdNotifier {
     mpd_builder_ = mpd_builder.Pass();
   }
 
-  std::map<std::string, std::list<AdaptationSet*>> adaptation_set_list_map_;
-  RepresentationMap representation_map_;
+  std::map<std::string, std::vector<AdaptationSet*>> adaptation_set_list_map_;
+
+  // O(1) container id to Representation lookup; every segment notification
+  // goes through it.
+  DenseIdMap<Representation> representation_index_;
 
   // Used to check whether a Representation should be added to an AdaptationSet.
   ProtectedContentMap protected_content_map_;
@@ -102,13 +113,22 @@ class DashIopMpdNotifier : public MpdNotifier {
   // MPD output path.
   std::string output_path_;
   scoped_ptr<MpdBuilder> mpd_builder_;
+
+  // Guards the container maps, AdaptationSet creation and MPD serialization.
+  // Segment notifications only hold it long enough to look up their
+  // Representation, then do the real work under the per-AdaptationSet lock
+  // from |adaptation_set_locks_| so concurrent muxer threads feeding different
+  // AdaptationSets do not contend.
   base::Lock lock_;
+  AdaptationSetLockMap adaptation_set_locks_;
+  STLValueDeleter<AdaptationSetLockMap> adaptation_set_locks_deleter_;
 
   // Next group ID to use for AdapationSets that can be grouped.
   int next_group_id_;
 
-  // Maps Representation ID to AdaptationSet. This is for updating the PSSH.
-  std::map<uint32_t, AdaptationSet*> representation_id_to_adaptation_set_;
+  // Maps Representation ID to AdaptationSet. This is for updating the PSSH
+  // and looking up the AdaptationSet lock of a Representation.
+  DenseIdMap<AdaptationSet> representation_id_to_adaptation_set_;
 };
 
 }  // namespace shaka
@@ -7,9 +7,12 @@
 #include "packager/mpd/base/mpd_builder.h"
 
 #include <libxml/tree.h>
+#include <libxml/xmlsave.h>
 #include <libxml/xmlstring.h>
 
+#include <algorithm>
 #include <cmath>
+#include <deque>
 #include <iterator>
 #include <list>
 #include <string>
@@ -42,6 +45,13 @@ namespace {
 
 const int kAdaptationSetGroupNotSet = -1;
 
+// Upper bound on the number of SegmentInfos kept when no timeShiftBufferDepth
+// is set. Contiguous segments of equal duration collapse into a single
+// SegmentInfo, so this is only ever reached by long-running live streams whose
+// segment durations keep changing. 1000 entries bound the timeline to a few
+// tens of KB per Representation.
+const size_t kMaxSegmentInfos = 1000;
+
 AdaptationSet::Role MediaInfoTextTypeToRole(
     MediaInfo::TextInfo::TextType type) {
   switch (type) {
@@ -78,17 +88,15 @@ std::string GetMimeType(const std::string& prefix,
   return std::string();
 }
 
+const char kXmlNamespace[] = "urn:mpeg:dash:schema:mpd:2011";
+const char kXmlNamespaceXsi[] = "http://www.w3.org/2001/XMLSchema-instance";
+const char kXmlNamespaceXlink[] = "http://www.w3.org/1999/xlink";
+const char kDashSchemaMpd2011[] = "urn:mpeg:dash:schema:mpd:2011 DASH-MPD.xsd";
+const char kCencNamespace[] = "urn:mpeg:cenc:2013";
+
 void AddMpdNameSpaceInfo(XmlNode* mpd) {
   DCHECK(mpd);
 
-  static const char kXmlNamespace[] = "urn:mpeg:dash:schema:mpd:2011";
-  static const char kXmlNamespaceXsi[] =
-      "http://www.w3.org/2001/XMLSchema-instance";
-  static const char kXmlNamespaceXlink[] = "http://www.w3.org/1999/xlink";
-  static const char kDashSchemaMpd2011[] =
-      "urn:mpeg:dash:schema:mpd:2011 DASH-MPD.xsd";
-  static const char kCencNamespace[] = "urn:mpeg:cenc:2013";
-
   mpd->SetStringAttribute("xmlns", kXmlNamespace);
   mpd->SetStringAttribute("xmlns:xsi", kXmlNamespaceXsi);
   mpd->SetStringAttribute("xmlns:xlink", kXmlNamespaceXlink);
@@ -171,7 +179,7 @@ uint64_t LastSegmentEndTime(const SegmentInfo& segment_info) {
          segment_info.duration * (segment_info.repeat + 1);
 }
 
-uint64_t LatestSegmentStartTime(const std::list<SegmentInfo>& segments) {
+uint64_t LatestSegmentStartTime(const std::deque<SegmentInfo>& segments) {
   DCHECK(!segments.empty());
   const SegmentInfo& latest_segment = segments.back();
   return LastSegmentStartTime(latest_segment);
@@ -191,7 +199,7 @@ int SearchTimedOutRepeatIndex(uint64_t timeshift_limit,
 // Overload this function to support different types of |output|.
 // Note that this could be done by call MpdBuilder::ToString() and use the
 // result to write to a file, it requires an extra copy.
-bool WriteXmlCharArrayToOutput(xmlChar* doc,
+bool WriteXmlCharArrayToOutput(const xmlChar* doc,
                                int doc_size,
                                std::string* output) {
   DCHECK(doc);
@@ -200,7 +208,7 @@ bool WriteXmlCharArrayToOutput(xmlChar* doc,
   return true;
 }
 
-bool WriteXmlCharArrayToOutput(xmlChar* doc,
+bool WriteXmlCharArrayToOutput(const xmlChar* doc,
                                int doc_size,
                                media::File* output) {
   DCHECK(doc);
@@ -211,6 +219,26 @@ bool WriteXmlCharArrayToOutput(xmlChar* doc,
   return output->Flush();
 }
 
+// Serializes |doc| into |output|. Used for the sharded output documents,
+// which are small and do not warrant the persistent serialization buffer the
+// main MPD write path keeps.
+bool SerializeDocToString(xmlDocPtr doc, std::string* output) {
+  DCHECK(doc);
+  DCHECK(output);
+  xml::scoped_xml_ptr<xmlBuffer> buffer(xmlBufferCreate());
+  if (!buffer)
+    return false;
+  xmlSaveCtxtPtr save_context =
+      xmlSaveToBuffer(buffer.get(), "UTF-8", XML_SAVE_FORMAT);
+  if (!save_context)
+    return false;
+  const long save_result = xmlSaveDoc(save_context, doc);
+  if (xmlSaveClose(save_context) < 0 || save_result < 0)
+    return false;
+  return WriteXmlCharArrayToOutput(xmlBufferContent(buffer.get()),
+                                   xmlBufferLength(buffer.get()), output);
+}
+
 std::string MakePathRelative(const std::string& path,
                              const std::string& mpd_dir) {
   return (path.find(mpd_dir) == 0) ? path.substr(mpd_dir.size()) : path;
@@ -403,7 +431,8 @@ MpdBuilder::MpdBuilder(MpdType type, const MpdOptions& mpd_options)
     : type_(type),
       mpd_options_(mpd_options),
       adaptation_sets_deleter_(&adaptation_sets_),
-      clock_(new base::DefaultClock()) {}
+      clock_(new base::DefaultClock()),
+      max_shard_duration_seconds_(0.0f) {}
 
 MpdBuilder::~MpdBuilder() {}
 
@@ -430,34 +459,129 @@ bool MpdBuilder::ToString(std::string* output) {
   DCHECK(output);
   return WriteMpdToOutput(output);
 }
+
+bool MpdBuilder::ToXlinkRootString(
+    const std::map<uint32_t, std::string>& shard_hrefs,
+    std::string* output) {
+  DCHECK(output);
+  static LibXmlInitializer lib_xml_initializer;
+
+  xml::scoped_xml_ptr<xmlDoc> doc(GenerateXlinkRootMpd(shard_hrefs));
+  if (!doc)
+    return false;
+  return SerializeDocToString(doc.get(), output);
+}
+
+bool MpdBuilder::AdaptationSetToString(AdaptationSet* adaptation_set,
+                                       std::string* output) {
+  DCHECK(adaptation_set);
+  DCHECK(output);
+  static LibXmlInitializer lib_xml_initializer;
+
+  xml::scoped_xml_ptr<xmlNode> node(adaptation_set->GetXml());
+  if (!node)
+    return false;
+  // Declare the namespaces that are normally inherited from the MPD element,
+  // so the shard is a valid standalone xlink target.
+  xmlSetProp(node.get(), BAD_CAST "xmlns", BAD_CAST kXmlNamespace);
+  xmlSetProp(node.get(), BAD_CAST "xmlns:cenc", BAD_CAST kCencNamespace);
+
+  // Strip the internal 'duration' helper attribute, which GetStaticMpdDuration
+  // normally consumes, and record the maximum for the static root's
+  // mediaPresentationDuration instead.
+  for (xmlNodePtr representation = xmlFirstElementChild(node.get());
+       representation; representation = xmlNextElementSibling(representation)) {
+    float duration = 0.0f;
+    if (GetDurationAttribute(representation, &duration)) {
+      max_shard_duration_seconds_ =
+          std::max(max_shard_duration_seconds_, duration);
+      xmlUnsetProp(representation, BAD_CAST "duration");
+    }
+  }
+
+  static const char kXmlVersion[] = "1.0";
+  xml::scoped_xml_ptr<xmlDoc> doc(xmlNewDoc(BAD_CAST kXmlVersion));
+  xmlDocSetRootElement(doc.get(), node.release());
+  return SerializeDocToString(doc.get(), output);
+}
 template <typename OutputType>
 bool MpdBuilder::WriteMpdToOutput(OutputType* output) {
   static LibXmlInitializer lib_xml_initializer;
 
-  xml::scoped_xml_ptr<xmlDoc> doc(GenerateMpd());
-  if (!doc.get())
+  // Dynamic MPDs are written on every segment notification, so the document
+  // is cached and patched incrementally instead of being rebuilt from
+  // scratch. Static MPDs are generated fresh as before.
+  xml::scoped_xml_ptr<xmlDoc> static_doc;
+  xmlDocPtr doc = NULL;
+  if (type_ == kDynamic) {
+    doc = GetDynamicMpdDocument();
+  } else {
+    static_doc.reset(GenerateMpd());
+    doc = static_doc.get();
+  }
+  if (!doc)
     return false;
 
-  static const int kNiceFormat = 1;
-  int doc_str_size = 0;
-  xmlChar* doc_str = NULL;
-  xmlDocDumpFormatMemoryEnc(doc.get(), &doc_str, &doc_str_size, "UTF-8",
-                            kNiceFormat);
+  // Serialize into a buffer that is kept across writes; after the first
+  // write it already has the capacity for the whole document, so subsequent
+  // updates do not reallocate it.
+  if (!serialization_buffer_) {
+    serialization_buffer_.reset(xmlBufferCreate());
+    if (!serialization_buffer_)
+      return false;
+  } else {
+    xmlBufferEmpty(serialization_buffer_.get());
+  }
+
+  xmlSaveCtxtPtr save_context =
+      xmlSaveToBuffer(serialization_buffer_.get(), "UTF-8", XML_SAVE_FORMAT);
+  if (!save_context)
+    return false;
+  const long save_result = xmlSaveDoc(save_context, doc);
+  if (xmlSaveClose(save_context) < 0 || save_result < 0)
+    return false;
 
-  bool result = WriteXmlCharArrayToOutput(doc_str, doc_str_size, output);
-  xmlFree(doc_str);
+  return WriteXmlCharArrayToOutput(
+      xmlBufferContent(serialization_buffer_.get()),
+      xmlBufferLength(serialization_buffer_.get()), output);
+}
 
-  // Cleanup, free the doc.
-  doc.reset();
-  return result;
+xmlDocPtr MpdBuilder::GetDynamicMpdDocument() {
+  DCHECK_EQ(kDynamic, type_);
+  if (cached_doc_.get()) {
+    // The document can only be patched if all the changes since the last
+    // write are confined to Representation subtrees. Also regenerate while
+    // availabilityStartTime is unknown, so that it gets calculated and added
+    // once segments are available.
+    bool patchable = !availability_start_time_.empty();
+    for (AdaptationSet* adaptation_set : adaptation_sets_) {
+      if (adaptation_set->dirty_) {
+        patchable = false;
+        break;
+      }
+    }
+    if (patchable) {
+      for (AdaptationSet* adaptation_set : adaptation_sets_) {
+        if (!adaptation_set->PatchXml(cached_doc_.get())) {
+          patchable = false;
+          break;
+        }
+      }
+    }
+    if (patchable) {
+      xmlNodePtr mpd_node = xmlDocGetRootElement(cached_doc_.get());
+      DCHECK(mpd_node);
+      xmlSetProp(mpd_node, BAD_CAST "publishTime",
+                 BAD_CAST XmlDateTimeNowWithOffset(0, clock_.get()).c_str());
+      return cached_doc_.get();
+    }
+    cached_doc_.reset();
+  }
+  cached_doc_.reset(GenerateMpd());
+  return cached_doc_.get();
 }
 
 xmlDocPtr MpdBuilder::GenerateMpd() {
-  // Setup nodes.
-  static const char kXmlVersion[] = "1.0";
-  xml::scoped_xml_ptr<xmlDoc> doc(xmlNewDoc(BAD_CAST kXmlVersion));
-  XmlNode mpd("MPD");
-
   // Iterate thru AdaptationSets and add them to one big Period element.
   XmlNode period("Period");
 
@@ -465,13 +589,43 @@ xmlDocPtr MpdBuilder::GenerateMpd() {
   // at the moment, just use a constant.
   // Required for 'dynamic' MPDs.
   period.SetId(0);
-  std::list<AdaptationSet*>::iterator adaptation_sets_it =
-      adaptation_sets_.begin();
-  for (; adaptation_sets_it != adaptation_sets_.end(); ++adaptation_sets_it) {
-    xml::scoped_xml_ptr<xmlNode> child((*adaptation_sets_it)->GetXml());
+  for (AdaptationSet* adaptation_set : adaptation_sets_) {
+    xml::scoped_xml_ptr<xmlNode> child(adaptation_set->GetXml());
     if (!child.get() || !period.AddChild(child.Pass()))
       return NULL;
   }
+  return FinishMpd(&period);
+}
+
+xmlDocPtr MpdBuilder::GenerateXlinkRootMpd(
+    const std::map<uint32_t, std::string>& shard_hrefs) {
+  XmlNode period("Period");
+  period.SetId(0);
+  for (AdaptationSet* adaptation_set : adaptation_sets_) {
+    std::map<uint32_t, std::string>::const_iterator href =
+        shard_hrefs.find(adaptation_set->id());
+    if (href == shard_hrefs.end()) {
+      LOG(ERROR) << "No shard href for AdaptationSet "
+                 << adaptation_set->id() << ".";
+      return NULL;
+    }
+    // An empty reference element; the player fetches the actual content from
+    // the href when it loads the MPD.
+    XmlNode reference("AdaptationSet");
+    reference.SetId(adaptation_set->id());
+    reference.SetStringAttribute("xlink:href", href->second);
+    reference.SetStringAttribute("xlink:actuate", "onLoad");
+    if (!period.AddChild(reference.PassScopedPtr()))
+      return NULL;
+  }
+  return FinishMpd(&period);
+}
+
+xmlDocPtr MpdBuilder::FinishMpd(XmlNode* period) {
+  DCHECK(period);
+  static const char kXmlVersion[] = "1.0";
+  xml::scoped_xml_ptr<xmlDoc> doc(xmlNewDoc(BAD_CAST kXmlVersion));
+  XmlNode mpd("MPD");
 
   // Add baseurls to MPD.
   std::list<std::string>::const_iterator base_urls_it = base_urls_.begin();
@@ -485,10 +639,10 @@ xmlDocPtr MpdBuilder::GenerateMpd() {
 
   if (type_ == kDynamic) {
     // This is the only Period and it is a regular period.
-    period.SetStringAttribute("start", "PT0S");
+    period->SetStringAttribute("start", "PT0S");
   }
 
-  if (!mpd.AddChild(period.PassScopedPtr()))
+  if (!mpd.AddChild(period->PassScopedPtr()))
     return NULL;
 
   AddMpdNameSpaceInfo(&mpd);
@@ -540,9 +694,12 @@ void MpdBuilder::AddStaticMpdInfo(XmlNode* mpd_node) {
       "urn:mpeg:dash:profile:isoff-on-demand:2011";
   mpd_node->SetStringAttribute("type", kStaticMpdType);
   mpd_node->SetStringAttribute("profiles", kStaticMpdProfile);
+  // |max_shard_duration_seconds_| covers AdaptationSets which are only xlink
+  // references in this document; it is zero for regular inline MPDs.
   mpd_node->SetStringAttribute(
       "mediaPresentationDuration",
-      SecondsToXmlDuration(GetStaticMpdDuration(mpd_node)));
+      SecondsToXmlDuration(std::max(GetStaticMpdDuration(mpd_node),
+                                    max_shard_duration_seconds_)));
 }
 
 void MpdBuilder::AddDynamicMpdInfo(XmlNode* mpd_node) {
@@ -628,11 +785,9 @@ bool MpdBuilder::GetEarliestTimestamp(double* timestamp_seconds) {
   DCHECK(timestamp_seconds);
 
   double earliest_timestamp(-1);
-  for (std::list<AdaptationSet*>::const_iterator iter =
-           adaptation_sets_.begin();
-       iter != adaptation_sets_.end(); ++iter) {
+  for (AdaptationSet* adaptation_set : adaptation_sets_) {
     double timestamp;
-    if ((*iter)->GetEarliestTimestamp(&timestamp) &&
+    if (adaptation_set->GetEarliestTimestamp(&timestamp) &&
         ((earliest_timestamp < 0) || (timestamp < earliest_timestamp))) {
       earliest_timestamp = timestamp;
     }
@@ -680,12 +835,15 @@ AdaptationSet::AdaptationSet(uint32_t adaptation_set_id,
     : representations_deleter_(&representations_),
       representation_counter_(counter),
       id_(adaptation_set_id),
-      lang_(lang),
+      // Normalize the language once at registration: the lookup table scan in
+      // LanguageToShortestForm does not belong in the per-write GetXml path.
+      lang_(lang.empty() ? lang : LanguageToShortestForm(lang)),
       mpd_options_(mpd_options),
       mpd_type_(mpd_type),
       group_(kAdaptationSetGroupNotSet),
       segments_aligned_(kSegmentAlignmentUnknown),
-      force_set_segment_alignment_(false) {
+      force_set_segment_alignment_(false),
+      dirty_(true) {
   DCHECK(counter);
 }
 
@@ -732,6 +890,7 @@ Representation* AdaptationSet::AddRepresentation(const MediaInfo& media_info) {
   }
 
   representations_.push_back(representation.get());
+  dirty_ = true;
   return representation.release();
 }
 
@@ -739,16 +898,19 @@ void AdaptationSet::AddContentProtectionElement(
     const ContentProtectionElement& content_protection_element) {
   content_protection_elements_.push_back(content_protection_element);
   RemoveDuplicateAttributes(&content_protection_elements_.back());
+  dirty_ = true;
 }
 
 void AdaptationSet::UpdateContentProtectionPssh(const std::string& drm_uuid,
                                                 const std::string& pssh) {
   UpdateContentProtectionPsshHelper(drm_uuid, pssh,
                                     &content_protection_elements_);
+  dirty_ = true;
 }
 
 void AdaptationSet::AddRole(Role role) {
   roles_.insert(role);
+  dirty_ = true;
 }
 
 // Creates a copy of <AdaptationSet> xml element, iterate thru all the
@@ -767,7 +929,7 @@ xml::scoped_xml_ptr<xmlNode> AdaptationSet::GetXml() {
   adaptation_set.SetId(id_);
   adaptation_set.SetStringAttribute("contentType", content_type_);
   if (!lang_.empty() && lang_ != "und") {
-    adaptation_set.SetStringAttribute("lang", LanguageToShortestForm(lang_));
+    adaptation_set.SetStringAttribute("lang", lang_);
   }
 
   // Note that std::{set,map} are ordered, so the last element is the max value.
@@ -831,17 +993,67 @@ xml::scoped_xml_ptr<xmlNode> AdaptationSet::GetXml() {
       return xml::scoped_xml_ptr<xmlNode>();
   }
 
+  dirty_ = false;
   return adaptation_set.PassScopedPtr();
 }
 
+bool AdaptationSet::PatchXml(xmlDocPtr doc) {
+  DCHECK(doc);
+  // The suppression decisions match the ones GetXml() made when the cached
+  // document was generated; any change to these sets marks this instance
+  // dirty, which forces a full regeneration instead of a patch.
+  const bool suppress_representation_width = video_widths_.size() == 1;
+  const bool suppress_representation_height = video_heights_.size() == 1;
+  const bool suppress_representation_frame_rate = video_frame_rates_.size() == 1;
+
+  for (Representation* representation : representations_) {
+    if (representation->dirty_) {
+      // Non-segment state changed; regenerate the whole subtree.
+      xmlNodePtr old_node = representation->cached_doc_node_;
+      if (!old_node || old_node->doc != doc)
+        return false;
+      if (suppress_representation_width)
+        representation->SuppressOnce(Representation::kSuppressWidth);
+      if (suppress_representation_height)
+        representation->SuppressOnce(Representation::kSuppressHeight);
+      if (suppress_representation_frame_rate)
+        representation->SuppressOnce(Representation::kSuppressFrameRate);
+      xml::scoped_xml_ptr<xmlNode> new_node(representation->GetXml());
+      if (!new_node)
+        return false;
+      xmlReplaceNode(old_node, new_node.release());
+      xmlFreeNode(old_node);
+    } else {
+      // Steady state: at most segment information changed, so touch just
+      // the bandwidth attribute and the SegmentTemplate region of the
+      // cached node.
+      if (!representation->PatchXml(doc))
+        return false;
+    }
+  }
+  return true;
+}
+
+bool AdaptationSet::HasPendingChanges() const {
+  if (dirty_)
+    return true;
+  for (Representation* representation : representations_) {
+    if (representation->dirty_ || representation->segments_dirty_)
+      return true;
+  }
+  return false;
+}
+
 void AdaptationSet::ForceSetSegmentAlignment(bool segment_alignment) {
   segments_aligned_ =
       segment_alignment ? kSegmentAlignmentTrue : kSegmentAlignmentFalse;
   force_set_segment_alignment_ = true;
+  dirty_ = true;
 }
 
 void AdaptationSet::SetGroup(int group_number) {
   group_ = group_number;
+  dirty_ = true;
 }
 
 int AdaptationSet::Group() const {
@@ -877,11 +1089,9 @@ bool AdaptationSet::GetEarliestTimestamp(double* timestamp_seconds) {
   DCHECK(timestamp_seconds);
 
   double earliest_timestamp(-1);
-  for (std::list<Representation*>::const_iterator iter =
-           representations_.begin();
-       iter != representations_.end(); ++iter) {
+  for (Representation* representation : representations_) {
     double timestamp;
-    if ((*iter)->GetEarliestTimestamp(&timestamp) &&
+    if (representation->GetEarliestTimestamp(&timestamp) &&
         ((earliest_timestamp < 0) || (timestamp < earliest_timestamp))) {
       earliest_timestamp = timestamp;
     }
@@ -949,9 +1159,12 @@ void AdaptationSet::CheckLiveSegmentAlignment(uint32_t representation_id,
       // around.
       segments_aligned_ = kSegmentAlignmentFalse;
       representation_segment_start_times_.clear();
+      dirty_ = true;
       return;
     }
   }
+  if (segments_aligned_ != kSegmentAlignmentTrue)
+    dirty_ = true;
   segments_aligned_ = kSegmentAlignmentTrue;
 
   for (RepresentationTimeline::iterator it =
@@ -1031,6 +1244,7 @@ void AdaptationSet::RecordFrameRate(uint32_t frame_duration,
   }
   video_frame_rates_[static_cast<double>(timescale) / frame_duration] =
       base::IntToString(timescale) + "/" + base::IntToString(frame_duration);
+  dirty_ = true;
 }
 
 Representation::Representation(
@@ -1042,9 +1256,17 @@ Representation::Representation(
       id_(id),
       bandwidth_estimator_(BandwidthEstimator::kUseAllBlocks),
       mpd_options_(mpd_options),
-      start_number_(1),
+      // A stream taking over a live channel continues the previous
+      // instance's segment numbering; see MediaInfo.segment_start_number.
+      start_number_(media_info.has_segment_start_number()
+                        ? media_info.segment_start_number()
+                        : 1),
       state_change_listener_(state_change_listener.Pass()),
-      output_suppression_flags_(0) {}
+      output_suppression_flags_(0),
+      dirty_(true),
+      segments_dirty_(false),
+      cached_bandwidth_(0),
+      cached_doc_node_(NULL) {}
 
 Representation::~Representation() {}
 
@@ -1094,12 +1316,14 @@ void Representation::AddContentProtectionElement(
     const ContentProtectionElement& content_protection_element) {
   content_protection_elements_.push_back(content_protection_element);
   RemoveDuplicateAttributes(&content_protection_elements_.back());
+  dirty_ = true;
 }
 
 void Representation::UpdateContentProtectionPssh(const std::string& drm_uuid,
                                                  const std::string& pssh) {
   UpdateContentProtectionPsshHelper(drm_uuid, pssh,
                                     &content_protection_elements_);
+  dirty_ = true;
 }
 
 void Representation::AddNewSegment(uint64_t start_time,
@@ -1124,11 +1348,15 @@ void Representation::AddNewSegment(uint64_t start_time,
 
   SlideWindow();
   DCHECK_GE(segment_infos_.size(), 1u);
+  // Segment-only change: the cached XML can be patched instead of
+  // regenerated.
+  segments_dirty_ = true;
 }
 
 void Representation::SetSampleDuration(uint32_t sample_duration) {
   if (media_info_.has_video_info()) {
     media_info_.mutable_video_info()->set_frame_duration(sample_duration);
+    dirty_ = true;
     if (state_change_listener_) {
       state_change_listener_->OnSetFrameRateForRepresentation(
           sample_duration, media_info_.video_info().time_scale());
@@ -1158,6 +1386,7 @@ xml::scoped_xml_ptr<xmlNode> Representation::GetXml() {
   // Mandatory fields for Representation.
   representation.SetId(id_);
   representation.SetIntegerAttribute("bandwidth", bandwidth);
+  cached_bandwidth_ = bandwidth;
   if (!codecs_.empty())
     representation.SetStringAttribute("codecs", codecs_);
   representation.SetStringAttribute("mimeType", mime_type_);
@@ -1202,11 +1431,65 @@ xml::scoped_xml_ptr<xmlNode> Representation::GetXml() {
   // SegmentTemplate. Optimize and propagate the tag up to AdaptationSet level.
 
   output_suppression_flags_ = 0;
+  dirty_ = false;
+  segments_dirty_ = false;
+  cached_doc_node_ = representation.GetRawPtr();
   return representation.PassScopedPtr();
 }
 
+bool Representation::PatchXml(xmlDocPtr doc) {
+  DCHECK(doc);
+  DCHECK(!dirty_);
+  if (!segments_dirty_)
+    return true;
+  xmlNodePtr node = cached_doc_node_;
+  if (!node || node->doc != doc)
+    return false;
+  // Only live segment information changes in steady state; VOD segment info
+  // is written once.
+  if (!HasLiveOnlyFields(media_info_))
+    return false;
+
+  // The estimate moves as segments arrive; re-format and set the attribute
+  // only when the value actually changed.
+  const uint64_t bandwidth = media_info_.has_bandwidth()
+                                 ? media_info_.bandwidth()
+                                 : bandwidth_estimator_.Estimate();
+  if (bandwidth != cached_bandwidth_) {
+    xmlSetProp(node, BAD_CAST "bandwidth",
+               BAD_CAST base::Uint64ToString(bandwidth).c_str());
+    cached_bandwidth_ = bandwidth;
+  }
+
+  // Rebuild the <SegmentTemplate> subtree - the only element that changes
+  // when segments are added or expire - and swap it into the cached node.
+  // Everything else (codecs, mimeType, audio/video info, content
+  // protection) stays untouched.
+  RepresentationXmlNode scratch;
+  if (!scratch.AddLiveOnlyInfo(media_info_, segment_infos_, start_number_))
+    return false;
+  xmlNodePtr new_template = xmlFirstElementChild(scratch.GetRawPtr());
+  DCHECK(new_template);
+  xmlNodePtr old_template = NULL;
+  for (xmlNodePtr child = xmlFirstElementChild(node); child;
+       child = xmlNextElementSibling(child)) {
+    if (xmlStrcmp(child->name, BAD_CAST "SegmentTemplate") == 0) {
+      old_template = child;
+      break;
+    }
+  }
+  if (!old_template)
+    return false;
+  xmlUnlinkNode(new_template);
+  xmlReplaceNode(old_template, new_template);
+  xmlFreeNode(old_template);
+  segments_dirty_ = false;
+  return true;
+}
+
 void Representation::SuppressOnce(SuppressFlag flag) {
   output_suppression_flags_ |= flag;
+  dirty_ = true;
 }
 
 bool Representation::HasRequiredMediaInfoFields() {
@@ -1286,8 +1569,19 @@ bool Representation::IsContiguous(uint64_t start_time,
 
 void Representation::SlideWindow() {
   DCHECK(!segment_infos_.empty());
-  if (mpd_options_.time_shift_buffer_depth <= 0.0)
+  if (mpd_options_.time_shift_buffer_depth <= 0.0) {
+    // Nothing expires without a timeShiftBufferDepth, but the timeline must
+    // not grow without bound for 24/7 live streams; drop the oldest runs once
+    // the safety limit is reached.
+    while (segment_infos_.size() > kMaxSegmentInfos) {
+      LOG(WARNING) << "Reached the maximum of " << kMaxSegmentInfos
+                   << " SegmentInfos without a timeShiftBufferDepth to expire "
+                      "them. Dropping the oldest segments.";
+      start_number_ += segment_infos_.front().repeat + 1;
+      segment_infos_.pop_front();
+    }
     return;
+  }
 
   const uint32_t time_scale = GetTimeScale(media_info_);
   DCHECK_GT(time_scale, 0u);
@@ -1305,8 +1599,8 @@ void Representation::SlideWindow() {
 
   // First remove all the SegmentInfos that are completely out of range, by
   // looking at the very last segment's end time.
-  std::list<SegmentInfo>::iterator first = segment_infos_.begin();
-  std::list<SegmentInfo>::iterator last = first;
+  std::deque<SegmentInfo>::iterator first = segment_infos_.begin();
+  std::deque<SegmentInfo>::iterator last = first;
   size_t num_segments_removed = 0;
   for (; last != segment_infos_.end(); ++last) {
     const uint64_t last_segment_end_time = LastSegmentEndTime(*last);
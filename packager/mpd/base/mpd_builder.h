@@ -17,10 +17,12 @@
 
 #include <stdint.h>
 
+#include <deque>
 #include <list>
 #include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "packager/base/atomic_sequence_num.h"
 #include "packager/base/callback.h"
@@ -89,6 +91,27 @@ class MpdBuilder {
   /// @return true on success, false otherwise.
   virtual bool ToString(std::string* output);
 
+  /// Writes a root MPD which references every AdaptationSet externally via
+  /// xlink instead of inlining it. Together with AdaptationSetToString() this
+  /// implements sharded MPD output: the root stays small and stable while
+  /// each AdaptationSet's timeline lives in its own document.
+  /// @param shard_hrefs maps AdaptationSet id to the URL written as the
+  ///        xlink:href of the corresponding reference element. Every
+  ///        AdaptationSet added to this builder must have an entry.
+  /// @param[out] output is an output string where the root MPD gets written.
+  /// @return true on success, false otherwise.
+  virtual bool ToXlinkRootString(
+      const std::map<uint32_t, std::string>& shard_hrefs,
+      std::string* output);
+
+  /// Serializes @a adaptation_set as a standalone XML document suitable as an
+  /// xlink target of a root MPD written by ToXlinkRootString().
+  /// @param adaptation_set must be owned by this builder.
+  /// @param[out] output is an output string where the document gets written.
+  /// @return true on success, false otherwise.
+  virtual bool AdaptationSetToString(AdaptationSet* adaptation_set,
+                                     std::string* output);
+
   /// @return The mpd type.
   MpdType type() const { return type_; }
 
@@ -118,11 +141,29 @@ class MpdBuilder {
   template <typename OutputType>
   bool WriteMpdToOutput(OutputType* output);
 
+  // Returns the document for a dynamic MPD. The document is cached between
+  // writes; when only Representation timelines changed since the last write,
+  // the stale <Representation> subtrees and the publishTime attribute are
+  // patched in place instead of rebuilding the whole document.
+  // The returned document is owned by this instance. Returns NULL on failure.
+  xmlDocPtr GetDynamicMpdDocument();
+
   // Returns the document pointer to the MPD. This must be freed by the caller
   // using appropriate xmlDocPtr freeing function.
   // On failure, this returns NULL.
   xmlDocPtr GenerateMpd();
 
+  // Same as GenerateMpd() but the Period contains an empty <AdaptationSet>
+  // reference element with an xlink:href from |shard_hrefs| per AdaptationSet
+  // instead of the full subtree.
+  xmlDocPtr GenerateXlinkRootMpd(
+      const std::map<uint32_t, std::string>& shard_hrefs);
+
+  // Shared tail of MPD generation: wraps |period| in an <MPD> element with
+  // BaseURLs, namespaces and profile specific attributes, and returns the
+  // finished document. On failure, this returns NULL.
+  xmlDocPtr FinishMpd(xml::XmlNode* period);
+
   // Set MPD attributes common to all profiles. Uses non-zero |mpd_options_| to
   // set attributes for the MPD.
   void AddCommonMpdInfo(xml::XmlNode* mpd_node);
@@ -146,8 +187,11 @@ class MpdBuilder {
 
   MpdType type_;
   MpdOptions mpd_options_;
-  std::list<AdaptationSet*> adaptation_sets_;
-  STLElementDeleter<std::list<AdaptationSet*> > adaptation_sets_deleter_;
+  // Contiguous storage: the AdaptationSets are walked on every MPD write, so
+  // keep them in a vector for cache locality. Pointers stay stable; only the
+  // pointer array moves on growth.
+  std::vector<AdaptationSet*> adaptation_sets_;
+  STLElementDeleter<std::vector<AdaptationSet*> > adaptation_sets_deleter_;
 
   std::list<std::string> base_urls_;
   std::string availability_start_time_;
@@ -159,6 +203,21 @@ class MpdBuilder {
   // testing.
   scoped_ptr<base::Clock> clock_;
 
+  // Cached document for dynamic MPDs, reused and patched across writes. See
+  // GetDynamicMpdDocument().
+  xml::scoped_xml_ptr<xmlDoc> cached_doc_;
+
+  // Serialization buffer, reused across writes so that repeated MPD updates
+  // do not reallocate (and copy the document through) a fresh libxml buffer
+  // every time. Only ever touched from WriteMpdToOutput(), i.e. under the
+  // owning notifier's lock.
+  xml::scoped_xml_ptr<xmlBuffer> serialization_buffer_;
+
+  // Maximum media duration seen across AdaptationSetToString() calls. A
+  // static xlink root cannot read the durations out of its reference-only
+  // children, so they are collected while the shards are serialized.
+  float max_shard_duration_seconds_;
+
   DISALLOW_COPY_AND_ASSIGN(MpdBuilder);
 };
 
@@ -247,6 +306,11 @@ class AdaptationSet {
   // Must be unique in the Period.
   uint32_t id() const { return id_; }
 
+  /// @return true if this AdaptationSet or any of its Representations changed
+  ///         since the last GetXml() call, i.e. a previously serialized form
+  ///         of this element is stale.
+  bool HasPendingChanges() const;
+
   /// Notifies the AdaptationSet instance that a new (sub)segment was added to
   /// the Representation with @a representation_id.
   /// This must be called every time a (sub)segment is added to a
@@ -340,13 +404,22 @@ class AdaptationSet {
   // Records the framerate of a Representation.
   void RecordFrameRate(uint32_t frame_duration, uint32_t timescale);
 
+  // Regenerates the subtree of every child Representation whose XML is stale
+  // and replaces it in |doc|. Returns false if the document cannot be
+  // patched, in which case the caller should rebuild the whole document.
+  bool PatchXml(xmlDocPtr doc);
+
   std::list<ContentProtectionElement> content_protection_elements_;
-  std::list<Representation*> representations_;
-  STLElementDeleter<std::list<Representation*> > representations_deleter_;
+  // See the comment on MpdBuilder::adaptation_sets_; serialization walks the
+  // Representations on every write.
+  std::vector<Representation*> representations_;
+  STLElementDeleter<std::vector<Representation*> > representations_deleter_;
 
   base::AtomicSequenceNumber* const representation_counter_;
 
   const uint32_t id_;
+  // Language in its shortest (RFC 5646) form, normalized at construction so
+  // manifest writes do no language processing.
   const std::string lang_;
   const MpdOptions& mpd_options_;
   const MpdBuilder::MpdType mpd_type_;
@@ -391,6 +464,11 @@ class AdaptationSet {
   SegmentAligmentStatus segments_aligned_;
   bool force_set_segment_alignment_;
 
+  // True if an attribute or child of the <AdaptationSet> element itself
+  // changed since the last GetXml() call. Changes confined to a child
+  // Representation are tracked by the Representation instead.
+  bool dirty_;
+
   // Keeps track of segment start times of Representations.
   // For VOD, this will not be cleared, all the segment start times are
   // stored in this. This should not out-of-memory for a reasonable length
@@ -524,6 +602,13 @@ class Representation {
 
   bool AddLiveInfo(xml::RepresentationXmlNode* representation);
 
+  // Patch the cached <Representation> node in place for changes confined to
+  // segment information: re-set @bandwidth if the (estimated) value moved
+  // and rebuild the <SegmentTemplate> subtree. Only valid when |dirty_| is
+  // not set. Returns false if the cached node cannot be patched, in which
+  // case the caller falls back to full regeneration.
+  bool PatchXml(xmlDocPtr doc);
+
   // Returns true if |media_info_| has required fields to generate a valid
   // Representation. Otherwise returns false.
   bool HasRequiredMediaInfoFields();
@@ -553,7 +638,10 @@ class Representation {
   // any logic using this can assume only one set.
   MediaInfo media_info_;
   std::list<ContentProtectionElement> content_protection_elements_;
-  std::list<SegmentInfo> segment_infos_;
+  // Runs of contiguous segments, in timeline order. A deque keeps the runs in
+  // a few contiguous blocks and pops expired runs from the front in O(1), so
+  // long-running live streams do not pay std::list's per-node overhead.
+  std::deque<SegmentInfo> segment_infos_;
 
   const uint32_t id_;
   std::string mime_type_;
@@ -572,6 +660,26 @@ class Representation {
   // Bit vector for tracking witch attributes should not be output.
   int output_suppression_flags_;
 
+  // True if the <Representation> element needs to be regenerated, i.e. the
+  // state of this instance changed since the last GetXml() call.
+  bool dirty_;
+
+  // True if only segment information changed since the last GetXml() call -
+  // segments added or expired, which also moves the bandwidth estimate -
+  // while the rest of the element is unchanged. Such changes are patched
+  // into the cached node instead of regenerating the whole subtree. Cleared
+  // by GetXml() and PatchXml().
+  bool segments_dirty_;
+
+  // The @bandwidth value in the cached node; the attribute is re-formatted
+  // and re-set only when the value actually changed.
+  uint64_t cached_bandwidth_;
+
+  // The node returned by the last GetXml() call. Not owned by this instance;
+  // it is only valid for patching while the cached MPD document it was
+  // attached to is alive.
+  xmlNodePtr cached_doc_node_;
+
   DISALLOW_COPY_AND_ASSIGN(Representation);
 };
 
@@ -1989,6 +1989,38 @@ TEST_F(StaticMpdBuilderTest, WriteToFile) {
   EXPECT_TRUE(DeleteFile(file_path, kNonRecursive));
 }
 
+// Verify sharded output serialization: the AdaptationSet document stands
+// alone and the root MPD only references it via xlink.
+TEST_F(StaticMpdBuilderTest, ShardedOutput) {
+  MediaInfo video_media_info = GetTestMediaInfo(kFileNameVideoMediaInfo1);
+  AdaptationSet* adaptation_set = mpd_.AddAdaptationSet("");
+  ASSERT_TRUE(adaptation_set);
+  ASSERT_TRUE(adaptation_set->AddRepresentation(video_media_info));
+
+  EXPECT_TRUE(adaptation_set->HasPendingChanges());
+  std::string shard;
+  ASSERT_TRUE(mpd_.AdaptationSetToString(adaptation_set, &shard));
+  EXPECT_FALSE(adaptation_set->HasPendingChanges());
+  EXPECT_NE(std::string::npos, shard.find("<AdaptationSet"));
+  EXPECT_NE(std::string::npos, shard.find("<Representation"));
+  EXPECT_NE(std::string::npos,
+            shard.find("xmlns=\"urn:mpeg:dash:schema:mpd:2011\""));
+  // The internal 'duration' helper attribute must not leak into the shard.
+  EXPECT_EQ(std::string::npos, shard.find(" duration="));
+
+  std::map<uint32_t, std::string> shard_hrefs;
+  shard_hrefs[adaptation_set->id()] = "manifest_set_0.mpd";
+  std::string root;
+  ASSERT_TRUE(mpd_.ToXlinkRootString(shard_hrefs, &root));
+  EXPECT_NE(std::string::npos, root.find("xlink:href=\"manifest_set_0.mpd\""));
+  EXPECT_NE(std::string::npos, root.find("xlink:actuate=\"onLoad\""));
+  // The Representation lives in the shard, not in the root, and the helper
+  // duration recorded while serializing the shard still sets the static
+  // root's mediaPresentationDuration.
+  EXPECT_EQ(std::string::npos, root.find("<Representation"));
+  EXPECT_NE(std::string::npos, root.find("mediaPresentationDuration"));
+}
+
 // Verify that a text path works.
 TEST_F(StaticMpdBuilderTest, Text) {
   const char kTextMediaInfo[] =
@@ -2075,6 +2107,40 @@ TEST_F(SegmentTemplateTest, OneSegmentNormal) {
   EXPECT_NO_FATAL_FAILURE(CheckMpd(kFileNameExpectedMpdOutputDynamicNormal));
 }
 
+// Writes between segment additions patch the cached dynamic MPD document
+// instead of rebuilding it; the patched output must match the output of a
+// full generation.
+TEST_F(SegmentTemplateTest, SegmentsAddedAfterWrite) {
+  const uint64_t kStartTime = 0;
+  const uint64_t kDuration = 10;
+  const uint64_t kSize = 128;
+  AddSegments(kStartTime, kDuration, kSize, 0);
+
+  // This write populates the document cache.
+  std::string unused;
+  ASSERT_TRUE(mpd_.ToString(&unused));
+
+  const uint64_t kLaterStartTime = 100;
+  const uint64_t kRepeat = 3;
+  AddSegments(kLaterStartTime, kDuration, kSize, kRepeat);
+  ASSERT_NO_FATAL_FAILURE(CheckMpdAgainstExpectedResult());
+}
+
+// Repeated write/add cycles keep patching the same cached document. Each
+// patched output must match a full generation, including the bandwidth
+// attribute, whose estimate moves with every added segment.
+TEST_F(SegmentTemplateTest, SegmentsAddedAcrossMultipleWrites) {
+  const uint64_t kRepeat = 0;
+  uint64_t start_time = 0;
+  for (int i = 0; i < 3; ++i) {
+    // Vary the duration so each cycle emits its own S element.
+    const uint64_t duration = 10 + i;
+    AddSegments(start_time, duration, 128 + i * 1000, kRepeat);
+    start_time += duration;
+    ASSERT_NO_FATAL_FAILURE(CheckMpdAgainstExpectedResult());
+  }
+}
+
 TEST_F(SegmentTemplateTest, NormalRepeatedSegmentDuration) {
   const uint64_t kSize = 256;
   uint64_t start_time = 0;
@@ -2471,6 +2537,40 @@ TEST_F(TimeShiftBufferDepthTest, ManySegments) {
       kDefaultStartNumber + kExpectedRemovedSegments));
 }
 
+// Without timeShiftBufferDepth, nothing can expire but the timeline should
+// still not grow without bound. Every segment gets a unique duration below so
+// that no two of them collapse into one SegmentInfo.
+TEST_F(TimeShiftBufferDepthTest, BoundedWhenNoTimeShiftBufferDepth) {
+  // Must match kMaxSegmentInfos in mpd_builder.cc.
+  const size_t kMaxSegmentInfos = 1000;
+  const size_t kExtraSegmentInfos = 3;
+  const uint64_t kSize = 20000;
+
+  uint64_t start_time = 0;
+  for (size_t i = 0; i < kMaxSegmentInfos + kExtraSegmentInfos; ++i) {
+    const uint64_t duration = DefaultTimeScale() + i;
+    AddSegments(start_time, duration, kSize, 0);
+    start_time += duration;
+  }
+
+  std::string mpd_doc;
+  ASSERT_TRUE(mpd_.ToString(&mpd_doc));
+
+  // The oldest segments should have been dropped, with startNumber advanced
+  // past them.
+  const std::string expected_start_number = base::StringPrintf(
+      "startNumber=\"%d\"",
+      static_cast<int>(kExtraSegmentInfos) + kDefaultStartNumber);
+  EXPECT_NE(std::string::npos, mpd_doc.find(expected_start_number));
+
+  size_t num_s_elements = 0;
+  for (size_t pos = mpd_doc.find("<S "); pos != std::string::npos;
+       pos = mpd_doc.find("<S ", pos + 1)) {
+    ++num_s_elements;
+  }
+  EXPECT_EQ(kMaxSegmentInfos, num_s_elements);
+}
+
 TEST(RelativePaths, PathsModified) {
   const std::string kCommonPath(FilePath("foo").Append("bar").value());
   const std::string kMediaFileBase("media.mp4");
@@ -6,16 +6,36 @@
 
 #include "packager/mpd/base/mpd_notifier_util.h"
 
+#include "packager/base/files/file_path.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_piece.h"
 #include "packager/base/strings/string_util.h"
 #include "packager/media/file/file_closer.h"
 #include "packager/media/file/file.h"
+#include "packager/media/file/gzip_file.h"
 #include "packager/mpd/base/mpd_utils.h"
 
 namespace shaka {
 
 using media::File;
 using media::FileCloser;
+using media::GzipFile;
+
+namespace {
+
+// Returns true if the MPD at |path| should be written gzip compressed.
+// Compression is opted into by giving the output a ".gz" suffix. A trailing
+// ".tmp" is ignored so that temporary files which get renamed over the real
+// output (see SimpleMpdNotifier::SerializeAndWriteMpd) use the encoding of
+// the final path.
+bool IsGzipOutputPath(base::StringPiece path) {
+  const base::StringPiece kTempSuffix(".tmp");
+  if (path.ends_with(kTempSuffix))
+    path.remove_suffix(kTempSuffix.size());
+  return path.ends_with(".gz");
+}
+
+}  // namespace
 
 bool WriteMpdToFile(const std::string& output_path, MpdBuilder* mpd_builder) {
   CHECK(!output_path.empty());
@@ -25,12 +45,22 @@ bool WriteMpdToFile(const std::string& output_path, MpdBuilder* mpd_builder) {
     LOG(ERROR) << "Failed to write MPD to string.";
     return false;
   }
+  return WriteMpdStringToFile(output_path, mpd);
+}
+
+bool WriteMpdStringToFile(const std::string& output_path,
+                          const std::string& mpd) {
+  CHECK(!output_path.empty());
 
   scoped_ptr<File, FileCloser> file(File::Open(output_path.c_str(), "w"));
   if (!file) {
     LOG(ERROR) << "Failed to open file for writing: " << output_path;
     return false;
   }
+  // The MPD is streamed through the compressor as it is written, there is no
+  // separate read-compress-write pass.
+  if (IsGzipOutputPath(output_path))
+    file.reset(new GzipFile(file.Pass()));
 
   const char* mpd_char_ptr = mpd.data();
   size_t mpd_bytes_left = mpd.size();
@@ -48,6 +78,14 @@ bool WriteMpdToFile(const std::string& output_path, MpdBuilder* mpd_builder) {
   return file.release()->Close();
 }
 
+std::string AdaptationSetShardPath(const std::string& mpd_path,
+                                   uint32_t adaptation_set_id) {
+  return base::FilePath::FromUTF8Unsafe(mpd_path)
+      .InsertBeforeExtensionASCII("_set_" +
+                                  base::UintToString(adaptation_set_id))
+      .AsUTF8Unsafe();
+}
+
 ContentType GetContentType(const MediaInfo& media_info) {
   const bool has_video = media_info.has_video_info();
   const bool has_audio = media_info.has_audio_info();
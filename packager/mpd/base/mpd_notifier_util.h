@@ -10,10 +10,13 @@
 #ifndef MPD_BASE_MPD_NOTIFIER_UTIL_H_
 #define MPD_BASE_MPD_NOTIFIER_UTIL_H_
 
+#include <stdint.h>
+
 #include <string>
 #include <vector>
 
 #include "packager/base/base64.h"
+#include "packager/base/logging.h"
 #include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mpd_builder.h"
 
@@ -26,11 +29,59 @@ enum ContentType {
   kContentTypeText
 };
 
-/// Outputs MPD to @a output_path.
+/// Maps ids to objects for MpdNotifier implementations. AdaptationSet and
+/// Representation ids are assigned densely from per-MpdBuilder counters
+/// starting at zero, so the map can be backed by a contiguous vector instead
+/// of a tree: Find() is O(1) and the table stays cache friendly no matter how
+/// many Representations a packaging run has.
+/// The registered objects are not owned by this class.
+template <typename T>
+class DenseIdMap {
+ public:
+  DenseIdMap() {}
+
+  /// Registers @a value under @a id. @a id must not be registered yet.
+  void Add(uint32_t id, T* value) {
+    if (id >= values_.size())
+      values_.resize(id + 1, NULL);
+    DCHECK(!values_[id]);
+    values_[id] = value;
+  }
+
+  /// @return The object registered under @a id, or NULL if there is none.
+  T* Find(uint32_t id) const {
+    return id < values_.size() ? values_[id] : NULL;
+  }
+
+ private:
+  std::vector<T*> values_;
+
+  DISALLOW_COPY_AND_ASSIGN(DenseIdMap);
+};
+
+/// Outputs MPD to @a output_path. If @a output_path ends with ".gz" the MPD
+/// is gzip compressed while it is written.
 /// @param output_path is the path to the MPD output location.
 /// @param mpd_builder is the MPD builder instance.
 bool WriteMpdToFile(const std::string& output_path, MpdBuilder* mpd_builder);
 
+/// Outputs an already serialized MPD to @a output_path. Useful when the
+/// serialization and the (possibly slow) file write should not happen under
+/// the same lock.
+/// @param output_path is the path to the MPD output location.
+/// @param mpd is the serialized MPD.
+bool WriteMpdStringToFile(const std::string& output_path,
+                          const std::string& mpd);
+
+/// Returns the path of the shard file holding the AdaptationSet with
+/// @a adaptation_set_id when the MPD at @a mpd_path is written in sharded
+/// mode: "_set_<id>" is inserted before the extension, so the shards are
+/// siblings of the root MPD and can be referenced with relative hrefs.
+/// @param mpd_path is the path of the root MPD.
+/// @param adaptation_set_id is the id of the AdaptationSet.
+std::string AdaptationSetShardPath(const std::string& mpd_path,
+                                   uint32_t adaptation_set_id);
+
 /// Determines the content type of |media_info|.
 /// @param media_info is the information about the media.
 /// @return content type of the @a media_info.
@@ -19,7 +19,9 @@ struct MpdOptions {
         // TODO(tinskip): Set min_buffer_time in unit tests rather than here.
         min_buffer_time(2.0),
         time_shift_buffer_depth(0),
-        suggested_presentation_delay(0) {}
+        suggested_presentation_delay(0),
+        mpd_flush_interval_seconds(0),
+        sharded_output(false) {}
 
   ~MpdOptions() {};
 
@@ -28,6 +30,16 @@ struct MpdOptions {
   double min_buffer_time;
   double time_shift_buffer_depth;
   double suggested_presentation_delay;
+
+  // If positive, MPD updates are written by a dedicated thread at most once
+  // per this many seconds, coalescing pending updates. If zero or negative,
+  // the MPD is written synchronously on every flush.
+  double mpd_flush_interval_seconds;
+
+  // If true, each AdaptationSet is written to its own file, referenced via
+  // xlink from a small root MPD. Only the shards that changed since the last
+  // write are rewritten.
+  bool sharded_output;
 };
 
 }  // namespace shaka
@@ -10,6 +10,7 @@
 
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/media/base/hex_base64.h"
 #include "packager/mpd/base/xml/scoped_xml_ptr.h"
 
 namespace shaka {
@@ -182,7 +183,7 @@ bool HexToUUID(const std::string& data, std::string* uuid_format) {
   }
 
   const std::string hex_encoded =
-      base::StringToLowerASCII(base::HexEncode(data.data(), data.size()));
+      media::HexEncodeLowerFast(data.data(), data.size());
   DCHECK_EQ(hex_encoded.size(), kExpectedUUIDSize * 2);
   base::StringPiece all(hex_encoded);
   // Note UUID has 5 parts separated with dashes.
@@ -313,13 +314,12 @@ void AddContentProtectionElementsHelperTemplated(
       drm_content_protection.value = entry.name_version();
 
     if (entry.has_pssh()) {
-      std::string base64_encoded_pssh;
-      base::Base64Encode(
-          base::StringPiece(entry.pssh().data(), entry.pssh().size()),
-          &base64_encoded_pssh);
+      // The same few pssh boxes are re-encoded on every manifest update, so
+      // serve them from the encode cache.
       Element cenc_pssh;
       cenc_pssh.name = kPsshElementName;
-      cenc_pssh.content = base64_encoded_pssh;
+      cenc_pssh.content =
+          media::Base64EncodeCached(entry.pssh().data(), entry.pssh().size());
       drm_content_protection.subelements.push_back(cenc_pssh);
     }
 
@@ -6,13 +6,40 @@
 
 #include "packager/mpd/base/simple_mpd_notifier.h"
 
+#include <utility>
+
+#include "packager/base/bind.h"
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
 #include "packager/base/logging.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/trace_span.h"
 #include "packager/mpd/base/mpd_builder.h"
 #include "packager/mpd/base/mpd_notifier_util.h"
 #include "packager/mpd/base/mpd_utils.h"
 
 namespace shaka {
 
+namespace {
+
+// Writes |content| to a temporary file next to |path|, then atomically swaps
+// it in, so readers polling |path| never observe a partially written file.
+bool WriteFileAtomically(const std::string& path, const std::string& content) {
+  const std::string temp_path = path + ".tmp";
+  if (!WriteMpdStringToFile(temp_path, content))
+    return false;
+  base::File::Error error;
+  if (!base::ReplaceFile(base::FilePath::FromUTF8Unsafe(temp_path),
+                         base::FilePath::FromUTF8Unsafe(path), &error)) {
+    LOG(ERROR) << "Failed to rename " << temp_path << " to " << path << " ("
+               << error << ").";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
 SimpleMpdNotifier::SimpleMpdNotifier(DashProfile dash_profile,
                                      const MpdOptions& mpd_options,
                                      const std::vector<std::string>& base_urls,
@@ -22,13 +49,29 @@ SimpleMpdNotifier::SimpleMpdNotifier(DashProfile dash_profile,
       mpd_builder_(new MpdBuilder(dash_profile == kLiveProfile
                                       ? MpdBuilder::kDynamic
                                       : MpdBuilder::kStatic,
-                                  mpd_options)) {
+                                  mpd_options)),
+      sharded_output_(mpd_options.sharded_output),
+      adaptation_sets_in_root_(0),
+      mpd_flush_interval_seconds_(mpd_options.mpd_flush_interval_seconds),
+      flush_cv_(&flush_lock_),
+      flush_pending_(false),
+      flush_thread_exit_(false) {
   DCHECK(dash_profile == kLiveProfile || dash_profile == kOnDemandProfile);
   for (size_t i = 0; i < base_urls.size(); ++i)
     mpd_builder_->AddBaseUrl(base_urls[i]);
 }
 
 SimpleMpdNotifier::~SimpleMpdNotifier() {
+  if (flush_thread_) {
+    {
+      base::AutoLock auto_lock(flush_lock_);
+      flush_thread_exit_ = true;
+      flush_cv_.Signal();
+    }
+    // The thread writes out any pending update before it exits, so no flush
+    // requested before destruction is lost.
+    flush_thread_->Join();
+  }
 }
 
 bool SimpleMpdNotifier::Init() {
@@ -65,20 +108,19 @@ bool SimpleMpdNotifier::NotifyNewContainer(const MediaInfo& media_info,
   // generate a valid MPD.
   AddContentProtectionElements(media_info, representation);
   *container_id = representation->id();
-  DCHECK(!ContainsKey(representation_map_, representation->id()));
-  representation_map_[representation->id()] = representation;
+  representation_index_.Add(representation->id(), representation);
   return true;
 }
 
 bool SimpleMpdNotifier::NotifySampleDuration(uint32_t container_id,
                                              uint32_t sample_duration) {
   base::AutoLock auto_lock(lock_);
-  RepresentationMap::iterator it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
+  Representation* representation = representation_index_.Find(container_id);
+  if (!representation) {
     LOG(ERROR) << "Unexpected container_id: " << container_id;
     return false;
   }
-  it->second->SetSampleDuration(sample_duration);
+  representation->SetSampleDuration(sample_duration);
   return true;
 }
 
@@ -87,12 +129,12 @@ bool SimpleMpdNotifier::NotifyNewSegment(uint32_t container_id,
                                          uint64_t duration,
                                          uint64_t size) {
   base::AutoLock auto_lock(lock_);
-  RepresentationMap::iterator it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
+  Representation* representation = representation_index_.Find(container_id);
+  if (!representation) {
     LOG(ERROR) << "Unexpected container_id: " << container_id;
     return false;
   }
-  it->second->AddNewSegment(start_time, duration, size);
+  representation->AddNewSegment(start_time, duration, size);
   return true;
 }
 
@@ -102,13 +144,13 @@ bool SimpleMpdNotifier::NotifyEncryptionUpdate(
     const std::vector<uint8_t>& new_key_id,
     const std::vector<uint8_t>& new_pssh) {
   base::AutoLock auto_lock(lock_);
-  RepresentationMap::iterator it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
+  Representation* representation = representation_index_.Find(container_id);
+  if (!representation) {
     LOG(ERROR) << "Unexpected container_id: " << container_id;
     return false;
   }
-  it->second->UpdateContentProtectionPssh(drm_uuid,
-                                          Uint8VectorToBase64(new_pssh));
+  representation->UpdateContentProtectionPssh(drm_uuid,
+                                              Uint8VectorToBase64(new_pssh));
   return true;
 }
 
@@ -116,18 +158,137 @@ bool SimpleMpdNotifier::AddContentProtectionElement(
     uint32_t container_id,
     const ContentProtectionElement& content_protection_element) {
   base::AutoLock auto_lock(lock_);
-  RepresentationMap::iterator it = representation_map_.find(container_id);
-  if (it == representation_map_.end()) {
+  Representation* representation = representation_index_.Find(container_id);
+  if (!representation) {
     LOG(ERROR) << "Unexpected container_id: " << container_id;
     return false;
   }
-  it->second->AddContentProtectionElement(content_protection_element);
+  representation->AddContentProtectionElement(content_protection_element);
   return true;
 }
 
 bool SimpleMpdNotifier::Flush() {
-  base::AutoLock auto_lock(lock_);
-  return WriteMpdToFile(output_path_, mpd_builder_.get());
+  if (mpd_flush_interval_seconds_ <= 0.0) {
+    if (sharded_output_)
+      return WriteShardedMpd();
+    TRACE_SPAN("manifest", "SimpleMpdNotifier::WriteMpd");
+    base::AutoLock auto_lock(lock_);
+    return WriteMpdToFile(output_path_, mpd_builder_.get());
+  }
+
+  // Debounced mode: just mark an update pending and let the flusher thread
+  // coalesce and write it. Write errors are logged by the thread.
+  base::AutoLock auto_lock(flush_lock_);
+  if (!flush_thread_) {
+    flush_thread_.reset(new media::ClosureThread(
+        "MpdFlushThread",
+        base::Bind(&SimpleMpdNotifier::FlushThreadMain,
+                   base::Unretained(this))));
+    flush_thread_->Start();
+  }
+  flush_pending_ = true;
+  flush_cv_.Signal();
+  return true;
+}
+
+bool SimpleMpdNotifier::SerializeAndWriteMpd() {
+  TRACE_SPAN("manifest", "SimpleMpdNotifier::WriteMpd");
+  std::string mpd;
+  {
+    base::AutoLock auto_lock(lock_);
+    if (!mpd_builder_->ToString(&mpd)) {
+      LOG(ERROR) << "Failed to write MPD to string.";
+      return false;
+    }
+  }
+
+  return WriteFileAtomically(output_path_, mpd);
+}
+
+bool SimpleMpdNotifier::WriteShardedMpd() {
+  TRACE_SPAN("manifest", "SimpleMpdNotifier::WriteShardedMpd");
+  // Serialize under the lock, write files outside of it, so the (possibly
+  // slow) file writes do not block segment notifications.
+  std::vector<std::pair<std::string, std::string> > files;  // path, content.
+  {
+    base::AutoLock auto_lock(lock_);
+    std::map<uint32_t, std::string> shard_hrefs;
+    for (AdaptationSetMap::const_iterator it = adaptation_set_map_.begin();
+         it != adaptation_set_map_.end(); ++it) {
+      AdaptationSet* adaptation_set = it->second;
+      const std::string shard_path =
+          AdaptationSetShardPath(output_path_, adaptation_set->id());
+      // The shards are siblings of the root MPD, so reference them relative
+      // to it.
+      shard_hrefs[adaptation_set->id()] =
+          base::FilePath::FromUTF8Unsafe(shard_path).BaseName().AsUTF8Unsafe();
+      if (!adaptation_set->HasPendingChanges())
+        continue;
+      std::string shard;
+      if (!mpd_builder_->AdaptationSetToString(adaptation_set, &shard)) {
+        LOG(ERROR) << "Failed to write AdaptationSet " << adaptation_set->id()
+                   << " shard to string.";
+        return false;
+      }
+      files.push_back(std::make_pair(shard_path, shard));
+    }
+    // The root only references the shards, so it goes stale only when an
+    // AdaptationSet is added. Keeping it byte-identical otherwise is the
+    // point of this mode: origin caches keep serving it while the shards
+    // carry the timeline updates.
+    if (adaptation_set_map_.size() != adaptation_sets_in_root_) {
+      std::string root;
+      if (!mpd_builder_->ToXlinkRootString(shard_hrefs, &root)) {
+        LOG(ERROR) << "Failed to write root MPD to string.";
+        return false;
+      }
+      // The root is written after the shards (below), so it never references
+      // a shard file that does not exist yet.
+      files.push_back(std::make_pair(output_path_, root));
+      adaptation_sets_in_root_ = adaptation_set_map_.size();
+    }
+  }
+
+  for (size_t i = 0; i < files.size(); ++i) {
+    if (!WriteFileAtomically(files[i].first, files[i].second))
+      return false;
+  }
+  return true;
+}
+
+void SimpleMpdNotifier::FlushThreadMain() {
+  const base::TimeDelta flush_interval =
+      base::TimeDelta::FromSecondsD(mpd_flush_interval_seconds_);
+  base::AutoLock auto_lock(flush_lock_);
+  while (true) {
+    while (!flush_pending_ && !flush_thread_exit_)
+      flush_cv_.Wait();
+    if (!flush_pending_) {
+      DCHECK(flush_thread_exit_);
+      break;
+    }
+    flush_pending_ = false;
+    {
+      base::AutoUnlock auto_unlock(flush_lock_);
+      if (sharded_output_)
+        WriteShardedMpd();
+      else
+        SerializeAndWriteMpd();
+    }
+    // Debounce: do not write again until the interval has passed. Requests
+    // arriving in the meantime coalesce into the next write. Exit requests
+    // cut the wait short; any pending update is written by the loop above
+    // before the thread exits.
+    const base::TimeTicks next_write_time =
+        base::TimeTicks::Now() + flush_interval;
+    while (!flush_thread_exit_) {
+      const base::TimeDelta remaining =
+          next_write_time - base::TimeTicks::Now();
+      if (remaining <= base::TimeDelta())
+        break;
+      flush_cv_.TimedWait(remaining);
+    }
+  }
 }
 
 }  // namespace shaka
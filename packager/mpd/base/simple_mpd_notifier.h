@@ -13,7 +13,9 @@
 
 #include "packager/base/gtest_prod_util.h"
 #include "packager/base/memory/scoped_ptr.h"
+#include "packager/base/synchronization/condition_variable.h"
 #include "packager/base/synchronization/lock.h"
+#include "packager/media/base/closure_thread.h"
 #include "packager/mpd/base/mpd_notifier.h"
 #include "packager/mpd/base/mpd_notifier_util.h"
 
@@ -69,16 +71,49 @@ class SimpleMpdNotifier : public MpdNotifier {
     mpd_builder_ = mpd_builder.Pass();
   }
 
+  // Serializes the MPD synchronously and writes it to |output_path_| via a
+  // temporary file and an atomic rename, so readers polling the file never
+  // observe a partial write.
+  bool SerializeAndWriteMpd();
+
+  // Sharded output mode: writes every AdaptationSet that changed since the
+  // last write to its own file next to |output_path_|, and rewrites the small
+  // xlink root MPD only when the set of AdaptationSets changed. Each file is
+  // published with the same temporary file plus atomic rename scheme.
+  bool WriteShardedMpd();
+
+  // Entry point of |flush_thread_|. Waits for flush requests, writes the MPD
+  // at most once per |mpd_flush_interval_seconds_| and coalesces requests
+  // that arrive in between.
+  void FlushThreadMain();
+
   // MPD output path.
   std::string output_path_;
   scoped_ptr<MpdBuilder> mpd_builder_;
   base::Lock lock_;
 
+  // Sharded output mode (see WriteShardedMpd()).
+  const bool sharded_output_;
+  // Number of AdaptationSets covered by the last written root MPD. The root
+  // is rewritten only when this goes stale.
+  size_t adaptation_sets_in_root_;
+
+  // Debounced asynchronous flushing; only used when
+  // |mpd_flush_interval_seconds_| is positive. |flush_lock_| guards
+  // |flush_pending_| and |flush_thread_exit_|.
+  const double mpd_flush_interval_seconds_;
+  scoped_ptr<media::ClosureThread> flush_thread_;
+  base::Lock flush_lock_;
+  base::ConditionVariable flush_cv_;
+  bool flush_pending_;
+  bool flush_thread_exit_;
+
   typedef std::map<std::string, AdaptationSet*> AdaptationSetMap;
   AdaptationSetMap adaptation_set_map_;
 
-  typedef std::map<uint32_t, Representation*> RepresentationMap;
-  RepresentationMap representation_map_;
+  // O(1) container id to Representation lookup; every segment notification
+  // goes through it.
+  DenseIdMap<Representation> representation_index_;
 
   DISALLOW_COPY_AND_ASSIGN(SimpleMpdNotifier);
 };
@@ -196,6 +196,40 @@ TEST_F(SimpleMpdNotifierTest, NotifyNewContainerAndSampleDurationNoMock) {
   EXPECT_TRUE(notifier.Flush());
 }
 
+// Verify sharded output mode end to end: Flush() writes a shard file per
+// AdaptationSet and a root MPD that composes them via xlink.
+TEST_F(SimpleMpdNotifierTest, ShardedOutput) {
+  MpdOptions sharded_mpd_options;
+  sharded_mpd_options.sharded_output = true;
+  SimpleMpdNotifier notifier(kOnDemandProfile, sharded_mpd_options,
+                             empty_base_urls_, output_path_);
+  uint32_t container_id;
+  EXPECT_TRUE(notifier.NotifyNewContainer(ConvertToMediaInfo(kValidMediaInfo),
+                                          &container_id));
+  EXPECT_TRUE(notifier.Flush());
+
+  const std::string shard_path =
+      AdaptationSetShardPath(output_path_, kDefaultAdaptationSetId);
+  const std::string shard_href =
+      base::FilePath::FromUTF8Unsafe(shard_path).BaseName().AsUTF8Unsafe();
+
+  std::string root;
+  ASSERT_TRUE(base::ReadFileToString(
+      base::FilePath::FromUTF8Unsafe(output_path_), &root));
+  EXPECT_NE(std::string::npos, root.find("xlink:href=\"" + shard_href + "\""));
+  EXPECT_EQ(std::string::npos, root.find("<Representation"));
+
+  std::string shard;
+  ASSERT_TRUE(base::ReadFileToString(
+      base::FilePath::FromUTF8Unsafe(shard_path), &shard));
+  EXPECT_NE(std::string::npos, shard.find("<AdaptationSet"));
+  EXPECT_NE(std::string::npos, shard.find("<Representation"));
+
+  const bool kNonRecursive = false;
+  EXPECT_TRUE(base::DeleteFile(base::FilePath::FromUTF8Unsafe(shard_path),
+                               kNonRecursive));
+}
+
 // Verify that NotifyNewSegment() for live works.
 TEST_F(SimpleMpdNotifierTest, LiveNotifyNewSegment) {
   SimpleMpdNotifier notifier(kLiveProfile, empty_mpd_option_, empty_base_urls_,
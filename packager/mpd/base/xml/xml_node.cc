@@ -31,16 +31,33 @@ std::string RangeToString(const Range& range) {
          base::Uint64ToString(range.end());
 }
 
-bool PopulateSegmentTimeline(const std::list<SegmentInfo>& segment_infos,
+// Longest uint64_t is 20 digits.
+const size_t kMaxUint64Digits = 20;
+
+// Formats |number| in decimal into |buffer|, which must hold at least
+// kMaxUint64Digits + 1 chars, and returns a pointer to the NUL-terminated
+// result inside the buffer. Unlike base::Uint64ToString this does not
+// allocate, which matters on the per-segment SegmentTimeline path.
+char* FormatUint64(uint64_t number, char* buffer) {
+  char* pos = buffer + kMaxUint64Digits;
+  *pos = '\0';
+  do {
+    *--pos = '0' + static_cast<char>(number % 10);
+    number /= 10;
+  } while (number > 0);
+  return pos;
+}
+
+bool PopulateSegmentTimeline(const std::deque<SegmentInfo>& segment_infos,
                              XmlNode* segment_timeline) {
-  for (std::list<SegmentInfo>::const_iterator it = segment_infos.begin();
+  for (std::deque<SegmentInfo>::const_iterator it = segment_infos.begin();
        it != segment_infos.end();
        ++it) {
     XmlNode s_element("S");
-    s_element.SetIntegerAttribute("t", it->start_time);
-    s_element.SetIntegerAttribute("d", it->duration);
+    s_element.AddNewIntegerAttribute("t", it->start_time);
+    s_element.AddNewIntegerAttribute("d", it->duration);
     if (it->repeat > 0)
-      s_element.SetIntegerAttribute("r", it->repeat);
+      s_element.AddNewIntegerAttribute("r", it->repeat);
 
     CHECK(segment_timeline->AddChild(s_element.PassScopedPtr()));
   }
@@ -111,9 +128,22 @@ void XmlNode::SetStringAttribute(const char* attribute_name,
 void XmlNode::SetIntegerAttribute(const char* attribute_name, uint64_t number) {
   DCHECK(node_);
   DCHECK(attribute_name);
+  char buffer[kMaxUint64Digits + 1];
   xmlSetProp(node_.get(),
              BAD_CAST attribute_name,
-             BAD_CAST (base::Uint64ToString(number).c_str()));
+             BAD_CAST FormatUint64(number, buffer));
+}
+
+void XmlNode::AddNewIntegerAttribute(const char* attribute_name,
+                                     uint64_t number) {
+  DCHECK(node_);
+  DCHECK(attribute_name);
+  // xmlNewProp() skips the existing-attribute search that xmlSetProp() does,
+  // which is safe because the attribute is known not to exist.
+  char buffer[kMaxUint64Digits + 1];
+  xmlNewProp(node_.get(),
+             BAD_CAST attribute_name,
+             BAD_CAST FormatUint64(number, buffer));
 }
 
 void XmlNode::SetFloatingPointAttribute(const char* attribute_name,
@@ -297,7 +327,7 @@ bool RepresentationXmlNode::AddVODOnlyInfo(const MediaInfo& media_info) {
 
 bool RepresentationXmlNode::AddLiveOnlyInfo(
     const MediaInfo& media_info,
-    const std::list<SegmentInfo>& segment_infos,
+    const std::deque<SegmentInfo>& segment_infos,
     uint32_t start_number) {
   XmlNode segment_template("SegmentTemplate");
   if (media_info.has_reference_time_scale()) {
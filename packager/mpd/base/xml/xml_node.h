@@ -13,6 +13,7 @@
 #include <libxml/tree.h>
 #include <stdint.h>
 
+#include <deque>
 #include <list>
 
 #include "packager/mpd/base/content_protection_element.h"
@@ -55,6 +56,14 @@ class XmlNode {
   /// @param number The value (rhs) of the attribute.
   void SetIntegerAttribute(const char* attribute_name, uint64_t number);
 
+  /// Adds an integer attribute which must not exist on this element yet.
+  /// Cheaper than SetIntegerAttribute() because it skips the search for an
+  /// existing attribute with the same name; meant for hot paths that build
+  /// fresh elements, like SegmentTimeline.
+  /// @param attribute_name The name (lhs) of the attribute.
+  /// @param number The value (rhs) of the attribute.
+  void AddNewIntegerAttribute(const char* attribute_name, uint64_t number);
+
   /// Set a floating point number attribute.
   /// @param attribute_name is the name of the attribute to set.
   /// @param number is the value (rhs) of the attribute.
@@ -157,7 +166,7 @@ class RepresentationXmlNode : public RepresentationBaseXmlNode {
   /// @param segment_infos is a set of SegmentInfos. This method assumes that
   ///        SegmentInfos are sorted by its start time.
   bool AddLiveOnlyInfo(const MediaInfo& media_info,
-                       const std::list<SegmentInfo>& segment_infos,
+                       const std::deque<SegmentInfo>& segment_infos,
                        uint32_t start_number);
 
  private:
@@ -7,6 +7,7 @@
 #include <gtest/gtest.h>
 #include <libxml/tree.h>
 
+#include <deque>
 #include <list>
 
 #include "packager/base/logging.h"
@@ -78,7 +79,7 @@ class RepresentationTest : public ::testing::Test {
 
  protected:
   RepresentationXmlNode representation_;
-  std::list<SegmentInfo> segment_infos_;
+  std::deque<SegmentInfo> segment_infos_;
 };
 
 // Make sure XmlEqual() is functioning correctly.
@@ -58,6 +58,7 @@
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../media/base/media_base.gyp:media_base',
         '../media/file/file.gyp:file',
         '../third_party/libxml/libxml.gyp:libxml',
         '../version/version.gyp:version',
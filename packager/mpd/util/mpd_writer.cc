@@ -10,6 +10,9 @@
 #include <google/protobuf/text_format.h>
 #include <stdint.h>
 
+#include <algorithm>
+#include <map>
+
 #include "packager/base/files/file_path.h"
 #include "packager/base/files/file_util.h"
 #include "packager/media/file/file.h"
@@ -59,6 +62,48 @@ class SimpleMpdNotifierFactory : public MpdNotifierFactory {
   }
 };
 
+// Key that groups MediaInfos written by different shards of the same stream:
+// segment-aligned shards share one init segment and one segment template
+// namespace, while distinct streams differ in at least one of the two.
+std::string ShardGroupKey(const MediaInfo& media_info) {
+  return media_info.init_segment_name() + '\n' + media_info.segment_template();
+}
+
+// Registers the segment timeline of a segment-templated |media_info| with
+// |notifier|. MediaInfo carries no per-segment timing, but templated content
+// is cut at a fixed segment duration, so the timeline is reconstructed from
+// segment_duration_seconds and media_duration_seconds.
+bool NotifyTemplatedSegments(const MediaInfo& media_info,
+                             uint32_t container_id,
+                             MpdNotifier* notifier) {
+  if (media_info.segment_duration_seconds() <= 0.0f ||
+      media_info.media_duration_seconds() <= 0.0f) {
+    LOG(ERROR) << "Cannot reconstruct the segment timeline for '"
+               << media_info.segment_template()
+               << "': segment_duration_seconds and media_duration_seconds "
+                  "are required in the MediaInfo.";
+    return false;
+  }
+  const uint32_t timescale = media_info.has_reference_time_scale()
+                                 ? media_info.reference_time_scale()
+                                 : 1;
+  const uint64_t segment_duration = static_cast<uint64_t>(
+      media_info.segment_duration_seconds() * timescale + 0.5);
+  uint64_t remaining_duration = static_cast<uint64_t>(
+      media_info.media_duration_seconds() * timescale + 0.5);
+  uint64_t start_time = 0;
+  while (remaining_duration > 0) {
+    const uint64_t duration = std::min(segment_duration, remaining_duration);
+    // Segment sizes are not recorded in MediaInfo; the bandwidth attribute
+    // comes from the MediaInfo itself so a zero size is fine here.
+    if (!notifier->NotifyNewSegment(container_id, start_time, duration, 0))
+      return false;
+    start_time += duration;
+    remaining_duration -= duration;
+  }
+  return true;
+}
+
 }  // namespace
 
 MpdWriter::MpdWriter()
@@ -69,8 +114,9 @@ MpdWriter::MpdWriter()
                                   new SimpleMpdNotifierFactory())) {}
 MpdWriter::~MpdWriter() {}
 
-bool MpdWriter::AddFile(const std::string& media_info_path,
-                        const std::string& mpd_path) {
+bool ReadMediaInfoFile(const std::string& media_info_path,
+                       MediaInfo* media_info) {
+  DCHECK(media_info);
   std::string file_content;
   if (!media::File::ReadFileToString(media_info_path.c_str(),
                                      &file_content)) {
@@ -78,26 +124,80 @@ bool MpdWriter::AddFile(const std::string& media_info_path,
     return false;
   }
 
-  MediaInfo media_info;
   if (!::google::protobuf::TextFormat::ParseFromString(file_content,
-                                                       &media_info)) {
+                                                       media_info)) {
     LOG(ERROR) << "Failed to parse " << file_content << " to MediaInfo.";
     return false;
   }
+  return true;
+}
+
+bool MpdWriter::AddFile(const std::string& media_info_path,
+                        const std::string& mpd_path) {
+  MediaInfo media_info;
+  if (!ReadMediaInfoFile(media_info_path, &media_info))
+    return false;
 
-  MpdBuilder::MakePathsRelativeToMpd(mpd_path, &media_info);
-  media_infos_.push_back(media_info);
+  AddMediaInfo(media_info, mpd_path);
   return true;
 }
 
+void MpdWriter::AddMediaInfo(const MediaInfo& media_info,
+                             const std::string& mpd_path) {
+  MediaInfo adjusted_media_info(media_info);
+  MpdBuilder::MakePathsRelativeToMpd(mpd_path, &adjusted_media_info);
+  media_infos_.push_back(adjusted_media_info);
+}
+
+void MpdWriter::MergeShardMediaInfos() {
+  std::map<std::string, std::list<MediaInfo>::iterator> groups;
+  std::list<MediaInfo>::iterator it = media_infos_.begin();
+  while (it != media_infos_.end()) {
+    if (!it->has_segment_template()) {
+      ++it;
+      continue;
+    }
+    const std::string key = ShardGroupKey(*it);
+    std::map<std::string, std::list<MediaInfo>::iterator>::iterator group =
+        groups.find(key);
+    if (group == groups.end()) {
+      // First shard of this stream; it keeps its position in the list and
+      // accumulates the others.
+      groups[key] = it;
+      ++it;
+      continue;
+    }
+    MediaInfo* merged = &*group->second;
+    merged->set_media_duration_seconds(merged->media_duration_seconds() +
+                                       it->media_duration_seconds());
+    // Shards cover different content so their bandwidths differ; the largest
+    // one is the conservative value for the whole stream.
+    if (it->bandwidth() > merged->bandwidth())
+      merged->set_bandwidth(it->bandwidth());
+    it = media_infos_.erase(it);
+  }
+}
+
 void MpdWriter::AddBaseUrl(const std::string& base_url) {
   base_urls_.push_back(base_url);
 }
 
 bool MpdWriter::WriteMpdToFile(const char* file_name) {
   CHECK(file_name);
+  // Segment-templated MediaInfos (e.g. merged shard outputs) can only be
+  // represented with the live profile; single-file MediaInfos keep using the
+  // on-demand profile.
+  DashProfile profile = kOnDemandProfile;
+  for (std::list<MediaInfo>::const_iterator it = media_infos_.begin();
+       it != media_infos_.end();
+       ++it) {
+    if (it->has_segment_template()) {
+      profile = kLiveProfile;
+      break;
+    }
+  }
   scoped_ptr<MpdNotifier> notifier = notifier_factory_->Create(
-      kOnDemandProfile, MpdOptions(), base_urls_, file_name);
+      profile, MpdOptions(), base_urls_, file_name);
   if (!notifier->Init()) {
     LOG(ERROR) << "failed to initialize MpdNotifier.";
     return false;
@@ -106,12 +206,16 @@ bool MpdWriter::WriteMpdToFile(const char* file_name) {
   for (std::list<MediaInfo>::const_iterator it = media_infos_.begin();
        it != media_infos_.end();
        ++it) {
-    uint32_t unused_conatiner_id;
-    if (!notifier->NotifyNewContainer(*it, &unused_conatiner_id)) {
+    uint32_t container_id;
+    if (!notifier->NotifyNewContainer(*it, &container_id)) {
       LOG(ERROR) << "Failed to add MediaInfo for media file: "
                  << it->media_file_name();
       return false;
     }
+    if (it->has_segment_template() &&
+        !NotifyTemplatedSegments(*it, container_id, notifier.get())) {
+      return false;
+    }
   }
 
   if (!notifier->Flush()) {
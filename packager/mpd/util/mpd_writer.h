@@ -26,6 +26,11 @@ class File;
 
 class MediaInfo;
 
+/// Reads a MediaInfo text proto from @a media_info_path into @a media_info.
+/// @return true on success, false otherwise.
+bool ReadMediaInfoFile(const std::string& media_info_path,
+                       MediaInfo* media_info);
+
 /// This is mainly for testing, and is implementation detail. No need to worry
 /// about this class if you are just using the API.
 /// Inject a factory and mock MpdNotifier to test the MpdWriter implementation.
@@ -61,11 +66,28 @@ class MpdWriter {
   bool AddFile(const std::string& media_info_path,
                const std::string& mpd_path);
 
+  // Add an already parsed |media_info| for MPD generation. Same as AddFile()
+  // without the file read and parse, so callers generating many MPDs can
+  // parse each MediaInfo file once and reuse the proto.
+  void AddMediaInfo(const MediaInfo& media_info, const std::string& mpd_path);
+
+  // Merge MediaInfos added so far that are time-range shards of the same
+  // stream into one MediaInfo per stream. MediaInfos sharing the same init
+  // segment name and segment template are treated as shards, in the order
+  // they were added: their durations are summed and the largest bandwidth
+  // wins. MediaInfos without a segment template are left untouched. This is
+  // the merge half of packaging a long asset as several worker invocations,
+  // each covering one time range of segment-aligned output.
+  void MergeShardMediaInfos();
+
   // |base_url| will be used for <BaseURL> element for the MPD. The BaseURL
   // element will be a direct child element of the <MPD> element.
   void AddBaseUrl(const std::string& base_url);
 
   // Write the MPD to |file_name|. |file_name| should not be NULL.
+  // MediaInfos with a segment template (e.g. merged shard outputs) produce a
+  // live profile MPD with the segment timeline reconstructed from the segment
+  // duration; otherwise the MPD uses the on-demand profile.
   // This opens the file in write mode, IOW if the
   // file exists this will over write whatever is in the file.
   // AddFile() should be called before calling this function to generate an MPD.
@@ -7,9 +7,12 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <list>
+
 #include "packager/base/files/file_util.h"
 #include "packager/base/path_service.h"
 #include "packager/mpd/base/dash_iop_mpd_notifier.h"
+#include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mock_mpd_notifier.h"
 #include "packager/mpd/base/mpd_options.h"
 #include "packager/mpd/test/mpd_builder_test_helper.h"
@@ -71,6 +74,8 @@ class MpdWriterTest : public ::testing::Test {
     mpd_writer_.SetMpdNotifierFactoryForTest(notifier_factory_.Pass());
   }
 
+  std::list<MediaInfo>& media_infos() { return mpd_writer_.media_infos_; }
+
   scoped_ptr<TestMpdNotifierFactory> notifier_factory_;
   MpdWriter mpd_writer_;
 };
@@ -102,4 +107,35 @@ TEST_F(MpdWriterTest, WriteMpdToFile) {
   EXPECT_TRUE(mpd_writer_.WriteMpdToFile(mpd_file_path.value().c_str()));
 }
 
+// MediaInfos sharing a segment template are shards of one stream: they merge
+// into a single MediaInfo with summed duration and the largest bandwidth.
+// MediaInfos without a segment template are left untouched.
+TEST_F(MpdWriterTest, MergeShardMediaInfos) {
+  MediaInfo video_shard1;
+  video_shard1.set_init_segment_name("video_init.mp4");
+  video_shard1.set_segment_template("video_$Number$.mp4");
+  video_shard1.set_media_duration_seconds(600.0f);
+  video_shard1.set_bandwidth(1000000);
+
+  MediaInfo video_shard2 = video_shard1;
+  video_shard2.set_media_duration_seconds(300.0f);
+  video_shard2.set_bandwidth(1200000);
+
+  MediaInfo audio;
+  audio.set_media_file_name("audio.mp4");
+  audio.set_media_duration_seconds(900.0f);
+
+  mpd_writer_.AddMediaInfo(video_shard1, "");
+  mpd_writer_.AddMediaInfo(audio, "");
+  mpd_writer_.AddMediaInfo(video_shard2, "");
+  mpd_writer_.MergeShardMediaInfos();
+
+  ASSERT_EQ(2u, media_infos().size());
+  const MediaInfo& merged_video = media_infos().front();
+  EXPECT_EQ("video_$Number$.mp4", merged_video.segment_template());
+  EXPECT_FLOAT_EQ(900.0f, merged_video.media_duration_seconds());
+  EXPECT_EQ(1200000u, merged_video.bandwidth());
+  EXPECT_TRUE(media_infos().back().has_media_file_name());
+}
+
 }  // namespace shaka
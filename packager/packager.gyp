@@ -13,10 +13,14 @@
       'target_name': 'packager',
       'type': 'executable',
       'sources': [
+        'app/cpu_affinity.cc',
+        'app/cpu_affinity.h',
         'app/fixed_key_encryption_flags.cc',
         'app/fixed_key_encryption_flags.h',
         'app/hls_flags.cc',
         'app/hls_flags.h',
+        'app/job_daemon.cc',
+        'app/job_daemon.h',
         'app/libcrypto_threading.cc',
         'app/libcrypto_threading.h',
         'app/mpd_flags.cc',
@@ -26,12 +30,16 @@
         'app/packager_main.cc',
         'app/packager_util.cc',
         'app/packager_util.h',
+        'app/sampling_profiler.cc',
+        'app/sampling_profiler.h',
         'app/stream_descriptor.cc',
         'app/stream_descriptor.h',
         'app/validate_flag.cc',
         'app/validate_flag.h',
         'app/vlog_flags.cc',
         'app/vlog_flags.h',
+        'app/watch_folder.cc',
+        'app/watch_folder.h',
         'app/widevine_encryption_flags.cc',
         'app/widevine_encryption_flags.h',
       ],
@@ -40,6 +48,7 @@
         'media/codecs/codecs.gyp:codecs',
         'media/event/media_event.gyp:media_event',
         'media/file/file.gyp:file',
+        'media/formats/escache/es_cache.gyp:escache',
         'media/formats/mp2t/mp2t.gyp:mp2t',
         'media/formats/mp4/mp4.gyp:mp4',
         'media/formats/mpeg/mpeg.gyp:mpeg',
@@ -47,6 +56,7 @@
         'media/formats/webvtt/webvtt.gyp:webvtt',
         'media/formats/wvm/wvm.gyp:wvm',
         'mpd/mpd.gyp:mpd_builder',
+        'mpd/mpd.gyp:mpd_util',
         'third_party/boringssl/boringssl.gyp:boringssl',
         'third_party/gflags/gflags.gyp:gflags',
       ],
@@ -69,10 +79,34 @@
       ],
       'dependencies': [
         'base/base.gyp:base',
+        'media/base/media_base.gyp:media_base',
+        'media/file/file.gyp:file',
         'mpd/mpd.gyp:mpd_util',
         'third_party/gflags/gflags.gyp:gflags',
       ],
     },
+    {
+      # End-to-end pipeline throughput benchmark over synthetic in-memory
+      # streams; see app/packager_benchmark.cc.
+      'target_name': 'packager_benchmark',
+      'type': 'executable',
+      'sources': [
+        'app/packager_benchmark.cc',
+      ],
+      'dependencies': [
+        'media/base/media_base.gyp:media_base',
+        'media/codecs/codecs.gyp:codecs',
+        'media/file/file.gyp:file',
+        'media/formats/escache/es_cache.gyp:escache',
+        'media/formats/mp2t/mp2t.gyp:mp2t',
+        'media/formats/mp4/mp4.gyp:mp4',
+        'media/formats/mpeg/mpeg.gyp:mpeg',
+        'media/formats/webm/webm.gyp:webm',
+        'media/formats/webvtt/webvtt.gyp:webvtt',
+        'media/formats/wvm/wvm.gyp:wvm',
+        'third_party/gflags/gflags.gyp:gflags',
+      ],
+    },
     {
       'target_name': 'packager_test',
       'type': '<(gtest_target_type)',
@@ -82,6 +116,7 @@
       'dependencies': [
         'media/codecs/codecs.gyp:codecs',
         'media/file/file.gyp:file',
+        'media/formats/escache/es_cache.gyp:escache',
         'media/formats/mp2t/mp2t.gyp:mp2t',
         'media/formats/mp4/mp4.gyp:mp4',
         'media/formats/mpeg/mpeg.gyp:mpeg',
@@ -92,6 +127,44 @@
         'testing/gtest.gyp:gtest',
       ],
     },
+    {
+      # Microbenchmarks for hot-path primitives; see media/test/media_benchmarks.cc.
+      'target_name': 'media_benchmarks',
+      'type': 'executable',
+      'sources': [
+        'media/test/media_benchmarks.cc',
+      ],
+      'dependencies': [
+        'media/base/media_base.gyp:media_base',
+        'media/codecs/codecs.gyp:codecs',
+        'media/formats/mp4/mp4.gyp:mp4',
+        'media/test/media_test.gyp:media_test_support',
+        'mpd/mpd.gyp:mpd_builder',
+      ],
+    },
+    {
+      # Release performance gate; replays the packager_test remux scenarios
+      # concurrently against memory files and compares wall/CPU/RSS against a
+      # baseline report. See media/test/packager_perf_tests.cc.
+      'target_name': 'packager_perf_tests',
+      'type': 'executable',
+      'sources': [
+        'media/test/packager_perf_tests.cc',
+      ],
+      'dependencies': [
+        'media/codecs/codecs.gyp:codecs',
+        'media/file/file.gyp:file',
+        'media/formats/escache/es_cache.gyp:escache',
+        'media/formats/mp2t/mp2t.gyp:mp2t',
+        'media/formats/mp4/mp4.gyp:mp4',
+        'media/formats/mpeg/mpeg.gyp:mpeg',
+        'media/formats/webm/webm.gyp:webm',
+        'media/formats/webvtt/webvtt.gyp:webvtt',
+        'media/formats/wvm/wvm.gyp:wvm',
+        'media/test/media_test.gyp:media_test_support',
+        'third_party/gflags/gflags.gyp:gflags',
+      ],
+    },
     {
       'target_name': 'packager_test_py_copy',
       'type': 'none',
@@ -114,6 +187,7 @@
         'media/codecs/codecs.gyp:codecs_unittest',
         'media/event/media_event.gyp:media_event_unittest',
         'media/file/file.gyp:file_unittest',
+        'media/formats/escache/es_cache.gyp:escache_unittest',
         'media/formats/mp2t/mp2t.gyp:mp2t_unittest',
         'media/formats/mp4/mp4.gyp:mp4_unittest',
         'media/formats/webm/webm.gyp:webm_unittest',